@@ -0,0 +1,705 @@
+#include "StratusCommon.h"
+#include "StratusMath.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include <iostream>
+#include <StratusCamera.h>
+#include <chrono>
+#include "StratusEngine.h"
+#include "StratusResourceManager.h"
+#include "StratusLog.h"
+#include "StratusRendererFrontend.h"
+#include "StratusWindow.h"
+#include <StratusLight.h>
+#include "StratusMaterial.h"
+#include "StratusRenderComponents.h"
+#include "StratusAsync.h"
+#include "StratusEntityManager.h"
+#include "StratusEntity.h"
+#include "StratusEntityCommon.h"
+#include "StratusTransformComponent.h"
+#include "StratusProfiler.h"
+#include "StratusBenchmark.h"
+#include "StratusFrameCapture.h"
+#include <memory>
+#include <fstream>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+#include <unordered_map>
+#include <cstring>
+#include <cstdlib>
+#include "CameraController.h"
+
+// Replays a camera path through one of the example scenes at a fixed timestep and writes per
+// subsystem frame time percentiles to a JSON file:
+//
+//   Bench_StratusGFX --scene sponza --frames 2000 --path sponza.path --output sponza.json
+//
+// --record flies the scene with the normal camera controls and saves the path on exit
+// --cpu-only runs without a window or GL context against a procedural scene (see CpuScene)
+// --pipelined simulates each frame while the previous one renders (see EngineInitParams::pipelined)
+// --capture records what the renderer frontend is given each frame (see FrameCapture)
+// --replay plays a capture back instead of a scene, one captured frame per benchmark frame, until it
+//   runs out. With --cpu-only no GL calls are made and the renderer frontend runs headless.
+struct BenchmarkOptions {
+    std::string scene = "sponza";
+    uint32_t frames = 1000;
+    uint32_t warmupFrames = 100;
+    double timestep = 1.0 / 60.0;
+    std::string path;
+    std::string output = "benchmark.json";
+    std::string trace;
+    std::string capture;
+    std::string replay;
+    bool record = false;
+    bool cpuOnly = false;
+    bool pipelined = false;
+    uint32_t entities = 20000;
+    uint32_t lights = 256;
+    uint32_t seed = 1234;
+};
+
+static BenchmarkOptions options;
+
+struct BenchmarkScene {
+    const char * name;
+    const char * file;
+    float scale;
+    glm::vec3 rotation;
+    bool optimizeGraph;
+    stratus::RenderFaceCulling culling;
+    // Used by the default orbit when no path was given
+    glm::vec3 center;
+    float orbitRadius;
+    float orbitHeight;
+};
+
+// Same files and transforms as the ExampleEnv0x applications
+static const BenchmarkScene scenes[] = {
+    { "sponza",        "../Resources/Sponza.glb",            15.0f, glm::vec3(0.0f,   90.0f, 0.0f), true,  stratus::RenderFaceCulling::CULLING_CCW,  glm::vec3(0.0f, 50.0f, 0.0f),   300.0f, 0.0f },
+    { "interrogation", "../Resources/InterrogationRoom.glb", 15.0f, glm::vec3(0.0f,    0.0f, 0.0f), false, stratus::RenderFaceCulling::CULLING_NONE, glm::vec3(0.0f, 30.0f, 0.0f),   60.0f,  0.0f },
+    { "sanmiguel",     "../Resources/SanMiguel.glb",         10.0f, glm::vec3(0.0f,    0.0f, 0.0f), true,  stratus::RenderFaceCulling::CULLING_NONE, glm::vec3(95.0f, 14.0f, 94.0f), 60.0f,  10.0f },
+    { "bistro",        "../Resources/Bistro.glb",            10.0f, glm::vec3(0.0f,    0.0f, 0.0f), true,  stratus::RenderFaceCulling::CULLING_CCW,  glm::vec3(0.0f, 30.0f, 0.0f),   400.0f, 20.0f },
+    { "bathroom",      "../Resources/Bathroom.glb",          10.0f, glm::vec3(0.0f,   70.0f, 0.0f), true,  stratus::RenderFaceCulling::CULLING_NONE, glm::vec3(0.0f, 20.0f, 0.0f),   40.0f,  0.0f },
+    { "warehouse",     "../Resources/Warehouse.glb",         0.25f, glm::vec3(0.0f,    0.0f, 0.0f), true,  stratus::RenderFaceCulling::CULLING_NONE, glm::vec3(0.0f, 20.0f, 0.0f),   100.0f, 0.0f },
+    { "cornellbox",    "../Resources/CornellBox.glb",        15.0f, glm::vec3(0.0f, -180.0f, 0.0f), true,  stratus::RenderFaceCulling::CULLING_NONE, glm::vec3(0.0f, 15.0f, 0.0f),   20.0f,  0.0f },
+    { "junkshop",      "../Resources/JunkShop.glb",          10.0f, glm::vec3(0.0f,   90.0f, 0.0f), true,  stratus::RenderFaceCulling::CULLING_CCW,  glm::vec3(0.0f, 20.0f, 0.0f),   60.0f,  0.0f }
+};
+
+static const BenchmarkScene * FindScene(const std::string& name) {
+    for (const BenchmarkScene& scene : scenes) {
+        if (name == scene.name) return &scene;
+    }
+    return nullptr;
+}
+
+static double ElapsedMsec(const std::chrono::high_resolution_clock::time_point& start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Stand-in for a real scene when running without GL. Every entity is a box with bounds but no GPU
+// data (see Meshlet::FinalizeWithoutGpuData) and the lights are given to the renderer frontend, so a
+// headless frontend (see RendererParams::headless) does the same per frame work it would for a real
+// scene: transform updates, light and shadow invalidation, camera culling and the point shadow pass.
+class CpuScene {
+public:
+    void Create(const uint32_t numEntities, const uint32_t numLights, const uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> height(0.0f, 100.0f);
+        std::uniform_real_distribution<float> scale(0.5f, 5.0f);
+
+        // Roots with a few children each, about 1 in 8 of the roots spin every frame
+        constexpr uint32_t childrenPerRoot = 4;
+        const uint32_t numRoots = std::max<uint32_t>(numEntities / (childrenPerRoot + 1), 1);
+        for (uint32_t i = 0; i < numRoots; ++i) {
+            const bool animated = i % 8 == 0;
+            auto root = stratus::CreateTransformEntity();
+            AttachBox(root, /* staticEntity = */ !animated, /* lightInteracting = */ true);
+            auto rootTransform = stratus::GetComponent<stratus::LocalTransformComponent>(root);
+            rootTransform->SetLocalPosition(glm::vec3(position(rng), height(rng), position(rng)));
+            rootTransform->SetLocalScale(glm::vec3(scale(rng)));
+
+            for (uint32_t c = 0; c < childrenPerRoot; ++c) {
+                auto child = stratus::CreateTransformEntity();
+                AttachBox(child, !animated, true);
+                stratus::GetComponent<stratus::LocalTransformComponent>(child)->SetLocalPosition(
+                    glm::vec3(float(c) * 2.0f, 1.0f, 0.0f));
+                root->AttachChildNode(child);
+            }
+
+            if (animated) animated_.push_back(root);
+            INSTANCE(EntityManager)->AddEntity(root);
+        }
+
+        for (uint32_t i = 0; i < numLights; ++i) {
+            auto light = stratus::LightPtr(new stratus::PointLight(/* staticLight = */ false));
+            light->SetPosition(glm::vec3(position(rng), height(rng), position(rng)));
+            light->SetIntensity(std::uniform_real_distribution<float>(100.0f, 2000.0f)(rng));
+            lights_.push_back(light);
+            INSTANCE(RendererFrontend)->AddLight(light);
+        }
+    }
+
+    // Gives a transform entity a render component with a 2x2x2 box mesh. Must be called before the
+    // entity is added to the entity manager.
+    void AttachBox(const stratus::EntityPtr& entity, const bool staticEntity, const bool lightInteracting) {
+        if (box_ == nullptr) {
+            box_ = std::make_shared<stratus::MeshData>();
+            box_->meshes.push_back(CreateBox(glm::vec3(-1.0f), glm::vec3(1.0f)));
+            box_->transforms.push_back(glm::mat4(1.0f));
+        }
+        AttachMeshes(entity, box_, { INSTANCE(MaterialManager)->CreateDefault() }, staticEntity, lightInteracting);
+    }
+
+    // Same as AttachBox with one material per mesh
+    static void AttachMeshes(const stratus::EntityPtr& entity, const std::shared_ptr<stratus::MeshData>& meshes,
+                             const std::vector<stratus::MaterialPtr>& materials, const bool staticEntity, const bool lightInteracting) {
+        entity->Components().AttachComponent<stratus::RenderComponent>();
+        entity->Components().AttachComponent<stratus::LightInteractionComponent>();
+        entity->Components().AttachComponent<stratus::StaticObjectComponent>();
+        if (!staticEntity) entity->Components().DisableComponent<stratus::StaticObjectComponent>();
+        if (!lightInteracting) entity->Components().DisableComponent<stratus::LightInteractionComponent>();
+
+        auto rc = stratus::GetComponent<stratus::RenderComponent>(entity);
+        rc->meshes = meshes;
+        for (const auto& material : materials) rc->AddMaterial(material);
+    }
+
+    // Box mesh with bounds but no GPU data
+    static stratus::MeshPtr CreateBox(const glm::vec3& vmin, const glm::vec3& vmax) {
+        stratus::MeshPtr mesh = stratus::Mesh::Create();
+        stratus::MeshletPtr meshlet = mesh->NewMeshlet();
+        for (int corner = 0; corner < 8; ++corner) {
+            meshlet->AddVertex(glm::vec3((corner & 1) ? vmax.x : vmin.x, (corner & 2) ? vmax.y : vmin.y, (corner & 4) ? vmax.z : vmin.z));
+        }
+        meshlet->CalculateAabbs(glm::mat4(1.0f));
+        meshlet->FinalizeWithoutGpuData();
+        return mesh;
+    }
+
+    void Animate(const double seconds) {
+        STRATUS_PROFILE_SCOPE("Animation");
+        const float angle = float(seconds) * 45.0f;
+        for (const auto& root : animated_) {
+            stratus::GetComponent<stratus::LocalTransformComponent>(root)->SetLocalRotation(
+                stratus::Rotation(stratus::Degrees(0.0f), stratus::Degrees(angle), stratus::Degrees(0.0f)));
+        }
+        // Lights drift up and down so their shadow state is invalidated each frame
+        const float offset = std::sin(float(seconds)) * 0.1f;
+        for (const auto& light : lights_) {
+            light->SetPosition(light->GetPosition() + glm::vec3(0.0f, offset, 0.0f));
+        }
+    }
+
+private:
+    std::vector<stratus::EntityPtr> animated_;
+    std::vector<stratus::LightPtr> lights_;
+    // Shared by every entity
+    std::shared_ptr<stratus::MeshData> box_;
+};
+
+// Plays a capture back one frame at a time. Lights, camera and settings go to the renderer frontend.
+// Entities come back at their captured world transforms with the meshes and materials of the model
+// node they were captured with. Headless runs can't load models so each mesh is replaced by a box
+// of the captured bounds, which the frontend culls and shadows the same way.
+class CaptureReplay {
+public:
+    // Throws std::runtime_error if the file is not a capture or is corrupt. With loadModels every model
+    // the capture refers to is requested up front so that entities have their meshes the frame they
+    // are added (see Loading).
+    void Open(const std::string& file, const bool loadModels) {
+        if (loadModels) {
+            stratus::FrameCaptureReader scan(file);
+            stratus::CapturedFrame frame;
+            while (scan.Next(frame)) {
+                for (const stratus::CapturedEntity& entity : frame.entities) {
+                    if (entity.model.empty() || models_.find(entity.model) != models_.end()) continue;
+                    models_.insert(std::make_pair(entity.model, INSTANCE(ResourceManager)->LoadModel(
+                        entity.model, stratus::ColorSpace::SRGB, entity.modelOptimizeGraph, stratus::RenderFaceCulling(entity.modelCullMode))));
+                }
+            }
+        }
+        reader_ = std::make_unique<stratus::FrameCaptureReader>(file);
+    }
+
+    bool Loading() const {
+        for (const auto& model : models_) {
+            if (!model.second.Completed()) return true;
+        }
+        return false;
+    }
+
+    // Returns false once the capture runs out. Throws std::runtime_error if it is corrupt.
+    bool Next(const stratus::CameraPtr& camera, CpuScene * scene) {
+        if (!reader_->Next(frame_)) return false;
+
+        stratus::RendererFrontend * frontend = INSTANCE(RendererFrontend);
+        for (const stratus::CapturedLight& light : frame_.lights) ApplyLight_(light, frontend);
+        for (const stratus::CapturedEntity& entity : frame_.entities) ApplyEntity_(entity, scene);
+
+        if (frame_.hasCamera) {
+            camera->SetPosition(frame_.cameraPosition);
+            camera->SetAngle(stratus::Rotation(stratus::Degrees(frame_.cameraPitch), stratus::Degrees(frame_.cameraYaw), stratus::Degrees(0.0f)));
+        }
+
+        stratus::RendererSettings settings = frontend->GetSettings();
+        stratus::ApplyCapturedSettings(frame_.settings, settings);
+        frontend->SetSettings(settings);
+        frontend->SetClearColor(frame_.clearColor);
+        frontend->SetFovY(stratus::Degrees(frame_.fovy));
+        frontend->SetNearFar(frame_.znear, frame_.zfar);
+
+        return true;
+    }
+
+    const stratus::CapturedFrame& Frame() const {
+        return frame_;
+    }
+
+private:
+    void ApplyLight_(const stratus::CapturedLight& captured, stratus::RendererFrontend * frontend) {
+        if (captured.change == stratus::CaptureChange::CLEARED) {
+            frontend->ClearLights();
+            lights_.clear();
+            return;
+        }
+
+        auto it = lights_.find(captured.id);
+        if (captured.change == stratus::CaptureChange::ADDED) {
+            // The frontend ignores lights it already has
+            if (it != lights_.end()) return;
+            stratus::LightPtr light = captured.virtualLight
+                ? stratus::LightPtr(new stratus::VirtualPointLight())
+                : stratus::LightPtr(new stratus::PointLight(captured.staticLight));
+            SetLightState_(captured, light);
+            lights_.insert(std::make_pair(captured.id, light));
+            frontend->AddLight(light);
+        }
+        else if (it == lights_.end()) {
+            return;
+        }
+        else if (captured.change == stratus::CaptureChange::CHANGED) {
+            SetLightState_(captured, it->second);
+        }
+        else if (captured.change == stratus::CaptureChange::REMOVED) {
+            frontend->RemoveLight(it->second);
+            lights_.erase(it);
+        }
+    }
+
+    static void SetLightState_(const stratus::CapturedLight& captured, const stratus::LightPtr& light) {
+        light->SetPosition(captured.position);
+        light->SetColor(captured.color);
+        light->SetIntensity(captured.intensity);
+        light->SetCastsShadows(captured.castsShadows);
+    }
+
+    void ApplyEntity_(const stratus::CapturedEntity& captured, CpuScene * scene) {
+        auto it = entities_.find(captured.id);
+        if (captured.change == stratus::CaptureChange::ADDED) {
+            if (it != entities_.end()) return;
+            stratus::EntityPtr entity = stratus::CreateTransformEntity();
+            SetTransform_(captured.transform, entity);
+            // The renderer only does per-entity work for entities with meshes
+            if (captured.meshes.size() > 0) {
+                if (scene != nullptr) AttachBoxes_(captured, entity);
+                else AttachModelNode_(captured, entity);
+            }
+            entities_.insert(std::make_pair(captured.id, entity));
+            INSTANCE(EntityManager)->AddEntity(entity);
+        }
+        else if (it == entities_.end()) {
+            return;
+        }
+        else if (captured.change == stratus::CaptureChange::REMOVED) {
+            INSTANCE(EntityManager)->RemoveEntity(it->second);
+            entities_.erase(it);
+        }
+        else {
+            SetTransform_(captured.transform, it->second);
+            if (captured.change == stratus::CaptureChange::CHANGED) SetComponentStatus_(captured, it->second);
+        }
+    }
+
+    void AttachModelNode_(const stratus::CapturedEntity& captured, const stratus::EntityPtr& entity) {
+        auto model = models_.find(captured.model);
+        if (model == models_.end() || !model->second.Completed() || model->second.Failed()) {
+            STRATUS_WARN << "Replayed entity " << captured.id << " has no model to take its meshes from" << std::endl;
+            return;
+        }
+
+        stratus::EntityPtr node = stratus::ResourceManager::FindModelNode(model->second.GetPtr(), captured.modelNode);
+        if (node == nullptr) {
+            STRATUS_WARN << "Model " << captured.model << " has no node " << captured.modelNode << std::endl;
+            return;
+        }
+
+        // Shares the model's mesh data the same way copies of a loaded model do
+        entity->Components().AttachComponent<stratus::RenderComponent>(*stratus::GetComponent<stratus::RenderComponent>(node));
+        entity->Components().AttachComponent<stratus::LightInteractionComponent>();
+        entity->Components().AttachComponent<stratus::StaticObjectComponent>();
+        SetComponentStatus_(captured, entity);
+
+        // Materials may have been swapped after the model was loaded
+        auto rc = stratus::GetComponent<stratus::RenderComponent>(entity);
+        for (size_t i = 0; i < captured.meshes.size() && i < rc->GetMaterialCount(); ++i) {
+            if (captured.meshes[i].material.empty()) continue;
+            stratus::MaterialPtr material = INSTANCE(MaterialManager)->GetMaterial(captured.meshes[i].material);
+            if (material != nullptr && material != rc->GetMaterialAt(i)) rc->SetMaterialAt(material, i);
+        }
+    }
+
+    void AttachBoxes_(const stratus::CapturedEntity& captured, const stratus::EntityPtr& entity) {
+        // Entities made from the same model node share their boxes
+        const std::string key = captured.model + "#" + std::to_string(captured.modelNode);
+        std::shared_ptr<stratus::MeshData> boxes = captured.model.empty() ? nullptr : boxes_[key];
+        if (boxes == nullptr) {
+            boxes = std::make_shared<stratus::MeshData>();
+            if (!captured.model.empty()) boxes_[key] = boxes;
+            for (const stratus::CapturedMesh& mesh : captured.meshes) {
+                boxes->meshes.push_back(CpuScene::CreateBox(mesh.boundsMin, mesh.boundsMax));
+                boxes->transforms.push_back(glm::mat4(1.0f));
+            }
+        }
+
+        std::vector<stratus::MaterialPtr> materials;
+        for (const stratus::CapturedMesh& mesh : captured.meshes) {
+            materials.push_back(mesh.material.empty()
+                ? INSTANCE(MaterialManager)->CreateDefault()
+                : INSTANCE(MaterialManager)->GetOrCreateMaterial(mesh.material));
+        }
+        CpuScene::AttachMeshes(entity, boxes, materials, captured.staticEntity, captured.lightInteracting);
+    }
+
+    static void SetComponentStatus_(const stratus::CapturedEntity& captured, const stratus::EntityPtr& entity) {
+        if (!entity->Components().ContainsComponent<stratus::StaticObjectComponent>()) return;
+        if (captured.staticEntity) entity->Components().EnableComponent<stratus::StaticObjectComponent>();
+        else entity->Components().DisableComponent<stratus::StaticObjectComponent>();
+        if (captured.lightInteracting) entity->Components().EnableComponent<stratus::LightInteractionComponent>();
+        else entity->Components().DisableComponent<stratus::LightInteractionComponent>();
+    }
+
+    // Placeholders have no parent so the captured world transform becomes the local one
+    static void SetTransform_(const glm::mat4& transform, const stratus::EntityPtr& entity) {
+        const glm::vec3 scale(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])));
+        glm::mat3 rotation(1.0f);
+        for (int i = 0; i < 3; ++i) {
+            if (scale[i] > 0.0f) rotation[i] = glm::vec3(transform[i]) / scale[i];
+        }
+        stratus::GetComponent<stratus::LocalTransformComponent>(entity)->SetLocalTransform(scale, rotation, glm::vec3(transform[3]));
+    }
+
+private:
+    std::unique_ptr<stratus::FrameCaptureReader> reader_;
+    stratus::CapturedFrame frame_;
+    std::unordered_map<stratus::u64, stratus::LightPtr> lights_;
+    std::unordered_map<stratus::u64, stratus::EntityPtr> entities_;
+    // Keyed by file
+    std::unordered_map<std::string, stratus::Async<stratus::Entity>> models_;
+    // Headless stand ins keyed by model file and node
+    std::unordered_map<std::string, std::shared_ptr<stratus::MeshData>> boxes_;
+};
+
+class BenchmarkRunner : public stratus::Application {
+public:
+    virtual ~BenchmarkRunner() = default;
+
+    const char * GetAppName() const override {
+        return "Benchmark";
+    }
+
+    virtual bool Initialize() override {
+        STRATUS_LOG << "Initializing Benchmark (" << (options.cpuOnly ? "cpu-only" : options.scene) << ")" << std::endl;
+
+        camera_ = stratus::CameraPtr(new stratus::Camera(false, false));
+
+        if (options.replay.size() > 0) {
+            if (options.record) {
+                STRATUS_ERROR << "--record can't be used with --replay" << std::endl;
+                return false;
+            }
+            try {
+                replay_.Open(options.replay, /* loadModels = */ !options.cpuOnly);
+            }
+            catch (const std::runtime_error& e) {
+                STRATUS_ERROR << e.what() << std::endl;
+                return false;
+            }
+            INSTANCE(RendererFrontend)->SetCamera(camera_);
+            loading_ = !options.cpuOnly;
+            return true;
+        }
+
+        if (options.cpuOnly) {
+            if (options.record) {
+                STRATUS_ERROR << "--record needs a window and can't be used with --cpu-only" << std::endl;
+                return false;
+            }
+            cpuScene_.Create(options.entities, options.lights, options.seed);
+            path_ = stratus::CameraPath::Orbit(glm::vec3(0.0f, 50.0f, 0.0f), 400.0f, 0.0f, 30.0);
+            loading_ = false;
+        }
+        else {
+            scene_ = FindScene(options.scene);
+            if (scene_ == nullptr) {
+                STRATUS_ERROR << "Unknown scene: " << options.scene << std::endl;
+                return false;
+            }
+            LoadScene_();
+        }
+
+        if (options.path.size() > 0 && !options.record) {
+            if (!stratus::CameraPath::Load(options.path, path_) || path_.Empty()) {
+                STRATUS_ERROR << "Unable to load camera path: " << options.path << std::endl;
+                return false;
+            }
+        }
+        else if (path_.Empty()) {
+            path_ = stratus::CameraPath::Orbit(scene_->center, scene_->orbitRadius, scene_->orbitHeight, 30.0);
+        }
+
+        if (options.record) {
+            // The controller creates and owns the frontend's camera, we sample it every frame
+            stratus::InputHandlerPtr controller(new CameraController(path_.Sample(0.0).position));
+            INSTANCE(InputManager)->AddInputHandler(controller);
+        }
+        else {
+            INSTANCE(RendererFrontend)->SetCamera(camera_);
+        }
+
+        return true;
+    }
+
+    virtual stratus::SystemStatus Update(const double deltaSeconds) override {
+        const auto frameStart = std::chrono::high_resolution_clock::now();
+
+        if (!options.cpuOnly) {
+            for (auto e : INSTANCE(InputManager)->GetInputEventsLastFrame()) {
+                if (e.type == SDL_QUIT || (e.type == SDL_KEYUP && e.key.keysym.scancode == SDL_SCANCODE_ESCAPE)) {
+                    return Finish_();
+                }
+            }
+        }
+
+        if (loading_) {
+            loading_ = received_ < requested_.size() || replay_.Loading() || INSTANCE(ResourceManager)->IsLoadingTextures();
+            if (loading_) return stratus::SystemStatus::SYSTEM_CONTINUE;
+            STRATUS_LOG << "Scene loaded, starting benchmark" << std::endl;
+        }
+
+        if (options.record) {
+            Record_(deltaSeconds);
+            return stratus::SystemStatus::SYSTEM_CONTINUE;
+        }
+
+        // Everything is driven off of the frame index so that two runs see the same camera
+        const double seconds = double(frame_) * options.timestep;
+        const bool replaying = options.replay.size() > 0;
+        if (replaying) {
+            try {
+                if (!replay_.Next(camera_, options.cpuOnly ? &cpuScene_ : nullptr)) return Finish_();
+            }
+            catch (const std::runtime_error& e) {
+                STRATUS_ERROR << e.what() << std::endl;
+                return Finish_();
+            }
+        }
+        else {
+            const stratus::CameraKeyframe key = path_.Sample(std::fmod(seconds, std::max(path_.Duration(), options.timestep)));
+            camera_->SetPosition(key.position);
+            camera_->SetAngle(stratus::Rotation(stratus::Degrees(key.pitch), stratus::Degrees(key.yaw), stratus::Degrees(0.0f)));
+        }
+
+        const bool measuring = frame_ >= options.warmupFrames;
+        if (frame_ == options.warmupFrames && options.trace.size() > 0) {
+            stratus::Profiler::Instance().StartCapture();
+        }
+
+        // Captured frames already contain whatever moved. Culling and the shadow pass are part of
+        // the RendererFrontend timing below.
+        if (options.cpuOnly && !replaying) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            cpuScene_.Animate(seconds);
+            if (measuring) stats_.Add("Animation", ElapsedMsec(start));
+        }
+
+        if (measuring) {
+            // These were recorded by the engine before the application updated this frame (or
+            // during the previous frame when pipelined)
+            for (const stratus::EngineModuleTiming& timing : INSTANCE(Engine)->GetModuleTimings()) {
+                stats_.Add(timing.name, timing.milliseconds);
+            }
+            // Modules overlap when pipelined so the frame is timed from one update to the next
+            // rather than summed
+            if (frame_ > 0) {
+                stats_.Add("Frame", std::chrono::duration<double, std::milli>(frameStart - prevFrameStart_).count());
+            }
+        }
+
+        prevFrameStart_ = frameStart;
+        ++frame_;
+        if (!replaying && frame_ >= options.warmupFrames + options.frames) return Finish_();
+        return stratus::SystemStatus::SYSTEM_CONTINUE;
+    }
+
+    virtual void Shutdown() override {
+    }
+
+private:
+    void LoadScene_() {
+        std::vector<std::string> files = { scene_->file };
+        if (std::strcmp(scene_->name, "sponza") == 0) files.push_back("../Resources/SponzaCurtains.glb");
+
+        const BenchmarkScene * scene = scene_;
+        for (const std::string& file : files) {
+            stratus::Async<stratus::Entity> e = INSTANCE(ResourceManager)->LoadModel(file, stratus::ColorSpace::SRGB, scene->optimizeGraph, scene->culling);
+            requested_.push_back(e);
+            e.AddCallback([this, scene](stratus::Async<stratus::Entity> e) {
+                ++received_;
+                if (e.Failed()) {
+                    STRATUS_ERROR << "Benchmark scene failed to load" << std::endl;
+                    return;
+                }
+                auto transform = stratus::GetComponent<stratus::LocalTransformComponent>(e.GetPtr());
+                transform->SetLocalScale(glm::vec3(scene->scale));
+                transform->SetLocalRotation(stratus::Rotation(
+                    stratus::Degrees(scene->rotation.x), stratus::Degrees(scene->rotation.y), stratus::Degrees(scene->rotation.z)));
+                INSTANCE(EntityManager)->AddEntity(e.GetPtr());
+            });
+        }
+    }
+
+    void Record_(const double deltaSeconds) {
+        auto camera = INSTANCE(RendererFrontend)->GetCamera();
+        if (camera == nullptr) return;
+
+        stratus::CameraKeyframe key;
+        key.seconds = recordSeconds_;
+        key.position = camera->GetPosition();
+        key.pitch = camera->GetPitch();
+        key.yaw = camera->GetYaw();
+        recorded_.AddKeyframe(key);
+        recordSeconds_ += std::max(deltaSeconds, 1e-6);
+    }
+
+    stratus::SystemStatus Finish_() {
+        if (options.record) {
+            const std::string file = options.path.size() > 0 ? options.path : options.scene + ".path";
+            if (recorded_.Save(file)) {
+                STRATUS_LOG << "Saved " << recorded_.Keyframes().size() << " keyframes to " << file << std::endl;
+            }
+            else {
+                STRATUS_ERROR << "Unable to save camera path: " << file << std::endl;
+            }
+            return stratus::SystemStatus::SYSTEM_SHUTDOWN;
+        }
+
+        if (options.trace.size() > 0 && !stratus::Profiler::Instance().StopCapture(options.trace)) {
+            STRATUS_ERROR << "Unable to write trace: " << options.trace << std::endl;
+        }
+
+        const std::vector<std::pair<std::string, std::string>> run = {
+            { "scene", options.replay.size() > 0 ? options.replay : (options.cpuOnly ? "procedural" : options.scene) },
+            { "mode", std::string(options.replay.size() > 0 ? "replay-" : "") + (options.cpuOnly ? "cpu-only" : (options.pipelined ? "pipelined" : "full")) },
+            { "frames", std::to_string(frame_ > options.warmupFrames ? frame_ - options.warmupFrames : 0) },
+            { "warmupFrames", std::to_string(options.warmupFrames) },
+            { "timestep", std::to_string(options.timestep) },
+            { "path", options.path.size() > 0 ? options.path : "orbit" },
+            { "entities", std::to_string(options.cpuOnly && options.replay.empty() ? options.entities : 0) },
+            { "lights", std::to_string(options.cpuOnly && options.replay.empty() ? options.lights : 0) }
+        };
+
+        std::ofstream out(options.output);
+        if (!out.is_open()) {
+            STRATUS_ERROR << "Unable to write benchmark results: " << options.output << std::endl;
+        }
+        else {
+            stats_.WriteJson(out, run);
+        }
+
+        const stratus::BenchmarkSummary frame = stats_.Summarize("Frame");
+        STRATUS_LOG << "Benchmark finished: mean " << frame.mean << " ms, p50 " << frame.p50
+                    << " ms, p95 " << frame.p95 << " ms, p99 " << frame.p99 << " ms" << std::endl;
+
+        return stratus::SystemStatus::SYSTEM_SHUTDOWN;
+    }
+
+private:
+    const BenchmarkScene * scene_ = nullptr;
+    std::vector<stratus::Async<stratus::Entity>> requested_;
+    size_t received_ = 0;
+    bool loading_ = true;
+    CpuScene cpuScene_;
+    CaptureReplay replay_;
+    stratus::CameraPtr camera_;
+    stratus::CameraPath path_;
+    stratus::CameraPath recorded_;
+    double recordSeconds_ = 0.0;
+    stratus::BenchmarkStats stats_;
+    uint64_t frame_ = 0;
+    std::chrono::high_resolution_clock::time_point prevFrameStart_;
+};
+
+static void PrintUsage() {
+    std::cout << "Usage: Bench_StratusGFX [--scene name] [--frames n] [--warmup n] [--timestep seconds]" << std::endl
+              << "                        [--path file] [--output file] [--trace file] [--record]" << std::endl
+              << "                        [--cpu-only] [--pipelined] [--entities n] [--lights n] [--seed n]" << std::endl
+              << "                        [--capture file] [--replay file]" << std::endl
+              << "Scenes:";
+    for (const BenchmarkScene& scene : scenes) std::cout << " " << scene.name;
+    std::cout << std::endl;
+}
+
+static bool ParseOptions(const int nargs, char ** args) {
+    for (int i = 1; i < nargs; ++i) {
+        const std::string arg = args[i];
+        const bool hasValue = i + 1 < nargs;
+        if (arg == "--record") options.record = true;
+        else if (arg == "--cpu-only") options.cpuOnly = true;
+        else if (arg == "--pipelined") options.pipelined = true;
+        else if (!hasValue) {
+            PrintUsage();
+            return false;
+        }
+        else if (arg == "--scene") options.scene = args[++i];
+        else if (arg == "--frames") options.frames = uint32_t(std::strtoul(args[++i], nullptr, 10));
+        else if (arg == "--warmup") options.warmupFrames = uint32_t(std::strtoul(args[++i], nullptr, 10));
+        else if (arg == "--timestep") options.timestep = std::strtod(args[++i], nullptr);
+        else if (arg == "--path") options.path = args[++i];
+        else if (arg == "--output") options.output = args[++i];
+        else if (arg == "--trace") options.trace = args[++i];
+        else if (arg == "--capture") options.capture = args[++i];
+        else if (arg == "--replay") options.replay = args[++i];
+        else if (arg == "--entities") options.entities = uint32_t(std::strtoul(args[++i], nullptr, 10));
+        else if (arg == "--lights") options.lights = uint32_t(std::strtoul(args[++i], nullptr, 10));
+        else if (arg == "--seed") options.seed = uint32_t(std::strtoul(args[++i], nullptr, 10));
+        else {
+            PrintUsage();
+            return false;
+        }
+    }
+
+    if (options.timestep <= 0.0) {
+        PrintUsage();
+        return false;
+    }
+    return true;
+}
+
+int main(int nargs, char ** args) {
+    if (!ParseOptions(nargs, args)) return 1;
+
+    stratus::EngineInitParams params;
+    params.numCmdArgs = nargs;
+    params.cmdArgs = (const char **)args;
+    params.headless = options.cpuOnly;
+    params.pipelined = options.pipelined;
+    params.captureFile = options.capture;
+    // Recording runs in real time so the path matches how it was flown
+    params.fixedDeltaSeconds = options.record ? 0.0 : options.timestep;
+    stratus::EngineBoot<BenchmarkRunner>(params);
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include "StratusLog.h"
 #include "StratusCamera.h"
 #include "StratusLight.h"
+#include "StratusProfiler.h"
 
 struct FrameRateController : public stratus::InputHandler {
     FrameRateController() {
@@ -41,6 +42,23 @@ struct FrameRateController : public stratus::InputHandler {
                                 STRATUS_LOG << "Max Frame Rate Toggled: " << frameRates_[frameRateIndex_] << std::endl;
                                 break;
                             }
+                            break;
+                        // Starts a profiler capture or stops the current one and writes it out for chrome://tracing / Perfetto
+                        case SDL_SCANCODE_F12:
+                            if (released) {
+                                stratus::Profiler& profiler = stratus::Profiler::Instance();
+                                if (!profiler.IsCapturing()) {
+                                    profiler.StartCapture();
+                                    STRATUS_LOG << "Profiler capture started" << std::endl;
+                                }
+                                else if (profiler.StopCapture("StratusTrace.json")) {
+                                    STRATUS_LOG << "Profiler capture written to StratusTrace.json" << std::endl;
+                                }
+                                else {
+                                    STRATUS_ERROR << "Unable to write profiler capture" << std::endl;
+                                }
+                            }
+                            break;
                     }
                 }
             }
@@ -101,6 +101,7 @@ void LightCreator::CreateVirtualPointLight(const LightParams& p, const bool spaw
     stratus::LightPtr light(new stratus::VirtualPointLight());
     InitLight(p, light);
     ((stratus::VirtualPointLight *)light.get())->SetNumShadowSamples(p.numShadowSamples);
+    ((stratus::VirtualPointLight *)light.get())->SetBaked(p.baked);
 
     stratus::EntityPtr cube;
     if (spawnCube) {
@@ -8,6 +8,7 @@ struct LightParams {
     float intensity;
     bool CastsShadows;
     uint32_t numShadowSamples; // only valid for Virtual Point Lights (VPLs)
+    bool baked = false; // only valid for VPLs (see stratus::VirtualPointLight::SetBaked)
 
     LightParams()
         : LightParams(glm::vec3(0.0f), glm::vec3(1.0f), 1.0f) {}
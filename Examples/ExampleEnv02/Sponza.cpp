@@ -63,7 +63,7 @@ public:
 
         // Disable culling for this model since there are some weird parts that seem to be reversed
         //stratus::Async<stratus::Entity> e = stratus::ResourceManager::Instance()->LoadModel("../Resources/glTF-Sample-Models/2.0/Sponza/glTF/Sponza.gltf", stratus::ColorSpace::SRGB, true, stratus::RenderFaceCulling::CULLING_CCW);
-        stratus::Async<stratus::Entity> e = stratus::ResourceManager::Instance()->LoadModel("../Resources/Sponza.glb", stratus::ColorSpace::SRGB, true, stratus::RenderFaceCulling::CULLING_CCW);
+        stratus::Async<stratus::Entity> e = stratus::ResourceManager::Instance()->LoadModel(sceneFile, stratus::ColorSpace::SRGB, true, stratus::RenderFaceCulling::CULLING_CCW);
         stratus::Async<stratus::Entity> e2 = stratus::ResourceManager::Instance()->LoadModel("../Resources/SponzaCurtains.glb", stratus::ColorSpace::SRGB, true, stratus::RenderFaceCulling::CULLING_CCW);
         requested.push_back(e);
         requested.push_back(e2);
@@ -143,6 +143,15 @@ public:
                                 INSTANCE(RendererFrontend)->RecompileShaders();
                             }
                             break;
+                        case SDL_SCANCODE_B:
+                            if (released && !baking && bakeCountdown == 0) {
+                                // The bake uses the colors the GI pass computes for the VPLs so
+                                // switch back to live VPLs and give them some frames to update
+                                INSTANCE(RendererFrontend)->SetStaticIrradianceProbes(nullptr);
+                                bakeCountdown = 60;
+                                STRATUS_LOG << "Baking irradiance probes in " << bakeCountdown << " frames" << std::endl;
+                            }
+                            break;
                         case SDL_SCANCODE_1: {
                             if (released) {
                                 LightCreator::CreateStationaryLight(
@@ -177,14 +186,16 @@ public:
               for (int y = 0; y < 240; y += 20) {
                   for (int z = -140; z < 180; z += 20) {
                           ++spawned;
-                          LightCreator::CreateVirtualPointLight(
-                              LightParams(glm::vec3(float(x), float(y), float(z)), glm::vec3(1.0f), 1.0f),
-                              false
-                          );
+                          LightParams params(glm::vec3(float(x), float(y), float(z)), glm::vec3(1.0f), 1.0f);
+                          params.baked = true;
+                          LightCreator::CreateVirtualPointLight(params, false);
                   }
               }
            }
 
+           // Falls back to live VPLs until the probes have been baked (B)
+           INSTANCE(RendererFrontend)->LoadStaticIrradianceProbes(sceneFile);
+
         //    for (int x = -160; x < 150; x += 20) {
         //        for (int y = 15; y < 150; y += 20) {
         //            for (int z = -60; z < 60; z += 10) {
@@ -200,6 +211,20 @@ public:
            STRATUS_LOG << "SPAWNED " << spawned << " VPLS\n";
         }
 
+        if (bakeCountdown > 0 && --bakeCountdown == 0) {
+            bake = INSTANCE(RendererFrontend)->BakeStaticIrradianceProbes(20.0f);
+            baking = true;
+        }
+
+        if (baking && bake.Completed()) {
+            baking = false;
+            INSTANCE(RendererFrontend)->SetStaticIrradianceProbes(bake.Result());
+            const std::string probeFile = stratus::IrradianceProbeGrid::ProbeFileForScene(sceneFile);
+            if (bake.Result()->SaveToFile(probeFile)) {
+                STRATUS_LOG << "Saved irradiance probes to " << probeFile << std::endl;
+            }
+        }
+
         // worldLight->setRotation(glm::vec3(75.0f, 0.0f, 0.0f));
         //worldLight->setRotation(stratus::Rotation(stratus::Degrees(30.0f), stratus::Degrees(0.0f), stratus::Degrees(0.0f)));
 
@@ -239,8 +264,13 @@ public:
     }
 
 private:
+    // Baked irradiance probes are stored next to this (see IrradianceProbeGrid::ProbeFileForScene)
+    const std::string sceneFile = "../Resources/Sponza.glb";
     std::vector<stratus::Async<stratus::Entity>> requested;
     std::vector<stratus::EntityPtr> received;
+    stratus::IrradianceProbeBakeJob bake;
+    bool baking = false;
+    int bakeCountdown = 0;
 };
 
 STRATUS_ENTRY_POINT(Sponza)
\ No newline at end of file
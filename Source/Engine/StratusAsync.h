@@ -123,6 +123,20 @@ namespace stratus {
             }
         }
 
+        // Runs listener on whichever thread finishes the work, or right away on this thread if it already
+        // finished (failed or not). Unlike AddCallback this can be called from any thread, so listeners
+        // should be short.
+        void AddCompletionListener(const Thread::ThreadFunction& listener) {
+            {
+                auto ul = LockWrite_();
+                if (!complete_) {
+                    listeners_.push_back(listener);
+                    return;
+                }
+            }
+            listener();
+        }
+
     private:
         std::unique_lock<std::shared_mutex> LockWrite_() const { return std::unique_lock<std::shared_mutex>(mutex_); }
         std::shared_lock<std::shared_mutex> LockRead_()  const { return std::shared_lock<std::shared_mutex>(mutex_); }
@@ -136,6 +150,13 @@ namespace stratus {
             for (auto entry : callbacks) {
                 entry.first->QueueMany(entry.second);
             }
+
+            std::vector<Thread::ThreadFunction> listeners;
+            {
+                auto ul = LockWrite_();
+                listeners = std::move(listeners_);
+            }
+            for (const auto& listener : listeners) listener();
         }
 
     private:
@@ -147,6 +168,7 @@ namespace stratus {
         bool failed_ = false;
         bool complete_ = false;
         std::unordered_map<Thread *, std::vector<Thread::ThreadFunction>> callbacks_;
+        std::vector<Thread::ThreadFunction> listeners_;
     };
 
     // Explicit specialization for void
@@ -223,6 +245,20 @@ namespace stratus {
             }
         }
 
+        // Runs listener on whichever thread finishes the work, or right away on this thread if it already
+        // finished (failed or not). Unlike AddCallback this can be called from any thread, so listeners
+        // should be short.
+        void AddCompletionListener(const Thread::ThreadFunction& listener) {
+            {
+                auto ul = LockWrite_();
+                if (!complete_) {
+                    listeners_.push_back(listener);
+                    return;
+                }
+            }
+            listener();
+        }
+
     private:
         std::unique_lock<std::shared_mutex> LockWrite_() const { return std::unique_lock<std::shared_mutex>(mutex_); }
         std::shared_lock<std::shared_mutex> LockRead_()  const { return std::shared_lock<std::shared_mutex>(mutex_); }
@@ -236,6 +272,13 @@ namespace stratus {
             for (auto entry : callbacks) {
                 entry.first->QueueMany(entry.second);
             }
+
+            std::vector<Thread::ThreadFunction> listeners;
+            {
+                auto ul = LockWrite_();
+                listeners = std::move(listeners_);
+            }
+            for (const auto& listener : listeners) listener();
         }
 
     private:
@@ -246,6 +289,7 @@ namespace stratus {
         bool failed_ = false;
         bool complete_ = false;
         std::unordered_map<Thread*, std::vector<Thread::ThreadFunction>> callbacks_;
+        std::vector<Thread::ThreadFunction> listeners_;
     };
 
     // To use this class, do something like the following:
@@ -297,6 +341,12 @@ namespace stratus {
             impl_->AddCallback([copy, callback]() { callback(copy); });
         }
 
+        // See AsyncImpl_::AddCompletionListener
+        void AddCompletionListener(const Thread::ThreadFunction& listener) {
+            if (impl_ == nullptr) listener();
+            else impl_->AddCompletionListener(listener);
+        }
+
     private:
         std::shared_ptr<AsyncImpl_<E>> impl_;
     };
@@ -333,6 +383,12 @@ namespace stratus {
             impl_->AddCallback([copy, callback]() { callback(copy); });
         }
 
+        // See AsyncImpl_::AddCompletionListener
+        void AddCompletionListener(const Thread::ThreadFunction& listener) {
+            if (impl_ == nullptr) listener();
+            else impl_->AddCompletionListener(listener);
+        }
+
     private:
         std::shared_ptr<AsyncImpl_<void>> impl_;
     };
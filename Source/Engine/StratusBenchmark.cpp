@@ -0,0 +1,154 @@
+#include "StratusBenchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace stratus {
+    void CameraPath::AddKeyframe(const CameraKeyframe& keyframe) {
+        if (keyframes_.size() > 0 && keyframe.seconds <= keyframes_.back().seconds) {
+            throw std::runtime_error("Camera path keyframes must be added in increasing time order");
+        }
+        keyframes_.push_back(keyframe);
+    }
+
+    f64 CameraPath::Duration() const {
+        return keyframes_.size() == 0 ? 0.0 : keyframes_.back().seconds - keyframes_.front().seconds;
+    }
+
+    CameraKeyframe CameraPath::Sample(const f64 seconds) const {
+        if (keyframes_.size() == 0) return CameraKeyframe();
+        if (seconds <= keyframes_.front().seconds) return keyframes_.front();
+        if (seconds >= keyframes_.back().seconds) return keyframes_.back();
+
+        // First keyframe past seconds
+        auto next = std::upper_bound(keyframes_.begin(), keyframes_.end(), seconds,
+            [](const f64 s, const CameraKeyframe& k) { return s < k.seconds; });
+        const CameraKeyframe& b = *next;
+        const CameraKeyframe& a = *(next - 1);
+        const f32 t = f32((seconds - a.seconds) / (b.seconds - a.seconds));
+
+        CameraKeyframe result;
+        result.seconds = seconds;
+        result.position = glm::mix(a.position, b.position, t);
+        result.pitch = a.pitch + (b.pitch - a.pitch) * t;
+        result.yaw = a.yaw + (b.yaw - a.yaw) * t;
+        return result;
+    }
+
+    bool CameraPath::Save(const std::string& file) const {
+        std::ofstream out(file);
+        if (!out.is_open()) return false;
+        out << std::setprecision(9);
+        for (const CameraKeyframe& k : keyframes_) {
+            out << k.seconds << " " << k.position.x << " " << k.position.y << " " << k.position.z << " "
+                << k.pitch << " " << k.yaw << "\n";
+        }
+        return out.good();
+    }
+
+    bool CameraPath::Load(const std::string& file, CameraPath& out) {
+        std::ifstream in(file);
+        if (!in.is_open()) return false;
+
+        CameraPath path;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+            std::istringstream stream(line);
+            CameraKeyframe k;
+            if (!(stream >> k.seconds >> k.position.x >> k.position.y >> k.position.z >> k.pitch >> k.yaw)) return false;
+            if (path.keyframes_.size() > 0 && k.seconds <= path.keyframes_.back().seconds) return false;
+            path.keyframes_.push_back(k);
+        }
+
+        out = std::move(path);
+        return true;
+    }
+
+    CameraPath CameraPath::Orbit(const glm::vec3& center, const f32 radius, const f32 height, const f64 periodSeconds, const u32 steps) {
+        CameraPath path;
+        const u32 count = std::max<u32>(steps, 2);
+        for (u32 i = 0; i <= count; ++i) {
+            const f64 fraction = f64(i) / f64(count);
+            const f32 angle = f32(fraction * 2.0 * M_PI);
+
+            CameraKeyframe k;
+            k.seconds = fraction * periodSeconds;
+            k.position = center + glm::vec3(radius * std::cos(angle), height, radius * std::sin(angle));
+            // The camera looks down -z rotated by yaw about -y, so this faces back towards the center
+            const glm::vec3 toCenter = center - k.position;
+            k.yaw = f32(std::atan2(toCenter.x, -toCenter.z) * 180.0 / M_PI);
+            path.AddKeyframe(k);
+        }
+        return path;
+    }
+
+    void BenchmarkStats::Add(const std::string& section, const f64 milliseconds) {
+        auto it = samples_.find(section);
+        if (it == samples_.end()) {
+            sections_.push_back(section);
+            it = samples_.insert(std::make_pair(section, std::vector<f64>())).first;
+        }
+        it->second.push_back(milliseconds);
+    }
+
+    f64 BenchmarkStats::Percentile(std::vector<f64> samples, const f64 p) {
+        if (samples.size() == 0) return 0.0;
+        const f64 clamped = std::min(std::max(p, 0.0), 100.0);
+        const usize rank = usize(std::ceil(clamped / 100.0 * f64(samples.size())));
+        const usize index = std::max<usize>(rank, 1) - 1;
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    }
+
+    BenchmarkSummary BenchmarkStats::Summarize(const std::string& section) const {
+        BenchmarkSummary summary;
+        auto it = samples_.find(section);
+        if (it == samples_.end() || it->second.size() == 0) return summary;
+
+        const std::vector<f64>& samples = it->second;
+        summary.count = samples.size();
+        summary.min = *std::min_element(samples.begin(), samples.end());
+        summary.max = *std::max_element(samples.begin(), samples.end());
+        f64 total = 0.0;
+        for (const f64 sample : samples) total += sample;
+        summary.mean = total / f64(samples.size());
+        summary.p50 = Percentile(samples, 50.0);
+        summary.p95 = Percentile(samples, 95.0);
+        summary.p99 = Percentile(samples, 99.0);
+        return summary;
+    }
+
+    static void WriteJsonString(std::ostream& out, const std::string& str) {
+        out << '"';
+        for (const char c : str) {
+            if (c == '"' || c == '\\') out << '\\' << c;
+            else if (u8(c) < 0x20) out << ' ';
+            else out << c;
+        }
+        out << '"';
+    }
+
+    void BenchmarkStats::WriteJson(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& run) const {
+        out << std::fixed << std::setprecision(4);
+        out << "{\n  \"run\": {";
+        for (usize i = 0; i < run.size(); ++i) {
+            out << (i == 0 ? "\n    " : ",\n    ");
+            WriteJsonString(out, run[i].first);
+            out << ": ";
+            WriteJsonString(out, run[i].second);
+        }
+        out << "\n  },\n  \"sections\": {";
+        for (usize i = 0; i < sections_.size(); ++i) {
+            const BenchmarkSummary s = Summarize(sections_[i]);
+            out << (i == 0 ? "\n    " : ",\n    ");
+            WriteJsonString(out, sections_[i]);
+            out << ": {\"count\": " << s.count << ", \"mean\": " << s.mean << ", \"min\": " << s.min << ", \"max\": " << s.max
+                << ", \"p50\": " << s.p50 << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << "}";
+        }
+        out << "\n  }\n}\n";
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "StratusTypes.h"
+#include "glm/glm.hpp"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace stratus {
+    struct CameraKeyframe {
+        f64 seconds = 0.0;
+        glm::vec3 position = glm::vec3(0.0f);
+        // Degrees, same as Camera::GetPitch/GetYaw
+        f32 pitch = 0.0f;
+        f32 yaw = 0.0f;
+    };
+
+    // Camera positions over time which a benchmark replays at a fixed timestep. Saved as plain
+    // text with one keyframe per line: seconds x y z pitch yaw
+    class CameraPath {
+    public:
+        // Keyframes must be added in increasing time order, throws otherwise
+        void AddKeyframe(const CameraKeyframe& keyframe);
+        const std::vector<CameraKeyframe>& Keyframes() const { return keyframes_; }
+        bool Empty() const { return keyframes_.size() == 0; }
+        f64 Duration() const;
+
+        // Linearly interpolates between the surrounding keyframes. Times outside of the path
+        // clamp to the first or last keyframe.
+        CameraKeyframe Sample(const f64 seconds) const;
+
+        bool Save(const std::string& file) const;
+        // Returns false if the file can't be read or a line is malformed
+        static bool Load(const std::string& file, CameraPath& out);
+
+        // Circles center once every periodSeconds, looking towards it. Used for scenes which
+        // don't have a recorded path.
+        static CameraPath Orbit(const glm::vec3& center, const f32 radius, const f32 height, const f64 periodSeconds, const u32 steps = 64);
+
+    private:
+        std::vector<CameraKeyframe> keyframes_;
+    };
+
+    struct BenchmarkSummary {
+        usize count = 0;
+        f64 mean = 0.0;
+        f64 min = 0.0;
+        f64 max = 0.0;
+        f64 p50 = 0.0;
+        f64 p95 = 0.0;
+        f64 p99 = 0.0;
+    };
+
+    // Per frame timings in milliseconds, grouped into named sections (one per subsystem)
+    class BenchmarkStats {
+    public:
+        void Add(const std::string& section, const f64 milliseconds);
+        // In the order they were first added
+        const std::vector<std::string>& Sections() const { return sections_; }
+        BenchmarkSummary Summarize(const std::string& section) const;
+
+        // Nearest rank percentile with p on [0, 100]. Returns 0 for no samples.
+        static f64 Percentile(std::vector<f64> samples, const f64 p);
+
+        // Writes {"run": {...}, "sections": {"name": {"count", "mean", "min", "max", "p50", "p95", "p99"}, ...}}
+        // where run holds the given key/value pairs as strings
+        void WriteJson(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& run) const;
+
+    private:
+        std::vector<std::string> sections_;
+        std::unordered_map<std::string, std::vector<f64>> samples_;
+    };
+}
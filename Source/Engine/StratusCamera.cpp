@@ -71,6 +71,15 @@ namespace stratus {
         return speed_;
     }
 
+    // Pitch is the x angle and yaw the y angle (see ModifyAngle)
+    float Camera::GetYaw() const {
+        return rotation_.y.value();
+    }
+
+    float Camera::GetPitch() const {
+        return rotation_.x.value();
+    }
+
     //void Camera::Update(double deltaSeconds) {
     //    glm::vec3 dir = GetDirection();
     //    glm::vec3 up = GetUp();
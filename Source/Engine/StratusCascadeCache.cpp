@@ -0,0 +1,136 @@
+#include "StratusCascadeCache.h"
+#include <algorithm>
+#include <cmath>
+
+namespace stratus {
+    CascadeCache::CascadeCache(const size_t numCascades) {
+        Resize(numCascades);
+    }
+
+    void CascadeCache::Resize(const size_t numCascades) {
+        cascades_.clear();
+        cascades_.resize(numCascades);
+        stats_.clear();
+        stats_.resize(numCascades);
+    }
+
+    size_t CascadeCache::Size() const {
+        return cascades_.size();
+    }
+
+    void CascadeCache::SetCoverageMargin(const float margin) {
+        margin_ = std::max<float>(margin, 0.0f);
+        // Existing projections were computed with the old margin
+        for (auto& cascade : cascades_) {
+            cascade.valid = false;
+        }
+    }
+
+    float CascadeCache::GetCoverageMargin() const {
+        return margin_;
+    }
+
+    void CascadeCache::SetFirstAlternatingCascade(const size_t cascade) {
+        firstAlternatingCascade_ = cascade;
+    }
+
+    void CascadeCache::MarkStaticDirty() {
+        for (auto& cascade : cascades_) {
+            cascade.staticDirty = true;
+        }
+    }
+
+    void CascadeCache::BeginFrame(const glm::vec3& lightDirection, const uint32_t resolution, const bool enabled) {
+        ++frameCount_;
+
+        // Any rotation of the light changes the projection of every static caster
+        const bool lightChanged = lightDirection != lightDirection_;
+        if (!enabled || !enabled_ || lightChanged || resolution != resolution_) {
+            for (auto& cascade : cascades_) {
+                cascade.valid = false;
+            }
+        }
+
+        lightDirection_ = lightDirection;
+        resolution_ = resolution;
+        enabled_ = enabled;
+    }
+
+    CascadeUpdate CascadeCache::UpdateCascade(const size_t cascade, const glm::vec3& minVec, const glm::vec3& maxVec, const float diameter) {
+        CascadeUpdate update;
+        CachedCascade_& cached = cascades_[cascade];
+        CascadeUpdateStats& stats = stats_[cascade];
+
+        if (!enabled_) {
+            update.bounds = ComputeBounds(minVec, maxVec, diameter, resolution_, 0.0f);
+        }
+        else {
+            if (!cached.valid || cached.diameter != diameter || !Covers(cached.bounds, minVec, maxVec)) {
+                cached.bounds = ComputeBounds(minVec, maxVec, diameter, resolution_, margin_);
+                cached.diameter = diameter;
+                cached.valid = true;
+                cached.staticDirty = true;
+            }
+
+            update.bounds = cached.bounds;
+            update.renderStatic = cached.staticDirty;
+            // Far cascades alternate frames (cascade 2 on even frames, cascade 3 on odd frames, ...)
+            // unless their static depth changed in which case the old contents are unusable
+            update.renderDynamic = update.renderStatic ||
+                cascade < firstAlternatingCascade_ ||
+                ((frameCount_ + cascade) % 2) == 0;
+            cached.staticDirty = false;
+        }
+
+        if (update.renderStatic) {
+            ++stats.staticUpdates;
+            stats.lastStaticUpdateFrame = frameCount_;
+        }
+        if (update.renderDynamic) {
+            ++stats.dynamicUpdates;
+        }
+        else {
+            ++stats.skippedUpdates;
+        }
+
+        return update;
+    }
+
+    const std::vector<CascadeUpdateStats>& CascadeCache::GetStats() const {
+        return stats_;
+    }
+
+    uint64_t CascadeCache::FrameCount() const {
+        return frameCount_;
+    }
+
+    bool CascadeCache::Covers(const CascadeBounds& bounds, const glm::vec3& minVec, const glm::vec3& maxVec) {
+        const float halfDimension = bounds.dimension / 2.0f;
+        return bounds.position.x - halfDimension <= minVec.x && maxVec.x <= bounds.position.x + halfDimension &&
+               bounds.position.y - halfDimension <= minVec.y && maxVec.y <= bounds.position.y + halfDimension &&
+               bounds.position.z <= minVec.z && maxVec.z <= bounds.position.z + bounds.depth;
+    }
+
+    CascadeBounds CascadeCache::ComputeBounds(
+        const glm::vec3& minVec,
+        const glm::vec3& maxVec,
+        const float diameter,
+        const uint32_t resolution,
+        const float margin) {
+
+        const float depth = maxVec.z - minVec.z;
+
+        CascadeBounds bounds;
+        bounds.dimension = diameter * (1.0f + 2.0f * margin);
+        bounds.depth = depth * (1.0f + 2.0f * margin);
+
+        // T is the physical width/height of each texel in the shadow map. Snapping the center to a
+        // multiple of it keeps the rasterization of static geometry stable as the camera moves.
+        const float T = bounds.dimension / float(std::max<uint32_t>(resolution, 1));
+        bounds.position = glm::vec3(floorf((maxVec.x + minVec.x) / (2.0f * T)) * T,
+                                    floorf((maxVec.y + minVec.y) / (2.0f * T)) * T,
+                                    minVec.z - depth * margin);
+
+        return bounds;
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace stratus {
+    // Light space region a cascade is rendered with. position.xy is the texel-snapped center
+    // and position.z is the near plane.
+    struct CascadeBounds {
+        glm::vec3 position = glm::vec3(0.0f);
+        // Width/height of the orthographic projection
+        float dimension = 0.0f;
+        // Distance between the near and far planes
+        float depth = 0.0f;
+    };
+
+    // What the backend needs to do for a single cascade this frame
+    struct CascadeUpdate {
+        CascadeBounds bounds;
+        // Static casters need to be re-rendered into the cached static depth layer
+        bool renderStatic = true;
+        // Cascade needs to be refreshed (cached static depth + dynamic casters). When false
+        // the previous frame's depth is reused as-is.
+        bool renderDynamic = true;
+    };
+
+    struct CascadeUpdateStats {
+        // Frames where the static casters were re-rendered
+        uint64_t staticUpdates = 0;
+        // Frames where the cascade was refreshed with dynamic casters
+        uint64_t dynamicUpdates = 0;
+        // Frames where the previous contents were reused
+        uint64_t skippedUpdates = 0;
+        // Value of CascadeCache::FrameCount() when the static casters were last re-rendered
+        uint64_t lastStaticUpdateFrame = 0;
+    };
+
+    // Decides when cascaded shadow maps can reuse previously rendered depth. Each cascade keeps
+    // a padded, texel-snapped projection which only moves once the camera frustum slice is no
+    // longer inside of it. Static casters are rendered once per projection and far cascades
+    // (index >= firstAlternatingCascade) refresh their dynamic casters every other frame.
+    //
+    // This is purely CPU side bookkeeping - the frontend feeds it the light space bounds of each
+    // frustum slice and forwards the result to the backend.
+    class CascadeCache {
+    public:
+        CascadeCache(const size_t numCascades = 0);
+
+        void Resize(const size_t numCascades);
+        size_t Size() const;
+
+        // Fraction of the cascade diameter added to each side of the cached projection. Larger
+        // values mean fewer static re-renders but lower effective shadow resolution.
+        void SetCoverageMargin(const float margin);
+        float GetCoverageMargin() const;
+
+        void SetFirstAlternatingCascade(const size_t cascade);
+
+        // Forces static casters to be re-rendered for every cascade (e.g. static geometry changed)
+        void MarkStaticDirty();
+
+        // Called once per frame before any UpdateCascade calls. Any change in light direction or
+        // resolution invalidates the cached static depth. When caching is disabled every cascade
+        // is fully re-rendered each frame with tight bounds.
+        void BeginFrame(const glm::vec3& lightDirection, const uint32_t resolution, const bool enabled);
+
+        // minVec/maxVec are the light space bounds of the cascade's frustum slice and diameter is
+        // the (frame-invariant) max diameter of that slice
+        CascadeUpdate UpdateCascade(const size_t cascade, const glm::vec3& minVec, const glm::vec3& maxVec, const float diameter);
+
+        const std::vector<CascadeUpdateStats>& GetStats() const;
+        uint64_t FrameCount() const;
+
+        // Returns true if bounds fully contain the region [minVec, maxVec]
+        static bool Covers(const CascadeBounds& bounds, const glm::vec3& minVec, const glm::vec3& maxVec);
+        // Texel-snapped bounds with the given padding (fraction of diameter per side)
+        static CascadeBounds ComputeBounds(
+            const glm::vec3& minVec,
+            const glm::vec3& maxVec,
+            const float diameter,
+            const uint32_t resolution,
+            const float margin
+        );
+
+    private:
+        struct CachedCascade_ {
+            CascadeBounds bounds;
+            float diameter = 0.0f;
+            bool valid = false;
+            bool staticDirty = true;
+        };
+
+        std::vector<CachedCascade_> cascades_;
+        std::vector<CascadeUpdateStats> stats_;
+        glm::vec3 lightDirection_ = glm::vec3(0.0f);
+        uint32_t resolution_ = 0;
+        float margin_ = 0.1f;
+        size_t firstAlternatingCascade_ = 2;
+        uint64_t frameCount_ = 0;
+        bool enabled_ = false;
+    };
+}
@@ -7,25 +7,43 @@
 #include "StratusRendererFrontend.h"
 #include "StratusApplicationThread.h"
 #include "StratusTaskSystem.h"
+#include "StratusProfiler.h"
 #include "StratusEntityManager.h"
 #include "StratusGraphicsDriver.h"
+#include "StratusFrameCapture.h"
 #include <atomic>
 #include <mutex>
 
+void EnsureIsSimulationThread() {
+    if ( !stratus::Engine::Instance()->IsSimulationThread() ) {
+        throw std::runtime_error("Must execute on simulation thread");
+    }
+}
+
 namespace stratus {
     Engine * Engine::instance_ = nullptr;
 
+    // 0.0625 ms up to 128 ms
+    static const std::vector<f64>& MillisecondBounds() {
+        static const std::vector<f64> bounds = MetricsRegistry::ExponentialBounds(0.0625, 2.0, 12);
+        return bounds;
+    }
+
     bool Engine::EngineMain(Application * app, const int numArgs, const char ** args) {
+        EngineInitParams params;
+        params.numCmdArgs = numArgs;
+        params.cmdArgs = args;
+        return EngineMain(app, params);
+    }
+
+    bool Engine::EngineMain(Application * app, const EngineInitParams& params) {
         static std::mutex preventMultipleMainCalls;
         std::unique_lock<std::mutex> ul(preventMultipleMainCalls, std::defer_lock);
         if (!ul.try_lock()) {
             throw std::runtime_error("EngineMain already running");
         }
 
-        // Set up engine params and create global Engine instance
-        EngineInitParams params;
-        params.numCmdArgs = numArgs;
-        params.cmdArgs = args;
+        // Create global Engine instance
         Application::Instance_() = app;
 
         // Delete the instance in case it's left over from a previous run
@@ -45,6 +63,9 @@ namespace stratus {
             Engine::Instance()->ShutDown();
         };
 
+        // The application thread runs on this one
+        STRATUS_PROFILE_THREAD_NAME("Main");
+
         // Enter main loop
         std::atomic<SystemStatus> status(SystemStatus::SYSTEM_CONTINUE);
         const auto runFrame = [&status]() {
@@ -86,7 +107,13 @@ namespace stratus {
     }
 
     Engine::Engine(const EngineInitParams& params)
-        : _params(params) {}
+        : _params(params) {
+        pacer_.SetAdaptive(params.adaptiveFramePacing);
+
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        framesMetric_ = metrics.RegisterCounter("Engine.frames");
+        frameTimeMetric_ = metrics.RegisterHistogram("Engine.frameTimeMs", MillisecondBounds(), "Time between the start of consecutive frames");
+    }
 
     bool Engine::IsInitializing() const {
         return isInitializing_.load();
@@ -109,6 +136,27 @@ namespace stratus {
         return stats_.lastFrameTimeSeconds;
     }
 
+    const std::vector<EngineModuleTiming>& Engine::GetModuleTimings() const {
+        return stats_.moduleTimings;
+    }
+
+    bool Engine::IsHeadless() const {
+        return _params.headless;
+    }
+
+    const FramePacerStats& Engine::GetFramePacerStats() const {
+        return pacer_.Stats();
+    }
+
+    bool Engine::IsPipelined() const {
+        return pipeline_ != nullptr;
+    }
+
+    bool Engine::IsSimulationThread() const {
+        if (IsPipelined()) return pipeline_->IsSimulationThread();
+        return ApplicationThread::Instance()->CurrentIsApplicationThread();
+    }
+
     void Engine::PreInitialize() {
         if (IsInitializing()) {
             throw std::runtime_error("Engine::PreInitialize called twice");
@@ -154,18 +202,38 @@ namespace stratus {
 
         STRATUS_LOG << "Engine initializing" << std::endl;
 
+        // Headless runs have no renderer to overlap with
+        if (_params.pipelined && !_params.headless) {
+            pipeline_ = std::make_unique<FramePipeline>(true);
+        }
+
         InitInput_();
         InitEntityManager_();
         InitTaskSystem_();
         InitMaterialManager_();
-        InitResourceManager_();
-        InitWindow_();
-        InitGraphicsDriver_();
+        // These need a window or a GL context
+        if (!_params.headless) {
+            InitResourceManager_();
+            InitWindow_();
+            InitGraphicsDriver_();
+        }
+        // Headless runs get a frontend with no backend (see RendererParams::headless)
         InitRenderer_();
 
         // Initialize application last
         EngineModuleInit::InitializeEngineModule(Application::Instance(), true);
 
+        if (!_params.metricsFile.empty()) {
+            STRATUS_LOG << "Writing metrics to " << _params.metricsFile << " every " << _params.metricsIntervalSeconds << " seconds" << std::endl;
+            metricsWriter_ = std::make_unique<MetricsFileWriter>(_params.metricsFile, _params.metricsIntervalSeconds);
+        }
+
+        // Only the renderer frontend records anything
+        if (!_params.captureFile.empty() && !_params.headless) {
+            STRATUS_LOG << "Capturing frames to " << _params.captureFile << std::endl;
+            FrameCapture::Instance().Start(_params.captureFile);
+        }
+
         STRATUS_LOG << "Initialization complete" << std::endl;
         isInitializing_.store(false);
     }
@@ -212,6 +280,7 @@ namespace stratus {
         params.appName = Application::Instance()->GetAppName();
         params.fovy = Degrees(75.0f);
         params.vsyncEnabled = false;
+        params.headless = _params.headless;
 
         EngineModuleInit::InitializeEngineModule(RendererFrontend::Instance_(), new RendererFrontend(params), true);
     }
@@ -230,6 +299,12 @@ namespace stratus {
 
         STRATUS_LOG << "Engine shutting down" << std::endl;
 
+        // Nothing runs on the simulation thread past this point
+        pipeline_.reset();
+        // Writes one last snapshot
+        metricsWriter_.reset();
+        FrameCapture::Instance().Stop();
+
         // Application should shut down first
         ShutdownResourceAndDelete_(Application::Instance_());
         ShutdownResourceAndDelete_(TaskSystem::Instance_());
@@ -241,7 +316,7 @@ namespace stratus {
         ShutdownResourceAndDelete_(EntityManager::Instance_());
         //ShutdownResourceAndDelete_(TaskSystem::Instance_());
         // This one does not have a specialized instance
-        GraphicsDriver::Shutdown();
+        if (!_params.headless) GraphicsDriver::Shutdown();
         // This one does not have a shutdown routine
         //DeleteResource_(ApplicationThread::Instance_());
         ShutdownResourceAndDelete_(Log::Instance_());
@@ -250,31 +325,27 @@ namespace stratus {
     // Processes the next full system frame, including rendering. Returns false only
     // if the main engine loop should stop.
     SystemStatus Engine::Frame() {
-        // Calculate new frame time
-        const auto end = std::chrono::high_resolution_clock::now();
-        //const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - _stats.prevFrameStart).count();
-        const auto elapsed = end - stats_.prevFrameStart;
-        const double durationMsec = std::chrono::duration<double, std::micro>(elapsed).count();
-        const auto requestedFrameTimingMsec = 1000000.0 / double(_params.maxFrameRate);
-        // Make sure we haven't exceeded the max frame rate
-        //if (frameRate > _params.maxFrameRate) {
-        if (durationMsec < requestedFrameTimingMsec) {
-            //std::this_thread::sleep_for(std::chrono::nanoseconds(1));
-            return SystemStatus::SYSTEM_CONTINUE;
-        }
-
-        //STRATUS_LOG << durationMsec << " " << requestedFrameTimingMsec << std::endl;
-
         // Validate
         CHECK_IS_APPLICATION_THREAD();
 
         if (IsInitializing()) return SystemStatus::SYSTEM_CONTINUE;
         if (IsShuttingDown()) return SystemStatus::SYSTEM_SHUTDOWN;
 
+        // Block until the next frame is due rather than returning so the caller doesn't spin
+        // on Frame() (a fixed timestep runs as fast as it can)
+        const bool fixedTimestep = _params.fixedDeltaSeconds > 0.0;
+        pacer_.SetTargetFrameRate(fixedTimestep ? 0 : _params.maxFrameRate);
+        pacer_.WaitForNextFrame();
+
+        // Calculate new frame time
+        const auto end = std::chrono::high_resolution_clock::now();
+        //const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - _stats.prevFrameStart).count();
+        const auto elapsed = end - stats_.prevFrameStart;
+
         //std::shared_lock<std::shared_mutex> sl(_mainLoop);
 
         const double duration = std::chrono::duration<double, std::milli>(elapsed).count();
-        const double deltaSeconds = duration / 1000.0;
+        const double deltaSeconds = fixedTimestep ? _params.fixedDeltaSeconds : duration / 1000.0;
         //const double frameRate = 1.0 / deltaSeconds;
 
         //sl.unlock();
@@ -287,27 +358,107 @@ namespace stratus {
         // Update prev frame start to be the beginning of this current frame
         stats_.prevFrameStart = end;
 
+        MetricsRegistry::Instance().Increment(framesMetric_);
+        MetricsRegistry::Instance().Record(frameTimeMetric_, duration);
+
+        // Hands everything profiled during the last frame over to the capture, if one is running
+        STRATUS_PROFILE_FRAME();
+        STRATUS_PROFILE_SCOPE("Engine::Frame");
+
         //ul.unlock();
 
         SystemStatus status;
-        #define UPDATE_MODULE(name)                                     \
-            status = name::Instance()->Update(deltaSeconds);            \
+        #define UPDATE_MODULE_INTO(name, timings)                                               \
+            {                                                                                   \
+                STRATUS_PROFILE_SCOPE(#name);                                                   \
+                static const MetricId updateMetric = MetricsRegistry::Instance().RegisterHistogram( \
+                    #name ".updateMs", MillisecondBounds());                                    \
+                const auto moduleStart = std::chrono::high_resolution_clock::now();             \
+                status = name::Instance()->Update(deltaSeconds);                                \
+                const auto moduleElapsed = std::chrono::high_resolution_clock::now() - moduleStart; \
+                const double moduleMsec = std::chrono::duration<double, std::milli>(moduleElapsed).count(); \
+                timings.push_back(EngineModuleTiming{ #name, moduleMsec });                     \
+                MetricsRegistry::Instance().Record(updateMetric, moduleMsec);                   \
+            }                                                                                   \
             if (status != SystemStatus::SYSTEM_CONTINUE) return status;
 
+        #define UPDATE_MODULE(name) UPDATE_MODULE_INTO(name, stats_.moduleTimings)
+
+        if (IsPipelined()) {
+            return PipelinedFrame_(deltaSeconds);
+        }
+
+        stats_.moduleTimings.clear();
+
         // Update core modules
         UPDATE_MODULE(Log)
         UPDATE_MODULE(InputManager)
         UPDATE_MODULE(EntityManager)
         UPDATE_MODULE(TaskSystem)
         UPDATE_MODULE(MaterialManager)
-        UPDATE_MODULE(ResourceManager)
-        UPDATE_MODULE(Window)
+        if (!_params.headless) {
+            UPDATE_MODULE(ResourceManager)
+            UPDATE_MODULE(Window)
+        }
         UPDATE_MODULE(RendererFrontend)
 
         // Finish with update to application
+        STRATUS_PROFILE_SCOPE("Application");
         return Application::Instance()->Update(deltaSeconds);
+    }
+
+    // Modules which need the application thread update first, then the renderer extracts what
+    // the simulation produced last frame. Input, entities and the application then simulate the
+    // next frame on the pipeline's thread while this one renders.
+    SystemStatus Engine::PipelinedFrame_(const double deltaSeconds) {
+        // The application reads stats_.moduleTimings while this frame is still being timed
+        std::vector<EngineModuleTiming> timings;
+        SystemStatus status;
+
+        UPDATE_MODULE_INTO(Log, timings)
+        UPDATE_MODULE_INTO(TaskSystem, timings)
+        UPDATE_MODULE_INTO(MaterialManager, timings)
+        UPDATE_MODULE_INTO(ResourceManager, timings)
+        UPDATE_MODULE_INTO(Window, timings)
+
+        RendererFrontend * renderer = RendererFrontend::Instance();
+        bool rendering = false;
+        double rendererMsec = 0.0;
+        const auto timeRenderer = [&rendererMsec](const std::function<void (void)>& step) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            step();
+            rendererMsec += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        };
+
+        // Simulation timings are kept separately since they are written from the other thread
+        std::vector<EngineModuleTiming> simulationTimings;
+        status = pipeline_->RunFrame(
+            [&]() {
+                timeRenderer([&]() { rendering = renderer->Extract_(deltaSeconds); });
+            },
+            [deltaSeconds, &simulationTimings]() {
+                SystemStatus status;
+                UPDATE_MODULE_INTO(InputManager, simulationTimings)
+                UPDATE_MODULE_INTO(EntityManager, simulationTimings)
+
+                STRATUS_PROFILE_SCOPE("Application");
+                return Application::Instance()->Update(deltaSeconds);
+            },
+            [&]() {
+                if (rendering) timeRenderer([&]() { renderer->Render_(deltaSeconds); });
+            }
+        );
+
+        timings.insert(timings.end(), simulationTimings.begin(), simulationTimings.end());
+        timings.push_back(EngineModuleTiming{ "RendererFrontend", rendererMsec });
+        static const MetricId rendererMetric = MetricsRegistry::Instance().RegisterHistogram("RendererFrontend.updateMs", MillisecondBounds());
+        MetricsRegistry::Instance().Record(rendererMetric, rendererMsec);
+        stats_.moduleTimings = std::move(timings);
+
+        return status;
 
         #undef UPDATE_MODULE
+        #undef UPDATE_MODULE_INTO
     }
 
     // Main thread is where both engine + application run
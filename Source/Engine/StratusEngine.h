@@ -9,12 +9,20 @@
 #include "StratusHandle.h"
 #include "StratusApplication.h"
 #include "StratusSystemStatus.h"
+#include "StratusFramePipeline.h"
+#include "StratusFramePacer.h"
+#include "StratusMetrics.h"
 #include <shared_mutex>
 #include <memory>
 #include <atomic>
 #include <chrono>
+#include <vector>
 //#include "Renderer.h"
 
+// Throws unless called from the thread entities and the application update on
+void EnsureIsSimulationThread();
+#define CHECK_IS_SIMULATION_THREAD() EnsureIsSimulationThread()
+
 // Useful within an existing main function
 #define STRATUS_INLINE_ENTRY_POINT(ApplicationClass, numArgs, argList)     \
     stratus::EngineBoot<ApplicationClass>(numArgs, (const char **)argList)
@@ -34,6 +42,32 @@ namespace stratus {
         uint32_t           numCmdArgs;
         const char **      cmdArgs;
         uint32_t           maxFrameRate = 1000;
+        // Starts each frame just late enough for its predicted cost to finish at the end of its
+        // slot, which cuts input latency when running below maxFrameRate (see FramePacer::SetAdaptive)
+        bool               adaptiveFramePacing = false;
+        // Skips the window, graphics driver and resource manager so that only the CPU side of the
+        // engine runs (no GL context needed). Their Instance() functions return null. The renderer
+        // frontend still runs without a backend (see RendererParams::headless).
+        bool               headless = false;
+        // When > 0 every frame advances by exactly this many seconds instead of the measured time
+        // and maxFrameRate is ignored, which makes runs repeatable
+        double             fixedDeltaSeconds = 0.0;
+        // Simulates the next frame (input, entities, application) on its own thread while the
+        // application thread renders the previous one (see FramePipeline). Ignored when headless.
+        bool               pipelined = false;
+        // When set a snapshot of MetricsRegistry is appended to this file as a line of JSON every
+        // metricsIntervalSeconds (see MetricsFileWriter)
+        std::string        metricsFile;
+        double             metricsIntervalSeconds = 1.0;
+        // When set everything the renderer frontend is given each frame is recorded to this file
+        // so it can be replayed offline (see FrameCapture). Ignored when headless.
+        std::string        captureFile;
+    };
+
+    // How long one module's Update took
+    struct EngineModuleTiming {
+        const char * name;
+        double milliseconds;
     };
 
     struct EngineStatistics {
@@ -42,6 +76,8 @@ namespace stratus {
         // Records the time the last frame took to complete - 16.0/1000.0 = 60 fps for example
         double lastFrameTimeSeconds = 0.0;
         std::chrono::high_resolution_clock::time_point prevFrameStart = std::chrono::high_resolution_clock::now();
+        // Filled in as each module updates during Frame
+        std::vector<EngineModuleTiming> moduleTimings;
     };
 
     // Engine class which handles initializing all core engine subsystems and helps 
@@ -54,6 +90,7 @@ namespace stratus {
         // Performs first-time start up and then begins the main loop
         // returns: true if EngineMain should be called again, false otherwise
         static bool EngineMain(Application * app, const int numArgs, const char ** args);
+        static bool EngineMain(Application * app, const EngineInitParams& params);
         
         // Creates a new application and calls EngineMain
         template<typename E>
@@ -72,6 +109,21 @@ namespace stratus {
         uint64_t FrameCount() const;
         // Useful functions for checking current and average frame delta seconds
         double LastFrameTimeSeconds() const;
+        // Update times of the modules which have run so far this frame. The application runs last so
+        // from within its Update this has every other module. When pipelined the application runs
+        // alongside the renderer so this holds the previous frame's timings instead. Only valid on the
+        // thread which calls Application::Update.
+        const std::vector<EngineModuleTiming>& GetModuleTimings() const;
+        // Frame time variance and how long frames spent waiting for maxFrameRate. Only valid on the
+        // application thread.
+        const FramePacerStats& GetFramePacerStats() const;
+        // True if started without a window or renderer (see EngineInitParams)
+        bool IsHeadless() const;
+        // True if simulation and rendering overlap (see EngineInitParams)
+        bool IsPipelined() const;
+        // Entities and the application update on the simulation thread. This is the application
+        // thread unless pipelined.
+        bool IsSimulationThread() const;
 
         // Pre-initialization for things like CommandLine, Log, Filesystem
         void PreInitialize();
@@ -99,6 +151,8 @@ namespace stratus {
         void InitResourceManager_();
         void InitWindow_();
         void InitRenderer_();
+        // Frame() when the simulation overlaps rendering (see EngineInitParams::pipelined)
+        SystemStatus PipelinedFrame_(const double deltaSeconds);
 
         template<typename E>
         static void DeleteResource_(E *& ptr) {
@@ -108,6 +162,8 @@ namespace stratus {
 
         template<typename E>
         static void ShutdownResourceAndDelete_(E *& ptr) {
+            // Modules skipped in headless mode were never created
+            if (ptr == nullptr) return;
             ptr->Shutdown();
             DeleteResource_(ptr);
         }
@@ -118,6 +174,11 @@ namespace stratus {
         EngineStatistics stats_;
         EngineInitParams _params;
         Thread * main_;
+        std::unique_ptr<FramePipeline> pipeline_;
+        FramePacer pacer_;
+        std::unique_ptr<MetricsFileWriter> metricsWriter_;
+        MetricId framesMetric_;
+        MetricId frameTimeMetric_;
         std::atomic<bool> isInitializing_{false};
         std::atomic<bool> isShuttingDown_{false};
 
@@ -136,6 +197,16 @@ namespace stratus {
             if (!Engine::EngineMain(app, numArgs, args)) break;
         }
     }
+
+    // Same as above but with full control over the engine params (headless, fixed timestep, ...)
+    template<typename E>
+    void EngineBoot(const EngineInitParams& params) {
+        static_assert(std::is_base_of<Application, E>::value);
+        while (true) {
+            Application * app = new E();
+            if (!Engine::EngineMain(app, params)) break;
+        }
+    }
 }
 
 #endif //STRATUSGFX_ENGINE_H
\ No newline at end of file
@@ -1,6 +1,6 @@
 #include "StratusEntityManager.h"
 #include "StratusEntity.h"
-#include "StratusApplicationThread.h"
+#include "StratusEngine.h"
 #include "StratusTransformComponent.h"
 #include <algorithm>
 
@@ -40,6 +40,12 @@ namespace stratus {
     }
 
     bool EntityManager::Initialize() {
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        entitiesMetric_ = metrics.RegisterGauge("EntityManager.entities", "Entities in the world");
+        processesMetric_ = metrics.RegisterGauge("EntityManager.processes", "Registered entity processes");
+        entitiesAddedMetric_ = metrics.RegisterCounter("EntityManager.entitiesAdded");
+        entitiesRemovedMetric_ = metrics.RegisterCounter("EntityManager.entitiesRemoved");
+
         // Initialize core engine entity processors
         RegisterEntityProcess<TransformProcess>();
 
@@ -47,7 +53,7 @@ namespace stratus {
     }
     
     SystemStatus EntityManager::Update(const double deltaSeconds) {
-        CHECK_IS_APPLICATION_THREAD();
+        CHECK_IS_SIMULATION_THREAD();
 
         // Notify processes of added/removed entities and allow them to
         // perform their process routine
@@ -99,6 +105,12 @@ namespace stratus {
             handlesToPtrs_.erase(handle);
         }
 
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        metrics.SetGauge(entitiesMetric_, f64(entities_.size()));
+        metrics.SetGauge(processesMetric_, f64(processes_.size()));
+        metrics.Increment(entitiesAddedMetric_, i64(entitiesToAdd.size()));
+        metrics.Increment(entitiesRemovedMetric_, i64(entitiesToRemove.size()));
+
         return SystemStatus::SYSTEM_CONTINUE;
     }
     
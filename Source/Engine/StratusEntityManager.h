@@ -1,6 +1,7 @@
 #pragma once
 
 #include "StratusHandle.h"
+#include "StratusMetrics.h"
 #include "StratusSystemModule.h"
 #include <memory>
 #include <unordered_set>
@@ -63,6 +64,10 @@ namespace stratus {
         // Component change lists
         std::unordered_map<EntityPtr, std::vector<EntityComponent *>> addedComponents_;
         std::unordered_set<EntityPtr> componentsEnabledDisabled_;
+        MetricId entitiesMetric_;
+        MetricId processesMetric_;
+        MetricId entitiesAddedMetric_;
+        MetricId entitiesRemovedMetric_;
     };
 
     template<typename E, typename ... Types>
@@ -0,0 +1,471 @@
+#include "StratusFrameCapture.h"
+#include "StratusLog.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace stratus {
+    static const char captureMagic[4] = { 'S', 'F', 'C', 'P' };
+
+    // Per frame flags
+    static constexpr u8 FRAME_HAS_CAMERA = 0x1;
+    static constexpr u8 FRAME_HAS_SETTINGS = 0x2;
+
+    // Light flags
+    static constexpr u8 LIGHT_CASTS_SHADOWS = 0x1;
+    static constexpr u8 LIGHT_VIRTUAL = 0x2;
+    static constexpr u8 LIGHT_STATIC = 0x4;
+
+    // Entity flags
+    static constexpr u8 ENTITY_STATIC = 0x1;
+    static constexpr u8 ENTITY_LIGHT_INTERACTING = 0x2;
+    static constexpr u8 ENTITY_MODEL_OPTIMIZE_GRAPH = 0x4;
+
+    // Smallest encoding of one light or entity record (change byte and a one byte id)
+    static constexpr usize minLightBytes = 2;
+    static constexpr usize minEntityBytes = 2;
+    // Bounds and an empty material name
+    static constexpr usize minMeshBytes = 6 * 4 + 1;
+
+    static bool HasLightState(const CaptureChange change) {
+        return change == CaptureChange::ADDED || change == CaptureChange::CHANGED;
+    }
+
+    static bool HasEntityState(const CaptureChange change) {
+        return change == CaptureChange::ADDED || change == CaptureChange::CHANGED;
+    }
+
+    static bool HasEntityTransform(const CaptureChange change) {
+        return HasEntityState(change) || change == CaptureChange::MOVED;
+    }
+
+    // Settings booleans packed into one varint
+    static u64 PackSettingsFlags(const CapturedSettings& s) {
+        const bool flags[] = {
+            s.vsyncEnabled, s.globalIlluminationEnabled, s.fxaaEnabled, s.taaEnabled, s.bloomEnabled,
+            s.usePerceptualRoughness, s.cpuVplCullingEnabled, s.cascadeCachingEnabled,
+            s.pointShadowFaceCullingEnabled, s.shaderHotReloadEnabled
+        };
+        u64 packed = 0;
+        for (usize i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+            if (flags[i]) packed |= u64(1) << i;
+        }
+        return packed;
+    }
+
+    static void UnpackSettingsFlags(const u64 packed, CapturedSettings& s) {
+        bool * flags[] = {
+            &s.vsyncEnabled, &s.globalIlluminationEnabled, &s.fxaaEnabled, &s.taaEnabled, &s.bloomEnabled,
+            &s.usePerceptualRoughness, &s.cpuVplCullingEnabled, &s.cascadeCachingEnabled,
+            &s.pointShadowFaceCullingEnabled, &s.shaderHotReloadEnabled
+        };
+        for (usize i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+            *flags[i] = (packed & (u64(1) << i)) != 0;
+        }
+    }
+
+    bool CapturedSettings::operator==(const CapturedSettings& other) const {
+        return PackSettingsFlags(*this) == PackSettingsFlags(other) &&
+            cascadeResolution == other.cascadeResolution &&
+            perFrameMaxScratchMemoryBytes == other.perFrameMaxScratchMemoryBytes &&
+            fogColor == other.fogColor &&
+            fogDensity == other.fogDensity &&
+            emissionStrength == other.emissionStrength &&
+            skyboxColorMask == other.skyboxColorMask &&
+            skyboxIntensity == other.skyboxIntensity &&
+            minRoughness == other.minRoughness &&
+            alphaDepthTestThreshold == other.alphaDepthTestThreshold &&
+            emissiveTextureMultiplier == other.emissiveTextureMultiplier &&
+            minGiOcclusionFactor == other.minGiOcclusionFactor;
+    }
+
+    FrameCaptureWriter::FrameCaptureWriter(const std::string& filename)
+        : file_(std::fopen(filename.c_str(), "wb")) {
+        if (file_ == nullptr) throw std::runtime_error("Unable to open frame capture file " + filename);
+
+        for (const char c : captureMagic) buffer_.push_back(u8(c));
+        WriteVarint_(Version);
+        Emit_();
+    }
+
+    FrameCaptureWriter::~FrameCaptureWriter() {
+        std::fclose(file_);
+    }
+
+    void FrameCaptureWriter::Write(const CapturedFrame& frame) {
+        const bool writeSettings = firstFrame_ || frame.settings != lastSettings_;
+        u8 flags = 0;
+        if (frame.hasCamera) flags |= FRAME_HAS_CAMERA;
+        if (writeSettings) flags |= FRAME_HAS_SETTINGS;
+
+        WriteVarint_(frame.frame);
+        WriteDouble_(frame.deltaSeconds);
+        WriteVarint_(frame.viewportWidth);
+        WriteVarint_(frame.viewportHeight);
+        buffer_.push_back(flags);
+        if (frame.hasCamera) {
+            WriteVec_(&frame.cameraPosition[0], 3);
+            WriteFloat_(frame.cameraPitch);
+            WriteFloat_(frame.cameraYaw);
+        }
+        WriteFloat_(frame.fovy);
+        WriteFloat_(frame.znear);
+        WriteFloat_(frame.zfar);
+        WriteVec_(&frame.clearColor[0], 4);
+        if (writeSettings) {
+            WriteSettings_(frame.settings);
+            lastSettings_ = frame.settings;
+            firstFrame_ = false;
+        }
+
+        WriteVarint_(frame.lights.size());
+        for (const CapturedLight& light : frame.lights) {
+            buffer_.push_back(u8(light.change));
+            WriteVarint_(light.id);
+            if (!HasLightState(light.change)) continue;
+
+            u8 lightFlags = 0;
+            if (light.castsShadows) lightFlags |= LIGHT_CASTS_SHADOWS;
+            if (light.virtualLight) lightFlags |= LIGHT_VIRTUAL;
+            if (light.staticLight) lightFlags |= LIGHT_STATIC;
+            buffer_.push_back(lightFlags);
+            WriteVec_(&light.position[0], 3);
+            WriteVec_(&light.color[0], 3);
+            WriteFloat_(light.intensity);
+        }
+
+        WriteVarint_(frame.entities.size());
+        for (const CapturedEntity& entity : frame.entities) {
+            buffer_.push_back(u8(entity.change));
+            WriteVarint_(entity.id);
+            if (HasEntityState(entity.change)) {
+                u8 entityFlags = 0;
+                if (entity.staticEntity) entityFlags |= ENTITY_STATIC;
+                if (entity.lightInteracting) entityFlags |= ENTITY_LIGHT_INTERACTING;
+                if (entity.modelOptimizeGraph) entityFlags |= ENTITY_MODEL_OPTIMIZE_GRAPH;
+                buffer_.push_back(entityFlags);
+                WriteVarint_(entity.meshes.size());
+                for (const CapturedMesh& mesh : entity.meshes) {
+                    WriteVec_(&mesh.boundsMin[0], 3);
+                    WriteVec_(&mesh.boundsMax[0], 3);
+                    WriteString_(mesh.material);
+                }
+                WriteString_(entity.model);
+                if (entity.model.size() > 0) {
+                    WriteVarint_(entity.modelCullMode);
+                    WriteVarint_(entity.modelNode);
+                }
+            }
+            if (HasEntityTransform(entity.change)) {
+                WriteVec_(&entity.transform[0][0], 16);
+            }
+        }
+
+        Emit_();
+        ++framesWritten_;
+    }
+
+    void FrameCaptureWriter::Flush() {
+        std::fflush(file_);
+    }
+
+    void FrameCaptureWriter::WriteVarint_(u64 value) {
+        while (value >= 0x80) {
+            buffer_.push_back(u8(value | 0x80));
+            value >>= 7;
+        }
+        buffer_.push_back(u8(value));
+    }
+
+    void FrameCaptureWriter::WriteFloat_(const f32 value) {
+        u32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 4; ++i) buffer_.push_back(u8(bits >> (i * 8)));
+    }
+
+    void FrameCaptureWriter::WriteDouble_(const f64 value) {
+        u64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; ++i) buffer_.push_back(u8(bits >> (i * 8)));
+    }
+
+    void FrameCaptureWriter::WriteVec_(const f32 * values, const usize count) {
+        for (usize i = 0; i < count; ++i) WriteFloat_(values[i]);
+    }
+
+    void FrameCaptureWriter::WriteString_(const std::string& value) {
+        WriteVarint_(value.size());
+        buffer_.insert(buffer_.end(), value.begin(), value.end());
+    }
+
+    void FrameCaptureWriter::WriteSettings_(const CapturedSettings& settings) {
+        WriteVarint_(PackSettingsFlags(settings));
+        WriteVarint_(u64(u32(settings.cascadeResolution)));
+        WriteVarint_(settings.perFrameMaxScratchMemoryBytes);
+        WriteVec_(&settings.fogColor[0], 3);
+        WriteFloat_(settings.fogDensity);
+        WriteFloat_(settings.emissionStrength);
+        WriteVec_(&settings.skyboxColorMask[0], 3);
+        WriteFloat_(settings.skyboxIntensity);
+        WriteFloat_(settings.minRoughness);
+        WriteFloat_(settings.alphaDepthTestThreshold);
+        WriteFloat_(settings.emissiveTextureMultiplier);
+        WriteFloat_(settings.minGiOcclusionFactor);
+    }
+
+    void FrameCaptureWriter::Emit_() {
+        if (std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+            throw std::runtime_error("Unable to write frame capture");
+        }
+        bytesWritten_ += buffer_.size();
+        buffer_.clear();
+    }
+
+    FrameCaptureReader::FrameCaptureReader(const std::string& filename)
+        : file_(std::fopen(filename.c_str(), "rb")) {
+        if (file_ == nullptr) throw std::runtime_error("Unable to open frame capture file " + filename);
+
+        std::fseek(file_, 0, SEEK_END);
+        fileBytes_ = u64(std::max<long>(std::ftell(file_), 0));
+        std::fseek(file_, 0, SEEK_SET);
+
+        char magic[sizeof(captureMagic)];
+        if (std::fread(magic, 1, sizeof(magic), file_) != sizeof(magic) || std::memcmp(magic, captureMagic, sizeof(magic)) != 0) {
+            std::fclose(file_);
+            throw std::runtime_error(filename + " is not a frame capture");
+        }
+
+        u64 version = 0;
+        try {
+            version = ReadVarint_();
+        }
+        catch (const std::runtime_error&) {
+        }
+        if (version != FrameCaptureWriter::Version) {
+            std::fclose(file_);
+            throw std::runtime_error(filename + " has unsupported frame capture version " + std::to_string(version));
+        }
+    }
+
+    FrameCaptureReader::~FrameCaptureReader() {
+        std::fclose(file_);
+    }
+
+    bool FrameCaptureReader::Next(CapturedFrame& frame) {
+        const int c = std::fgetc(file_);
+        if (c == EOF) return false;
+        std::ungetc(c, file_);
+
+        frame.frame = ReadVarint_();
+        frame.deltaSeconds = ReadDouble_();
+        frame.viewportWidth = u32(ReadVarint_());
+        frame.viewportHeight = u32(ReadVarint_());
+        const u8 flags = ReadByte_();
+        frame.hasCamera = (flags & FRAME_HAS_CAMERA) != 0;
+        if (frame.hasCamera) {
+            ReadVec_(&frame.cameraPosition[0], 3);
+            frame.cameraPitch = ReadFloat_();
+            frame.cameraYaw = ReadFloat_();
+        }
+        else {
+            frame.cameraPosition = glm::vec3(0.0f);
+            frame.cameraPitch = 0.0f;
+            frame.cameraYaw = 0.0f;
+        }
+        frame.fovy = ReadFloat_();
+        frame.znear = ReadFloat_();
+        frame.zfar = ReadFloat_();
+        ReadVec_(&frame.clearColor[0], 4);
+        if (flags & FRAME_HAS_SETTINGS) ReadSettings_(lastSettings_);
+        frame.settings = lastSettings_;
+
+        frame.lights.resize(ReadCount_(minLightBytes));
+        for (CapturedLight& light : frame.lights) {
+            light = CapturedLight();
+            light.change = CaptureChange(ReadByte_());
+            if (light.change > CaptureChange::MOVED) throw std::runtime_error("Frame capture is corrupt");
+            light.id = ReadVarint_();
+            if (!HasLightState(light.change)) continue;
+
+            const u8 lightFlags = ReadByte_();
+            light.castsShadows = (lightFlags & LIGHT_CASTS_SHADOWS) != 0;
+            light.virtualLight = (lightFlags & LIGHT_VIRTUAL) != 0;
+            light.staticLight = (lightFlags & LIGHT_STATIC) != 0;
+            ReadVec_(&light.position[0], 3);
+            ReadVec_(&light.color[0], 3);
+            light.intensity = ReadFloat_();
+        }
+
+        frame.entities.resize(ReadCount_(minEntityBytes));
+        for (CapturedEntity& entity : frame.entities) {
+            entity = CapturedEntity();
+            entity.change = CaptureChange(ReadByte_());
+            if (entity.change > CaptureChange::MOVED) throw std::runtime_error("Frame capture is corrupt");
+            entity.id = ReadVarint_();
+            if (HasEntityState(entity.change)) {
+                const u8 entityFlags = ReadByte_();
+                entity.staticEntity = (entityFlags & ENTITY_STATIC) != 0;
+                entity.lightInteracting = (entityFlags & ENTITY_LIGHT_INTERACTING) != 0;
+                entity.modelOptimizeGraph = (entityFlags & ENTITY_MODEL_OPTIMIZE_GRAPH) != 0;
+                entity.meshes.resize(ReadCount_(minMeshBytes));
+                for (CapturedMesh& mesh : entity.meshes) {
+                    ReadVec_(&mesh.boundsMin[0], 3);
+                    ReadVec_(&mesh.boundsMax[0], 3);
+                    mesh.material = ReadString_();
+                }
+                entity.model = ReadString_();
+                if (entity.model.size() > 0) {
+                    entity.modelCullMode = u32(ReadVarint_());
+                    entity.modelNode = u32(ReadVarint_());
+                }
+            }
+            if (HasEntityTransform(entity.change)) {
+                ReadVec_(&entity.transform[0][0], 16);
+            }
+        }
+
+        ++framesRead_;
+        return true;
+    }
+
+    u8 FrameCaptureReader::ReadByte_() {
+        const int c = std::fgetc(file_);
+        if (c == EOF) throw std::runtime_error("Frame capture ends part way through a frame");
+        return u8(c);
+    }
+
+    u64 FrameCaptureReader::ReadVarint_() {
+        u64 value = 0;
+        for (u32 shift = 0; shift < 64; shift += 7) {
+            const u8 byte = ReadByte_();
+            value |= u64(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        throw std::runtime_error("Frame capture is corrupt");
+    }
+
+    usize FrameCaptureReader::ReadCount_(const usize minBytesPerItem) {
+        const u64 count = ReadVarint_();
+        // Anything claiming more items than the rest of the file could hold is corrupt - checking
+        // here keeps a bad count from turning into a huge allocation
+        const long offset = std::ftell(file_);
+        const u64 remaining = offset < 0 || u64(offset) > fileBytes_ ? 0 : fileBytes_ - u64(offset);
+        if (count > remaining / minBytesPerItem) throw std::runtime_error("Frame capture is corrupt");
+        return usize(count);
+    }
+
+    f32 FrameCaptureReader::ReadFloat_() {
+        u32 bits = 0;
+        for (int i = 0; i < 4; ++i) bits |= u32(ReadByte_()) << (i * 8);
+        f32 value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    f64 FrameCaptureReader::ReadDouble_() {
+        u64 bits = 0;
+        for (int i = 0; i < 8; ++i) bits |= u64(ReadByte_()) << (i * 8);
+        f64 value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    void FrameCaptureReader::ReadVec_(f32 * values, const usize count) {
+        for (usize i = 0; i < count; ++i) values[i] = ReadFloat_();
+    }
+
+    std::string FrameCaptureReader::ReadString_() {
+        std::string value(ReadCount_(1), '\0');
+        for (char& c : value) c = char(ReadByte_());
+        return value;
+    }
+
+    void FrameCaptureReader::ReadSettings_(CapturedSettings& settings) {
+        UnpackSettingsFlags(ReadVarint_(), settings);
+        settings.cascadeResolution = i32(u32(ReadVarint_()));
+        settings.perFrameMaxScratchMemoryBytes = ReadVarint_();
+        ReadVec_(&settings.fogColor[0], 3);
+        settings.fogDensity = ReadFloat_();
+        settings.emissionStrength = ReadFloat_();
+        ReadVec_(&settings.skyboxColorMask[0], 3);
+        settings.skyboxIntensity = ReadFloat_();
+        settings.minRoughness = ReadFloat_();
+        settings.alphaDepthTestThreshold = ReadFloat_();
+        settings.emissiveTextureMultiplier = ReadFloat_();
+        settings.minGiOcclusionFactor = ReadFloat_();
+    }
+
+    FrameCapture& FrameCapture::Instance() {
+        static FrameCapture * instance = new FrameCapture();
+        return *instance;
+    }
+
+    void FrameCapture::Start(const std::string& filename) {
+        auto ul = std::unique_lock<std::mutex>(mutex_);
+        // Open the new file first so that a bad path leaves the current capture running
+        auto writer = std::make_unique<FrameCaptureWriter>(filename);
+        writer_ = std::move(writer);
+        ids_.clear();
+        lights_.clear();
+        nextId_ = 1;
+        session_.fetch_add(1);
+        capturing_.store(true);
+    }
+
+    void FrameCapture::Stop() {
+        auto ul = std::unique_lock<std::mutex>(mutex_);
+        capturing_.store(false);
+        writer_.reset();
+        ids_.clear();
+        lights_.clear();
+    }
+
+    u64 FrameCapture::FramesCaptured() const {
+        auto ul = std::unique_lock<std::mutex>(mutex_);
+        return writer_ != nullptr ? writer_->FramesWritten() : 0;
+    }
+
+    u64 FrameCapture::IdFor(const void * object) {
+        auto ul = std::unique_lock<std::mutex>(mutex_);
+        auto it = ids_.find(object);
+        if (it != ids_.end()) return it->second;
+        const u64 id = nextId_++;
+        ids_.insert(std::make_pair(object, id));
+        return id;
+    }
+
+    void FrameCapture::Forget(const void * object) {
+        auto ul = std::unique_lock<std::mutex>(mutex_);
+        auto it = ids_.find(object);
+        if (it == ids_.end()) return;
+        lights_.erase(it->second);
+        ids_.erase(it);
+    }
+
+    bool FrameCapture::LightChanged(const CapturedLight& light) {
+        auto ul = std::unique_lock<std::mutex>(mutex_);
+        auto it = lights_.find(light.id);
+        if (it != lights_.end() &&
+            it->second.position == light.position &&
+            it->second.color == light.color &&
+            it->second.intensity == light.intensity &&
+            it->second.castsShadows == light.castsShadows) {
+            return false;
+        }
+        lights_[light.id] = light;
+        return true;
+    }
+
+    void FrameCapture::Write(const CapturedFrame& frame) {
+        auto ul = std::unique_lock<std::mutex>(mutex_);
+        if (writer_ == nullptr) return;
+        try {
+            writer_->Write(frame);
+        }
+        catch (const std::runtime_error& e) {
+            STRATUS_ERROR << e.what() << " - stopping frame capture" << std::endl;
+            capturing_.store(false);
+            writer_.reset();
+        }
+    }
+}
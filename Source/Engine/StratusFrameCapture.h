@@ -0,0 +1,230 @@
+#pragma once
+
+#include "StratusTypes.h"
+#include "glm/glm.hpp"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace stratus {
+    enum class CaptureChange : u8 {
+        ADDED,
+        REMOVED,
+        // Entities: components were added, enabled or disabled. Lights: position, color or intensity changed.
+        CHANGED,
+        // Lights only - removes every light
+        CLEARED,
+        // Entities only - a dynamic entity's transform changed
+        MOVED
+    };
+
+    struct CapturedLight {
+        u64 id = 0;
+        CaptureChange change = CaptureChange::ADDED;
+        // Everything below is only set for ADDED and CHANGED
+        glm::vec3 position = glm::vec3(0.0f);
+        // Color before intensity is applied
+        glm::vec3 color = glm::vec3(1.0f);
+        f32 intensity = 1.0f;
+        bool castsShadows = true;
+        bool virtualLight = false;
+        bool staticLight = false;
+    };
+
+    struct CapturedMesh {
+        // In the entity's space. Lets a replay without the model stand in a box of the same size.
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+        // Name the material is registered under with MaterialManager
+        std::string material;
+    };
+
+    // Entities refer to the model file their meshes were loaded from (see MeshSource) instead of
+    // carrying the mesh data, so replays load the same meshes and materials the capture saw
+    struct CapturedEntity {
+        u64 id = 0;
+        CaptureChange change = CaptureChange::ADDED;
+        // Everything below is only set for ADDED, CHANGED and MOVED
+        glm::mat4 transform = glm::mat4(1.0f);
+        // Everything below is only set for ADDED and CHANGED
+        // Empty for entities the renderer ignores
+        std::vector<CapturedMesh> meshes;
+        // Empty if the meshes were not loaded from a model
+        std::string model;
+        bool modelOptimizeGraph = false;
+        // RenderFaceCulling the model was loaded with
+        u32 modelCullMode = 0;
+        u32 modelNode = 0;
+        bool staticEntity = false;
+        bool lightInteracting = false;
+    };
+
+    // Mirrors RendererSettings minus the skybox texture
+    struct CapturedSettings {
+        bool vsyncEnabled = false;
+        bool globalIlluminationEnabled = true;
+        bool fxaaEnabled = true;
+        bool taaEnabled = true;
+        bool bloomEnabled = true;
+        bool usePerceptualRoughness = true;
+        bool cpuVplCullingEnabled = false;
+        bool cascadeCachingEnabled = true;
+        bool pointShadowFaceCullingEnabled = true;
+        bool shaderHotReloadEnabled = false;
+        i32 cascadeResolution = 0;
+        u64 perFrameMaxScratchMemoryBytes = 0;
+        glm::vec3 fogColor = glm::vec3(0.5f);
+        f32 fogDensity = 0.0f;
+        f32 emissionStrength = 0.0f;
+        glm::vec3 skyboxColorMask = glm::vec3(1.0f);
+        f32 skyboxIntensity = 3.0f;
+        f32 minRoughness = 0.08f;
+        f32 alphaDepthTestThreshold = 0.5f;
+        f32 emissiveTextureMultiplier = 1.0f;
+        f32 minGiOcclusionFactor = 0.95f;
+
+        bool operator==(const CapturedSettings& other) const;
+        bool operator!=(const CapturedSettings& other) const { return !(*this == other); }
+    };
+
+    // Everything RendererFrontend::Extract_ consumed for one frame
+    struct CapturedFrame {
+        // Engine frame count
+        u64 frame = 0;
+        f64 deltaSeconds = 0.0;
+        u32 viewportWidth = 0;
+        u32 viewportHeight = 0;
+        // False when no camera was set (the frame was not rendered)
+        bool hasCamera = false;
+        glm::vec3 cameraPosition = glm::vec3(0.0f);
+        // Degrees
+        f32 cameraPitch = 0.0f;
+        f32 cameraYaw = 0.0f;
+        f32 fovy = 90.0f;
+        f32 znear = 1.0f;
+        f32 zfar = 1000.0f;
+        glm::vec4 clearColor = glm::vec4(0.0f);
+        CapturedSettings settings;
+        // In the order they were applied
+        std::vector<CapturedLight> lights;
+        std::vector<CapturedEntity> entities;
+    };
+
+    // Binary format: a "SFCP" magic and a version, then one record per frame. Integers are
+    // varints and floats are raw little endian IEEE. Settings are only written when they differ
+    // from the previous frame's.
+    class FrameCaptureWriter {
+    public:
+        static constexpr u32 Version = 2;
+
+        // Throws std::runtime_error if the file can't be opened
+        FrameCaptureWriter(const std::string& filename);
+        ~FrameCaptureWriter();
+
+        FrameCaptureWriter(const FrameCaptureWriter&) = delete;
+        FrameCaptureWriter& operator=(const FrameCaptureWriter&) = delete;
+
+        void Write(const CapturedFrame&);
+        void Flush();
+
+        u64 FramesWritten() const { return framesWritten_; }
+        u64 BytesWritten() const { return bytesWritten_; }
+
+    private:
+        void WriteVarint_(u64);
+        void WriteFloat_(const f32);
+        void WriteDouble_(const f64);
+        void WriteVec_(const f32 *, const usize);
+        void WriteString_(const std::string&);
+        void WriteSettings_(const CapturedSettings&);
+        void Emit_();
+
+    private:
+        FILE * file_;
+        // Encoded frame waiting to be written
+        std::vector<u8> buffer_;
+        CapturedSettings lastSettings_;
+        bool firstFrame_ = true;
+        u64 framesWritten_ = 0;
+        u64 bytesWritten_ = 0;
+    };
+
+    class FrameCaptureReader {
+    public:
+        // Throws std::runtime_error if the file can't be opened or is not a capture
+        FrameCaptureReader(const std::string& filename);
+        ~FrameCaptureReader();
+
+        FrameCaptureReader(const FrameCaptureReader&) = delete;
+        FrameCaptureReader& operator=(const FrameCaptureReader&) = delete;
+
+        // Returns false once every frame has been read. Throws std::runtime_error if the file ends
+        // part way through a frame.
+        bool Next(CapturedFrame&);
+
+        u64 FramesRead() const { return framesRead_; }
+
+    private:
+        u8 ReadByte_();
+        u64 ReadVarint_();
+        // Reads a record count and throws std::runtime_error if the rest of the file is too small for it
+        usize ReadCount_(const usize minBytesPerItem);
+        f32 ReadFloat_();
+        f64 ReadDouble_();
+        void ReadVec_(f32 *, const usize);
+        std::string ReadString_();
+        void ReadSettings_(CapturedSettings&);
+
+    private:
+        FILE * file_;
+        u64 fileBytes_ = 0;
+        CapturedSettings lastSettings_;
+        u64 framesRead_ = 0;
+    };
+
+    // Records what the renderer frontend was given each frame so that a slow frame can be replayed
+    // offline (see the --replay mode of the benchmark). Never deleted so that it can be started
+    // before the engine and stopped after it.
+    //
+    // The frontend refers to lights and entities by pointer. The capture hands out ids for them
+    // which stay the same until they are removed.
+    class FrameCapture {
+        FrameCapture() = default;
+
+    public:
+        static FrameCapture& Instance();
+
+        // Throws std::runtime_error if the file can't be opened. Stops the current capture first.
+        void Start(const std::string& filename);
+        // Flushes and closes the file
+        void Stop();
+        bool IsCapturing() const { return capturing_.load(std::memory_order_relaxed); }
+        // Changes every time a capture starts. Whatever already existed at that point has to be
+        // written out as ADDED since the new file knows nothing about it.
+        u64 Session() const { return session_.load(std::memory_order_relaxed); }
+        u64 FramesCaptured() const;
+
+        // Everything below is meant to be called by the frontend while capturing
+
+        u64 IdFor(const void * object);
+        // Called once the object has been removed so that the memory can be reused
+        void Forget(const void * object);
+        // Returns true if the light is new or different from what was last recorded for it
+        bool LightChanged(const CapturedLight&);
+        // Stops the capture if the file can't be written to
+        void Write(const CapturedFrame&);
+
+    private:
+        std::atomic<bool> capturing_{false};
+        std::atomic<u64> session_{0};
+        mutable std::mutex mutex_;
+        std::unique_ptr<FrameCaptureWriter> writer_;
+        std::unordered_map<const void *, u64> ids_;
+        std::unordered_map<u64, CapturedLight> lights_;
+        u64 nextId_ = 1;
+    };
+}
@@ -0,0 +1,152 @@
+#include "StratusFramePacer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace stratus {
+    // Sleeps are done in steps this long so that a late wakeup costs at most one step
+    static constexpr f64 sleepStepSeconds = 0.001;
+    // Weight of the newest frame in the work estimate
+    static constexpr f64 workSmoothing = 0.1;
+    // Standard deviations added to the work and sleep estimates so that a slightly slow frame
+    // or sleep still lands before the deadline
+    static constexpr f64 marginStdDevs = 2.0;
+
+    f64 SystemFramePacerClock::Now() {
+        return std::chrono::duration<f64>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void SystemFramePacerClock::Sleep(const f64 seconds) {
+        std::this_thread::sleep_for(std::chrono::duration<f64>(seconds));
+    }
+
+    void SystemFramePacerClock::Spin() {
+        std::this_thread::yield();
+    }
+
+    FramePacer::FramePacer(const f64 targetFrameSeconds, std::unique_ptr<FramePacerClock> clock)
+        : clock_(std::move(clock)) {
+        if (clock_ == nullptr) clock_ = std::make_unique<SystemFramePacerClock>();
+        SetTargetFrameSeconds(targetFrameSeconds);
+    }
+
+    void FramePacer::SetTargetFrameSeconds(const f64 seconds) {
+        targetSeconds_ = std::max(seconds, 0.0);
+    }
+
+    void FramePacer::SetTargetFrameRate(const u32 framesPerSecond) {
+        SetTargetFrameSeconds(framesPerSecond == 0 ? 0.0 : 1.0 / f64(framesPerSecond));
+    }
+
+    f64 FramePacer::WaitForNextFrame() {
+        const f64 now = clock_->Now();
+        if (!started_) {
+            started_ = true;
+            slotStart_ = now;
+            frameStart_ = now;
+            return now;
+        }
+
+        RecordWork_(now - frameStart_);
+
+        f64 start = now;
+        stats_.lastSleepMs = 0.0;
+        stats_.lastSpinMs = 0.0;
+        if (targetSeconds_ > 0.0) {
+            f64 nextSlot = slotStart_ + targetSeconds_;
+            // More than a whole frame behind - start over from here rather than rushing
+            if (now - nextSlot >= targetSeconds_) {
+                ++stats_.missedFrames;
+                nextSlot = now;
+            }
+            slotStart_ = nextSlot;
+
+            f64 wakeUp = nextSlot;
+            if (adaptive_) {
+                const f64 predicted = stats_.predictedWorkMs / 1000.0;
+                wakeUp = std::max(nextSlot, nextSlot + targetSeconds_ - predicted);
+            }
+
+            Wait_(wakeUp);
+            start = clock_->Now();
+        }
+        else {
+            slotStart_ = now;
+        }
+
+        stats_.lastWaitMs = (start - now) * 1000.0;
+        RecordFrame_(start - frameStart_);
+        frameStart_ = start;
+        return start;
+    }
+
+    void FramePacer::ResetStats() {
+        stats_ = FramePacerStats();
+        frameM2_ = 0.0;
+    }
+
+    void FramePacer::Wait_(const f64 until) {
+        while (true) {
+            const f64 now = clock_->Now();
+            const f64 remaining = until - now;
+            if (remaining <= 0.0) break;
+
+            // Until there are samples assume a sleep can overshoot by a whole step
+            const f64 overshoot = sleepSamples_ < 2 ? sleepStepSeconds :
+                sleepOvershootMean_ + marginStdDevs * std::sqrt(sleepOvershootM2_ / f64(sleepSamples_ - 1));
+
+            if (remaining > sleepStepSeconds + overshoot) {
+                clock_->Sleep(sleepStepSeconds);
+                const f64 slept = clock_->Now() - now;
+                stats_.lastSleepMs += slept * 1000.0;
+
+                const f64 sample = std::max(slept - sleepStepSeconds, 0.0);
+                ++sleepSamples_;
+                const f64 delta = sample - sleepOvershootMean_;
+                sleepOvershootMean_ += delta / f64(sleepSamples_);
+                sleepOvershootM2_ += delta * (sample - sleepOvershootMean_);
+            }
+            else {
+                clock_->Spin();
+                stats_.lastSpinMs += (clock_->Now() - now) * 1000.0;
+            }
+        }
+    }
+
+    void FramePacer::RecordWork_(const f64 seconds) {
+        if (stats_.frames == 0) {
+            workMean_ = seconds;
+            workVariance_ = 0.0;
+        }
+        else {
+            const f64 delta = seconds - workMean_;
+            workMean_ += workSmoothing * delta;
+            workVariance_ = (1.0 - workSmoothing) * (workVariance_ + workSmoothing * delta * delta);
+        }
+
+        stats_.lastWorkMs = seconds * 1000.0;
+        stats_.predictedWorkMs = (workMean_ + marginStdDevs * std::sqrt(workVariance_)) * 1000.0;
+    }
+
+    void FramePacer::RecordFrame_(const f64 seconds) {
+        const f64 ms = seconds * 1000.0;
+        ++stats_.frames;
+        stats_.lastFrameMs = ms;
+
+        if (stats_.frames == 1) {
+            stats_.minFrameMs = ms;
+            stats_.maxFrameMs = ms;
+        }
+        else {
+            stats_.minFrameMs = std::min(stats_.minFrameMs, ms);
+            stats_.maxFrameMs = std::max(stats_.maxFrameMs, ms);
+        }
+
+        const f64 delta = ms - stats_.meanFrameMs;
+        stats_.meanFrameMs += delta / f64(stats_.frames);
+        frameM2_ += delta * (ms - stats_.meanFrameMs);
+        stats_.frameTimeVarianceMs2 = stats_.frames > 1 ? frameM2_ / f64(stats_.frames - 1) : 0.0;
+        stats_.frameTimeStdDevMs = std::sqrt(stats_.frameTimeVarianceMs2);
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "StratusTypes.h"
+#include <memory>
+
+namespace stratus {
+    // Time source for FramePacer. Tests swap in a fake clock so that pacing can be checked
+    // without actually sleeping.
+    struct FramePacerClock {
+        virtual ~FramePacerClock() = default;
+
+        // Monotonic time in seconds
+        virtual f64 Now() = 0;
+        // May wake up later than requested (never earlier)
+        virtual void Sleep(const f64 seconds) = 0;
+        // Called between polls of Now() once the pacer is close enough to spin
+        virtual void Spin() = 0;
+    };
+
+    // Uses std::chrono::steady_clock and std::this_thread
+    struct SystemFramePacerClock : public FramePacerClock {
+        virtual ~SystemFramePacerClock() = default;
+
+        f64 Now() override;
+        void Sleep(const f64 seconds) override;
+        void Spin() override;
+    };
+
+    struct FramePacerStats {
+        u64 frames = 0;
+        // Time between the start of one frame and the start of the next
+        f64 lastFrameMs = 0.0;
+        f64 meanFrameMs = 0.0;
+        f64 minFrameMs = 0.0;
+        f64 maxFrameMs = 0.0;
+        f64 frameTimeVarianceMs2 = 0.0;
+        f64 frameTimeStdDevMs = 0.0;
+        // Time spent doing work (start of a frame until the pacer is asked to wait again)
+        f64 lastWorkMs = 0.0;
+        // Estimate of the next frame's work including a safety margin (see FramePacer::SetAdaptive)
+        f64 predictedWorkMs = 0.0;
+        // Time spent waiting before the last frame, split into sleeping and spinning
+        f64 lastWaitMs = 0.0;
+        f64 lastSleepMs = 0.0;
+        f64 lastSpinMs = 0.0;
+        // Frames which started more than a full frame late. The schedule is reset instead
+        // of trying to catch up with a burst of short frames.
+        u64 missedFrames = 0;
+    };
+
+    // Frame rate limiter which blocks until the next frame is due rather than having the caller
+    // poll. It sleeps in small steps while the deadline is further away than a sleep usually
+    // overshoots by and spins for the rest, so the deadline is hit closely without keeping a core busy.
+    //
+    // Frames are scheduled on a fixed grid (start of frame n = first start + n * target) so that
+    // slightly late frames don't push every later frame back.
+    class FramePacer {
+    public:
+        // A target of 0 disables limiting but still collects stats. A null clock uses SystemFramePacerClock.
+        FramePacer(const f64 targetFrameSeconds = 0.0, std::unique_ptr<FramePacerClock> clock = nullptr);
+
+        FramePacer(const FramePacer&) = delete;
+        FramePacer& operator=(const FramePacer&) = delete;
+
+        void SetTargetFrameSeconds(const f64 seconds);
+        void SetTargetFrameRate(const u32 framesPerSecond);
+        f64 GetTargetFrameSeconds() const { return targetSeconds_; }
+
+        // Instead of starting each frame on the grid, starts it late enough that the predicted work
+        // finishes right at the end of its slot. Frames still never start earlier than they would
+        // otherwise, but input is sampled closer to when the frame is presented.
+        void SetAdaptive(const bool adaptive) { adaptive_ = adaptive; }
+        bool IsAdaptive() const { return adaptive_; }
+
+        // Blocks until the next frame should start and returns the time it started at (in the
+        // clock's time). Everything between two calls counts as that frame's work.
+        f64 WaitForNextFrame();
+
+        const FramePacerStats& Stats() const { return stats_; }
+        void ResetStats();
+
+    private:
+        void Wait_(const f64 until);
+        void RecordWork_(const f64 seconds);
+        void RecordFrame_(const f64 seconds);
+
+    private:
+        std::unique_ptr<FramePacerClock> clock_;
+        f64 targetSeconds_ = 0.0;
+        bool adaptive_ = false;
+        bool started_ = false;
+        // Grid slot the last frame was scheduled in
+        f64 slotStart_ = 0.0;
+        f64 frameStart_ = 0.0;
+        // Running estimate of how long a sleep overshoots by (Welford mean/variance)
+        f64 sleepOvershootMean_ = 0.0;
+        f64 sleepOvershootM2_ = 0.0;
+        u64 sleepSamples_ = 0;
+        // Exponential moving average of frame work and its variance
+        f64 workMean_ = 0.0;
+        f64 workVariance_ = 0.0;
+        // Welford accumulator for frame time variance
+        f64 frameM2_ = 0.0;
+        FramePacerStats stats_;
+    };
+}
@@ -0,0 +1,84 @@
+#include "StratusFramePipeline.h"
+#include "StratusProfiler.h"
+#include <chrono>
+
+namespace stratus {
+    static f64 ElapsedMs(const std::chrono::high_resolution_clock::time_point& start, const std::chrono::high_resolution_clock::time_point& end) {
+        return std::chrono::duration<f64, std::milli>(end - start).count();
+    }
+
+    FramePipeline::FramePipeline(const bool pipelined) {
+        if (!pipelined) return;
+
+        // Manual dispatch so that anything else queued to this thread (Async callbacks registered
+        // during simulate, for example) only runs alongside the next simulate and never during extract
+        simulation_ = std::unique_ptr<Thread>(new Thread("Simulation", true, ThreadDispatchMode::MANUAL));
+        simulation_->Queue([this]() {
+            simulationThreadId_ = std::this_thread::get_id();
+        });
+        simulation_->DispatchAndSynchronize();
+    }
+
+    FramePipeline::~FramePipeline() {
+        if (simulation_ != nullptr) simulation_->Synchronize();
+    }
+
+    bool FramePipeline::IsSimulationThread() const {
+        return simulation_ != nullptr && std::this_thread::get_id() == simulationThreadId_;
+    }
+
+    SystemStatus FramePipeline::RunFrame(const Step& extract, const SimulationStep& simulate, const Step& render) {
+        typedef std::chrono::high_resolution_clock Clock;
+        SystemStatus status = SystemStatus::SYSTEM_CONTINUE;
+        ++stats_.frames;
+
+        if (!IsPipelined()) {
+            const auto start = Clock::now();
+            status = simulate();
+            const auto simulated = Clock::now();
+            extract();
+            const auto extracted = Clock::now();
+            render();
+            const auto rendered = Clock::now();
+
+            stats_.simulateMs = ElapsedMs(start, simulated);
+            stats_.extractMs = ElapsedMs(simulated, extracted);
+            stats_.renderMs = ElapsedMs(extracted, rendered);
+            stats_.waitMs = 0.0;
+            return status;
+        }
+
+        const auto start = Clock::now();
+        {
+            STRATUS_PROFILE_SCOPE("FramePipeline::Extract");
+            extract();
+        }
+        const auto extracted = Clock::now();
+
+        // Written by the simulation thread, read here only after Synchronize
+        Clock::time_point simulated;
+        simulation_->Queue([&status, &simulate, &simulated]() {
+            status = simulate();
+            simulated = Clock::now();
+        });
+        simulation_->Dispatch();
+
+        {
+            STRATUS_PROFILE_SCOPE("FramePipeline::Render");
+            render();
+        }
+        const auto rendered = Clock::now();
+
+        {
+            STRATUS_PROFILE_SCOPE("FramePipeline::Wait");
+            simulation_->Synchronize();
+        }
+        const auto joined = Clock::now();
+
+        stats_.extractMs = ElapsedMs(start, extracted);
+        stats_.simulateMs = ElapsedMs(extracted, simulated);
+        stats_.renderMs = ElapsedMs(extracted, rendered);
+        stats_.waitMs = ElapsedMs(rendered, joined);
+        return status;
+    }
+}
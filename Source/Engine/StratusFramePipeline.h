@@ -0,0 +1,63 @@
+#pragma once
+
+#include "StratusSystemStatus.h"
+#include "StratusThread.h"
+#include "StratusTypes.h"
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace stratus {
+    struct FramePipelineStats {
+        u64 frames = 0;
+        // Milliseconds each step took during the last frame
+        f64 extractMs = 0.0;
+        f64 simulateMs = 0.0;
+        f64 renderMs = 0.0;
+        // Time the calling thread sat idle after rendering while simulation finished. Zero when
+        // not pipelined.
+        f64 waitMs = 0.0;
+    };
+
+    // Runs one frame as three steps:
+    //
+    //   extract  - copies simulation state into the renderer's frame
+    //   simulate - input, entities and the application
+    //   render   - submits the extracted frame to the GPU
+    //
+    // Without pipelining all three run on the calling thread one after the other. When pipelined,
+    // extract runs first on the calling thread and then simulate runs on a private thread while the
+    // calling thread (which owns the GL context) renders. The frame being rendered is always the one
+    // extracted before the simulation started, so rendering lags simulation by one frame but the
+    // frame costs max(simulate, render) instead of their sum.
+    //
+    // Extract never overlaps simulate or render, which is what makes it safe to read simulation
+    // state from there without locks.
+    class FramePipeline {
+    public:
+        typedef std::function<void (void)> Step;
+        typedef std::function<SystemStatus (void)> SimulationStep;
+
+        FramePipeline(const bool pipelined);
+        ~FramePipeline();
+
+        FramePipeline(const FramePipeline&) = delete;
+        FramePipeline& operator=(const FramePipeline&) = delete;
+
+        bool IsPipelined() const { return simulation_ != nullptr; }
+        // True if the calling code is running as part of simulate on the private thread
+        bool IsSimulationThread() const;
+
+        // Returns the status simulate returned
+        SystemStatus RunFrame(const Step& extract, const SimulationStep& simulate, const Step& render);
+
+        // Only valid from the thread which calls RunFrame
+        const FramePipelineStats& Stats() const { return stats_; }
+
+    private:
+        // Null unless pipelined
+        std::unique_ptr<Thread> simulation_;
+        std::thread::id simulationThreadId_;
+        FramePipelineStats stats_;
+    };
+}
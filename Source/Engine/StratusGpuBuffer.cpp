@@ -4,6 +4,7 @@
 #include <algorithm>
 #include "StratusApplicationThread.h"
 #include "StratusLog.h"
+#include "StratusProfiler.h"
 
 namespace stratus {
     typedef std::function<void(void)> GpuBufferCommand;
@@ -36,6 +37,8 @@ namespace stratus {
         case GpuBindingPoint::UNIFORM_BUFFER: return GL_UNIFORM_BUFFER;
         case GpuBindingPoint::SHADER_STORAGE_BUFFER: return GL_SHADER_STORAGE_BUFFER;
         case GpuBindingPoint::DRAW_INDIRECT_BUFFER: return GL_DRAW_INDIRECT_BUFFER;
+        case GpuBindingPoint::PIXEL_UNPACK_BUFFER: return GL_PIXEL_UNPACK_BUFFER;
+        case GpuBindingPoint::PIXEL_PACK_BUFFER: return GL_PIXEL_PACK_BUFFER;
         }
 
         throw std::invalid_argument("Unknown buffer type");
@@ -180,6 +183,16 @@ namespace stratus {
         glCopyNamedBufferSubData(buffer._buffer, _buffer, 0, 0, buffer.SizeBytes());
     }
 
+    void CopyDataFromBuffer(const GpuBufferImpl& buffer, intptr_t readOffset, intptr_t writeOffset, uintptr_t size) {
+        if (readOffset + size > buffer.SizeBytes() || writeOffset + size > SizeBytes()) {
+            throw std::runtime_error("offset+size exceeded maximum GPU buffer size");
+        }
+        if (this == &buffer) {
+            throw std::runtime_error("Attempt to copy from buffer to itself");
+        }
+        glCopyNamedBufferSubData(buffer._buffer, _buffer, readOffset, writeOffset, size);
+    }
+
     void CopyDataFromBufferToSysMem(intptr_t offset, uintptr_t size, void * data) {
         if (offset + size > SizeBytes()) {
             throw std::runtime_error("offset+size exceeded maximum GPU buffer size");
@@ -244,6 +257,7 @@ namespace stratus {
 
     void GpuBuffer::CopyDataToBuffer(intptr_t offset, uintptr_t size, const void * data) {
         impl_->CopyDataToBuffer(offset, size, data);
+        STRATUS_PROFILE_COUNTER("BytesUploaded", size);
     }
 
     void GpuBuffer::CopyDataFromBuffer(const GpuBuffer& buffer) {
@@ -253,6 +267,13 @@ namespace stratus {
         impl_->CopyDataFromBuffer(*buffer.impl_);
     }
 
+    void GpuBuffer::CopyDataFromBuffer(const GpuBuffer& source, intptr_t readOffset, intptr_t writeOffset, uintptr_t size) {
+        if (impl_ == nullptr || source.impl_ == nullptr) {
+            throw std::runtime_error("Attempt to use null GpuBuffer");
+        }
+        impl_->CopyDataFromBuffer(*source.impl_, readOffset, writeOffset, size);
+    }
+
     void GpuBuffer::CopyDataFromBufferToSysMem(intptr_t offset, uintptr_t size, void * data) {
         impl_->CopyDataFromBufferToSysMem(offset, size, data);
     }
@@ -548,6 +569,16 @@ namespace stratus {
         indices_.CopyDataToBuffer(byteOffset, data.size() * sizeof(uint32_t), (const void *)data.data());
     }
 
+    void GpuMeshAllocator::CopyVertexData(const GpuBuffer& source, const uintptr_t sourceOffsetBytes, const uint32_t numVertices, const uint32_t offset) {
+        const intptr_t byteOffset = intptr_t(offset) * sizeof(GpuMeshData);
+        vertices_.CopyDataFromBuffer(source, intptr_t(sourceOffsetBytes), byteOffset, uintptr_t(numVertices) * sizeof(GpuMeshData));
+    }
+
+    void GpuMeshAllocator::CopyIndexData(const GpuBuffer& source, const uintptr_t sourceOffsetBytes, const uint32_t numIndices, const uint32_t offset) {
+        const intptr_t byteOffset = intptr_t(offset) * sizeof(uint32_t);
+        indices_.CopyDataFromBuffer(source, intptr_t(sourceOffsetBytes), byteOffset, uintptr_t(numIndices) * sizeof(uint32_t));
+    }
+
     void GpuMeshAllocator::BindBase(const GpuBaseBindingPoint& point, const uint32_t index) {
         vertices_.BindBase(point, index);
     }
@@ -605,4 +636,44 @@ namespace stratus {
         }
         return indices;
     }
-}
\ No newline at end of file
+
+    GpuStagingBuffer::GpuStagingBuffer(const usize sizeBytes)
+        : sizeBytes_(sizeBytes) {
+        const Bitfield flags = GPU_MAP_WRITE | GPU_MAP_PERSISTENT | GPU_MAP_COHERENT;
+        buffer_ = GpuBuffer(nullptr, uintptr_t(sizeBytes), flags);
+        memory_ = (u8 *)buffer_.MapMemory(flags);
+        if (memory_ == nullptr) {
+            throw std::runtime_error("Unable to map staging buffer");
+        }
+    }
+
+    GpuStagingBuffer::~GpuStagingBuffer() {
+        // Deleting the buffer unmaps it, only the fences need cleaning up
+        std::vector<GpuHostFence> fences;
+        for (auto& fence : fences_) fences.push_back(fence.second);
+        const auto deleteFences = [fences]() {
+            for (GpuHostFence fence : fences) HostDeleteFence(fence);
+        };
+
+        if (ApplicationThread::Instance()->CurrentIsApplicationThread()) {
+            deleteFences();
+        }
+        else {
+            ApplicationThread::Instance()->Queue(deleteFences);
+        }
+    }
+
+    void GpuStagingBuffer::InsertFence(const u64 frame) {
+        fences_.push_back(std::make_pair(frame, HostInsertFence()));
+    }
+
+    u64 GpuStagingBuffer::CompletedFrame() {
+        // Fences signal in order so stop at the first one which has not
+        while (fences_.size() > 0 && HostFenceSignalled(fences_.front().second)) {
+            completedFrame_ = fences_.front().first;
+            HostDeleteFence(fences_.front().second);
+            fences_.pop_front();
+        }
+        return completedFrame_;
+    }
+}
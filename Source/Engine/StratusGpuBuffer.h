@@ -11,7 +11,10 @@
 #include "StratusGpuCommon.h"
 #include <unordered_set>
 #include "StratusLog.h"
+#include "StratusGraphicsDriver.h"
+#include "StratusUploadQueue.h"
 #include <list>
+#include <deque>
 
 #define MINIMUM_GPU_BLOCK_SIZE 64
 // 2^30
@@ -28,7 +31,11 @@ namespace stratus {
         // Allows read and write shader buffer access
         SHADER_STORAGE_BUFFER   = BITMASK64_POW2(4),
         // Allows for indirect array and element draw commands
-        DRAW_INDIRECT_BUFFER    = BITMASK64_POW2(5)
+        DRAW_INDIRECT_BUFFER    = BITMASK64_POW2(5),
+        // Texture uploads read from the bound buffer with the data pointer treated as an offset
+        PIXEL_UNPACK_BUFFER     = BITMASK64_POW2(6),
+        // Texture reads write to the bound buffer with the data pointer treated as an offset
+        PIXEL_PACK_BUFFER       = BITMASK64_POW2(7)
     };
 
     // A more restrictive set of bindings good for things like floating point (vertex, normal, etc.)
@@ -96,6 +103,8 @@ namespace stratus {
         // Make sure GPU_DYNAMIC_DATA is set
         void CopyDataToBuffer(intptr_t offset, uintptr_t size, const void * data);
         void CopyDataFromBuffer(const GpuBuffer&);
+        // GPU side copy of size bytes from source
+        void CopyDataFromBuffer(const GpuBuffer& source, intptr_t readOffset, intptr_t writeOffset, uintptr_t size);
         void CopyDataFromBufferToSysMem(intptr_t offset, uintptr_t size, void * data);
 
         // Memory mapping and data copying won't work after this
@@ -392,6 +401,9 @@ namespace stratus {
 
         static void CopyVertexData(const std::vector<GpuMeshData>&, const uint32_t offset);
         static void CopyIndexData(const std::vector<uint32_t>&, const uint32_t offset);
+        // Same as above but the data is already on the GPU (e.g. in staging memory) at sourceOffsetBytes
+        static void CopyVertexData(const GpuBuffer& source, const uintptr_t sourceOffsetBytes, const uint32_t numVertices, const uint32_t offset);
+        static void CopyIndexData(const GpuBuffer& source, const uintptr_t sourceOffsetBytes, const uint32_t numIndices, const uint32_t offset);
 
         // Binds the GpuMesh buffer
         static void BindBase(const GpuBaseBindingPoint&, const uint32_t);
@@ -431,4 +443,30 @@ namespace stratus {
         static std::vector<_MeshData> freeIndices_;
         static bool initialized_;
     };
+
+    // Persistently mapped, coherent staging memory for the UploadQueue. Copies read from it either as the
+    // source buffer (buffer to buffer) or while it is bound as the PIXEL_UNPACK_BUFFER (buffer to texture).
+    // Must be created and destroyed on the application thread.
+    class GpuStagingBuffer final : public UploadTarget {
+    public:
+        GpuStagingBuffer(const usize sizeBytes);
+        ~GpuStagingBuffer();
+
+        u8 * MappedMemory() override { return memory_; }
+        usize SizeBytes() const override { return sizeBytes_; }
+        void InsertFence(const u64 frame) override;
+        u64 CompletedFrame() override;
+
+        const GpuBuffer& GetBuffer() const { return buffer_; }
+
+    private:
+        GpuBuffer buffer_;
+        usize sizeBytes_;
+        u8 * memory_;
+        // Oldest first
+        std::deque<std::pair<u64, GpuHostFence>> fences_;
+        u64 completedFrame_ = 0;
+    };
+
+    typedef std::shared_ptr<GpuStagingBuffer> GpuStagingBufferPtr;
 }
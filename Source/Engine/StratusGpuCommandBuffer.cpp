@@ -1,4 +1,5 @@
 #include "StratusGpuCommandBuffer.h"
+#include "StratusShadowFaceCulling.h"
 
 namespace stratus {
     GpuCommandBuffer::GpuCommandBuffer(const RenderFaceCulling& culling, usize numLods, usize commandBlockSize)
@@ -33,6 +34,14 @@ namespace stratus {
         return drawCommands_[0]->Capacity();
     }
 
+    usize GpuCommandBuffer::NumIndices(const usize lod) const {
+        usize result = 0;
+        for (usize i = 0; i < NumDrawCommands(); ++i) {
+            result += drawCommands_[lod]->GetRead(u32(i)).vertexCount;
+        }
+        return result;
+    }
+
     const RenderFaceCulling& GpuCommandBuffer::GetFaceCulling() const
     {
         return culling_;
@@ -259,6 +268,15 @@ namespace stratus {
         buffer.BindBase(GpuBaseBindingPoint::SHADER_STORAGE_BUFFER, index);
     }
 
+    void GpuCommandBuffer::GetWorldAabbs(std::vector<GpuAABB>& out) const
+    {
+        for (usize i = 0; i < NumDrawCommands(); ++i) {
+            // Free slots and meshes which are still pending have empty draw commands
+            if (drawCommands_[0]->GetRead(u32(i)).vertexCount == 0) continue;
+            out.push_back(PointShadowFaceCulling::TransformAabb(aabbs_->GetRead(u32(i)), modelTransforms_->GetRead(u32(i))));
+        }
+    }
+
     void GpuCommandBuffer::BindIndirectDrawCommands(const usize lod) const
     {
         if (lod >= NumLods() || drawCommands_[lod]->GetBuffer() == GpuBuffer()) {
@@ -38,6 +38,9 @@ namespace stratus {
         usize NumDrawCommands() const;
         usize NumLods() const;
         usize CommandCapacity() const;
+        // Sum of the index counts of the CPU side draw commands for the lod. This is what gets submitted,
+        // GPU culling may draw less.
+        usize NumIndices(const usize lod) const;
         const RenderFaceCulling& GetFaceCulling() const;
 
         void RecordCommand(RenderComponent*, MeshWorldTransforms*, const usize, const usize);
@@ -53,6 +56,10 @@ namespace stratus {
         void BindModelTransformBuffer(u32 index) const;
         void BindAabbBuffer(u32 index) const;
 
+        // Appends the world space bounds of every finalized draw command using the CPU copies
+        // of the aabb and model transform buffers
+        void GetWorldAabbs(std::vector<GpuAABB>& out) const;
+
         void BindIndirectDrawCommands(const usize lod) const;
         void UnbindIndirectDrawCommands(const usize lod) const;
 
@@ -30,6 +30,14 @@
 // It's possible to have metallic + roughness combined into a single map
 #define GPU_METALLIC_ROUGHNESS_MAPPED (BITMASK_POW2(7))
 
+// Matches the definitions in common.glsl. Each map gets 4 bits of GpuMaterial::residentMips.
+#define GPU_DIFFUSE_MIP_SLOT            (0)
+#define GPU_EMISSIVE_MIP_SLOT           (1)
+#define GPU_NORMAL_MIP_SLOT             (2)
+#define GPU_ROUGHNESS_MIP_SLOT          (3)
+#define GPU_METALLIC_MIP_SLOT           (4)
+#define GPU_METALLIC_ROUGHNESS_MIP_SLOT (5)
+
 // Matches the definitions in vpl_common.glsl
 #define MAX_TOTAL_VPLS_BEFORE_CULLING (10000)
 #define MAX_TOTAL_VPLS_PER_FRAME (MAX_TOTAL_SHADOW_MAPS)
@@ -142,7 +150,8 @@ namespace stratus {
         // last two values = padding
         float metallicRoughness[2];
         unsigned int flags = 0;
-        unsigned int placeholder1_ = 0;
+        // Finest resident mip of each streamed map (see GPU_*_MIP_SLOT). 0 for fully resident maps.
+        unsigned int residentMips = 0;
 
         GpuMaterial() {}
         GpuMaterial(const GpuMaterial&) = default;
@@ -293,6 +302,17 @@ namespace stratus {
     #pragma pack(pop)
 #endif
 
+    // Matches the definition in irradiance_probes.glsl (rgb + padding per L2 SH coefficient)
+#ifndef __GNUC__
+    #pragma pack(push, 1)
+#endif
+    struct PACKED_STRUCT_ATTRIBUTE GpuIrradianceProbe {
+        GpuVec coefficients[9];
+    };
+#ifndef __GNUC__
+    #pragma pack(pop)
+#endif
+
     // These are here since if they fail the engine will not work
     static_assert(sizeof(GpuVec) == 16);
     static_assert(sizeof(GpuMaterial) == 96);
@@ -304,5 +324,6 @@ namespace stratus {
     static_assert(sizeof(GpuPointLight) == 48);
     static_assert(sizeof(GpuAtlasEntry) == 8);
     static_assert(sizeof(GpuHaltonEntry) == 8);
+    static_assert(sizeof(GpuIrradianceProbe) == 144);
     static_assert(MAX_TOTAL_VPLS_PER_FRAME > 64);
 }
\ No newline at end of file
@@ -7,135 +7,108 @@ namespace stratus {
     {
         maxMaterials = std::max<size_t>(1, maxMaterials);
         materials_ = GpuTypedBuffer<GpuMaterial>::Create(maxMaterials, false);
+
+        // Runs on the application thread with no resource manager lock held
+        textureChanges_ = std::make_shared<TextureChanges_>();
+        auto changes = textureChanges_;
+        textureCallback_ = INSTANCE(ResourceManager)->AddTextureStatusCallback([changes](const std::unordered_set<TextureHandle>& changed) {
+            auto ul = std::unique_lock<std::mutex>(changes->m);
+            changes->changed.insert(changed.begin(), changed.end());
+        });
     }
 
     GpuMaterialBuffer::~GpuMaterialBuffer()
     {
+        // Moved from buffers never owned the callback and the resource manager may already be gone on shutdown
+        if (textureChanges_ != nullptr && ResourceManager::Instance() != nullptr) {
+            ResourceManager::Instance()->RemoveTextureStatusCallback(textureCallback_);
+        }
     }
 
-    static inline bool ValidateTexture(const Texture& tex, const TextureLoadingStatus& status) {
-        return status == TextureLoadingStatus::LOADING_DONE;
+    struct MaterialTextureSlot {
+        GpuTextureHandle GpuMaterial::* map;
+        unsigned int flag;
+        u32 mipSlot;
+    };
+
+    // Same order as TexturesOf_
+    static const MaterialTextureSlot materialTextureSlots[MaterialChangeTracker::TEXTURES_PER_MATERIAL] = {
+        { &GpuMaterial::diffuseMap, GPU_DIFFUSE_MAPPED, GPU_DIFFUSE_MIP_SLOT },
+        { &GpuMaterial::emissiveMap, GPU_EMISSIVE_MAPPED, GPU_EMISSIVE_MIP_SLOT },
+        { &GpuMaterial::normalMap, GPU_NORMAL_MAPPED, GPU_NORMAL_MIP_SLOT },
+        { &GpuMaterial::roughnessMap, GPU_ROUGHNESS_MAPPED, GPU_ROUGHNESS_MIP_SLOT },
+        { &GpuMaterial::metallicMap, GPU_METALLIC_MAPPED, GPU_METALLIC_MIP_SLOT },
+        { &GpuMaterial::metallicRoughnessMap, GPU_METALLIC_ROUGHNESS_MAPPED, GPU_METALLIC_ROUGHNESS_MIP_SLOT }
+    };
+
+    MaterialChangeTracker::TextureList GpuMaterialBuffer::TexturesOf_(const Material& material) {
+        return {
+            material.GetDiffuseMap(),
+            material.GetEmissiveMap(),
+            material.GetNormalMap(),
+            material.GetRoughnessMap(),
+            material.GetMetallicMap(),
+            material.GetMetallicRoughnessMap()
+        };
     }
 
-    void GpuMaterialBuffer::CopyMaterialToGpuStaging_(const MaterialPtr& material, const int index) {
+    void GpuMaterialBuffer::CopyMaterialToGpuStaging_(Entry_& entry, const TextureLookup * textures) {
+        const MaterialPtr& material = entry.material;
 
-        auto mat = materials_->GetRead(index);
+        auto mat = materials_->GetRead(entry.gpuIndex);
         GpuMaterial* gpuMaterial = &mat;
 
         gpuMaterial->flags = 0;
+        gpuMaterial->residentMips = 0;
 
         SET_FLOAT4(gpuMaterial->diffuseColor, material->GetDiffuseColor());
         SET_FLOAT3(gpuMaterial->emissiveColor, material->GetEmissiveColor());
         gpuMaterial->reflectance = material->GetReflectance();
         SET_FLOAT2(gpuMaterial->metallicRoughness, glm::vec2(material->GetMetallic(), material->GetRoughness()));
 
-        auto diffuseHandle = material->GetDiffuseMap();
-        auto emissiveHandle = material->GetEmissiveMap();
-        auto normalHandle = material->GetNormalMap();
-        auto roughnessHandle = material->GetRoughnessMap();
-        auto metallicHandle = material->GetMetallicMap();
-        auto metallicRoughnessHandle = material->GetMetallicRoughnessMap();
-
-        TextureLoadingStatus diffuseStatus;
-        auto diffuse = INSTANCE(ResourceManager)->LookupTexture(diffuseHandle, diffuseStatus);
-        TextureLoadingStatus emissiveStatus;
-        auto emissive = INSTANCE(ResourceManager)->LookupTexture(emissiveHandle, emissiveStatus);
-        TextureLoadingStatus normalStatus;
-        auto normal = INSTANCE(ResourceManager)->LookupTexture(normalHandle, normalStatus);
-        TextureLoadingStatus roughnessStatus;
-        auto roughness = INSTANCE(ResourceManager)->LookupTexture(roughnessHandle, roughnessStatus);
-        TextureLoadingStatus metallicStatus;
-        auto metallic = INSTANCE(ResourceManager)->LookupTexture(metallicHandle, metallicStatus);
-        TextureLoadingStatus metallicRoughnessStatus;
-        auto metallicRoughness = INSTANCE(ResourceManager)->LookupTexture(metallicRoughnessHandle, metallicRoughnessStatus);
-
-        auto& resident = residentTexturesPerMaterial_.find(material)->second;
-
-        if (ValidateTexture(diffuse, diffuseStatus)) {
-            gpuMaterial->diffuseMap = diffuse.GpuHandle();
-            gpuMaterial->flags |= GPU_DIFFUSE_MAPPED;
-            resident.push_back(TextureMemResidencyGuard(diffuse));
-        }
-        // If this is true then the texture is still loading so we need to check again later
-        else if (diffuseHandle != TextureHandle::Null() && diffuseStatus != TextureLoadingStatus::FAILED) {
-            pendingMaterials_.insert(material);
-        }
-
-        if (ValidateTexture(emissive, emissiveStatus)) {
-            gpuMaterial->emissiveMap = emissive.GpuHandle();
-            gpuMaterial->flags |= GPU_EMISSIVE_MAPPED;
-            resident.push_back(TextureMemResidencyGuard(emissive));
-        }
-        // If this is true then the texture is still loading so we need to check again later
-        else if (emissiveHandle != TextureHandle::Null() && emissiveStatus != TextureLoadingStatus::FAILED) {
-            pendingMaterials_.insert(material);
-        }
-
-        if (ValidateTexture(normal, normalStatus)) {
-            gpuMaterial->normalMap = normal.GpuHandle();
-            gpuMaterial->flags |= GPU_NORMAL_MAPPED;
-            resident.push_back(TextureMemResidencyGuard(normal));
-        }
-        // If this is true then the texture is still loading so we need to check again later
-        else if (normalHandle != TextureHandle::Null() && normalStatus != TextureLoadingStatus::FAILED) {
-            pendingMaterials_.insert(material);
-        }
-
-        if (ValidateTexture(roughness, roughnessStatus)) {
-            gpuMaterial->roughnessMap = roughness.GpuHandle();
-            gpuMaterial->flags |= GPU_ROUGHNESS_MAPPED;
-            resident.push_back(TextureMemResidencyGuard(roughness));
-        }
-        // If this is true then the texture is still loading so we need to check again later
-        else if (roughnessHandle != TextureHandle::Null() && roughnessStatus != TextureLoadingStatus::FAILED) {
-            pendingMaterials_.insert(material);
-        }
-
-        if (ValidateTexture(metallic, metallicStatus)) {
-            gpuMaterial->metallicMap = metallic.GpuHandle();
-            gpuMaterial->flags |= GPU_METALLIC_MAPPED;
-            resident.push_back(TextureMemResidencyGuard(metallic));
-        }
-        // If this is true then the texture is still loading so we need to check again later
-        else if (metallicHandle != TextureHandle::Null() && metallicStatus != TextureLoadingStatus::FAILED) {
-            pendingMaterials_.insert(material);
-        }
+        // Textures which are still loading are left unmapped. There is no need to check on them again since
+        // the resource manager reports when they finish.
+        for (usize slot = 0; slot < MaterialChangeTracker::TEXTURES_PER_MATERIAL; ++slot) {
+            const TextureLookup& lookup = textures[slot];
+            const MaterialTextureSlot& info = materialTextureSlots[slot];
+            const Texture texture = lookup.status == TextureLoadingStatus::LOADING_DONE ? lookup.texture : Texture();
+
+            if (texture != Texture()) {
+                gpuMaterial->*info.map = texture.GpuHandle();
+                gpuMaterial->flags |= info.flag;
+                // 4 bits per slot
+                gpuMaterial->residentMips |= std::min<u32>(lookup.minMip, 15) << (info.mipSlot * 4);
+            }
 
-        if (ValidateTexture(metallicRoughness, metallicRoughnessStatus)) {
-            gpuMaterial->metallicRoughnessMap = metallicRoughness.GpuHandle();
-            gpuMaterial->flags |= GPU_METALLIC_ROUGHNESS_MAPPED;
-            resident.push_back(TextureMemResidencyGuard(metallicRoughness));
-        }
-        // If this is true then the texture is still loading so we need to check again later
-        else if (metallicRoughnessHandle != TextureHandle::Null() && metallicRoughnessStatus != TextureLoadingStatus::FAILED) {
-            pendingMaterials_.insert(material);
+            // Residency only changes hands when the slot's texture does
+            if (entry.residentTextures[slot] != texture) {
+                entry.residentTextures[slot] = texture;
+                entry.resident[slot] = TextureMemResidencyGuard(texture);
+            }
         }
 
-        materials_->Set(*gpuMaterial, index);
+        materials_->Set(*gpuMaterial, entry.gpuIndex);
     }
 
     void GpuMaterialBuffer::MarkMaterialsUsed(RenderComponent * component)
     {
         for (size_t i = 0; i < component->GetMaterialCount(); ++i) {
             auto material = component->GetMaterialAt(i);
-
-            auto it = usedIndices_.find(material);
-            uint32_t index;
-            // No materials currently reference this material so add a new entry
-            if (it == usedIndices_.end()) {
-                index = materials_->Add(GpuMaterial());
-
-                usedIndices_.insert(std::make_pair(material, index));
-                availableMaterials_.insert(std::make_pair(material, std::unordered_set<RenderComponent *>()));
-                residentTexturesPerMaterial_.insert(std::make_pair(material, std::vector<TextureMemResidencyGuard>()));
-
-                CopyMaterialToGpuStaging_(material, static_cast<int>(index));
-            }
-            else {
-                index = it->second;
+            if (material == nullptr) continue;
+
+            const u32 index = material->GetHandle().index;
+            if (index >= entries_.size()) entries_.resize(usize(index) + 1);
+
+            Entry_& entry = entries_[index];
+            // No components currently reference this material so add a new entry. It is copied
+            // with the rest of the dirty materials in UploadDataToGpu.
+            if (entry.material == nullptr) {
+                entry.material = material;
+                entry.gpuIndex = materials_->Add(GpuMaterial());
+                tracker_.Track(index, TexturesOf_(*material));
             }
 
-            availableMaterials_.find(material)->second.insert(component);
+            entry.components.insert(component);
         }
     }
 
@@ -143,40 +116,67 @@ namespace stratus {
     {
         for (size_t i = 0; i < component->GetMaterialCount(); ++i) {
             auto material = component->GetMaterialAt(i);
-            auto mcit = availableMaterials_.find(material);
-            if (mcit == availableMaterials_.end()) continue;
-
-            mcit->second.erase(component);
-            // No components reference this material anymore so remove it
-            if (mcit->second.size() == 0) {
-                const auto index = usedIndices_.find(material)->second;
+            if (material == nullptr) continue;
 
-                materials_->Remove(index);
-                usedIndices_.erase(material);
+            const u32 index = material->GetHandle().index;
+            if (index >= entries_.size() || entries_[index].material != material) continue;
 
-                availableMaterials_.erase(material);
-                residentTexturesPerMaterial_.erase(material);
-                pendingMaterials_.erase(material);
+            Entry_& entry = entries_[index];
+            entry.components.erase(component);
+            // No components reference this material anymore so remove it
+            if (entry.components.size() == 0) {
+                materials_->Remove(entry.gpuIndex);
+                tracker_.Untrack(index);
+                entry = Entry_();
             }
         }
     }
 
     uint32_t GpuMaterialBuffer::GetMaterialIndex(const MaterialPtr material) const
     {
-        auto it = usedIndices_.find(material);
-        if (it == usedIndices_.end()) {
+        const u32 index = material == nullptr ? MaterialHandle::invalidIndex : material->GetHandle().index;
+        if (index >= entries_.size() || entries_[index].material != material) {
             throw std::runtime_error("Material not found");
         }
 
-        return it->second;
+        return entries_[index].gpuIndex;
     }
 
     void GpuMaterialBuffer::UploadDataToGpu()
     {
-        auto pending = std::move(pendingMaterials_);
-        for (auto& p : pending) {
-            const int index = static_cast<int>(usedIndices_.find(p)->second);
-            CopyMaterialToGpuStaging_(p, index);
+        // Properties or texture assignments changed
+        for (const u32 index : MaterialRegistry::Instance().TakeChanged()) {
+            if (!tracker_.IsTracked(index)) continue;
+            tracker_.Track(index, TexturesOf_(*entries_[index].material));
+        }
+
+        // Loads which finished or failed and streamed textures with a new min mip
+        std::unordered_set<TextureHandle> changed;
+        {
+            auto ul = std::unique_lock<std::mutex>(textureChanges_->m);
+            changed.swap(textureChanges_->changed);
+        }
+        tracker_.TexturesChanged(changed);
+
+        stats_.materialsInUse = tracker_.NumTracked();
+        stats_.materialsProcessedLastFrame = tracker_.NumDirty();
+        stats_.textureChangesLastFrame = changed.size();
+        stats_.materialsProcessed += tracker_.NumDirty();
+        stats_.textureChanges += changed.size();
+
+        if (tracker_.NumDirty() > 0) {
+            const std::vector<u32> dirty = tracker_.TakeDirty();
+            lookupHandles_.clear();
+            for (const u32 index : dirty) {
+                const auto& textures = tracker_.Textures(index);
+                lookupHandles_.insert(lookupHandles_.end(), textures.begin(), textures.end());
+            }
+
+            // One lock for the whole batch rather than one per texture
+            INSTANCE(ResourceManager)->LookupTextures(lookupHandles_, lookups_);
+            for (usize i = 0; i < dirty.size(); ++i) {
+                CopyMaterialToGpuStaging_(entries_[dirty[i]], lookups_.data() + i * MaterialChangeTracker::TEXTURES_PER_MATERIAL);
+            }
         }
 
         materials_->UploadChangesToGpu();
@@ -9,6 +9,9 @@
 #include <list>
 #include <unordered_map>
 #include <unordered_set>
+#include <mutex>
+#include "StratusMaterialRegistry.h"
+#include "StratusResourceManager.h"
 #include "StratusRenderComponents.h"
 #include "StratusEntity.h"
 
@@ -16,7 +19,19 @@ namespace stratus {
     struct GpuMaterialBuffer;
     typedef std::shared_ptr<GpuMaterialBuffer> GpuMaterialBufferPtr;
 
-    // This class manages the current active materials in GPU memory
+    struct GpuMaterialBufferStats {
+        usize materialsInUse = 0;
+        // Most recent UploadDataToGpu
+        usize materialsProcessedLastFrame = 0;
+        usize textureChangesLastFrame = 0;
+        // Totals
+        u64 materialsProcessed = 0;
+        u64 textureChanges = 0;
+    };
+
+    // This class manages the current active materials in GPU memory. Materials are only re-copied when one of
+    // their properties changes or when the resource manager reports a status change for one of their textures,
+    // and all of the textures for a frame's dirty materials are looked up in one batch.
     struct GpuMaterialBuffer {
         GpuMaterialBuffer(size_t maxMaterials);
         
@@ -36,20 +51,41 @@ namespace stratus {
 
         void UploadDataToGpu();
 
+        GpuMaterialBufferStats GetStats() const { return stats_; }
+
         static GpuMaterialBufferPtr Create(const size_t maxMaterials) {
             return GpuMaterialBufferPtr(new GpuMaterialBuffer(maxMaterials));
         }
 
     private:
-        void CopyMaterialToGpuStaging_(const MaterialPtr& material, const int index);
+        struct Entry_ {
+            MaterialPtr material;
+            uint32_t gpuIndex = 0;
+            std::unordered_set<RenderComponent *> components;
+            // Per texture slot, only replaced when the slot's texture actually changes
+            Texture residentTextures[MaterialChangeTracker::TEXTURES_PER_MATERIAL];
+            TextureMemResidencyGuard resident[MaterialChangeTracker::TEXTURES_PER_MATERIAL];
+        };
+
+        // Filled in by the resource manager's status callback, drained once per frame
+        struct TextureChanges_ {
+            std::mutex m;
+            std::unordered_set<TextureHandle> changed;
+        };
+
+        static MaterialChangeTracker::TextureList TexturesOf_(const Material&);
+        void CopyMaterialToGpuStaging_(Entry_& entry, const TextureLookup * textures);
 
     private:
         GpuTypedBufferPtr<GpuMaterial> materials_;
-        // These are the materials we draw from to calculate the material-indices map
-        std::unordered_map<MaterialPtr, std::unordered_set<RenderComponent *>> availableMaterials_;
-        std::unordered_map<MaterialPtr, std::vector<TextureMemResidencyGuard>> residentTexturesPerMaterial_;
-        // Indices can change completely if new materials are added
-        std::unordered_map<MaterialPtr, uint32_t> usedIndices_;
-        std::unordered_set<MaterialPtr> pendingMaterials_;
+        // Indexed by MaterialHandle::index, only entries with a material are in use
+        std::vector<Entry_> entries_;
+        MaterialChangeTracker tracker_;
+        std::shared_ptr<TextureChanges_> textureChanges_;
+        u64 textureCallback_ = 0;
+        // Scratch space reused between frames
+        std::vector<TextureHandle> lookupHandles_;
+        std::vector<TextureLookup> lookups_;
+        GpuMaterialBufferStats stats_;
     };
 }
\ No newline at end of file
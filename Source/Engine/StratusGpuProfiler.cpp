@@ -0,0 +1,92 @@
+#include "StratusGpuProfiler.h"
+#include <algorithm>
+
+namespace stratus {
+    GpuProfiler::GpuProfiler(const usize framesInFlight)
+        : frames_(std::max<usize>(framesInFlight, 1)) {}
+
+    GpuProfiler::~GpuProfiler() {
+        for (Frame_& frame : frames_) {
+            for (Query_& query : frame.queries) {
+                glDeleteQueries(1, &query.begin);
+                glDeleteQueries(1, &query.end);
+            }
+        }
+    }
+
+    bool GpuProfiler::Resolve_(Frame_& frame) {
+        for (usize i = 0; i < frame.used; ++i) {
+            const Query_& query = frame.queries[i];
+            if (!query.ended) continue;
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(query.end, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available == GL_FALSE) return false;
+        }
+
+        for (usize i = 0; i < frame.used; ++i) {
+            const Query_& query = frame.queries[i];
+            if (!query.ended) continue;
+            GLuint64 begin = 0;
+            GLuint64 end = 0;
+            glGetQueryObjectui64v(query.begin, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &end);
+            Profiler::Instance().RecordGpuEvent(ProfileEvent{
+                query.name, i64(begin) + frame.offsetNs, i64(end) + frame.offsetNs, query.depth });
+        }
+
+        frame.pending = false;
+        return true;
+    }
+
+    void GpuProfiler::BeginFrame() {
+        // Pick up whatever finished since last frame. Nothing blocks - frames which are still in
+        // flight are checked again next time.
+        for (Frame_& frame : frames_) {
+            if (frame.pending) Resolve_(frame);
+        }
+
+        open_.clear();
+        active_ = Profiler::Instance().IsCapturing();
+        if (!active_) return;
+
+        current_ = (current_ + 1) % frames_.size();
+        Frame_& frame = frames_[current_];
+        // If the GPU is more than framesInFlight behind the oldest results are dropped rather than waited on
+        frame.pending = true;
+        frame.used = 0;
+
+        // GL_TIMESTAMP is the GPU's current time, which lines the GPU track up with the CPU tracks
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        frame.offsetNs = Profiler::NowNs() - i64(gpuNow);
+    }
+
+    void GpuProfiler::BeginScope(const char * name) {
+        if (!active_) return;
+
+        Frame_& frame = frames_[current_];
+        if (frame.used == frame.queries.size()) {
+            Query_ query{ nullptr, 0, 0, 0, false };
+            glGenQueries(1, &query.begin);
+            glGenQueries(1, &query.end);
+            frame.queries.push_back(query);
+        }
+
+        Query_& query = frame.queries[frame.used];
+        query.name = name;
+        query.depth = u32(open_.size());
+        query.ended = false;
+        glQueryCounter(query.begin, GL_TIMESTAMP);
+        open_.push_back(frame.used);
+        ++frame.used;
+    }
+
+    void GpuProfiler::EndScope() {
+        if (!active_ || open_.size() == 0) return;
+
+        Query_& query = frames_[current_].queries[open_.back()];
+        open_.pop_back();
+        glQueryCounter(query.end, GL_TIMESTAMP);
+        query.ended = true;
+    }
+}
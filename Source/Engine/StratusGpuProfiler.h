@@ -0,0 +1,81 @@
+#pragma once
+
+#include "StratusCommon.h"
+#include "StratusTypes.h"
+#include "StratusProfiler.h"
+#include <vector>
+
+namespace stratus {
+    // Times GPU work with timestamp queries and hands the results to Profiler's GPU track. Results
+    // are read back a few frames later once they are available so the CPU never waits on the GPU.
+    // Does nothing unless Profiler is capturing.
+    class GpuProfiler {
+    public:
+        GpuProfiler(const usize framesInFlight = 3);
+        ~GpuProfiler();
+
+        GpuProfiler(const GpuProfiler&) = delete;
+        GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+        // Call at the start of each frame before any scopes
+        void BeginFrame();
+        void BeginScope(const char * name);
+        void EndScope();
+
+    private:
+        struct Query_ {
+            const char * name;
+            u32 depth;
+            GLuint begin;
+            GLuint end;
+            // False until EndScope writes the end timestamp
+            bool ended;
+        };
+
+        struct Frame_ {
+            std::vector<Query_> queries;
+            usize used = 0;
+            // Added to GPU timestamps to move them onto Profiler::NowNs time
+            i64 offsetNs = 0;
+            bool pending = false;
+        };
+
+        // Returns false if the frame's queries are not all available yet
+        bool Resolve_(Frame_& frame);
+
+    private:
+        std::vector<Frame_> frames_;
+        usize current_ = 0;
+        // Indices into the current frame's queries for scopes which are still open
+        std::vector<usize> open_;
+        bool active_ = false;
+    };
+
+    // Times the GPU work issued until the end of the enclosing block
+    class GpuProfileScope {
+    public:
+        GpuProfileScope(GpuProfiler * profiler, const char * name)
+            : profiler_(profiler) {
+            if (profiler_ != nullptr) profiler_->BeginScope(name);
+        }
+
+        ~GpuProfileScope() {
+            if (profiler_ != nullptr) profiler_->EndScope();
+        }
+
+        GpuProfileScope(const GpuProfileScope&) = delete;
+        GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+    private:
+        GpuProfiler * profiler_;
+    };
+}
+
+#if STRATUS_PROFILING_ENABLED
+    // Times both the CPU and GPU side of a block of rendering code
+    #define STRATUS_PROFILE_GPU_SCOPE(gpuProfiler, name)                                                         \
+        STRATUS_PROFILE_SCOPE(name);                                                                         \
+        ::stratus::GpuProfileScope STRATUS_PROFILE_CONCAT_(gpuProfileScope, __LINE__)(gpuProfiler, name)
+#else
+    #define STRATUS_PROFILE_GPU_SCOPE(gpuProfiler, name) ((void)0)
+#endif
@@ -4,6 +4,7 @@
 #include "StratusCommon.h"
 #include "StratusGpuCommon.h"
 #include "StratusLog.h"
+#include <sstream>
 
 namespace stratus {
     struct GraphicsContext {
@@ -27,9 +28,23 @@ namespace stratus {
         glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 10000000);
     }
 
+    bool HostFenceSignalled(GpuHostFence fenceHandle) {
+        if (fenceHandle.handle == nullptr) return true;
+        GLsync fence = static_cast<GLsync>(fenceHandle.handle);
+        const GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+    }
+
+    void HostDeleteFence(GpuHostFence fenceHandle) {
+        if (fenceHandle.handle == nullptr) return;
+        glDeleteSync(static_cast<GLsync>(fenceHandle.handle));
+    }
+
     static void PrintGLInfo() {
         const GraphicsConfig& config = GetContext().config;
-        auto& log = STRATUS_LOG << std::endl;
+        // Built up first so that it goes out as a single message
+        std::stringstream log;
+        log << std::endl;
         log << "==================== OpenGL Information ====================" << std::endl;
         log << "\tRenderer: " << config.renderer << std::endl;
         log << "\tVersion: " << config.version << std::endl;
@@ -87,6 +102,8 @@ namespace stratus {
                 log << "\t\tPreferred page size Z 3D: " << config.preferredPageSizeZ3D[i] << std::endl;
             }
         }
+
+        STRATUS_LOG << log.str() << std::endl;
     }
 
     bool GraphicsDriver::Initialize() {
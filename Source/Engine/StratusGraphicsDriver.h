@@ -15,6 +15,9 @@ namespace stratus {
 
     GpuHostFence HostInsertFence();
     void HostFenceSync(GpuHostFence);
+    // Returns immediately - true if the GPU has passed the fence
+    bool HostFenceSignalled(GpuHostFence);
+    void HostDeleteFence(GpuHostFence);
 
     /**
      * This contains information about a lot of the
@@ -0,0 +1,388 @@
+#include "StratusIrradianceProbes.h"
+#include "StratusTaskSystem.h"
+#include "StratusLog.h"
+#include "StratusLight.h"
+#include "StratusVplCulling.h"
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace stratus {
+    // 'SPRB' - Stratus PRoBes
+    static constexpr uint32_t probeFileMagic = 0x42525053;
+    static constexpr uint32_t probeFileVersion = 1;
+
+    static constexpr float pi = 3.14159265358979323846f;
+
+    // Real spherical harmonic basis for bands 0-2 evaluated in the (normalized) direction d
+    static void EvaluateShBasis(const glm::vec3& d, float basis[IRRADIANCE_PROBE_SH_COEFFICIENTS]) {
+        basis[0] = 0.282095f;
+        basis[1] = 0.488603f * d.y;
+        basis[2] = 0.488603f * d.z;
+        basis[3] = 0.488603f * d.x;
+        basis[4] = 1.092548f * d.x * d.y;
+        basis[5] = 1.092548f * d.y * d.z;
+        basis[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+        basis[7] = 1.092548f * d.x * d.z;
+        basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+    }
+
+    // Convolution of radiance with the clamped cosine lobe (Ramamoorthi and Hanrahan, "An Efficient
+    // Representation for Irradiance Environment Maps")
+    static constexpr float cosineLobeBand0 = pi;
+    static constexpr float cosineLobeBand1 = 2.0f * pi / 3.0f;
+    static constexpr float cosineLobeBand2 = pi / 4.0f;
+
+    static glm::vec3 EvaluateIrradiance(const glm::vec3 * coefficients, const glm::vec3& normal) {
+        float basis[IRRADIANCE_PROBE_SH_COEFFICIENTS];
+        EvaluateShBasis(normal, basis);
+
+        glm::vec3 result = cosineLobeBand0 * coefficients[0] * basis[0];
+        for (int i = 1; i < 4; ++i) {
+            result += cosineLobeBand1 * coefficients[i] * basis[i];
+        }
+        for (int i = 4; i < IRRADIANCE_PROBE_SH_COEFFICIENTS; ++i) {
+            result += cosineLobeBand2 * coefficients[i] * basis[i];
+        }
+
+        return glm::max(result, glm::vec3(0.0f));
+    }
+
+    // Solid boxes the bake traces against. Leaves own a contiguous range of boxes and the first child
+    // of an interior node always directly follows it.
+    struct IrradianceOccluderNode_ {
+        glm::vec3 vmin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 vmax = glm::vec3(std::numeric_limits<float>::lowest());
+        uint32_t first = 0;
+        // 0 for interior nodes
+        uint32_t count = 0;
+        uint32_t secondChild = 0;
+    };
+
+    struct IrradianceOccluderBvh_ {
+        static constexpr uint32_t maxBoxesPerLeaf = 4;
+
+        std::vector<std::pair<glm::vec3, glm::vec3>> boxes;
+        std::vector<IrradianceOccluderNode_> nodes;
+
+        explicit IrradianceOccluderBvh_(const std::vector<GpuAABB>& occluders) {
+            boxes.reserve(occluders.size());
+            for (const GpuAABB& aabb : occluders) {
+                boxes.push_back(std::make_pair(glm::vec3(aabb.vmin.ToVec4()), glm::vec3(aabb.vmax.ToVec4())));
+            }
+            if (boxes.size() > 0) Build_(0, uint32_t(boxes.size()));
+        }
+
+        // True if the segment passes through a box which contains neither end
+        bool Blocks(const glm::vec3& from, const glm::vec3& to) const {
+            if (nodes.size() == 0) return false;
+
+            const glm::vec3 direction = to - from;
+            glm::vec3 invDirection;
+            for (int i = 0; i < 3; ++i) {
+                // Avoids 0 * inf = NaN for segments starting on a slab
+                invDirection[i] = direction[i] == 0.0f ? std::numeric_limits<float>::max() : 1.0f / direction[i];
+            }
+
+            uint32_t stack[64];
+            uint32_t stackSize = 0;
+            stack[stackSize++] = 0;
+            while (stackSize > 0) {
+                const IrradianceOccluderNode_& node = nodes[stack[--stackSize]];
+                if (!SegmentHits_(from, invDirection, node.vmin, node.vmax)) continue;
+
+                if (node.count == 0) {
+                    stack[stackSize++] = uint32_t(&node - nodes.data()) + 1;
+                    stack[stackSize++] = node.secondChild;
+                    continue;
+                }
+
+                for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                    const auto& box = boxes[i];
+                    if (Contains_(box, from) || Contains_(box, to)) continue;
+                    if (SegmentHits_(from, invDirection, box.first, box.second)) return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        static bool Contains_(const std::pair<glm::vec3, glm::vec3>& box, const glm::vec3& point) {
+            return glm::all(glm::greaterThanEqual(point, box.first)) && glm::all(glm::lessThanEqual(point, box.second));
+        }
+
+        // Slab test clipped to the segment (t on [0, 1])
+        static bool SegmentHits_(const glm::vec3& from, const glm::vec3& invDirection, const glm::vec3& vmin, const glm::vec3& vmax) {
+            const glm::vec3 t0 = (vmin - from) * invDirection;
+            const glm::vec3 t1 = (vmax - from) * invDirection;
+            const glm::vec3 tmin = glm::min(t0, t1);
+            const glm::vec3 tmax = glm::max(t0, t1);
+            const float enter = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.0f));
+            const float exit = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, 1.0f));
+            return enter <= exit;
+        }
+
+        // Median split along the longest axis of the box centers. Depth stays around log2(boxes) which
+        // keeps the traversal stack small.
+        uint32_t Build_(const uint32_t first, const uint32_t last) {
+            const uint32_t index = uint32_t(nodes.size());
+            nodes.push_back(IrradianceOccluderNode_());
+
+            glm::vec3 vmin = glm::vec3(std::numeric_limits<float>::max());
+            glm::vec3 vmax = glm::vec3(std::numeric_limits<float>::lowest());
+            glm::vec3 centerMin = vmin;
+            glm::vec3 centerMax = vmax;
+            for (uint32_t i = first; i < last; ++i) {
+                vmin = glm::min(vmin, boxes[i].first);
+                vmax = glm::max(vmax, boxes[i].second);
+                const glm::vec3 center = (boxes[i].first + boxes[i].second) * 0.5f;
+                centerMin = glm::min(centerMin, center);
+                centerMax = glm::max(centerMax, center);
+            }
+            nodes[index].vmin = vmin;
+            nodes[index].vmax = vmax;
+
+            if (last - first <= maxBoxesPerLeaf) {
+                nodes[index].first = first;
+                nodes[index].count = last - first;
+                return index;
+            }
+
+            const glm::vec3 extents = centerMax - centerMin;
+            const int axis = extents.x >= extents.y && extents.x >= extents.z ? 0 : (extents.y >= extents.z ? 1 : 2);
+            const uint32_t middle = first + (last - first) / 2;
+            std::nth_element(boxes.begin() + first, boxes.begin() + middle, boxes.begin() + last, [axis](const auto& a, const auto& b) {
+                return a.first[axis] + a.second[axis] < b.first[axis] + b.second[axis];
+            });
+
+            Build_(first, middle);
+            const uint32_t secondChild = Build_(middle, last);
+            nodes[index].secondChild = secondChild;
+            return index;
+        }
+    };
+
+    glm::vec3 IrradianceProbeGrid::SampleIrradiance(const glm::vec3& position, const glm::vec3& normal) const {
+        if (!IsValid()) return glm::vec3(0.0f);
+
+        // Convert to grid space and clamp so that positions outside the grid use the border probes
+        const glm::vec3 maxCoords = glm::vec3(dimensions - glm::ivec3(1));
+        const glm::vec3 gridCoords = glm::clamp((position - origin) / spacing, glm::vec3(0.0f), maxCoords);
+        const glm::ivec3 base = glm::min(glm::ivec3(glm::floor(gridCoords)), glm::max(dimensions - glm::ivec3(2), glm::ivec3(0)));
+        const glm::vec3 alpha = glm::clamp(gridCoords - glm::vec3(base), glm::vec3(0.0f), glm::vec3(1.0f));
+
+        glm::vec3 blended[IRRADIANCE_PROBE_SH_COEFFICIENTS];
+        for (int i = 0; i < IRRADIANCE_PROBE_SH_COEFFICIENTS; ++i) {
+            blended[i] = glm::vec3(0.0f);
+        }
+
+        for (int corner = 0; corner < 8; ++corner) {
+            const glm::ivec3 offset = glm::ivec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+            const glm::ivec3 probe = glm::min(base + offset, dimensions - glm::ivec3(1));
+            const glm::vec3 weights = glm::mix(glm::vec3(1.0f) - alpha, alpha, glm::vec3(offset));
+            const float weight = weights.x * weights.y * weights.z;
+            if (weight <= 0.0f) continue;
+
+            const glm::vec3 * probeCoefficients = &coefficients[ProbeIndex(probe.x, probe.y, probe.z) * IRRADIANCE_PROBE_SH_COEFFICIENTS];
+            for (int i = 0; i < IRRADIANCE_PROBE_SH_COEFFICIENTS; ++i) {
+                blended[i] += weight * probeCoefficients[i];
+            }
+        }
+
+        return EvaluateIrradiance(blended, glm::normalize(normal));
+    }
+
+    bool IrradianceProbeGrid::SaveToFile(const std::string& filepath) const {
+        if (!IsValid()) {
+            STRATUS_ERROR << "Attempt to save invalid irradiance probe grid to " << filepath << std::endl;
+            return false;
+        }
+
+        std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            STRATUS_ERROR << "Unable to open " << filepath << " for writing" << std::endl;
+            return false;
+        }
+
+        const uint64_t numCoefficients = uint64_t(coefficients.size());
+        file.write((const char *)&probeFileMagic, sizeof(probeFileMagic));
+        file.write((const char *)&probeFileVersion, sizeof(probeFileVersion));
+        file.write((const char *)&origin[0], sizeof(float) * 3);
+        file.write((const char *)&spacing, sizeof(float));
+        file.write((const char *)&dimensions[0], sizeof(int) * 3);
+        file.write((const char *)&numCoefficients, sizeof(numCoefficients));
+        file.write((const char *)coefficients.data(), sizeof(glm::vec3) * coefficients.size());
+
+        return file.good();
+    }
+
+    bool IrradianceProbeGrid::LoadFromFile(const std::string& filepath) {
+        std::ifstream file(filepath, std::ios::binary);
+        if (!file.is_open()) return false;
+
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        file.read((char *)&magic, sizeof(magic));
+        file.read((char *)&version, sizeof(version));
+        if (!file.good() || magic != probeFileMagic || version != probeFileVersion) {
+            STRATUS_ERROR << "Irradiance probe file " << filepath << " is not a supported probe file" << std::endl;
+            return false;
+        }
+
+        IrradianceProbeGrid loaded;
+        uint64_t numCoefficients = 0;
+        file.read((char *)&loaded.origin[0], sizeof(float) * 3);
+        file.read((char *)&loaded.spacing, sizeof(float));
+        file.read((char *)&loaded.dimensions[0], sizeof(int) * 3);
+        file.read((char *)&numCoefficients, sizeof(numCoefficients));
+        if (!file.good() || numCoefficients != loaded.NumProbes() * IRRADIANCE_PROBE_SH_COEFFICIENTS) {
+            STRATUS_ERROR << "Irradiance probe file " << filepath << " has a corrupt header" << std::endl;
+            return false;
+        }
+
+        loaded.coefficients.resize(numCoefficients);
+        file.read((char *)loaded.coefficients.data(), sizeof(glm::vec3) * loaded.coefficients.size());
+        if (!file.good()) {
+            STRATUS_ERROR << "Irradiance probe file " << filepath << " is truncated" << std::endl;
+            return false;
+        }
+
+        *this = std::move(loaded);
+        return true;
+    }
+
+    bool IrradianceProbeBakeJob::Completed() const {
+        for (const auto& batch : batches_) {
+            if (!batch.Completed()) return false;
+        }
+        return true;
+    }
+
+    IrradianceProbeGridPtr IrradianceProbeBakeJob::Result() const {
+        if (!Completed()) {
+            throw std::runtime_error("IrradianceProbeBakeJob::Result called before completion");
+        }
+        return grid_;
+    }
+
+    std::vector<IrradianceProbeLight> IrradianceProbeBaker::CollectBakedLights(const LightRegistry& lights) {
+        const uint32_t bakedVpl = LIGHT_FLAG_VIRTUAL | LIGHT_FLAG_BAKED;
+        const auto& flags = lights.Flags();
+
+        std::vector<IrradianceProbeLight> result;
+        size_t uncolored = 0;
+        for (size_t i = 0; i < lights.Size(); ++i) {
+            if ((flags[i] & bakedVpl) != bakedVpl) continue;
+
+            const VirtualPointLight * vpl = (const VirtualPointLight *)lights.Lights()[i].get();
+            if (vpl->GetSunDrivenColor() == glm::vec3(0.0f)) {
+                ++uncolored;
+                continue;
+            }
+
+            IrradianceProbeLight probeLight;
+            probeLight.position = lights.Positions()[i];
+            probeLight.color = vpl->GetSunDrivenColor();
+            probeLight.radius = lights.Radii()[i];
+            result.push_back(probeLight);
+        }
+
+        if (uncolored > 0) {
+            STRATUS_WARN << uncolored << " baked VPLs have not been lit by the GI pass yet and were left out of the bake" << std::endl;
+        }
+
+        return result;
+    }
+
+    IrradianceProbeVisibilityFunction IrradianceProbeBaker::CreateOccluderVisibility(const std::vector<GpuAABB>& occluders) {
+        auto bvh = std::make_shared<const IrradianceOccluderBvh_>(occluders);
+        return [bvh](const glm::vec3& from, const glm::vec3& to) {
+            return !bvh->Blocks(from, to);
+        };
+    }
+
+    IrradianceProbeGridPtr IrradianceProbeBaker::CreateGrid(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const float spacing) {
+        if (spacing <= 0.0f) {
+            throw std::runtime_error("Irradiance probe spacing must be > 0");
+        }
+
+        auto grid = IrradianceProbeGridPtr(new IrradianceProbeGrid());
+        const glm::vec3 extents = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+        grid->origin = boundsMin;
+        grid->spacing = spacing;
+        // +1 so that the last probe lands on (or past) boundsMax
+        grid->dimensions = glm::ivec3(glm::ceil(extents / spacing)) + glm::ivec3(1);
+        grid->coefficients.resize(grid->NumProbes() * IRRADIANCE_PROBE_SH_COEFFICIENTS, glm::vec3(0.0f));
+        return grid;
+    }
+
+    void IrradianceProbeBaker::BakeProbes(
+        const std::vector<IrradianceProbeLight>& lights,
+        const IrradianceProbeVisibilityFunction& visible,
+        const size_t firstProbe,
+        const size_t lastProbe,
+        IrradianceProbeGrid& grid) {
+
+        const size_t end = std::min(lastProbe, grid.NumProbes());
+        const size_t sliceSize = size_t(grid.dimensions.x) * size_t(grid.dimensions.y);
+        float basis[IRRADIANCE_PROBE_SH_COEFFICIENTS];
+
+        for (size_t index = firstProbe; index < end; ++index) {
+            const int z = int(index / sliceSize);
+            const int y = int((index % sliceSize) / size_t(grid.dimensions.x));
+            const int x = int(index % size_t(grid.dimensions.x));
+            const glm::vec3 probePosition = grid.ProbePosition(x, y, z);
+
+            glm::vec3 * coefficients = &grid.coefficients[index * IRRADIANCE_PROBE_SH_COEFFICIENTS];
+            for (int i = 0; i < IRRADIANCE_PROBE_SH_COEFFICIENTS; ++i) {
+                coefficients[i] = glm::vec3(0.0f);
+            }
+
+            for (const IrradianceProbeLight& light : lights) {
+                const glm::vec3 toLight = light.position - probePosition;
+                const float distance = glm::length(toLight);
+                if (distance >= light.radius || distance <= 0.0f) continue;
+                if (visible && !visible(probePosition, light.position)) continue;
+
+                // Point lights are a delta in direction space so their projection is just
+                // the basis evaluated in the light direction scaled by the incoming radiance
+                const glm::vec3 radiance = light.color * CpuVplCulling::DiffuseAttenuation(distance, light.radius);
+                EvaluateShBasis(toLight / distance, basis);
+                for (int i = 0; i < IRRADIANCE_PROBE_SH_COEFFICIENTS; ++i) {
+                    coefficients[i] += radiance * basis[i];
+                }
+            }
+        }
+    }
+
+    IrradianceProbeBakeJob IrradianceProbeBaker::ScheduleBake(
+        const std::vector<IrradianceProbeLight>& lights,
+        const IrradianceProbeVisibilityFunction& visible,
+        const IrradianceProbeGridPtr& grid) {
+
+        IrradianceProbeBakeJob job;
+        job.grid_ = grid;
+
+        const size_t numProbes = grid->NumProbes();
+        TaskSystem * tasks = INSTANCE(TaskSystem);
+        if (tasks == nullptr || tasks->Size() == 0) {
+            BakeProbes(lights, visible, 0, numProbes, *grid);
+            return job;
+        }
+
+        STRATUS_LOG << "Baking " << numProbes << " irradiance probes from " << lights.size() << " static lights" << std::endl;
+
+        auto sharedLights = std::make_shared<const std::vector<IrradianceProbeLight>>(lights);
+        // Each batch writes to a disjoint range of probes
+        const size_t probesPerBatch = std::max<size_t>(1, (numProbes + tasks->Size() - 1) / tasks->Size());
+        for (size_t first = 0; first < numProbes; first += probesPerBatch) {
+            const size_t last = std::min(first + probesPerBatch, numProbes);
+            job.batches_.push_back(tasks->ScheduleTask([sharedLights, visible, grid, first, last]() {
+                BakeProbes(*sharedLights, visible, first, last, *grid);
+            }));
+        }
+
+        return job;
+    }
+}
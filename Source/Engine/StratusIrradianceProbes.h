@@ -0,0 +1,121 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "StratusAsync.h"
+#include "StratusLightRegistry.h"
+#include "StratusGpuCommon.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+
+// Number of coefficients for 3-band (L2) spherical harmonics (matches irradiance_probes.glsl)
+#define IRRADIANCE_PROBE_SH_COEFFICIENTS (9)
+
+namespace stratus {
+    // Light source used by the bake (see CollectBakedLights)
+    struct IrradianceProbeLight {
+        glm::vec3 position = glm::vec3(0.0f);
+        // Color the GI pass uses for the light (intensity included)
+        glm::vec3 color = glm::vec3(1.0f);
+        float radius = 1.0f;
+    };
+
+    // Regular 3D grid of L2 spherical harmonic irradiance probes. Probe (x, y, z) is located
+    // at origin + vec3(x, y, z) * spacing.
+    struct IrradianceProbeGrid {
+        glm::vec3 origin = glm::vec3(0.0f);
+        float spacing = 1.0f;
+        glm::ivec3 dimensions = glm::ivec3(0);
+        // IRRADIANCE_PROBE_SH_COEFFICIENTS entries per probe, x varying fastest
+        std::vector<glm::vec3> coefficients;
+
+        size_t NumProbes() const {
+            return size_t(dimensions.x) * size_t(dimensions.y) * size_t(dimensions.z);
+        }
+
+        size_t ProbeIndex(const int x, const int y, const int z) const {
+            return size_t(x) + size_t(dimensions.x) * (size_t(y) + size_t(dimensions.y) * size_t(z));
+        }
+
+        glm::vec3 ProbePosition(const int x, const int y, const int z) const {
+            return origin + glm::vec3(float(x), float(y), float(z)) * spacing;
+        }
+
+        bool IsValid() const {
+            return NumProbes() > 0 && coefficients.size() == NumProbes() * IRRADIANCE_PROBE_SH_COEFFICIENTS;
+        }
+
+        // Irradiance arriving at a surface with the given normal, trilinearly blended between
+        // the 8 surrounding probes. Divide by pi and multiply by albedo for Lambertian outgoing radiance.
+        glm::vec3 SampleIrradiance(const glm::vec3& position, const glm::vec3& normal) const;
+
+        // Compact binary format (magic + version + header + raw coefficients)
+        bool SaveToFile(const std::string& filepath) const;
+        bool LoadFromFile(const std::string& filepath);
+
+        // Bake output is stored next to the cooked scene, e.g. Sponza.gltf -> Sponza.gltf.probes
+        static std::string ProbeFileForScene(const std::string& scenePath) {
+            return scenePath + ".probes";
+        }
+    };
+
+    typedef std::shared_ptr<IrradianceProbeGrid> IrradianceProbeGridPtr;
+
+    // Returns true if nothing blocks the segment between the two world space points
+    typedef std::function<bool (const glm::vec3& from, const glm::vec3& to)> IrradianceProbeVisibilityFunction;
+
+    // Handle to a bake which was split across the task system
+    class IrradianceProbeBakeJob {
+        friend class IrradianceProbeBaker;
+
+    public:
+        IrradianceProbeBakeJob() = default;
+
+        bool Completed() const;
+        // Only valid after Completed() returns true
+        IrradianceProbeGridPtr Result() const;
+
+    private:
+        IrradianceProbeGridPtr grid_;
+        std::vector<Async<void>> batches_;
+    };
+
+    // Evaluates static lighting into an IrradianceProbeGrid on the CPU. Nothing here touches
+    // the graphics API so it can run headless (e.g. as part of an offline cook step).
+    class IrradianceProbeBaker {
+        IrradianceProbeBaker() = delete;
+
+    public:
+        // Pulls every virtual point light marked as baked out of the registry with the color the GI pass
+        // last computed for it from the sun (see VirtualPointLight::GetSunDrivenColor). Lights which
+        // have no color yet are left out since they would contribute nothing.
+        static std::vector<IrradianceProbeLight> CollectBakedLights(const LightRegistry& lights);
+
+        // Treats each box as solid: a light is visible from a probe when the segment between them
+        // misses every box. Boxes containing either end are ignored so that a probe inside a large
+        // box (e.g. the bounds of a whole room) is not always dark.
+        static IrradianceProbeVisibilityFunction CreateOccluderVisibility(const std::vector<GpuAABB>& occluders);
+
+        // Creates an empty grid covering [boundsMin, boundsMax] with the given spacing
+        static IrradianceProbeGridPtr CreateGrid(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const float spacing);
+
+        // Bakes probes [firstProbe, lastProbe) into the grid. If visible is empty then lights are
+        // treated as unoccluded.
+        static void BakeProbes(
+            const std::vector<IrradianceProbeLight>& lights,
+            const IrradianceProbeVisibilityFunction& visible,
+            const size_t firstProbe,
+            const size_t lastProbe,
+            IrradianceProbeGrid& grid
+        );
+
+        // Splits the bake into one batch per task thread. Runs inline if the task system
+        // is unavailable.
+        static IrradianceProbeBakeJob ScheduleBake(
+            const std::vector<IrradianceProbeLight>& lights,
+            const IrradianceProbeVisibilityFunction& visible,
+            const IrradianceProbeGridPtr& grid
+        );
+    };
+}
@@ -337,6 +337,7 @@ namespace stratus {
     // changing will be disabled.
     class VirtualPointLight : public PointLight {
         friend class Renderer;
+        friend class RendererBackend;
 
     public:
         VirtualPointLight() : PointLight(/* virtualLight = */ true, /* staticLight = */ true) {}
@@ -345,6 +346,15 @@ namespace stratus {
         void SetNumShadowSamples(uint32_t samples) { numShadowSamples_ = samples; }
         uint32_t GetNumShadowSamples() const { return numShadowSamples_; }
 
+        // Baked lights are evaluated into the static irradiance probes (see IrradianceProbeBaker).
+        // While the renderer has probes set they are left out of the per-frame GI pass.
+        void SetBaked(const bool baked) { baked_ = baked; }
+        bool IsBaked() const { return baked_; }
+
+        // Color the GI pass last computed from the sun for this light (vpl_light_color.cs), intensity
+        // included. Only tracked for baked lights and stays 0 until the light has been lit and visible.
+        const glm::vec3& GetSunDrivenColor() const { return sunDrivenColor_; }
+
         // This MUST be done or else the engine makes copies and it will defer
         // to PointLight instead of this and then cause horrible strange errors
         LightPtr Copy() const override {
@@ -357,6 +367,8 @@ namespace stratus {
 
     private:
         uint32_t numShadowSamples_ = 3;
+        glm::vec3 sunDrivenColor_ = glm::vec3(0.0f);
+        bool baked_ = false;
     };
 }
 
@@ -0,0 +1,295 @@
+#include "StratusLightRegistry.h"
+#include "StratusLight.h"
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace stratus {
+    static uint32_t ComputeFlags(const Light& light) {
+        uint32_t flags = 0;
+        if (light.IsVirtualLight()) flags |= LIGHT_FLAG_VIRTUAL;
+        if (light.IsStaticLight()) flags |= LIGHT_FLAG_STATIC;
+        if (light.CastsShadows()) flags |= LIGHT_FLAG_CASTS_SHADOWS;
+        if (light.IsVirtualLight() && ((const VirtualPointLight&)light).IsBaked()) flags |= LIGHT_FLAG_BAKED;
+        return flags;
+    }
+
+    int LightRegistry::CountTrailingZeros_(const uint64_t value) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return int(index);
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    LightHandle LightRegistry::Add(const LightPtr& light) {
+        if (light == nullptr) return LightHandle::Null();
+
+        auto existing = lookup_.find(light.get());
+        if (existing != lookup_.end()) return existing->second;
+
+        uint32_t slotIndex;
+        if (freeList_ != LightHandle::invalidIndex) {
+            slotIndex = freeList_;
+            freeList_ = slots_[slotIndex].denseOrNextFree;
+        }
+        else {
+            slotIndex = uint32_t(slots_.size());
+            slots_.push_back(Slot_());
+        }
+
+        const size_t denseIndex = lights_.size();
+        Slot_& slot = slots_[slotIndex];
+        slot.denseOrNextFree = uint32_t(denseIndex);
+        slot.occupied = true;
+
+        lights_.push_back(light);
+        positions_.push_back(light->GetPosition());
+        radii_.push_back(light->GetRadius());
+        colors_.push_back(light->GetColor());
+        intensities_.push_back(light->GetIntensity());
+        flags_.push_back(ComputeFlags(*light));
+        denseToSlot_.push_back(slotIndex);
+        ResizeBits_();
+
+        // New lights always count as changed so that anything keyed off of the bitsets picks them up
+        SetBit_(changed_, denseIndex, true);
+        SetBit_(moved_, denseIndex, true);
+
+        const LightHandle handle{ slotIndex, slot.generation };
+        lookup_.insert(std::make_pair(light.get(), handle));
+        return handle;
+    }
+
+    bool LightRegistry::Remove(const LightHandle& handle) {
+        if (!IsValid(handle)) return false;
+
+        Slot_& slot = slots_[handle.index];
+        const size_t denseIndex = slot.denseOrNextFree;
+        const size_t last = lights_.size() - 1;
+
+        lookup_.erase(lights_[denseIndex].get());
+
+        // Swap the last element into the hole to keep the arrays dense
+        if (denseIndex != last) {
+            lights_[denseIndex] = std::move(lights_[last]);
+            positions_[denseIndex] = positions_[last];
+            radii_[denseIndex] = radii_[last];
+            colors_[denseIndex] = colors_[last];
+            intensities_[denseIndex] = intensities_[last];
+            flags_[denseIndex] = flags_[last];
+            denseToSlot_[denseIndex] = denseToSlot_[last];
+            SetBit_(changed_, denseIndex, TestBit_(changed_, last));
+            SetBit_(moved_, denseIndex, TestBit_(moved_, last));
+            slots_[denseToSlot_[denseIndex]].denseOrNextFree = uint32_t(denseIndex);
+        }
+
+        SetBit_(changed_, last, false);
+        SetBit_(moved_, last, false);
+        lights_.pop_back();
+        positions_.pop_back();
+        radii_.pop_back();
+        colors_.pop_back();
+        intensities_.pop_back();
+        flags_.pop_back();
+        denseToSlot_.pop_back();
+
+        // Bumping the generation invalidates all outstanding handles to this slot
+        ++slot.generation;
+        slot.occupied = false;
+        slot.denseOrNextFree = freeList_;
+        freeList_ = handle.index;
+
+        return true;
+    }
+
+    void LightRegistry::Clear() {
+        // Keep the slots around so that old handles stay stale rather than aliasing new lights
+        for (uint32_t i = 0; i < uint32_t(slots_.size()); ++i) {
+            Slot_& slot = slots_[i];
+            if (!slot.occupied) continue;
+            ++slot.generation;
+            slot.occupied = false;
+            slot.denseOrNextFree = freeList_;
+            freeList_ = i;
+        }
+
+        lookup_.clear();
+        lights_.clear();
+        positions_.clear();
+        radii_.clear();
+        colors_.clear();
+        intensities_.clear();
+        flags_.clear();
+        denseToSlot_.clear();
+        changed_.clear();
+        moved_.clear();
+    }
+
+    LightHandle LightRegistry::Find(const LightPtr& light) const {
+        auto it = lookup_.find(light.get());
+        return it == lookup_.end() ? LightHandle::Null() : it->second;
+    }
+
+    bool LightRegistry::IsValid(const LightHandle& handle) const {
+        return handle.index < slots_.size() &&
+               slots_[handle.index].occupied &&
+               slots_[handle.index].generation == handle.generation;
+    }
+
+    LightPtr LightRegistry::Get(const LightHandle& handle) const {
+        if (!IsValid(handle)) return nullptr;
+        return lights_[slots_[handle.index].denseOrNextFree];
+    }
+
+    LightHandle LightRegistry::HandleAt(const size_t denseIndex) const {
+        const uint32_t slotIndex = denseToSlot_[denseIndex];
+        return LightHandle{ slotIndex, slots_[slotIndex].generation };
+    }
+
+    size_t LightRegistry::DenseIndex(const LightHandle& handle) const {
+        if (!IsValid(handle)) return Size();
+        return slots_[handle.index].denseOrNextFree;
+    }
+
+    size_t LightRegistry::SyncFromLights() {
+        ClearChanged();
+
+        size_t numChanged = 0;
+        for (size_t i = 0; i < lights_.size(); ++i) {
+            bool moved;
+            if (ReadLight_(i, moved)) {
+                SetBit_(changed_, i, true);
+                ++numChanged;
+            }
+            if (moved) SetBit_(moved_, i, true);
+        }
+
+        return numChanged;
+    }
+
+    void LightRegistry::ClearChanged() {
+        std::fill(changed_.begin(), changed_.end(), 0);
+        std::fill(moved_.begin(), moved_.end(), 0);
+    }
+
+    void LightRegistry::ResizeBits_() {
+        const size_t words = (lights_.size() + 63) / 64;
+        if (changed_.size() < words) {
+            changed_.resize(words, 0);
+            moved_.resize(words, 0);
+        }
+    }
+
+    bool LightRegistry::ReadLight_(const size_t denseIndex, bool& moved) {
+        const Light& light = *lights_[denseIndex];
+        const glm::vec3& position = light.GetPosition();
+        const float radius = light.GetRadius();
+        const glm::vec3& color = light.GetColor();
+        const float intensity = light.GetIntensity();
+        const uint32_t flags = ComputeFlags(light);
+
+        moved = position != positions_[denseIndex] || radius != radii_[denseIndex];
+        const bool changed = moved || color != colors_[denseIndex] || intensity != intensities_[denseIndex] ||
+                             flags != flags_[denseIndex];
+
+        if (changed) {
+            positions_[denseIndex] = position;
+            radii_[denseIndex] = radius;
+            colors_[denseIndex] = color;
+            intensities_[denseIndex] = intensity;
+            flags_[denseIndex] = flags;
+        }
+
+        return changed;
+    }
+
+    void LightUpdateQueue::PushBack(const LightHandle& handle) {
+        Enqueue_(handle, false);
+    }
+
+    void LightUpdateQueue::PushFront(const LightHandle& handle) {
+        Enqueue_(handle, true);
+    }
+
+    LightHandle LightUpdateQueue::PopFront() {
+        while (!queue_.empty()) {
+            const Entry_ entry = queue_.front();
+            queue_.pop_front();
+            if (IsLive_(entry)) {
+                tickets_[entry.handle.index] = 0;
+                --size_;
+                return entry.handle;
+            }
+        }
+
+        return LightHandle::Null();
+    }
+
+    void LightUpdateQueue::Erase(const LightHandle& handle) {
+        if (!Contains(handle)) return;
+        tickets_[handle.index] = 0;
+        --size_;
+        CompactIfNeeded_();
+    }
+
+    void LightUpdateQueue::Clear() {
+        queue_.clear();
+        std::fill(tickets_.begin(), tickets_.end(), 0);
+        size_ = 0;
+    }
+
+    bool LightUpdateQueue::Contains(const LightHandle& handle) const {
+        return handle.index < tickets_.size() &&
+               tickets_[handle.index] != 0 &&
+               generations_[handle.index] == handle.generation;
+    }
+
+    bool LightUpdateQueue::IsLive_(const Entry_& entry) const {
+        return tickets_[entry.handle.index] == entry.ticket &&
+               generations_[entry.handle.index] == entry.handle.generation;
+    }
+
+    void LightUpdateQueue::Enqueue_(const LightHandle& handle, const bool front) {
+        if (!handle) return;
+
+        if (handle.index >= tickets_.size()) {
+            tickets_.resize(handle.index + 1, 0);
+            generations_.resize(handle.index + 1, 0);
+        }
+
+        if (Contains(handle)) {
+            if (!front) return;
+        }
+        // A queued entry from an older generation is replaced rather than added to
+        else if (tickets_[handle.index] == 0) {
+            ++size_;
+        }
+
+        // Ticket 0 is reserved for "not queued"
+        if (nextTicket_ == 0) ++nextTicket_;
+        const uint32_t ticket = nextTicket_++;
+        tickets_[handle.index] = ticket;
+        generations_[handle.index] = handle.generation;
+
+        if (front) queue_.push_front(Entry_{ handle, ticket });
+        else queue_.push_back(Entry_{ handle, ticket });
+
+        CompactIfNeeded_();
+    }
+
+    void LightUpdateQueue::CompactIfNeeded_() {
+        // Stale entries are normally skipped lazily by PopFront, but bound how many can pile up
+        if (queue_.size() <= 2 * size_ + 64) return;
+
+        std::deque<Entry_> live;
+        for (const Entry_& entry : queue_) {
+            if (IsLive_(entry)) live.push_back(entry);
+        }
+        queue_ = std::move(live);
+    }
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <limits>
+#include <cstdint>
+#include <unordered_map>
+
+namespace stratus {
+    class Light;
+    typedef std::shared_ptr<Light> LightPtr;
+
+    // Cached copies of the light's boolean state (see LightRegistry::Flags)
+    enum LightFlags : uint32_t {
+        LIGHT_FLAG_VIRTUAL       = 1 << 0,
+        LIGHT_FLAG_STATIC        = 1 << 1,
+        LIGHT_FLAG_CASTS_SHADOWS = 1 << 2,
+        // Virtual point lights only (see VirtualPointLight::SetBaked)
+        LIGHT_FLAG_BAKED         = 1 << 3
+    };
+
+    // Generation-checked reference to a slot in a LightRegistry. A handle becomes stale once its
+    // light is removed, even if the slot is later reused by another light.
+    struct LightHandle {
+        static constexpr uint32_t invalidIndex = std::numeric_limits<uint32_t>::max();
+
+        uint32_t index = invalidIndex;
+        uint32_t generation = 0;
+
+        static LightHandle Null() { return LightHandle(); }
+
+        bool operator==(const LightHandle& other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const LightHandle& other) const { return !(*this == other); }
+        explicit operator bool() const { return index != invalidIndex; }
+    };
+
+    // Slot map of lights. Light parameters are mirrored into dense arrays so that per-frame loops
+    // are linear over contiguous memory rather than walking hash buckets and shared_ptr control blocks.
+    //
+    // Dense indices are only stable until the next Add/Remove - use handles to refer to a light across frames.
+    //
+    // The dense arrays are also the renderer's snapshot of the lights: they only change on Add/Remove/
+    // SyncFromLights, so reading them is safe while the simulation moves the lights themselves.
+    class LightRegistry {
+    public:
+        LightRegistry() = default;
+
+        // Returns the existing handle if the light was already added
+        LightHandle Add(const LightPtr&);
+        bool Remove(const LightHandle&);
+        void Clear();
+
+        // Lookup by identity (hashes the raw pointer only)
+        LightHandle Find(const LightPtr&) const;
+        bool Contains(const LightPtr& light) const { return IsValid(Find(light)); }
+        bool IsValid(const LightHandle&) const;
+        // Returns nullptr for stale handles
+        LightPtr Get(const LightHandle&) const;
+
+        size_t Size() const { return lights_.size(); }
+        bool Empty() const { return lights_.empty(); }
+
+        // Dense arrays, all Size() elements long
+        const std::vector<LightPtr>& Lights() const { return lights_; }
+        const std::vector<glm::vec3>& Positions() const { return positions_; }
+        const std::vector<float>& Radii() const { return radii_; }
+        const std::vector<glm::vec3>& Colors() const { return colors_; }
+        const std::vector<float>& Intensities() const { return intensities_; }
+        const std::vector<uint32_t>& Flags() const { return flags_; }
+        LightHandle HandleAt(const size_t denseIndex) const;
+        // Returns Size() for stale handles
+        size_t DenseIndex(const LightHandle&) const;
+
+        // Re-reads every light's parameters into the dense arrays. Clears and then rebuilds the change
+        // bitsets. Returns the number of lights that changed in any way.
+        size_t SyncFromLights();
+
+        // Set by SyncFromLights (and Add) for lights whose position, radius, color, intensity or flags changed
+        bool Changed(const size_t denseIndex) const { return TestBit_(changed_, denseIndex); }
+        // Set by SyncFromLights (and Add) for lights whose position or radius changed, meaning
+        // their shadow maps are out of date
+        bool Moved(const size_t denseIndex) const { return TestBit_(moved_, denseIndex); }
+        void ClearChanged();
+
+        // Calls f(denseIndex) for every light with its Moved bit set
+        template<typename F>
+        void ForEachMoved(F&& f) const {
+            ForEachSetBit_(moved_, f);
+        }
+
+        template<typename F>
+        void ForEachChanged(F&& f) const {
+            ForEachSetBit_(changed_, f);
+        }
+
+    private:
+        struct Slot_ {
+            uint32_t generation = 1;
+            // Index into the dense arrays or next free slot when unoccupied
+            uint32_t denseOrNextFree = LightHandle::invalidIndex;
+            bool occupied = false;
+        };
+
+        static bool TestBit_(const std::vector<uint64_t>& bits, const size_t index) {
+            return (bits[index >> 6] >> (index & 63)) & 1;
+        }
+
+        static void SetBit_(std::vector<uint64_t>& bits, const size_t index, const bool value) {
+            const uint64_t mask = uint64_t(1) << (index & 63);
+            if (value) bits[index >> 6] |= mask;
+            else bits[index >> 6] &= ~mask;
+        }
+
+        template<typename F>
+        static void ForEachSetBit_(const std::vector<uint64_t>& bits, F& f) {
+            for (size_t word = 0; word < bits.size(); ++word) {
+                uint64_t value = bits[word];
+                while (value != 0) {
+                    const size_t bit = size_t(CountTrailingZeros_(value));
+                    f(word * 64 + bit);
+                    value &= value - 1;
+                }
+            }
+        }
+
+        static int CountTrailingZeros_(const uint64_t value);
+        void ResizeBits_();
+        // Returns true if anything changed
+        bool ReadLight_(const size_t denseIndex, bool& moved);
+
+    private:
+        std::vector<Slot_> slots_;
+        uint32_t freeList_ = LightHandle::invalidIndex;
+        std::unordered_map<const Light *, LightHandle> lookup_;
+
+        // Dense storage
+        std::vector<LightPtr> lights_;
+        std::vector<glm::vec3> positions_;
+        std::vector<float> radii_;
+        std::vector<glm::vec3> colors_;
+        std::vector<float> intensities_;
+        std::vector<uint32_t> flags_;
+        std::vector<uint32_t> denseToSlot_;
+        std::vector<uint64_t> changed_;
+        std::vector<uint64_t> moved_;
+    };
+
+    // Ordered set of lights waiting for a shadow map update. Each light is queued at most once.
+    // Backed by a deque of (handle, ticket) entries where re-queuing or erasing a light just bumps its
+    // ticket - stale entries are skipped when popped.
+    class LightUpdateQueue {
+    public:
+        // If a light is already in the queue it is not reordered since it would
+        // lose its better place in line
+        void PushBack(const LightHandle&);
+        // Moves the light to the front even if it is already queued
+        void PushFront(const LightHandle&);
+        // Returns a null handle if empty
+        LightHandle PopFront();
+        // In case a light needs to be removed without being updated
+        void Erase(const LightHandle&);
+        // In case all lights need to be removed without being updated
+        void Clear();
+
+        bool Contains(const LightHandle&) const;
+        size_t Size() const { return size_; }
+
+    private:
+        struct Entry_ {
+            LightHandle handle;
+            uint32_t ticket;
+        };
+
+        bool IsLive_(const Entry_&) const;
+        void Enqueue_(const LightHandle&, const bool front);
+        void CompactIfNeeded_();
+
+    private:
+        std::deque<Entry_> queue_;
+        // Per slot ticket of the live entry (0 = not queued)
+        std::vector<uint32_t> tickets_;
+        // Generation of the queued light per slot
+        std::vector<uint32_t> generations_;
+        uint32_t nextTicket_ = 1;
+        size_t size_ = 0;
+    };
+}
@@ -1,39 +1,649 @@
 #include "StratusLog.h"
 #include "StratusThread.h"
-#include "StratusUtils.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 namespace stratus {
-    static void EmbedLogData(const std::string & tagline, const std::string& function, const int line, std::ostream & out) {
-        auto& thread = Thread::Current();
-        out << tagline << " Thread::(" << thread.Name() << ") " << function << ":" << line << " -> ";
+    std::atomic<i32> Log::minLevel_(static_cast<i32>(LogLevel::LOG_INFO));
+
+    // Per thread, must be a power of 2
+    static constexpr u64 logQueueCapacity = 4096;
+    // Most distinct messages remembered for rate limiting
+    static constexpr usize maxRateLimitEntries = 4096;
+    // How long the writer sleeps when there is nothing to do (producers wake it sooner)
+    static constexpr auto writerIdleWait = std::chrono::milliseconds(5);
+
+    struct LogRecord_ {
+        LogLevel level = LogLevel::LOG_INFO;
+        const char * function = "";
+        i32 line = 0;
+        u64 timestampUs = 0;
+        std::string thread;
+        std::string message;
+    };
+
+    // Written by one thread and drained by whoever holds LogBackend_::drainMutex_. Records are
+    // reused so that once the strings have grown, queueing a message doesn't allocate.
+    struct LogQueue_ {
+        LogQueue_() : records(logQueueCapacity) {}
+
+        std::vector<LogRecord_> records;
+        alignas(64) std::atomic<u64> head{0};
+        alignas(64) std::atomic<u64> tail{0};
+        // Only written by the producer
+        std::atomic<u64> pushed{0};
+        std::atomic<u64> fullWaits{0};
+        // Set when the owning thread exits - the queue is dropped once it is empty
+        std::atomic<bool> closed{false};
+    };
+
+    static const char * LevelTag(const LogLevel level) {
+        switch (level) {
+        case LogLevel::LOG_WARN: return "[Warn]";
+        case LogLevel::LOG_ERROR: return "[Error]";
+        default: return "[Info]";
+        }
+    }
+
+    static const char * LevelName(const LogLevel level) {
+        switch (level) {
+        case LogLevel::LOG_WARN: return "warn";
+        case LogLevel::LOG_ERROR: return "error";
+        default: return "info";
+        }
+    }
+
+    static void CombineHash(usize& seed, const usize value) {
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    static void AppendJsonString(std::string& out, const std::string& value) {
+        out.push_back('"');
+        for (const char c : value) {
+            switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    out += escaped;
+                }
+                else {
+                    out.push_back(c);
+                }
+                break;
+            }
+        }
+        out.push_back('"');
+    }
+
+    class LogBackend_ {
+    public:
+        static LogBackend_& Instance() {
+            static LogBackend_ backend;
+            return backend;
+        }
+
+        ~LogBackend_() {
+            SetAsync(false);
+        }
+
+        std::shared_ptr<LogQueue_> Register() {
+            auto queue = std::make_shared<LogQueue_>();
+            std::lock_guard<std::mutex> lock(registryMutex_);
+            queues_.push_back(queue);
+            return queue;
+        }
+
+        void Push(LogQueue_& queue, const LogLevel level, const char * function, const i32 line,
+                  const std::string& thread, const std::string& message) {
+            const u64 tail = queue.tail.load(std::memory_order_relaxed);
+            if (tail - queue.head.load(std::memory_order_acquire) >= logQueueCapacity) {
+                queue.fullWaits.fetch_add(1, std::memory_order_relaxed);
+                while (tail - queue.head.load(std::memory_order_acquire) >= logQueueCapacity) {
+                    if (running_.load()) {
+                        WakeWriter_();
+                        std::this_thread::yield();
+                    }
+                    else {
+                        DrainAndFlush();
+                    }
+                }
+            }
+
+            LogRecord_& record = queue.records[tail & (logQueueCapacity - 1)];
+            record.level = level;
+            record.function = function;
+            record.line = line;
+            record.timestampUs = u64(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+            record.thread.assign(thread);
+            record.message.assign(message);
+            queue.pushed.fetch_add(1, std::memory_order_relaxed);
+            // Sequentially consistent together with the load of running_ below so that a message
+            // pushed while the writer stops is seen by SetAsync's final drain
+            queue.tail.store(tail + 1);
+
+            // Errors are written straight away in case the program is about to go down
+            if (!running_.load() || level == LogLevel::LOG_ERROR) {
+                DrainAndFlush();
+            }
+            else if (writerSleeping_.load(std::memory_order_relaxed)) {
+                WakeWriter_();
+            }
+        }
+
+        void DrainAndFlush() {
+            std::lock_guard<std::mutex> lock(drainMutex_);
+            Drain_();
+            ExpireRateLimits_(std::chrono::steady_clock::now(), false);
+            FlushSinks_();
+        }
+
+        void SetAsync(const bool async) {
+            std::lock_guard<std::mutex> lock(asyncMutex_);
+            if (async == running_.load()) return;
+
+            if (async) {
+                running_.store(true);
+                writer_ = std::thread([this]() { WriterLoop_(); });
+            }
+            else {
+                running_.store(false);
+                WakeWriter_();
+                writer_.join();
+                // Anything pushed while the writer was on its way out
+                std::lock_guard<std::mutex> drainLock(drainMutex_);
+                Drain_();
+                ExpireRateLimits_(std::chrono::steady_clock::now(), true);
+                FlushSinks_();
+            }
+        }
+
+        bool IsAsync() const {
+            return running_.load();
+        }
+
+        void SetSinks(const std::vector<std::shared_ptr<LogSink>>& sinks) {
+            std::lock_guard<std::mutex> lock(drainMutex_);
+            Drain_();
+            FlushSinks_();
+            sinks_ = sinks;
+        }
+
+        std::vector<std::shared_ptr<LogSink>> GetSinks() {
+            std::lock_guard<std::mutex> lock(drainMutex_);
+            return sinks_;
+        }
+
+        LogStats Stats() {
+            LogStats stats;
+            {
+                std::lock_guard<std::mutex> lock(registryMutex_);
+                stats.messages = retiredPushed_;
+                stats.queueFullWaits = retiredFullWaits_;
+                for (const auto& queue : queues_) {
+                    stats.messages += queue->pushed.load(std::memory_order_relaxed);
+                    stats.queueFullWaits += queue->fullWaits.load(std::memory_order_relaxed);
+                }
+            }
+            // Atomic so that reading them doesn't wait on a writer in the middle of I/O
+            stats.written = written_.load(std::memory_order_relaxed);
+            stats.suppressed = suppressed_.load(std::memory_order_relaxed);
+
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            stats.messages -= statsBase_.messages;
+            stats.written -= statsBase_.written;
+            stats.suppressed -= statsBase_.suppressed;
+            stats.queueFullWaits -= statsBase_.queueFullWaits;
+            return stats;
+        }
+
+        void ResetStats() {
+            const LogStats current = Stats();
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            statsBase_.messages += current.messages;
+            statsBase_.written += current.written;
+            statsBase_.suppressed += current.suppressed;
+            statsBase_.queueFullWaits += current.queueFullWaits;
+        }
+
+        std::atomic<i32> format{static_cast<i32>(LogFormat::TEXT)};
+        std::atomic<u32> maxRepeats{20};
+        std::atomic<f64> rateLimitWindowSeconds{1.0};
+
+    private:
+        struct RateLimit_ {
+            std::chrono::steady_clock::time_point windowStart;
+            u32 count = 0;
+            u64 suppressed = 0;
+            // First suppressed message, used for the summary
+            LogRecord_ record;
+        };
+
+        LogBackend_() {
+            sinks_.push_back(std::make_shared<ConsoleLogSink>());
+        }
+
+        void WakeWriter_() {
+            wake_.notify_one();
+        }
+
+        void WriterLoop_() {
+            while (running_.load()) {
+                usize drained = 0;
+                {
+                    std::lock_guard<std::mutex> lock(drainMutex_);
+                    drained = Drain_();
+                    ExpireRateLimits_(std::chrono::steady_clock::now(), false);
+                    if (drained > 0) FlushSinks_();
+                }
+
+                if (drained == 0) {
+                    std::unique_lock<std::mutex> lock(wakeMutex_);
+                    writerSleeping_.store(true);
+                    wake_.wait_for(lock, writerIdleWait);
+                    writerSleeping_.store(false);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(drainMutex_);
+            Drain_();
+            FlushSinks_();
+        }
+
+        // Requires drainMutex_
+        usize Drain_() {
+            {
+                std::lock_guard<std::mutex> lock(registryMutex_);
+                draining_ = queues_;
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            usize drained = 0;
+            bool removeClosed = false;
+            for (const auto& queue : draining_) {
+                // Check closed first - the owner can't push once it has set it
+                const bool closed = queue->closed.load();
+                u64 head = queue->head.load(std::memory_order_relaxed);
+                const u64 tail = queue->tail.load();
+                for (; head != tail; ++head) {
+                    Write_(queue->records[head & (logQueueCapacity - 1)], now);
+                    ++drained;
+                }
+                queue->head.store(head, std::memory_order_release);
+                removeClosed = removeClosed || closed;
+            }
+
+            draining_.clear();
+            if (removeClosed) RemoveClosedQueues_();
+            return drained;
+        }
+
+        void RemoveClosedQueues_() {
+            std::lock_guard<std::mutex> lock(registryMutex_);
+            for (auto it = queues_.begin(); it != queues_.end();) {
+                LogQueue_& queue = **it;
+                if (queue.closed.load() && queue.head.load() == queue.tail.load()) {
+                    retiredPushed_ += queue.pushed.load();
+                    retiredFullWaits_ += queue.fullWaits.load();
+                    it = queues_.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+
+        // Requires drainMutex_
+        void Write_(const LogRecord_& record, const std::chrono::steady_clock::time_point now) {
+            const u32 limit = maxRepeats.load(std::memory_order_relaxed);
+            if (limit > 0) {
+                usize key = std::hash<std::string>()(record.message);
+                CombineHash(key, std::hash<const void *>()(record.function));
+                CombineHash(key, std::hash<i32>()(record.line));
+
+                auto it = rateLimits_.find(key);
+                if (it == rateLimits_.end()) {
+                    if (rateLimits_.size() >= maxRateLimitEntries) {
+                        ExpireRateLimits_(now, false);
+                        // Still full of messages seen this window - forget the ones which don't need summaries
+                        if (rateLimits_.size() >= maxRateLimitEntries) {
+                            for (auto entry = rateLimits_.begin(); entry != rateLimits_.end();) {
+                                entry = entry->second.suppressed == 0 ? rateLimits_.erase(entry) : std::next(entry);
+                            }
+                        }
+                    }
+                    it = rateLimits_.emplace(key, RateLimit_()).first;
+                    it->second.windowStart = now;
+                }
+
+                RateLimit_& entry = it->second;
+                if (now - entry.windowStart >= RateLimitWindow_()) {
+                    WriteSummary_(entry);
+                    entry.windowStart = now;
+                    entry.count = 0;
+                }
+
+                if (++entry.count > limit) {
+                    if (entry.suppressed == 0) entry.record = record;
+                    ++entry.suppressed;
+                    suppressed_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            WriteLine_(record, record.message);
+        }
+
+        std::chrono::steady_clock::duration RateLimitWindow_() const {
+            return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<f64>(rateLimitWindowSeconds.load(std::memory_order_relaxed)));
+        }
+
+        // Requires drainMutex_. Drops entries whose window has ended (all of them if force is set),
+        // writing summaries for anything they suppressed.
+        void ExpireRateLimits_(const std::chrono::steady_clock::time_point now, const bool force) {
+            if (rateLimits_.empty()) return;
+            if (!force && now < nextRateLimitScan_) return;
+
+            const auto window = RateLimitWindow_();
+            nextRateLimitScan_ = now + window / 2;
+            for (auto it = rateLimits_.begin(); it != rateLimits_.end();) {
+                if (force || now - it->second.windowStart >= window) {
+                    WriteSummary_(it->second);
+                    it = rateLimits_.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+
+        void WriteSummary_(RateLimit_& entry) {
+            if (entry.suppressed == 0) return;
+            WriteLine_(entry.record, entry.record.message + " (repeated " + std::to_string(entry.suppressed) + " more times)");
+            entry.suppressed = 0;
+        }
+
+        void WriteLine_(const LogRecord_& record, const std::string& message) {
+            line_.clear();
+            if (static_cast<LogFormat>(format.load(std::memory_order_relaxed)) == LogFormat::JSON_LINES) {
+                line_ += "{\"ts\":";
+                line_ += std::to_string(record.timestampUs);
+                line_ += ",\"level\":\"";
+                line_ += LevelName(record.level);
+                line_ += "\",\"thread\":";
+                AppendJsonString(line_, record.thread);
+                line_ += ",\"function\":";
+                AppendJsonString(line_, record.function);
+                line_ += ",\"line\":";
+                line_ += std::to_string(record.line);
+                line_ += ",\"message\":";
+                AppendJsonString(line_, message);
+                line_ += "}\n";
+            }
+            else {
+                line_ += LevelTag(record.level);
+                line_ += " Thread::(";
+                line_ += record.thread;
+                line_ += ") ";
+                line_ += record.function;
+                line_ += ":";
+                line_ += std::to_string(record.line);
+                line_ += " -> ";
+                line_ += message;
+                line_ += "\n";
+            }
+
+            for (const auto& sink : sinks_) {
+                sink->Write(record.level, line_);
+            }
+            written_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void FlushSinks_() {
+            for (const auto& sink : sinks_) {
+                sink->Flush();
+            }
+        }
+
+    private:
+        std::mutex registryMutex_;
+        std::vector<std::shared_ptr<LogQueue_>> queues_;
+        // Totals from queues which have been removed
+        u64 retiredPushed_ = 0;
+        u64 retiredFullWaits_ = 0;
+
+        // Held by whoever is draining - the writer, or a logging thread when there is no writer
+        std::mutex drainMutex_;
+        std::vector<std::shared_ptr<LogQueue_>> draining_;
+        std::vector<std::shared_ptr<LogSink>> sinks_;
+        std::unordered_map<usize, RateLimit_> rateLimits_;
+        std::chrono::steady_clock::time_point nextRateLimitScan_;
+        std::string line_;
+        std::atomic<u64> written_{0};
+        std::atomic<u64> suppressed_{0};
+
+        std::mutex statsMutex_;
+        LogStats statsBase_;
+
+        std::mutex asyncMutex_;
+        std::thread writer_;
+        std::atomic<bool> running_{false};
+        std::mutex wakeMutex_;
+        std::condition_variable wake_;
+        std::atomic<bool> writerSleeping_{false};
+    };
+
+    // Collects what a thread writes to the stream until the message is finished
+    class ThreadLog_ : private std::streambuf {
+    public:
+        ThreadLog_()
+            : stream_(this), queue_(LogBackend_::Instance().Register()) {
+            static std::atomic<u64> nextId(1);
+            unnamed_ = "Unnamed#" + std::to_string(nextId.fetch_add(1));
+            defaultFlags_ = stream_.flags();
+            defaultPrecision_ = stream_.precision();
+        }
+
+        ~ThreadLog_() {
+            Commit();
+            queue_->closed.store(true);
+        }
+
+        std::ostream& Begin(const LogLevel level, const char * function, const i32 line) {
+            Commit();
+            // Formatting changes (std::boolalpha, std::setprecision, ...) only last for one message
+            stream_.clear();
+            stream_.flags(defaultFlags_);
+            stream_.precision(defaultPrecision_);
+            stream_.width(0);
+            stream_.fill(' ');
+            pending_ = true;
+            level_ = level;
+            function_ = function;
+            line_ = line;
+            return stream_;
+        }
+
+        void Commit() {
+            if (!pending_) return;
+            pending_ = false;
+
+            while (!text_.empty() && text_.back() == '\n') text_.pop_back();
+
+            // Thread::Current throws for threads it doesn't know about, and looking the name up
+            // again is only needed when the Thread changes
+            Thread * thread = Thread::TryCurrent();
+            if (thread != thread_ || threadName_.empty()) {
+                thread_ = thread;
+                threadName_ = thread != nullptr ? thread->Name() : unnamed_;
+            }
+
+            LogBackend_::Instance().Push(*queue_, level_, function_, line_, threadName_, text_);
+            text_.clear();
+        }
+
+    private:
+        int_type overflow(int_type c) override {
+            if (!traits_type::eq_int_type(c, traits_type::eof())) text_.push_back(traits_type::to_char_type(c));
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char * s, std::streamsize count) override {
+            text_.append(s, usize(count));
+            return count;
+        }
+
+        // std::endl and std::flush end the message
+        int sync() override {
+            Commit();
+            return 0;
+        }
+
+    private:
+        std::ostream stream_;
+        std::shared_ptr<LogQueue_> queue_;
+        std::string text_;
+        bool pending_ = false;
+        LogLevel level_ = LogLevel::LOG_INFO;
+        const char * function_ = "";
+        i32 line_ = 0;
+        Thread * thread_ = nullptr;
+        std::string threadName_;
+        std::string unnamed_;
+        std::ios_base::fmtflags defaultFlags_;
+        std::streamsize defaultPrecision_;
+    };
+
+    static ThreadLog_& GetThreadLog() {
+        static thread_local ThreadLog_ log;
+        return log;
+    }
+
+    void ConsoleLogSink::Write(const LogLevel level, const std::string& line) {
+        std::ostream& out = level == LogLevel::LOG_ERROR ? std::cerr : std::cout;
+        out.write(line.data(), std::streamsize(line.size()));
+    }
+
+    void ConsoleLogSink::Flush() {
+        std::cout.flush();
+        std::cerr.flush();
+    }
+
+    FileLogSink::FileLogSink(const std::string& filename, const bool append)
+        : file_(std::fopen(filename.c_str(), append ? "ab" : "wb")) {
+        if (file_ == nullptr) throw std::runtime_error("Unable to open log file " + filename);
+    }
+
+    FileLogSink::~FileLogSink() {
+        std::fclose(file_);
+    }
+
+    void FileLogSink::Write(const LogLevel, const std::string& line) {
+        std::fwrite(line.data(), 1, line.size(), file_);
+    }
+
+    void FileLogSink::Flush() {
+        std::fflush(file_);
     }
 
     Log::Log() {}
 
-    std::ostream& Log::Inform(const std::string & function, const int line) const {
-        EmbedLogData("[Info]", function, line, std::cout);
-        return std::cout;
+    std::ostream& Log::Stream(const LogLevel level, const char * function, const int line) {
+        return GetThreadLog().Begin(level, function, line);
+    }
+
+    void Log::SetLevel(const LogLevel level) {
+        minLevel_.store(static_cast<i32>(level));
+    }
+
+    LogLevel Log::GetLevel() {
+        return static_cast<LogLevel>(minLevel_.load());
+    }
+
+    void Log::SetFormat(const LogFormat format) {
+        LogBackend_::Instance().format.store(static_cast<i32>(format));
+    }
+
+    LogFormat Log::GetFormat() {
+        return static_cast<LogFormat>(LogBackend_::Instance().format.load());
+    }
+
+    void Log::SetRateLimit(const u32 maxRepeats, const f64 windowSeconds) {
+        LogBackend_& backend = LogBackend_::Instance();
+        backend.maxRepeats.store(maxRepeats);
+        backend.rateLimitWindowSeconds.store(windowSeconds);
     }
 
-    std::ostream& Log::Warn(const std::string & function, const int line) const {
-        EmbedLogData("[Warn]", function, line, std::cout);
-        return std::cout;
+    void Log::SetSinks(const std::vector<std::shared_ptr<LogSink>>& sinks) {
+        LogBackend_::Instance().SetSinks(sinks);
     }
 
-    std::ostream& Log::Error(const std::string & function, const int line) const {
-        EmbedLogData("[Error]", function, line, std::cerr);
-        return std::cerr;
+    std::vector<std::shared_ptr<LogSink>> Log::GetSinks() {
+        return LogBackend_::Instance().GetSinks();
+    }
+
+    void Log::SetAsync(const bool async) {
+        LogBackend_::Instance().SetAsync(async);
+    }
+
+    bool Log::IsAsync() {
+        return LogBackend_::Instance().IsAsync();
+    }
+
+    void Log::Flush() {
+        GetThreadLog().Commit();
+        LogBackend_::Instance().DrainAndFlush();
+    }
+
+    LogStats Log::Stats() {
+        return LogBackend_::Instance().Stats();
+    }
+
+    void Log::ResetStats() {
+        LogBackend_::Instance().ResetStats();
     }
 
     bool Log::Initialize() {
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        messagesMetric_ = metrics.RegisterCounter("Log.messages", "Messages logged");
+        writtenMetric_ = metrics.RegisterCounter("Log.written", "Messages written to the sinks");
+        suppressedMetric_ = metrics.RegisterCounter("Log.suppressed", "Messages dropped by rate limiting");
+        queueFullWaitsMetric_ = metrics.RegisterCounter("Log.queueFullWaits", "Times a thread waited on the writer");
+        lastStats_ = Stats();
+
+        SetAsync(true);
         return true;
     }
 
     SystemStatus Log::Update(const double) {
+        const LogStats stats = Stats();
+        // ResetStats can make the totals go backwards
+        const auto increment = [](const MetricId id, const u64 current, const u64 last) {
+            if (current > last) MetricsRegistry::Instance().Increment(id, i64(current - last));
+        };
+        increment(messagesMetric_, stats.messages, lastStats_.messages);
+        increment(writtenMetric_, stats.written, lastStats_.written);
+        increment(suppressedMetric_, stats.suppressed, lastStats_.suppressed);
+        increment(queueFullWaitsMetric_, stats.queueFullWaits, lastStats_.queueFullWaits);
+        lastStats_ = stats;
+
         return SystemStatus::SYSTEM_CONTINUE;
     }
 
     void Log::Shutdown() {
-        
+        SetAsync(false);
     }
-}
\ No newline at end of file
+}
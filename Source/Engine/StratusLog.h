@@ -1,15 +1,106 @@
 #pragma once
 
+#include <atomic>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "StratusMetrics.h"
 #include "StratusSystemModule.h"
+#include "StratusTypes.h"
+
+// Messages below this level are compiled out entirely (0 = info, 1 = warnings, 2 = errors, 3 = nothing)
+#ifndef STRATUS_LOG_MIN_LEVEL
+#define STRATUS_LOG_MIN_LEVEL 0
+#endif
 
 // Usage example:
 //      STRATUS_LOG << "Initializing system" << std::endl;
-#define STRATUS_LOG stratus::Log::Instance()->Inform(__FUNCTION__, __LINE__)
-#define STRATUS_WARN stratus::Log::Instance()->Warn(__FUNCTION__, __LINE__)
-#define STRATUS_ERROR stratus::Log::Instance()->Error(__FUNCTION__, __LINE__)
+//
+// A message ends at std::endl (or std::flush), or when the same thread starts the next one. When the
+// level is filtered out, either at compile time or through Log::SetLevel, nothing after the macro
+// is evaluated. The whole statement is an expression (<< binds tighter than &) so it is safe to use
+// as the body of an if without braces.
+#define STRATUS_LOG_AT_(level)                                                                         \
+    (static_cast<int>(level) < STRATUS_LOG_MIN_LEVEL || !::stratus::Log::IsEnabled(level)) ? (void)0 : \
+    ::stratus::LogVoidify_() & ::stratus::Log::Stream(level, __FUNCTION__, __LINE__)
+
+#define STRATUS_LOG STRATUS_LOG_AT_(::stratus::LogLevel::LOG_INFO)
+#define STRATUS_WARN STRATUS_LOG_AT_(::stratus::LogLevel::LOG_WARN)
+#define STRATUS_ERROR STRATUS_LOG_AT_(::stratus::LogLevel::LOG_ERROR)
 
 namespace stratus {
+    enum class LogLevel : i32 {
+        LOG_INFO = 0,
+        LOG_WARN = 1,
+        LOG_ERROR = 2,
+        // Only valid for Log::SetLevel - disables everything
+        LOG_NONE = 3
+    };
+
+    // Turns the stream expression after STRATUS_LOG_AT_ into void to match the other side of the ?:
+    struct LogVoidify_ {
+        void operator&(std::ostream&) const {}
+    };
+
+    enum class LogFormat : i32 {
+        // [Info] Thread::(Renderer) Function:12 -> message
+        TEXT,
+        // One JSON object per line with ts (microseconds since the epoch), level, thread, function,
+        // line and message fields
+        JSON_LINES
+    };
+
+    // Receives formatted lines (including the trailing newline). Only ever called by one thread at a time.
+    struct LogSink {
+        virtual ~LogSink() = default;
+
+        virtual void Write(const LogLevel level, const std::string& line) = 0;
+        // Called after each batch of lines
+        virtual void Flush() = 0;
+    };
+
+    // Errors go to std::cerr, everything else to std::cout
+    struct ConsoleLogSink : public LogSink {
+        virtual ~ConsoleLogSink() = default;
+
+        void Write(const LogLevel level, const std::string& line) override;
+        void Flush() override;
+    };
+
+    struct FileLogSink : public LogSink {
+        // Throws std::runtime_error if the file can't be opened
+        FileLogSink(const std::string& filename, const bool append = false);
+        virtual ~FileLogSink();
+
+        FileLogSink(const FileLogSink&) = delete;
+        FileLogSink& operator=(const FileLogSink&) = delete;
+
+        void Write(const LogLevel level, const std::string& line) override;
+        void Flush() override;
+
+    private:
+        FILE * file_;
+    };
+
+    struct LogStats {
+        // Messages handed to the log
+        u64 messages = 0;
+        // Messages which made it to the sinks
+        u64 written = 0;
+        // Messages dropped by rate limiting
+        u64 suppressed = 0;
+        // Times a thread found its queue full and had to wait for the writer
+        u64 queueFullWaits = 0;
+    };
+
+    // Each thread formats its messages into its own lock-free queue and a background writer drains
+    // the queues into the sinks, so logging never blocks on I/O unless a queue fills up. Errors are
+    // written out before the logging call returns in case the program is about to go down.
+    //
+    // Everything is static so that logging works before the engine starts and after it stops - the
+    // module only starts and stops the writer. Without the writer each message is written by the
+    // thread which logged it.
     SYSTEM_MODULE_CLASS(Log)
         ~Log() = default;
 
@@ -18,15 +109,46 @@ namespace stratus {
         Log& operator=(const Log&) = delete;
         Log& operator=(Log&&) = delete;
 
-        // Main logging functions
-        std::ostream& Inform(const std::string & function, const int line) const;
-        std::ostream& Warn(const std::string & function, const int line) const;
-        std::ostream& Error(const std::string & function, const int line) const;
+        static bool IsEnabled(const LogLevel level) {
+            return static_cast<i32>(level) >= minLevel_.load(std::memory_order_relaxed);
+        }
+
+        // Starts a new message for the calling thread. Use the macros instead of calling this directly.
+        static std::ostream& Stream(const LogLevel level, const char * function, const int line);
+
+        static void SetLevel(const LogLevel level);
+        static LogLevel GetLevel();
+        static void SetFormat(const LogFormat format);
+        static LogFormat GetFormat();
+        // Identical messages from the same call site beyond maxRepeats within a window are dropped and
+        // summarized once the window ends. A maxRepeats of 0 disables rate limiting.
+        static void SetRateLimit(const u32 maxRepeats, const f64 windowSeconds);
+        // Defaults to a single ConsoleLogSink
+        static void SetSinks(const std::vector<std::shared_ptr<LogSink>>& sinks);
+        static std::vector<std::shared_ptr<LogSink>> GetSinks();
+
+        // Starts or stops the background writer. Stopping writes out everything still queued.
+        static void SetAsync(const bool async);
+        static bool IsAsync();
+        // Blocks until everything logged before the call has been written
+        static void Flush();
+
+        static LogStats Stats();
+        static void ResetStats();
 
     private:
-        // SystemModule inteface     
+        // SystemModule inteface
         virtual bool Initialize();
         virtual SystemStatus Update(const double);
         virtual void Shutdown();
+
+    private:
+        static std::atomic<i32> minLevel_;
+        // Stats() as of the last Update, used to turn the totals into counter increments
+        LogStats lastStats_;
+        MetricId messagesMetric_;
+        MetricId writtenMetric_;
+        MetricId suppressedMetric_;
+        MetricId queueFullWaitsMetric_;
     };
-}
\ No newline at end of file
+}
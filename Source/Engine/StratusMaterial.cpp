@@ -3,13 +3,20 @@
 
 namespace stratus {
     Material::Material(const std::string& name, bool registerSelf)
-        : name_(name), registerSelf_(registerSelf) {}
+        : name_(name), registerSelf_(registerSelf) {
+        handle_ = MaterialRegistry::Instance().Register(this);
+    }
 
-    Material::~Material() {}
+    Material::~Material() {
+        MaterialRegistry::Instance().Unregister(handle_);
+    }
 
     void Material::MarkChanged() {
-        auto ul = LockWrite_();
-        lastFrameChanged_ = INSTANCE(Engine)->FrameCount();
+        {
+            auto ul = LockWrite_();
+            lastFrameChanged_ = INSTANCE(Engine)->FrameCount();
+        }
+        MaterialRegistry::Instance().MarkChanged(handle_);
     }
 
     bool Material::ChangedWithinLastFrame() {
@@ -209,6 +216,15 @@ namespace stratus {
         return nullptr;
     }
 
+    MaterialPtr MaterialManager::GetMaterial(const MaterialHandle& handle) const {
+        MaterialPtr material;
+        // Expired if the material is in the middle of being destroyed
+        MaterialRegistry::Instance().With(handle, [&material](Material * m) {
+            material = m->weak_from_this().lock();
+        });
+        return material;
+    }
+
     MaterialPtr MaterialManager::GetOrCreateMaterial(const std::string& name) {
         auto mat = GetMaterial(name);
         if (mat) return mat;
@@ -241,10 +257,12 @@ namespace stratus {
     }
 
     bool MaterialManager::Initialize() {
+        materialsMetric_ = MetricsRegistry::Instance().RegisterGauge("MaterialManager.materials", "Named materials in the cache");
         return true;
     }
 
     SystemStatus MaterialManager::Update(const double) {
+        MetricsRegistry::Instance().SetGauge(materialsMetric_, f64(materials_.Size()));
         return SystemStatus::SYSTEM_CONTINUE;
     }
 
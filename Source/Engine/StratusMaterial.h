@@ -3,11 +3,13 @@
 #include "StratusCommon.h"
 #include "StratusTexture.h"
 #include "StratusConcurrentHashMap.h"
+#include "StratusMaterialRegistry.h"
 #include <vector>
 #include <shared_mutex>
 #include <string>
 #include <memory>
 #include "StratusLog.h"
+#include "StratusMetrics.h"
 #include "StratusSystemModule.h"
 
 namespace stratus {
@@ -36,6 +38,8 @@ namespace stratus {
         // New name must be unique
         void SetName(const std::string&);
         std::string GetName() const;
+        // Dense index into MaterialRegistry::Instance(), valid for the lifetime of the material
+        MaterialHandle GetHandle() const { return handle_; }
 
         // Creates an un-named sub material (only parent is registered with MaterialManager)
         MaterialPtr CreateSubMaterial();
@@ -76,6 +80,7 @@ namespace stratus {
         // Things like GLTF 2.0 permit a combined metallic-roughness map
         void SetMetallicRoughnessMap(TextureHandle);
 
+        // Also flags the material in MaterialRegistry so renderers can pick up the change
         void MarkChanged();
         bool ChangedWithinLastFrame();
 
@@ -93,6 +98,7 @@ namespace stratus {
     private:
         //mutable std::shared_mutex _mutex;
         std::string name_;
+        MaterialHandle handle_;
         // Register self with material manager
         bool registerSelf_;
         uint64_t lastFrameChanged_ = 0;
@@ -127,6 +133,8 @@ namespace stratus {
         // is dropped the material will go out of scope
         void ReleaseMaterial(const std::string& name);
         MaterialPtr GetMaterial(const std::string& name) const;
+        // Works for every live material including defaults and sub materials. Returns nullptr for stale handles.
+        MaterialPtr GetMaterial(const MaterialHandle&) const;
         MaterialPtr GetOrCreateMaterial(const std::string& name);
         bool ContainsMaterial(const std::string& name) const;
         std::vector<MaterialPtr> GetAllMaterials() const;
@@ -143,5 +151,6 @@ namespace stratus {
 
     private:
         ConcurrentHashMap<std::string, MaterialPtr> materials_;
+        MetricId materialsMetric_;
     };
 }
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "StratusMaterialRegistry.h"
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace stratus {
+    static int CountTrailingZeros(const u64 value) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return int(index);
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    // Appends the index of every set bit in ascending order and clears the bits
+    static void TakeSetBits(std::vector<u64>& bits, std::vector<u32>& out) {
+        for (usize word = 0; word < bits.size(); ++word) {
+            u64 value = bits[word];
+            while (value != 0) {
+                out.push_back(u32(word * 64 + usize(CountTrailingZeros(value))));
+                value &= value - 1;
+            }
+            bits[word] = 0;
+        }
+    }
+
+    MaterialHandle MaterialRegistry::Register(Material * material) {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        u32 index;
+        if (freeList_ != MaterialHandle::invalidIndex) {
+            index = freeList_;
+            freeList_ = slots_[index].nextFree;
+        }
+        else {
+            index = u32(slots_.size());
+            slots_.push_back(Slot_());
+            changed_.resize((slots_.size() + 63) / 64, 0);
+        }
+
+        Slot_& slot = slots_[index];
+        slot.material = material;
+        slot.nextFree = MaterialHandle::invalidIndex;
+        ++size_;
+
+        MaterialHandle handle;
+        handle.index = index;
+        handle.generation = slot.generation;
+        return handle;
+    }
+
+    void MaterialRegistry::Unregister(const MaterialHandle& handle) {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        if (!IsValid_(handle)) return;
+
+        Slot_& slot = slots_[handle.index];
+        slot.material = nullptr;
+        // Invalidates outstanding handles
+        ++slot.generation;
+        slot.nextFree = freeList_;
+        freeList_ = handle.index;
+        --size_;
+        changed_[handle.index >> 6] &= ~(u64(1) << (handle.index & 63));
+    }
+
+    bool MaterialRegistry::IsValid_(const MaterialHandle& handle) const {
+        return handle.index < slots_.size() &&
+            slots_[handle.index].material != nullptr &&
+            slots_[handle.index].generation == handle.generation;
+    }
+
+    bool MaterialRegistry::IsValid(const MaterialHandle& handle) const {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        return IsValid_(handle);
+    }
+
+    u32 MaterialRegistry::Capacity() const {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        return u32(slots_.size());
+    }
+
+    u32 MaterialRegistry::Size() const {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        return size_;
+    }
+
+    void MaterialRegistry::MarkChanged(const MaterialHandle& handle) {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        if (!IsValid_(handle)) return;
+        changed_[handle.index >> 6] |= u64(1) << (handle.index & 63);
+    }
+
+    std::vector<u32> MaterialRegistry::TakeChanged() {
+        std::vector<u32> changed;
+        auto ul = std::unique_lock<std::mutex>(m_);
+        TakeSetBits(changed_, changed);
+        return changed;
+    }
+
+    MaterialRegistry& MaterialRegistry::Instance() {
+        // Never destroyed since materials can outlive every engine module
+        static MaterialRegistry * registry = new MaterialRegistry();
+        return *registry;
+    }
+
+    void MaterialChangeTracker::Resize_(const u32 index) {
+        if (index < textures_.size()) return;
+        textures_.resize(usize(index) + 1);
+        const usize words = (textures_.size() + 63) / 64;
+        tracked_.resize(words, 0);
+        dirty_.resize(words, 0);
+    }
+
+    void MaterialChangeTracker::AddUsers_(const u32 index) {
+        for (const TextureHandle texture : textures_[index]) {
+            if (texture == TextureHandle::Null()) continue;
+            users_[texture].push_back(index);
+        }
+    }
+
+    void MaterialChangeTracker::RemoveUsers_(const u32 index) {
+        for (const TextureHandle texture : textures_[index]) {
+            if (texture == TextureHandle::Null()) continue;
+            auto it = users_.find(texture);
+            if (it == users_.end()) continue;
+
+            std::vector<u32>& users = it->second;
+            auto user = std::find(users.begin(), users.end(), index);
+            if (user != users.end()) {
+                *user = users.back();
+                users.pop_back();
+            }
+            if (users.size() == 0) users_.erase(it);
+        }
+    }
+
+    void MaterialChangeTracker::Track(const u32 index, const TextureList& textures) {
+        Resize_(index);
+        if (IsTracked(index)) {
+            RemoveUsers_(index);
+        }
+        else {
+            SetBit_(tracked_, index, true);
+            ++numTracked_;
+        }
+
+        textures_[index] = textures;
+        AddUsers_(index);
+        MarkDirty(index);
+    }
+
+    void MaterialChangeTracker::Untrack(const u32 index) {
+        if (!IsTracked(index)) return;
+
+        RemoveUsers_(index);
+        textures_[index] = TextureList();
+        if (IsDirty(index)) {
+            SetBit_(dirty_, index, false);
+            --numDirty_;
+        }
+        SetBit_(tracked_, index, false);
+        --numTracked_;
+    }
+
+    bool MaterialChangeTracker::IsTracked(const u32 index) const {
+        return TestBit_(tracked_, index);
+    }
+
+    const MaterialChangeTracker::TextureList& MaterialChangeTracker::Textures(const u32 index) const {
+        static const TextureList null;
+        return IsTracked(index) ? textures_[index] : null;
+    }
+
+    void MaterialChangeTracker::MarkDirty(const u32 index) {
+        if (!IsTracked(index) || IsDirty(index)) return;
+        SetBit_(dirty_, index, true);
+        ++numDirty_;
+    }
+
+    void MaterialChangeTracker::TexturesChanged(const std::unordered_set<TextureHandle>& textures) {
+        for (const TextureHandle texture : textures) {
+            auto it = users_.find(texture);
+            if (it == users_.end()) continue;
+            for (const u32 index : it->second) MarkDirty(index);
+        }
+    }
+
+    bool MaterialChangeTracker::IsDirty(const u32 index) const {
+        return TestBit_(dirty_, index);
+    }
+
+    std::vector<u32> MaterialChangeTracker::TakeDirty() {
+        std::vector<u32> dirty;
+        dirty.reserve(numDirty_);
+        TakeSetBits(dirty_, dirty);
+        numDirty_ = 0;
+        return dirty;
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "StratusTexture.h"
+#include "StratusTypes.h"
+#include <array>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace stratus {
+    class Material;
+
+    // Generation-checked reference to a slot in the MaterialRegistry. A handle becomes stale once its
+    // material is destroyed, even if the slot is later reused by another material.
+    struct MaterialHandle {
+        static constexpr u32 invalidIndex = std::numeric_limits<u32>::max();
+
+        u32 index = invalidIndex;
+        u32 generation = 0;
+
+        static MaterialHandle Null() { return MaterialHandle(); }
+
+        bool operator==(const MaterialHandle& other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const MaterialHandle& other) const { return !(*this == other); }
+        explicit operator bool() const { return index != invalidIndex; }
+    };
+
+    // Slot map of every live material. Freed slots are reused first so indices stay small enough to
+    // size flat arrays and bitsets by Capacity() instead of hashing materials by pointer or name.
+    //
+    // Thread safe since materials are created on loader threads.
+    class MaterialRegistry {
+    public:
+        MaterialRegistry() = default;
+
+        MaterialHandle Register(Material *);
+        // Also clears the changed bit so a reused slot does not start out changed
+        void Unregister(const MaterialHandle&);
+
+        bool IsValid(const MaterialHandle&) const;
+        // Calls f(Material *) with the registry locked so the material can not finish being destroyed
+        // while f runs. Returns false for stale handles.
+        template<typename F>
+        bool With(const MaterialHandle& handle, F&& f) const {
+            auto ul = std::unique_lock<std::mutex>(m_);
+            if (!IsValid_(handle)) return false;
+            f(slots_[handle.index].material);
+            return true;
+        }
+
+        // Upper bound (exclusive) on the index of any live handle
+        u32 Capacity() const;
+        u32 Size() const;
+
+        // Called by materials whenever a property or texture changes
+        void MarkChanged(const MaterialHandle&);
+        // Returns the indices of materials which changed since the last call, in ascending order. Meant for a
+        // single consumer (the renderer's material buffer).
+        std::vector<u32> TakeChanged();
+
+        // Shared by every material
+        static MaterialRegistry& Instance();
+
+    private:
+        struct Slot_ {
+            Material * material = nullptr;
+            u32 generation = 1;
+            u32 nextFree = MaterialHandle::invalidIndex;
+        };
+
+        bool IsValid_(const MaterialHandle&) const;
+
+    private:
+        mutable std::mutex m_;
+        std::vector<Slot_> slots_;
+        u32 freeList_ = MaterialHandle::invalidIndex;
+        u32 size_ = 0;
+        std::vector<u64> changed_;
+    };
+
+    // Decides which materials need their GPU copy rebuilt. Every tracked material records the textures it
+    // references so a texture finishing (or changing which levels are resident) only dirties the materials
+    // which use it rather than every material that was still waiting on something.
+    //
+    // Indexed by MaterialHandle::index. Not thread safe.
+    class MaterialChangeTracker {
+    public:
+        static constexpr usize TEXTURES_PER_MATERIAL = 6;
+        typedef std::array<TextureHandle, TEXTURES_PER_MATERIAL> TextureList;
+
+        // Starts tracking with the dirty bit set. If already tracked this replaces the texture list.
+        void Track(const u32 index, const TextureList& textures);
+        void Untrack(const u32 index);
+        bool IsTracked(const u32 index) const;
+        // Returns the null list for untracked materials
+        const TextureList& Textures(const u32 index) const;
+
+        // Ignored for untracked materials
+        void MarkDirty(const u32 index);
+        // Marks every tracked material which references one of the textures
+        void TexturesChanged(const std::unordered_set<TextureHandle>&);
+        bool IsDirty(const u32 index) const;
+        usize NumDirty() const { return numDirty_; }
+        usize NumTracked() const { return numTracked_; }
+
+        // Returns the dirty materials in ascending order and clears them
+        std::vector<u32> TakeDirty();
+
+    private:
+        static bool TestBit_(const std::vector<u64>& bits, const usize index) {
+            return index < (bits.size() << 6) && ((bits[index >> 6] >> (index & 63)) & 1);
+        }
+
+        static void SetBit_(std::vector<u64>& bits, const usize index, const bool value) {
+            const u64 mask = u64(1) << (index & 63);
+            if (value) bits[index >> 6] |= mask;
+            else bits[index >> 6] &= ~mask;
+        }
+
+        void Resize_(const u32 index);
+        void AddUsers_(const u32 index);
+        void RemoveUsers_(const u32 index);
+
+    private:
+        std::vector<TextureList> textures_;
+        std::vector<u64> tracked_;
+        std::vector<u64> dirty_;
+        // Texture -> tracked materials referencing it (once per slot that uses it)
+        std::unordered_map<TextureHandle, std::vector<u32>> users_;
+        usize numDirty_ = 0;
+        usize numTracked_ = 0;
+    };
+}
@@ -0,0 +1,382 @@
+#include "StratusMetrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace stratus {
+    static const char * MetricTypeName(const MetricType type) {
+        switch (type) {
+        case MetricType::GAUGE: return "gauge";
+        case MetricType::HISTOGRAM: return "histogram";
+        default: return "counter";
+        }
+    }
+
+    // Metric names are expected to be plain identifiers but escape the basics anyway
+    static void WriteJsonString(std::ostream& out, const std::string& value) {
+        out << '"';
+        for (const char c : value) {
+            if (c == '"' || c == '\\') out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+            else out << c;
+        }
+        out << '"';
+    }
+
+    // JSON has no inf/nan
+    static void WriteJsonNumber(std::ostream& out, const f64 value) {
+        if (std::isfinite(value)) out << value;
+        else out << 0;
+    }
+
+    // Only the owning thread writes to a shard so there is no need for an atomic read-modify-write
+    template<typename T>
+    static void AddRelaxed(std::atomic<T>& value, const T amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    f64 HistogramSnapshot::Percentile(const f64 p) const {
+        if (count == 0) return 0.0;
+
+        const f64 target = std::min(std::max(p, 0.0), 1.0) * f64(count);
+        u64 seen = 0;
+        for (usize i = 0; i < counts.size(); ++i) {
+            if (counts[i] == 0) continue;
+            if (f64(seen + counts[i]) >= target) {
+                // Clamp the bucket to what was actually recorded so the ends stay accurate
+                const f64 lower = std::max(i == 0 ? min : bounds[i - 1], min);
+                const f64 upper = std::min(i < bounds.size() ? bounds[i] : max, max);
+                const f64 t = (target - f64(seen)) / f64(counts[i]);
+                return lower + (upper - lower) * t;
+            }
+            seen += counts[i];
+        }
+        return max;
+    }
+
+    const MetricSnapshot * MetricsSnapshot::Find(const std::string& name) const {
+        for (const MetricSnapshot& metric : metrics) {
+            if (metric.name == name) return &metric;
+        }
+        return nullptr;
+    }
+
+    void MetricsSnapshot::WriteJson(std::ostream& out) const {
+        const auto flags = out.flags();
+        const auto precision = out.precision();
+        out << std::setprecision(std::numeric_limits<f64>::digits10);
+
+        out << "{\"ts\":" << timestampUs << ",\"metrics\":{";
+        for (usize i = 0; i < metrics.size(); ++i) {
+            const MetricSnapshot& metric = metrics[i];
+            if (i > 0) out << ',';
+            WriteJsonString(out, metric.name);
+            out << ":{\"type\":\"" << MetricTypeName(metric.type) << '"';
+            switch (metric.type) {
+            case MetricType::COUNTER:
+                out << ",\"value\":" << metric.count;
+                break;
+            case MetricType::GAUGE:
+                out << ",\"value\":";
+                WriteJsonNumber(out, metric.value);
+                break;
+            case MetricType::HISTOGRAM: {
+                const HistogramSnapshot& histogram = metric.histogram;
+                out << ",\"count\":" << histogram.count << ",\"sum\":";
+                WriteJsonNumber(out, histogram.sum);
+                out << ",\"min\":";
+                WriteJsonNumber(out, histogram.min);
+                out << ",\"max\":";
+                WriteJsonNumber(out, histogram.max);
+                out << ",\"p50\":";
+                WriteJsonNumber(out, histogram.Percentile(0.5));
+                out << ",\"p95\":";
+                WriteJsonNumber(out, histogram.Percentile(0.95));
+                out << ",\"p99\":";
+                WriteJsonNumber(out, histogram.Percentile(0.99));
+                out << ",\"bounds\":[";
+                for (usize b = 0; b < histogram.bounds.size(); ++b) {
+                    if (b > 0) out << ',';
+                    WriteJsonNumber(out, histogram.bounds[b]);
+                }
+                out << "],\"counts\":[";
+                for (usize b = 0; b < histogram.counts.size(); ++b) {
+                    if (b > 0) out << ',';
+                    out << histogram.counts[b];
+                }
+                out << ']';
+                break;
+            }
+            }
+            out << '}';
+        }
+        out << "}}";
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    MetricsRegistry::Shard_::Shard_() {
+        for (usize i = 0; i < MaxMetrics; ++i) {
+            counters[i].store(0, std::memory_order_relaxed);
+        }
+        for (usize h = 0; h < MaxHistograms; ++h) {
+            for (usize b = 0; b <= MaxHistogramBuckets; ++b) {
+                buckets[h][b].store(0, std::memory_order_relaxed);
+            }
+            sums[h].store(0.0, std::memory_order_relaxed);
+            mins[h].store(std::numeric_limits<f64>::infinity(), std::memory_order_relaxed);
+            maxs[h].store(-std::numeric_limits<f64>::infinity(), std::memory_order_relaxed);
+        }
+    }
+
+    MetricsRegistry::MetricsRegistry() {
+        for (usize i = 0; i < MaxMetrics; ++i) {
+            gauges_[i].store(0.0, std::memory_order_relaxed);
+        }
+    }
+
+    MetricsRegistry& MetricsRegistry::Instance() {
+        static MetricsRegistry * instance = new MetricsRegistry();
+        return *instance;
+    }
+
+    MetricId MetricsRegistry::RegisterCounter(const std::string& name, const std::string& description) {
+        return Register_(name, description, MetricType::COUNTER, {});
+    }
+
+    MetricId MetricsRegistry::RegisterGauge(const std::string& name, const std::string& description) {
+        return Register_(name, description, MetricType::GAUGE, {});
+    }
+
+    MetricId MetricsRegistry::RegisterHistogram(const std::string& name, const std::vector<f64>& bounds, const std::string& description) {
+        if (bounds.empty() || bounds.size() > MaxHistogramBuckets) {
+            throw std::runtime_error("Histogram " + name + " needs between 1 and " + std::to_string(MaxHistogramBuckets) + " bounds");
+        }
+        if (!std::is_sorted(bounds.begin(), bounds.end())) {
+            throw std::runtime_error("Histogram " + name + " bounds must be in ascending order");
+        }
+        return Register_(name, description, MetricType::HISTOGRAM, bounds);
+    }
+
+    MetricId MetricsRegistry::Register_(const std::string& name, const std::string& description, const MetricType type, const std::vector<f64>& bounds) {
+        auto ul = std::unique_lock<std::mutex>(registerMutex_);
+
+        const u32 count = numMetrics_.load(std::memory_order_relaxed);
+        for (u32 id = 0; id < count; ++id) {
+            if (metrics_[id].name != name) continue;
+            if (metrics_[id].type != type) {
+                throw std::runtime_error("Metric " + name + " was already registered as a " + MetricTypeName(metrics_[id].type));
+            }
+            return id;
+        }
+
+        if (count == MaxMetrics) throw std::runtime_error("Too many metrics registered (adding " + name + ")");
+        if (type == MetricType::HISTOGRAM && numHistograms_ == MaxHistograms) {
+            throw std::runtime_error("Too many histograms registered (adding " + name + ")");
+        }
+
+        Metric_& metric = metrics_[count];
+        metric.name = name;
+        metric.description = description;
+        metric.type = type;
+        if (type == MetricType::HISTOGRAM) {
+            metric.histogram = numHistograms_++;
+            metric.numBounds = u32(bounds.size());
+            std::copy(bounds.begin(), bounds.end(), metric.bounds);
+        }
+
+        // Publishes the entry to Snapshot
+        numMetrics_.store(count + 1, std::memory_order_release);
+        return count;
+    }
+
+    const MetricsRegistry::Metric_& MetricsRegistry::GetMetric_(const MetricId id, const MetricType type) const {
+        if (id >= numMetrics_.load(std::memory_order_acquire) || metrics_[id].type != type) {
+            throw std::runtime_error("Invalid metric id " + std::to_string(id));
+        }
+        return metrics_[id];
+    }
+
+    MetricsRegistry::Shard_ * MetricsRegistry::GetShard_() {
+        // Gives the shard back when the thread exits
+        struct ShardHandle_ {
+            Shard_ * shard = nullptr;
+            ~ShardHandle_() {
+                if (shard != nullptr) shard->inUse.store(false, std::memory_order_release);
+            }
+        };
+
+        static thread_local ShardHandle_ handle;
+        if (handle.shard == nullptr) {
+            auto ul = std::unique_lock<std::mutex>(shardsMutex_);
+            for (const auto& shard : shards_) {
+                if (!shard->inUse.load(std::memory_order_acquire)) {
+                    shard->inUse.store(true, std::memory_order_relaxed);
+                    handle.shard = shard.get();
+                    break;
+                }
+            }
+            if (handle.shard == nullptr) {
+                shards_.push_back(std::unique_ptr<Shard_>(new Shard_()));
+                handle.shard = shards_.back().get();
+            }
+        }
+        return handle.shard;
+    }
+
+    void MetricsRegistry::Increment(const MetricId id, const i64 amount) {
+        GetMetric_(id, MetricType::COUNTER);
+        AddRelaxed(GetShard_()->counters[id], amount);
+    }
+
+    void MetricsRegistry::SetGauge(const MetricId id, const f64 value) {
+        GetMetric_(id, MetricType::GAUGE);
+        gauges_[id].store(value, std::memory_order_relaxed);
+    }
+
+    void MetricsRegistry::AddGauge(const MetricId id, const f64 amount) {
+        GetMetric_(id, MetricType::GAUGE);
+        // Shared between threads so this one does need a loop
+        f64 current = gauges_[id].load(std::memory_order_relaxed);
+        while (!gauges_[id].compare_exchange_weak(current, current + amount, std::memory_order_relaxed)) {}
+    }
+
+    void MetricsRegistry::Record(const MetricId id, const f64 value) {
+        const Metric_& metric = GetMetric_(id, MetricType::HISTOGRAM);
+        Shard_ * shard = GetShard_();
+
+        const f64 * end = metric.bounds + metric.numBounds;
+        const usize bucket = usize(std::lower_bound(metric.bounds, end, value) - metric.bounds);
+        const u32 h = metric.histogram;
+        AddRelaxed(shard->buckets[h][bucket], u64(1));
+        AddRelaxed(shard->sums[h], value);
+        if (value < shard->mins[h].load(std::memory_order_relaxed)) shard->mins[h].store(value, std::memory_order_relaxed);
+        if (value > shard->maxs[h].load(std::memory_order_relaxed)) shard->maxs[h].store(value, std::memory_order_relaxed);
+    }
+
+    MetricsSnapshot MetricsRegistry::Snapshot() const {
+        MetricsSnapshot snapshot;
+        snapshot.timestampUs = u64(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+
+        const u32 count = numMetrics_.load(std::memory_order_acquire);
+        snapshot.metrics.resize(count);
+        for (u32 id = 0; id < count; ++id) {
+            const Metric_& metric = metrics_[id];
+            MetricSnapshot& out = snapshot.metrics[id];
+            out.name = metric.name;
+            out.description = metric.description;
+            out.type = metric.type;
+            if (metric.type == MetricType::GAUGE) {
+                out.value = gauges_[id].load(std::memory_order_relaxed);
+            }
+            else if (metric.type == MetricType::HISTOGRAM) {
+                out.histogram.bounds.assign(metric.bounds, metric.bounds + metric.numBounds);
+                out.histogram.counts.resize(metric.numBounds + 1, 0);
+                out.histogram.min = std::numeric_limits<f64>::infinity();
+                out.histogram.max = -std::numeric_limits<f64>::infinity();
+            }
+        }
+
+        // Shards can be written while this runs so the totals may be off by whatever happens
+        // during the snapshot, but every value read is one a thread actually wrote
+        auto ul = std::unique_lock<std::mutex>(shardsMutex_);
+        for (const auto& shard : shards_) {
+            for (u32 id = 0; id < count; ++id) {
+                const Metric_& metric = metrics_[id];
+                MetricSnapshot& out = snapshot.metrics[id];
+                if (metric.type == MetricType::COUNTER) {
+                    out.count += shard->counters[id].load(std::memory_order_relaxed);
+                }
+                else if (metric.type == MetricType::HISTOGRAM) {
+                    const u32 h = metric.histogram;
+                    HistogramSnapshot& histogram = out.histogram;
+                    for (u32 b = 0; b <= metric.numBounds; ++b) {
+                        const u64 value = shard->buckets[h][b].load(std::memory_order_relaxed);
+                        histogram.counts[b] += value;
+                        histogram.count += value;
+                    }
+                    histogram.sum += shard->sums[h].load(std::memory_order_relaxed);
+                    histogram.min = std::min(histogram.min, shard->mins[h].load(std::memory_order_relaxed));
+                    histogram.max = std::max(histogram.max, shard->maxs[h].load(std::memory_order_relaxed));
+                }
+            }
+        }
+
+        for (MetricSnapshot& metric : snapshot.metrics) {
+            if (metric.type == MetricType::HISTOGRAM && metric.histogram.count == 0) {
+                metric.histogram.min = 0.0;
+                metric.histogram.max = 0.0;
+            }
+        }
+
+        return snapshot;
+    }
+
+    usize MetricsRegistry::NumShards() const {
+        auto ul = std::unique_lock<std::mutex>(shardsMutex_);
+        return shards_.size();
+    }
+
+    std::vector<f64> MetricsRegistry::ExponentialBounds(const f64 start, const f64 factor, const usize count) {
+        std::vector<f64> bounds;
+        bounds.reserve(count);
+        f64 bound = start;
+        for (usize i = 0; i < count; ++i) {
+            bounds.push_back(bound);
+            bound *= factor;
+        }
+        return bounds;
+    }
+
+    MetricsFileWriter::MetricsFileWriter(const std::string& filename, const f64 intervalSeconds, const bool append)
+        : file_(std::fopen(filename.c_str(), append ? "ab" : "wb")),
+          intervalSeconds_(intervalSeconds) {
+        if (file_ == nullptr) throw std::runtime_error("Unable to open metrics file " + filename);
+        thread_ = std::thread([this]() { Run_(); });
+    }
+
+    MetricsFileWriter::~MetricsFileWriter() {
+        {
+            auto ul = std::unique_lock<std::mutex>(runningMutex_);
+            running_ = false;
+        }
+        wake_.notify_one();
+        thread_.join();
+
+        WriteSnapshot();
+        std::fclose(file_);
+    }
+
+    void MetricsFileWriter::WriteSnapshot() {
+        std::ostringstream line;
+        MetricsRegistry::Instance().Snapshot().WriteJson(line);
+        line << '\n';
+        const std::string text = line.str();
+
+        auto ul = std::unique_lock<std::mutex>(fileMutex_);
+        std::fwrite(text.data(), 1, text.size(), file_);
+        std::fflush(file_);
+        written_.fetch_add(1);
+    }
+
+    void MetricsFileWriter::Run_() {
+        const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<f64>(std::max(intervalSeconds_, 0.001)));
+        auto next = std::chrono::steady_clock::now() + interval;
+
+        auto ul = std::unique_lock<std::mutex>(runningMutex_);
+        while (running_) {
+            if (wake_.wait_until(ul, next, [this]() { return !running_; })) break;
+            ul.unlock();
+            WriteSnapshot();
+            ul.lock();
+            next += interval;
+        }
+    }
+}
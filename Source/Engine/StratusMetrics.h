@@ -0,0 +1,174 @@
+#pragma once
+
+#include "StratusTypes.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stratus {
+    typedef u32 MetricId;
+
+    enum class MetricType : i32 {
+        // Only ever goes up (draw calls issued, tasks scheduled)
+        COUNTER,
+        // Current value of something (entities, free mesh vertices)
+        GAUGE,
+        // Distribution of recorded values (frame times)
+        HISTOGRAM
+    };
+
+    struct HistogramSnapshot {
+        // Upper bound of each bucket. counts has one more entry for values above the last bound.
+        std::vector<f64> bounds;
+        std::vector<u64> counts;
+        u64 count = 0;
+        f64 sum = 0.0;
+        f64 min = 0.0;
+        f64 max = 0.0;
+
+        f64 Mean() const { return count > 0 ? sum / f64(count) : 0.0; }
+        // Estimated by interpolating within the bucket the percentile falls in. p is in [0, 1].
+        f64 Percentile(const f64 p) const;
+    };
+
+    struct MetricSnapshot {
+        std::string name;
+        std::string description;
+        MetricType type;
+        // Set for counters
+        i64 count = 0;
+        // Set for gauges
+        f64 value = 0.0;
+        // Set for histograms
+        HistogramSnapshot histogram;
+    };
+
+    struct MetricsSnapshot {
+        // Microseconds since the epoch
+        u64 timestampUs = 0;
+        // In the order the metrics were registered
+        std::vector<MetricSnapshot> metrics;
+
+        // Returns null if there is no metric with the name
+        const MetricSnapshot * Find(const std::string& name) const;
+        // One line of JSON (no trailing newline):
+        //      {"ts":...,"metrics":{"Name":{"type":"counter","value":...},...}}
+        void WriteJson(std::ostream& out) const;
+    };
+
+    // Counters, gauges and histograms which can be updated from any thread without locking. Modules
+    // register their metrics once (usually in Initialize) and keep the ids around.
+    //
+    // Counters and histograms are sharded per thread - each thread only writes its own shard so
+    // updating them is a couple of uncontended relaxed stores. Snapshot adds the shards together.
+    // Gauges are a single value where the last write wins. Shards of threads which have exited are
+    // handed to new threads so the number of shards stays at the number of live threads.
+    //
+    // Names are expected to look like Module.metric (EntityManager.entities).
+    class MetricsRegistry {
+        MetricsRegistry();
+
+    public:
+        // Never deleted so that threads which outlive the engine can still update their metrics
+        static MetricsRegistry& Instance();
+
+        static constexpr usize MaxMetrics = 256;
+        static constexpr usize MaxHistograms = 64;
+        static constexpr usize MaxHistogramBuckets = 16;
+
+        // Registering the same name again returns the same id. Throws std::runtime_error if the name
+        // was registered with a different type or if there is no room left.
+        MetricId RegisterCounter(const std::string& name, const std::string& description = "");
+        MetricId RegisterGauge(const std::string& name, const std::string& description = "");
+        // bounds are the upper bound of each bucket in ascending order (at most MaxHistogramBuckets)
+        MetricId RegisterHistogram(const std::string& name, const std::vector<f64>& bounds, const std::string& description = "");
+
+        void Increment(const MetricId id, const i64 amount = 1);
+        void SetGauge(const MetricId id, const f64 value);
+        void AddGauge(const MetricId id, const f64 amount);
+        void Record(const MetricId id, const f64 value);
+
+        MetricsSnapshot Snapshot() const;
+        usize NumMetrics() const { return numMetrics_.load(std::memory_order_acquire); }
+        usize NumShards() const;
+
+        // start, start * factor, start * factor^2, ...
+        static std::vector<f64> ExponentialBounds(const f64 start, const f64 factor, const usize count);
+
+    private:
+        struct Metric_ {
+            std::string name;
+            std::string description;
+            MetricType type = MetricType::COUNTER;
+            // Index into the histogram arrays
+            u32 histogram = 0;
+            f64 bounds[MaxHistogramBuckets];
+            u32 numBounds = 0;
+        };
+
+        // Everything is only written by the owning thread
+        struct Shard_ {
+            std::atomic<bool> inUse{true};
+            std::atomic<i64> counters[MaxMetrics];
+            // Last entry of each row is for values above the last bound
+            std::atomic<u64> buckets[MaxHistograms][MaxHistogramBuckets + 1];
+            std::atomic<f64> sums[MaxHistograms];
+            std::atomic<f64> mins[MaxHistograms];
+            std::atomic<f64> maxs[MaxHistograms];
+
+            Shard_();
+        };
+
+        MetricId Register_(const std::string& name, const std::string& description, const MetricType type, const std::vector<f64>& bounds);
+        const Metric_& GetMetric_(const MetricId id, const MetricType type) const;
+        Shard_ * GetShard_();
+
+    private:
+        // Entries below numMetrics_ are never changed again
+        Metric_ metrics_[MaxMetrics];
+        std::atomic<u32> numMetrics_{0};
+        u32 numHistograms_ = 0;
+        std::mutex registerMutex_;
+
+        std::atomic<f64> gauges_[MaxMetrics];
+
+        // Shards are only ever added
+        mutable std::mutex shardsMutex_;
+        std::vector<std::unique_ptr<Shard_>> shards_;
+    };
+
+    // Appends a snapshot of MetricsRegistry::Instance() to a file as a line of JSON every
+    // intervalSeconds from a background thread, plus a final one when destroyed
+    class MetricsFileWriter {
+    public:
+        // Throws std::runtime_error if the file can't be opened
+        MetricsFileWriter(const std::string& filename, const f64 intervalSeconds, const bool append = false);
+        ~MetricsFileWriter();
+
+        MetricsFileWriter(const MetricsFileWriter&) = delete;
+        MetricsFileWriter& operator=(const MetricsFileWriter&) = delete;
+
+        // Writes a snapshot right away
+        void WriteSnapshot();
+        u64 SnapshotsWritten() const { return written_.load(); }
+
+    private:
+        void Run_();
+
+    private:
+        FILE * file_;
+        f64 intervalSeconds_;
+        std::mutex fileMutex_;
+        std::atomic<u64> written_{0};
+        bool running_ = true;
+        std::mutex runningMutex_;
+        std::condition_variable wake_;
+        std::thread thread_;
+    };
+}
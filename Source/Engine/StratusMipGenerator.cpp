@@ -0,0 +1,237 @@
+#include "StratusMipGenerator.h"
+#include "StratusTaskSystem.h"
+#include "StratusCommon.h"
+#include "glm/glm.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace stratus {
+    static float SrgbToLinear(const float value) {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    static float LinearToSrgb(const float value) {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    static const float * SrgbDecodeTable() {
+        static const std::vector<float> table = []() {
+            std::vector<float> result(256);
+            for (u32 i = 0; i < 256; ++i) result[i] = SrgbToLinear(float(i) / 255.0f);
+            return result;
+        }();
+        return table.data();
+    }
+
+    // Fine enough that the steepest part of the curve (near black) stays under a quarter of an 8-bit step
+    static constexpr u32 srgbEncodeTableSize = 16384;
+
+    static const u8 * SrgbEncodeTable() {
+        static const std::vector<u8> table = []() {
+            std::vector<u8> result(srgbEncodeTableSize);
+            for (u32 i = 0; i < srgbEncodeTableSize; ++i) {
+                const float srgb = LinearToSrgb(float(i) / float(srgbEncodeTableSize - 1));
+                result[i] = u8(std::clamp(srgb, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+            return result;
+        }();
+        return table.data();
+    }
+
+    static u8 ToUnorm8(const float value) {
+        return u8(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    // Describes how each channel of the source is interpreted
+    struct ChannelLayout_ {
+        u32 numChannels;
+        u32 colorChannels;
+        // -1 if there is no alpha
+        i32 alphaIndex;
+        bool srgb;
+        bool normalMap;
+
+        ChannelLayout_(const u32 numChannels, const MipGenerationOptions& options)
+            : numChannels(numChannels) {
+            alphaIndex = (numChannels == 2 || numChannels == 4) ? i32(numChannels - 1) : -1;
+            colorChannels = alphaIndex >= 0 ? numChannels - 1 : numChannels;
+            normalMap = options.normalMap && colorChannels >= 3;
+            // sRGB has no meaning for normal vectors
+            srgb = options.srgb && !normalMap;
+        }
+    };
+
+    // Converts an 8-bit texel into the space filtering happens in: linear color, [-1, 1] normals,
+    // and alpha as-is. Alpha always goes in w so coverage code does not need to know the layout.
+    static glm::vec4 DecodeTexel(const u8 * texel, const ChannelLayout_& layout, const float * srgbTable) {
+        glm::vec4 result(0.0f);
+        for (u32 c = 0; c < layout.colorChannels; ++c) {
+            if (layout.normalMap) result[c] = float(texel[c]) / 255.0f * 2.0f - 1.0f;
+            else if (layout.srgb) result[c] = srgbTable[texel[c]];
+            else result[c] = float(texel[c]) / 255.0f;
+        }
+        if (layout.alphaIndex >= 0) result.w = float(texel[layout.alphaIndex]) / 255.0f;
+        return result;
+    }
+
+    static void EncodeTexel(glm::vec4 value, const float alphaScale, const ChannelLayout_& layout, const u8 * srgbTable, u8 * texel) {
+        if (layout.normalMap) {
+            const glm::vec3 n = glm::vec3(value);
+            const float length = glm::length(n);
+            const glm::vec3 unit = length > 1e-6f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            value = glm::vec4(unit * 0.5f + 0.5f, value.w);
+        }
+
+        for (u32 c = 0; c < layout.colorChannels; ++c) {
+            if (layout.srgb) {
+                const float linear = std::clamp(value[c], 0.0f, 1.0f);
+                texel[c] = srgbTable[u32(linear * float(srgbEncodeTableSize - 1) + 0.5f)];
+            }
+            else {
+                texel[c] = ToUnorm8(value[c]);
+            }
+        }
+        if (layout.alphaIndex >= 0) texel[layout.alphaIndex] = ToUnorm8(value.w * alphaScale);
+    }
+
+    static float FilteredAlphaCoverage(const std::vector<glm::vec4>& texels, const float threshold, const float alphaScale) {
+        if (texels.size() == 0) return 0.0f;
+        usize covered = 0;
+        for (const glm::vec4& texel : texels) {
+            if (texel.w * alphaScale > threshold) ++covered;
+        }
+        return float(covered) / float(texels.size());
+    }
+
+    // Finds the alpha scale which gets this level's coverage closest to the target
+    // (see Castaño, "Computing Alpha Mipmaps")
+    static float FindAlphaScale(const std::vector<glm::vec4>& texels, const float threshold, const float targetCoverage) {
+        float low = 0.0f;
+        float high = 4.0f;
+        for (i32 iteration = 0; iteration < 12; ++iteration) {
+            const float mid = (low + high) * 0.5f;
+            if (FilteredAlphaCoverage(texels, threshold, mid) < targetCoverage) {
+                low = mid;
+            }
+            else {
+                high = mid;
+            }
+        }
+        return (low + high) * 0.5f;
+    }
+
+    u32 MipGenerator::NumLevels(const u32 width, const u32 height) {
+        u32 levels = 1;
+        for (u32 size = std::max(width, height); size > 1; size /= 2) ++levels;
+        return levels;
+    }
+
+    void MipGenerator::ForEach(const usize count, const std::function<void (usize)>& process) {
+        TaskSystem * tasks = INSTANCE(TaskSystem);
+        if (tasks == nullptr || tasks->Size() == 0) {
+            for (usize i = 0; i < count; ++i) process(i);
+            return;
+        }
+        tasks->ParallelFor(count, process);
+    }
+
+    float MipGenerator::AlphaCoverage(const MipLevel& level, const u32 numChannels, const float threshold, const float alphaScale) {
+        if (numChannels != 2 && numChannels != 4) return 1.0f;
+        const usize numPixels = usize(level.width) * usize(level.height);
+        if (numPixels == 0) return 0.0f;
+
+        usize covered = 0;
+        for (usize i = 0; i < numPixels; ++i) {
+            if (float(level.data[i * numChannels + numChannels - 1]) / 255.0f * alphaScale > threshold) ++covered;
+        }
+        return float(covered) / float(numPixels);
+    }
+
+    std::vector<MipLevel> MipGenerator::Generate(
+        const u8 * pixels,
+        const u32 width,
+        const u32 height,
+        const u32 numChannels,
+        const MipGenerationOptions& options) {
+
+        if (pixels == nullptr || width == 0 || height == 0 || numChannels < 1 || numChannels > 4) return {};
+
+        const ChannelLayout_ layout(numChannels, options);
+        const float * decodeTable = SrgbDecodeTable();
+        const u8 * encodeTable = SrgbEncodeTable();
+        const u32 numLevels = NumLevels(width, height);
+
+        std::vector<MipLevel> levels(numLevels);
+        for (u32 level = 0; level < numLevels; ++level) {
+            levels[level].width = std::max<u32>(1, width >> level);
+            levels[level].height = std::max<u32>(1, height >> level);
+            levels[level].data.resize(usize(levels[level].width) * usize(levels[level].height) * numChannels);
+        }
+        std::memcpy(levels[0].data.data(), pixels, levels[0].data.size());
+
+        // Filtered levels are kept at full precision so rounding does not accumulate down the chain.
+        // Index 0 is unused since level 0 is read straight from the source.
+        std::vector<std::vector<glm::vec4>> filtered(numLevels);
+
+        // Each level depends on the one above it so levels run in order, with rows split into tiles
+        for (u32 level = 1; level < numLevels; ++level) {
+            const u32 srcWidth = levels[level - 1].width;
+            const u32 srcHeight = levels[level - 1].height;
+            const u32 dstWidth = levels[level].width;
+            const u32 dstHeight = levels[level].height;
+            const std::vector<glm::vec4>& src = filtered[level - 1];
+            std::vector<glm::vec4>& dst = filtered[level];
+            dst.resize(usize(dstWidth) * usize(dstHeight));
+
+            const auto load = [&](const u32 x, const u32 y) {
+                const usize index = usize(y) * srcWidth + x;
+                return level == 1 ? DecodeTexel(pixels + index * numChannels, layout, decodeTable) : src[index];
+            };
+
+            const usize numTiles = (dstHeight + tileRows - 1) / tileRows;
+            ForEach(numTiles, [&](const usize tile) {
+                const u32 lastRow = std::min<u32>(dstHeight, u32(tile + 1) * tileRows);
+                for (u32 y = u32(tile) * tileRows; y < lastRow; ++y) {
+                    // 2x2 box, odd dimensions clamp at the edge
+                    const u32 y0 = std::min(y * 2, srcHeight - 1);
+                    const u32 y1 = std::min(y * 2 + 1, srcHeight - 1);
+                    for (u32 x = 0; x < dstWidth; ++x) {
+                        const u32 x0 = std::min(x * 2, srcWidth - 1);
+                        const u32 x1 = std::min(x * 2 + 1, srcWidth - 1);
+                        dst[usize(y) * dstWidth + x] = (load(x0, y0) + load(x1, y0) + load(x0, y1) + load(x1, y1)) * 0.25f;
+                    }
+                }
+            });
+        }
+
+        // Levels are independent from here on
+        std::vector<float> alphaScales(numLevels, 1.0f);
+        if (layout.alphaIndex >= 0 && options.alphaCoverageThreshold > 0.0f) {
+            const float targetCoverage = AlphaCoverage(levels[0], numChannels, options.alphaCoverageThreshold);
+            ForEach(numLevels - 1, [&](const usize index) {
+                const usize level = index + 1;
+                alphaScales[level] = FindAlphaScale(filtered[level], options.alphaCoverageThreshold, targetCoverage);
+            });
+        }
+
+        std::vector<std::pair<u32, u32>> tiles;
+        for (u32 level = 1; level < numLevels; ++level) {
+            for (u32 row = 0; row < levels[level].height; row += tileRows) {
+                tiles.push_back(std::make_pair(level, row));
+            }
+        }
+
+        ForEach(tiles.size(), [&](const usize index) {
+            const u32 level = tiles[index].first;
+            const u32 firstRow = tiles[index].second;
+            MipLevel& mip = levels[level];
+            const u32 lastRow = std::min<u32>(mip.height, firstRow + tileRows);
+            for (usize i = usize(firstRow) * mip.width; i < usize(lastRow) * mip.width; ++i) {
+                EncodeTexel(filtered[level][i], alphaScales[level], layout, encodeTable, mip.data.data() + i * numChannels);
+            }
+        });
+
+        return levels;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "StratusTypes.h"
+#include <vector>
+#include <functional>
+
+namespace stratus {
+    struct MipGenerationOptions {
+        // Color channels are filtered in linear space and converted back to sRGB afterwards
+        bool srgb = false;
+        // RGB stores a unit vector mapped to [0, 1] which is renormalized after filtering
+        bool normalMap = false;
+        // When > 0, alpha of each level is rescaled so that the fraction of texels passing this
+        // threshold matches level 0. Keeps alpha tested geometry (foliage, fences) from thinning
+        // out with distance. Should match the renderer's alpha depth test threshold.
+        float alphaCoverageThreshold = 0.0f;
+    };
+
+    struct MipLevel {
+        u32 width = 0;
+        u32 height = 0;
+        // Same channel count as the source image, tightly packed
+        std::vector<u8> data;
+    };
+
+    // Builds full mip chains for 8-bit images on the CPU. Work is split into tiles of rows and
+    // spread across TaskSystem when it is running, otherwise everything runs on the calling thread.
+    class MipGenerator {
+    public:
+        // Rows of the destination level handled by a single work item
+        static constexpr u32 tileRows = 32;
+
+        // Number of levels down to and including 1x1
+        static u32 NumLevels(const u32 width, const u32 height);
+
+        // pixels are tightly packed with numChannels (1-4) bytes per pixel. Level 0 is a copy of the
+        // input. With 2 or 4 channels the last channel is treated as alpha.
+        static std::vector<MipLevel> Generate(
+            const u8 * pixels,
+            const u32 width,
+            const u32 height,
+            const u32 numChannels,
+            const MipGenerationOptions& options
+        );
+
+        // Fraction of texels with alpha * alphaScale above threshold
+        static float AlphaCoverage(const MipLevel& level, const u32 numChannels, const float threshold, const float alphaScale = 1.0f);
+
+        // Runs process(i) for i in [0, count) on TaskSystem if it is available, otherwise serially
+        static void ForEach(const usize count, const std::function<void (usize)>& process);
+    };
+}
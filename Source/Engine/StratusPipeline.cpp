@@ -6,6 +6,9 @@
 #include "StratusUtils.h"
 #include <sstream>
 #include "StratusGraphicsDriver.h"
+#include "StratusTaskSystem.h"
+#include <mutex>
+#include <chrono>
 
 namespace stratus {
     bool ValidatePipeline(const Pipeline* p) {
@@ -24,13 +27,11 @@ namespace stratus {
         const ShaderApiVersion& version,
         const std::vector<Shader>& shaders,
         const std::vector<std::pair<std::string, std::string>> defines)
-        : shaders_(shaders), rootPath_(rootPath), version_(version), defines_(defines) {
-
-        this->Compile_();
-    }
+        : shaders_(shaders), rootPath_(rootPath), version_(version), defines_(defines),
+          preprocessor_(GetPreprocessor(rootPath)) {}
 
     Pipeline::~Pipeline() {
-        glDeleteProgram(program_);
+        if (program_ != 0) glDeleteProgram(program_);
     }
 
     static std::string BuildSourceWithLineNums(const std::string& source) {
@@ -114,23 +115,6 @@ namespace stratus {
         return true;
     }
 
-    static std::unordered_set<std::string> BuildFileList(const std::filesystem::path& root) {
-        std::unordered_set<std::string> result;
-        std::string rootReformatted = root.string();
-        ReplaceAll(rootReformatted, "\\", "/");
-
-        for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(root)) {
-            if (entry.is_regular_file()) {
-                std::string file = entry.path().string();
-                ReplaceAll(file, "\\", "/");
-                ReplaceFirst(file, rootReformatted + "/", "");
-                result.insert(file);
-            }
-        }
-
-        return result;
-    }
-
     static std::string BuildShaderApiVersion(const ShaderApiVersion& version) {
         std::string result = "#version ";
 
@@ -143,116 +127,54 @@ namespace stratus {
         return result;
     }
 
-    static std::string ExtractFirstInclude(const std::string& source) {
-        std::string result;
-
-        for (usize i = 0; i < source.size(); ++i) {
-            std::string line;
-            bool foundWhitespace = false;
-            // Read current line
-            for (; i < source.size(); ++i) {
-                const char c = source[i];
-                if (c == '\n') {
-                    break;
-                }
-
-                const bool isWhitespace = c == ' ' || c == '\t' || c == '\r';
-                // We skip all the initial whitespace until we hit the first valid character
-                if (!isWhitespace) {
-                    // Current character is valid - stop looking for whitespace
-                    foundWhitespace = true;
-                }
-                else if (foundWhitespace == false) {
-                    foundWhitespace = true;
-                    continue;
-                }
-
-                line += c;
-            }
+    static std::mutex programCacheMutex;
+    static ShaderProgramCachePtr programCache;
 
-            if (BeginsWith(line, "#include")) {
-                result = line;
-                break;
-            }
-        }
-
-        return result;
+    void Pipeline::SetProgramCache(const ShaderProgramCachePtr& cache) {
+        auto ul = std::unique_lock<std::mutex>(programCacheMutex);
+        programCache = cache;
     }
 
-    static std::string ExtractIncludeFile(const std::string& source) {
-        std::string file;
-        bool foundQuote = false;
-        for (usize i = 0; i < source.size(); ++i) {
-            const char c = source[i];
-            if (c == '\"') {
-                if (foundQuote) {
-                    break;
-                }
-                foundQuote = true;
-            }
-            else if (foundQuote) {
-                file += c;
-            }
-        }
-
-        return file;
+    ShaderProgramCachePtr Pipeline::GetProgramCache() {
+        auto ul = std::unique_lock<std::mutex>(programCacheMutex);
+        return programCache;
     }
 
-    static void PreprocessIncludes(std::string& source, const std::filesystem::path& root, const std::unordered_set<std::string>& allShaders) {
-        std::unordered_set<std::string> seenIncludes;
-        // We need to do this in a loop since bringing in one file could also bring in additional includes
-        while (true) {
-            std::string line = ExtractFirstInclude(source);
-            // Reached the end of the include list
-            if (line.empty()) {
-                break;
-            }
+    static std::mutex preprocessorMutex;
+    static std::unordered_map<std::string, ShaderPreprocessorPtr> preprocessors;
 
-            const std::string file = ExtractIncludeFile(line);
-            if (seenIncludes.find(file) == seenIncludes.end()) {
-                seenIncludes.insert(file);
-                const std::string fullPath = root.string() + "/" + file;
-                std::string includeSource = Filesystem::ReadAscii(fullPath);
-                ReplaceFirst(source, line, includeSource);
-            }
-            else {
-                ReplaceAll(source, line, "");
-            }
-        }
+    ShaderPreprocessorPtr Pipeline::GetPreprocessor(const std::filesystem::path& rootPath) {
+        const std::string key = rootPath.lexically_normal().generic_string();
+        auto ul = std::unique_lock<std::mutex>(preprocessorMutex);
+        auto it = preprocessors.find(key);
+        if (it != preprocessors.end()) return it->second;
+
+        auto preprocessor = std::make_shared<ShaderPreprocessor>(std::make_shared<DiskShaderSourceFiles>(rootPath));
+        preprocessors.insert(std::make_pair(key, preprocessor));
+        return preprocessor;
     }
 
-    static void PreprocessShaderSource(std::string& source,
-        const std::filesystem::path& root,
-        const std::string& versionTag,
-        const std::unordered_set<std::string>& allShaders,
-        const std::vector<std::pair<std::string, std::string>>& defines) {
-        PreprocessIncludes(source, root, allShaders);
-        ReplaceFirst(source, "STRATUS_GLSL_VERSION", versionTag + "\n\nSTRATUS_GLSL_DEFINES");
-        ReplaceAll(source, "STRATUS_GLSL_VERSION", "");
-        // Build the define list
-        std::string defineList;
-        for (const auto& define : defines) {
-            defineList = defineList + "#define " + define.first + " " + define.second + "\n";
-        }
-        ReplaceFirst(source, "STRATUS_GLSL_DEFINES", defineList);
+    static std::string DriverDescription() {
+        // Version string includes the driver build on most vendors
+        return GraphicsDriver::GetConfig().renderer + "|" + GraphicsDriver::GetConfig().version;
     }
 
-    void Pipeline::Compile_() {
-        const std::unordered_set<std::string> allShaders = BuildFileList(rootPath_);
-        const std::string versionTag = BuildShaderApiVersion(version_);
+    Pipeline::PreprocessedSource_ Pipeline::Preprocess_(const std::filesystem::path& rootPath,
+                                                        const ShaderApiVersion& version,
+                                                        const std::vector<Shader>& shaders,
+                                                        const std::vector<std::pair<std::string, std::string>>& defines,
+                                                        ShaderPreprocessor& preprocessor) {
+        const auto start = std::chrono::steady_clock::now();
+        const std::string versionTag = BuildShaderApiVersion(version);
 
-        isValid_ = true;
-        std::vector<GLuint> shaderBinaries;
-        for (Shader& s : this->shaders_) {
-            const std::string shaderFile = rootPath_.string() + "/" + s.filename;
+        PreprocessedSource_ result;
+        for (const Shader& s : shaders) {
+            const std::string shaderFile = rootPath.string() + "/" + s.filename;
             STRATUS_LOG << "Loading shader: " << shaderFile << std::endl;
-            std::string buffer = Filesystem::ReadAscii(shaderFile);
-            if (buffer.empty()) {
-                isValid_ = false;
-                return;
-            }
-
-            PreprocessShaderSource(buffer, rootPath_, versionTag, allShaders, defines_);
+            PreprocessedShader preprocessed;
+            const bool read = preprocessor.Preprocess(s.filename, versionTag, defines, preprocessed, result.error);
+            result.files.insert(result.files.end(), preprocessed.files.begin(), preprocessed.files.end());
+            if (!read) return result;
 
             GLenum type;
             switch (s.type) {
@@ -269,26 +191,136 @@ namespace stratus {
                 type = GL_COMPUTE_SHADER;
                 break;
             default:
-                STRATUS_ERROR << "Unknown shader type" << std::endl;
-                isValid_ = false;
-                return;
+                result.error = "[error] Unknown shader type: " + s.filename + "\n";
+                return result;
             }
 
-            GLuint bin = glCreateShader(type);
-            const char* bufferPtr = buffer.c_str();
+            result.stages.push_back(ShaderStageSource{ u32(type), std::move(preprocessed.source) });
+        }
+
+        result.valid = true;
+        result.cacheKey = ShaderProgramCache::ComputeKey(result.stages, defines, DriverDescription());
+        result.milliseconds = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    Pipeline::PreprocessedSource_ Pipeline::TakePreprocessed_() const {
+        const std::shared_ptr<PendingSource_> pending = std::move(pendingSource_);
+        pendingSource_.reset();
+        if (pending != nullptr && pending->ready.load()) {
+            return std::move(pending->source);
+        }
+        // Not done yet - doing the work here is cheaper than blocking on the task
+        return Preprocess_(rootPath_, version_, shaders_, defines_, *preprocessor_);
+    }
+
+    void Pipeline::PrepareAsync() {
+        if (!compilePending_ || pendingSource_ != nullptr) return;
+
+        TaskSystem * tasks = TaskSystem::Instance();
+        if (tasks == nullptr || tasks->Size() == 0) return;
+
+        auto pending = std::make_shared<PendingSource_>();
+        pendingSource_ = pending;
+        tasks->ScheduleTask([pending, rootPath = rootPath_, version = version_, shaders = shaders_, defines = defines_, preprocessor = preprocessor_]() {
+            pending->source = Preprocess_(rootPath, version, shaders, defines, *preprocessor);
+            pending->ready.store(true);
+        });
+    }
+
+    // Returns 0 on a miss or if the driver no longer accepts the binary
+    static GLuint LoadCachedProgram(const ShaderProgramCache& cache, const u64 key) {
+        ShaderProgramBinary binary;
+        if (!cache.Load(key, binary)) return 0;
+
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, GLenum(binary.format), binary.data.data(), GLsizei(binary.data.size()));
+
+        GLint linkStatus;
+        glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+        if (!linkStatus) {
+            glDeleteProgram(program);
+            cache.Reject(key);
+            return 0;
+        }
+
+        return program;
+    }
+
+    static void StoreProgram(const ShaderProgramCachePtr& cache, const GLuint program, const u64 key) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        auto binary = std::make_shared<ShaderProgramBinary>();
+        binary->key = key;
+        binary->data.resize(usize(length));
+        GLenum format = 0;
+        glGetProgramBinary(program, length, nullptr, &format, binary->data.data());
+        binary->format = u32(format);
+
+        // Keep the disk write off of the graphics thread
+        TaskSystem * tasks = TaskSystem::Instance();
+        if (tasks != nullptr && tasks->Size() > 0) {
+            tasks->ScheduleTask([cache, binary]() {
+                cache->Store(*binary);
+            });
+        }
+        else {
+            cache->Store(*binary);
+        }
+    }
+
+    void Pipeline::Link_(const PreprocessedSource_& preprocessed) const {
+        const auto start = std::chrono::steady_clock::now();
+        LinkProgram_(preprocessed);
+        const f64 milliseconds = preprocessed.milliseconds +
+            std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        ++compileStats_.compiles;
+        compileStats_.lastCompileMs = milliseconds;
+        compileStats_.totalCompileMs += milliseconds;
+    }
+
+    void Pipeline::LinkProgram_(const PreprocessedSource_& preprocessed) const {
+        if (program_ != 0) {
+            glDeleteProgram(program_);
+            program_ = 0;
+        }
+
+        error_ = preprocessed.error;
+        isValid_ = preprocessed.valid;
+        // Kept even on failure so that fixing the file triggers a reload
+        sourceFiles_ = preprocessed.files;
+        if (!isValid_) return;
+
+        const ShaderProgramCachePtr cache = GetProgramCache();
+        if (cache != nullptr) {
+            program_ = LoadCachedProgram(*cache, preprocessed.cacheKey);
+            if (program_ != 0) return;
+        }
+
+        std::vector<GLuint> shaderBinaries;
+        for (usize i = 0; i < preprocessed.stages.size(); ++i) {
+            const ShaderStageSource& stage = preprocessed.stages[i];
+            GLuint bin = glCreateShader(GLenum(stage.type));
+            const char* bufferPtr = stage.source.c_str();
             glShaderSource(bin, 1, &bufferPtr, nullptr);
             glCompileShader(bin);
+            shaderBinaries.push_back(bin);
 
-            if (!checkShaderError(bin, s.filename, buffer, error_)) {
+            if (!checkShaderError(bin, shaders_[i].filename, stage.source, error_)) {
+                for (auto compiled : shaderBinaries) glDeleteShader(compiled);
                 isValid_ = false;
                 return;
             }
-
-            shaderBinaries.push_back(bin);
         }
 
         // Link all the compiled binaries into a program
         program_ = glCreateProgram();
+        if (cache != nullptr) {
+            glProgramParameteri(program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         for (auto bin : shaderBinaries) {
             glAttachShader(program_, bin);
         }
@@ -304,13 +336,146 @@ namespace stratus {
             isValid_ = false;
             return;
         }
+
+        if (cache != nullptr) {
+            StoreProgram(cache, program_, preprocessed.cacheKey);
+        }
+    }
+
+    void Pipeline::EnsureCompiled_() const {
+        if (!compilePending_) return;
+        compilePending_ = false;
+        Link_(TakePreprocessed_());
+    }
+
+    void Pipeline::CompileAll(const std::vector<Pipeline *>& pipelines) {
+        std::vector<Pipeline *> pending;
+        for (Pipeline * p : pipelines) {
+            if (p->compilePending_) pending.push_back(p);
+        }
+
+        std::vector<PreprocessedSource_> preprocessed(pending.size());
+        const auto preprocess = [&pending, &preprocessed](const size_t i) {
+            preprocessed[i] = pending[i]->TakePreprocessed_();
+        };
+
+        TaskSystem * tasks = TaskSystem::Instance();
+        if (tasks != nullptr) {
+            tasks->ParallelFor(pending.size(), preprocess);
+        }
+        else {
+            for (size_t i = 0; i < pending.size(); ++i) preprocess(i);
+        }
+
+        // GL work stays on this thread
+        for (size_t i = 0; i < pending.size(); ++i) {
+            pending[i]->compilePending_ = false;
+            pending[i]->Link_(preprocessed[i]);
+        }
+    }
+
+    std::vector<Pipeline *> Pipeline::ReloadChanged(const std::vector<Pipeline *>& pipelines) {
+        std::unordered_set<ShaderPreprocessor *> polled;
+        for (Pipeline * p : pipelines) {
+            if (polled.insert(p->preprocessor_.get()).second) {
+                for (const std::string& file : p->preprocessor_->PollChanges()) {
+                    STRATUS_LOG << "Shader file changed: " << file << std::endl;
+                }
+            }
+        }
+
+        // Versions are compared rather than the files returned above so that pipelines passed to a
+        // different call than the one which noticed the change are still picked up
+        std::vector<Pipeline *> changed;
+        for (Pipeline * p : pipelines) {
+            if (!p->compilePending_ && p->preprocessor_->IsStale(p->sourceFiles_)) {
+                p->Recompile();
+                changed.push_back(p);
+            }
+        }
+
+        CompileAll(changed);
+        return changed;
+    }
+
+    PipelinePermutations::PipelinePermutations(const std::filesystem::path& rootPath,
+        const ShaderApiVersion& version,
+        const std::vector<Shader>& shaders,
+        const ShaderFeatureSet& features,
+        const std::vector<std::pair<std::string, std::string>>& defines)
+        : rootPath_(rootPath), version_(version), shaders_(shaders), features_(features), defines_(defines) {}
+
+    Pipeline * PipelinePermutations::Create_(const ShaderVariantKey key) {
+        auto it = variants_.find(key);
+        if (it != variants_.end()) return it->second.get();
+
+        if (!features_.IsValid(key)) {
+            throw std::runtime_error("Invalid shader variant key: " + std::to_string(key));
+        }
+
+        std::vector<std::pair<std::string, std::string>> defines = defines_;
+        const auto featureDefines = features_.Defines(key);
+        defines.insert(defines.end(), featureDefines.begin(), featureDefines.end());
+
+        Pipeline * pipeline = new Pipeline(rootPath_, version_, shaders_, defines);
+        variants_.insert(std::make_pair(key, std::unique_ptr<Pipeline>(pipeline)));
+        keys_.push_back(key);
+        return pipeline;
+    }
+
+    Pipeline * PipelinePermutations::Get(const ShaderVariantKey key) {
+        auto it = variants_.find(key);
+        if (it != variants_.end() && !it->second->IsCompilePending()) return it->second.get();
+
+        Pipeline * pipeline = Create_(key);
+        Pipeline::CompileAll({ pipeline });
+        if (ValidatePipeline(pipeline)) {
+            STRATUS_LOG << "Compiled shader variant " << key << " of " << shaders_[0].filename
+                        << " in " << pipeline->GetCompileStats().lastCompileMs << " ms" << std::endl;
+        }
+        return pipeline;
+    }
+
+    void PipelinePermutations::Prewarm(const std::vector<ShaderVariantKey>& keys) {
+        for (const ShaderVariantKey key : keys) {
+            Create_(key)->PrepareAsync();
+        }
+    }
+
+    std::vector<Pipeline *> PipelinePermutations::Variants() const {
+        std::vector<Pipeline *> result;
+        result.reserve(keys_.size());
+        for (const ShaderVariantKey key : keys_) result.push_back(variants_.find(key)->second.get());
+        return result;
+    }
+
+    std::vector<PipelineVariantStats> PipelinePermutations::GetStats() const {
+        std::vector<PipelineVariantStats> result;
+        result.reserve(keys_.size());
+        for (const ShaderVariantKey key : keys_) {
+            result.push_back(PipelineVariantStats{ key, features_.Defines(key), variants_.find(key)->second->GetCompileStats() });
+        }
+        return result;
+    }
+
+    bool Pipeline::IsValid() const {
+        EnsureCompiled_();
+        return isValid_;
+    }
+
+    std::string Pipeline::GetError() const {
+        EnsureCompiled_();
+        return error_;
     }
 
     void Pipeline::Recompile() {
-        Compile_();
+        compilePending_ = true;
+        // Anything still being prepared was read before the change
+        pendingSource_.reset();
     }
 
     void Pipeline::Bind() {
+        EnsureCompiled_();
         Unbind();
         glUseProgram(program_);
     }
@@ -433,10 +598,12 @@ namespace stratus {
     }
 
     GLint Pipeline::GetUniformLocation(const std::string& uniform) const {
+        EnsureCompiled_();
         return glGetUniformLocation(program_, &uniform[0]);
     }
 
     GLint Pipeline::GetAttribLocation(const std::string& attrib) const {
+        EnsureCompiled_();
         return glGetAttribLocation(program_, &attrib[0]);
     }
 
@@ -449,11 +616,11 @@ namespace stratus {
     }
 
     void Pipeline::Print() const {
-        auto& log = STRATUS_LOG;
+        std::stringstream log;
         for (auto& s : GetFileNames()) {
             log << s << ", ";
         }
-        log << std::endl;
+        STRATUS_LOG << log.str() << std::endl;
     }
 
     void Pipeline::DispatchCompute(u32 xGroups, u32 yGroups, u32 zGroups) const {
@@ -10,6 +10,11 @@
 #include "glm/glm.hpp"
 #include <filesystem>
 #include "StratusTypes.h"
+#include "StratusShaderCache.h"
+#include "StratusShaderPreprocessor.h"
+#include "StratusShaderPermutation.h"
+#include <atomic>
+#include <memory>
 
 namespace stratus {
     enum class ShaderType {
@@ -29,6 +34,13 @@ namespace stratus {
         i32 minor;
     };
 
+    struct PipelineCompileStats {
+        u32 compiles = 0;
+        // Preprocessing plus compiling/linking (or loading from the program cache)
+        f64 lastCompileMs = 0.0;
+        f64 totalCompileMs = 0.0;
+    };
+
     class Pipeline {
         /**
          * List of all shaders used by the pipeline.
@@ -58,18 +70,29 @@ namespace stratus {
         /**
          * Program handle returned from OpenGL
          */
-        GLuint program_;
+        mutable GLuint program_ = 0;
 
         /**
          * When a shader compiler error occurs it is placed here
          */
-        std::string error_;
+        mutable std::string error_;
 
         /**
          * Used to determine whether or not this Pipeline
          * is valid. If true then it is safe to use.
          */
-        bool isValid_ = false;
+        mutable bool isValid_ = false;
+
+        // Set until the sources have been compiled (see CompileAll)
+        mutable bool compilePending_ = true;
+
+        // Shared by every pipeline with the same root path
+        ShaderPreprocessorPtr preprocessor_;
+
+        // Every file (includes too) that went into the last compile and the version used
+        mutable std::vector<std::pair<std::string, u64>> sourceFiles_;
+
+        mutable PipelineCompileStats compileStats_;
 
     public:
         /**
@@ -86,15 +109,55 @@ namespace stratus {
         /**
          * @return true if the Pipeline was successfully compiled
          */
-        bool IsValid() const { return isValid_; }
+        bool IsValid() const;
 
-        std::string GetError() const { return error_; }
+        std::string GetError() const;
 
         /**
-         * Tells the Pipeline to recompile its source files.
+         * Tells the Pipeline to recompile its source files. Like construction, the compile
+         * happens on first use or during the next CompileAll.
          */
         void Recompile();
 
+        // True until the next compile (first use, CompileAll or ReloadChanged)
+        bool IsCompilePending() const { return compilePending_; }
+
+        /**
+         * Starts reading and preprocessing the sources on the task system so that the next compile
+         * only has to compile and link. Does nothing if no compile is pending.
+         */
+        void PrepareAsync();
+
+        const PipelineCompileStats& GetCompileStats() const { return compileStats_; }
+
+        /**
+         * Pipelines compile the first time they are used. This compiles every pending pipeline
+         * in the list at once - sources are read and preprocessed in parallel on the task system,
+         * then compiled and linked (or loaded from the program cache) on the calling thread, which
+         * has to own the GL context.
+         */
+        static void CompileAll(const std::vector<Pipeline *>& pipelines);
+
+        /**
+         * Checks the shader files for changes and recompiles only the pipelines in the list which
+         * use a changed file, either directly or through an include. Returns the pipelines which
+         * were recompiled. Needs the GL context.
+         */
+        static std::vector<Pipeline *> ReloadChanged(const std::vector<Pipeline *>& pipelines);
+
+        /**
+         * Preprocessor used for every pipeline under the given root. Keeps parsed files in memory
+         * between compiles.
+         */
+        static ShaderPreprocessorPtr GetPreprocessor(const std::filesystem::path& rootPath);
+
+        /**
+         * Linked programs are loaded from and saved to this cache when set. Entries are keyed by
+         * the preprocessed source, defines and driver. Null (the default) disables the cache.
+         */
+        static void SetProgramCache(const ShaderProgramCachePtr&);
+        static ShaderProgramCachePtr GetProgramCache();
+
         /**
          * Binds this Pipeline so that it can be used for rendering.
          */
@@ -169,10 +232,90 @@ namespace stratus {
         void UnbindAllTextures();
 
     private:
-        void Compile_();
+        // CPU side of compiling, safe to run on any thread
+        struct PreprocessedSource_ {
+            bool valid = false;
+            std::string error;
+            // One per element of shaders_, type is the GL shader type
+            std::vector<ShaderStageSource> stages;
+            u64 cacheKey = 0;
+            // See sourceFiles_
+            std::vector<std::pair<std::string, u64>> files;
+            f64 milliseconds = 0.0;
+        };
+
+        // Result of PrepareAsync, owned jointly with the task so the pipeline can go away first
+        struct PendingSource_ {
+            std::atomic<bool> ready{ false };
+            PreprocessedSource_ source;
+        };
+
+        mutable std::shared_ptr<PendingSource_> pendingSource_;
+
+        static PreprocessedSource_ Preprocess_(const std::filesystem::path& rootPath,
+                                               const ShaderApiVersion& version,
+                                               const std::vector<Shader>& shaders,
+                                               const std::vector<std::pair<std::string, std::string>>& defines,
+                                               ShaderPreprocessor& preprocessor);
+        // Uses the PrepareAsync result if it has finished, otherwise preprocesses on this thread
+        PreprocessedSource_ TakePreprocessed_() const;
+        // Replaces the current program and updates compileStats_. Needs the GL context.
+        void Link_(const PreprocessedSource_&) const;
+        void LinkProgram_(const PreprocessedSource_&) const;
+        void EnsureCompiled_() const;
         i32 NextTextureIndex_(const std::string& uniform, const Texture& tex);
     };
 
+    struct PipelineVariantStats {
+        ShaderVariantKey key;
+        std::vector<std::pair<std::string, std::string>> defines;
+        PipelineCompileStats compile;
+    };
+
+    /**
+     * One set of shaders compiled with different combinations of features (see ShaderFeatureSet).
+     * Variants are only created when asked for, so only the combinations that are actually used get
+     * compiled, and each compiled variant goes into the program cache under its own key.
+     *
+     * Not thread safe - meant to be used from the renderer thread.
+     */
+    class PipelinePermutations {
+    public:
+        // defines are shared by every variant
+        PipelinePermutations(const std::filesystem::path& rootPath,
+            const ShaderApiVersion& version,
+            const std::vector<Shader>& shaders,
+            const ShaderFeatureSet& features,
+            const std::vector<std::pair<std::string, std::string>>& defines = {});
+
+        const ShaderFeatureSet& Features() const { return features_; }
+
+        // Creates and compiles the variant the first time it is asked for. Compile errors are logged.
+        Pipeline * Get(const ShaderVariantKey key);
+
+        // Creates the variants and preprocesses them in the background so their first Get only has to
+        // compile and link
+        void Prewarm(const std::vector<ShaderVariantKey>& keys);
+
+        // Every variant created so far, compiled or not
+        std::vector<Pipeline *> Variants() const;
+        // One entry per variant created so far
+        std::vector<PipelineVariantStats> GetStats() const;
+
+    private:
+        Pipeline * Create_(const ShaderVariantKey key);
+
+    private:
+        std::filesystem::path rootPath_;
+        ShaderApiVersion version_;
+        std::vector<Shader> shaders_;
+        ShaderFeatureSet features_;
+        std::vector<std::pair<std::string, std::string>> defines_;
+        std::unordered_map<ShaderVariantKey, std::unique_ptr<Pipeline>> variants_;
+        // Creation order so Variants() and GetStats() are stable
+        std::vector<ShaderVariantKey> keys_;
+    };
+
     bool ValidatePipeline(const Pipeline* p);
     bool ValidatePipeline(const Pipeline& p);
 
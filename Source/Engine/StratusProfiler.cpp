@@ -0,0 +1,270 @@
+#include "StratusProfiler.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+namespace stratus {
+    ProfileEventRing::ProfileEventRing(const usize capacity) {
+        usize size = 1;
+        while (size < capacity) size <<= 1;
+        events_.resize(size);
+        mask_ = u64(size - 1);
+    }
+
+    bool ProfileEventRing::Push(const ProfileEvent& event) {
+        const u64 tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= u64(events_.size())) return false;
+        events_[usize(tail & mask_)] = event;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    usize ProfileEventRing::PopAll(std::vector<ProfileEvent>& out) {
+        const u64 head = head_.load(std::memory_order_relaxed);
+        const u64 tail = tail_.load(std::memory_order_acquire);
+        for (u64 i = head; i < tail; ++i) {
+            out.push_back(events_[usize(i & mask_)]);
+        }
+        head_.store(tail, std::memory_order_release);
+        return usize(tail - head);
+    }
+
+    Profiler::Profiler()
+        // Track 0 is the GPU, threads start at 1
+        : gpu_(new Track_(0)) {
+        gpu_->name = "GPU";
+        for (usize i = 0; i < MaxCounters; ++i) {
+            counters_[i].store(0);
+            lastFrameCounters_[i].store(0);
+            counterNames_[i] = nullptr;
+        }
+    }
+
+    Profiler& Profiler::Instance() {
+        static Profiler * instance = new Profiler();
+        return *instance;
+    }
+
+    i64 Profiler::NowNs() {
+        return i64(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    Profiler::Track_ * Profiler::GetTrack_() {
+        static thread_local Track_ * track = nullptr;
+        if (track == nullptr) {
+            auto ul = std::unique_lock<std::mutex>(tracksMutex_);
+            tracks_.push_back(std::unique_ptr<Track_>(new Track_(u32(tracks_.size() + 1))));
+            track = tracks_.back().get();
+        }
+        return track;
+    }
+
+    void Profiler::SetThreadName(const std::string& name) {
+        Track_ * track = GetTrack_();
+        auto ul = std::unique_lock<std::mutex>(tracksMutex_);
+        track->name = name;
+    }
+
+    void Profiler::BeginScope(const char * name) {
+        Track_ * track = GetTrack_();
+        if (track->depth == MaxScopeDepth) {
+            ++track->overflow;
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        track->open[track->depth] = OpenScope_{ name, NowNs() };
+        ++track->depth;
+    }
+
+    void Profiler::EndScope() {
+        Track_ * track = GetTrack_();
+        if (track->overflow > 0) {
+            --track->overflow;
+            return;
+        }
+        if (track->depth == 0) return;
+
+        --track->depth;
+        const OpenScope_& scope = track->open[track->depth];
+        if (!track->ring.Push(ProfileEvent{ scope.name, scope.startNs, NowNs(), track->depth })) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Profiler::RecordGpuEvent(const ProfileEvent& event) {
+        if (!IsCapturing()) return;
+        if (!gpu_->ring.Push(event)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    u32 Profiler::RegisterCounter(const char * name) {
+        auto ul = std::unique_lock<std::mutex>(countersMutex_);
+        const u32 count = numCounters_.load();
+        for (u32 i = 0; i < count; ++i) {
+            if (std::strcmp(counterNames_[i], name) == 0) return i;
+        }
+        // Out of slots - AddCounter ignores this id
+        if (count == MaxCounters) return u32(MaxCounters);
+
+        counterNames_[count] = name;
+        numCounters_.store(count + 1);
+        return count;
+    }
+
+    void Profiler::AddCounter(const u32 id, const i64 value) {
+        if (id >= MaxCounters) return;
+        counters_[id].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    i64 Profiler::LastFrameCounter(const u32 id) const {
+        if (id >= MaxCounters) return 0;
+        return lastFrameCounters_[id].load(std::memory_order_relaxed);
+    }
+
+    void Profiler::Drain_() {
+        std::vector<Track_ *> tracks;
+        {
+            auto ul = std::unique_lock<std::mutex>(tracksMutex_);
+            tracks.reserve(tracks_.size() + 1);
+            tracks.push_back(gpu_.get());
+            for (const auto& track : tracks_) tracks.push_back(track.get());
+        }
+
+        for (Track_ * track : tracks) {
+            drained_.clear();
+            track->ring.PopAll(drained_);
+            for (const ProfileEvent& event : drained_) {
+                events_.push_back(CapturedEvent_{ event, track->id });
+            }
+        }
+    }
+
+    void Profiler::SampleCounters_(const i64 timeNs) {
+        const u32 count = numCounters_.load();
+        for (u32 i = 0; i < count; ++i) {
+            const i64 value = counters_[i].exchange(0, std::memory_order_relaxed);
+            lastFrameCounters_[i].store(value, std::memory_order_relaxed);
+            counterSamples_.push_back(CounterSample_{ i, timeNs, value });
+        }
+    }
+
+    void Profiler::StartCapture() {
+        auto ul = std::unique_lock<std::mutex>(captureMutex_);
+        // Throw away anything left over from scopes which were open when the last capture stopped
+        Drain_();
+        events_.clear();
+        counterSamples_.clear();
+        frames_.clear();
+        dropped_.store(0);
+        for (usize i = 0; i < MaxCounters; ++i) {
+            counters_[i].store(0);
+            lastFrameCounters_[i].store(0);
+        }
+        capturing_.store(true);
+    }
+
+    void Profiler::StopCapture() {
+        auto ul = std::unique_lock<std::mutex>(captureMutex_);
+        if (!capturing_.load()) return;
+        capturing_.store(false);
+        Drain_();
+    }
+
+    bool Profiler::StopCapture(const std::string& path) {
+        StopCapture();
+        std::ofstream out(path);
+        if (!out.is_open()) return false;
+        WriteTrace(out);
+        return out.good();
+    }
+
+    void Profiler::BeginFrame() {
+        if (!IsCapturing()) return;
+        const i64 now = NowNs();
+        auto ul = std::unique_lock<std::mutex>(captureMutex_);
+        Drain_();
+        // The first call only marks where the frame begins, there is nothing to sample yet
+        if (frames_.size() > 0) SampleCounters_(now);
+        frames_.push_back(now);
+    }
+
+    ProfilerStats Profiler::Stats() const {
+        ProfilerStats stats;
+        {
+            auto ul = std::unique_lock<std::mutex>(captureMutex_);
+            stats.events = events_.size();
+            stats.counterSamples = counterSamples_.size();
+            stats.frames = frames_.size();
+        }
+        {
+            auto ul = std::unique_lock<std::mutex>(tracksMutex_);
+            stats.threads = tracks_.size();
+        }
+        stats.dropped = dropped_.load();
+        stats.capturing = IsCapturing();
+        return stats;
+    }
+
+    static void WriteJsonString(std::ostream& out, const char * str) {
+        out << '"';
+        for (; str != nullptr && *str != '\0'; ++str) {
+            const char c = *str;
+            if (c == '"' || c == '\\') out << '\\' << c;
+            else if (u8(c) < 0x20) out << ' ';
+            else out << c;
+        }
+        out << '"';
+    }
+
+    void Profiler::WriteTrace(std::ostream& out) const {
+        std::vector<std::pair<u32, std::string>> tracks;
+        {
+            auto ul = std::unique_lock<std::mutex>(tracksMutex_);
+            tracks.push_back(std::make_pair(gpu_->id, gpu_->name));
+            for (const auto& track : tracks_) {
+                tracks.push_back(std::make_pair(track->id, track->name.size() > 0 ? track->name : "Thread " + std::to_string(track->id)));
+            }
+        }
+
+        auto ul = std::unique_lock<std::mutex>(captureMutex_);
+
+        // Timestamps are in microseconds relative to the start of the capture
+        i64 start = frames_.size() > 0 ? frames_[0] : 0;
+        for (const CapturedEvent_& e : events_) {
+            if (start == 0 || e.event.startNs < start) start = e.event.startNs;
+        }
+        const auto micros = [start](const i64 ns) { return f64(ns - start) / 1000.0; };
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"StratusGFX\"}}";
+        for (const auto& track : tracks) {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track.first << ",\"args\":{\"name\":";
+            WriteJsonString(out, track.second.c_str());
+            out << "}}";
+        }
+
+        for (const CapturedEvent_& e : events_) {
+            out << ",\n{\"name\":";
+            WriteJsonString(out, e.event.name);
+            out << ",\"cat\":\"" << (e.track == gpu_->id ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"ts\":" << micros(e.event.startNs)
+                << ",\"dur\":" << f64(e.event.endNs - e.event.startNs) / 1000.0
+                << ",\"pid\":1,\"tid\":" << e.track << ",\"args\":{\"depth\":" << e.event.depth << "}}";
+        }
+
+        for (const CounterSample_& sample : counterSamples_) {
+            out << ",\n{\"name\":";
+            WriteJsonString(out, counterNames_[sample.counter]);
+            out << ",\"ph\":\"C\",\"ts\":" << micros(sample.timeNs) << ",\"pid\":1,\"args\":{\"value\":" << sample.value << "}}";
+        }
+
+        for (const i64 frame : frames_) {
+            out << ",\n{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"ts\":" << micros(frame) << ",\"pid\":1,\"tid\":0}";
+        }
+
+        out << "\n]}\n";
+    }
+}
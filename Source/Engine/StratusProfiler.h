@@ -0,0 +1,207 @@
+#pragma once
+
+#include "StratusTypes.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace stratus {
+    // One timed scope. Names are never copied so they need to outlive the profiler (string literals, __func__).
+    struct ProfileEvent {
+        const char * name = nullptr;
+        i64 startNs = 0;
+        i64 endNs = 0;
+        // How many scopes were open on the same track when this one began
+        u32 depth = 0;
+    };
+
+    // Fixed size single producer/single consumer ring. The owning thread pushes and Profiler drains it,
+    // so neither side ever blocks. Events pushed while the ring is full are dropped.
+    class ProfileEventRing {
+    public:
+        // Capacity is rounded up to a power of 2
+        explicit ProfileEventRing(const usize capacity);
+
+        ProfileEventRing(const ProfileEventRing&) = delete;
+        ProfileEventRing& operator=(const ProfileEventRing&) = delete;
+
+        // Producer side - returns false if the ring was full
+        bool Push(const ProfileEvent& event);
+        // Consumer side - appends everything currently in the ring to out and returns how many were added
+        usize PopAll(std::vector<ProfileEvent>& out);
+
+        usize Capacity() const { return events_.size(); }
+
+    private:
+        std::vector<ProfileEvent> events_;
+        u64 mask_;
+        // Kept on separate cache lines since they are written by different threads
+        alignas(64) std::atomic<u64> head_{0};
+        alignas(64) std::atomic<u64> tail_{0};
+    };
+
+    struct ProfilerStats {
+        // Events and counter samples held by the current (or last) capture
+        usize events = 0;
+        usize counterSamples = 0;
+        usize frames = 0;
+        // Events lost because a thread's ring was full or its scopes were nested too deeply
+        u64 dropped = 0;
+        usize threads = 0;
+        bool capturing = false;
+    };
+
+    // Collects scopes from every thread plus per-frame counters while a capture is running and writes
+    // them out as Chrome trace JSON (chrome://tracing, ui.perfetto.dev). When no capture is running a
+    // scope costs a single relaxed atomic load.
+    //
+    // Use the STRATUS_PROFILE_* macros rather than calling this directly so that everything compiles
+    // out when STRATUS_PROFILING_ENABLED is not set.
+    class Profiler {
+        Profiler();
+
+    public:
+        // Never deleted so that threads which outlive the engine can still end their scopes
+        static Profiler& Instance();
+        // Steady clock time all events are recorded in
+        static i64 NowNs();
+
+        static constexpr usize MaxCounters = 64;
+        static constexpr usize MaxScopeDepth = 64;
+
+        bool IsCapturing() const { return capturing_.load(std::memory_order_relaxed); }
+        // Clears the previous capture and begins recording
+        void StartCapture();
+        // Stops recording. The capture is kept until the next StartCapture.
+        void StopCapture();
+        // Stops recording and writes the capture to the file. Returns false if it could not be written.
+        bool StopCapture(const std::string& path);
+        void WriteTrace(std::ostream& out) const;
+
+        // Name shown for the calling thread's track
+        void SetThreadName(const std::string& name);
+
+        void BeginScope(const char * name);
+        void EndScope();
+        // For timings measured somewhere else (the GPU) which have already been converted to NowNs time
+        void RecordGpuEvent(const ProfileEvent& event);
+
+        // Returns the same id for the same name
+        u32 RegisterCounter(const char * name);
+        void AddCounter(const u32 id, const i64 value);
+        // Totals from the last frame which completed while capturing
+        i64 LastFrameCounter(const u32 id) const;
+
+        // Called once per frame by the main thread. Moves the events each thread recorded since the
+        // last call into the capture and samples then resets the counters.
+        void BeginFrame();
+
+        ProfilerStats Stats() const;
+
+    private:
+        struct OpenScope_ {
+            const char * name;
+            i64 startNs;
+        };
+
+        struct Track_ {
+            explicit Track_(const u32 id) : id(id), ring(16384) {}
+
+            u32 id;
+            ProfileEventRing ring;
+            std::string name;
+            // Only touched by the owning thread
+            OpenScope_ open[MaxScopeDepth];
+            u32 depth = 0;
+            // Set while a scope deeper than MaxScopeDepth is open
+            u32 overflow = 0;
+        };
+
+        struct CapturedEvent_ {
+            ProfileEvent event;
+            u32 track;
+        };
+
+        struct CounterSample_ {
+            u32 counter;
+            i64 timeNs;
+            i64 value;
+        };
+
+        Track_ * GetTrack_();
+        // Requires captureMutex_
+        void Drain_();
+        void SampleCounters_(const i64 timeNs);
+
+    private:
+        std::atomic<bool> capturing_{false};
+        std::atomic<u64> dropped_{0};
+
+        // Tracks are only ever added
+        mutable std::mutex tracksMutex_;
+        std::vector<std::unique_ptr<Track_>> tracks_;
+        std::unique_ptr<Track_> gpu_;
+
+        std::mutex countersMutex_;
+        std::atomic<i64> counters_[MaxCounters];
+        std::atomic<i64> lastFrameCounters_[MaxCounters];
+        const char * counterNames_[MaxCounters];
+        std::atomic<u32> numCounters_{0};
+
+        mutable std::mutex captureMutex_;
+        std::vector<ProfileEvent> drained_;
+        std::vector<CapturedEvent_> events_;
+        std::vector<CounterSample_> counterSamples_;
+        std::vector<i64> frames_;
+    };
+
+    // Times everything until the end of the enclosing block
+    class ProfileScope {
+    public:
+        explicit ProfileScope(const char * name) {
+            Profiler& profiler = Profiler::Instance();
+            if (profiler.IsCapturing()) {
+                active_ = true;
+                profiler.BeginScope(name);
+            }
+        }
+
+        ~ProfileScope() {
+            if (active_) Profiler::Instance().EndScope();
+        }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        bool active_ = false;
+    };
+}
+
+#define STRATUS_PROFILE_CONCAT_INNER_(a, b) a##b
+#define STRATUS_PROFILE_CONCAT_(a, b) STRATUS_PROFILE_CONCAT_INNER_(a, b)
+
+#if STRATUS_PROFILING_ENABLED
+    #define STRATUS_PROFILE_SCOPE(name) ::stratus::ProfileScope STRATUS_PROFILE_CONCAT_(profileScope, __LINE__)(name)
+    #define STRATUS_PROFILE_FUNCTION() STRATUS_PROFILE_SCOPE(__func__)
+    // value is only evaluated while capturing
+    #define STRATUS_PROFILE_COUNTER(name, value)                                            \
+        do {                                                                                \
+            ::stratus::Profiler& profiler_ = ::stratus::Profiler::Instance();               \
+            if (profiler_.IsCapturing()) {                                                  \
+                static const ::stratus::u32 counterId_ = profiler_.RegisterCounter(name);   \
+                profiler_.AddCounter(counterId_, ::stratus::i64(value));                    \
+            }                                                                               \
+        } while (0)
+    #define STRATUS_PROFILE_THREAD_NAME(name) ::stratus::Profiler::Instance().SetThreadName(name)
+    #define STRATUS_PROFILE_FRAME() ::stratus::Profiler::Instance().BeginFrame()
+#else
+    #define STRATUS_PROFILE_SCOPE(name) ((void)0)
+    #define STRATUS_PROFILE_FUNCTION() ((void)0)
+    #define STRATUS_PROFILE_COUNTER(name, value) ((void)0)
+    #define STRATUS_PROFILE_THREAD_NAME(name) ((void)0)
+    #define STRATUS_PROFILE_FRAME() ((void)0)
+#endif
@@ -6,7 +6,9 @@
 #include "StratusLog.h"
 #include "StratusTransformComponent.h"
 #include "StratusPoolAllocator.h"
+#include "StratusProfiler.h"
 #include "meshoptimizer.h"
+#include <cstring>
 
 namespace stratus {
     struct MeshAllocator {
@@ -82,6 +84,9 @@ namespace stratus {
         delete cpuData_;
         cpuData_ = nullptr;
 
+        // Never allocated space in the global buffers (see FinalizeWithoutGpuData)
+        if (indexOffsetPerLod_.empty()) return;
+
         auto vertexOffset = vertexOffset_;
         auto numVertices = numVertices_;
         auto indexOffsetPerLod = indexOffsetPerLod_;
@@ -404,7 +409,7 @@ namespace stratus {
         return total;
     }
 
-    void Meshlet::GenerateGpuData_() {
+    void Meshlet::AllocateGpuData() {
         EnsureNotFinalized_();
 
         if (cpuData_->indicesPerLod.size() == 0) {
@@ -417,16 +422,78 @@ namespace stratus {
         indexOffsetPerLod_.reserve(cpuData_->indicesPerLod.size());
         for (auto& indices : cpuData_->indicesPerLod) {
             indexOffsetPerLod_.push_back(GpuMeshAllocator::AllocateIndexData(indices.size()));
-            // Account for the fact that all vertices are stored in a global GpuBuffer and so
-            // the indices need to be offset
+        }
+    }
+
+    void Meshlet::FinalizeWithoutGpuData() {
+        EnsureNotFinalized_();
+        delete cpuData_;
+        cpuData_ = nullptr;
+    }
+
+    void Meshlet::OffsetIndices_() {
+        // Account for the fact that all vertices are stored in a global GpuBuffer and so
+        // the indices need to be offset
+        for (auto& indices : cpuData_->indicesPerLod) {
             for (usize i = 0; i < indices.size(); ++i) {
                 indices[i] += vertexOffset_;
             }
+        }
+    }
+
+    void Meshlet::StageGpuData(UploadQueue& uploads, const GpuBuffer& staging) {
+        EnsureNotFinalized_();
+        OffsetIndices_();
 
-            GpuMeshAllocator::CopyIndexData(indices, indexOffsetPerLod_[indexOffsetPerLod_.size() - 1]);
+        // Vertices followed by the indices of each LOD
+        usize sizeBytes = cpuData_->data.size() * sizeof(GpuMeshData);
+        for (const auto& indices : cpuData_->indicesPerLod) {
+            sizeBytes += indices.size() * sizeof(u32);
         }
 
-        GpuMeshAllocator::CopyVertexData(cpuData_->data, vertexOffset_);
+        const MeshCpuData_* data = cpuData_;
+        const auto write = [data](u8 * memory) {
+            const usize vertexBytes = data->data.size() * sizeof(GpuMeshData);
+            std::memcpy(memory, (const void *)data->data.data(), vertexBytes);
+            memory += vertexBytes;
+            for (const auto& indices : data->indicesPerLod) {
+                std::memcpy(memory, (const void *)indices.data(), indices.size() * sizeof(u32));
+                memory += indices.size() * sizeof(u32);
+            }
+        };
+
+        uploads.Stage(sizeBytes, write, [this, staging](const UploadSource& source) {
+            CopyGpuData_(staging, source);
+        });
+    }
+
+    void Meshlet::CopyGpuData_(const GpuBuffer& staging, const UploadSource& source) {
+        if (source.staged) {
+            uintptr_t offset = uintptr_t(source.offset);
+            GpuMeshAllocator::CopyVertexData(staging, offset, u32(cpuData_->data.size()), vertexOffset_);
+            offset += cpuData_->data.size() * sizeof(GpuMeshData);
+            for (usize lod = 0; lod < cpuData_->indicesPerLod.size(); ++lod) {
+                const auto& indices = cpuData_->indicesPerLod[lod];
+                GpuMeshAllocator::CopyIndexData(staging, offset, u32(indices.size()), indexOffsetPerLod_[lod]);
+                offset += indices.size() * sizeof(u32);
+            }
+        }
+        else {
+            for (usize lod = 0; lod < cpuData_->indicesPerLod.size(); ++lod) {
+                GpuMeshAllocator::CopyIndexData(cpuData_->indicesPerLod[lod], indexOffsetPerLod_[lod]);
+            }
+            GpuMeshAllocator::CopyVertexData(cpuData_->data, vertexOffset_);
+        }
+
+        // Clear CPU memory
+        delete cpuData_;
+        cpuData_ = nullptr;
+    }
+
+    void Meshlet::GenerateGpuData_() {
+        AllocateGpuData();
+        OffsetIndices_();
+        CopyGpuData_(GpuBuffer(), UploadSource());
 
         //_meshData = GpuBuffer((const void *)_cpuData->data.data(), _dataSizeBytes, GPU_MAP_READ);
         //_indices = GpuPrimitiveBuffer(GpuPrimitiveBindingPoint::ELEMENT_ARRAY_BUFFER, _cpuData->indices.data(), _cpuData->indices.size() * sizeof(u32));
@@ -454,10 +521,6 @@ namespace stratus {
 
         // // Bitangents
         // buffer.EnableAttribute(4, 3, GpuStorageType::FLOAT, false, stride, 11 * sizeof(f32));
-
-        // Clear CPU memory
-        delete cpuData_;
-        cpuData_ = nullptr;
     }
 
     void Meshlet::FinalizeData() {
@@ -488,6 +551,8 @@ namespace stratus {
         additionalBuffers.Bind();
 
         glDrawElementsInstanced(GL_TRIANGLES, numIndices_, GL_UNSIGNED_INT, (const void*)(GetIndexOffset(0) * sizeof(u32)), numInstances);
+        STRATUS_PROFILE_COUNTER("Draws", 1);
+        STRATUS_PROFILE_COUNTER("Triangles", (numIndices_ / 3) * numInstances);
 
         additionalBuffers.Unbind();
         //GpuMeshAllocator::UnbindElementArrayBuffer();
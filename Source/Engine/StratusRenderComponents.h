@@ -55,6 +55,15 @@ namespace stratus {
 
         bool IsFinalized() const;
         void FinalizeData();
+        // FinalizeData split up so the application thread only allocates and issues copies:
+        //      1) AllocateGpuData on the application thread reserves space in the global buffers
+        //      2) StageGpuData on any thread copies the data into staging memory and queues the GPU copy
+        // The meshlet is finalized once the application thread has issued the copy.
+        void AllocateGpuData();
+        void StageGpuData(UploadQueue&, const GpuBuffer& staging);
+        // Finalizes without allocating or copying any GPU data so only the bounds can be used
+        // afterwards. Call CalculateAabbs first. For headless runs (see EngineInitParams::headless).
+        void FinalizeWithoutGpuData();
 
         usize GetGpuSizeBytes() const;
 
@@ -82,6 +91,10 @@ namespace stratus {
 
     private:
         void GenerateGpuData_();
+        // Adds the vertex offset to every index once space is allocated
+        void OffsetIndices_();
+        // Runs on the application thread
+        void CopyGpuData_(const GpuBuffer& staging, const UploadSource&);
         void CalculateTangentsBitangents_();
         void EnsureFinalized_() const;
         void EnsureNotFinalized_() const;
@@ -142,9 +155,20 @@ namespace stratus {
         RenderFaceCulling cullMode_ = RenderFaceCulling::CULLING_CCW;
     };
 
+    // Where mesh data was loaded from so that it can be found again later (see FrameCapture).
+    // The file is empty for meshes which were not loaded from a model.
+    struct MeshSource {
+        std::string file;
+        bool optimizeGraph = false;
+        RenderFaceCulling defaultCullMode = RenderFaceCulling::CULLING_CCW;
+        // Depth first index of the model entity holding the data, counting only entities with meshes
+        u32 node = 0;
+    };
+
     struct MeshData {
         std::vector<MeshPtr> meshes;
         std::vector<glm::mat4> transforms;
+        MeshSource source;
 
         ~MeshData() {
             for (auto ptr : meshes) {
@@ -0,0 +1,489 @@
+#include "StratusRenderGraph.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace stratus {
+    static Bitfield BarrierForAccess(const RenderGraphAccess access) {
+        switch (access) {
+        case RenderGraphAccess::SAMPLED:
+            return RENDER_GRAPH_BARRIER_TEXTURE_FETCH;
+        case RenderGraphAccess::IMAGE_LOAD:
+        case RenderGraphAccess::IMAGE_STORE:
+            return RENDER_GRAPH_BARRIER_SHADER_IMAGE_ACCESS;
+        default:
+            // Attachments and blits both go through the frame buffer
+            return RENDER_GRAPH_BARRIER_FRAMEBUFFER;
+        }
+    }
+
+    static bool CanAlias(const TextureConfig& a, const TextureConfig& b) {
+        return a.type == b.type && a.format == b.format && a.storage == b.storage && a.dataType == b.dataType &&
+            a.width == b.width && a.height == b.height && a.depth == b.depth && a.generateMipMaps == b.generateMipMaps &&
+            a.virtualTexture == b.virtualTexture && a.virtualMipLevels == b.virtualMipLevels && a.compression == b.compression;
+    }
+
+    RenderGraphTextureId RenderGraph::CreateTexture(const std::string& name, const TextureConfig& config) {
+        return AddTexture_(name, config, false);
+    }
+
+    RenderGraphTextureId RenderGraph::ImportTexture(const std::string& name, const TextureConfig& config) {
+        return AddTexture_(name, config, true);
+    }
+
+    RenderGraphTextureId RenderGraph::AddTexture_(const std::string& name, const TextureConfig& config, const bool imported) {
+        compiled_ = false;
+        textures_.push_back(Texture_{name, config, imported});
+        return RenderGraphTextureId(textures_.size() - 1);
+    }
+
+    RenderGraphPassId RenderGraph::AddPass(const std::string& name, const ExecuteFunction& execute) {
+        compiled_ = false;
+        Pass_ pass;
+        pass.name = name;
+        pass.execute = execute;
+        passes_.push_back(std::move(pass));
+        return RenderGraphPassId(passes_.size() - 1);
+    }
+
+    void RenderGraph::SetExecute(const RenderGraphPassId pass, const ExecuteFunction& execute) {
+        GetPass_(pass).execute = execute;
+    }
+
+    void RenderGraph::Read(const RenderGraphPassId pass, const RenderGraphTextureId texture, const RenderGraphAccess access) {
+        GetTexture_(texture);
+        compiled_ = false;
+        GetPass_(pass).reads.push_back(Access_{texture, access});
+    }
+
+    void RenderGraph::Write(const RenderGraphPassId pass, const RenderGraphTextureId texture, const RenderGraphAccess access) {
+        GetTexture_(texture);
+        compiled_ = false;
+        GetPass_(pass).writes.push_back(Access_{texture, access});
+    }
+
+    void RenderGraph::SetSideEffect(const RenderGraphPassId pass) {
+        compiled_ = false;
+        GetPass_(pass).sideEffect = true;
+    }
+
+    void RenderGraph::Compile() {
+        Validate_();
+
+        stats_ = RenderGraphStats();
+        physicalTextures_.clear();
+        for (Pass_& pass : passes_) {
+            pass.culled = false;
+            pass.barriers = 0;
+        }
+        for (Texture_& texture : textures_) {
+            texture.physical = RENDER_GRAPH_INVALID_ID;
+        }
+
+        Cull_();
+        Alias_();
+        ComputeBarriers_();
+
+        compiled_ = true;
+    }
+
+    void RenderGraph::Execute(const BarrierFunction& barrier) const {
+        EnsureCompiled_();
+        for (const Pass_& pass : passes_) {
+            if (pass.culled) continue;
+            if (pass.barriers != 0 && barrier != nullptr) barrier(pass.barriers);
+            if (pass.execute != nullptr) pass.execute();
+        }
+    }
+
+    bool RenderGraph::IsPassCulled(const RenderGraphPassId pass) const {
+        EnsureCompiled_();
+        return GetPass_(pass).culled;
+    }
+
+    Bitfield RenderGraph::GetPassBarriers(const RenderGraphPassId pass) const {
+        EnsureCompiled_();
+        return GetPass_(pass).barriers;
+    }
+
+    u32 RenderGraph::GetPhysicalTexture(const RenderGraphTextureId texture) const {
+        EnsureCompiled_();
+        return GetTexture_(texture).physical;
+    }
+
+    const std::string& RenderGraph::GetPassName(const RenderGraphPassId pass) const {
+        return GetPass_(pass).name;
+    }
+
+    const std::string& RenderGraph::GetTextureName(const RenderGraphTextureId texture) const {
+        return GetTexture_(texture).name;
+    }
+
+    const TextureConfig& RenderGraph::GetTextureConfig(const RenderGraphTextureId texture) const {
+        return GetTexture_(texture).config;
+    }
+
+    bool RenderGraph::IsImported(const RenderGraphTextureId texture) const {
+        return GetTexture_(texture).imported;
+    }
+
+    usize RenderGraph::TextureBytes(const TextureConfig& config) {
+        usize layers = 1;
+        switch (config.type) {
+        case TextureType::TEXTURE_2D_ARRAY:
+        case TextureType::TEXTURE_3D:
+            layers = std::max<usize>(config.depth, 1);
+            break;
+        case TextureType::TEXTURE_CUBE_MAP:
+            layers = 6;
+            break;
+        case TextureType::TEXTURE_CUBE_MAP_ARRAY:
+            layers = 6 * std::max<usize>(config.depth, 1);
+            break;
+        default:
+            break;
+        }
+
+        usize bitsPerTexel = 0;
+        switch (config.compression) {
+        case TextureCompression::BC1:
+        case TextureCompression::BC4:
+            bitsPerTexel = 4;
+            break;
+        case TextureCompression::BC5:
+        case TextureCompression::BC7:
+            bitsPerTexel = 8;
+            break;
+        default: {
+            usize channels = 4;
+            switch (config.format) {
+            case TextureComponentFormat::RED:
+            case TextureComponentFormat::DEPTH:
+                channels = 1;
+                break;
+            case TextureComponentFormat::RG:
+                channels = 2;
+                break;
+            case TextureComponentFormat::RGB:
+            case TextureComponentFormat::SRGB:
+                channels = 3;
+                break;
+            default:
+                break;
+            }
+
+            const bool depth = config.format == TextureComponentFormat::DEPTH || config.format == TextureComponentFormat::DEPTH_STENCIL;
+            switch (config.storage) {
+            case TextureComponentSize::BITS_8:
+                bitsPerTexel = 8 * channels;
+                break;
+            case TextureComponentSize::BITS_16:
+                bitsPerTexel = 16 * channels;
+                break;
+            case TextureComponentSize::BITS_32:
+                bitsPerTexel = 32 * channels;
+                break;
+            case TextureComponentSize::BITS_11_11_10:
+                bitsPerTexel = 32;
+                break;
+            default:
+                // Depth defaults to 24 bits which is padded out to 32 (or packed with 8 bits of stencil)
+                bitsPerTexel = depth ? 32 : 8 * channels;
+                break;
+            }
+
+            // Depth-stencil is stored as a single packed value (24+8 or 32+8 padded to 64)
+            if (config.format == TextureComponentFormat::DEPTH_STENCIL) {
+                bitsPerTexel = config.storage == TextureComponentSize::BITS_32 ? 64 : 32;
+            }
+            break;
+        }
+        }
+
+        usize width = std::max<usize>(config.width, 1);
+        usize height = std::max<usize>(config.height, 1);
+        usize bytes = 0;
+        while (true) {
+            bytes += (width * height * layers * bitsPerTexel + 7) / 8;
+            if (!config.generateMipMaps || (width == 1 && height == 1)) break;
+            width = std::max<usize>(width / 2, 1);
+            height = std::max<usize>(height / 2, 1);
+        }
+
+        return bytes;
+    }
+
+    RenderGraph::Pass_& RenderGraph::GetPass_(const RenderGraphPassId pass) {
+        if (pass >= passes_.size()) throw std::runtime_error("Invalid render graph pass");
+        return passes_[pass];
+    }
+
+    const RenderGraph::Pass_& RenderGraph::GetPass_(const RenderGraphPassId pass) const {
+        if (pass >= passes_.size()) throw std::runtime_error("Invalid render graph pass");
+        return passes_[pass];
+    }
+
+    const RenderGraph::Texture_& RenderGraph::GetTexture_(const RenderGraphTextureId texture) const {
+        if (texture >= textures_.size()) throw std::runtime_error("Invalid render graph texture");
+        return textures_[texture];
+    }
+
+    void RenderGraph::EnsureCompiled_() const {
+        if (!compiled_) throw std::runtime_error("Render graph has not been compiled");
+    }
+
+    void RenderGraph::Validate_() const {
+        std::vector<bool> written(textures_.size(), false);
+        for (usize i = 0; i < textures_.size(); ++i) {
+            written[i] = textures_[i].imported;
+        }
+
+        for (const Pass_& pass : passes_) {
+            for (const Access_& read : pass.reads) {
+                if (!written[read.texture]) {
+                    throw std::runtime_error("Render graph pass " + pass.name + " reads " +
+                        textures_[read.texture].name + " before anything writes it");
+                }
+            }
+
+            for (const Access_& write : pass.writes) {
+                written[write.texture] = true;
+            }
+        }
+    }
+
+    void RenderGraph::Cull_() {
+        // Walk backwards from the passes which have to run, keeping anything which writes a texture
+        // a kept pass reads
+        std::vector<bool> needed(textures_.size(), false);
+        for (usize i = passes_.size(); i > 0; --i) {
+            Pass_& pass = passes_[i - 1];
+            bool keep = pass.sideEffect;
+            for (const Access_& write : pass.writes) {
+                keep = keep || textures_[write.texture].imported || needed[write.texture];
+            }
+
+            pass.culled = !keep;
+            if (pass.culled) {
+                ++stats_.culledPasses;
+                continue;
+            }
+
+            for (const Access_& read : pass.reads) {
+                needed[read.texture] = true;
+            }
+        }
+
+        stats_.passes = passes_.size();
+    }
+
+    void RenderGraph::Alias_() {
+        // Lifetimes are measured in pass indices
+        std::vector<u32> firstUse(textures_.size(), RENDER_GRAPH_INVALID_ID);
+        std::vector<u32> lastUse(textures_.size(), 0);
+        for (u32 i = 0; i < passes_.size(); ++i) {
+            const Pass_& pass = passes_[i];
+            if (pass.culled) continue;
+
+            for (const std::vector<Access_> * accesses : { &pass.reads, &pass.writes }) {
+                for (const Access_& access : *accesses) {
+                    firstUse[access.texture] = std::min(firstUse[access.texture], i);
+                    lastUse[access.texture] = std::max(lastUse[access.texture], i);
+                }
+            }
+        }
+
+        std::vector<RenderGraphTextureId> live;
+        for (RenderGraphTextureId i = 0; i < textures_.size(); ++i) {
+            const Texture_& texture = textures_[i];
+            if (texture.imported) continue;
+
+            const usize bytes = TextureBytes(texture.config);
+            ++stats_.transientTextures;
+            stats_.declaredBytes += bytes;
+
+            if (firstUse[i] == RENDER_GRAPH_INVALID_ID) {
+                ++stats_.culledTextures;
+                continue;
+            }
+
+            stats_.usedBytes += bytes;
+            live.push_back(i);
+        }
+
+        // Handing out slots in order of first use with first fit needs the fewest slots for
+        // each group of compatible textures
+        std::stable_sort(live.begin(), live.end(), [&firstUse](const RenderGraphTextureId a, const RenderGraphTextureId b) {
+            return firstUse[a] < firstUse[b];
+        });
+
+        std::vector<u32> slotLastUse;
+        for (const RenderGraphTextureId id : live) {
+            Texture_& texture = textures_[id];
+            for (u32 slot = 0; slot < physicalTextures_.size(); ++slot) {
+                if (slotLastUse[slot] < firstUse[id] && CanAlias(physicalTextures_[slot], texture.config)) {
+                    texture.physical = slot;
+                    break;
+                }
+            }
+
+            if (texture.physical == RENDER_GRAPH_INVALID_ID) {
+                texture.physical = u32(physicalTextures_.size());
+                physicalTextures_.push_back(texture.config);
+                slotLastUse.push_back(0);
+                stats_.allocatedBytes += TextureBytes(texture.config);
+            }
+
+            slotLastUse[texture.physical] = lastUse[id];
+        }
+
+        stats_.physicalTextures = physicalTextures_.size();
+    }
+
+    void RenderGraph::ComputeBarriers_() {
+        // Tracked per piece of memory rather than per texture so that a texture reusing another's
+        // memory waits for the previous owner's writes
+        struct MemoryState_ {
+            // Written with IMAGE_STORE and not yet made visible to every kind of access
+            bool pendingStore = false;
+            Bitfield visible = 0;
+        };
+
+        const usize physical = physicalTextures_.size();
+        std::vector<MemoryState_> memory(physical + textures_.size());
+        const auto memoryIndex = [this, physical](const RenderGraphTextureId texture) {
+            const Texture_& t = textures_[texture];
+            return t.imported ? physical + texture : usize(t.physical);
+        };
+
+        for (Pass_& pass : passes_) {
+            if (pass.culled) continue;
+
+            Bitfield barriers = 0;
+            for (const std::vector<Access_> * accesses : { &pass.reads, &pass.writes }) {
+                for (const Access_& access : *accesses) {
+                    const MemoryState_& state = memory[memoryIndex(access.texture)];
+                    const Bitfield bit = BarrierForAccess(access.access);
+                    if (state.pendingStore && (state.visible & bit) == 0) barriers |= bit;
+                }
+            }
+
+            // Barriers apply to all memory, not just the textures which asked for them
+            if (barriers != 0) {
+                for (MemoryState_& state : memory) {
+                    if (state.pendingStore) state.visible |= barriers;
+                }
+            }
+
+            for (const Access_& write : pass.writes) {
+                MemoryState_& state = memory[memoryIndex(write.texture)];
+                state.pendingStore = write.access == RenderGraphAccess::IMAGE_STORE;
+                state.visible = 0;
+            }
+
+            pass.barriers = barriers;
+        }
+    }
+
+    static TextureConfig PostFxTextureConfig(const u32 width, const u32 height, const TextureComponentFormat format, const TextureComponentSize size) {
+        return TextureConfig{ TextureType::TEXTURE_2D, format, size, TextureComponentType::FLOAT, width, height, 0, false };
+    }
+
+    static PostFxRenderGraphPass AddPostFxPass(RenderGraph& graph, const std::string& name,
+                                               const RenderGraphTextureId input, const RenderGraphTextureId output) {
+        PostFxRenderGraphPass pass;
+        pass.pass = graph.AddPass(name);
+        pass.input = input;
+        pass.output = output;
+        graph.Read(pass.pass, input);
+        graph.Write(pass.pass, output);
+        return pass;
+    }
+
+    PostFxRenderGraph BuildPostFxRenderGraph(RenderGraph& graph, const PostFxRenderGraphParams& params) {
+        const u32 width = params.viewportWidth;
+        const u32 height = params.viewportHeight;
+        const TextureConfig hdr = PostFxTextureConfig(width, height, TextureComponentFormat::RGBA, TextureComponentSize::BITS_16);
+        const TextureConfig ldr = PostFxTextureConfig(width, height, TextureComponentFormat::RGBA, TextureComponentSize::BITS_8);
+
+        PostFxRenderGraph fx;
+        fx.scene = graph.ImportTexture("Scene", PostFxTextureConfig(width, height, TextureComponentFormat::RGB, TextureComponentSize::BITS_16));
+        fx.history = graph.ImportTexture("TaaHistory", PostFxTextureConfig(width, height, TextureComponentFormat::RGB, TextureComponentSize::BITS_8));
+        fx.screen = graph.ImportTexture("Screen", ldr);
+
+        // Output of the last enabled effect
+        RenderGraphTextureId current = fx.scene;
+
+        fx.taa = AddPostFxPass(graph, "TAA", current, graph.CreateTexture("TAA", hdr));
+        graph.Read(fx.taa.pass, fx.history);
+        if (params.taaEnabled) {
+            current = fx.taa.output;
+            // History only moves forward while TAA is running (this would otherwise keep TAA alive)
+            fx.taaHistory.pass = graph.AddPass("TaaHistory");
+            fx.taaHistory.input = current;
+            fx.taaHistory.output = fx.history;
+            graph.Read(fx.taaHistory.pass, current, RenderGraphAccess::COPY_SOURCE);
+            graph.Write(fx.taaHistory.pass, fx.history, RenderGraphAccess::COPY_DEST);
+        }
+
+        // Bloom halves the resolution up to 8 times, stopping before either side drops below 8 pixels
+        std::vector<std::pair<u32, u32>> levels;
+        for (u32 levelWidth = width / 2, levelHeight = height / 2; levels.size() < 8 && levelWidth >= 8 && levelHeight >= 8;
+             levelWidth /= 2, levelHeight /= 2) {
+            levels.push_back(std::make_pair(levelWidth, levelHeight));
+        }
+
+        const RenderGraphTextureId bloomInput = current;
+        std::vector<RenderGraphTextureId> blurred;
+        for (usize i = 0; i < levels.size(); ++i) {
+            const std::string level = std::to_string(i);
+            const TextureConfig config = PostFxTextureConfig(levels[i].first, levels[i].second, TextureComponentFormat::RGBA, TextureComponentSize::BITS_16);
+
+            // Each level downsamples the previous level before it was blurred
+            const RenderGraphTextureId downsampleInput = i == 0 ? bloomInput : fx.bloomDownsample[i - 1].output;
+            fx.bloomDownsample.push_back(AddPostFxPass(graph, "BloomDownsample" + level, downsampleInput,
+                graph.CreateTexture("BloomDownsample" + level, config)));
+
+            RenderGraphTextureId blurInput = fx.bloomDownsample[i].output;
+            for (int blur = 0; blur < 2; ++blur) {
+                const std::string name = "BloomBlur" + level + "_" + std::to_string(blur);
+                fx.bloomBlur.push_back(AddPostFxPass(graph, name, blurInput, graph.CreateTexture(name, config)));
+                blurInput = fx.bloomBlur.back().output;
+            }
+            blurred.push_back(blurInput);
+        }
+
+        // Upsampling combines the level below with the blurred level at the new size, finishing with
+        // the original image at full resolution
+        RenderGraphTextureId upsampled = blurred.size() > 0 ? blurred.back() : bloomInput;
+        for (usize i = levels.size(); i > 0; --i) {
+            const usize level = i - 1;
+            const bool fullResolution = level == 0;
+            const u32 levelWidth = fullResolution ? width : levels[level - 1].first;
+            const u32 levelHeight = fullResolution ? height : levels[level - 1].second;
+            const std::string name = "BloomUpsample" + std::to_string(level);
+            const TextureConfig config = PostFxTextureConfig(levelWidth, levelHeight, TextureComponentFormat::RGBA, TextureComponentSize::BITS_16);
+
+            PostFxRenderGraphPass pass = AddPostFxPass(graph, name, upsampled, graph.CreateTexture(name, config));
+            pass.secondary = fullResolution ? bloomInput : blurred[level - 1];
+            graph.Read(pass.pass, pass.secondary);
+            fx.bloomUpsample.push_back(pass);
+            upsampled = pass.output;
+        }
+        if (params.bloomEnabled) current = upsampled;
+
+        fx.atmospheric = AddPostFxPass(graph, "Atmospheric", current, graph.CreateTexture("Atmospheric", hdr));
+        if (params.atmosphericEnabled) current = fx.atmospheric.output;
+
+        // Always runs and has to come before FXAA since FXAA works on tonemapped LDR values
+        fx.tonemap = AddPostFxPass(graph, "Tonemap", current, graph.CreateTexture("Tonemap", ldr));
+        current = fx.tonemap.output;
+
+        fx.fxaaLuminance = AddPostFxPass(graph, "FxaaLuminance", current, graph.CreateTexture("FxaaLuminance", ldr));
+        fx.fxaaSmoothing = AddPostFxPass(graph, "FxaaSmoothing", fx.fxaaLuminance.output, graph.CreateTexture("FxaaSmoothing", ldr));
+        if (params.fxaaEnabled) current = fx.fxaaSmoothing.output;
+
+        fx.present = AddPostFxPass(graph, "Present", current, fx.screen);
+
+        return fx;
+    }
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "StratusCommon.h"
+#include "StratusGpuBuffer.h"
+#include "StratusTexture.h"
+#include "StratusTypes.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace stratus {
+    typedef u32 RenderGraphTextureId;
+    typedef u32 RenderGraphPassId;
+
+    constexpr u32 RENDER_GRAPH_INVALID_ID = 0xFFFFFFFF;
+
+    // How a pass touches a texture. Decides which memory barriers are needed between passes.
+    enum class RenderGraphAccess : i32 {
+        // Read through a sampler
+        SAMPLED,
+        // Rendered to as part of a frame buffer
+        COLOR_ATTACHMENT,
+        DEPTH_ATTACHMENT,
+        // imageLoad/imageStore from a shader (incoherent)
+        IMAGE_LOAD,
+        IMAGE_STORE,
+        // Source or destination of a frame buffer blit
+        COPY_SOURCE,
+        COPY_DEST
+    };
+
+    // Barriers a pass needs before it runs. These mirror glMemoryBarrier bits and RendererBackend
+    // translates them so that the graph itself never touches GL.
+    //
+    // Writes through frame buffers are ordered for later commands by GL already, so barriers are
+    // only needed after IMAGE_STORE.
+    constexpr Bitfield RENDER_GRAPH_BARRIER_TEXTURE_FETCH = BITMASK64_POW2(0);
+    constexpr Bitfield RENDER_GRAPH_BARRIER_SHADER_IMAGE_ACCESS = BITMASK64_POW2(1);
+    constexpr Bitfield RENDER_GRAPH_BARRIER_FRAMEBUFFER = BITMASK64_POW2(2);
+
+    struct RenderGraphStats {
+        usize passes = 0;
+        usize culledPasses = 0;
+        // Imported textures are not counted
+        usize transientTextures = 0;
+        usize culledTextures = 0;
+        usize physicalTextures = 0;
+        // Memory needed if every transient texture had its own allocation (whether or not it is used)
+        usize declaredBytes = 0;
+        // Memory needed for the textures which survived culling without aliasing
+        usize usedBytes = 0;
+        // Memory actually allocated after aliasing
+        usize allocatedBytes = 0;
+
+        usize SavedBytes() const { return declaredBytes - allocatedBytes; }
+    };
+
+    // Describes a frame as a list of passes and the textures they read and write. Compile works
+    // out which passes contribute to the output, the barriers between them and which transient
+    // textures can share memory. It is pure CPU work so it can be tested without a GL context.
+    //
+    // Passes run in the order they were added, so every texture has to be written by an earlier
+    // pass before it is read (imported textures excepted).
+    //
+    // A pass is culled if nothing it writes is read by a pass which survives. Passes which write
+    // imported textures or are marked with SetSideEffect are always kept.
+    //
+    // Transient textures are aliased when their lifetimes (first to last surviving pass which
+    // touches them) don't overlap. GL has no way to place different textures in the same memory so
+    // only textures with identical configs are aliased - they end up being the same texture.
+    class RenderGraph {
+    public:
+        typedef std::function<void (void)> ExecuteFunction;
+        typedef std::function<void (const Bitfield barriers)> BarrierFunction;
+
+        RenderGraph() {}
+
+        RenderGraph(const RenderGraph&) = delete;
+        RenderGraph(RenderGraph&&) = default;
+        RenderGraph& operator=(const RenderGraph&) = delete;
+        RenderGraph& operator=(RenderGraph&&) = default;
+
+        // Only lives for the passes which use it and may share memory with other textures
+        RenderGraphTextureId CreateTexture(const std::string& name, const TextureConfig& config);
+        // Owned outside of the graph (history buffers, the screen). Never aliased and writing to one
+        // keeps the pass alive.
+        RenderGraphTextureId ImportTexture(const std::string& name, const TextureConfig& config);
+
+        RenderGraphPassId AddPass(const std::string& name, const ExecuteFunction& execute = nullptr);
+        void SetExecute(const RenderGraphPassId pass, const ExecuteFunction& execute);
+        void Read(const RenderGraphPassId pass, const RenderGraphTextureId texture, const RenderGraphAccess access = RenderGraphAccess::SAMPLED);
+        void Write(const RenderGraphPassId pass, const RenderGraphTextureId texture, const RenderGraphAccess access = RenderGraphAccess::COLOR_ATTACHMENT);
+        // For passes with effects the graph can't see, such as writing to a buffer
+        void SetSideEffect(const RenderGraphPassId pass);
+
+        // Throws std::runtime_error if a texture is read before anything writes it
+        void Compile();
+        bool IsCompiled() const { return compiled_; }
+
+        // Runs every pass which survived culling, calling barrier first when a pass needs one
+        void Execute(const BarrierFunction& barrier) const;
+
+        // Everything below requires Compile
+        bool IsPassCulled(const RenderGraphPassId pass) const;
+        Bitfield GetPassBarriers(const RenderGraphPassId pass) const;
+        // Index into GetPhysicalTextures, or RENDER_GRAPH_INVALID_ID for imported or culled textures
+        u32 GetPhysicalTexture(const RenderGraphTextureId texture) const;
+        const std::vector<TextureConfig>& GetPhysicalTextures() const { return physicalTextures_; }
+        const RenderGraphStats& Stats() const { return stats_; }
+
+        usize NumPasses() const { return passes_.size(); }
+        usize NumTextures() const { return textures_.size(); }
+        const std::string& GetPassName(const RenderGraphPassId pass) const;
+        const std::string& GetTextureName(const RenderGraphTextureId texture) const;
+        const TextureConfig& GetTextureConfig(const RenderGraphTextureId texture) const;
+        bool IsImported(const RenderGraphTextureId texture) const;
+
+        // Estimate of how much memory a texture with this config needs. Drivers may pad (RGB is
+        // often stored as RGBA) so this is a lower bound.
+        static usize TextureBytes(const TextureConfig& config);
+
+    private:
+        struct Access_ {
+            RenderGraphTextureId texture;
+            RenderGraphAccess access;
+        };
+
+        struct Pass_ {
+            std::string name;
+            ExecuteFunction execute;
+            std::vector<Access_> reads;
+            std::vector<Access_> writes;
+            bool sideEffect = false;
+            // Set by Compile
+            bool culled = false;
+            Bitfield barriers = 0;
+        };
+
+        struct Texture_ {
+            std::string name;
+            TextureConfig config;
+            bool imported;
+            // Set by Compile
+            u32 physical = RENDER_GRAPH_INVALID_ID;
+        };
+
+        RenderGraphTextureId AddTexture_(const std::string& name, const TextureConfig& config, const bool imported);
+        Pass_& GetPass_(const RenderGraphPassId pass);
+        const Pass_& GetPass_(const RenderGraphPassId pass) const;
+        const Texture_& GetTexture_(const RenderGraphTextureId texture) const;
+        void EnsureCompiled_() const;
+        void Validate_() const;
+        void Cull_();
+        void Alias_();
+        void ComputeBarriers_();
+
+    private:
+        std::vector<Pass_> passes_;
+        std::vector<Texture_> textures_;
+        std::vector<TextureConfig> physicalTextures_;
+        RenderGraphStats stats_;
+        bool compiled_ = false;
+    };
+
+    struct PostFxRenderGraphParams {
+        u32 viewportWidth = 0;
+        u32 viewportHeight = 0;
+        bool taaEnabled = false;
+        bool bloomEnabled = false;
+        // Atmospheric fog is only applied while the world light is enabled
+        bool atmosphericEnabled = false;
+        bool fxaaEnabled = false;
+
+        bool operator==(const PostFxRenderGraphParams& other) const {
+            return viewportWidth == other.viewportWidth && viewportHeight == other.viewportHeight &&
+                taaEnabled == other.taaEnabled && bloomEnabled == other.bloomEnabled &&
+                atmosphericEnabled == other.atmosphericEnabled && fxaaEnabled == other.fxaaEnabled;
+        }
+
+        bool operator!=(const PostFxRenderGraphParams& other) const {
+            return !(*this == other);
+        }
+    };
+
+    struct PostFxRenderGraphPass {
+        RenderGraphPassId pass = RENDER_GRAPH_INVALID_ID;
+        RenderGraphTextureId input = RENDER_GRAPH_INVALID_ID;
+        RenderGraphTextureId output = RENDER_GRAPH_INVALID_ID;
+        // Only used by bloom upsampling, which adds a blurred level (or the original screen) back in
+        RenderGraphTextureId secondary = RENDER_GRAPH_INVALID_ID;
+    };
+
+    // Passes and textures of RendererBackend's post processing chain
+    struct PostFxRenderGraph {
+        // Lighting result everything starts from
+        RenderGraphTextureId scene = RENDER_GRAPH_INVALID_ID;
+        // Last frame's TAA output
+        RenderGraphTextureId history = RENDER_GRAPH_INVALID_ID;
+        // Default frame buffer
+        RenderGraphTextureId screen = RENDER_GRAPH_INVALID_ID;
+
+        PostFxRenderGraphPass taa;
+        // Only added while TAA is enabled
+        PostFxRenderGraphPass taaHistory;
+        // One per bloom level, largest first
+        std::vector<PostFxRenderGraphPass> bloomDownsample;
+        // Two separable blur passes per level
+        std::vector<PostFxRenderGraphPass> bloomBlur;
+        // Smallest level first, the last one writes at full resolution
+        std::vector<PostFxRenderGraphPass> bloomUpsample;
+        PostFxRenderGraphPass atmospheric;
+        PostFxRenderGraphPass tonemap;
+        PostFxRenderGraphPass fxaaLuminance;
+        PostFxRenderGraphPass fxaaSmoothing;
+        PostFxRenderGraphPass present;
+    };
+
+    // Declares every effect whether or not it is enabled. Disabled effects are skipped over when
+    // wiring up the chain so nothing reads their output and Compile culls them.
+    PostFxRenderGraph BuildPostFxRenderGraph(RenderGraph& graph, const PostFxRenderGraphParams& params);
+}
@@ -9,6 +9,8 @@
 #include <algorithm>
 #include <random>
 #include <numeric>
+#include <chrono>
+#include <sstream>
 #include <ctime>
 #include "StratusUtils.h"
 #include "StratusMath.h"
@@ -18,8 +20,13 @@
 #include "StratusEngine.h"
 #include "StratusWindow.h"
 #include "StratusGraphicsDriver.h"
+#include "StratusVplCulling.h"
+#include "StratusGpuProfiler.h"
 
 namespace stratus {
+// One csm depth shader variant per cascade
+static constexpr u32 maxCascades = 6;
+
 bool IsRenderable(const EntityPtr& p) {
     return p->Components().ContainsComponent<RenderComponent>();
 }
@@ -71,9 +78,18 @@ RendererBackend::RendererBackend(const uint32_t width, const uint32_t height, co
         throw std::runtime_error("Unable to initialize renderer - driver does not support OpenGL 4.6");
     }
 
+    gpuProfiler_ = std::make_unique<GpuProfiler>();
+
     const std::filesystem::path shaderRoot("../Source/Shaders");
     const ShaderApiVersion version{GraphicsDriver::GetConfig().majorVersion, GraphicsDriver::GetConfig().minorVersion};
 
+    // Linked programs are cached on disk when the driver can give them back to us
+    GLint numProgramBinaryFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numProgramBinaryFormats);
+    if (numProgramBinaryFormats > 0 && Pipeline::GetProgramCache() == nullptr) {
+        Pipeline::SetProgramCache(std::make_shared<ShaderProgramCache>("ShaderCache"));
+    }
+
     // Initialize the pipelines
     state_.depthPrepass = std::unique_ptr<Pipeline>(new Pipeline(shaderRoot, version, {
         Shader{"depth.vs", ShaderType::VERTEX}, 
@@ -92,17 +108,12 @@ RendererBackend::RendererBackend(const uint32_t width, const uint32_t height, co
 
     using namespace std;
 
-    state_.skybox = std::unique_ptr<Pipeline>(new Pipeline(shaderRoot, version, {
+    state_.skybox = std::unique_ptr<PipelinePermutations>(new PipelinePermutations(shaderRoot, version, {
         Shader{"skybox.vs", ShaderType::VERTEX}, 
-        Shader{"skybox.fs", ShaderType::FRAGMENT}}));
-    state_.shaders.push_back(state_.skybox.get());
-
-    state_.skyboxLayered = std::unique_ptr<Pipeline>(new Pipeline(shaderRoot, version, {
-        Shader{"skybox.vs", ShaderType::VERTEX},
-        Shader{"skybox.fs", ShaderType::FRAGMENT} },
-        // Defines
-        { {"USE_LAYERED_RENDERING", "1"} }));
-    state_.shaders.push_back(state_.skyboxLayered.get());
+        Shader{"skybox.fs", ShaderType::FRAGMENT}},
+        // Features
+        ShaderFeatureSet({ {"USE_LAYERED_RENDERING"} })));
+    state_.permutations.push_back(state_.skybox.get());
 
     // Set up the hdr/gamma postprocessing shader
 
@@ -126,42 +137,25 @@ RendererBackend::RendererBackend(const uint32_t width, const uint32_t height, co
     ));
     state_.shaders.push_back(state_.vplShadows.get());
 
-    state_.lighting = std::unique_ptr<Pipeline>(new Pipeline(shaderRoot, version, {
+    state_.lighting = std::unique_ptr<PipelinePermutations>(new PipelinePermutations(shaderRoot, version, {
         Shader{"pbr.vs", ShaderType::VERTEX},
-        Shader{"pbr.fs", ShaderType::FRAGMENT}}));
-    state_.shaders.push_back(state_.lighting.get());
-
-    state_.lightingWithInfiniteLight = std::unique_ptr<Pipeline>(new Pipeline(shaderRoot, version, {
-        Shader{"pbr.vs", ShaderType::VERTEX},
-        Shader{"pbr.fs", ShaderType::FRAGMENT} },
-        {{"INFINITE_LIGHTING_ENABLED", "1"}}));
-    state_.shaders.push_back(state_.lightingWithInfiniteLight.get());
+        Shader{"pbr.fs", ShaderType::FRAGMENT}},
+        // Features
+        ShaderFeatureSet({ {"INFINITE_LIGHTING_ENABLED"} })));
+    state_.permutations.push_back(state_.lighting.get());
 
     state_.bloom = std::unique_ptr<Pipeline>(new Pipeline(shaderRoot, version, {
         Shader{"bloom.vs", ShaderType::VERTEX},
         Shader{"bloom.fs", ShaderType::FRAGMENT}}));
     state_.shaders.push_back(state_.bloom.get());
 
-    for (int i = 0; i < 6; ++i) {
-        state_.csmDepth.push_back(std::unique_ptr<Pipeline>(new Pipeline(shaderRoot, version, {
-            Shader{"csm.vs", ShaderType::VERTEX},
-            //Shader{"csm.gs", ShaderType::GEOMETRY},
-            Shader{"csm.fs", ShaderType::FRAGMENT}},
-            // Defines
-            {{"DEPTH_LAYER", std::to_string(i)}}))
-        );
-        state_.shaders.push_back(state_.csmDepth[i].get());
-
-        state_.csmDepthRunAlphaTest.push_back(std::unique_ptr<Pipeline>(new Pipeline(shaderRoot, version, {
-            Shader{"csm.vs", ShaderType::VERTEX},
-            //Shader{"csm.gs", ShaderType::GEOMETRY},
-            Shader{"csm.fs", ShaderType::FRAGMENT}},
-            // Defines
-            {{"DEPTH_LAYER", std::to_string(i)},
-             {"RUN_CSM_ALPHA_TEST", "1"}}))
-        );
-        state_.shaders.push_back(state_.csmDepthRunAlphaTest[i].get());
-    }
+    state_.csmDepth = std::unique_ptr<PipelinePermutations>(new PipelinePermutations(shaderRoot, version, {
+        Shader{"csm.vs", ShaderType::VERTEX},
+        //Shader{"csm.gs", ShaderType::GEOMETRY},
+        Shader{"csm.fs", ShaderType::FRAGMENT}},
+        // Features
+        ShaderFeatureSet({ {"DEPTH_LAYER", maxCascades}, {"RUN_CSM_ALPHA_TEST"} })));
+    state_.permutations.push_back(state_.csmDepth.get());
 
     state_.ssaoOcclude = std::unique_ptr<Pipeline>(new Pipeline(shaderRoot, version, {
         Shader{"ssao.vs", ShaderType::VERTEX},
@@ -250,8 +244,21 @@ RendererBackend::RendererBackend(const uint32_t width, const uint32_t height, co
     // Create the screen quad
     state_.screenQuad = ResourceManager::Instance()->CreateQuad();
 
+    // Variants are compiled the first time they are used. Prepare the ones every scene with a world light
+    // needs in the background so that first use only has to compile them.
+    std::vector<ShaderVariantKey> csmVariants;
+    for (u32 cascade = 0; cascade < maxCascades; ++cascade) {
+        csmVariants.push_back(CsmDepthVariant_(cascade, false));
+    }
+    state_.csmDepth->Prewarm(csmVariants);
+    state_.lighting->Prewarm({ LightingVariant_(true) });
+
     // Use the shader isValid() method to determine if everything succeeded
+    const auto compileStart = std::chrono::steady_clock::now();
+    Pipeline::CompileAll(state_.shaders);
     ValidateAllShaders_();
+    const auto compileEnd = std::chrono::steady_clock::now();
+    LogShaderCompile_(state_.shaders.size(), std::chrono::duration<double, std::milli>(compileEnd - compileStart).count());
 
     // Init constant SSAO data
     InitSSAO_();
@@ -314,21 +321,68 @@ void RendererBackend::ValidateAllShaders_() {
     for (Pipeline * p : state_.shaders) {
         isValid_ = isValid_ && p->IsValid();
     }
+    // Variants which have not been used yet are left alone so they are still compiled lazily
+    for (PipelinePermutations * permutations : state_.permutations) {
+        for (Pipeline * p : permutations->Variants()) {
+            if (!p->IsCompilePending()) isValid_ = isValid_ && p->IsValid();
+        }
+    }
+}
+
+ShaderVariantKey RendererBackend::CsmDepthVariant_(const u32 cascade, const bool runAlphaTest) const {
+    const ShaderFeatureSet& features = state_.csmDepth->Features();
+    return features.Set(features.Set(0, 0, cascade), 1, runAlphaTest ? 1 : 0);
+}
+
+ShaderVariantKey RendererBackend::LightingVariant_(const bool infiniteLightEnabled) const {
+    return state_.lighting->Features().Set(0, 0, infiniteLightEnabled ? 1 : 0);
+}
+
+std::vector<PipelineVariantStats> RendererBackend::GetShaderVariantStats() const {
+    std::vector<PipelineVariantStats> result;
+    for (PipelinePermutations * permutations : state_.permutations) {
+        const auto stats = permutations->GetStats();
+        result.insert(result.end(), stats.begin(), stats.end());
+    }
+    return result;
 }
 
 RendererBackend::~RendererBackend() {
     for (Pipeline * shader : shaders_) delete shader;
     shaders_.clear();
 
+    for (auto& readback : state_.vpls.cascadeDepthReadbacks) HostDeleteFence(readback.fence);
+    state_.vpls.cascadeDepthReadbacks.clear();
+    for (auto& readback : state_.vpls.colorReadbacks) HostDeleteFence(readback.fence);
+    state_.vpls.colorReadbacks.clear();
+
     // Delete the main frame buffer
     ClearGBuffer_();
 }
 
 void RendererBackend::RecompileShaders() {
-    for (Pipeline* p : state_.shaders) {
-        p->Recompile();
-    }
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Pipeline *> pipelines = state_.shaders;
+    for (PipelinePermutations * permutations : state_.permutations) {
+        const auto variants = permutations->Variants();
+        pipelines.insert(pipelines.end(), variants.begin(), variants.end());
+    }
+    const std::vector<Pipeline *> changed = Pipeline::ReloadChanged(pipelines);
+    if (changed.size() == 0) return;
     ValidateAllShaders_();
+    const auto end = std::chrono::steady_clock::now();
+    LogShaderCompile_(changed.size(), std::chrono::duration<double, std::milli>(end - start).count());
+}
+
+void RendererBackend::LogShaderCompile_(const size_t numPipelines, const double milliseconds) const {
+    std::stringstream cacheInfo;
+    const ShaderProgramCachePtr cache = Pipeline::GetProgramCache();
+    if (cache != nullptr) {
+        // Totals since startup
+        const ShaderProgramCacheStats stats = cache->Stats();
+        cacheInfo << " (program cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.rejected << " rejected)";
+    }
+    STRATUS_LOG << "Compiled " << numPipelines << " pipelines in " << milliseconds << " ms" << cacheInfo.str() << std::endl;
 }
 
 bool RendererBackend::Valid() const {
@@ -339,6 +393,10 @@ const Pipeline *RendererBackend::GetCurrentShader() const {
     return nullptr;
 }
 
+const PointShadowCullingStats& RendererBackend::GetPointShadowCullingStats() const {
+    return state_.pointShadowCullingStats;
+}
+
 void RendererBackend::RecalculateCascadeData_() {
     const uint32_t cascadeResolutionXY = frame_->csc.cascadeResolutionXY;
     const uint32_t numCascades = frame_->csc.cascades.size();
@@ -355,12 +413,20 @@ void RendererBackend::RecalculateCascadeData_() {
         frame_->csc.fbo = FrameBuffer({ tex });
     }
 
+    if (!frame_->settings.cascadeCachingEnabled) {
+        frame_->csc.staticFbo = FrameBuffer();
+    }
+    else if (frame_->csc.regenerateFbo || !frame_->csc.staticFbo.Valid()) {
+        // Only ever used as a copy source so no sampling state is needed
+        Texture tex(TextureConfig{ TextureType::TEXTURE_2D_ARRAY, TextureComponentFormat::DEPTH, TextureComponentSize::BITS_DEFAULT, TextureComponentType::FLOAT, cascadeResolutionXY, cascadeResolutionXY, numCascades, false }, NoTextureData);
+        frame_->csc.staticFbo = FrameBuffer({ tex });
+    }
+
     frame_->csc.regenerateFbo = false;
 }
 
 void RendererBackend::ClearGBuffer_() {
     state_.currentFrame = GBuffer();
-    state_.gaussianBuffers.clear();
     state_.postFxBuffers.clear();
 }
 
@@ -601,120 +667,82 @@ void RendererBackend::UpdateWindowDimensions_() {
     InitializePostFxBuffers_();
 }
 
+PostFxRenderGraphParams RendererBackend::GetPostFxRenderGraphParams_() const {
+    PostFxRenderGraphParams params;
+    params.viewportWidth = frame_->viewportWidth;
+    params.viewportHeight = frame_->viewportHeight;
+    params.taaEnabled = frame_->settings.taaEnabled;
+    params.bloomEnabled = frame_->settings.bloomEnabled;
+    params.atmosphericEnabled = frame_->csc.worldLight->GetEnabled();
+    params.fxaaEnabled = frame_->settings.fxaaEnabled;
+    return params;
+}
+
 void RendererBackend::InitializePostFxBuffers_() {
-    uint32_t currWidth = frame_->viewportWidth;
-    uint32_t currHeight = frame_->viewportHeight;
-    state_.numDownsampleIterations = 0;
-    state_.numUpsampleIterations = 0;
-
-    // Initialize bloom
-    for (; state_.numDownsampleIterations < 8; ++state_.numDownsampleIterations) {
-        currWidth /= 2;
-        currHeight /= 2;
-        if (currWidth < 8 || currHeight < 8) break;
-        PostFXBuffer buffer;
-        auto color = Texture(TextureConfig{ TextureType::TEXTURE_2D, TextureComponentFormat::RGBA, TextureComponentSize::BITS_16, TextureComponentType::FLOAT, currWidth, currHeight, 0, false }, NoTextureData);
-        color.SetMinMagFilter(TextureMinificationFilter::LINEAR, TextureMagnificationFilter::LINEAR);
-        color.SetCoordinateWrapping(TextureCoordinateWrapping::CLAMP_TO_EDGE); // TODO: Does this make sense for bloom textures?
-        buffer.fbo = FrameBuffer({ color });
-        if (!buffer.fbo.Valid()) {
-            isValid_ = false;
-            STRATUS_ERROR << "Unable to initialize bloom buffer" << std::endl;
-            return;
-        }
-        state_.postFxBuffers.push_back(buffer);
+    state_.postFxParams = GetPostFxRenderGraphParams_();
+    state_.postFxGraph = RenderGraph();
+    state_.postFx = BuildPostFxRenderGraph(state_.postFxGraph, state_.postFxParams);
 
-        // Create the Gaussian Blur buffers
-        PostFXBuffer dualBlurFbos[2];
-        for (int i = 0; i < 2; ++i) {
-            FrameBuffer& blurFbo = dualBlurFbos[i].fbo;
-            Texture tex = Texture(color.GetConfig(), NoTextureData);
-            tex.SetMinMagFilter(TextureMinificationFilter::LINEAR, TextureMagnificationFilter::LINEAR);
-            tex.SetCoordinateWrapping(TextureCoordinateWrapping::CLAMP_TO_EDGE);
-            blurFbo = FrameBuffer({tex});
-            state_.gaussianBuffers.push_back(dualBlurFbos[i]);
-        }
+    RenderGraph& graph = state_.postFxGraph;
+    const PostFxRenderGraph& fx = state_.postFx;
+
+    graph.SetExecute(fx.taa.pass, [this, pass = fx.taa]() { PerformTaaPostFx_(pass); });
+    if (fx.taaHistory.pass != RENDER_GRAPH_INVALID_ID) {
+        graph.SetExecute(fx.taaHistory.pass, [this, pass = fx.taaHistory]() { UpdateTaaHistory_(pass); });
     }
 
-    std::vector<std::pair<uint32_t, uint32_t>> sizes;
-    for (int i = state_.numDownsampleIterations - 2; i >= 0; --i) {
-        auto tex = state_.postFxBuffers[i].fbo.GetColorAttachments()[0];
-        sizes.push_back(std::make_pair(tex.Width(), tex.Height()));
+    for (const PostFxRenderGraphPass& pass : fx.bloomDownsample) {
+        graph.SetExecute(pass.pass, [this, pass]() { PerformBloomDownsamplePostFx_(pass); });
     }
-    sizes.push_back(std::make_pair(frame_->viewportWidth, frame_->viewportHeight));
-    
-    for (auto&[width, height] : sizes) {
-        PostFXBuffer buffer;
-        ++state_.numUpsampleIterations;
-        auto color = Texture(TextureConfig{ TextureType::TEXTURE_2D, TextureComponentFormat::RGBA, TextureComponentSize::BITS_16, TextureComponentType::FLOAT, width, height, 0, false }, NoTextureData);
+
+    for (usize i = 0; i < fx.bloomBlur.size(); ++i) {
+        const bool horizontal = (i % 2) == 1;
+        graph.SetExecute(fx.bloomBlur[i].pass, [this, pass = fx.bloomBlur[i], horizontal]() { PerformBloomBlurPostFx_(pass, horizontal); });
+    }
+
+    for (usize i = 0; i < fx.bloomUpsample.size(); ++i) {
+        const bool finalStage = i + 1 == fx.bloomUpsample.size();
+        graph.SetExecute(fx.bloomUpsample[i].pass, [this, pass = fx.bloomUpsample[i], finalStage]() { PerformBloomUpsamplePostFx_(pass, finalStage); });
+    }
+
+    graph.SetExecute(fx.atmospheric.pass, [this, pass = fx.atmospheric]() { PerformAtmosphericPostFx_(pass); });
+    graph.SetExecute(fx.tonemap.pass, [this, pass = fx.tonemap]() { PerformScreenPostFx_("Tonemap", state_.gammaTonemap.get(), pass); });
+    graph.SetExecute(fx.fxaaLuminance.pass, [this, pass = fx.fxaaLuminance]() { PerformScreenPostFx_("FxaaLuminance", state_.fxaaLuminance.get(), pass); });
+    graph.SetExecute(fx.fxaaSmoothing.pass, [this, pass = fx.fxaaSmoothing]() { PerformScreenPostFx_("FxaaSmoothing", state_.fxaaSmoothing.get(), pass); });
+    graph.SetExecute(fx.present.pass, [this, pass = fx.present]() { FinalizeFrame_(pass); });
+
+    graph.Compile();
+
+    // Disabled effects have been culled so only what is used gets allocated, and textures which
+    // are never alive at the same time share a buffer
+    state_.postFxBuffers.clear();
+    for (const TextureConfig& config : graph.GetPhysicalTextures()) {
+        Texture color = Texture(config, NoTextureData);
         color.SetMinMagFilter(TextureMinificationFilter::LINEAR, TextureMagnificationFilter::LINEAR);
-        color.SetCoordinateWrapping(TextureCoordinateWrapping::CLAMP_TO_EDGE); // TODO: Does this make sense for bloom textures?
+        color.SetCoordinateWrapping(TextureCoordinateWrapping::CLAMP_TO_EDGE);
+
+        PostFXBuffer buffer;
         buffer.fbo = FrameBuffer({ color });
         if (!buffer.fbo.Valid()) {
             isValid_ = false;
-            STRATUS_ERROR << "Unable to initialize bloom buffer" << std::endl;
+            STRATUS_ERROR << "Unable to initialize post fx buffer" << std::endl;
             return;
         }
         state_.postFxBuffers.push_back(buffer);
     }
 
-    // Create the atmospheric post fx buffer
-    Texture atmosphericTexture = Texture(TextureConfig{TextureType::TEXTURE_2D, TextureComponentFormat::RGBA, TextureComponentSize::BITS_16, TextureComponentType::FLOAT, frame_->viewportWidth, frame_->viewportHeight, 0, false}, NoTextureData);
-    atmosphericTexture.SetMinMagFilter(TextureMinificationFilter::LINEAR, TextureMagnificationFilter::LINEAR);
-    atmosphericTexture.SetCoordinateWrapping(TextureCoordinateWrapping::CLAMP_TO_EDGE);
-    state_.atmosphericPostFxBuffer.fbo = FrameBuffer({atmosphericTexture});
-    if (!state_.atmosphericPostFxBuffer.fbo.Valid()) {
-        isValid_ = false;
-        STRATUS_ERROR << "Unable to initialize atmospheric post fx buffer" << std::endl;
-        return;
-    }
-    state_.postFxBuffers.push_back(state_.atmosphericPostFxBuffer);
-
-    // Create the Gamma-Tonemap buffer
-    Texture gammaTonemap = Texture(TextureConfig{ TextureType::TEXTURE_2D, TextureComponentFormat::RGBA, TextureComponentSize::BITS_8, TextureComponentType::FLOAT, frame_->viewportWidth, frame_->viewportHeight, 0, false }, NoTextureData);
-    gammaTonemap.SetMinMagFilter(TextureMinificationFilter::LINEAR, TextureMagnificationFilter::LINEAR);
-    gammaTonemap.SetCoordinateWrapping(TextureCoordinateWrapping::CLAMP_TO_EDGE);
-    state_.gammaTonemapFbo.fbo = FrameBuffer({ gammaTonemap });
-    if (!state_.gammaTonemapFbo.fbo.Valid()) {
-        isValid_ = false;
-        STRATUS_ERROR << "Unable to initialize gamma tonemap buffer" << std::endl;
-        return;
-    }
-
-    // Create the FXAA buffers
-    Texture fxaa = Texture(TextureConfig{TextureType::TEXTURE_2D, TextureComponentFormat::RGBA, TextureComponentSize::BITS_8, TextureComponentType::FLOAT, frame_->viewportWidth, frame_->viewportHeight, 0, false}, NoTextureData);
-    fxaa.SetMinMagFilter(TextureMinificationFilter::LINEAR, TextureMagnificationFilter::LINEAR);
-    fxaa.SetCoordinateWrapping(TextureCoordinateWrapping::CLAMP_TO_EDGE);
-    state_.fxaaFbo1.fbo = FrameBuffer({fxaa});
-    if (!state_.fxaaFbo1.fbo.Valid()) {
-        isValid_ = false;
-        STRATUS_ERROR << "Unable to initialize fxaa luminance buffer" << std::endl;
-        return;
-    }
-    state_.postFxBuffers.push_back(state_.fxaaFbo1);
-
-    fxaa = Texture(TextureConfig{TextureType::TEXTURE_2D, TextureComponentFormat::RGBA, TextureComponentSize::BITS_8, TextureComponentType::FLOAT, frame_->viewportWidth, frame_->viewportHeight, 0, false}, NoTextureData);
-    fxaa.SetMinMagFilter(TextureMinificationFilter::LINEAR, TextureMagnificationFilter::LINEAR);
-    fxaa.SetCoordinateWrapping(TextureCoordinateWrapping::CLAMP_TO_EDGE);
-    state_.fxaaFbo2.fbo = FrameBuffer({fxaa});
-    if (!state_.fxaaFbo2.fbo.Valid()) {
-        isValid_ = false;
-        STRATUS_ERROR << "Unable to initialize fxaa smoothing buffer" << std::endl;
-        return;
-    }
-    state_.postFxBuffers.push_back(state_.fxaaFbo2);
+    const RenderGraphStats& stats = graph.Stats();
+    STRATUS_LOG << "Post fx: " << (stats.passes - stats.culledPasses) << "/" << stats.passes << " passes, "
+                << stats.physicalTextures << " buffers for " << (stats.transientTextures - stats.culledTextures) << " textures, "
+                << (stats.allocatedBytes / 1024 / 1024) << " MB allocated ("
+                << (stats.SavedBytes() / 1024 / 1024) << " MB saved)" << std::endl;
+}
 
-    // Initialize TAA buffer
-    Texture taa = Texture(TextureConfig{ TextureType::TEXTURE_2D, TextureComponentFormat::RGBA, TextureComponentSize::BITS_16, TextureComponentType::FLOAT, frame_->viewportWidth, frame_->viewportHeight, 0, false }, NoTextureData);
-    taa.SetMinMagFilter(TextureMinificationFilter::LINEAR, TextureMagnificationFilter::LINEAR);
-    taa.SetCoordinateWrapping(TextureCoordinateWrapping::CLAMP_TO_EDGE);
-    state_.taaFbo.fbo = FrameBuffer({ taa });
-    if (!state_.taaFbo.fbo.Valid()) {
-        isValid_ = false;
-        STRATUS_ERROR << "Unable to initialize taa buffer" << std::endl;
-        return;
-    }
-    state_.postFxBuffers.push_back(state_.taaFbo);
+FrameBuffer& RendererBackend::GetPostFxBuffer_(const RenderGraphTextureId texture) {
+    if (texture == state_.postFx.scene) return state_.lightingFbo;
+    if (texture == state_.postFx.history) return state_.previousFrameBuffer;
+    // The screen has no FrameBuffer (see FinalizeFrame_)
+    return state_.postFxBuffers[state_.postFxGraph.GetPhysicalTexture(texture)].fbo;
 }
 
 void RendererBackend::ClearFramebufferData_(const bool clearScreen) {
@@ -737,22 +765,17 @@ void RendererBackend::ClearFramebufferData_(const bool clearScreen) {
         state_.vpls.vplGIDenoisedFbo1.Clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
         state_.vpls.vplGIDenoisedFbo2.Clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
 
-        // Depending on when this happens we may not have generated cascadeFbo yet
-        if (frame_->csc.fbo.Valid()) {
+        // Depending on when this happens we may not have generated cascadeFbo yet. Cached cascades
+        // keep their contents between frames and are overwritten in RenderCSMDepth_.
+        if (frame_->csc.fbo.Valid() && !frame_->settings.cascadeCachingEnabled) {
             frame_->csc.fbo.Clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
             //const int index = Engine::Instance()->FrameCount() % 4;
             //_frame->csc.fbo.ClearDepthStencilLayer(index);
         }
 
-        for (auto& gaussian : state_.gaussianBuffers) {
-            gaussian.fbo.Clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
-        }
-
         for (auto& postFx : state_.postFxBuffers) {
             postFx.fbo.Clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
         }
-
-        state_.atmosphericPostFxBuffer.fbo.Clear(glm::vec4(0.0f));
     }
 }
 
@@ -814,6 +837,8 @@ void RendererBackend::Begin(const std::shared_ptr<RendererFrame>& frame, bool cl
     // Make sure we set our context as the active one
     GraphicsDriver::MakeContextCurrent();
 
+    gpuProfiler_->BeginFrame();
+
     // Swap current and previous frame buffers
     auto tmp = state_.currentFrame;
     state_.currentFrame = state_.previousFrame;
@@ -871,16 +896,10 @@ void RendererBackend::Begin(const std::shared_ptr<RendererFrame>& frame, bool cl
 //    };
 //}
 static std::vector<glm::mat4, StackBasedPoolAllocator<glm::mat4>> GenerateLightViewTransforms(const glm::vec3 & lightPos, const UnsafePtr<StackAllocator>& allocator) {
-    return std::vector<glm::mat4, StackBasedPoolAllocator<glm::mat4>>({
-        //          pos       pos + dir                                  up
-        glm::lookAt(lightPos, lightPos + glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(lightPos, lightPos + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(lightPos, lightPos + glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-        glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-        glm::lookAt(lightPos, lightPos + glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(lightPos, lightPos + glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-        },
-
+    glm::mat4 views[PointShadowFaceMask::numFaces];
+    PointShadowFaceCulling::ComputeFaceViews(lightPos, views);
+    return std::vector<glm::mat4, StackBasedPoolAllocator<glm::mat4>>(
+        views, views + PointShadowFaceMask::numFaces,
         StackBasedPoolAllocator<glm::mat4>(allocator)
     );
 }
@@ -938,6 +957,7 @@ void RendererBackend::RenderBoundingBoxes_(GpuCommandBufferPtr& buffer) {
     for (int i = 0; i < buffer->NumDrawCommands(); ++i) {
         state_.aabbDraw->SetInt("modelIndex", i);
         glDrawArrays(GL_LINES, 0, 24);
+        STRATUS_PROFILE_COUNTER("Draws", 1);
     }
 
     UnbindShader_();
@@ -961,6 +981,8 @@ void RendererBackend::RenderImmediate_(const RenderFaceCulling cull, GpuCommandB
     SetCullState(cull);
 
     glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void *)0, (GLsizei)buffer->NumDrawCommands(), (GLsizei)0);
+    STRATUS_PROFILE_COUNTER("Draws", buffer->NumDrawCommands());
+    STRATUS_PROFILE_COUNTER("Triangles", buffer->NumIndices(0) / 3);
 
     select(buffer).Unbind(GpuBindingPoint::DRAW_INDIRECT_BUFFER);
 }
@@ -1067,19 +1089,22 @@ void RendererBackend::RenderSkybox_(Pipeline * s, const glm::mat4& projectionVie
 }
 
 void RendererBackend::RenderSkybox_() {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "Skybox");
     const glm::mat4& projection = frame_->projection;
     const glm::mat4 view = glm::mat4(glm::mat3(frame_->camera->GetViewTransform()));
     const glm::mat4 projectionView = projection * view;
 
     glDepthFunc(GL_LEQUAL);
 
-    BindShader_(state_.skybox.get());
-    RenderSkybox_(state_.skybox.get(), projectionView);
+    Pipeline * skybox = state_.skybox->Get(0);
+    BindShader_(skybox);
+    RenderSkybox_(skybox, projectionView);
     UnbindShader_();
 }
 
 void RendererBackend::RenderCSMDepth_() {
-    if (frame_->csc.cascades.size() > state_.csmDepth.size()) {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "CSM");
+    if (frame_->csc.cascades.size() > maxCascades) {
         throw std::runtime_error("Max cascades exceeded (> 6)");
     }
 
@@ -1098,17 +1123,21 @@ void RendererBackend::RenderCSMDepth_() {
     //glBlendFunc(GL_ONE, GL_ONE);
     // glDisable(GL_CULL_FACE);
 
-    frame_->csc.fbo.Bind();
     const Texture * depth = frame_->csc.fbo.GetDepthStencilAttachment();
     if (!depth) {
         throw std::runtime_error("Critical error: depth attachment not present");
     }
     glViewport(0, 0, depth->Width(), depth->Height());
 
+    const bool cachingEnabled = frame_->settings.cascadeCachingEnabled && frame_->csc.staticFbo.Valid();
+    const Texture * staticDepth = cachingEnabled ? frame_->csc.staticFbo.GetDepthStencilAttachment() : nullptr;
+
     for (size_t cascade = 0; cascade < frame_->csc.cascades.size(); ++cascade) {
-        Pipeline * shader = frame_->csc.worldLight->GetAlphaTest() && cascade < 2 ?
-            state_.csmDepthRunAlphaTest[cascade].get() :
-            state_.csmDepth[cascade].get();
+        auto& csm = frame_->csc.cascades[cascade];
+        if (cachingEnabled && !csm.renderDynamic) continue;
+
+        const bool runAlphaTest = frame_->csc.worldLight->GetAlphaTest() && cascade < 2;
+        Pipeline * shader = state_.csmDepth->Get(CsmDepthVariant_(u32(cascade), runAlphaTest));
 
         BindShader_(shader);
 
@@ -1129,7 +1158,6 @@ void RendererBackend::RenderCSMDepth_() {
         // Render everything
         // See https://www.gamedev.net/forums/topic/695063-is-there-a-quick-way-to-fix-peter-panning-shadows-detaching-from-objects/5370603/
         // for the tip about enabling reverse culling for directional shadow maps to reduce peter panning
-        auto& csm = frame_->csc.cascades[cascade];
         shader->SetMat4("shadowMatrix", csm.projectionViewRender);
 
         CommandBufferSelectionFunction selectDynamic = [this, cascade](GpuCommandBufferPtr& b) {
@@ -1142,8 +1170,27 @@ void RendererBackend::RenderCSMDepth_() {
             return frame_->csc.cascades[cascade].drawCommands->staticPbrMeshes.find(cull)->second->GetCommandBuffer();
         };
 
-        RenderImmediate_(frame_->drawCommands->dynamicPbrMeshes, selectDynamic, true);
-        RenderImmediate_(frame_->drawCommands->staticPbrMeshes, selectStatic, true);
+        if (cachingEnabled) {
+            // Static casters only change when the cascade moves or static geometry changes
+            if (csm.renderStatic) {
+                frame_->csc.staticFbo.ClearDepthStencilLayer(int(cascade));
+                frame_->csc.staticFbo.Bind();
+                RenderImmediate_(frame_->drawCommands->staticPbrMeshes, selectStatic, true);
+                frame_->csc.staticFbo.Unbind();
+            }
+
+            // Start from the cached static depth and composite the dynamic casters on top
+            depth->CopyLayerFrom(*staticDepth, 0, int(cascade), int(cascade));
+            frame_->csc.fbo.Bind();
+            RenderImmediate_(frame_->drawCommands->dynamicPbrMeshes, selectDynamic, true);
+            frame_->csc.fbo.Unbind();
+        }
+        else {
+            frame_->csc.fbo.Bind();
+            RenderImmediate_(frame_->drawCommands->dynamicPbrMeshes, selectDynamic, true);
+            RenderImmediate_(frame_->drawCommands->staticPbrMeshes, selectStatic, true);
+            frame_->csc.fbo.Unbind();
+        }
 
         // RenderImmediate_(csm.visibleDynamicPbrMeshes);
         // RenderImmediate_(csm.visibleStaticPbrMeshes);
@@ -1151,13 +1198,126 @@ void RendererBackend::RenderCSMDepth_() {
         UnbindShader_();
     }
     
-    frame_->csc.fbo.Unbind();
-
     glDisable(GL_POLYGON_OFFSET_FILL);
     glDisable(GL_DEPTH_CLAMP);
 }
 
+void RendererBackend::UpdateCascadeDepthReadback_() {
+    auto& vpls = state_.vpls;
+
+    // Collect copies which have finished without waiting on the ones which haven't
+    while (vpls.cascadeDepthReadbacks.size() > 0 && HostFenceSignalled(vpls.cascadeDepthReadbacks.front().fence)) {
+        CascadeDepthReadback_& readback = vpls.cascadeDepthReadbacks.front();
+        HostDeleteFence(readback.fence);
+
+        vpls.cascadeDepth = std::move(readback.snapshot);
+        vpls.cascadeDepth.depth.resize(readback.buffer.SizeBytes() / sizeof(float));
+        readback.buffer.CopyDataFromBufferToSysMem(0, readback.buffer.SizeBytes(), (void *)vpls.cascadeDepth.depth.data());
+
+        vpls.freeCascadeDepthBuffers.push_back(readback.buffer);
+        vpls.cascadeDepthReadbacks.pop_front();
+    }
+
+    const bool needsDepth = frame_->settings.cpuVplCullingEnabled &&
+                            frame_->settings.globalIlluminationEnabled &&
+                            frame_->csc.worldLight->GetEnabled();
+    if (!needsDepth) {
+        // Stale once the cascades stop being rendered
+        vpls.cascadeDepth = VplCascadeDepthSnapshot();
+        return;
+    }
+
+    if (vpls.cascadeDepthReadbacks.size() >= MaxCascadeDepthReadbacks) return;
+
+    const Texture * depth = frame_->csc.fbo.GetDepthStencilAttachment();
+    const u32 numCascades = u32(frame_->csc.cascades.size());
+    const u32 resolution = std::min(CascadeDepthReadbackResolution, frame_->csc.cascadeResolutionXY);
+
+    // The cascade frame buffer is layered so a second one is needed to select one layer at a time
+    if (!vpls.cascadeDepthSource.Valid() || *vpls.cascadeDepthSource.GetDepthStencilAttachment() != *depth) {
+        vpls.cascadeDepthSource = FrameBuffer({ *depth });
+
+        Texture tex(TextureConfig{ TextureType::TEXTURE_2D_ARRAY, TextureComponentFormat::DEPTH, TextureComponentSize::BITS_DEFAULT, TextureComponentType::FLOAT, resolution, resolution, numCascades, false }, NoTextureData);
+        vpls.cascadeDepthCopy = FrameBuffer({ tex });
+        vpls.freeCascadeDepthBuffers.clear();
+    }
+
+    const BufferBounds from{ 0, 0, frame_->csc.cascadeResolutionXY, frame_->csc.cascadeResolutionXY };
+    const BufferBounds to{ 0, 0, resolution, resolution };
+    for (u32 cascade = 0; cascade < numCascades; ++cascade) {
+        vpls.cascadeDepthSource.SetDepthTextureLayer(int(cascade));
+        vpls.cascadeDepthCopy.SetDepthTextureLayer(int(cascade));
+        vpls.cascadeDepthCopy.CopyFrom(vpls.cascadeDepthSource, from, to, BufferBit::DEPTH_BIT, BufferFilter::NEAREST);
+    }
+
+    CascadeDepthReadback_ readback;
+    const usize sizeBytes = sizeof(float) * usize(resolution) * usize(resolution) * usize(numCascades);
+    if (vpls.freeCascadeDepthBuffers.size() > 0) {
+        readback.buffer = vpls.freeCascadeDepthBuffers.back();
+        vpls.freeCascadeDepthBuffers.pop_back();
+    }
+    else {
+        readback.buffer = GpuBuffer(nullptr, sizeBytes, GPU_MAP_READ);
+    }
+
+    readback.buffer.Bind(GpuBindingPoint::PIXEL_PACK_BUFFER);
+    vpls.cascadeDepthCopy.GetDepthStencilAttachment()->ReadPixels(0, sizeBytes, nullptr);
+    readback.buffer.Unbind(GpuBindingPoint::PIXEL_PACK_BUFFER);
+    readback.fence = HostInsertFence();
+
+    readback.snapshot.resolution = resolution;
+    readback.snapshot.lightDirection = frame_->csc.worldLightCamera->GetDirection();
+    for (u32 cascade = 0; cascade < numCascades; ++cascade) {
+        readback.snapshot.projectionViews.push_back(frame_->csc.cascades[cascade].projectionViewSample);
+        if (cascade > 0) {
+            readback.snapshot.cascadePlanes.push_back(frame_->csc.cascades[cascade].cascadePlane);
+        }
+    }
+
+    vpls.cascadeDepthReadbacks.push_back(std::move(readback));
+}
+
+void RendererBackend::UpdateVplColorReadback_(std::vector<std::pair<LightPtr, u32>>& bakedLights, const usize totalVisible) {
+    auto& vpls = state_.vpls;
+
+    while (vpls.colorReadbacks.size() > 0 && HostFenceSignalled(vpls.colorReadbacks.front().fence)) {
+        VplColorReadback_& readback = vpls.colorReadbacks.front();
+        HostDeleteFence(readback.fence);
+
+        // Lights are in visible order so the last one has the highest index
+        const usize count = usize(readback.lights.back().second) + 1;
+        std::vector<GpuVplData> data(count);
+        readback.buffer.CopyDataFromBufferToSysMem(0, sizeof(GpuVplData) * count, (void *)data.data());
+        for (const auto& [light, index] : readback.lights) {
+            ((VirtualPointLight *)light.get())->sunDrivenColor_ = glm::vec3(data[index].color.ToVec4());
+        }
+
+        vpls.freeColorBuffers.push_back(readback.buffer);
+        vpls.colorReadbacks.pop_front();
+    }
+
+    if (bakedLights.size() == 0 || vpls.colorReadbacks.size() >= MaxVplColorReadbacks) return;
+
+    VplColorReadback_ readback;
+    if (vpls.freeColorBuffers.size() > 0) {
+        readback.buffer = vpls.freeColorBuffers.back();
+        vpls.freeColorBuffers.pop_back();
+    }
+    else {
+        readback.buffer = GpuBuffer(nullptr, sizeof(GpuVplData) * MAX_TOTAL_VPLS_PER_FRAME, GPU_MAP_READ);
+    }
+
+    // Colors are written by the compute shader so they have to be visible to the copy
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    readback.buffer.CopyDataFromBuffer(vpls.vplUpdatedData, 0, 0, sizeof(GpuVplData) * std::min<usize>(totalVisible, MAX_TOTAL_VPLS_PER_FRAME));
+    readback.fence = HostInsertFence();
+    readback.lights = std::move(bakedLights);
+
+    vpls.colorReadbacks.push_back(std::move(readback));
+}
+
 void RendererBackend::RenderSsaoOcclude_() {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "SSAOOcclude");
     glDisable(GL_CULL_FACE);
     glDisable(GL_DEPTH_TEST);
 
@@ -1187,6 +1347,7 @@ void RendererBackend::RenderSsaoOcclude_() {
 }
 
 void RendererBackend::RenderSsaoBlur_() {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "SSAOBlur");
     glDisable(GL_CULL_FACE);
     glDisable(GL_DEPTH_TEST);
 
@@ -1205,6 +1366,7 @@ void RendererBackend::RenderSsaoBlur_() {
 }
 
 void RendererBackend::RenderAtmosphericShadowing_() {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "AtmosphericShadowing");
     if (!frame_->csc.worldLight->GetEnabled()) return;
 
     constexpr float preventDivByZero = std::numeric_limits<float>::epsilon();
@@ -1279,18 +1441,45 @@ void RendererBackend::RenderAtmosphericShadowing_() {
 }
 
 void RendererBackend::InitVplFrameData_(const VplDistVector_& perVPLDistToViewer) {
-    std::vector<GpuVplData> vplData(perVPLDistToViewer.size());
+    std::vector<GpuVplData>& vplData = state_.vpls.vplCpuData;
+    vplData.resize(perVPLDistToViewer.size());
+    const auto& positions = frame_->lights.Positions();
+    const auto& radii = frame_->lights.Radii();
+    const auto& intensities = frame_->lights.Intensities();
     for (size_t i = 0; i < perVPLDistToViewer.size(); ++i) {
-        const VirtualPointLight* point = (const VirtualPointLight *)perVPLDistToViewer[i].key.get();
+        const size_t light = perVPLDistToViewer[i].index;
         GpuVplData& data = vplData[i];
-        data.position = GpuVec(glm::vec4(point->GetPosition(), 1.0f));
-        data.farPlane = point->GetFarPlane();
-        data.radius = point->GetRadius();
-        data.intensity = point->GetIntensity();
+        data.position = GpuVec(glm::vec4(positions[light], 1.0f));
+        // Far plane of a point light is its radius
+        data.farPlane = radii[light];
+        data.radius = radii[light];
+        data.intensity = intensities[light];
     }
     state_.vpls.vplData.CopyDataToBuffer(0, sizeof(GpuVplData) * vplData.size(), (const void *)vplData.data());
 }
 
+void RendererBackend::UpdateStaticIrradianceProbes_() {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "IrradianceProbes");
+    const IrradianceProbeGridPtr& grid = frame_->staticIrradianceProbes;
+    if (grid == uploadedIrradianceProbes_) return;
+
+    uploadedIrradianceProbes_ = grid;
+    if (grid == nullptr || !grid->IsValid()) {
+        staticIrradianceProbes_ = GpuBuffer();
+        return;
+    }
+
+    std::vector<GpuIrradianceProbe> probes(grid->NumProbes());
+    for (size_t i = 0; i < probes.size(); ++i) {
+        for (size_t k = 0; k < IRRADIANCE_PROBE_SH_COEFFICIENTS; ++k) {
+            probes[i].coefficients[k] = GpuVec(glm::vec4(grid->coefficients[i * IRRADIANCE_PROBE_SH_COEFFICIENTS + k], 0.0f));
+        }
+    }
+
+    staticIrradianceProbes_ = GpuBuffer((const void *)probes.data(), sizeof(GpuIrradianceProbe) * probes.size(), GPU_DYNAMIC_DATA);
+    STRATUS_LOG << "Uploaded " << probes.size() << " static irradiance probes" << std::endl;
+}
+
 static inline void PerformPointLightGeometryCulling(
     Pipeline& pipeline,
     const size_t lod,
@@ -1332,11 +1521,14 @@ void RendererBackend::UpdatePointLights_(
     VplDistMultiSet_& perVPLDistToViewerSet,
     VplDistVector_& perVPLDistToViewerVec,
     std::vector<int, StackBasedPoolAllocator<int>>& visibleVplIndices) {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "PointShadows");
 
     const Camera& c = *frame_->camera;
 
     const bool worldLightEnabled = frame_->csc.worldLight->GetEnabled();
     const bool giEnabled = worldLightEnabled && frame_->settings.globalIlluminationEnabled;
+    // Baked VPL contributions are already part of the probes
+    const bool skipBakedVpls = uploadedIrradianceProbes_ != nullptr;
 
     perLightDistToViewerSet.clear();
     perLightDistToViewerVec.clear();
@@ -1356,21 +1548,28 @@ void RendererBackend::UpdatePointLights_(
     }
 
     // Init per light instance data
-    for (auto& light : frame_->lights) {
-        const double distance = glm::distance(c.GetPosition(), light->GetPosition());
-        if (light->IsVirtualLight()) {
+    const auto& lights = frame_->lights.Lights();
+    const auto& lightPositions = frame_->lights.Positions();
+    const auto& lightRadii = frame_->lights.Radii();
+    const auto& lightFlags = frame_->lights.Flags();
+    for (size_t i = 0; i < lights.size(); ++i) {
+        const LightPtr& light = lights[i];
+        const uint32_t flags = lightFlags[i];
+        const double distance = glm::distance(c.GetPosition(), lightPositions[i]);
+        if (flags & LIGHT_FLAG_VIRTUAL) {
+            if (skipBakedVpls && (flags & LIGHT_FLAG_BAKED)) continue;
             //if (giEnabled && distance <= MAX_VPL_DISTANCE_TO_VIEWER) {
-            if (giEnabled && IsSphereInFrustum(light->GetPosition(), light->GetRadius(), frame_->viewFrustumPlanes)) {
+            if (giEnabled && IsSphereInFrustum(lightPositions[i], lightRadii[i], frame_->viewFrustumPlanes)) {
             //if (giEnabled) {
-                perVPLDistToViewerSet.insert(VplDistKey_(light, distance));
+                perVPLDistToViewerSet.insert(VplDistKey_(light, distance, i));
             }
         }
         else {
-            perLightDistToViewerSet.insert(VplDistKey_(light, distance));
+            perLightDistToViewerSet.insert(VplDistKey_(light, distance, i));
         }
 
-        if ( !light->IsVirtualLight() && light->CastsShadows() ) {
-            perLightShadowCastingDistToViewerSet.insert(VplDistKey_(light, distance));
+        if ( !(flags & LIGHT_FLAG_VIRTUAL) && (flags & LIGHT_FLAG_CASTS_SHADOWS) ) {
+            perLightShadowCastingDistToViewerSet.insert(VplDistKey_(light, distance, i));
         }
     }
 
@@ -1396,9 +1595,10 @@ void RendererBackend::UpdatePointLights_(
     }
 
     // Check if any need to have a new shadow map pulled from the cache
-    for (const auto&[light, _] : perLightShadowCastingDistToViewerVec) {
+    for (const auto& entry : perLightShadowCastingDistToViewerVec) {
+        const LightPtr& light = entry.key;
         if (!ShadowMapExistsForLight_(light)) {
-            frame_->lightsToUpdate.PushBack(light);
+            frame_->lightsToUpdate.PushBack(frame_->lights.Find(light));
         }
     }
 
@@ -1408,7 +1608,7 @@ void RendererBackend::UpdatePointLights_(
         if (!ShadowMapExistsForLight_(light)) {
             // Pushing to front will cause the light update queue to be reordered biased towards VPLs
             // close to the camera
-            frame_->lightsToUpdate.PushFront(light);
+            frame_->lightsToUpdate.PushFront(frame_->lights.Find(light));
             ++updates;
         }
     }
@@ -1419,14 +1619,37 @@ void RendererBackend::UpdatePointLights_(
         state_.staticPerPointLightDrawCalls[i]->EnsureCapacity(frame_->drawCommands);
     }
 
+    // Gather caster bounds for the per-face pre-pass
+    const bool faceCullingEnabled = frame_->settings.pointShadowFaceCullingEnabled;
+    state_.pointShadowCullingStats = PointShadowCullingStats();
+    state_.staticCasterAabbs.clear();
+    state_.dynamicCasterAabbs.clear();
+    if (faceCullingEnabled && frame_->lightsToUpdate.Size() > 0) {
+        for (auto& [cull, buffer] : frame_->drawCommands->staticPbrMeshes) {
+            buffer->GetWorldAabbs(state_.staticCasterAabbs);
+        }
+        for (auto& [cull, buffer] : frame_->drawCommands->dynamicPbrMeshes) {
+            buffer->GetWorldAabbs(state_.dynamicCasterAabbs);
+        }
+    }
+
     // Set blend func just for shadow pass
     // glBlendFunc(GL_ONE, GL_ONE);
     glEnable(GL_DEPTH_TEST);
     // Perform the shadow volume pre-pass
     for (int shadowUpdates = 0; shadowUpdates < state_.maxShadowUpdatesPerFrame && frame_->lightsToUpdate.Size() > 0; ++shadowUpdates) {
-        auto light = frame_->lightsToUpdate.PopFront();
+        const LightHandle handle = frame_->lightsToUpdate.PopFront();
+        auto light = frame_->lights.Get(handle);
         // Ideally this won't be needed but just in case
-        if ( !light->CastsShadows() ) continue;
+        if ( light == nullptr ) continue;
+        // Light parameters come from the registry rather than the light itself since the simulation
+        // may be moving lights while this frame renders
+        const size_t lightIndex = frame_->lights.DenseIndex(handle);
+        const uint32_t flags = lightFlags[lightIndex];
+        if ( !(flags & LIGHT_FLAG_CASTS_SHADOWS) ) continue;
+        const bool virtualLight = flags & LIGHT_FLAG_VIRTUAL;
+        const glm::vec3& lightPosition = lightPositions[lightIndex];
+        const float lightRadius = lightRadii[lightIndex];
         //const double distance = perLightShadowCastingDistToViewer.find(light)->second;
     
         // TODO: Make this work with spotlights
@@ -1437,8 +1660,8 @@ void RendererBackend::UpdatePointLights_(
         //     frame_->lightsToUpdate.PushBack(light);
         //     continue;
         // }
-        if (point->IsVirtualLight() && !IsSphereInFrustum(point->GetPosition(), point->GetRadius(), frame_->viewFrustumPlanes)) {
-            frame_->lightsToUpdate.PushBack(light);
+        if (virtualLight && !IsSphereInFrustum(lightPosition, lightRadius, frame_->viewFrustumPlanes)) {
+            frame_->lightsToUpdate.PushBack(handle);
             continue;
         }
 
@@ -1447,7 +1670,7 @@ void RendererBackend::UpdatePointLights_(
 
         const auto cubeMapWidth = cache.buffers[smap.index].GetDepthStencilAttachment()->Width();
         const auto cubeMapHeight = cache.buffers[smap.index].GetDepthStencilAttachment()->Height();
-        const glm::mat4 lightPerspective = glm::perspective<float>(glm::radians(90.0f), float(cubeMapWidth) / float(cubeMapHeight), point->GetNearPlane(), point->GetFarPlane());
+        const glm::mat4 lightPerspective = glm::perspective<float>(glm::radians(90.0f), float(cubeMapWidth) / float(cubeMapHeight), point->GetNearPlane(), lightRadius);
 
         // glBindFramebuffer(GL_FRAMEBUFFER, smap.frameBuffer);
         if (cache.buffers[smap.index].GetColorAttachments().size() > 0) {
@@ -1461,8 +1684,8 @@ void RendererBackend::UpdatePointLights_(
         // Current pass only cares about depth buffer
         // glClear(GL_DEPTH_BUFFER_BIT);
 
-        Pipeline * shader = light->IsVirtualLight() ? state_.vplShadows.get() : state_.shadows.get();
-        auto transforms = GenerateLightViewTransforms(point->GetPosition(), frame_->perFrameScratchMemory);
+        Pipeline * shader = virtualLight ? state_.vplShadows.get() : state_.shadows.get();
+        auto transforms = GenerateLightViewTransforms(lightPosition, frame_->perFrameScratchMemory);
 
         std::vector<glm::mat4, StackBasedPoolAllocator<glm::mat4>> lightViewProj(
             {
@@ -1477,22 +1700,49 @@ void RendererBackend::UpdatePointLights_(
             StackBasedPoolAllocator<glm::mat4>(frame_->perFrameScratchMemory)
         );
 
+        // Figure out which faces actually see any casters
+        const bool renderDynamic = !(flags & LIGHT_FLAG_STATIC) && !virtualLight;
+        PointShadowFaceMask staticFaces;
+        PointShadowFaceMask dynamicFaces;
+        if (faceCullingEnabled) {
+            PointShadowFaceCulling::AccumulateCasters(lightPosition, lightRadius, lightViewProj.data(), state_.staticCasterAabbs, staticFaces);
+            if (renderDynamic) {
+                PointShadowFaceCulling::AccumulateCasters(lightPosition, lightRadius, lightViewProj.data(), state_.dynamicCasterAabbs, dynamicFaces);
+            }
+        }
+        else {
+            staticFaces.mask = 0x3F;
+            dynamicFaces.mask = renderDynamic ? 0x3F : 0;
+        }
+
+        // Nothing to draw - the cleared shadow map is already correct. VPLs still need their skybox faces.
+        if (!virtualLight && staticFaces.Empty() && dynamicFaces.Empty()) {
+            cache.buffers[smap.index].Unbind();
+            ++state_.pointShadowCullingStats.lightsSkipped;
+            state_.pointShadowCullingStats.facesSkipped += PointShadowFaceMask::numFaces;
+            // Clearing is cheap enough that it does not count against the per-frame update budget
+            --shadowUpdates;
+            continue;
+        }
+
         // Perform visibility culling
 
         state_.viscullPointLights->Bind();
 
-        PerformPointLightGeometryCulling(
-            *state_.viscullPointLights.get(),
-            light->IsVirtualLight() ? frame_->drawCommands->NumLods() - 1 : 0, // lod
-            frame_->drawCommands->staticPbrMeshes,
-            state_.staticPerPointLightDrawCalls,
-            [](const GpuCommandReceiveManagerPtr& manager, const RenderFaceCulling& cull) {
-                return manager->staticPbrMeshes.find(cull)->second->GetCommandBuffer();
-            },
-            lightViewProj
-        );
+        if (!staticFaces.Empty()) {
+            PerformPointLightGeometryCulling(
+                *state_.viscullPointLights.get(),
+                virtualLight ? frame_->drawCommands->NumLods() - 1 : 0, // lod
+                frame_->drawCommands->staticPbrMeshes,
+                state_.staticPerPointLightDrawCalls,
+                [](const GpuCommandReceiveManagerPtr& manager, const RenderFaceCulling& cull) {
+                    return manager->staticPbrMeshes.find(cull)->second->GetCommandBuffer();
+                },
+                lightViewProj
+            );
+        }
 
-        if (!light->IsStaticLight() && !light->IsVirtualLight()) {
+        if (!dynamicFaces.Empty()) {
             PerformPointLightGeometryCulling(
                 *state_.viscullPointLights.get(),
                 0, // lod
@@ -1509,16 +1759,27 @@ void RendererBackend::UpdatePointLights_(
 
         for (size_t i = 0; i < lightViewProj.size(); ++i) {
             const glm::mat4& projectionView = lightViewProj[i];
+            const bool drawStatic = staticFaces.FaceHasCasters(i);
+            const bool drawDynamic = dynamicFaces.FaceHasCasters(i);
+
+            if (!drawStatic && !drawDynamic) {
+                ++state_.pointShadowCullingStats.facesSkipped;
+                // Regular lights have nothing else to draw for this face
+                if (!virtualLight) continue;
+            }
+            else {
+                ++state_.pointShadowCullingStats.facesRendered;
+            }
 
             // * 6 since each cube map is accessed by a layer-face which is divisible by 6
             BindShader_(shader);
             shader->SetInt("layer", int(smap.layer * 6 + i));
             shader->SetMat4("shadowMatrix", projectionView);
-            shader->SetVec3("lightPos", light->GetPosition());
-            shader->SetFloat("farPlane", point->GetFarPlane());
+            shader->SetVec3("lightPos", lightPosition);
+            shader->SetFloat("farPlane", lightRadius);
             shader->SetFloat("alphaDepthTestThreshold", frame_->settings.GetAlphaDepthTestThreshold());
 
-            if (point->IsVirtualLight()) {
+            if (virtualLight) {
                 // Use lower LOD
                 const size_t lod = frame_->drawCommands->NumLods() - 1;
                 const CommandBufferSelectionFunction select = [this, lod, i](GpuCommandBufferPtr& b) {
@@ -1527,22 +1788,23 @@ void RendererBackend::UpdatePointLights_(
                     const auto cull = b->GetFaceCulling();
                     return state_.staticPerPointLightDrawCalls[i]->staticPbrMeshes.find(cull)->second->GetCommandBuffer();
                 };
-                RenderImmediate_(frame_->drawCommands->staticPbrMeshes, select, false);
+                if (drawStatic) RenderImmediate_(frame_->drawCommands->staticPbrMeshes, select, false);
                 //RenderImmediate_(frame_->instancedDynamicPbrMeshes[frame_->instancedDynamicPbrMeshes.size() - 1]);
 
                 const glm::mat4 projectionViewNoTranslate = lightPerspective * glm::mat4(glm::mat3(transforms[i]));
 
                 glDepthFunc(GL_LEQUAL);
 
-                BindShader_(state_.skyboxLayered.get());
-                state_.skyboxLayered->SetInt("layer", int(smap.layer * 6 + i));
+                Pipeline * skyboxLayered = state_.skybox->Get(state_.skybox->Features().Set(0, 0, 1));
+                BindShader_(skyboxLayered);
+                skyboxLayered->SetInt("layer", int(smap.layer * 6 + i));
 
                 auto tmp = frame_->settings.GetSkyboxIntensity();
                 if (tmp > 1.0f) {
                     frame_->settings.SetSkyboxIntensity(1.0f);
                 }
                 
-                RenderSkybox_(state_.skyboxLayered.get(), projectionViewNoTranslate);
+                RenderSkybox_(skyboxLayered, projectionViewNoTranslate);
 
                 if (tmp > 1.0f) {
                     frame_->settings.SetSkyboxIntensity(tmp);
@@ -1563,8 +1825,8 @@ void RendererBackend::UpdatePointLights_(
                     //return b->GetIndirectDrawCommandsBuffer(0);
                 };
 
-                RenderImmediate_(frame_->drawCommands->staticPbrMeshes, selectStatic, false);
-                if ( !point->IsStaticLight() ) RenderImmediate_(frame_->drawCommands->dynamicPbrMeshes, selectDynamic, false);
+                if (drawStatic) RenderImmediate_(frame_->drawCommands->staticPbrMeshes, selectStatic, false);
+                if (drawDynamic) RenderImmediate_(frame_->drawCommands->dynamicPbrMeshes, selectDynamic, false);
             }
 
             UnbindShader_();
@@ -1578,9 +1840,15 @@ void RendererBackend::UpdatePointLights_(
 void RendererBackend::PerformVirtualPointLightCullingStage1_(
     VplDistVector_& perVPLDistToViewer,
     std::vector<int, StackBasedPoolAllocator<int>>& visibleVplIndices) {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "VPLCullingStage1");
 
     if (perVPLDistToViewer.size() == 0) return;
 
+    if (frame_->settings.cpuVplCullingEnabled) {
+        PerformVirtualPointLightCullingStage1Cpu_(perVPLDistToViewer, visibleVplIndices);
+        return;
+    }
+
     state_.vplCulling->Bind();
 
     const Camera & lightCam = *frame_->csc.worldLightCamera;
@@ -1660,11 +1928,64 @@ void RendererBackend::PerformVirtualPointLightCullingStage1_(
     //}
 }
 
+void RendererBackend::PerformVirtualPointLightCullingStage1Cpu_(
+    VplDistVector_& perVPLDistToViewer,
+    std::vector<int, StackBasedPoolAllocator<int>>& visibleVplIndices) {
+
+    // This is an approximation of the GPU result, not a copy of it. The cascade depth copy is downsampled
+    // (so IsLit's 3x3 footprint covers a much larger area) and lags the GPU by a frame or two. Until the
+    // first one arrives a light counts as visible if any cascade covers it, which keeps lights the shadow
+    // test would reject. isLit runs on the task threads so it must only read.
+    const VplCascadeDepthSnapshot& cascadeDepth = state_.vpls.cascadeDepth;
+    const auto& cascades = frame_->csc.cascades;
+    const auto isLit = [&cascadeDepth, &cascades](const glm::vec3& position) {
+        if (cascadeDepth.Valid()) {
+            return CpuVplCulling::IsLit(cascadeDepth, position);
+        }
+
+        for (const auto& cascade : cascades) {
+            glm::vec4 coords = cascade.projectionViewSample * glm::vec4(position, 1.0f);
+            coords = coords / coords.w * 0.5f + glm::vec4(0.5f);
+            if (coords.x >= 0.0f && coords.x <= 1.0f &&
+                coords.y >= 0.0f && coords.y <= 1.0f &&
+                coords.z >= 0.0f && coords.z <= 1.0f) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<int> visible;
+    CpuVplCulling::ComputeVisibleLights(state_.vpls.vplCpuData, frame_->camera->GetPosition(), isLit, MAX_TOTAL_VPLS_PER_FRAME, visible);
+
+    visibleVplIndices.assign(visible.begin(), visible.end());
+
+    // Matches the layout written by viscull_vpls.cs: first element is the count followed by
+    // the indices, and the updated light data is compacted to only the visible lights
+    std::vector<int, StackBasedPoolAllocator<int>> indices(StackBasedPoolAllocator<int>(frame_->perFrameScratchMemory));
+    indices.reserve(visible.size() + 1);
+    indices.push_back(int(visible.size()));
+    indices.insert(indices.end(), visible.begin(), visible.end());
+
+    std::vector<GpuVplData, StackBasedPoolAllocator<GpuVplData>> updated(StackBasedPoolAllocator<GpuVplData>(frame_->perFrameScratchMemory));
+    updated.reserve(visible.size());
+    for (const int index : visible) {
+        updated.push_back(state_.vpls.vplCpuData[index]);
+    }
+
+    state_.vpls.vplVisibleIndices.CopyDataToBuffer(0, sizeof(int) * indices.size(), (const void *)indices.data());
+    if (updated.size() > 0) {
+        state_.vpls.vplUpdatedData.CopyDataToBuffer(0, sizeof(GpuVplData) * updated.size(), (const void *)updated.data());
+    }
+}
+
 // void RendererBackend::PerformVirtualPointLightCullingStage2_(
 //     const std::vector<std::pair<LightPtr, double>>& perVPLDistToViewer,
 //     const std::vector<int>& visibleVplIndices) {
 void RendererBackend::PerformVirtualPointLightCullingStage2_(
-    const VplDistVector_& perVPLDistToViewer) {
+    const VplDistVector_& perVPLDistToViewer,
+    const std::vector<int, StackBasedPoolAllocator<int>>& cpuVisibleVplIndices) {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "VPLCullingStage2");
 
     // int totalVisible = *(int *)state_.vpls.vplNumVisible.MapMemory();
     // state_.vpls.vplNumVisible.UnmapMemory();
@@ -1672,13 +1993,23 @@ void RendererBackend::PerformVirtualPointLightCullingStage2_(
     //if (perVPLDistToViewer.size() == 0 || visibleVplIndices.size() == 0) return;
     if (perVPLDistToViewer.size() == 0) return;
 
-    int* visibleVplIndices = (int*)state_.vpls.vplVisibleIndices.MapMemory(GPU_MAP_READ);
-    // First index is reserved for the size of the array
-    const int totalVisible = visibleVplIndices[0];
-    visibleVplIndices += 1;
+    // The CPU path already has the indices so there is no need to wait on the GPU
+    const bool cpuCulling = frame_->settings.cpuVplCullingEnabled;
+    const int* visibleVplIndices = nullptr;
+    int totalVisible = 0;
+    if (cpuCulling) {
+        visibleVplIndices = cpuVisibleVplIndices.data();
+        totalVisible = int(cpuVisibleVplIndices.size());
+    }
+    else {
+        visibleVplIndices = (const int*)state_.vpls.vplVisibleIndices.MapMemory(GPU_MAP_READ);
+        // First index is reserved for the size of the array
+        totalVisible = visibleVplIndices[0];
+        visibleVplIndices += 1;
+    }
     
     if (totalVisible == 0) {
-        state_.vpls.vplVisibleIndices.UnmapMemory();
+        if (!cpuCulling) state_.vpls.vplVisibleIndices.UnmapMemory();
         return;
     }
 
@@ -1687,14 +2018,18 @@ void RendererBackend::PerformVirtualPointLightCullingStage2_(
     diffuseHandles.reserve(totalVisible);
     std::vector<GpuAtlasEntry, StackBasedPoolAllocator<GpuAtlasEntry>> shadowDiffuseIndices(StackBasedPoolAllocator<GpuAtlasEntry>(frame_->perFrameScratchMemory));
     shadowDiffuseIndices.reserve(totalVisible);
+    std::vector<std::pair<LightPtr, u32>> bakedLights;
     for (size_t i = 0; i < totalVisible; ++i) {
         const int index = visibleVplIndices[i];
         const VirtualPointLight * point = (const VirtualPointLight *)perVPLDistToViewer[index].key.get();
         auto smap = GetOrAllocateShadowMapForLight_(perVPLDistToViewer[index].key);
         shadowDiffuseIndices.push_back(smap);
+        if ((frame_->lights.Flags()[perVPLDistToViewer[index].index] & LIGHT_FLAG_BAKED) && i < MAX_TOTAL_VPLS_PER_FRAME) {
+            bakedLights.push_back(std::make_pair(perVPLDistToViewer[index].key, u32(i)));
+        }
     }
 
-    state_.vpls.vplVisibleIndices.UnmapMemory();
+    if (!cpuCulling) state_.vpls.vplVisibleIndices.UnmapMemory();
     visibleVplIndices = nullptr;
 
     // Move data to GPU memory
@@ -1730,6 +2065,8 @@ void RendererBackend::PerformVirtualPointLightCullingStage2_(
 
     state_.vplColoring->Unbind();
 
+    UpdateVplColorReadback_(bakedLights, usize(totalVisible));
+
     // Now perform culling per tile since we now know which lights are active
     // state_.vplTileDeferredCullingStage1->Bind();
 
@@ -1814,7 +2151,15 @@ void RendererBackend::PerformVirtualPointLightCullingStage2_(
 }
 
 void RendererBackend::ComputeVirtualPointLightGlobalIllumination_(const VplDistVector_& perVPLDistToViewer, const double deltaSeconds) {
-    if (perVPLDistToViewer.size() == 0) return;
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "GI");
+    const bool staticProbesEnabled = uploadedIrradianceProbes_ != nullptr;
+    if (perVPLDistToViewer.size() == 0 && !staticProbesEnabled) return;
+
+    if (perVPLDistToViewer.size() == 0) {
+        // Culling didn't run this frame so make sure the shader sees 0 live VPLs
+        const int numVisible = 0;
+        state_.vpls.vplVisibleIndices.CopyDataToBuffer(0, sizeof(int), (const void *)&numVisible);
+    }
 
     // auto space = LogSpace<float>(1, 512, 30);
     // for (const auto& s : space) std::cout << s << " ";
@@ -1844,6 +2189,14 @@ void RendererBackend::ComputeVirtualPointLightGlobalIllumination_(const VplDistV
     haltonSequence_.BindBase(GpuBaseBindingPoint::SHADER_STORAGE_BUFFER, 4);
     state_.vplGlobalIllumination->SetInt("haltonSize", int(haltonSequence.size()));
 
+    state_.vplGlobalIllumination->SetBool("staticProbesEnabled", staticProbesEnabled);
+    if (staticProbesEnabled) {
+        staticIrradianceProbes_.BindBase(GpuBaseBindingPoint::SHADER_STORAGE_BUFFER, 5);
+        state_.vplGlobalIllumination->SetVec3("probeGridOrigin", uploadedIrradianceProbes_->origin);
+        state_.vplGlobalIllumination->SetFloat("probeGridSpacing", uploadedIrradianceProbes_->spacing);
+        state_.vplGlobalIllumination->SetIVec3("probeGridDimensions", uploadedIrradianceProbes_->dimensions);
+    }
+
     state_.vplGlobalIllumination->SetMat4("invProjectionView", frame_->invProjectionView);
     for (size_t i = 0; i < cache.buffers.size(); ++i) {
         state_.vplGlobalIllumination->BindTexture("shadowCubeMaps[" + std::to_string(i) + "]", *cache.buffers[i].GetDepthStencilAttachment());
@@ -1954,6 +2307,8 @@ void RendererBackend::ComputeVirtualPointLightGlobalIllumination_(const VplDistV
 void RendererBackend::RenderScene(const double deltaSeconds) {
     CHECK_IS_APPLICATION_THREAD();
 
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "RenderScene");
+
     const Camera& c = *frame_->camera;
 
     // Bind buffers
@@ -1965,6 +2320,7 @@ void RendererBackend::RenderScene(const double deltaSeconds) {
     if (frame_->csc.worldLight->GetEnabled()) {
         RenderCSMDepth_();
     }
+    UpdateCascadeDepthReadback_();
 
     VplDistMultiSet_ perLightDistToViewerSet(StackBasedPoolAllocator<VplDistKey_>(frame_->perFrameScratchMemory));
     VplDistVector_ perLightDistToViewerVec(StackBasedPoolAllocator<VplDistKey_>(frame_->perFrameScratchMemory));
@@ -1978,6 +2334,8 @@ void RendererBackend::RenderScene(const double deltaSeconds) {
 
     std::vector<int, StackBasedPoolAllocator<int>> visibleVplIndices(StackBasedPoolAllocator<int>(frame_->perFrameScratchMemory));
 
+    UpdateStaticIrradianceProbes_();
+
     // Perform point light pass
     UpdatePointLights_(
         perLightDistToViewerSet, perLightDistToViewerVec,
@@ -2008,39 +2366,39 @@ void RendererBackend::RenderScene(const double deltaSeconds) {
     RenderAtmosphericShadowing_();
 
     // Begin deferred lighting pass
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
-    state_.lightingFbo.Bind();
-
-    //_unbindAllTextures();
-    Pipeline* lighting = state_.lighting.get();
-    if (frame_->csc.worldLight->GetEnabled()) {
-        lighting = state_.lightingWithInfiniteLight.get();
-    }
-
-    BindShader_(lighting);
-    InitLights_(lighting, perLightDistToViewerVec, state_.maxShadowCastingLightsPerFrame);
-    lighting->BindTexture("atmosphereBuffer", state_.atmosphericTexture);
-    lighting->SetMat4("invProjectionView", frame_->invProjectionView);
-    lighting->BindTexture("gDepth", state_.currentFrame.depth);
-    lighting->BindTexture("gNormal", state_.currentFrame.normals);
-    lighting->BindTexture("gAlbedo", state_.currentFrame.albedo);
-    lighting->BindTexture("gBaseReflectivity", state_.currentFrame.baseReflectivity);
-    lighting->BindTexture("gRoughnessMetallicAmbient", state_.currentFrame.roughnessMetallicAmbient);
-    lighting->BindTexture("ssao", state_.ssaoOcclusionBlurredTexture);
-    lighting->SetFloat("windowWidth", frame_->viewportWidth);
-    lighting->SetFloat("windowHeight", frame_->viewportHeight);
-    lighting->SetVec3("fogColor", frame_->settings.GetFogColor());
-    lighting->SetFloat("fogDensity", frame_->settings.GetFogDensity());
-    RenderQuad_();
-    state_.lightingFbo.Unbind();
-    UnbindShader_();
+    {
+        STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "Lighting");
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_DEPTH_TEST);
+        state_.lightingFbo.Bind();
+
+        //_unbindAllTextures();
+        Pipeline* lighting = state_.lighting->Get(LightingVariant_(frame_->csc.worldLight->GetEnabled()));
+
+        BindShader_(lighting);
+        InitLights_(lighting, perLightDistToViewerVec, state_.maxShadowCastingLightsPerFrame);
+        lighting->BindTexture("atmosphereBuffer", state_.atmosphericTexture);
+        lighting->SetMat4("invProjectionView", frame_->invProjectionView);
+        lighting->BindTexture("gDepth", state_.currentFrame.depth);
+        lighting->BindTexture("gNormal", state_.currentFrame.normals);
+        lighting->BindTexture("gAlbedo", state_.currentFrame.albedo);
+        lighting->BindTexture("gBaseReflectivity", state_.currentFrame.baseReflectivity);
+        lighting->BindTexture("gRoughnessMetallicAmbient", state_.currentFrame.roughnessMetallicAmbient);
+        lighting->BindTexture("ssao", state_.ssaoOcclusionBlurredTexture);
+        lighting->SetFloat("windowWidth", frame_->viewportWidth);
+        lighting->SetFloat("windowHeight", frame_->viewportHeight);
+        lighting->SetVec3("fogColor", frame_->settings.GetFogColor());
+        lighting->SetFloat("fogDensity", frame_->settings.GetFogDensity());
+        RenderQuad_();
+        state_.lightingFbo.Unbind();
+        UnbindShader_();
+    }
     state_.finalScreenBuffer = state_.lightingFbo; // state_.lightingColorBuffer;
 
     // If world light is enabled perform VPL Global Illumination pass
     if (frame_->csc.worldLight->GetEnabled() && frame_->settings.globalIlluminationEnabled) {
         // Handle VPLs for global illumination (can't do this earlier due to needing position data from GBuffer)
-        PerformVirtualPointLightCullingStage2_(perVPLDistToViewerVec);
+        PerformVirtualPointLightCullingStage2_(perVPLDistToViewerVec, visibleVplIndices);
         ComputeVirtualPointLightGlobalIllumination_(perVPLDistToViewerVec, deltaSeconds);
     }
 
@@ -2069,17 +2427,15 @@ void RendererBackend::RenderScene(const double deltaSeconds) {
     state_.finalScreenBuffer = state_.lightingFbo;// state_.lightingColorBuffer;
     // glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    // Enable post-FX effects such as bloom
+    // Enable post-FX effects such as bloom, then draw the result to the screen
     PerformPostFxProcessing_();
 
-    // Perform final drawing to screen + gamma correction
-    FinalizeFrame_();
-
     // Unbind element array buffer
     GpuMeshAllocator::UnbindElementArrayBuffer();
 }
 
 void RendererBackend::RenderForwardPassPbr_() {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "GBuffer");
     // Make sure to bind our own frame buffer for rendering
     state_.currentFrame.fbo.Bind();
 
@@ -2113,6 +2469,7 @@ void RendererBackend::RenderForwardPassPbr_() {
 }
 
 void RendererBackend::RenderForwardPassFlat_() {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "ForwardFlat");
     BindShader_(state_.forward.get());
 
     auto& jitter = frame_->settings.taaEnabled ? frame_->jitterProjectionView : frame_->projectionView;
@@ -2130,124 +2487,87 @@ void RendererBackend::RenderForwardPassFlat_() {
     UnbindShader_();
 }
 
+static GLbitfield ConvertRenderGraphBarriers(const Bitfield barriers) {
+    GLbitfield bits = 0;
+    if (barriers & RENDER_GRAPH_BARRIER_TEXTURE_FETCH) bits |= GL_TEXTURE_FETCH_BARRIER_BIT;
+    if (barriers & RENDER_GRAPH_BARRIER_SHADER_IMAGE_ACCESS) bits |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+    if (barriers & RENDER_GRAPH_BARRIER_FRAMEBUFFER) bits |= GL_FRAMEBUFFER_BARRIER_BIT;
+    return bits;
+}
+
 void RendererBackend::PerformPostFxProcessing_() {
+    // Switching an effect on or off changes which passes survive and which buffers can be shared
+    if (GetPostFxRenderGraphParams_() != state_.postFxParams) {
+        InitializePostFxBuffers_();
+        if (!isValid_) return;
+    }
+
     glDisable(GL_CULL_FACE);
     glDisable(GL_BLEND);
-    //glDisable(GL_BLEND);
     glDisable(GL_DEPTH_TEST);
 
-    PerformTaaPostFx_();
-
-    PerformBloomPostFx_();
-
-    PerformAtmosphericPostFx_();
-
-    // Needs to happen before FXAA since FXAA works on color graded LDR values (not HDR)
-    PerformGammaTonemapPostFx_();
-
-    PerformFxaaPostFx_();
+    // TAA -> bloom -> atmospherics -> tonemapping -> FXAA -> screen (see BuildPostFxRenderGraph)
+    state_.postFxGraph.Execute([](const Bitfield barriers) {
+        glMemoryBarrier(ConvertRenderGraphBarriers(barriers));
+    });
 
     glEnable(GL_CULL_FACE);
     glEnable(GL_BLEND);
     glEnable(GL_DEPTH_TEST);
 }
 
-void RendererBackend::PerformBloomPostFx_() {
-    if (!frame_->settings.bloomEnabled) return;
+void RendererBackend::RenderBloomQuad_(const PostFxRenderGraphPass& pass) {
+    Pipeline* bloom = state_.bloom.get();
+    FrameBuffer& output = GetPostFxBuffer_(pass.output);
+    const Texture colorTex = output.GetColorAttachments()[0];
+    const auto width = colorTex.Width();
+    const auto height = colorTex.Height();
+
+    bloom->SetFloat("viewportX", float(width));
+    bloom->SetFloat("viewportY", float(height));
+    output.Bind();
+    glViewport(0, 0, width, height);
+    bloom->BindTexture("mainTexture", GetPostFxBuffer_(pass.input).GetColorAttachments()[0]);
+    RenderQuad_();
+    output.Unbind();
+}
 
-    // We use this so that we can avoid a final copy between the downsample and blurring stages
-    std::vector<PostFXBuffer, StackBasedPoolAllocator<PostFXBuffer>> finalizedPostFxFrames(
-        state_.numDownsampleIterations + state_.numUpsampleIterations,
-        StackBasedPoolAllocator<PostFXBuffer>(frame_->perFrameScratchMemory)
-    );
-   
+void RendererBackend::PerformBloomDownsamplePostFx_(const PostFxRenderGraphPass& pass) {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "BloomDownsample");
     Pipeline* bloom = state_.bloom.get();
     BindShader_(bloom);
-
-    Texture lightingColorBuffer = state_.finalScreenBuffer.GetColorAttachments()[0];
-
-    // Downsample stage
     bloom->SetBool("downsamplingStage", true);
     bloom->SetBool("upsamplingStage", false);
     bloom->SetBool("finalStage", false);
     bloom->SetBool("gaussianStage", false);
-    for (int i = 0, gaussian = 0; i < state_.numDownsampleIterations; ++i, gaussian += 2) {
-        PostFXBuffer& buffer = state_.postFxBuffers[i];
-        Texture colorTex = buffer.fbo.GetColorAttachments()[0];
-        auto width = colorTex.Width();
-        auto height = colorTex.Height();
-        bloom->SetFloat("viewportX", float(width));
-        bloom->SetFloat("viewportY", float(height));
-        buffer.fbo.Bind();
-        glViewport(0, 0, width, height);
-        if (i == 0) {
-            bloom->BindTexture("mainTexture", lightingColorBuffer);
-        }
-        else {
-            bloom->BindTexture("mainTexture", state_.postFxBuffers[i - 1].fbo.GetColorAttachments()[0]);
-        }
-        RenderQuad_();
-        buffer.fbo.Unbind();
-
-        // Now apply Gaussian blurring
-        bool horizontal = false;
-        bloom->SetBool("downsamplingStage", false);
-        bloom->SetBool("gaussianStage", true);
-        BufferBounds bounds = BufferBounds{0, 0, width, height};
-        for (int i = 0; i < 2; ++i) {
-            FrameBuffer& blurFbo = state_.gaussianBuffers[gaussian + i].fbo;
-            FrameBuffer copyFromFbo;
-            if (i == 0) {
-                copyFromFbo = buffer.fbo;
-            }
-            else {
-                copyFromFbo = state_.gaussianBuffers[gaussian].fbo;
-            }
-
-            bloom->SetBool("horizontal", horizontal);
-            bloom->BindTexture("mainTexture", copyFromFbo.GetColorAttachments()[0]);
-            horizontal = !horizontal;
-            blurFbo.Bind();
-            RenderQuad_();
-            blurFbo.Unbind();
-        }
+    RenderBloomQuad_(pass);
+    UnbindShader_();
+}
 
-        // Copy the end result back to the original buffer
-        // buffer.fbo.copyFrom(_state.gaussianBuffers[gaussian + 1].fbo, bounds, bounds, BufferBit::COLOR_BIT, BufferFilter::LINEAR);
-        finalizedPostFxFrames[i] = state_.gaussianBuffers[gaussian + 1];
-    }
+void RendererBackend::PerformBloomBlurPostFx_(const PostFxRenderGraphPass& pass, const bool horizontal) {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "BloomBlur");
+    Pipeline* bloom = state_.bloom.get();
+    BindShader_(bloom);
+    bloom->SetBool("downsamplingStage", false);
+    bloom->SetBool("upsamplingStage", false);
+    bloom->SetBool("finalStage", false);
+    bloom->SetBool("gaussianStage", true);
+    bloom->SetBool("horizontal", horizontal);
+    RenderBloomQuad_(pass);
+    UnbindShader_();
+}
 
-    // Upsample stage
+void RendererBackend::PerformBloomUpsamplePostFx_(const PostFxRenderGraphPass& pass, const bool finalStage) {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "BloomUpsample");
+    Pipeline* bloom = state_.bloom.get();
+    BindShader_(bloom);
     bloom->SetBool("downsamplingStage", false);
     bloom->SetBool("upsamplingStage", true);
-    bloom->SetBool("finalStage", false);
+    bloom->SetBool("finalStage", finalStage);
     bloom->SetBool("gaussianStage", false);
-    int postFXIndex = state_.numDownsampleIterations;
-    for (int i = state_.numDownsampleIterations - 1; i >= 0; --i, ++postFXIndex) {
-        PostFXBuffer& buffer = state_.postFxBuffers[postFXIndex];
-        auto width = buffer.fbo.GetColorAttachments()[0].Width();
-        auto height = buffer.fbo.GetColorAttachments()[0].Height();
-        bloom->SetFloat("viewportX", float(width));
-        bloom->SetFloat("viewportY", float(height));
-        buffer.fbo.Bind();
-        glViewport(0, 0, width, height);
-        //bloom->bindTexture("mainTexture", _state.postFxBuffers[postFXIndex - 1].fbo.getColorAttachments()[0]);
-        bloom->BindTexture("mainTexture", finalizedPostFxFrames[postFXIndex - 1].fbo.GetColorAttachments()[0]);
-        if (i == 0) {
-            bloom->BindTexture("bloomTexture", lightingColorBuffer);
-            bloom->SetBool("finalStage", true);
-        }
-        else {
-            //bloom->bindTexture("bloomTexture", _state.postFxBuffers[i - 1].fbo.getColorAttachments()[0]);
-            bloom->BindTexture("bloomTexture", finalizedPostFxFrames[i - 1].fbo.GetColorAttachments()[0]);
-        }
-        RenderQuad_();
-        buffer.fbo.Unbind();
-        
-        finalizedPostFxFrames[postFXIndex] = buffer;
-        state_.finalScreenBuffer = buffer.fbo; //buffer.fbo.GetColorAttachments()[0];
-    }
-
+    // The blurred level at this size, or the original image for the last pass
+    bloom->BindTexture("bloomTexture", GetPostFxBuffer_(pass.secondary).GetColorAttachments()[0]);
+    RenderBloomQuad_(pass);
     UnbindShader_();
 }
 
@@ -2268,9 +2588,8 @@ glm::vec3 RendererBackend::CalculateAtmosphericLightPosition_() const {
     return 2.0f * normalizedLightDirCamSpace.z * glm::vec3(xlight, ylight, 1.0f);
 }
 
-void RendererBackend::PerformAtmosphericPostFx_() {
-    if (!frame_->csc.worldLight->GetEnabled()) return;
-
+void RendererBackend::PerformAtmosphericPostFx_(const PostFxRenderGraphPass& pass) {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "AtmosphericPostFx");
     glViewport(0, 0, frame_->viewportWidth, frame_->viewportHeight);
 
     const glm::vec3 lightPosition = CalculateAtmosphericLightPosition_();
@@ -2278,74 +2597,55 @@ void RendererBackend::PerformAtmosphericPostFx_() {
     //const float cosX = stratus::cosine(_frame->csc.worldLight->getRotation().x).value();
     const glm::vec3 lightColor = frame_->csc.worldLight->GetAtmosphereColor();// * glm::vec3(cosX, cosX, sinX);
 
+    FrameBuffer& output = GetPostFxBuffer_(pass.output);
     BindShader_(state_.atmosphericPostFx.get());
-    state_.atmosphericPostFxBuffer.fbo.Bind();
+    output.Bind();
     state_.atmosphericPostFx->BindTexture("atmosphereBuffer", state_.atmosphericTexture);
-    state_.atmosphericPostFx->BindTexture("screenBuffer", state_.finalScreenBuffer.GetColorAttachments()[0]);
+    state_.atmosphericPostFx->BindTexture("screenBuffer", GetPostFxBuffer_(pass.input).GetColorAttachments()[0]);
     state_.atmosphericPostFx->SetVec3("lightPosition", lightPosition);
     state_.atmosphericPostFx->SetVec3("lightColor", lightColor);
     RenderQuad_();
-    state_.atmosphericPostFxBuffer.fbo.Unbind();
+    output.Unbind();
     UnbindShader_();
-
-    state_.finalScreenBuffer = state_.atmosphericPostFxBuffer.fbo; //state_.atmosphericPostFxBuffer.fbo.GetColorAttachments()[0];
 }
 
-void RendererBackend::PerformFxaaPostFx_() {
-    if (!frame_->settings.fxaaEnabled) return;
-
+void RendererBackend::PerformScreenPostFx_(const char * name, Pipeline * pipeline, const PostFxRenderGraphPass& pass) {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), name);
     glViewport(0, 0, frame_->viewportWidth, frame_->viewportHeight);
 
-    // Perform luminance calculation pass
-    BindShader_(state_.fxaaLuminance.get());
-    
-    state_.fxaaFbo1.fbo.Bind();
-    state_.fxaaLuminance->BindTexture("screen", state_.finalScreenBuffer.GetColorAttachments()[0]);
-    RenderQuad_();
-    state_.fxaaFbo1.fbo.Unbind();
-
-    UnbindShader_();
-
-    state_.finalScreenBuffer = state_.fxaaFbo1.fbo; // state_.fxaaFbo1.fbo.GetColorAttachments()[0];
-
-    // Perform smoothing pass
-    BindShader_(state_.fxaaSmoothing.get());
-
-    state_.fxaaFbo2.fbo.Bind();
-    state_.fxaaSmoothing->BindTexture("screen", state_.finalScreenBuffer.GetColorAttachments()[0]);
+    FrameBuffer& output = GetPostFxBuffer_(pass.output);
+    BindShader_(pipeline);
+    output.Bind();
+    pipeline->BindTexture("screen", GetPostFxBuffer_(pass.input).GetColorAttachments()[0]);
     RenderQuad_();
-    state_.fxaaFbo2.fbo.Unbind();
-
+    output.Unbind();
     UnbindShader_();
-
-    state_.finalScreenBuffer = state_.fxaaFbo2.fbo; // state_.fxaaFbo2.fbo.GetColorAttachments()[0];
 }
 
-void RendererBackend::PerformTaaPostFx_() {
-    if (!frame_->settings.taaEnabled) return;
-
+void RendererBackend::PerformTaaPostFx_(const PostFxRenderGraphPass& pass) {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "TAA");
     glViewport(0, 0, frame_->viewportWidth, frame_->viewportHeight);
 
     BindShader_(state_.taa.get());
 
-    state_.taaFbo.fbo.Bind();
+    FrameBuffer& output = GetPostFxBuffer_(pass.output);
+    output.Bind();
 
-    state_.taa->BindTexture("screen", state_.finalScreenBuffer.GetColorAttachments()[0]);
+    state_.taa->BindTexture("screen", GetPostFxBuffer_(pass.input).GetColorAttachments()[0]);
     state_.taa->BindTexture("prevScreen", state_.previousFrameBuffer.GetColorAttachments()[0]);
     state_.taa->BindTexture("velocity", state_.currentFrame.velocity);
     state_.taa->BindTexture("previousVelocity", state_.previousFrame.velocity);
 
     RenderQuad_();
 
-    state_.taaFbo.fbo.Unbind();
+    output.Unbind();
 
     UnbindShader_();
+}
 
-    state_.finalScreenBuffer = state_.taaFbo.fbo;
-
-    // Update history texture
-    state_.previousFrameBuffer.CopyFrom(
-        state_.finalScreenBuffer,
+void RendererBackend::UpdateTaaHistory_(const PostFxRenderGraphPass& pass) {
+    GetPostFxBuffer_(pass.output).CopyFrom(
+        GetPostFxBuffer_(pass.input),
         BufferBounds{ 0, 0, frame_->viewportWidth, frame_->viewportHeight },
         BufferBounds{ 0, 0, frame_->viewportWidth, frame_->viewportHeight },
         BufferBit::COLOR_BIT,
@@ -2353,21 +2653,9 @@ void RendererBackend::PerformTaaPostFx_() {
     );
 }
 
-void RendererBackend::PerformGammaTonemapPostFx_() {
-    glViewport(0, 0, frame_->viewportWidth, frame_->viewportHeight);
-
-    BindShader_(state_.gammaTonemap.get());
-    state_.gammaTonemapFbo.fbo.Bind();
-    state_.gammaTonemap->BindTexture("screen", state_.finalScreenBuffer.GetColorAttachments()[0]);
-    RenderQuad_();
-    UnbindShader_();
-
-    state_.finalScreenBuffer = state_.gammaTonemapFbo.fbo; //state_.gammaTonemapFbo.fbo.GetColorAttachments()[0];
-}
-
-void RendererBackend::FinalizeFrame_() {
-    // Copy final frame to current frame
-    //state_.gammaTonemapFbo.fbo.CopyFrom()
+void RendererBackend::FinalizeFrame_(const PostFxRenderGraphPass& pass) {
+    STRATUS_PROFILE_GPU_SCOPE(gpuProfiler_.get(), "FinalizeFrame");
+    state_.finalScreenBuffer = GetPostFxBuffer_(pass.input);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glDisable(GL_CULL_FACE);
@@ -2526,21 +2814,25 @@ void RendererBackend::InitLights_(Pipeline * s, const VplDistVector_& lights, co
     gpuLights.reserve(lights.size());
     gpuShadowCubeMaps.reserve(maxShadowLights);
     gpuShadowLights.reserve(maxShadowLights);
+    const auto& positions = frame_->lights.Positions();
+    const auto& radii = frame_->lights.Radii();
+    const auto& colors = frame_->lights.Colors();
+    const auto& flags = frame_->lights.Flags();
     for (int i = 0; i < lights.size(); ++i) {
         LightPtr light = lights[i].key;
-        PointLight* point = (PointLight*)light.get();
+        const size_t index = lights[i].index;
 
-        if (point->IsVirtualLight()) {
+        if (flags[index] & LIGHT_FLAG_VIRTUAL) {
             continue;
         }
 
         GpuPointLight gpuLight;
-        gpuLight.position = GpuVec(glm::vec4(point->GetPosition(), 1.0f));
-        gpuLight.color = GpuVec(glm::vec4(point->GetColor(), 1.0f));
-        gpuLight.farPlane = point->GetFarPlane();
-        gpuLight.radius = point->GetRadius();
+        gpuLight.position = GpuVec(glm::vec4(positions[index], 1.0f));
+        gpuLight.color = GpuVec(glm::vec4(colors[index], 1.0f));
+        gpuLight.farPlane = radii[index];
+        gpuLight.radius = radii[index];
 
-        if (point->CastsShadows() && gpuShadowLights.size() < maxShadowLights) {
+        if ((flags[index] & LIGHT_FLAG_CASTS_SHADOWS) && gpuShadowLights.size() < maxShadowLights) {
             gpuShadowLights.push_back(std::move(gpuLight));
             auto smap = GetOrAllocateShadowMapForLight_(light);
             gpuShadowCubeMaps.push_back(smap);
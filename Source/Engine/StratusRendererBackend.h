@@ -26,6 +26,13 @@
 #include "StratusRenderComponents.h"
 #include "StratusGpuMaterialBuffer.h"
 #include "StratusGpuCommandBuffer.h"
+#include "StratusIrradianceProbes.h"
+#include "StratusLightRegistry.h"
+#include "StratusShadowFaceCulling.h"
+#include "StratusVplCulling.h"
+#include "StratusGraphicsDriver.h"
+#include "StratusShaderPermutation.h"
+#include "StratusRenderGraph.h"
 #include <functional>
 #include "StratusStackAllocator.h"
 #include <set>
@@ -33,6 +40,9 @@
 
 namespace stratus {
     class Pipeline;
+    class PipelinePermutations;
+    struct PipelineVariantStats;
+    class GpuProfiler;
     class Light;
     class InfiniteLight;
     class Quad;
@@ -93,10 +103,15 @@ namespace stratus {
         float cascadeRadius;
         float cascadeBegins;
         float cascadeEnds;
+        // See CascadeCache - when caching is disabled both are always true
+        bool renderStatic = true;
+        bool renderDynamic = true;
     };
 
     struct RendererCascadeContainer {
         FrameBuffer fbo;
+        // Static casters only (one layer per cascade). Only allocated when cascade caching is enabled.
+        FrameBuffer staticFbo;
         std::vector<RendererCascadeData> cascades;
         glm::vec4 cascadeShadowOffsets[2];
         uint32_t cascadeResolutionXY;
@@ -108,80 +123,6 @@ namespace stratus {
         bool regenerateFbo;    
     };
 
-    struct LightUpdateQueue {
-        template<typename LightPtrContainer>
-        void PushBackAll(const LightPtrContainer& container) {
-            for (const LightPtr& ptr : container) {
-                PushBack(ptr);
-            }
-        }
-
-        void PushFront(const LightPtr& ptr) {
-            auto existing = existing_.find(ptr);
-            // Allow lights further in the queue to be bumped higher up
-            // with this function
-            if (existing != existing_.end()) {
-                queue_.erase(existing->second);
-                existing_.erase(ptr);
-            }
-
-            queue_.push_front(ptr);
-            auto it = queue_.begin();
-            existing_.insert(std::make_pair(ptr, it));
-        }
-
-        void PushBack(const LightPtr& ptr) {
-            // If a light is already in the queue, don't reorder since it would
-            // result in the light losing its better place in line
-            if (existing_.find(ptr) != existing_.end() || !ptr->CastsShadows()) return;
-
-            queue_.push_back(ptr);
-            auto it = queue_.end();
-            --it;
-            existing_.insert(std::make_pair(ptr, it));
-        }
-
-        LightPtr PopFront() {
-            if (Size() == 0) return nullptr;
-            auto front = Front();
-            existing_.erase(front);
-            queue_.pop_front();
-            return front;
-        }
-
-        LightPtr Front() const {
-            if (Size() == 0) return nullptr;
-            return queue_.front();
-        }
-
-        // In case a light needs to be removed without being updated
-        void Erase(const LightPtr& ptr) {
-            if (existing_.find(ptr) == existing_.end()) return;
-            existing_.erase(ptr);
-            for (auto it = queue_.begin(); it != queue_.end(); ++it) {
-                const LightPtr& light = *it;
-                if (ptr == light) {
-                    queue_.erase(it);
-                    return;
-                }
-            }
-        }
-
-        // In case all lights need to be removed without being updated
-        void Clear() {
-            queue_.clear();
-            existing_.clear();
-        }
-
-        size_t Size() const {
-            return queue_.size();
-        }
-
-    private:
-        std::list<LightPtr> queue_;
-        std::unordered_map<LightPtr, std::list<LightPtr>::iterator> existing_;
-    };
-
     // Settings which can be changed at runtime by the application
     struct RendererSettings {
         // These are values we don't need to range check
@@ -192,9 +133,24 @@ namespace stratus {
         bool taaEnabled = true;
         bool bloomEnabled = true;
         bool usePerceptualRoughness = true;
+        // When true VPL visibility is computed on the CPU which removes the blocking readback
+        // of the GPU culling results. The result is approximate: the shadow test runs on a
+        // downsampled cascade depth copy which is a frame or two old, and falls back to cascade
+        // coverage until the first copy arrives
+        bool cpuVplCullingEnabled = false;
+        // When true static shadow casters are rendered into a per-cascade cache which is only
+        // refreshed when the cascade moves or static geometry changes. Dynamic casters are drawn
+        // on top and the far cascades alternate frames.
+        bool cascadeCachingEnabled = true;
+        // When true point light shadow updates test the casters against each cube face on the CPU
+        // first so that faces (and lights) with nothing to draw are skipped
+        bool pointShadowFaceCullingEnabled = true;
+        // When true the shader files are checked for changes about once a second and the pipelines
+        // using a changed file are recompiled
+        bool shaderHotReloadEnabled = false;
         RendererCascadeResolution cascadeResolution = RendererCascadeResolution::CASCADE_RESOLUTION_1024;
-        // Records how much temporary memory the renderer is allowed to use
-        // per frame
+        // How much temporary memory the renderer starts out with per frame. It
+        // grows past this when a frame needs more but never shrinks below it.
         size_t perFrameMaxScratchMemoryBytes = 134217728; // 128 mb
 
         float GetEmissionStrength() const {
@@ -303,10 +259,11 @@ namespace stratus {
         GpuMaterialBufferPtr materialInfo;
         RendererCascadeContainer csc;
         GpuCommandManagerPtr drawCommands;
-        std::unordered_set<LightPtr> lights;
-        std::unordered_set<LightPtr> virtualPointLights; // data is in lights
+        LightRegistry lights;
         LightUpdateQueue lightsToUpdate; // shadow map data is invalid
-        std::unordered_set<LightPtr> lightsToRemove;
+        std::vector<LightPtr> lightsToRemove;
+        // Baked static GI - when set baked VPLs are skipped by the per-frame GI pass
+        IrradianceProbeGridPtr staticIrradianceProbes;
         float znear;
         float zfar;
         glm::mat4 projection;
@@ -318,6 +275,10 @@ namespace stratus {
         glm::mat4 prevInvProjectionView = glm::mat4(1.0f);
         glm::vec4 clearColor;
         RendererSettings settings;
+        // Everything allocated from here is freed at the end of the frame. Worker threads
+        // allocate through scratchArena->ThreadAllocator().
+        std::shared_ptr<FrameArena> scratchArena;
+        // The application thread's sub-arena of scratchArena
         UnsafePtr<StackAllocator> perFrameScratchMemory;
         bool viewportDirty;
     };
@@ -341,6 +302,20 @@ namespace stratus {
             FrameBuffer fbo;
         };
 
+        struct CascadeDepthReadback_ {
+            GpuBuffer buffer;
+            GpuHostFence fence;
+            // Cascade data at the time of the copy - depth is filled in once the fence has passed
+            VplCascadeDepthSnapshot snapshot;
+        };
+
+        struct VplColorReadback_ {
+            GpuBuffer buffer;
+            GpuHostFence fence;
+            // Baked lights and their index into the copy of vplUpdatedData
+            std::vector<std::pair<LightPtr, u32>> lights;
+        };
+
         struct VirtualPointLightData {
             // For splitting viewport into tiles
             const int tileXDivisor = 5;
@@ -355,6 +330,19 @@ namespace stratus {
             GpuBuffer vplData;
             GpuBuffer vplUpdatedData;
             GpuBuffer vplVisibleIndices;
+            // CPU copy of vplData used by the CPU culling path
+            std::vector<GpuVplData> vplCpuData;
+            // Cascade depth copied back for the CPU culling path. Copies are downsampled with a blit and
+            // read into a pixel pack buffer so the CPU only has to wait for a fence which has passed.
+            FrameBuffer cascadeDepthSource;
+            FrameBuffer cascadeDepthCopy;
+            std::deque<CascadeDepthReadback_> cascadeDepthReadbacks;
+            std::vector<GpuBuffer> freeCascadeDepthBuffers;
+            // Most recent completed copy (see CpuVplCulling::IsLit)
+            VplCascadeDepthSnapshot cascadeDepth;
+            // Colors computed by vpl_light_color.cs copied back for baked lights (see VirtualPointLight::GetSunDrivenColor)
+            std::deque<VplColorReadback_> colorReadbacks;
+            std::vector<GpuBuffer> freeColorBuffers;
             //GpuBuffer vplNumVisible;
             FrameBuffer vplGIFbo;
             FrameBuffer vplGIDenoisedPrevFrameFbo;
@@ -375,7 +363,7 @@ namespace stratus {
             // How many shadow maps can be rebuilt each frame
             // Lights are inserted into a queue to prevent any light from being
             // over updated or neglected
-            int maxShadowUpdatesPerFrame = 5;
+            int maxShadowUpdatesPerFrame = RendererBackend::MaxShadowUpdatesPerFrame;
             //std::shared_ptr<Camera> camera;
             Pipeline * currentShader = nullptr;
             // Buffer where all color data is written
@@ -399,24 +387,15 @@ namespace stratus {
             FrameBuffer atmosphericFbo;
             Texture atmosphericTexture;
             Texture atmosphericNoiseTexture;
-            // Used for gamma-tonemapping
-            PostFXBuffer gammaTonemapFbo;
-            // Used for fast approximate anti-aliasing (FXAA)
-            PostFXBuffer fxaaFbo1;
-            PostFXBuffer fxaaFbo2;
-            // Used for temporal anti-aliasing (TAA)
-            PostFXBuffer taaFbo;
             // Need to keep track of these to clear them at the end of each frame
             std::vector<GpuArrayBuffer> gpuBuffers;
-            // For everything else including bloom post-processing
-            int numBlurIterations = 10;
-            // Might change from frame to frame
-            int numDownsampleIterations = 0;
-            int numUpsampleIterations = 0;
-            std::vector<PostFXBuffer> gaussianBuffers;
+            // Post processing chain (TAA, bloom, atmospherics, tonemapping and FXAA). Rebuilt whenever
+            // the viewport changes or an effect is switched on or off.
+            RenderGraph postFxGraph;
+            PostFxRenderGraph postFx;
+            PostFxRenderGraphParams postFxParams;
+            // One per physical texture in postFxGraph - aliased textures share a buffer
             std::vector<PostFXBuffer> postFxBuffers;
-            // Handles atmospheric post processing
-            PostFXBuffer atmosphericPostFxBuffer;
             // End of the pipeline should write to this
             FrameBuffer finalScreenBuffer;
             // Used for TAA
@@ -426,9 +405,8 @@ namespace stratus {
             GLenum blendDFactor = GL_ZERO;
             // Depth prepass
             std::unique_ptr<Pipeline> depthPrepass;
-            // Skybox
-            std::unique_ptr<Pipeline> skybox;
-            std::unique_ptr<Pipeline> skyboxLayered;
+            // Skybox, with a variant for rendering into cube map layers
+            std::unique_ptr<PipelinePermutations> skybox;
             // Postprocessing shader which allows for application
             // of hdr and gamma correction
             std::unique_ptr<Pipeline> gammaTonemap;
@@ -447,9 +425,8 @@ namespace stratus {
             std::unique_ptr<Pipeline> atmospheric;
             // Handles atmospheric post fx stage
             std::unique_ptr<Pipeline> atmosphericPostFx;
-            // Handles the lighting stage
-            std::unique_ptr<Pipeline> lighting;
-            std::unique_ptr<Pipeline> lightingWithInfiniteLight;
+            // Handles the lighting stage, with and without the infinite light
+            std::unique_ptr<PipelinePermutations> lighting;
             // Handles global illuminatino stage
             std::unique_ptr<Pipeline> vplGlobalIllumination;
             std::unique_ptr<Pipeline> vplGlobalIlluminationDenoising;
@@ -463,9 +440,8 @@ namespace stratus {
             // Draws axis-aligned bounding boxes
             std::unique_ptr<Pipeline> aabbDraw;
             // Handles cascading shadow map depth buffer rendering
-            // (we compile one depth shader per cascade - max 6)
-            std::vector<std::unique_ptr<Pipeline>> csmDepth;
-            std::vector<std::unique_ptr<Pipeline>> csmDepthRunAlphaTest;
+            // (one variant per cascade - max 6 - with and without the alpha test)
+            std::unique_ptr<PipelinePermutations> csmDepth;
             // Handles fxaa luminance followed by fxaa smoothing
             std::unique_ptr<Pipeline> fxaaLuminance;
             std::unique_ptr<Pipeline> fxaaSmoothing;
@@ -474,6 +450,8 @@ namespace stratus {
             // Performs full screen pass through
             std::unique_ptr<Pipeline> fullscreen;
             std::vector<Pipeline *> shaders;
+            // Compiled on first use so they are not in shaders
+            std::vector<PipelinePermutations *> permutations;
             // Generic unit cube to render as skybox
             EntityPtr skyboxCube;
             // Generic screen quad so we can render the screen
@@ -484,6 +462,10 @@ namespace stratus {
             std::vector<GpuCommandReceiveManagerPtr> dynamicPerPointLightDrawCalls;
             std::vector<GpuCommandReceiveManagerPtr> staticPerPointLightDrawCalls;
             std::unique_ptr<Pipeline> viscullPointLights;
+            // World space caster bounds used by the point shadow face pre-pass (rebuilt each frame)
+            std::vector<GpuAABB> staticCasterAabbs;
+            std::vector<GpuAABB> dynamicCasterAabbs;
+            PointShadowCullingStats pointShadowCullingStats;
         };
 
         struct TextureCache {
@@ -542,6 +524,13 @@ namespace stratus {
         // Contains some number of Halton sequence values
         GpuBuffer haltonSequence_;
 
+        // GPU copy of frame_->staticIrradianceProbes
+        GpuBuffer staticIrradianceProbes_;
+        IrradianceProbeGridPtr uploadedIrradianceProbes_;
+
+        // Timestamp queries around each pass, only active while Profiler is capturing
+        std::unique_ptr<GpuProfiler> gpuProfiler_;
+
         /**
          * If the renderer was setup properly then this will be marked
          * true.
@@ -549,6 +538,13 @@ namespace stratus {
         bool isValid_ = false;
 
     public:
+        // Shadow maps rebuilt per frame unless changed (also used by the headless frontend)
+        static constexpr int MaxShadowUpdatesPerFrame = 5;
+        // Per cascade size of the depth copies used by CPU VPL culling, and how many can be in flight
+        static constexpr u32 CascadeDepthReadbackResolution = 256;
+        static constexpr usize MaxCascadeDepthReadbacks = 2;
+        static constexpr usize MaxVplColorReadbacks = 2;
+
         explicit RendererBackend(const uint32_t width, const uint32_t height, const std::string&);
         ~RendererBackend();
 
@@ -560,10 +556,17 @@ namespace stratus {
 
         const Pipeline * GetCurrentShader() const;
 
+        // Counters from the most recent frame's point light shadow updates
+        const PointShadowCullingStats& GetPointShadowCullingStats() const;
+
         //void invalidateAllTextures();
 
+        // Recompiles the pipelines whose shader files (or anything they include) changed on disk
         void RecompileShaders();
 
+        // Every shader variant compiled on demand so far along with how long it took
+        std::vector<PipelineVariantStats> GetShaderVariantStats() const;
+
         /**
          * Attempts to load a model if not already loaded. Be sure to check
          * the returned model's isValid() function.
@@ -602,9 +605,12 @@ namespace stratus {
         struct VplDistKey_ {
             LightPtr key;
             double distance = 0.0;
+            // Index into frame_->lights' dense arrays, which hold this frame's copy of the
+            // light's parameters
+            size_t index = 0;
 
-            VplDistKey_(const LightPtr& key = nullptr, const double distance = 0.0)
-                : key(key), distance(distance) {}
+            VplDistKey_(const LightPtr& key = nullptr, const double distance = 0.0, const size_t index = 0)
+                : key(key), distance(distance), index(index) {}
 
             bool operator<(const VplDistKey_& other) const {
                 return distance < other.distance;
@@ -640,12 +646,17 @@ namespace stratus {
         void BindShader_(Pipeline *);
         void UnbindShader_();
         void PerformPostFxProcessing_();
-        void PerformBloomPostFx_();
-        void PerformAtmosphericPostFx_();
-        void PerformFxaaPostFx_();
-        void PerformTaaPostFx_();
-        void PerformGammaTonemapPostFx_();
-        void FinalizeFrame_();
+        void PerformBloomDownsamplePostFx_(const PostFxRenderGraphPass&);
+        void PerformBloomBlurPostFx_(const PostFxRenderGraphPass&, const bool horizontal);
+        void PerformBloomUpsamplePostFx_(const PostFxRenderGraphPass&, const bool finalStage);
+        void RenderBloomQuad_(const PostFxRenderGraphPass&);
+        void PerformAtmosphericPostFx_(const PostFxRenderGraphPass&);
+        void PerformScreenPostFx_(const char * name, Pipeline *, const PostFxRenderGraphPass&);
+        void PerformTaaPostFx_(const PostFxRenderGraphPass&);
+        void UpdateTaaHistory_(const PostFxRenderGraphPass&);
+        void FinalizeFrame_(const PostFxRenderGraphPass&);
+        PostFxRenderGraphParams GetPostFxRenderGraphParams_() const;
+        FrameBuffer& GetPostFxBuffer_(const RenderGraphTextureId);
         void InitializePostFxBuffers_();
         void RenderBoundingBoxes_(GpuCommandBufferPtr&);
         void RenderBoundingBoxes_(std::unordered_map<RenderFaceCulling, GpuCommandBufferPtr>&);
@@ -653,6 +664,7 @@ namespace stratus {
         void Render_(Pipeline&, const RenderFaceCulling, GpuCommandBufferPtr&, const CommandBufferSelectionFunction&, bool isLightInteracting, bool removeViewTranslation = false);
         void Render_(Pipeline&, std::unordered_map<RenderFaceCulling, GpuCommandBufferPtr>&, const CommandBufferSelectionFunction&, bool isLightInteracting, bool removeViewTranslation = false);
         void InitVplFrameData_(const VplDistVector_& perVPLDistToViewer);
+        void UpdateStaticIrradianceProbes_();
         void RenderImmediate_(std::unordered_map<RenderFaceCulling, GpuCommandBufferPtr>&, const CommandBufferSelectionFunction&, const bool reverseCullFace);
         void UpdatePointLights_(
             VplDistMultiSet_&, 
@@ -665,9 +677,12 @@ namespace stratus {
         );
         void PerformVirtualPointLightCullingStage1_(VplDistVector_&, std::vector<int, StackBasedPoolAllocator<int>>& visibleVplIndices);
         //void PerformVirtualPointLightCullingStage2_(const std::vector<std::pair<LightPtr, double>>&, const std::vector<int>& visibleVplIndices);
-        void PerformVirtualPointLightCullingStage2_(const VplDistVector_&);
+        void PerformVirtualPointLightCullingStage1Cpu_(VplDistVector_&, std::vector<int, StackBasedPoolAllocator<int>>& visibleVplIndices);
+        void PerformVirtualPointLightCullingStage2_(const VplDistVector_&, const std::vector<int, StackBasedPoolAllocator<int>>& visibleVplIndices);
         void ComputeVirtualPointLightGlobalIllumination_(const VplDistVector_&, const double);
         void RenderCSMDepth_();
+        void UpdateCascadeDepthReadback_();
+        void UpdateVplColorReadback_(std::vector<std::pair<LightPtr, u32>>& bakedLights, const usize totalVisible);
         void RenderQuad_();
         void RenderSkybox_(Pipeline *, const glm::mat4&);
         void RenderSkybox_();
@@ -688,6 +703,9 @@ namespace stratus {
         ShadowMapCache& GetSmapCacheForLight_(LightPtr);
         void RecalculateCascadeData_();
         void ValidateAllShaders_();
+        void LogShaderCompile_(const size_t numPipelines, const double milliseconds) const;
+        ShaderVariantKey CsmDepthVariant_(const u32 cascade, const bool runAlphaTest) const;
+        ShaderVariantKey LightingVariant_(const bool infiniteLightEnabled) const;
     };
 }
 
@@ -1,5 +1,6 @@
 #include "StratusRendererFrontend.h"
 #include "StratusUtils.h"
+#include "StratusProfiler.h"
 #include "StratusLog.h"
 #include "StratusWindow.h"
 #include "StratusTransformComponent.h"
@@ -64,6 +65,116 @@ namespace stratus {
         return sc.component != nullptr && sc.status == EntityComponentStatus::COMPONENT_ENABLED;
     }
 
+    static CapturedEntity CaptureEntity(const EntityPtr& p, const CaptureChange change) {
+        CapturedEntity entity;
+        entity.id = FrameCapture::Instance().IdFor(p.get());
+        entity.change = change;
+        if (change == CaptureChange::REMOVED) return entity;
+
+        auto global = p->Components().GetComponent<GlobalTransformComponent>().component;
+        if (global != nullptr) entity.transform = global->GetGlobalTransform();
+        if (change == CaptureChange::MOVED) return entity;
+
+        entity.staticEntity = IsStaticEntity(p);
+        if (!IsRenderable(p)) return entity;
+
+        entity.lightInteracting = IsLightInteracting(p);
+        auto rc = p->Components().GetComponent<RenderComponent>().component;
+        entity.model = rc->meshes->source.file;
+        entity.modelOptimizeGraph = rc->meshes->source.optimizeGraph;
+        entity.modelCullMode = u32(rc->meshes->source.defaultCullMode);
+        entity.modelNode = rc->meshes->source.node;
+        entity.meshes.resize(rc->GetMeshCount());
+        for (usize i = 0; i < rc->GetMeshCount(); ++i) {
+            CapturedMesh& captured = entity.meshes[i];
+            if (i < rc->GetMaterialCount() && rc->GetMaterialAt(i) != nullptr) {
+                captured.material = rc->GetMaterialAt(i)->GetName();
+            }
+
+            MeshPtr mesh = rc->GetMesh(i);
+            glm::vec3 vmin(std::numeric_limits<float>::max());
+            glm::vec3 vmax(std::numeric_limits<float>::lowest());
+            for (usize m = 0; m < mesh->NumMeshlets(); ++m) {
+                const MeshletPtr meshlet = mesh->GetMeshlet(m);
+                if (!meshlet->IsFinalized()) continue;
+                const GpuAABB aabb = PointShadowFaceCulling::TransformAabb(meshlet->GetAABB(), rc->GetMeshTransform(i));
+                vmin = glm::min(vmin, glm::vec3(aabb.vmin.ToVec4()));
+                vmax = glm::max(vmax, glm::vec3(aabb.vmax.ToVec4()));
+            }
+            // Left empty until the mesh is finalized
+            if (vmin.x <= vmax.x) {
+                captured.boundsMin = vmin;
+                captured.boundsMax = vmax;
+            }
+        }
+        return entity;
+    }
+
+    static CapturedLight CaptureLight(const LightPtr& light, const CaptureChange change) {
+        CapturedLight captured;
+        captured.id = FrameCapture::Instance().IdFor(light.get());
+        captured.change = change;
+        if (change == CaptureChange::REMOVED) return captured;
+
+        captured.position = light->GetPosition();
+        captured.color = light->GetBaseColor();
+        captured.intensity = light->GetIntensity();
+        captured.castsShadows = light->CastsShadows();
+        captured.virtualLight = light->IsVirtualLight();
+        captured.staticLight = light->IsStaticLight();
+        return captured;
+    }
+
+    CapturedSettings CaptureRendererSettings(const RendererSettings& settings) {
+        CapturedSettings captured;
+        captured.vsyncEnabled = settings.vsyncEnabled;
+        captured.globalIlluminationEnabled = settings.globalIlluminationEnabled;
+        captured.fxaaEnabled = settings.fxaaEnabled;
+        captured.taaEnabled = settings.taaEnabled;
+        captured.bloomEnabled = settings.bloomEnabled;
+        captured.usePerceptualRoughness = settings.usePerceptualRoughness;
+        captured.cpuVplCullingEnabled = settings.cpuVplCullingEnabled;
+        captured.cascadeCachingEnabled = settings.cascadeCachingEnabled;
+        captured.pointShadowFaceCullingEnabled = settings.pointShadowFaceCullingEnabled;
+        captured.shaderHotReloadEnabled = settings.shaderHotReloadEnabled;
+        captured.cascadeResolution = i32(settings.cascadeResolution);
+        captured.perFrameMaxScratchMemoryBytes = u64(settings.perFrameMaxScratchMemoryBytes);
+        captured.fogColor = settings.GetFogColor();
+        captured.fogDensity = settings.GetFogDensity();
+        captured.emissionStrength = settings.GetEmissionStrength();
+        captured.skyboxColorMask = settings.GetSkyboxColorMask();
+        captured.skyboxIntensity = settings.GetSkyboxIntensity();
+        captured.minRoughness = settings.GetMinRoughness();
+        captured.alphaDepthTestThreshold = settings.GetAlphaDepthTestThreshold();
+        captured.emissiveTextureMultiplier = settings.GetEmissiveTextureMultiplier();
+        captured.minGiOcclusionFactor = settings.GetMinGiOcclusionFactor();
+        return captured;
+    }
+
+    void ApplyCapturedSettings(const CapturedSettings& captured, RendererSettings& settings) {
+        settings.vsyncEnabled = captured.vsyncEnabled;
+        settings.globalIlluminationEnabled = captured.globalIlluminationEnabled;
+        settings.fxaaEnabled = captured.fxaaEnabled;
+        settings.taaEnabled = captured.taaEnabled;
+        settings.bloomEnabled = captured.bloomEnabled;
+        settings.usePerceptualRoughness = captured.usePerceptualRoughness;
+        settings.cpuVplCullingEnabled = captured.cpuVplCullingEnabled;
+        settings.cascadeCachingEnabled = captured.cascadeCachingEnabled;
+        settings.pointShadowFaceCullingEnabled = captured.pointShadowFaceCullingEnabled;
+        settings.shaderHotReloadEnabled = captured.shaderHotReloadEnabled;
+        settings.cascadeResolution = RendererCascadeResolution(captured.cascadeResolution);
+        settings.perFrameMaxScratchMemoryBytes = size_t(captured.perFrameMaxScratchMemoryBytes);
+        settings.SetFogColor(captured.fogColor);
+        settings.SetFogDensity(captured.fogDensity);
+        settings.SetEmissionStrength(captured.emissionStrength);
+        settings.SetSkyboxColorMask(captured.skyboxColorMask);
+        settings.SetSkyboxIntensity(captured.skyboxIntensity);
+        settings.SetMinRoughness(captured.minRoughness);
+        settings.SetAlphaDepthTestThreshold(captured.alphaDepthTestThreshold);
+        settings.SetEmissiveTextureMultiplier(captured.emissiveTextureMultiplier);
+        settings.SetMinGiOcclusionFactor(captured.minGiOcclusionFactor);
+    }
+
     static glm::vec3 GetWorldTransform(const EntityPtr& p, const size_t meshIndex) {
         return glm::vec3(GetTranslate(p->Components().GetComponent<MeshWorldTransforms>().component->transforms[meshIndex]));
     }
@@ -115,52 +226,63 @@ namespace stratus {
     }
 
     void RendererFrontend::AddAllMaterialsForEntity_(const EntityPtr& p) {
+        if (params_.headless) return;
         RenderComponent * c = p->Components().GetComponent<RenderComponent>().component;
         frame_->materialInfo->MarkMaterialsUsed(c);
     }
 
     void RendererFrontend::RemoveAllMaterialsForEntity_(const EntityPtr& p) {
+        if (params_.headless) return;
         RenderComponent* c = p->Components().GetComponent<RenderComponent>().component;
         frame_->materialInfo->MarkMaterialsUnused(c);
     }
 
+    // Entity changes are only recorded here since they can arrive while the previous frame is
+    // still rendering - they are applied to frame_ during Extract_
+
     void RendererFrontend::EntitiesAdded_(const std::unordered_set<stratus::EntityPtr>& e) {
         auto ul = LockWrite_();
-        bool added = false;
-        for (auto ptr : e) {
-            added |= AddEntity_(ptr);
+        for (auto& ptr : e) {
+            pendingEntityChanges_.push_back(std::make_pair(PendingChange_::ADDED, ptr));
         }
     }
 
     void RendererFrontend::EntitiesRemoved_(const std::unordered_set<stratus::EntityPtr>& e) {
         auto ul = LockWrite_();
-        bool removed = false;
         for (auto& ptr : e) {
-            removed = removed || RemoveEntity_(ptr);
+            pendingEntityChanges_.push_back(std::make_pair(PendingChange_::REMOVED, ptr));
         }
     }
 
     void RendererFrontend::EntityComponentsAdded_(const std::unordered_map<stratus::EntityPtr, std::vector<stratus::EntityComponent *>>& e) {
         auto ul = LockWrite_();
-        bool changed = false;
         for (auto& entry : e) {
-            auto ptr = entry.first;
-            if (RemoveEntity_(ptr)) {
-                changed = true;
-                AddEntity_(ptr);
-            }
+            pendingEntityChanges_.push_back(std::make_pair(PendingChange_::CHANGED, entry.first));
         }
     }
 
     void RendererFrontend::EntityComponentsEnabledDisabled_(const std::unordered_set<stratus::EntityPtr>& e) {
         auto ul = LockWrite_();
-        bool changed = false;
         for (auto& ptr : e) {
-            if (RemoveEntity_(ptr)) {
-                changed = true;
+            pendingEntityChanges_.push_back(std::make_pair(PendingChange_::CHANGED, ptr));
+        }
+    }
+
+    void RendererFrontend::ApplyPendingEntityChanges_() {
+        for (const auto& [change, ptr] : pendingEntityChanges_) {
+            switch (change) {
+            case PendingChange_::ADDED:
                 AddEntity_(ptr);
+                break;
+            case PendingChange_::REMOVED:
+                RemoveEntity_(ptr);
+                break;
+            default:
+                if (RemoveEntity_(ptr)) AddEntity_(ptr);
+                break;
             }
         }
+        pendingEntityChanges_.clear();
     }
 
     bool RendererFrontend::AddEntity_(const EntityPtr& p) {
@@ -179,22 +301,28 @@ namespace stratus {
 
             AddAllMaterialsForEntity_(p);
             
-            frame_->drawCommands->RecordCommands(p, frame_->materialInfo);
+            if (!params_.headless) frame_->drawCommands->RecordCommands(p, frame_->materialInfo);
             //_renderComponents.insert(p->Components().GetComponent<RenderComponent>().component);
             
             if (IsLightInteracting(p)) {
+                if (isStatic) cascadeCache_.MarkStaticDirty();
+
                 for (size_t i = 0; i < GetMeshCount(p); ++i) {
                     if (isStatic) InsertMesh(staticPbrEntities_, p, i);
                     else InsertMesh(dynamicPbrEntities_, p, i);
 
                     auto mesh = GetMesh(p, i);
-                    for (auto& entry : lights_) {
-                        if (!entry->CastsShadows()) continue;
-                        auto pos = entry->GetPosition();
-                        if ((isStatic && entry->IsStaticLight()) || !entry->IsStaticLight()) {
-                            if (glm::distance(GetWorldTransform(p, i), pos) < entry->GetRadius()) {
+                    const glm::vec3 meshPosition = GetWorldTransform(p, i);
+                    const auto& flags = frame_->lights.Flags();
+                    const auto& positions = frame_->lights.Positions();
+                    const auto& radii = frame_->lights.Radii();
+                    for (size_t light = 0; light < frame_->lights.Size(); ++light) {
+                        if (!(flags[light] & LIGHT_FLAG_CASTS_SHADOWS)) continue;
+                        const bool staticLight = flags[light] & LIGHT_FLAG_STATIC;
+                        if ((isStatic && staticLight) || !staticLight) {
+                            if (glm::distance(meshPosition, positions[light]) < radii[light]) {
                             //if (DistanceFromPointToAABB(pos, mesh->GetAABB()) < entry->GetRadius()) {
-                                frame_->lightsToUpdate.PushBack(entry);
+                                frame_->lightsToUpdate.PushBack(frame_->lights.HandleAt(light));
                             }
                         }
                     }
@@ -219,36 +347,39 @@ namespace stratus {
         entities_.erase(p);
         dynamicEntities_.erase(p);
         dynamicPbrEntities_.erase(p);
-        staticPbrEntities_.erase(p);
+        // Cached shadow cascades still contain this entity's depth
+        if (staticPbrEntities_.erase(p) > 0) cascadeCache_.MarkStaticDirty();
         flatEntities_.erase(p);
 
         RemoveAllMaterialsForEntity_(p);
 
-        frame_->drawCommands->RemoveAllCommands(p);
+        if (!params_.headless) frame_->drawCommands->RemoveAllCommands(p);
 
         const auto entityIsStatic = IsStaticEntity(p);
 
-        for (auto& entry : lights_) {
-            if (!entry->CastsShadows()) {
+        const auto& flags = frame_->lights.Flags();
+        const auto& positions = frame_->lights.Positions();
+        const auto& radii = frame_->lights.Radii();
+        for (size_t light = 0; light < frame_->lights.Size(); ++light) {
+            if (!(flags[light] & LIGHT_FLAG_CASTS_SHADOWS)) {
                 continue;
             }
 
             for (size_t i = 0; i < GetMeshCount(p); ++i) {
-                auto pos = entry->GetPosition();
-                if (glm::distance(GetWorldTransform(p, i), pos) > entry->GetRadius()) {
+                if (glm::distance(GetWorldTransform(p, i), positions[light]) > radii[light]) {
                 //if (DistanceFromPointToAABB(pos, mesh->GetAABB()) > entry->GetRadius()) {
                     continue;
                 }
 
                 //if (entry.second.visible.erase(p)) {
-                if (entry->IsStaticLight()) {
+                if (flags[light] & LIGHT_FLAG_STATIC) {
                     if (entityIsStatic) {
-                        frame_->lightsToUpdate.PushBack(entry);
+                        frame_->lightsToUpdate.PushBack(frame_->lights.HandleAt(light));
                         break;
                     }
                 }
                 else {
-                    frame_->lightsToUpdate.PushBack(entry);
+                    frame_->lightsToUpdate.PushBack(frame_->lights.HandleAt(light));
                     break;
                 }
             }
@@ -259,49 +390,51 @@ namespace stratus {
     }
 
     void RendererFrontend::AddLight(const LightPtr& light) {
+        if (light == nullptr) return;
         auto ul = LockWrite_();
-        if (lights_.find(light) != lights_.end()) return;
-
-        lights_.insert(light);
-        frame_->lights.insert(light);
-
-        if ( light->IsVirtualLight() ) virtualPointLights_.insert(light);
-
-        if ( light->IsVirtualLight() || light->IsStaticLight() ) {
-            staticLights_.insert(light);
-        }
-        else {
-            dynamicLights_.insert(light);
-        }
-
-        if ( !light->CastsShadows() ) return;
-
-        frame_->lightsToUpdate.PushBack(light);
-
-        //_AttemptAddEntitiesForLight(light, data, _frame->instancedPbrMeshes);
+        pendingLightChanges_.push_back(std::make_pair(PendingChange_::ADDED, light));
     }
 
     void RendererFrontend::RemoveLight(const LightPtr& light) {
+        if (light == nullptr) return;
         auto ul = LockWrite_();
-        if (lights_.find(light) == lights_.end()) return;
-        lights_.erase(light);
-        dynamicLights_.erase(light);
-        staticLights_.erase(light);
-        virtualPointLights_.erase(light);
-        lightsToRemove_.insert(light);
-        frame_->lightsToUpdate.Erase(light);
+        pendingLightChanges_.push_back(std::make_pair(PendingChange_::REMOVED, light));
     }
 
     void RendererFrontend::ClearLights() {
         auto ul = LockWrite_();
-        for (auto& light : lights_) {
-            lightsToRemove_.insert(light);
+        pendingLightChanges_.push_back(std::make_pair(PendingChange_::CLEARED, LightPtr()));
+    }
+
+    void RendererFrontend::ApplyPendingLightChanges_() {
+        for (const auto& [change, light] : pendingLightChanges_) {
+            if (change == PendingChange_::ADDED) {
+                if (frame_->lights.Contains(light)) continue;
+
+                const LightHandle handle = frame_->lights.Add(light);
+
+                if ( !light->CastsShadows() ) continue;
+
+                frame_->lightsToUpdate.PushBack(handle);
+
+                //_AttemptAddEntitiesForLight(light, data, _frame->instancedPbrMeshes);
+            }
+            else if (change == PendingChange_::REMOVED) {
+                const LightHandle handle = frame_->lights.Find(light);
+                if (!frame_->lights.IsValid(handle)) continue;
+                frame_->lightsToUpdate.Erase(handle);
+                frame_->lights.Remove(handle);
+                lightsToRemove_.push_back(light);
+            }
+            else {
+                for (const auto& light : frame_->lights.Lights()) {
+                    lightsToRemove_.push_back(light);
+                }
+                frame_->lights.Clear();
+                frame_->lightsToUpdate.Clear();
+            }
         }
-        lights_.clear();
-        dynamicLights_.clear();
-        staticLights_.clear();
-        virtualPointLights_.clear();
-        frame_->lightsToUpdate.Clear();
+        pendingLightChanges_.clear();
     }
 
     void RendererFrontend::SetWorldLight(const InfiniteLightPtr& light) {
@@ -346,17 +479,111 @@ namespace stratus {
 
     void RendererFrontend::SetClearColor(const glm::vec4& color) {
         auto ul = LockWrite_();
-        frame_->clearColor = color;
+        clearColor_ = color;
     }
 
     RendererSettings RendererFrontend::GetSettings() const {
         auto sl = LockRead_();
-        return frame_->settings;
+        return settings_;
     }
 
     void RendererFrontend::SetSettings(const RendererSettings& settings) {
         auto ul = LockWrite_();
-        frame_->settings = settings;
+        settings_ = settings;
+    }
+
+    void RendererFrontend::SetStaticIrradianceProbes(const IrradianceProbeGridPtr& probes) {
+        auto ul = LockWrite_();
+        staticIrradianceProbes_ = probes;
+    }
+
+    IrradianceProbeGridPtr RendererFrontend::GetStaticIrradianceProbes() const {
+        auto sl = LockRead_();
+        return staticIrradianceProbes_;
+    }
+
+    std::vector<CascadeUpdateStats> RendererFrontend::GetCascadeUpdateStats() const {
+        auto sl = LockRead_();
+        return cascadeCache_.GetStats();
+    }
+
+    PointShadowCullingStats RendererFrontend::GetPointShadowCullingStats() const {
+        auto sl = LockRead_();
+        return pointShadowCullingStats_;
+    }
+
+    FrameArenaStats RendererFrontend::GetScratchMemoryStats() const {
+        auto sl = LockRead_();
+        return scratchStats_;
+    }
+
+    std::vector<GpuAABB> RendererFrontend::CollectStaticOccluders_() const {
+        std::vector<GpuAABB> occluders;
+        for (const EntityPtr& entity : entities_) {
+            if (!IsLightInteracting(entity) || dynamicEntities_.find(entity) != dynamicEntities_.end()) continue;
+
+            auto rc = entity->Components().GetComponent<RenderComponent>().component;
+            auto mt = entity->Components().GetComponent<MeshWorldTransforms>().component;
+            for (usize i = 0; i < rc->GetMeshCount() && i < mt->transforms.size(); ++i) {
+                MeshPtr mesh = rc->GetMesh(i);
+                for (usize m = 0; m < mesh->NumMeshlets(); ++m) {
+                    const MeshletPtr meshlet = mesh->GetMeshlet(m);
+                    if (!meshlet->IsFinalized()) continue;
+                    occluders.push_back(PointShadowFaceCulling::TransformAabb(meshlet->GetAABB(), mt->transforms[i]));
+                }
+            }
+        }
+        return occluders;
+    }
+
+    IrradianceProbeBakeJob RendererFrontend::BakeStaticIrradianceProbes(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const float spacing) {
+        std::vector<IrradianceProbeLight> lights;
+        std::vector<GpuAABB> occluders;
+        {
+            // Include light changes which have not been extracted yet
+            auto sl = LockRead_();
+            LightRegistry registry = frame_->lights;
+            for (const auto& [change, light] : pendingLightChanges_) {
+                if (change == PendingChange_::ADDED) registry.Add(light);
+                else if (change == PendingChange_::REMOVED) registry.Remove(registry.Find(light));
+                else registry.Clear();
+            }
+            registry.SyncFromLights();
+            lights = IrradianceProbeBaker::CollectBakedLights(registry);
+            occluders = CollectStaticOccluders_();
+        }
+
+        auto grid = IrradianceProbeBaker::CreateGrid(boundsMin, boundsMax, spacing);
+        return IrradianceProbeBaker::ScheduleBake(lights, IrradianceProbeBaker::CreateOccluderVisibility(occluders), grid);
+    }
+
+    IrradianceProbeBakeJob RendererFrontend::BakeStaticIrradianceProbes(const float spacing) {
+        glm::vec3 boundsMin(0.0f);
+        glm::vec3 boundsMax(0.0f);
+        {
+            auto sl = LockRead_();
+            const std::vector<GpuAABB> occluders = CollectStaticOccluders_();
+            if (occluders.size() > 0) {
+                boundsMin = glm::vec3(std::numeric_limits<float>::max());
+                boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+            }
+            for (const GpuAABB& aabb : occluders) {
+                boundsMin = glm::min(boundsMin, glm::vec3(aabb.vmin.ToVec4()));
+                boundsMax = glm::max(boundsMax, glm::vec3(aabb.vmax.ToVec4()));
+            }
+        }
+
+        return BakeStaticIrradianceProbes(boundsMin, boundsMax, spacing);
+    }
+
+    bool RendererFrontend::LoadStaticIrradianceProbes(const std::string& scenePath) {
+        const std::string file = IrradianceProbeGrid::ProbeFileForScene(scenePath);
+        auto grid = IrradianceProbeGridPtr(new IrradianceProbeGrid());
+        if (!grid->LoadFromFile(file)) return false;
+
+        STRATUS_LOG << "Loaded " << grid->NumProbes() << " irradiance probes from " << file << std::endl;
+        SetStaticIrradianceProbes(grid);
+        return true;
     }
 
     static glm::vec2 GetJitterForIndex(const size_t index, const float width, const float height) {
@@ -372,16 +599,39 @@ namespace stratus {
     }
 
     SystemStatus RendererFrontend::Update(const double deltaSeconds) {
+        if (Extract_(deltaSeconds)) {
+            Render_(deltaSeconds);
+        }
+
+        return SystemStatus::SYSTEM_CONTINUE;
+    }
+
+    bool RendererFrontend::Extract_(const double deltaSeconds) {
         CHECK_IS_APPLICATION_THREAD();
+        STRATUS_PROFILE_SCOPE("RendererFrontend::Extract");
 
         auto ul = LockWrite_();
-        if (camera_ == nullptr) return SystemStatus::SYSTEM_CONTINUE;
 
-        // Update per frame scratch memory if application requested a different size
+        // Bring frame_ up to date with everything the application changed since the last extract
+        frame_->settings = settings_;
+        frame_->clearColor = clearColor_;
+        frame_->staticIrradianceProbes = staticIrradianceProbes_;
+        capturingFrame_ = FrameCapture::Instance().IsCapturing();
+        if (capturingFrame_) BeginCapture_(deltaSeconds);
+        ApplyPendingLightChanges_();
+        ApplyPendingEntityChanges_();
+
+        if (camera_ == nullptr) {
+            if (capturingFrame_) EndCapture_();
+            return false;
+        }
+
+        // Update per frame scratch memory if application requested a different size. The arena
+        // grows past this on its own so it only sets the floor.
         if (frame_->settings.perFrameMaxScratchMemoryBytes > 0 &&
-            frame_->perFrameScratchMemory->Capacity() < frame_->settings.perFrameMaxScratchMemoryBytes) {
+            frame_->scratchArena->MinCapacity() != frame_->settings.perFrameMaxScratchMemoryBytes) {
             STRATUS_LOG << "Resizing per frame scratch memory for renderer to " << frame_->settings.perFrameMaxScratchMemoryBytes;
-            frame_->perFrameScratchMemory = MakeUnsafe<StackAllocator>(frame_->settings.perFrameMaxScratchMemoryBytes);
+            frame_->scratchArena->SetMinCapacity(frame_->settings.perFrameMaxScratchMemoryBytes);
         }
 
         camera_->Update(deltaSeconds);
@@ -392,9 +642,18 @@ namespace stratus {
         UpdateCascadeData_();
         CheckForEntityChanges_();
         UpdateLights_();
-        UpdateMaterialSet_();
-        UpdateDrawCommands_();
-        UpdateVisibility_();
+        if (params_.headless) {
+            // Nothing to stream textures or upload draw commands to
+            UpdateVisibilityHeadless_();
+        }
+        else {
+            UpdateTextureRequests_();
+            UpdateMaterialSet_();
+            UpdateDrawCommands_();
+            UpdateVisibility_();
+        }
+
+        if (capturingFrame_) EndCapture_();
 
         // Update view projection and its inverse
         frame_->projectionView = frame_->projection * frame_->view;
@@ -416,73 +675,247 @@ namespace stratus {
 
         //_SwapFrames();
 
+        // Hot reload just polls file timestamps so it does not need to run every frame
+        if (frame_->settings.shaderHotReloadEnabled) {
+            shaderReloadSeconds_ += deltaSeconds;
+            if (shaderReloadSeconds_ >= 1.0) {
+                shaderReloadSeconds_ = 0.0;
+                recompileShaders_ = true;
+            }
+        }
+
         // Check for shader recompile request
-        if (recompileShaders_) {
+        if (recompileShaders_ && !params_.headless) {
             renderer_->RecompileShaders();
-            viscullLodSelect_->Recompile();
-            viscull_->Recompile();
-            viscullCsms_->Recompile();
-            updateTransforms_->Recompile();
+            Pipeline::ReloadChanged({ viscullLodSelect_.get(), viscull_.get(), viscullCsms_.get(), updateTransforms_.get() });
             recompileShaders_ = false;
         }
 
-        // Begin the new frame
-        renderer_->Begin(frame_, true);
+        return true;
+    }
 
-        // Complete the frame
-        renderer_->RenderScene(deltaSeconds);
-        renderer_->End();
+    // Does not hold the lock since frame_ is only written by Extract_, which never overlaps this
+    void RendererFrontend::Render_(const double deltaSeconds) {
+        CHECK_IS_APPLICATION_THREAD();
+        STRATUS_PROFILE_SCOPE("RendererFrontend::Render");
+
+        PointShadowCullingStats pointShadowStats;
+        if (params_.headless) {
+            pointShadowStats = RenderHeadless_();
+        }
+        else {
+            // Begin the new frame
+            renderer_->Begin(frame_, true);
+
+            // Complete the frame
+            renderer_->RenderScene(deltaSeconds);
+            renderer_->End();
+
+            // Move current transforms -> previous transforms
+            UpdatePrevFrameModelTransforms_();
+            pointShadowStats = renderer_->GetPointShadowCullingStats();
+        }
 
         // This needs to be unset
         frame_->csc.regenerateFbo = false;
 
-        // Move current transforms -> previous transforms
-        UpdatePrevFrameModelTransforms_();
-
         // Set previous projection view
         frame_->prevProjectionView = frame_->projectionView;
         frame_->prevInvProjectionView = frame_->invProjectionView;
 
         // Reset the per frame scratch memory
-        frame_->perFrameScratchMemory->Deallocate();
+        const FrameArenaStats scratchStats = frame_->scratchArena->EndFrame();
 
-        return SystemStatus::SYSTEM_CONTINUE;
+        auto ul = LockWrite_();
+        pointShadowCullingStats_ = pointShadowStats;
+        scratchStats_ = scratchStats;
+        UpdateMetrics_();
+    }
+
+    void RendererFrontend::RegisterMetrics_() {
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        entitiesMetric_ = metrics.RegisterGauge("RendererFrontend.entities", "Entities with render components");
+        lightsMetric_ = metrics.RegisterGauge("RendererFrontend.lights");
+        drawCommandsMetric_ = metrics.RegisterGauge("RendererFrontend.drawCommands", "Draw commands across all mesh types and cull modes");
+        freeMeshVerticesMetric_ = metrics.RegisterGauge("RendererFrontend.freeMeshVertices", "GpuMeshAllocator::FreeVertices");
+        freeMeshIndicesMetric_ = metrics.RegisterGauge("RendererFrontend.freeMeshIndices", "GpuMeshAllocator::FreeIndices");
+        shadowCacheHitsMetric_ = metrics.RegisterCounter("RendererFrontend.shadowCacheHits", "Cascade updates which reused last frame's depth");
+        shadowCacheMissesMetric_ = metrics.RegisterCounter("RendererFrontend.shadowCacheMisses", "Cascade updates which rendered casters");
+        pointShadowFacesSkippedMetric_ = metrics.RegisterCounter("RendererFrontend.pointShadowFacesSkipped");
+        pointShadowFacesRenderedMetric_ = metrics.RegisterCounter("RendererFrontend.pointShadowFacesRendered");
+        scratchBytesUsedMetric_ = metrics.RegisterGauge("RendererFrontend.scratchBytesUsed", "Per frame scratch memory used last frame");
+        scratchCapacityMetric_ = metrics.RegisterGauge("RendererFrontend.scratchCapacity", "Per frame scratch memory reserved for the next frame");
+        scratchOverflowBytesMetric_ = metrics.RegisterGauge("RendererFrontend.scratchOverflowBytes", "Scratch memory which had to be chained on last frame");
+        visibleMeshesMetric_ = metrics.RegisterGauge("RendererFrontend.visibleMeshes", "Meshes inside the camera frustum (headless only)");
+    }
+
+    void RendererFrontend::UpdateMetrics_() {
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        metrics.SetGauge(entitiesMetric_, f64(entities_.size()));
+        metrics.SetGauge(lightsMetric_, f64(frame_->lights.Size()));
+
+        if (!params_.headless) {
+            usize drawCommands = 0;
+            for (const auto * commands : { &frame_->drawCommands->flatMeshes, &frame_->drawCommands->dynamicPbrMeshes, &frame_->drawCommands->staticPbrMeshes }) {
+                for (const auto& entry : *commands) {
+                    drawCommands += entry.second->NumDrawCommands();
+                }
+            }
+            metrics.SetGauge(drawCommandsMetric_, f64(drawCommands));
+            metrics.SetGauge(freeMeshVerticesMetric_, f64(GpuMeshAllocator::FreeVertices()));
+            metrics.SetGauge(freeMeshIndicesMetric_, f64(GpuMeshAllocator::FreeIndices()));
+        }
+        else {
+            metrics.SetGauge(visibleMeshesMetric_, f64(visibleMeshes_));
+        }
+
+        CascadeUpdateStats totals;
+        for (const CascadeUpdateStats& cascade : cascadeCache_.GetStats()) {
+            totals.staticUpdates += cascade.staticUpdates;
+            totals.dynamicUpdates += cascade.dynamicUpdates;
+            totals.skippedUpdates += cascade.skippedUpdates;
+        }
+        // The totals start over when the cascades are resized
+        if (totals.skippedUpdates >= lastCascadeTotals_.skippedUpdates) {
+            metrics.Increment(shadowCacheHitsMetric_, i64(totals.skippedUpdates - lastCascadeTotals_.skippedUpdates));
+        }
+        const u64 misses = totals.staticUpdates + totals.dynamicUpdates;
+        const u64 lastMisses = lastCascadeTotals_.staticUpdates + lastCascadeTotals_.dynamicUpdates;
+        if (misses >= lastMisses) {
+            metrics.Increment(shadowCacheMissesMetric_, i64(misses - lastMisses));
+        }
+        lastCascadeTotals_ = totals;
+
+        metrics.Increment(pointShadowFacesSkippedMetric_, i64(pointShadowCullingStats_.facesSkipped));
+        metrics.Increment(pointShadowFacesRenderedMetric_, i64(pointShadowCullingStats_.facesRendered));
+
+        metrics.SetGauge(scratchBytesUsedMetric_, f64(scratchStats_.bytesUsed));
+        metrics.SetGauge(scratchCapacityMetric_, f64(scratchStats_.nextCapacity));
+        metrics.SetGauge(scratchOverflowBytesMetric_, f64(scratchStats_.overflowBytes));
+    }
+
+    void RendererFrontend::BeginCapture_(const double deltaSeconds) {
+        FrameCapture& recorder = FrameCapture::Instance();
+        capture_.frame = INSTANCE(Engine)->FrameCount();
+        capture_.deltaSeconds = deltaSeconds;
+        capture_.lights.clear();
+        capture_.entities.clear();
+
+        // The capture just started so it has no idea what was added before
+        if (recorder.Session() != captureSession_) {
+            captureSession_ = recorder.Session();
+            for (const LightPtr& light : frame_->lights.Lights()) {
+                capture_.lights.push_back(CaptureLight(light, CaptureChange::ADDED));
+                recorder.LightChanged(capture_.lights.back());
+            }
+            for (const EntityPtr& entity : entities_) {
+                capture_.entities.push_back(CaptureEntity(entity, CaptureChange::ADDED));
+            }
+        }
+
+        for (const auto& [change, light] : pendingLightChanges_) {
+            if (change == PendingChange_::ADDED) {
+                capture_.lights.push_back(CaptureLight(light, CaptureChange::ADDED));
+                recorder.LightChanged(capture_.lights.back());
+            }
+            else if (change == PendingChange_::REMOVED) {
+                capture_.lights.push_back(CaptureLight(light, CaptureChange::REMOVED));
+                recorder.Forget(light.get());
+            }
+            else {
+                CapturedLight cleared;
+                cleared.change = CaptureChange::CLEARED;
+                capture_.lights.push_back(cleared);
+                for (const LightPtr& existing : frame_->lights.Lights()) recorder.Forget(existing.get());
+            }
+        }
+
+        for (const auto& [change, entity] : pendingEntityChanges_) {
+            if (change == PendingChange_::ADDED) {
+                capture_.entities.push_back(CaptureEntity(entity, CaptureChange::ADDED));
+            }
+            else if (change == PendingChange_::REMOVED) {
+                capture_.entities.push_back(CaptureEntity(entity, CaptureChange::REMOVED));
+                recorder.Forget(entity.get());
+            }
+            else {
+                capture_.entities.push_back(CaptureEntity(entity, CaptureChange::CHANGED));
+            }
+        }
+    }
+
+    void RendererFrontend::EndCapture_() {
+        FrameCapture& recorder = FrameCapture::Instance();
+        capture_.viewportWidth = frame_->viewportWidth;
+        capture_.viewportHeight = frame_->viewportHeight;
+        capture_.hasCamera = camera_ != nullptr;
+        if (capture_.hasCamera) {
+            capture_.cameraPosition = camera_->GetPosition();
+            capture_.cameraPitch = camera_->GetPitch();
+            capture_.cameraYaw = camera_->GetYaw();
+        }
+        capture_.fovy = params_.fovy.value();
+        capture_.znear = params_.znear;
+        capture_.zfar = params_.zfar;
+        capture_.clearColor = clearColor_;
+        capture_.settings = CaptureRendererSettings(settings_);
+
+        // Lights are changed through their pointers so compare against what was last written
+        for (const LightPtr& light : frame_->lights.Lights()) {
+            const CapturedLight captured = CaptureLight(light, CaptureChange::CHANGED);
+            if (recorder.LightChanged(captured)) capture_.lights.push_back(captured);
+        }
+
+        recorder.Write(capture_);
+        capturingFrame_ = false;
     }
 
     bool RendererFrontend::Initialize() {
         CHECK_IS_APPLICATION_THREAD();
+        RegisterMetrics_();
+
         // Create the renderer on the renderer thread only
-        renderer_ = std::make_unique<RendererBackend>(Window::Instance()->GetWindowDims().first, Window::Instance()->GetWindowDims().second, params_.appName);
+        if (!params_.headless) {
+            renderer_ = std::make_unique<RendererBackend>(Window::Instance()->GetWindowDims().first, Window::Instance()->GetWindowDims().second, params_.appName);
+        }
 
         frame_ = std::make_shared<RendererFrame>();
+        settings_ = frame_->settings;
+        clearColor_ = frame_->clearColor;
 
         // 4 cascades total
         frame_->csc.cascades.resize(4);
         frame_->csc.cascadeResolutionXY = 1024;
         frame_->csc.regenerateFbo = true;
 
-        for (size_t i = 0; i < frame_->csc.cascades.size(); ++i) {
-            frame_->csc.cascades[i].drawCommands = GpuCommandReceiveManager::Create();
-        }
-
-        // Set materials per frame and initialize material buffer
-        frame_->materialInfo = GpuMaterialBuffer::Create(8192);
+        cascadeCache_.Resize(frame_->csc.cascades.size());
 
         // Initialize per frame scratch memory
-        frame_->perFrameScratchMemory = MakeUnsafe<StackAllocator>(frame_->settings.perFrameMaxScratchMemoryBytes);
+        frame_->scratchArena = std::make_shared<FrameArena>(frame_->settings.perFrameMaxScratchMemoryBytes);
+        frame_->perFrameScratchMemory = frame_->scratchArena->ThreadAllocator();
 
         //_frame->instancedFlatMeshes.resize(1);
         //_frame->instancedDynamicPbrMeshes.resize(1);
         //_frame->instancedStaticPbrMeshes.resize(1);
 
-        // Set up draw command buffers
-        frame_->drawCommands = GpuCommandManager::Create(8);
-
         // Initialize entity processing
         entityHandler_ = INSTANCE(EntityManager)->RegisterEntityProcess<RenderEntityProcess>();
 
         ClearWorldLight();
 
+        // Everything past here is GPU state
+        if (params_.headless) return true;
+
+        for (size_t i = 0; i < frame_->csc.cascades.size(); ++i) {
+            frame_->csc.cascades[i].drawCommands = GpuCommandReceiveManager::Create();
+        }
+
+        // Set materials per frame and initialize material buffer
+        frame_->materialInfo = GpuMaterialBuffer::Create(8192);
+
+        // Set up draw command buffers
+        frame_->drawCommands = GpuCommandManager::Create(8);
+
         // Initialize visibility culling compute pipeline
         const std::filesystem::path shaderRoot("../Source/Shaders");
         const ShaderApiVersion version{GraphicsDriver::GetConfig().majorVersion, GraphicsDriver::GetConfig().minorVersion};
@@ -505,6 +938,8 @@ namespace stratus {
             Shader{"update_model_transforms.cs", ShaderType::COMPUTE} }
         ));
 
+        Pipeline::CompileAll({ viscullLodSelect_.get(), viscull_.get(), viscullCsms_.get(), updateTransforms_.get() });
+
         // Copy
         //_prevFrame = std::make_shared<RendererFrame>(*_frame);
 
@@ -521,8 +956,9 @@ namespace stratus {
 
         entities_.clear();
         dynamicEntities_.clear();
-        lights_.clear();
         lightsToRemove_.clear();
+        pendingLightChanges_.clear();
+        pendingEntityChanges_.clear();
 
         INSTANCE(EntityManager)->UnregisterEntityProcess(entityHandler_);
     }
@@ -532,14 +968,20 @@ namespace stratus {
         recompileShaders_ = true;
     }
 
+    std::pair<u32, u32> RendererFrontend::GetViewportDims_() const {
+        if (params_.headless) return std::make_pair(params_.viewportWidth, params_.viewportHeight);
+        return Window::Instance()->GetWindowDims();
+    }
+
     void RendererFrontend::UpdateViewport_() {
-        viewportDirty_ = viewportDirty_ || Window::Instance()->WindowResizedWithinLastFrame();
+        viewportDirty_ = viewportDirty_ || (!params_.headless && Window::Instance()->WindowResizedWithinLastFrame());
         frame_->viewportDirty = viewportDirty_;
 
         if (!viewportDirty_) return;
         viewportDirty_ = false;
 
-        const float aspect = float(Window::Instance()->GetWindowDims().first) / float(Window::Instance()->GetWindowDims().second);
+        const auto dims = GetViewportDims_();
+        const float aspect = float(dims.first) / float(dims.second);
         projection_        = glm::perspective(
             Radians(params_.fovy).value(),
             aspect,
@@ -550,8 +992,8 @@ namespace stratus {
         frame_->znear          = params_.znear;
         frame_->zfar           = params_.zfar;
         frame_->projection     = projection_;
-        frame_->viewportWidth  = Window::Instance()->GetWindowDims().first;
-        frame_->viewportHeight = Window::Instance()->GetWindowDims().second;
+        frame_->viewportWidth  = dims.first;
+        frame_->viewportHeight = dims.second;
         frame_->fovy           = Radians(params_.fovy);
     }
 
@@ -599,11 +1041,20 @@ namespace stratus {
         const glm::vec3 worldLightDirCamSpace = glm::normalize(glm::mat3(cameraViewTransform) * worldLightDirWorldSpace);
         frame_->csc.worldLightDirectionCameraSpace = worldLightDirCamSpace;
 
+        // Switching between alpha tested and regular depth shaders changes the static casters' depth
+        if (worldLight_->GetAlphaTest() != cascadeAlphaTest_) {
+            cascadeAlphaTest_ = worldLight_->GetAlphaTest();
+            cascadeCache_.MarkStaticDirty();
+        }
+        // Nothing is rendered while the world light is disabled so the cache can't be trusted after
+        const bool cascadeCachingEnabled = frame_->settings.cascadeCachingEnabled && worldLight_->GetEnabled();
+        cascadeCache_.BeginFrame(worldLightDirWorldSpace, frame_->csc.cascadeResolutionXY, cascadeCachingEnabled);
+
         const glm::mat4 L = lightViewTransform * cameraWorldTransform;
 
         // @see https://gamedev.stackexchange.com/questions/183499/how-do-i-calculate-the-bounding-box-for-an-ortho-matrix-for-cascaded-shadow-mapp
         // @see https://ogldev.org/www/tutorial49/tutorial49.html
-        const float ar = float(Window::Instance()->GetWindowDims().first) / float(Window::Instance()->GetWindowDims().second);
+        const float ar = float(frame_->viewportWidth) / float(frame_->viewportHeight);
         //const float tanHalfHFov = glm::tan(Radians(_params.fovy).value() / 2.0f) * ar;
         //const float tanHalfVFov = glm::tan(Radians(_params.fovy).value() / 2.0f);
         const float projPlaneDist = glm::tan(Radians(params_.fovy).value() / 2.0f);
@@ -705,9 +1156,6 @@ namespace stratus {
             //                                            glm::length(frustumCorners[4] - frustumCorners[6])));
             const float dk = ceilf(maxLength);
             dks.push_back(dk);
-            // T is essentially the physical width/height of area corresponding to each texel in the shadow map
-            const float T = dk / frame_->csc.cascadeResolutionXY;
-            frame_->csc.cascades[i].cascadeRadius = dk / 2.0f;
 
             // Compute min/max of each so that we can combine it with dk to create a perfectly rectangular bounding box
             glm::vec3 minVec;
@@ -726,22 +1174,21 @@ namespace stratus {
                 }
             }
 
-            const float minX = minVec.x;
-            const float maxX = maxVec.x;
-
-            const float minY = minVec.y;
-            const float maxY = maxVec.y;
-
             const float minZ = minVec.z;
             const float maxZ = maxVec.z;
 
             zmins.push_back(minZ);
             zmaxs.push_back(maxZ);
 
-            // Now we calculate cascade camera position sk using the min, max, dk and T for a stable location
-            glm::vec3 sk(floorf((maxX + minX) / (2.0f * T)) * T, 
-                         floorf((maxY + minY) / (2.0f * T)) * T, 
-                         minZ);
+            // Now we calculate cascade camera position sk using the min, max, dk and T (physical width/height of each texel)
+            // for a stable location. With caching enabled the bounds are padded and only move once the frustum slice leaves them.
+            const CascadeUpdate update = cascadeCache_.UpdateCascade(i, minVec, maxVec, dk);
+            frame_->csc.cascades[i].renderStatic = update.renderStatic;
+            frame_->csc.cascades[i].renderDynamic = update.renderDynamic;
+            const glm::vec3 sk = update.bounds.position;
+            const float cascadeDimension = update.bounds.dimension;
+            const float cascadeDepth = update.bounds.depth;
+            frame_->csc.cascades[i].cascadeRadius = cascadeDimension / 2.0f;
             //sk = glm::vec3(L * glm::vec4(sk, 1.0f));
             // STRATUS_LOG << "sk " << sk << std::endl;
             sks.push_back(sk);
@@ -761,9 +1208,9 @@ namespace stratus {
             // so it enables us to use the simplified Orthographic Projection matrix below
             //
             // This results in values between [-1, 1]
-            const glm::mat4 cascadeOrthoProjection(glm::vec4(2.0f / dk, 0.0f, 0.0f, 0.0f), 
-                                                   glm::vec4(0.0f, 2.0f / dk, 0.0f, 0.0f),
-                                                   glm::vec4(0.0f, 0.0f, 1.0f / (maxZ - minZ), shadowDepthOffset),
+            const glm::mat4 cascadeOrthoProjection(glm::vec4(2.0f / cascadeDimension, 0.0f, 0.0f, 0.0f), 
+                                                   glm::vec4(0.0f, 2.0f / cascadeDimension, 0.0f, 0.0f),
+                                                   glm::vec4(0.0f, 0.0f, 1.0f / cascadeDepth, shadowDepthOffset),
                                                    glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
             //const glm::mat4 cascadeOrthoProjection(glm::vec4(2.0f / (maxX - minX), 0.0f, 0.0f, 0.0f), 
             //                                       glm::vec4(0.0f, 2.0f / (maxY - minY), 0.0f, 0.0f),
@@ -816,26 +1263,31 @@ namespace stratus {
         for (auto& entity : set) {
             // If this is a light-interacting node, run through all the lights to see if they need to be updated
             if (EntityChanged_(entity)) {               
+                if (capturingFrame_) capture_.entities.push_back(CaptureEntity(entity, CaptureChange::MOVED));
 
                 InitializeMeshTransformComponent(entity);
 
-                frame_->drawCommands->UpdateTransforms(entity);
+                if (!params_.headless) frame_->drawCommands->UpdateTransforms(entity);
 
                 if (IsLightInteracting(entity)) {
-                    for (const auto& light : lights_) {
+                    const auto& flags = frame_->lights.Flags();
+                    const auto& positions = frame_->lights.Positions();
+                    const auto& radii = frame_->lights.Radii();
+                    for (size_t light = 0; light < frame_->lights.Size(); ++light) {
                         // Static lights don't care about entity movement changes
-                        if (light->IsStaticLight()) continue;
+                        if (flags[light] & LIGHT_FLAG_STATIC) continue;
+                        if (!(flags[light] & LIGHT_FLAG_CASTS_SHADOWS)) continue;
 
-                        auto lightPos = light->GetPosition();
-                        auto lightRadius = light->GetRadius();
+                        const glm::vec3& lightPos = positions[light];
+                        const float lightRadius = radii[light];
                         //If the EntityView is in the light's visible set, its shadows are now out of date
                         for (size_t i = 0; i < GetMeshCount(entity); ++i) {
                             if (glm::distance(GetWorldTransform(entity, i), lightPos) > lightRadius) {
-                                frame_->lightsToUpdate.PushBack(light);
+                                frame_->lightsToUpdate.PushBack(frame_->lights.HandleAt(light));
                             }
                             // If the EntityView has moved inside the light's radius, add it
                             else if (glm::distance(GetWorldTransform(entity, i), lightPos) < lightRadius) {
-                                frame_->lightsToUpdate.PushBack(light);
+                                frame_->lightsToUpdate.PushBack(frame_->lights.HandleAt(light));
                             }
                         }
                     }
@@ -845,58 +1297,70 @@ namespace stratus {
     }
 
     void RendererFrontend::CheckForEntityChanges_() {
+        STRATUS_PROFILE_SCOPE("CheckForEntityChanges");
         // We only care about dynamic light-interacting entities
         CheckEntitySetForChanges_(dynamicEntities_);
     }
 
-    void RendererFrontend::MarkDynamicLightsDirty_() {
-        for (auto& light : dynamicLights_) {
-            frame_->lightsToUpdate.PushBack(light);
+    // Queues every shadow casting light whose flags pass the predicate
+    template<typename Predicate>
+    static void MarkLightsDirty(const LightRegistry& lights, LightUpdateQueue& queue, Predicate&& include) {
+        const auto& flags = lights.Flags();
+        for (size_t i = 0; i < lights.Size(); ++i) {
+            if (!(flags[i] & LIGHT_FLAG_CASTS_SHADOWS) || !include(flags[i])) continue;
+            queue.PushBack(lights.HandleAt(i));
         }
     }
 
+    void RendererFrontend::MarkDynamicLightsDirty_() {
+        MarkLightsDirty(frame_->lights, frame_->lightsToUpdate, [](const uint32_t flags) {
+            return !(flags & (LIGHT_FLAG_VIRTUAL | LIGHT_FLAG_STATIC));
+        });
+    }
+
     void RendererFrontend::MarkStaticLightsDirty_() {
-        for (auto& light : staticLights_) {
-            frame_->lightsToUpdate.PushBack(light);
-        }
+        MarkLightsDirty(frame_->lights, frame_->lightsToUpdate, [](const uint32_t flags) {
+            return (flags & (LIGHT_FLAG_VIRTUAL | LIGHT_FLAG_STATIC)) != 0;
+        });
     }
 
     void RendererFrontend::MarkAllLightsDirty_() {
-        for (auto& light : lights_) {
-            frame_->lightsToUpdate.PushBack(light);
-        }
+        MarkLightsDirty(frame_->lights, frame_->lightsToUpdate, [](const uint32_t) {
+            return true;
+        });
     }
 
     void RendererFrontend::UpdateLights_() {
-        frame_->lightsToRemove.clear();
-        // First get rid of all lights that are pending deletion
-        for (auto& light : lightsToRemove_) {
-            frame_->lights.erase(light);
-            frame_->virtualPointLights.erase(light);
-            frame_->lightsToRemove.insert(light);
-        }
+        STRATUS_PROFILE_SCOPE("UpdateLights");
+        // Lights pending deletion were already removed from frame_->lights - the backend
+        // only needs them to free their shadow maps
+        frame_->lightsToRemove.swap(lightsToRemove_);
         lightsToRemove_.clear();
 
         // Update the world light
-        frame_->csc.worldLight = worldLight_;//->Copy();
+        // Copied since the application can keep changing it while this frame renders
+        frame_->csc.worldLight = worldLight_->Copy();
 
-        // Now go through and update all lights that have changed in some way
-        for (auto& light : lights_) {
-            if ( !light->CastsShadows() ) continue;
+        // Pull in any light changes and rebuild the change bitsets
+        frame_->lights.SyncFromLights();
 
-            // See if the light moved or its radius changed
-            if (light->PositionChangedWithinLastFrame() || light->RadiusChangedWithinLastFrame()) {
-                frame_->lightsToUpdate.PushBack(light);
+        // Now go through and update all lights that moved or had their radius change
+        const auto& flags = frame_->lights.Flags();
+        frame_->lights.ForEachMoved([this, &flags](const size_t light) {
+            if (flags[light] & LIGHT_FLAG_CASTS_SHADOWS) {
+                frame_->lightsToUpdate.PushBack(frame_->lights.HandleAt(light));
             }
-        }
+        });
     }
 
     void RendererFrontend::UpdateMaterialSet_() {
+        STRATUS_PROFILE_SCOPE("UpdateMaterialSet");
         frame_->materialInfo->UploadDataToGpu();
     }
 
     // TODO: This desperately needs to be refactored and made more efficient
     void RendererFrontend::UpdateDrawCommands_() {
+        STRATUS_PROFILE_SCOPE("UpdateDrawCommands");
         const bool staticLightsDirty = frame_->drawCommands->UploadStaticDataToGpu();
         const bool dynamicLightsDirty = staticLightsDirty || frame_->drawCommands->UploadDynamicDataToGpu();
         frame_->drawCommands->UploadFlatDataToGpu();
@@ -950,8 +1414,68 @@ namespace stratus {
         return IsAabbInFrustum(aabb, frustumPlanes);
     }
 
+    // Tells the resource manager how large each mesh is on screen and whether it is in view. Drives
+    // both which mip levels are streamed in and the order textures load in. This is a CPU estimate
+    // from the mesh bounds so it does not account for occlusion or UV density.
+    void RendererFrontend::UpdateTextureRequests_() {
+        STRATUS_PROFILE_SCOPE("UpdateTextureRequests");
+        auto rm = INSTANCE(ResourceManager);
+        if (!rm->IsTextureStreamingEnabled() && !rm->IsLoadingTextures()) return;
+
+        const glm::vec3 cameraPosition = camera_->GetPosition();
+        const float projectionScale = float(frame_->viewportHeight) / (2.0f * std::tan(frame_->fovy.value() / 2.0f));
+
+        // Same extraction as UpdateVisibility_, done here since that runs later in the frame
+        const glm::mat4 vpt = glm::transpose(frame_->projection * frame_->view);
+        const glm::vec4 frustumPlanes[] = {
+            vpt[3] + vpt[0], vpt[3] - vpt[0],
+            vpt[3] + vpt[1], vpt[3] - vpt[1],
+            vpt[3] + vpt[2], vpt[3] - vpt[2]
+        };
+
+        std::vector<TextureScreenSize> requests;
+        for (const EntityPtr& entity : entities_) {
+            auto rc = entity->Components().GetComponent<RenderComponent>().component;
+            auto mt = entity->Components().GetComponent<MeshWorldTransforms>().component;
+            if (rc == nullptr || mt == nullptr) continue;
+
+            for (usize i = 0; i < rc->GetMeshCount() && i < mt->transforms.size(); ++i) {
+                MeshPtr mesh = rc->GetMesh(i);
+                glm::vec3 vmin(std::numeric_limits<float>::max());
+                glm::vec3 vmax(-std::numeric_limits<float>::max());
+                for (usize m = 0; m < mesh->NumMeshlets(); ++m) {
+                    const MeshletPtr meshlet = mesh->GetMeshlet(m);
+                    if (!meshlet->IsFinalized()) continue;
+                    const GpuAABB aabb = TransformAabb(meshlet->GetAABB(), mt->transforms[i], frame_->perFrameScratchMemory);
+                    vmin = glm::min(vmin, glm::vec3(aabb.vmin.ToVec4()));
+                    vmax = glm::max(vmax, glm::vec3(aabb.vmax.ToVec4()));
+                }
+                if (vmin.x > vmax.x) continue;
+
+                GpuAABB bounds;
+                bounds.vmin = glm::vec4(vmin, 1.0f);
+                bounds.vmax = glm::vec4(vmax, 1.0f);
+                const bool visible = IsAabbInFrustum(bounds, frustumPlanes);
+                const float screenSize = TextureStreamer::EstimateScreenSize(vmin, vmax, cameraPosition, projectionScale);
+                const MaterialPtr& material = rc->GetMaterialAt(i);
+                for (const TextureHandle handle : {
+                        material->GetDiffuseMap(),
+                        material->GetEmissiveMap(),
+                        material->GetNormalMap(),
+                        material->GetRoughnessMap(),
+                        material->GetMetallicMap(),
+                        material->GetMetallicRoughnessMap() }) {
+                    if (handle != TextureHandle::Null()) requests.push_back(TextureScreenSize{ handle, screenSize, visible });
+                }
+            }
+        }
+
+        rm->RequestTextureScreenSizes(requests);
+    }
+
     // See the section on culling in "3D Graphics Rendering Cookbook"
-    void RendererFrontend::UpdateVisibility_() {   
+    void RendererFrontend::UpdateVisibility_() {
+        STRATUS_PROFILE_SCOPE("UpdateVisibility");
         using CommandBufferAllocator = StackBasedPoolAllocator< std::unordered_map<RenderFaceCulling, GpuCommandBufferPtr>*>;
         const std::vector<std::unordered_map<RenderFaceCulling, GpuCommandBufferPtr>*, CommandBufferAllocator> commands({
             &frame_->drawCommands->flatMeshes,
@@ -1151,6 +1675,96 @@ namespace stratus {
         //}
     }
 
+    // CPU version of UpdateVisibility_ for headless runs. Tests the same mesh bounds against the camera
+    // frustum and gathers the caster bounds the backend would read back from the draw commands.
+    void RendererFrontend::UpdateVisibilityHeadless_() {
+        STRATUS_PROFILE_SCOPE("UpdateVisibility");
+        glm::vec4 planes[6];
+        PointShadowFaceCulling::ComputeFrustumPlanes(frame_->projection * frame_->view, planes);
+        frame_->viewFrustumPlanes = std::vector<glm::vec4, Vec4Allocator>(planes, planes + 6, Vec4Allocator(frame_->perFrameScratchMemory));
+
+        visibleMeshes_ = 0;
+        staticCasterAabbs_.clear();
+        dynamicCasterAabbs_.clear();
+        for (const EntityPtr& entity : entities_) {
+            auto rc = entity->Components().GetComponent<RenderComponent>().component;
+            auto mt = entity->Components().GetComponent<MeshWorldTransforms>().component;
+            std::vector<GpuAABB>* casters = nullptr;
+            if (IsLightInteracting(entity)) {
+                casters = dynamicEntities_.find(entity) == dynamicEntities_.end() ? &staticCasterAabbs_ : &dynamicCasterAabbs_;
+            }
+
+            for (usize i = 0; i < rc->GetMeshCount() && i < mt->transforms.size(); ++i) {
+                MeshPtr mesh = rc->GetMesh(i);
+                bool visible = false;
+                for (usize m = 0; m < mesh->NumMeshlets(); ++m) {
+                    const MeshletPtr meshlet = mesh->GetMeshlet(m);
+                    if (!meshlet->IsFinalized()) continue;
+                    const GpuAABB aabb = PointShadowFaceCulling::TransformAabb(meshlet->GetAABB(), mt->transforms[i]);
+                    visible = visible || IsAabbInFrustum(aabb, planes);
+                    if (casters != nullptr) casters->push_back(aabb);
+                }
+                if (visible) ++visibleMeshes_;
+            }
+        }
+    }
+
+    // Stands in for the backend when headless. Runs the CPU half of the point shadow pass: the same
+    // update queue, update budget, cube face matrices and face culling the backend uses, without any of
+    // the draws.
+    PointShadowCullingStats RendererFrontend::RenderHeadless_() {
+        STRATUS_PROFILE_SCOPE("PointShadows");
+        PointShadowCullingStats stats;
+        const auto& lightFlags = frame_->lights.Flags();
+        const auto& lightPositions = frame_->lights.Positions();
+        const auto& lightRadii = frame_->lights.Radii();
+        for (int updates = 0; updates < RendererBackend::MaxShadowUpdatesPerFrame && frame_->lightsToUpdate.Size() > 0; ++updates) {
+            const LightHandle handle = frame_->lightsToUpdate.PopFront();
+            if (frame_->lights.Get(handle) == nullptr) continue;
+            const size_t lightIndex = frame_->lights.DenseIndex(handle);
+            const uint32_t flags = lightFlags[lightIndex];
+            if (!(flags & LIGHT_FLAG_CASTS_SHADOWS)) continue;
+            const bool virtualLight = flags & LIGHT_FLAG_VIRTUAL;
+            const glm::vec3& lightPosition = lightPositions[lightIndex];
+            const float lightRadius = lightRadii[lightIndex];
+
+            if (virtualLight && !IsSphereInFrustum(lightPosition, lightRadius, frame_->viewFrustumPlanes)) {
+                frame_->lightsToUpdate.PushBack(handle);
+                continue;
+            }
+
+            const PointLight * point = (const PointLight *)frame_->lights.Get(handle).get();
+            const glm::mat4 lightPerspective = glm::perspective<float>(glm::radians(90.0f), 1.0f, point->GetNearPlane(), lightRadius);
+            glm::mat4 lightViewProj[PointShadowFaceMask::numFaces];
+            PointShadowFaceCulling::ComputeFaceViews(lightPosition, lightViewProj);
+            for (glm::mat4& face : lightViewProj) face = lightPerspective * face;
+
+            PointShadowFaceMask faces;
+            if (frame_->settings.pointShadowFaceCullingEnabled) {
+                PointShadowFaceCulling::AccumulateCasters(lightPosition, lightRadius, lightViewProj, staticCasterAabbs_, faces);
+                if (!(flags & LIGHT_FLAG_STATIC) && !virtualLight) {
+                    PointShadowFaceCulling::AccumulateCasters(lightPosition, lightRadius, lightViewProj, dynamicCasterAabbs_, faces);
+                }
+            }
+            else {
+                faces.mask = 0x3F;
+            }
+
+            if (!virtualLight && faces.Empty()) {
+                ++stats.lightsSkipped;
+                stats.facesSkipped += PointShadowFaceMask::numFaces;
+                // Same as the backend - an empty light does not count against the budget
+                --updates;
+                continue;
+            }
+
+            stats.facesRendered += faces.NumFacesWithCasters();
+            stats.facesSkipped += PointShadowFaceMask::numFaces - faces.NumFacesWithCasters();
+        }
+
+        return stats;
+    }
+
     void RendererFrontend::UpdatePrevFrameModelTransforms_() {
         using CommandBufferAllocator = StackBasedPoolAllocator<std::unordered_map<RenderFaceCulling, GpuCommandBufferPtr>*>;
         std::vector<std::unordered_map<RenderFaceCulling, GpuCommandBufferPtr>*, CommandBufferAllocator> drawCommands({
@@ -5,6 +5,8 @@
 #include "StratusEntity.h"
 #include "StratusEntityCommon.h"
 #include "StratusSystemModule.h"
+#include "StratusMetrics.h"
+#include "StratusFrameCapture.h"
 #include "StratusLight.h"
 #include "StratusThread.h"
 #include "StratusApplicationThread.h"
@@ -19,6 +21,8 @@
 #include "StratusPipeline.h"
 #include "StratusGpuMaterialBuffer.h"
 #include "StratusGpuCommandBuffer.h"
+#include "StratusIrradianceProbes.h"
+#include "StratusCascadeCache.h"
 
 namespace stratus {
     struct RendererParams {
@@ -27,10 +31,27 @@ namespace stratus {
         float znear = 1.0f;
         float zfar = 1000.0f;
         bool vsyncEnabled;
+        // No window or GL context. The frontend still extracts every frame but nothing is uploaded,
+        // camera culling runs on the CPU and the backend is replaced by the CPU side of the point
+        // shadow pass (see RenderHeadless_).
+        bool headless = false;
+        // Used in place of the window size when headless
+        u32 viewportWidth = 1600;
+        u32 viewportHeight = 900;
     };
 
+    // Conversions used when capturing and replaying frames (see FrameCapture). The skybox is not captured
+    // so ApplyCapturedSettings leaves it alone.
+    CapturedSettings CaptureRendererSettings(const RendererSettings&);
+    void ApplyCapturedSettings(const CapturedSettings&, RendererSettings&);
+
     // Public interface of the renderer - manages frame to frame state and manages
     // the backend
+    //
+    // Each frame is split into an extract step, which copies everything the application and entities
+    // have changed into frame_, and a render step which hands frame_ to the backend. The public API only
+    // touches frontend-side state (pending light/entity changes, staged settings) so that when the engine
+    // is pipelined the next frame can be simulated while the render step is still running.
     SYSTEM_MODULE_CLASS(RendererFrontend)
     private:
         RendererFrontend(const RendererParams&);
@@ -51,6 +72,30 @@ namespace stratus {
         RendererSettings GetSettings() const;
         void SetSettings(const RendererSettings&);
 
+        // Baked static GI (see IrradianceProbeBaker). While set, baked VPLs are skipped by the
+        // per-frame GI pass and the probes are sampled instead. Pass nullptr to go back to live VPLs.
+        void SetStaticIrradianceProbes(const IrradianceProbeGridPtr&);
+        IrradianceProbeGridPtr GetStaticIrradianceProbes() const;
+        // Bakes all VPLs marked as baked (see VirtualPointLight::SetBaked) on the task system using the
+        // colors the GI pass last computed for them, so run the scene with the intended sun first.
+        // Static light interacting meshes occlude the lights. The result can be saved next to the scene
+        // with IrradianceProbeGrid::SaveToFile(IrradianceProbeGrid::ProbeFileForScene(scene)).
+        IrradianceProbeBakeJob BakeStaticIrradianceProbes(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const float spacing);
+        // Same as above with the grid covering all static light interacting meshes
+        IrradianceProbeBakeJob BakeStaticIrradianceProbes(const float spacing);
+        // Loads the probes baked for the scene file (see IrradianceProbeGrid::ProbeFileForScene) and sets
+        // them. Returns false and leaves the current probes alone if there is no valid probe file.
+        bool LoadStaticIrradianceProbes(const std::string& scenePath);
+
+        // One entry per shadow cascade (see RendererSettings::cascadeCachingEnabled)
+        std::vector<CascadeUpdateStats> GetCascadeUpdateStats() const;
+
+        // Point light shadow faces and lights skipped during the last rendered frame because they had no casters
+        PointShadowCullingStats GetPointShadowCullingStats() const;
+
+        // Per frame scratch memory use as of the end of the last rendered frame
+        FrameArenaStats GetScratchMemoryStats() const;
+
         // std::vector<SDL_Event> PollInputEvents();
         // RendererMouseState GetMouseState() const;
 
@@ -62,6 +107,11 @@ namespace stratus {
         virtual SystemStatus Update(const double);
         virtual void Shutdown();
 
+        // Update is Extract_ followed by Render_. The engine calls them separately when pipelined.
+        // Extract_ returns false if there is nothing to render (no camera set).
+        bool Extract_(const double);
+        void Render_(const double);
+
     private:
         std::unique_lock<std::shared_mutex> LockWrite_() const { return std::unique_lock<std::shared_mutex>(mutex_); }
         std::shared_lock<std::shared_mutex> LockRead_()  const { return std::shared_lock<std::shared_mutex>(mutex_); }
@@ -74,11 +124,13 @@ namespace stratus {
         void CopyMaterialToGpuAndMarkForUse_(const MaterialPtr& material, GpuMaterial* gpuMaterial);
 
     private:
+        std::pair<u32, u32> GetViewportDims_() const;
         void UpdateViewport_();
         void UpdateCascadeData_();
         void CheckForEntityChanges_();
         void UpdateLights_();
         void UpdateMaterialSet_();
+        void UpdateTextureRequests_();
         void MarkDynamicLightsDirty_();
         void MarkStaticLightsDirty_();
         void MarkAllLightsDirty_();
@@ -95,12 +147,35 @@ namespace stratus {
             const std::function<GpuCommandReceiveBufferPtr (const RendererCascadeData&, const RenderFaceCulling&)>& select,
             std::unordered_map<RenderFaceCulling, GpuCommandBufferPtr>& commands
         );
+        // Headless replacements for the GPU culling passes and the backend
+        void UpdateVisibilityHeadless_();
+        PointShadowCullingStats RenderHeadless_();
         void UpdatePrevFrameModelTransforms_();
+        void ApplyPendingLightChanges_();
+        void ApplyPendingEntityChanges_();
+        void RegisterMetrics_();
+        // Requires the write lock
+        void UpdateMetrics_();
+        // Records the pending light and entity changes before Extract_ applies them
+        void BeginCapture_(const double deltaSeconds);
+        // Records the camera, settings and light changes then writes the frame out
+        void EndCapture_();
 
     private:
+        enum class PendingChange_ {
+            ADDED,
+            REMOVED,
+            // Components were added, enabled or disabled
+            CHANGED,
+            // Lights only - removes every light
+            CLEARED
+        };
+
         // These are called by the private entity handler
         friend struct RenderEntityProcess;
         void EntitiesAdded_(const std::unordered_set<stratus::EntityPtr>&);
+        // World space meshlet bounds of every static light interacting entity
+        std::vector<GpuAABB> CollectStaticOccluders_() const;
         void EntitiesRemoved_(const std::unordered_set<stratus::EntityPtr>&);
         void EntityComponentsAdded_(const std::unordered_map<stratus::EntityPtr, std::vector<stratus::EntityComponent *>>&);
         void EntityComponentsEnabledDisabled_(const std::unordered_set<stratus::EntityPtr>&);
@@ -111,20 +186,36 @@ namespace stratus {
         // These are entities we need to check for position/orientation/scale updates
         std::unordered_set<EntityPtr> dynamicEntities_;
         //std::vector<GpuMaterial> _gpuMaterials;
-        std::unordered_set<LightPtr> lights_;
-        std::unordered_set<LightPtr> dynamicLights_;
-        std::unordered_set<LightPtr> staticLights_;
-        std::unordered_set<LightPtr> virtualPointLights_;
+        // Lights themselves live in frame_->lights
         InfiniteLightPtr worldLight_;
-        std::unordered_set<LightPtr> lightsToRemove_;
+        std::vector<LightPtr> lightsToRemove_;
+        // Applied in order during Extract_
+        std::vector<std::pair<PendingChange_, LightPtr>> pendingLightChanges_;
+        std::vector<std::pair<PendingChange_, EntityPtr>> pendingEntityChanges_;
+        // Staged copies of frame_ state the application can set - copied over during Extract_
+        RendererSettings settings_;
+        glm::vec4 clearColor_ = glm::vec4(0.0f);
+        IrradianceProbeGridPtr staticIrradianceProbes_;
+        // Copied out of the backend after each render
+        PointShadowCullingStats pointShadowCullingStats_;
+        FrameArenaStats scratchStats_;
         EntityMeshData flatEntities_;
         EntityMeshData dynamicPbrEntities_;
         EntityMeshData staticPbrEntities_;
+        // Headless only - world space bounds of every light interacting mesh, rebuilt each frame
+        std::vector<GpuAABB> staticCasterAabbs_;
+        std::vector<GpuAABB> dynamicCasterAabbs_;
+        usize visibleMeshes_ = 0;
+        // Tracks which shadow cascades can reuse last frame's depth
+        CascadeCache cascadeCache_;
+        bool cascadeAlphaTest_ = false;
         uint64_t lastFrameMaterialIndicesRecomputed_ = 0;
         CameraPtr camera_;
         glm::mat4 projection_ = glm::mat4(1.0f);
         bool viewportDirty_ = true;
         bool recompileShaders_ = false;
+        // Time since the shader files were last checked for changes (see RendererSettings::shaderHotReloadEnabled)
+        double shaderReloadSeconds_ = 0.0;
         std::shared_ptr<RendererFrame> frame_;
         std::unique_ptr<RendererBackend> renderer_;
         // This forwards entity state changes to the renderer
@@ -137,5 +228,25 @@ namespace stratus {
         // Used for temporal anti-aliasing
         size_t currentHaltonIndex_ = 0;
         mutable std::shared_mutex mutex_;
+        // Sum of CascadeUpdateStats as of the last frame, used to turn the totals into counter increments
+        CascadeUpdateStats lastCascadeTotals_;
+        // Frame being recorded by Extract_ when FrameCapture is running
+        CapturedFrame capture_;
+        bool capturingFrame_ = false;
+        // FrameCapture::Session() the last frame was recorded for
+        u64 captureSession_ = 0;
+        MetricId entitiesMetric_;
+        MetricId lightsMetric_;
+        MetricId drawCommandsMetric_;
+        MetricId freeMeshVerticesMetric_;
+        MetricId freeMeshIndicesMetric_;
+        MetricId shadowCacheHitsMetric_;
+        MetricId shadowCacheMissesMetric_;
+        MetricId pointShadowFacesSkippedMetric_;
+        MetricId pointShadowFacesRenderedMetric_;
+        MetricId scratchBytesUsedMetric_;
+        MetricId scratchCapacityMetric_;
+        MetricId scratchOverflowBytesMetric_;
+        MetricId visibleMeshesMetric_;
     };
 }
\ No newline at end of file
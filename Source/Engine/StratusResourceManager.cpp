@@ -17,11 +17,33 @@
 #include "StratusAsync.h"
 #include "StratusRenderComponents.h"
 #include "StratusTransformComponent.h"
+#include "StratusFilesystem.h"
 #include <sstream>
+#include <cstring>
 #include <algorithm>
 #include <filesystem>
 
 namespace stratus {
+    static constexpr usize stagingBufferBytes = 64 * 1024 * 1024;
+    static constexpr usize defaultUploadBytesPerFrame = 32 * 1024 * 1024;
+    static constexpr f64 defaultUploadMsPerFrame = 2.0;
+
+    // Calls process(data, sizeBytes) for each block of pixel data a texture upload reads, in upload order.
+    // layerBytes is the size of each layer which has no mip chain.
+    template<typename Process>
+    static void ForEachTextureUpload(TextureArrayData& upload, const usize layerBytes, const Process& process) {
+        for (TextureData& layer : upload) {
+            if (layer.mips.size() == 0) {
+                process(layer.data, layerBytes);
+                continue;
+            }
+            for (TextureMipData& mip : layer.mips) {
+                process(mip.data, mip.sizeBytes);
+            }
+            layer.data = layer.mips[0].data;
+        }
+    }
+
     ResourceManager::ResourceManager() {}
 
     ResourceManager::~ResourceManager() {
@@ -31,13 +53,44 @@ namespace stratus {
         {
             auto ul = LockWrite_();
             ClearAsyncTextureData_();
+            UpdateTextureLoads_();
             ClearAsyncModelData_();
+            UpdateTextureStreaming_();
+
+            MetricsRegistry& metrics = MetricsRegistry::Instance();
+            metrics.SetGauge(modelsMetric_, f64(loadedModels_.size()));
+            metrics.SetGauge(texturesMetric_, f64(loadedTextures_.size()));
+            metrics.SetGauge(texturesLoadingMetric_, f64(texturesStillLoading_.size()));
+            metrics.SetGauge(textureLoadBytesMetric_, f64(textureLoadQueue_.Stats().bytesInFlight));
+            if (textureStreamer_ != nullptr) {
+                metrics.SetGauge(streamingResidentBytesMetric_, f64(textureStreamer_->Stats().residentBytes));
+            }
         }
 
+        // Outside of the lock since finishing a texture takes it
+        uploadQueue_->ProcessFrame();
+        NotifyTextureStatusChanges_();
+
+        const UploadQueueStats uploads = uploadQueue_->Stats();
+        MetricsRegistry::Instance().SetGauge(uploadPendingCopiesMetric_, f64(uploads.pendingCopies));
+        MetricsRegistry::Instance().Increment(uploadedBytesMetric_, i64(uploads.bytesLastFrame));
+
         return SystemStatus::SYSTEM_CONTINUE;
     }
 
     bool ResourceManager::Initialize() {
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        modelsMetric_ = metrics.RegisterGauge("ResourceManager.models", "Models loaded or loading");
+        texturesMetric_ = metrics.RegisterGauge("ResourceManager.textures", "Textures loaded or loading");
+        texturesLoadingMetric_ = metrics.RegisterGauge("ResourceManager.texturesLoading");
+        textureLoadBytesMetric_ = metrics.RegisterGauge("ResourceManager.textureLoadBytes", "Memory held by texture loads in progress");
+        streamingResidentBytesMetric_ = metrics.RegisterGauge("ResourceManager.streamingResidentBytes", "Committed memory of streamed textures");
+        uploadPendingCopiesMetric_ = metrics.RegisterGauge("ResourceManager.uploadPendingCopies");
+        uploadedBytesMetric_ = metrics.RegisterCounter("ResourceManager.uploadedBytes", "Bytes copied to the GPU by the upload queue");
+
+        stagingBuffer_ = std::make_shared<GpuStagingBuffer>(stagingBufferBytes);
+        uploadQueue_ = std::make_shared<UploadQueue>(stagingBuffer_, defaultUploadBytesPerFrame, defaultUploadMsPerFrame);
+
         InitCube_();
         InitQuad_();
 
@@ -45,12 +98,33 @@ namespace stratus {
     }
 
     void ResourceManager::Shutdown() {
+        const TextureDedupStats dedup = GetTextureDedupStats();
+        STRATUS_LOG << "Texture dedup: " << dedup.duplicateTextures << " duplicates of " << dedup.uniqueTextures
+            << " unique textures, saved " << dedup.sourceBytesSaved << " source bytes and "
+            << dedup.decodedBytesSaved << " decoded bytes" << std::endl;
+
         loadedModels_.clear();
         pendingFinalize_.clear();
         meshFinalizeQueue_.clear();
         asyncLoadedTextureData_.clear();
         loadedTextures_.clear();
         loadedTexturesByFile_.clear();
+        textureDedup_.Clear();
+        // Anything that has not been read yet still owns its in-memory source
+        for (auto& job : textureLoadJobs_) {
+            if (textureLoadQueue_.Stage(job.first) != TextureLoadStage::QUEUED) continue;
+            for (const BinaryDataWrapper& data : job.second->data) delete[] data.data;
+        }
+        textureLoadJobs_.clear();
+        asyncTextureReads_.clear();
+        textureStreamer_.reset();
+        streamedTextures_.clear();
+        pendingMipLoads_.clear();
+        textureStatusChanges_.clear();
+        textureStatusCallbacks_.clear();
+        // Anything still queued is dropped along with the staging memory
+        uploadQueue_.reset();
+        stagingBuffer_.reset();
     }
 
     void ResourceManager::ClearAsyncTextureData_() {
@@ -58,44 +132,88 @@ namespace stratus {
         //constexpr usize maxBytes = 1024 * 1024 * 10; // 10 mb per frame
         usize totalTex = 0;
         usize totalBytes = 0;
-        std::vector<TextureHandle> handles;
         std::vector<std::shared_ptr<RawTextureData>> rawTexData;
         for (auto& tpair : asyncLoadedTextureData_) {
             //if (totalBytes > maxBytes) break;
             if (tpair.second.Completed()) {
                 toDelete.push_back(tpair.first);
-                if (tpair.second.Failed()) {
+                TextureHandle handle = tpair.first;
+                auto texdata = tpair.second.Failed() ? nullptr : tpair.second.GetPtr();
+                if (!texdata) {
+                    // Reports as failed from here on
+                    texturesStillLoading_.erase(handle);
+                    textureStatusChanges_.insert(handle);
+                    textureLoadQueue_.Finish(handle);
                     continue;
                 }
-                TextureHandle handle = tpair.first;
-                auto texdata = tpair.second.GetPtr();
-                if (!texdata) continue;
+                // Decode buffers are gone, what is left waits for the application thread
+                textureLoadQueue_.SetStage(handle, TextureLoadStage::UPLOADING, texdata->sizeBytes);
                 totalBytes += texdata->sizeBytes;
+                textureDedup_.SetDecodedBytes(handle, texdata->sizeBytes);
                 ++totalTex;
 
-                handles.push_back(handle);
                 rawTexData.push_back(texdata);
             }
         }
 
         if (totalBytes > 0) {
             STRATUS_LOG << "Texture data bytes processed: " << totalBytes << ", " << totalTex << std::endl;
+            const TextureDedupStats dedup = textureDedup_.Stats();
+            if (dedup.duplicateTextures > 0) {
+                STRATUS_LOG << "Texture dedup: " << dedup.duplicateTextures << " duplicates of "
+                    << dedup.uniqueTextures << " unique textures, " << dedup.sourceBytesSaved
+                    << " source bytes skipped" << std::endl;
+            }
         }
 
         for (auto handle : toDelete) asyncLoadedTextureData_.erase(handle);
 
-        ApplicationThread::Instance()->Queue([this, handles, rawTexData]() {
-            std::vector<Texture*> ptrs(rawTexData.size());
-            for (i32 i = 0; i < rawTexData.size(); ++i) {
-                ptrs[i] = FinalizeTexture_(*rawTexData[i]);
-            }
+        // Pixel data is copied into staging memory on a task thread and the application thread picks
+        // up the copy when the upload queue gets to it
+        TaskSystem* tasks = TaskSystem::Instance();
+        const UploadQueuePtr uploads = uploadQueue_;
+        const GpuBuffer staging = stagingBuffer_->GetBuffer();
+        for (const std::shared_ptr<RawTextureData>& texdata : rawTexData) {
+            const auto copy = [this, texdata, staging](const UploadSource& source) {
+                FinishTexture_(*texdata, staging, source);
+            };
 
-            auto ul = LockWrite_();
-            for (i32 i = 0; i < handles.size(); ++i) {
-                texturesStillLoading_.erase(handles[i]);
-                loadedTextures_.insert(std::make_pair(handles[i], Async<Texture>(std::shared_ptr<Texture>(ptrs[i]))));
+            // Sparse textures only upload their (small) mip tail and its layout is not known until
+            // the texture exists, so they are not staged
+            if (texdata->streamed) {
+                uploads->Queue(0, copy);
+                continue;
             }
+
+            tasks->ScheduleTask([uploads, texdata, copy]() {
+                TextureArrayData upload = TextureUploadData_(*texdata);
+                usize sizeBytes = 0;
+                ForEachTextureUpload(upload, texdata->sizeBytes, [&sizeBytes](const void *&, const usize bytes) {
+                    sizeBytes += bytes;
+                });
+
+                const auto write = [&upload, texdata](u8 * memory) {
+                    ForEachTextureUpload(upload, texdata->sizeBytes, [&memory](const void *& data, const usize bytes) {
+                        std::memcpy(memory, data, bytes);
+                        memory += bytes;
+                    });
+                };
+                uploads->Stage(sizeBytes, write, copy);
             });
+        }
+    }
+
+    void ResourceManager::FinishTexture_(RawTextureData& data, const GpuBuffer& staging, const UploadSource& source) {
+        Texture* texture = FinalizeTexture_(data, staging, source);
+
+        auto ul = LockWrite_();
+        texturesStillLoading_.erase(data.handle);
+        textureStatusChanges_.insert(data.handle);
+        textureLoadQueue_.Finish(data.handle);
+        loadedTextures_.insert(std::make_pair(data.handle, Async<Texture>(std::shared_ptr<Texture>(texture))));
+        if (data.streamed) {
+            RegisterStreamedTexture_(*texture, data);
+        }
     }
 
     void ResourceManager::ClearAsyncModelData_() {
@@ -136,10 +254,22 @@ namespace stratus {
         //for (auto meshlet : removeFromGpuDataQueue) {
         for (usize i = 0; i < numUploadGpuData; i++) {
             auto& meshlet = uploadGpuDataQueue[i];
-            meshlet->FinalizeData();
+            meshlet->AllocateGpuData();
             generateMeshGpuDataQueue_.erase(meshlet);
         }
 
+        // Copying into staging memory happens on a task thread, the application thread only issues the copies
+        if (numUploadGpuData > 0) {
+            const std::vector<MeshletPtr> staged(uploadGpuDataQueue, uploadGpuDataQueue + numUploadGpuData);
+            const UploadQueuePtr uploads = uploadQueue_;
+            const GpuBuffer staging = stagingBuffer_->GetBuffer();
+            INSTANCE(TaskSystem)->ScheduleTask([staged, uploads, staging]() {
+                for (MeshletPtr meshlet : staged) {
+                    meshlet->StageGpuData(*uploads, staging);
+                }
+            });
+        }
+
         // If none other left to finalize, end early
         if (pendingFinalize_.size() == 0) {
             return;
@@ -259,12 +389,265 @@ namespace stratus {
         return e;
     }
 
-    TextureHandle ResourceManager::LoadTexture(const std::string& name, const ColorSpace& cspace) {
-        return LoadTextureImpl_({ name }, {}, cspace);
+    TextureHandle ResourceManager::LoadTexture(const std::string& name, const ColorSpace& cspace, const TextureUsage usage) {
+        return LoadTextureImpl_({ name }, {}, cspace, usage);
+    }
+
+    TextureHandle ResourceManager::LoadTexture(const std::string& name, BinaryDataWrapper data, const ColorSpace& cspace, const TextureUsage usage) {
+        return LoadTextureImpl_({ name }, { data }, cspace, usage);
+    }
+
+    void ResourceManager::SetTextureCooking(const bool enabled, const std::string& cacheDirectory) {
+        auto ul = LockWrite_();
+        textureCookCache_ = enabled ? std::make_shared<TextureCookCache>(cacheDirectory) : nullptr;
+    }
+
+    void ResourceManager::SetTextureStreaming(const bool enabled, const usize budgetBytes) {
+        auto ul = LockWrite_();
+        // Textures which were already streamed keep whatever levels they currently have
+        if (!enabled) {
+            textureStreamer_.reset();
+        }
+        else if (textureStreamer_ == nullptr) {
+            textureStreamer_ = std::make_unique<TextureStreamer>(budgetBytes);
+        }
+        else {
+            textureStreamer_->SetBudget(budgetBytes);
+        }
+    }
+
+    bool ResourceManager::IsTextureStreamingEnabled() const {
+        auto sl = LockRead_();
+        return textureStreamer_ != nullptr;
+    }
+
+    void ResourceManager::RequestTextureScreenSizes(const std::vector<TextureScreenSize>& requests) {
+        auto ul = LockWrite_();
+        for (const TextureScreenSize& request : requests) {
+            const TextureHandle handle = ResolveTexture_(request.handle);
+            // Larger on screen loads first
+            textureLoadQueue_.Prioritize(handle, request.visible, request.pixels);
+            if (textureStreamer_ != nullptr) textureStreamer_->RequestScreenSize(handle, request.pixels);
+        }
+    }
+
+    void ResourceManager::SetTextureLoadBudget(const usize budgetBytes) {
+        auto ul = LockWrite_();
+        textureLoadQueue_.SetBudget(budgetBytes);
+    }
+
+    TextureLoadStats ResourceManager::GetTextureLoadStats() const {
+        auto sl = LockRead_();
+        return textureLoadQueue_.Stats();
+    }
+
+    bool ResourceManager::IsLoadingTextures() const {
+        auto sl = LockRead_();
+        return textureLoadQueue_.Size() > 0;
+    }
+
+    void ResourceManager::SetUploadBudget(const usize bytesPerFrame, const f64 msPerFrame) {
+        uploadQueue_->SetBudget(bytesPerFrame, msPerFrame);
     }
 
-    TextureHandle ResourceManager::LoadTexture(const std::string& name, BinaryDataWrapper data, const ColorSpace& cspace) {
-        return LoadTextureImpl_({ name }, { data }, cspace);
+    UploadQueueStats ResourceManager::GetUploadStats() const {
+        return uploadQueue_->Stats();
+    }
+
+    void ResourceManager::UpdateTextureLoads_() {
+        TaskSystem* tasks = TaskSystem::Instance();
+
+        std::vector<TextureHandle> finishedReads;
+        for (auto& read : asyncTextureReads_) {
+            if (!read.second.Completed()) continue;
+
+            const TextureHandle handle = read.first;
+            finishedReads.push_back(handle);
+            auto job = read.second.Failed() ? nullptr : read.second.GetPtr();
+            // Duplicates are done since lookups already resolve to the owner
+            if (job == nullptr || job->aliasOf != TextureHandle::Null()) {
+                texturesStillLoading_.erase(handle);
+                textureStatusChanges_.insert(handle);
+                textureLoadJobs_.erase(handle);
+                textureLoadQueue_.Finish(handle);
+                continue;
+            }
+            textureLoadQueue_.FinishRead(handle, job->sourceBytes, job->decodedBytes);
+        }
+        for (auto handle : finishedReads) asyncTextureReads_.erase(handle);
+
+        // Decodes go first so memory held by sources drains before more is read in
+        for (const TextureHandle handle : textureLoadQueue_.AdmitDecodes()) {
+            auto it = textureLoadJobs_.find(handle);
+            const TextureLoadJobPtr job = it->second;
+            textureLoadJobs_.erase(it);
+            // We have to use the main thread for the upload since Texture calls glGenTextures :(
+            Async<RawTextureData> as = tasks->ScheduleTask<RawTextureData>([this, job, handle]() {
+                return LoadTexture_(*job, handle);
+            });
+            asyncLoadedTextureData_.insert(std::make_pair(handle, as));
+        }
+
+        for (const TextureHandle handle : textureLoadQueue_.AdmitReads()) {
+            const TextureLoadJobPtr job = textureLoadJobs_.find(handle)->second;
+            Async<TextureLoadJob_> as = tasks->ScheduleTask<TextureLoadJob_>([this, job, handle]() {
+                return ReadTextureSources_(*job, handle) ? job : nullptr;
+            });
+            asyncTextureReads_.insert(std::make_pair(handle, as));
+        }
+    }
+
+    u32 ResourceManager::GetStreamedTextureMinMip(const TextureHandle handle) const {
+        auto sl = LockRead_();
+        auto it = streamedTextures_.find(ResolveTexture_(handle));
+        return it == streamedTextures_.end() ? 0 : it->second.uploadedMip;
+    }
+
+    u64 ResourceManager::AddTextureStatusCallback(const TextureStatusCallback& callback) {
+        auto ul = LockWrite_();
+        const u64 id = nextTextureStatusCallback_++;
+        textureStatusCallbacks_.insert(std::make_pair(id, callback));
+        return id;
+    }
+
+    void ResourceManager::RemoveTextureStatusCallback(const u64 id) {
+        auto ul = LockWrite_();
+        textureStatusCallbacks_.erase(id);
+    }
+
+    void ResourceManager::NotifyTextureStatusChanges_() {
+        std::unordered_set<TextureHandle> changes;
+        std::vector<TextureStatusCallback> callbacks;
+        {
+            auto ul = LockWrite_();
+            if (textureStatusChanges_.size() == 0) return;
+
+            changes = std::move(textureStatusChanges_);
+            textureStatusChanges_.clear();
+            // Materials may reference the content through a duplicate handle
+            for (const auto& alias : textureDedup_.Aliases()) {
+                if (changes.find(alias.second) != changes.end()) changes.insert(alias.first);
+            }
+
+            callbacks.reserve(textureStatusCallbacks_.size());
+            for (const auto& callback : textureStatusCallbacks_) callbacks.push_back(callback.second);
+        }
+
+        // Callbacks are free to call back in (LookupTextures etc)
+        for (const auto& callback : callbacks) callback(changes);
+    }
+
+    TextureStreamingStats ResourceManager::GetTextureStreamingStats() const {
+        auto sl = LockRead_();
+        return textureStreamer_ == nullptr ? TextureStreamingStats() : textureStreamer_->Stats();
+    }
+
+    void ResourceManager::RegisterStreamedTexture_(const Texture& texture, const RawTextureData& data) {
+        if (textureStreamer_ == nullptr) return;
+
+        const TexturePageLayout& layout = data.pageLayout;
+        const u32 firstTailMip = layout.FirstTailMip();
+
+        StreamedTexture_ streamed;
+        streamed.texture = texture;
+        streamed.cache = data.cookCache;
+        streamed.key = data.cooked->key;
+        streamed.uploadedMip = firstTailMip;
+        streamed.uploaded.resize(layout.numMips, false);
+        streamed.generation.resize(layout.numMips, 0);
+        for (u32 mip = firstTailMip; mip < layout.numMips; ++mip) streamed.uploaded[mip] = true;
+
+        streamedTextures_.insert(std::make_pair(data.handle, std::move(streamed)));
+        textureStreamer_->Register(data.handle, layout);
+    }
+
+    void ResourceManager::UpdateTextureStreaming_() {
+        // Finished reads are handed to the application thread for upload. This runs even if streaming
+        // was disabled so that in-flight levels still land.
+        for (auto it = pendingMipLoads_.begin(); it != pendingMipLoads_.end();) {
+            if (!it->data.Completed()) {
+                ++it;
+                continue;
+            }
+
+            const PendingMipLoad_ load = *it;
+            it = pendingMipLoads_.erase(it);
+            ApplicationThread::Instance()->Queue([this, load]() {
+                FinishMipLoad_(load);
+            });
+        }
+
+        if (textureStreamer_ == nullptr) return;
+
+        TaskSystem* tasks = TaskSystem::Instance();
+        for (const TextureStreamingAction& action : textureStreamer_->Update()) {
+            auto it = streamedTextures_.find(action.handle);
+            if (it == streamedTextures_.end()) continue;
+
+            StreamedTexture_& streamed = it->second;
+            const u32 mip = action.mip;
+            const u32 generation = ++streamed.generation[mip];
+
+            if (!action.commit) {
+                // Stop sampling the level right away, the memory goes back once the application thread gets to it
+                streamed.uploaded[mip] = false;
+                if (streamed.uploadedMip <= mip) {
+                    streamed.uploadedMip = mip + 1;
+                    textureStatusChanges_.insert(action.handle);
+                }
+
+                const Texture texture = streamed.texture;
+                ApplicationThread::Instance()->Queue([texture, mip]() {
+                    texture.CommitOrUncommitVirtualMip(mip, false);
+                });
+                continue;
+            }
+
+            const TextureCookCachePtr cache = streamed.cache;
+            const u64 key = streamed.key;
+            Async<CookedMip> data = tasks->ScheduleTask<CookedMip>([cache, key, mip]() {
+                auto result = std::make_shared<CookedMip>();
+                if (!cache->LoadMip(key, mip, *result)) {
+                    STRATUS_WARN << "Unable to stream mip " << mip << " from " << cache->PathFor(key) << std::endl;
+                    return std::shared_ptr<CookedMip>();
+                }
+                return result;
+            });
+
+            pendingMipLoads_.push_back(PendingMipLoad_{ action.handle, mip, generation, data });
+        }
+    }
+
+    void ResourceManager::FinishMipLoad_(const PendingMipLoad_& load) {
+        if (load.data.Failed()) return;
+        auto mip = load.data.GetPtr();
+        if (!mip) return;
+
+        auto ul = LockWrite_();
+        auto it = streamedTextures_.find(load.handle);
+        // Level was uncommitted (and possibly requested again) while the read was in flight
+        if (it == streamedTextures_.end() || it->second.generation[load.mip] != load.generation) return;
+
+        StreamedTexture_& streamed = it->second;
+        // Pages are only committed once there is data for them so nothing is sampled uninitialized
+        streamed.texture.CommitOrUncommitVirtualMip(load.mip, true);
+
+        TextureMipData upload;
+        upload.data = (const void *)mip->data.data();
+        upload.width = mip->width;
+        upload.height = mip->height;
+        upload.sizeBytes = mip->data.size();
+        streamed.texture.UploadMip(load.mip, upload);
+        streamed.uploaded[load.mip] = true;
+
+        // Levels can finish out of order but shaders can only be pointed at a contiguous chain
+        const u32 previous = streamed.uploadedMip;
+        while (streamed.uploadedMip > 0 && streamed.uploaded[streamed.uploadedMip - 1]) {
+            --streamed.uploadedMip;
+        }
+        if (streamed.uploadedMip != previous) {
+            textureStatusChanges_.insert(load.handle);
+        }
     }
 
     TextureHandle ResourceManager::LoadCubeMap(const std::string& prefix, const ColorSpace& cspace, const std::string& fileExt) {
@@ -276,6 +659,7 @@ namespace stratus {
                                  prefix + "back." + fileExt },
             {},
             cspace,
+            TextureUsage::GENERIC,
             TextureType::TEXTURE_CUBE_MAP,
             TextureCoordinateWrapping::CLAMP_TO_EDGE,
             TextureMinificationFilter::LINEAR_MIPMAP_LINEAR,
@@ -285,6 +669,7 @@ namespace stratus {
     TextureHandle ResourceManager::LoadTextureImpl_(const std::vector<std::string>& files,
         const std::vector<BinaryDataWrapper>& data,
         const ColorSpace& cspace,
+        const TextureUsage usage,
         const TextureType type,
         const TextureCoordinateWrapping wrap,
         const TextureMinificationFilter min,
@@ -305,43 +690,94 @@ namespace stratus {
             }
         }
 
+        // Albedo alpha drives the alpha test so its mips need to keep the same coverage. Read before
+        // taking our lock since the renderer calls into us while holding its own.
+        float alphaCoverageThreshold = 0.0f;
+        if (usage == TextureUsage::ALBEDO && INSTANCE(RendererFrontend) != nullptr) {
+            alphaCoverageThreshold = INSTANCE(RendererFrontend)->GetSettings().GetAlphaDepthTestThreshold();
+        }
+
+        if (data.size() > 0 && files.size() != data.size()) {
+            STRATUS_ERROR << "Invalid file/data length combination" << std::endl;
+            return TextureHandle::Null();
+        }
+
         auto ul = LockWrite_();
         auto handle = TextureHandle::NextHandle();
-        TaskSystem* tasks = TaskSystem::Instance();
-        // We have to use the main thread since Texture calls glGenTextures :(
-        Async<RawTextureData> as = tasks->ScheduleTask<RawTextureData>([this, files, data, handle, cspace, type, wrap, min, mag]() {
-            auto result = LoadTexture_(files, data, handle, cspace, type, wrap, min, mag);
-            //auto ul = this->LockWrite_();
-            //this->texturesStillLoading_.erase(handle);
-            return result;
-            });
+
+        TextureLoadJobPtr job = std::make_shared<TextureLoadJob_>();
+        job->files = files;
+        job->data = data;
+        job->cspace = cspace;
+        job->usage = usage;
+        // Cube maps and arrays are left uncooked
+        job->cookCache = (type == TextureType::TEXTURE_2D && files.size() == 1) ? textureCookCache_ : nullptr;
+        job->alphaCoverageThreshold = alphaCoverageThreshold;
+        job->allowStreaming = textureStreamer_ != nullptr;
+        job->type = type;
+        job->wrap = wrap;
+        job->min = min;
+        job->mag = mag;
+
+        // Only needs to be close enough to decide when to start reading
+        usize estimatedSourceBytes = 0;
+        for (usize index = 0; index < files.size(); ++index) {
+            if (data.size() > 0) {
+                estimatedSourceBytes += data[index].sizeBytes;
+                continue;
+            }
+            std::error_code error;
+            const auto size = std::filesystem::file_size(files[index], error);
+            if (!error) estimatedSourceBytes += usize(size);
+        }
 
         texturesStillLoading_.insert(handle);
         loadedTexturesByFile_.insert(std::make_pair(name, handle));
-        asyncLoadedTextureData_.insert(std::make_pair(handle, as));
+        textureLoadJobs_.insert(std::make_pair(handle, job));
+        textureLoadQueue_.Push(handle, estimatedSourceBytes);
 
         return handle;
     }
 
-    Texture ResourceManager::LookupTexture(const TextureHandle handle, TextureLoadingStatus& status) const {
-        auto sl = LockRead_();
-        if (loadedTextures_.find(handle) == loadedTextures_.end()) {
+    TextureLookup ResourceManager::LookupTexture_(const TextureHandle alias) const {
+        TextureLookup lookup;
+        const TextureHandle handle = ResolveTexture_(alias);
+        auto it = loadedTextures_.find(handle);
+        if (it == loadedTextures_.end()) {
             if (texturesStillLoading_.find(handle) == texturesStillLoading_.end()) {
-                status = TextureLoadingStatus::FAILED;
+                lookup.status = TextureLoadingStatus::FAILED;
             }
             else {
-                status = TextureLoadingStatus::LOADING;
+                lookup.status = TextureLoadingStatus::LOADING;
             }
 
-            return Texture();
+            return lookup;
         }
 
-        status = TextureLoadingStatus::LOADING_DONE;
+        lookup.status = TextureLoadingStatus::LOADING_DONE;
+        lookup.texture = it->second.Get();
+        auto streamed = streamedTextures_.find(handle);
+        if (streamed != streamedTextures_.end()) lookup.minMip = streamed->second.uploadedMip;
+
+        return lookup;
+    }
+
+    Texture ResourceManager::LookupTexture(const TextureHandle alias, TextureLoadingStatus& status) const {
+        auto sl = LockRead_();
+        const TextureLookup lookup = LookupTexture_(alias);
+        status = lookup.status;
+        return lookup.texture;
+    }
 
-        return loadedTextures_.find(handle)->second.Get();
+    void ResourceManager::LookupTextures(const std::vector<TextureHandle>& handles, std::vector<TextureLookup>& results) const {
+        results.resize(handles.size());
+        auto sl = LockRead_();
+        for (usize i = 0; i < handles.size(); ++i) {
+            results[i] = LookupTexture_(handles[i]);
+        }
     }
 
-    static TextureHandle LoadMaterialTexture(const aiScene* scene, aiMaterial* mat, const aiTextureType& type, const std::string& base_file_name, const std::string& directory, const ColorSpace& cspace) {
+    static TextureHandle LoadMaterialTexture(const aiScene* scene, aiMaterial* mat, const aiTextureType& type, const std::string& base_file_name, const std::string& directory, const ColorSpace& cspace, const TextureUsage usage) {
         TextureHandle texture;
         if (mat->GetTextureCount(type) > 0) {
             aiString str;
@@ -371,10 +807,10 @@ namespace stratus {
                 binaryData.data = writeData;
                 binaryData.sizeBytes = sizeBytes;// 4 * sizeBytes;
 
-                texture = ResourceManager::Instance()->LoadTexture(base_file_name + "/" + file, binaryData, cspace);
+                texture = ResourceManager::Instance()->LoadTexture(base_file_name + "/" + file, binaryData, cspace, usage);
             }
             else {
-                texture = ResourceManager::Instance()->LoadTexture(directory + "/" + file, cspace);
+                texture = ResourceManager::Instance()->LoadTexture(directory + "/" + file, cspace, usage);
             }
         }
 
@@ -690,9 +1126,9 @@ namespace stratus {
             //     STRATUS_LOG << "Transparency: " << transparency.r << ", " << transparency.g << ", " << transparency.b << ", " << transparency.a << std::endl;
             // }
 
-            material->SetDiffuseMap(LoadMaterialTexture(scene, aimat, aiTextureType_DIFFUSE, base_file_name, directory, cspace));
+            material->SetDiffuseMap(LoadMaterialTexture(scene, aimat, aiTextureType_DIFFUSE, base_file_name, directory, cspace, TextureUsage::ALBEDO));
             // Important: Unless the normal/depth maps were generated as sRGB textures, srgb must be set to false!
-            auto normalMap = LoadMaterialTexture(scene, aimat, aiTextureType_NORMALS, base_file_name, directory, ColorSpace::NONE);
+            auto normalMap = LoadMaterialTexture(scene, aimat, aiTextureType_NORMALS, base_file_name, directory, ColorSpace::NONE, TextureUsage::NORMAL_MAP);
             if (normalMap != TextureHandle::Null()) {
                 material->SetNormalMap(normalMap);
             }
@@ -700,13 +1136,13 @@ namespace stratus {
                 //m->SetNormalMap(LoadMaterialTexture(aimat, aiTextureType_HEIGHT, directory, ColorSpace::LINEAR));
             //}
             //m->SetDepthMap(LoadMaterialTexture(aimat, aiTextureType_HEIGHT, directory, ColorSpace::LINEAR));
-            material->SetRoughnessMap(LoadMaterialTexture(scene, aimat, aiTextureType_DIFFUSE_ROUGHNESS, base_file_name, directory, ColorSpace::NONE));
-            material->SetEmissiveMap(LoadMaterialTexture(scene, aimat, aiTextureType_EMISSIVE, base_file_name, directory, ColorSpace::NONE));
-            material->SetMetallicMap(LoadMaterialTexture(scene, aimat, aiTextureType_METALNESS, base_file_name, directory, ColorSpace::NONE));
+            material->SetRoughnessMap(LoadMaterialTexture(scene, aimat, aiTextureType_DIFFUSE_ROUGHNESS, base_file_name, directory, ColorSpace::NONE, TextureUsage::ROUGHNESS));
+            material->SetEmissiveMap(LoadMaterialTexture(scene, aimat, aiTextureType_EMISSIVE, base_file_name, directory, ColorSpace::NONE, TextureUsage::EMISSIVE));
+            material->SetMetallicMap(LoadMaterialTexture(scene, aimat, aiTextureType_METALNESS, base_file_name, directory, ColorSpace::NONE, TextureUsage::METALLIC));
             // GLTF 2.0 have the metallic-roughness map specified as aiTextureType_UNKNOWN at the time of writing
             // TODO: See if other file types encode metallic-roughness in the same way
             if (extension == "gltf" || extension == "GLTF" || extension == "glb" || extension == "GLB") {
-                material->SetMetallicRoughnessMap(LoadMaterialTexture(scene, aimat, aiTextureType_UNKNOWN, base_file_name, directory, ColorSpace::NONE));
+                material->SetMetallicRoughnessMap(LoadMaterialTexture(scene, aimat, aiTextureType_UNKNOWN, base_file_name, directory, ColorSpace::NONE, TextureUsage::METALLIC_ROUGHNESS));
             }
 
             // STRATUS_LOG << "m " 
@@ -813,6 +1249,33 @@ namespace stratus {
         }
     }
 
+    // Visits the entities with meshes in depth first order, stopping early if visit returns false
+    template<typename Visit>
+    static bool VisitRenderNodes(const EntityPtr& entity, u32& node, const Visit& visit) {
+        auto rc = entity->Components().GetComponent<RenderComponent>().component;
+        if (rc != nullptr) {
+            if (!visit(entity, rc, node)) return false;
+            ++node;
+        }
+
+        for (const EntityPtr& child : entity->GetChildNodes()) {
+            if (!VisitRenderNodes(child, node, visit)) return false;
+        }
+        return true;
+    }
+
+    EntityPtr ResourceManager::FindModelNode(const EntityPtr& model, const u32 node) {
+        if (model == nullptr) return nullptr;
+
+        EntityPtr found;
+        u32 index = 0;
+        VisitRenderNodes(model, index, [&found, node](const EntityPtr& entity, RenderComponent *, const u32 current) {
+            if (current == node) found = entity;
+            return current != node;
+        });
+        return found;
+    }
+
     EntityPtr ResourceManager::LoadModel_(const std::string& name, const ColorSpace& cspace, const bool optimizeGraph, RenderFaceCulling defaultCullMode) {
         STRATUS_LOG << "Attempting to load model: " << name << std::endl;
 
@@ -870,6 +1333,15 @@ namespace stratus {
         const auto path = std::filesystem::path(name);
         ProcessNode(scene->mRootNode, scene, e, aiMatrix4x4(), path.relative_path().string(), directory, extension, defaultCullMode, cspace, meshes);
 
+        u32 node = 0;
+        VisitRenderNodes(e, node, [&name, optimizeGraph, defaultCullMode](const EntityPtr&, RenderComponent * rc, const u32 current) {
+            rc->meshes->source.file = name;
+            rc->meshes->source.optimizeGraph = optimizeGraph;
+            rc->meshes->source.defaultCullMode = defaultCullMode;
+            rc->meshes->source.node = current;
+            return true;
+        });
+
         //for (auto& mesh : meshes) {
         //    ProcessMesh(mesh, scene, directory, extension, defaultCullMode, cspace);
         //}
@@ -914,24 +1386,146 @@ namespace stratus {
         return e->Copy();
     }
 
-    std::shared_ptr<ResourceManager::RawTextureData> ResourceManager::LoadTexture_(const std::vector<std::string>& files,
-        const std::vector<BinaryDataWrapper>& binaryData,
-        const TextureHandle handle,
-        const ColorSpace& cspace,
-        const TextureType type,
-        const TextureCoordinateWrapping wrap,
-        const TextureMinificationFilter min,
-        const TextureMagnificationFilter mag) {
+    // Returns the cooked version of the source image, either from the cache or by decoding + cooking it
+    // and adding the result to the cache. Returns nullptr if the source could not be read or decoded.
+    static CookedTexturePtr LoadOrCookTexture(const TextureCookCachePtr& cache, const u8 * source, const usize sizeBytes, const u64 sourceHash,
+                                              const ColorSpace& cspace, const TextureUsage usage, const float alphaCoverageThreshold) {
+        if (source == nullptr || sizeBytes == 0) return nullptr;
 
-        if (binaryData.size() > 0 && files.size() != binaryData.size()) {
-            STRATUS_ERROR << "Invalid file/data length combination" << std::endl;
-            return nullptr;
+        const bool srgb = cspace == ColorSpace::SRGB;
+        const u64 key = TextureCooker::ComputeKey(sourceHash, usage, srgb, alphaCoverageThreshold);
+        auto cooked = cache->Load(key);
+        if (cooked != nullptr) return cooked;
+
+        i32 width, height, numChannels;
+        u8 * pixels = stbi_load_from_memory(source, (i32)sizeBytes, &width, &height, &numChannels, 0);
+        if (pixels == nullptr) return nullptr;
+
+        cooked = TextureCooker::Cook(pixels, (u32)width, (u32)height, (u32)numChannels, usage, srgb, key, alphaCoverageThreshold);
+        stbi_image_free((void *)pixels);
+
+        if (cooked != nullptr && !cache->Store(*cooked)) {
+            STRATUS_WARN << "Unable to write cooked texture to " << cache->PathFor(key) << std::endl;
         }
+        return cooked;
+    }
+
+    bool ResourceManager::ReadTextureSources_(TextureLoadJob_& job, const TextureHandle handle) {
+        const std::vector<std::string>& files = job.files;
+        const std::vector<BinaryDataWrapper>& binaryData = job.data;
+
+        job.sources.resize(files.size());
+        job.sourceBytes = 0;
+        bool allRead = true;
+        for (usize index = 0; index < files.size(); ++index) {
+            std::string file = files[index];
+            std::replace(file.begin(), file.end(), '\\', '/');
+            if (binaryData.size() > 0) {
+                const char * bytes = (const char *)binaryData[index].data;
+                job.sources[index].assign(bytes, bytes + binaryData[index].sizeBytes);
+                delete[] binaryData[index].data;
+            }
+            else {
+                job.sources[index] = Filesystem::ReadBinary(file);
+            }
+
+            if (job.sources[index].size() == 0) {
+                STRATUS_ERROR << "Could not load texture: " << file << std::endl;
+                allRead = false;
+            }
+            job.sourceBytes += job.sources[index].size();
+        }
+        job.data.clear();
+        if (!allRead) return false;
+
+        job.sourceHash = TextureDedupTable::HashSources(job.sources);
+
+        // Identical bytes loaded with the same settings produce the same texture, so only the first
+        // handle to claim the content decodes it and the rest become aliases
+        TextureContentSettings settings;
+        settings.usage = job.usage;
+        settings.srgb = job.cspace == ColorSpace::SRGB;
+        settings.alphaCoverageThreshold = job.alphaCoverageThreshold;
+        settings.type = job.type;
+        settings.wrap = job.wrap;
+        settings.min = job.min;
+        settings.mag = job.mag;
+        const u64 contentKey = TextureDedupTable::ContentKey(job.sourceHash, settings);
+        job.aliasOf = ClaimTextureContent_(contentKey, handle, job.sourceBytes);
+        if (job.aliasOf == handle) {
+            job.aliasOf = TextureHandle::Null();
+        }
+        else {
+            STRATUS_LOG << "Texture " << files[0] << " has the same content as handle " << job.aliasOf << " (handle = " << handle << ")" << std::endl;
+            job.sources.clear();
+            return true;
+        }
+
+        // Header only - the decode stage needs to know how much memory it will take before it starts.
+        // 2D textures also hold their mip chain and the float copy the mip generator filters in.
+        job.decodedBytes = 0;
+        const bool generatesMips = job.type == TextureType::TEXTURE_2D && files.size() == 1;
+        for (const std::vector<char>& source : job.sources) {
+            i32 width, height, numChannels;
+            if (!stbi_info_from_memory((const u8 *)source.data(), (i32)source.size(), &width, &height, &numChannels)) continue;
+            const usize texels = usize(width) * usize(height);
+            job.decodedBytes += texels * usize(numChannels);
+            if (generatesMips) {
+                job.decodedBytes += texels * usize(numChannels) * 4 / 3 + texels * sizeof(glm::vec4) / 3;
+            }
+        }
+
+        return true;
+    }
+
+    std::shared_ptr<ResourceManager::RawTextureData> ResourceManager::LoadTexture_(TextureLoadJob_& job, const TextureHandle handle) {
+        const std::vector<std::string>& files = job.files;
+        std::vector<std::vector<char>>& sources = job.sources;
+        const ColorSpace cspace = job.cspace;
+        const TextureUsage usage = job.usage;
+        const TextureCookCachePtr& cookCache = job.cookCache;
+        const TextureType type = job.type;
 
         std::shared_ptr<RawTextureData> texdata = std::make_shared<RawTextureData>();
-        texdata->wrap = wrap;
-        texdata->min = min;
-        texdata->mag = mag;
+        texdata->wrap = job.wrap;
+        texdata->min = job.min;
+        texdata->mag = job.mag;
+
+        if (cookCache != nullptr && type == TextureType::TEXTURE_2D && files.size() == 1) {
+            std::string file = files[0];
+            std::replace(file.begin(), file.end(), '\\', '/');
+
+            CookedTexturePtr cooked = LoadOrCookTexture(cookCache, (const u8 *)sources[0].data(), sources[0].size(), job.sourceHash, cspace, usage, job.alphaCoverageThreshold);
+            if (cooked != nullptr) std::vector<std::vector<char>>().swap(sources);
+
+            if (cooked != nullptr) {
+                STRATUS_LOG << "Loaded cooked texture: " << file << " (handle = " << handle << ")" << std::endl;
+
+                TextureConfig config;
+                config.type = type;
+                config.format = cooked->Format();
+                config.storage = TextureComponentSize::BITS_DEFAULT;
+                config.dataType = TextureComponentType::UINT_NORM;
+                config.compression = cooked->compression;
+                config.width = cooked->width;
+                config.height = cooked->height;
+                config.depth = 0;
+                // The full chain was already generated by the cooker
+                config.generateMipMaps = false;
+
+                texdata->config = config;
+                texdata->handle = handle;
+                texdata->sizeBytes = cooked->SizeBytes();
+                texdata->cooked = cooked;
+                // Levels are read back from the cache file so it has to have made it to disk
+                texdata->streamed = job.allowStreaming && cooked->mips.size() > 1 && std::filesystem::exists(cookCache->PathFor(cooked->key));
+                texdata->cookCache = cookCache;
+                return texdata;
+            }
+
+            // Fall through to the uncompressed path below which will report any errors
+            STRATUS_WARN << "Unable to cook texture: " << file << std::endl;
+        }
 
 #define FREE_ALL_STBI_IMAGE_DATA for (uint8_t * ptr : texdata->data) stbi_image_free((void *)ptr);
 
@@ -945,12 +1539,9 @@ namespace stratus {
             // @see http://www.redbancosdealimentos.org/homes-flooring-design-sources
             u8* data = nullptr;
 
-            if (binaryData.size() > 0) {
-                data = stbi_load_from_memory(binaryData[index].data, (i32)binaryData[index].sizeBytes, &width, &height, &numChannels, 0);
-                delete[] binaryData[index].data;
-            }
-            else {
-                data = stbi_load(file.c_str(), &width, &height, &numChannels, 0);
+            if (sources[index].size() > 0) {
+                data = stbi_load_from_memory((const u8 *)sources[index].data(), (i32)sources[index].size(), &width, &height, &numChannels, 0);
+                std::vector<char>().swap(sources[index]);
             }
 
             if (data) {
@@ -1020,6 +1611,27 @@ namespace stratus {
 
 #undef FREE_ALL_STBI_IMAGE_DATA
 
+        // Build the mip chain here on the loading thread rather than having the driver do it
+        // after upload on the main thread
+        if (type == TextureType::TEXTURE_2D && texdata->data.size() == 1) {
+            const u32 numChannels = u32(texdata->sizeBytes / (usize(texdata->config.width) * usize(texdata->config.height)));
+            MipGenerationOptions options;
+            options.srgb = cspace == ColorSpace::SRGB;
+            options.normalMap = usage == TextureUsage::NORMAL_MAP;
+            options.alphaCoverageThreshold = job.alphaCoverageThreshold;
+            {
+                auto ul = LockWrite_();
+                textureLoadQueue_.SetStage(handle, TextureLoadStage::GENERATING_MIPS, job.sourceBytes + job.decodedBytes);
+            }
+            texdata->mips = MipGenerator::Generate(texdata->data[0], texdata->config.width, texdata->config.height, numChannels, options);
+
+            stbi_image_free((void *)texdata->data[0]);
+            texdata->data.clear();
+            texdata->config.generateMipMaps = false;
+            texdata->sizeBytes = 0;
+            for (const MipLevel& mip : texdata->mips) texdata->sizeBytes += mip.data.size();
+        }
+
         // auto ul = _LockWrite();
         // _loadedTextures.insert(std::make_pair(handle, Async<Texture>(*Engine::Instance()->GetMainThread(), [this, texdata]() {
         //     return _FinalizeTexture(*texdata);
@@ -1027,12 +1639,87 @@ namespace stratus {
         return texdata;
     }
 
-    Texture* ResourceManager::FinalizeTexture_(const RawTextureData& data) {
+    TextureHandle ResourceManager::ClaimTextureContent_(const u64 contentKey, const TextureHandle handle, const usize sourceBytes) {
+        auto ul = LockWrite_();
+        const TextureHandle owner = textureDedup_.Claim(contentKey, handle, sourceBytes);
+        if (owner != handle) {
+            // Resolves to the owner from now on, which may already be done
+            textureStatusChanges_.insert(handle);
+        }
+        return owner;
+    }
+
+    TextureHandle ResourceManager::ResolveTexture_(const TextureHandle handle) const {
+        return textureDedup_.Resolve(handle);
+    }
+
+    TextureDedupStats ResourceManager::GetTextureDedupStats() const {
+        auto sl = LockRead_();
+        return textureDedup_.Stats();
+    }
+
+    TextureArrayData ResourceManager::TextureUploadData_(const RawTextureData& data) {
         stratus::TextureArrayData texArrayData(data.data.size());
         for (usize i = 0; i < texArrayData.size(); ++i) {
             texArrayData[i].data = (const void*)data.data[i];
         }
+        // Mip views point into data which stays alive until after the upload
+        if (data.cooked != nullptr) {
+            texArrayData = stratus::TextureArrayData{ stratus::TextureData(data.cooked->MipData()) };
+        }
+        else if (data.mips.size() > 0) {
+            std::vector<TextureMipData> mips(data.mips.size());
+            for (usize i = 0; i < mips.size(); ++i) {
+                mips[i].data = (const void*)data.mips[i].data.data();
+                mips[i].width = data.mips[i].width;
+                mips[i].height = data.mips[i].height;
+                mips[i].sizeBytes = data.mips[i].data.size();
+            }
+            texArrayData = stratus::TextureArrayData{ stratus::TextureData(mips) };
+        }
+        return texArrayData;
+    }
+
+    Texture* ResourceManager::FinalizeTexture_(RawTextureData& data, const GpuBuffer& staging, const UploadSource& source) {
+        if (data.streamed) {
+            TextureConfig config = data.config;
+            config.virtualTexture = true;
+            config.virtualMipLevels = u32(data.cooked->mips.size());
+            Texture* texture = new Texture(config, TextureArrayData(), false);
+            texture->SetHandle_(data.handle);
+            texture->SetCoordinateWrapping(data.wrap);
+            texture->SetMinMagFilter(data.min, data.mag);
+
+            TexturePageLayout& layout = data.pageLayout;
+            layout.width = config.width;
+            layout.height = config.height;
+            layout.numMips = config.virtualMipLevels;
+            texture->GetVirtualPageInfo(layout.pageWidth, layout.pageHeight, layout.numSparseLevels);
+
+            // Only the mip tail is resident to begin with, the rest is streamed in on request
+            const std::vector<TextureMipData> mips = data.cooked->MipData();
+            for (u32 mip = layout.FirstTailMip(); mip < layout.numMips; ++mip) {
+                texture->CommitOrUncommitVirtualMip(mip, true);
+                texture->UploadMip(mip, mips[mip]);
+            }
+
+            return texture;
+        }
+
+        stratus::TextureArrayData texArrayData = TextureUploadData_(data);
+        if (source.staged) {
+            // Same order the data was written in, the pointers become offsets into the bound staging buffer
+            usize offset = source.offset;
+            ForEachTextureUpload(texArrayData, data.sizeBytes, [&offset](const void *& ptr, const usize bytes) {
+                ptr = (const void *)uintptr_t(offset);
+                offset += bytes;
+            });
+            staging.Bind(GpuBindingPoint::PIXEL_UNPACK_BUFFER);
+        }
         Texture* texture = new Texture(data.config, texArrayData, false);
+        if (source.staged) {
+            staging.Unbind(GpuBindingPoint::PIXEL_UNPACK_BUFFER);
+        }
         texture->SetHandle_(data.handle);
         texture->SetCoordinateWrapping(data.wrap);
         texture->SetMinMagFilter(data.min, data.mag);
@@ -7,11 +7,20 @@
 #include "StratusEntityCommon.h"
 #include "StratusRenderComponents.h"
 #include "StratusTexture.h"
+#include "StratusTextureCooker.h"
+#include "StratusMipGenerator.h"
+#include "StratusTextureStreaming.h"
+#include "StratusTextureLoadQueue.h"
+#include "StratusTextureDedup.h"
+#include "StratusUploadQueue.h"
+#include "StratusGpuBuffer.h"
+#include "StratusMetrics.h"
 #include "StratusSystemModule.h"
 #include "StratusAsync.h"
 #include <vector>
 #include <shared_mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include "StratusTypes.h"
 
 namespace stratus {
@@ -26,11 +35,31 @@ namespace stratus {
         LOADING_DONE
     };
 
+    // Everything a renderer needs to know about a texture in one lookup
+    struct TextureLookup {
+        Texture texture;
+        TextureLoadingStatus status = TextureLoadingStatus::FAILED;
+        // See ResourceManager::GetStreamedTextureMinMip
+        u32 minMip = 0;
+    };
+
+    // Receives every texture handle (including duplicate handles) whose loading status or streamed min mip
+    // changed since the previous call
+    typedef std::function<void (const std::unordered_set<TextureHandle>&)> TextureStatusCallback;
+
     struct BinaryDataWrapper {
         u8* data;
         usize sizeBytes;
     };
 
+    struct TextureScreenSize {
+        TextureHandle handle;
+        // Approximate size in pixels of what the texture is mapped onto
+        float pixels;
+        // Inside the view frustum
+        bool visible;
+    };
+
     SYSTEM_MODULE_CLASS(ResourceManager)
 private:
     struct RawTextureData {
@@ -41,6 +70,58 @@ private:
         TextureMagnificationFilter mag;
         size_t sizeBytes;
         std::vector<uint8_t*> data;
+        // Set instead of data when the texture went through the cooker
+        CookedTexturePtr cooked;
+        // Set instead of data for uncooked 2D textures so all levels are uploaded together
+        std::vector<MipLevel> mips;
+        // Cooked textures which are streamed in level by level from cookCache
+        bool streamed = false;
+        TextureCookCachePtr cookCache;
+        // Filled in by FinalizeTexture_ for streamed textures
+        TexturePageLayout pageLayout;
+    };
+
+    // Everything needed to load a texture. Filled in as it moves through the load stages.
+    struct TextureLoadJob_ {
+        std::vector<std::string> files;
+        std::vector<BinaryDataWrapper> data;
+        ColorSpace cspace;
+        TextureUsage usage;
+        TextureCookCachePtr cookCache;
+        float alphaCoverageThreshold;
+        bool allowStreaming;
+        TextureType type;
+        TextureCoordinateWrapping wrap;
+        TextureMinificationFilter min;
+        TextureMagnificationFilter mag;
+        // Filled in by the read stage
+        std::vector<std::vector<char>> sources;
+        u64 sourceHash = 0;
+        usize sourceBytes = 0;
+        // Estimated peak memory of the decode stage
+        usize decodedBytes = 0;
+        // Set when another handle already owns the same content
+        TextureHandle aliasOf;
+    };
+
+    typedef std::shared_ptr<TextureLoadJob_> TextureLoadJobPtr;
+
+    struct StreamedTexture_ {
+        Texture texture;
+        TextureCookCachePtr cache;
+        u64 key;
+        // Finest level with every coarser level uploaded. This is the finest level shaders may sample.
+        u32 uploadedMip;
+        std::vector<bool> uploaded;
+        // Bumped per level whenever a commit or uncommit is issued so stale reads can be dropped
+        std::vector<u32> generation;
+    };
+
+    struct PendingMipLoad_ {
+        TextureHandle handle;
+        u32 mip;
+        u32 generation;
+        Async<CookedMip> data;
     };
 
 public:
@@ -52,8 +133,10 @@ public:
     virtual ~ResourceManager();
 
     Async<Entity> LoadModel(const std::string&, const ColorSpace&, const bool optimizeGraph, RenderFaceCulling defaultCullMode = RenderFaceCulling::CULLING_CCW);
-    TextureHandle LoadTexture(const std::string&, const ColorSpace&);
-    TextureHandle LoadTexture(const std::string&, BinaryDataWrapper data, const ColorSpace&);
+    // Returns the entity of a loaded model which holds the mesh data for MeshSource::node, or nullptr
+    static EntityPtr FindModelNode(const EntityPtr& model, const u32 node);
+    TextureHandle LoadTexture(const std::string&, const ColorSpace&, const TextureUsage usage = TextureUsage::GENERIC);
+    TextureHandle LoadTexture(const std::string&, BinaryDataWrapper data, const ColorSpace&, const TextureUsage usage = TextureUsage::GENERIC);
     // prefix is used to select all faces with one string. It ends up expanding to:
     //      prefix + "right." + fileExt
     //      prefix + "left." + fileExt
@@ -61,6 +144,45 @@ public:
     //      prefix + "back." + fileExt
     TextureHandle LoadCubeMap(const std::string& prefix, const ColorSpace&, const std::string& fileExt = "jpg");
     Texture LookupTexture(const TextureHandle, TextureLoadingStatus&) const;
+    // Looks up a batch of textures under a single lock. Results are in the same order as handles.
+    void LookupTextures(const std::vector<TextureHandle>& handles, std::vector<TextureLookup>& results) const;
+
+    // Callbacks run on the application thread during Update, without the resource manager's lock held, so
+    // that textures which are still loading do not have to be polled. Returns an id for removing the callback.
+    u64 AddTextureStatusCallback(const TextureStatusCallback&);
+    void RemoveTextureStatusCallback(const u64 id);
+
+    // When enabled, 2D textures are block compressed with their full mip chain the first time they are
+    // loaded and the results are cached under cacheDirectory keyed by a hash of the source file.
+    // Only affects textures loaded after the call.
+    void SetTextureCooking(const bool enabled, const std::string& cacheDirectory = "CookedTextures");
+
+    // When enabled, cooked 2D textures are created as sparse textures with only their mip tail resident.
+    // Finer levels are read back from the cooked file as they are requested, keeping committed texture
+    // memory under budgetBytes. Requires texture cooking and only affects textures loaded after the call.
+    void SetTextureStreaming(const bool enabled, const usize budgetBytes = 512 * 1024 * 1024);
+    bool IsTextureStreamingEnabled() const;
+    // Called each frame with what the renderer can see. Drives both streaming and the order textures load in.
+    void RequestTextureScreenSizes(const std::vector<TextureScreenSize>&);
+    // Finest mip level that can be sampled. Always 0 for textures which are not streamed.
+    u32 GetStreamedTextureMinMip(const TextureHandle) const;
+    TextureStreamingStats GetTextureStreamingStats() const;
+
+    // Textures are deduplicated by a hash of their source bytes and load settings, so the same image
+    // referenced from different paths or models is only decoded and uploaded once
+    TextureDedupStats GetTextureDedupStats() const;
+
+    // Caps the memory held by texture loads in progress (sources, decoded images and mip chains waiting
+    // to be uploaded). Textures move through read -> decode -> mip generation -> upload as the budget allows,
+    // visible ones first.
+    void SetTextureLoadBudget(const usize budgetBytes);
+    TextureLoadStats GetTextureLoadStats() const;
+    bool IsLoadingTextures() const;
+
+    // Texture and mesh data is copied into staging memory on worker threads and the application thread
+    // only issues the GPU copies, as many per frame as fit in bytesPerFrame and msPerFrame
+    void SetUploadBudget(const usize bytesPerFrame, const f64 msPerFrame);
+    UploadQueueStats GetUploadStats() const;
 
     // Default shapes
     EntityPtr CreateCube();
@@ -85,19 +207,35 @@ private:
     TextureHandle LoadTextureImpl_(const std::vector<std::string>&,
         const std::vector<BinaryDataWrapper>&,
         const ColorSpace&,
+        const TextureUsage,
         const TextureType type = TextureType::TEXTURE_2D,
         const TextureCoordinateWrapping wrap = TextureCoordinateWrapping::REPEAT,
         const TextureMinificationFilter min = TextureMinificationFilter::LINEAR_MIPMAP_LINEAR,
         const TextureMagnificationFilter mag = TextureMagnificationFilter::LINEAR);
-    std::shared_ptr<RawTextureData> LoadTexture_(const std::vector<std::string>&,
-        const std::vector<BinaryDataWrapper>&,
-        const TextureHandle,
-        const ColorSpace&,
-        const TextureType type = TextureType::TEXTURE_2D,
-        const TextureCoordinateWrapping wrap = TextureCoordinateWrapping::REPEAT,
-        const TextureMinificationFilter min = TextureMinificationFilter::LINEAR_MIPMAP_LINEAR,
-        const TextureMagnificationFilter mag = TextureMagnificationFilter::LINEAR);
-    Texture* FinalizeTexture_(const RawTextureData&);
+    // Read stage. Returns false if any of the sources could not be read.
+    bool ReadTextureSources_(TextureLoadJob_&, const TextureHandle);
+    // Decode + mip stage
+    std::shared_ptr<RawTextureData> LoadTexture_(TextureLoadJob_&, const TextureHandle);
+    // Moves queued textures along as the load budget allows. Expects the write lock to be held.
+    void UpdateTextureLoads_();
+    // Views into the CPU data of a texture which is not streamed
+    static TextureArrayData TextureUploadData_(const RawTextureData&);
+    // Runs on the application thread. Pixel data is read from staging when source is staged.
+    Texture* FinalizeTexture_(RawTextureData&, const GpuBuffer& staging, const UploadSource& source);
+    // Runs on the application thread once the texture's upload comes up in the upload queue
+    void FinishTexture_(RawTextureData&, const GpuBuffer& staging, const UploadSource& source);
+    // Returns the handle which owns the content. This is handle itself the first time the content is seen.
+    TextureHandle ClaimTextureContent_(const u64 contentKey, const TextureHandle handle, const usize sourceBytes);
+    // Expects the lock to be held
+    TextureHandle ResolveTexture_(const TextureHandle) const;
+    TextureLookup LookupTexture_(const TextureHandle) const;
+    // Passes the status changes collected since the last call to the status callbacks
+    void NotifyTextureStatusChanges_();
+    // Streaming helpers expect the write lock to be held
+    void RegisterStreamedTexture_(const Texture&, const RawTextureData&);
+    void UpdateTextureStreaming_();
+    // Runs on the application thread
+    void FinishMipLoad_(const PendingMipLoad_&);
 
     void InitCube_();
     void InitQuad_();
@@ -111,9 +249,34 @@ private:
     std::unordered_set<MeshletPtr> generateMeshGpuDataQueue_;
     //std::vector<MeshPtr> _meshFinalizeQueue;
     std::unordered_map<TextureHandle, Async<RawTextureData>> asyncLoadedTextureData_;
+    // Jobs which have not started decoding yet
+    std::unordered_map<TextureHandle, TextureLoadJobPtr> textureLoadJobs_;
+    std::unordered_map<TextureHandle, Async<TextureLoadJob_>> asyncTextureReads_;
+    TextureLoadQueue textureLoadQueue_ = TextureLoadQueue(256 * 1024 * 1024);
     std::unordered_set<TextureHandle> texturesStillLoading_;
     std::unordered_map<TextureHandle, Async<Texture>> loadedTextures_;
     std::unordered_map<std::string, TextureHandle> loadedTexturesByFile_;
+    TextureDedupTable textureDedup_;
+    // Null when texture cooking is disabled
+    TextureCookCachePtr textureCookCache_ = std::make_shared<TextureCookCache>("CookedTextures");
+    // Null when texture streaming is disabled
+    std::unique_ptr<TextureStreamer> textureStreamer_;
+    std::unordered_map<TextureHandle, StreamedTexture_> streamedTextures_;
+    std::vector<PendingMipLoad_> pendingMipLoads_;
+    // Loads that finished or failed and streamed textures whose min mip changed, sent out once per Update
+    std::unordered_set<TextureHandle> textureStatusChanges_;
+    std::unordered_map<u64, TextureStatusCallback> textureStatusCallbacks_;
+    u64 nextTextureStatusCallback_ = 1;
+    // Created on initialize since they need the graphics context
+    GpuStagingBufferPtr stagingBuffer_;
+    UploadQueuePtr uploadQueue_;
     mutable std::shared_mutex mutex_;
+    MetricId modelsMetric_;
+    MetricId texturesMetric_;
+    MetricId texturesLoadingMetric_;
+    MetricId textureLoadBytesMetric_;
+    MetricId streamingResidentBytesMetric_;
+    MetricId uploadPendingCopiesMetric_;
+    MetricId uploadedBytesMetric_;
 };
 }
\ No newline at end of file
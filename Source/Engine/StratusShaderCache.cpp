@@ -0,0 +1,144 @@
+#include "StratusShaderCache.h"
+#include "StratusTextureCooker.h"
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <functional>
+
+namespace stratus {
+    static constexpr u32 programMagic = 0x50585453; // "STXP"
+
+    ShaderProgramCache::ShaderProgramCache(const std::string& directory)
+        : directory_(directory) {}
+
+    std::string ShaderProgramCache::PathFor(const u64 key) const {
+        std::stringstream path;
+        path << directory_ << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".stxp";
+        return path.str();
+    }
+
+    static u64 HashString(const std::string& value, const u64 seed) {
+        // Length first so that ("ab", "c") and ("a", "bc") do not collide
+        const u64 size = u64(value.size());
+        return TextureCooker::HashBytes(value.data(), value.size(), TextureCooker::HashBytes(&size, sizeof(size), seed));
+    }
+
+    u64 ShaderProgramCache::ComputeKey(const std::vector<ShaderStageSource>& stages,
+                                       const std::vector<std::pair<std::string, std::string>>& defines,
+                                       const std::string& driver) {
+        u64 hash = TextureCooker::HashBytes(&version, sizeof(version));
+        hash = HashString(driver, hash);
+        for (const auto& define : defines) {
+            hash = HashString(define.first, hash);
+            hash = HashString(define.second, hash);
+        }
+        for (const ShaderStageSource& stage : stages) {
+            hash = TextureCooker::HashBytes(&stage.type, sizeof(stage.type), hash);
+            hash = HashString(stage.source, hash);
+        }
+        return hash;
+    }
+
+    template<typename T>
+    static bool ReadValue(std::ifstream& file, T& value) {
+        file.read((char *)&value, sizeof(T));
+        return file.good();
+    }
+
+    template<typename T>
+    static void WriteValue(std::ofstream& file, const T& value) {
+        file.write((const char *)&value, sizeof(T));
+    }
+
+    bool ShaderProgramCache::Load(const u64 key, ShaderProgramBinary& out) const {
+        std::ifstream file(PathFor(key), std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            ++misses_;
+            return false;
+        }
+
+        u32 magic, fileVersion, format;
+        u64 fileKey, size;
+        const bool valid = ReadValue(file, magic) && magic == programMagic &&
+            ReadValue(file, fileVersion) && fileVersion == version &&
+            // The file name already encodes the key so this only fails for renamed or corrupt files
+            ReadValue(file, fileKey) && fileKey == key &&
+            ReadValue(file, format) && ReadValue(file, size);
+        if (!valid) {
+            ++misses_;
+            return false;
+        }
+
+        // Checked before allocating so that a corrupt size can't ask for more memory than the file holds
+        const std::streamoff dataStart = file.tellg();
+        file.seekg(0, std::ios::end);
+        const u64 remaining = u64(file.tellg() - dataStart);
+        file.seekg(dataStart);
+        if (size > remaining) {
+            file.close();
+            ++misses_;
+            Reject(key);
+            return false;
+        }
+
+        out.key = key;
+        out.format = format;
+        out.data.resize(usize(size));
+        file.read((char *)out.data.data(), std::streamsize(size));
+        if (usize(file.gcount()) != usize(size)) {
+            ++misses_;
+            return false;
+        }
+
+        ++hits_;
+        return true;
+    }
+
+    bool ShaderProgramCache::Store(const ShaderProgramBinary& binary) const {
+        std::error_code error;
+        std::filesystem::create_directories(directory_, error);
+        if (error) return false;
+
+        // Write to a temporary file first so that concurrent loaders never see a partial file
+        const std::string path = PathFor(binary.key);
+        const std::string tmp = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) return false;
+            WriteValue(file, programMagic);
+            WriteValue(file, version);
+            WriteValue(file, binary.key);
+            WriteValue(file, binary.format);
+            WriteValue(file, u64(binary.data.size()));
+            file.write((const char *)binary.data.data(), std::streamsize(binary.data.size()));
+            if (!file.good()) return false;
+        }
+
+        std::filesystem::rename(tmp, path, error);
+        if (error) {
+            std::filesystem::remove(tmp, error);
+            return false;
+        }
+
+        ++stores_;
+        return true;
+    }
+
+    void ShaderProgramCache::Reject(const u64 key) const {
+        ++rejected_;
+        std::error_code error;
+        std::filesystem::remove(PathFor(key), error);
+    }
+
+    ShaderProgramCacheStats ShaderProgramCache::Stats() const {
+        ShaderProgramCacheStats stats;
+        stats.hits = hits_.load();
+        stats.misses = misses_.load();
+        stats.rejected = rejected_.load();
+        stats.stores = stores_.load();
+        return stats;
+    }
+}
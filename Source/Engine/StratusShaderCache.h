@@ -0,0 +1,71 @@
+#pragma once
+
+#include "StratusTypes.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stratus {
+    // Linked program as returned by glGetProgramBinary
+    struct ShaderProgramBinary {
+        // See ShaderProgramCache::ComputeKey
+        u64 key = 0;
+        // Driver specific format that has to be passed back to glProgramBinary
+        u32 format = 0;
+        std::vector<u8> data;
+    };
+
+    struct ShaderProgramCacheStats {
+        u64 hits = 0;
+        u64 misses = 0;
+        // Entries the driver refused to load even though the key matched, or which were corrupt
+        u64 rejected = 0;
+        u64 stores = 0;
+    };
+
+    // One preprocessed stage of a program. type is whatever the caller uses to tell stages apart.
+    struct ShaderStageSource {
+        u32 type;
+        std::string source;
+    };
+
+    // On-disk cache of linked shader programs. The key covers the fully preprocessed source of every stage
+    // (so edits to any include are picked up), the defines and the driver, so stale entries are never looked
+    // up - changing any of them just produces a new key.
+    //
+    // Safe to use from multiple threads.
+    class ShaderProgramCache {
+    public:
+        // Bumped whenever the file layout changes so old entries are ignored
+        static constexpr u32 version = 1;
+
+        ShaderProgramCache(const std::string& directory);
+
+        const std::string& Directory() const { return directory_; }
+        std::string PathFor(const u64 key) const;
+
+        // driver should identify the exact driver build (renderer + version string)
+        static u64 ComputeKey(const std::vector<ShaderStageSource>& stages,
+                              const std::vector<std::pair<std::string, std::string>>& defines,
+                              const std::string& driver);
+
+        // Returns false on a miss. Entries whose size is larger than the file are rejected.
+        bool Load(const u64 key, ShaderProgramBinary& out) const;
+        bool Store(const ShaderProgramBinary&) const;
+        // Called when the driver rejects a binary (or Load finds it corrupt) so it is rebuilt next time
+        void Reject(const u64 key) const;
+
+        ShaderProgramCacheStats Stats() const;
+
+    private:
+        std::string directory_;
+        mutable std::atomic<u64> hits_{ 0 };
+        mutable std::atomic<u64> misses_{ 0 };
+        mutable std::atomic<u64> rejected_{ 0 };
+        mutable std::atomic<u64> stores_{ 0 };
+    };
+
+    typedef std::shared_ptr<ShaderProgramCache> ShaderProgramCachePtr;
+}
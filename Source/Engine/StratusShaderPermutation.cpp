@@ -0,0 +1,70 @@
+#include "StratusShaderPermutation.h"
+#include <stdexcept>
+
+namespace stratus {
+    static u64 FieldMask(const u32 bits) {
+        return bits >= 64 ? ~u64(0) : (u64(1) << bits) - 1;
+    }
+
+    ShaderFeatureSet::ShaderFeatureSet(const std::vector<ShaderFeature>& features) {
+        u32 shift = 0;
+        for (const ShaderFeature& feature : features) {
+            if (feature.numValues < 2) {
+                throw std::runtime_error("Shader feature needs at least 2 values: " + feature.define);
+            }
+
+            u32 bits = 1;
+            while ((u64(1) << bits) < u64(feature.numValues)) ++bits;
+            if (shift + bits > 64) {
+                throw std::runtime_error("Shader features do not fit in a 64 bit variant key");
+            }
+
+            features_.push_back(Field_{ feature, shift, bits });
+            shift += bits;
+        }
+    }
+
+    ShaderVariantKey ShaderFeatureSet::Set(const ShaderVariantKey key, const usize feature, const u32 value) const {
+        if (feature >= features_.size() || value >= features_[feature].feature.numValues) {
+            throw std::runtime_error("Shader feature value out of range");
+        }
+
+        const Field_& field = features_[feature];
+        const u64 mask = FieldMask(field.bits) << field.shift;
+        return (key & ~mask) | (u64(value) << field.shift);
+    }
+
+    u32 ShaderFeatureSet::Get(const ShaderVariantKey key, const usize feature) const {
+        const Field_& field = features_[feature];
+        return u32((key >> field.shift) & FieldMask(field.bits));
+    }
+
+    bool ShaderFeatureSet::IsValid(const ShaderVariantKey key) const {
+        u32 used = 0;
+        for (usize i = 0; i < features_.size(); ++i) {
+            if (Get(key, i) >= features_[i].feature.numValues) return false;
+            used += features_[i].bits;
+        }
+        return (key & ~FieldMask(used)) == 0;
+    }
+
+    u64 ShaderFeatureSet::NumVariants() const {
+        u64 result = 1;
+        for (const Field_& field : features_) result *= u64(field.feature.numValues);
+        return result;
+    }
+
+    std::vector<std::pair<std::string, std::string>> ShaderFeatureSet::Defines(const ShaderVariantKey key) const {
+        std::vector<std::pair<std::string, std::string>> result;
+        for (usize i = 0; i < features_.size(); ++i) {
+            const u32 value = Get(key, i);
+            if (features_[i].feature.numValues == 2) {
+                if (value != 0) result.push_back(std::make_pair(features_[i].feature.define, std::string("1")));
+            }
+            else {
+                result.push_back(std::make_pair(features_[i].feature.define, std::to_string(value)));
+            }
+        }
+        return result;
+    }
+}
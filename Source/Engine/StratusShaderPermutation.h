@@ -0,0 +1,49 @@
+#pragma once
+
+#include "StratusTypes.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stratus {
+    // Identifies one permutation of a pipeline - each feature's value packed into its own bits (see ShaderFeatureSet)
+    typedef u64 ShaderVariantKey;
+
+    struct ShaderFeature {
+        // Name of the #define the shader checks
+        std::string define;
+        // 2 for on/off features, which are only defined when on. Features with more values are always defined
+        // with the value as a number (0 to numValues - 1).
+        u32 numValues = 2;
+    };
+
+    // Maps variant keys to the defines each one is compiled with. Features are addressed by their index
+    // in the list passed to the constructor.
+    class ShaderFeatureSet {
+    public:
+        // Throws if a feature has fewer than 2 values or the features need more than 64 bits
+        ShaderFeatureSet(const std::vector<ShaderFeature>& features = {});
+
+        usize Size() const { return features_.size(); }
+        const ShaderFeature& Feature(const usize index) const { return features_[index].feature; }
+
+        // Returns key with the feature changed to value. Throws if either is out of range.
+        ShaderVariantKey Set(const ShaderVariantKey key, const usize feature, const u32 value) const;
+        u32 Get(const ShaderVariantKey key, const usize feature) const;
+        // False if the key has bits outside of the features or a value past the end of its feature
+        bool IsValid(const ShaderVariantKey key) const;
+        // Total number of variants the features can produce
+        u64 NumVariants() const;
+
+        std::vector<std::pair<std::string, std::string>> Defines(const ShaderVariantKey key) const;
+
+    private:
+        struct Field_ {
+            ShaderFeature feature;
+            u32 shift;
+            u32 bits;
+        };
+
+        std::vector<Field_> features_;
+    };
+}
@@ -0,0 +1,212 @@
+#include "StratusShaderPreprocessor.h"
+#include "StratusUtils.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace stratus {
+    DiskShaderSourceFiles::DiskShaderSourceFiles(const std::filesystem::path& root)
+        : root_(root) {}
+
+    bool DiskShaderSourceFiles::Read(const std::string& file, std::string& out) {
+        std::ifstream stream(root_ / file);
+        if (!stream.is_open()) return false;
+        std::stringstream buffer;
+        buffer << stream.rdbuf();
+        out = buffer.str();
+        return true;
+    }
+
+    i64 DiskShaderSourceFiles::LastModified(const std::string& file) {
+        std::error_code error;
+        const auto time = std::filesystem::last_write_time(root_ / file, error);
+        if (error) return 0;
+        return i64(time.time_since_epoch().count());
+    }
+
+    ShaderPreprocessor::ShaderPreprocessor(const ShaderSourceFilesPtr& files)
+        : files_(files) {}
+
+    ShaderPreprocessor::FilePtr_ ShaderPreprocessor::Parse_(const std::string& source) {
+        auto result = std::make_shared<File_>();
+
+        usize textBegin = 0;
+        for (usize lineBegin = 0; lineBegin < source.size();) {
+            usize lineEnd = source.find('\n', lineBegin);
+            if (lineEnd == std::string::npos) lineEnd = source.size();
+
+            // Leading whitespace stays with the text before the include
+            usize directive = lineBegin;
+            while (directive < lineEnd && (source[directive] == ' ' || source[directive] == '\t')) ++directive;
+
+            if (source.compare(directive, 8, "#include") == 0) {
+                const usize open = source.find('\"', directive);
+                const usize close = open < lineEnd ? source.find('\"', open + 1) : std::string::npos;
+                if (close < lineEnd) {
+                    result->text.push_back(source.substr(textBegin, directive - textBegin));
+                    result->includes.push_back(source.substr(open + 1, close - open - 1));
+                    // Everything after the include on the same line is dropped, the newline is kept
+                    textBegin = lineEnd;
+                }
+            }
+
+            lineBegin = lineEnd + 1;
+        }
+        result->text.push_back(source.substr(std::min(textBegin, source.size())));
+
+        return result;
+    }
+
+    ShaderPreprocessor::FilePtr_ ShaderPreprocessor::Get_(const std::string& file, u64& version) {
+        {
+            auto ul = std::unique_lock<std::mutex>(m_);
+            Entry_& entry = entries_[file];
+            version = entry.version;
+            if (entry.parsed != nullptr) {
+                ++stats_.cacheHits;
+                return entry.parsed;
+            }
+            ++stats_.fileReads;
+        }
+
+        // Read outside of the lock so that pipelines can be preprocessed in parallel. The timestamp is taken first
+        // so that a write during the read shows up in the next PollChanges.
+        const i64 lastModified = files_->LastModified(file);
+        std::string source;
+        const bool read = files_->Read(file, source);
+        FilePtr_ parsed = read ? Parse_(source) : nullptr;
+
+        auto ul = std::unique_lock<std::mutex>(m_);
+        Entry_& entry = entries_[file];
+        // Only cache if nothing changed in the meantime
+        if (entry.version == version) {
+            entry.lastModified = read ? lastModified : 0;
+            entry.parsed = parsed;
+        }
+        return parsed;
+    }
+
+    bool ShaderPreprocessor::Expand_(const std::string& file,
+                                     std::unordered_set<std::string>& seen,
+                                     PreprocessedShader& out,
+                                     std::string& error) {
+        u64 version;
+        const FilePtr_ parsed = Get_(file, version);
+        out.files.push_back(std::make_pair(file, version));
+        if (parsed == nullptr) {
+            error = "[error] Unable to read shader: " + file + "\n";
+            return false;
+        }
+
+        for (usize i = 0; i < parsed->includes.size(); ++i) {
+            out.source += parsed->text[i];
+            const std::string& include = parsed->includes[i];
+            if (seen.insert(include).second) {
+                if (!Expand_(include, seen, out, error)) return false;
+            }
+        }
+        out.source += parsed->text.back();
+
+        return true;
+    }
+
+    bool ShaderPreprocessor::Preprocess(const std::string& file,
+                                        const std::string& versionTag,
+                                        const std::vector<std::pair<std::string, std::string>>& defines,
+                                        PreprocessedShader& out,
+                                        std::string& error) {
+        out.source.clear();
+        out.files.clear();
+
+        // The shader itself counts as seen so include cycles back to it are dropped
+        std::unordered_set<std::string> seen{ file };
+        if (!Expand_(file, seen, out, error)) return false;
+
+        ReplaceFirst(out.source, "STRATUS_GLSL_VERSION", versionTag + "\n\nSTRATUS_GLSL_DEFINES");
+        ReplaceAll(out.source, "STRATUS_GLSL_VERSION", "");
+        // Build the define list
+        std::string defineList;
+        for (const auto& define : defines) {
+            defineList += "#define " + define.first + " " + define.second + "\n";
+        }
+        ReplaceFirst(out.source, "STRATUS_GLSL_DEFINES", defineList);
+
+        return true;
+    }
+
+    std::vector<std::string> ShaderPreprocessor::PollChanges() {
+        std::vector<std::pair<std::string, i64>> seen;
+        {
+            auto ul = std::unique_lock<std::mutex>(m_);
+            seen.reserve(entries_.size());
+            for (const auto& entry : entries_) seen.push_back(std::make_pair(entry.first, entry.second.lastModified));
+        }
+
+        // Timestamps are checked without holding the lock
+        std::vector<std::pair<std::string, i64>> changed;
+        for (const auto& file : seen) {
+            const i64 lastModified = files_->LastModified(file.first);
+            if (lastModified != file.second) changed.push_back(std::make_pair(file.first, lastModified));
+        }
+
+        std::vector<std::string> result;
+        auto ul = std::unique_lock<std::mutex>(m_);
+        for (const auto& file : changed) {
+            Entry_& entry = entries_[file.first];
+            entry.parsed = nullptr;
+            entry.lastModified = file.second;
+            ++entry.version;
+            result.push_back(file.first);
+        }
+
+        return result;
+    }
+
+    u64 ShaderPreprocessor::Version(const std::string& file) const {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        auto it = entries_.find(file);
+        return it == entries_.end() ? 1 : it->second.version;
+    }
+
+    bool ShaderPreprocessor::IsStale(const std::vector<std::pair<std::string, u64>>& files) const {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        for (const auto& file : files) {
+            auto it = entries_.find(file.first);
+            const u64 version = it == entries_.end() ? 1 : it->second.version;
+            if (version != file.second) return true;
+        }
+        return false;
+    }
+
+    std::unordered_set<std::string> ShaderPreprocessor::Dependents(const std::vector<std::string>& files) const {
+        auto ul = std::unique_lock<std::mutex>(m_);
+
+        // Reverse the include edges of everything that is currently parsed
+        std::unordered_map<std::string, std::vector<const std::string *>> includedBy;
+        for (const auto& entry : entries_) {
+            if (entry.second.parsed == nullptr) continue;
+            for (const std::string& include : entry.second.parsed->includes) {
+                includedBy[include].push_back(&entry.first);
+            }
+        }
+
+        std::unordered_set<std::string> result(files.begin(), files.end());
+        std::vector<std::string> next(files.begin(), files.end());
+        while (next.size() > 0) {
+            const std::string file = std::move(next.back());
+            next.pop_back();
+            auto it = includedBy.find(file);
+            if (it == includedBy.end()) continue;
+            for (const std::string * user : it->second) {
+                if (result.insert(*user).second) next.push_back(*user);
+            }
+        }
+
+        return result;
+    }
+
+    ShaderPreprocessorStats ShaderPreprocessor::Stats() const {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        return stats_;
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "StratusTypes.h"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace stratus {
+    // Where shader sources come from - the shader directory on disk, or memory in tests. File names are
+    // relative to the shader root. Must be safe to call from multiple threads.
+    class ShaderSourceFiles {
+    public:
+        virtual ~ShaderSourceFiles() = default;
+
+        // Returns false if the file can not be read
+        virtual bool Read(const std::string& file, std::string& out) = 0;
+        // Anything which changes whenever the file does, 0 if the file does not exist
+        virtual i64 LastModified(const std::string& file) = 0;
+    };
+
+    typedef std::shared_ptr<ShaderSourceFiles> ShaderSourceFilesPtr;
+
+    class DiskShaderSourceFiles : public ShaderSourceFiles {
+    public:
+        DiskShaderSourceFiles(const std::filesystem::path& root);
+
+        bool Read(const std::string& file, std::string& out) override;
+        i64 LastModified(const std::string& file) override;
+
+    private:
+        std::filesystem::path root_;
+    };
+
+    struct PreprocessedShader {
+        std::string source;
+        // Every file that went into source (the shader itself first) along with the version of it that was used.
+        // Includes files which could not be read so that they are picked up once they exist.
+        std::vector<std::pair<std::string, u64>> files;
+    };
+
+    struct ShaderPreprocessorStats {
+        u64 fileReads = 0;
+        u64 cacheHits = 0;
+    };
+
+    // Expands #include "file" lines and the STRATUS_GLSL_VERSION/STRATUS_GLSL_DEFINES markers. Files are read
+    // and split around their include lines once, then kept in memory, so expanding a shader is a single pass
+    // over its include tree. The include lines make up a dependency graph which is used to find out what has
+    // to be rebuilt when a file changes.
+    //
+    // Thread safe.
+    class ShaderPreprocessor {
+    public:
+        ShaderPreprocessor(const ShaderSourceFilesPtr& files);
+
+        // Each file is expanded at most once per shader - later includes of a file which was already expanded
+        // are dropped. Returns false and sets error if any file is missing.
+        bool Preprocess(const std::string& file,
+                        const std::string& versionTag,
+                        const std::vector<std::pair<std::string, std::string>>& defines,
+                        PreprocessedShader& out,
+                        std::string& error);
+
+        // Checks every file seen so far for changes. Changed files are dropped from the cache and their version
+        // is bumped. Returns the changed files.
+        std::vector<std::string> PollChanges();
+        // Starts at 1 and goes up each time the file changes
+        u64 Version(const std::string& file) const;
+        // True if any of the files changed after the recorded version was used
+        bool IsStale(const std::vector<std::pair<std::string, u64>>& files) const;
+        // files along with every cached file that includes one of them, directly or indirectly
+        std::unordered_set<std::string> Dependents(const std::vector<std::string>& files) const;
+
+        ShaderPreprocessorStats Stats() const;
+
+    private:
+        // Source split around its include lines: text[0] includes[0] text[1] ... includes[n - 1] text[n]
+        struct File_ {
+            std::vector<std::string> text;
+            std::vector<std::string> includes;
+        };
+
+        typedef std::shared_ptr<const File_> FilePtr_;
+
+        struct Entry_ {
+            // Null if the file could not be read or changed since it was last read
+            FilePtr_ parsed;
+            i64 lastModified = 0;
+            u64 version = 1;
+        };
+
+        static FilePtr_ Parse_(const std::string& source);
+        // Returns null if the file can not be read
+        FilePtr_ Get_(const std::string& file, u64& version);
+        bool Expand_(const std::string& file,
+                     std::unordered_set<std::string>& seen,
+                     PreprocessedShader& out,
+                     std::string& error);
+
+    private:
+        mutable std::mutex m_;
+        ShaderSourceFilesPtr files_;
+        std::unordered_map<std::string, Entry_> entries_;
+        ShaderPreprocessorStats stats_;
+    };
+
+    typedef std::shared_ptr<ShaderPreprocessor> ShaderPreprocessorPtr;
+}
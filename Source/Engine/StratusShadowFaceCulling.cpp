@@ -0,0 +1,113 @@
+#include "StratusShadowFaceCulling.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace stratus {
+    uint32_t PointShadowFaceMask::NumFacesWithCasters() const {
+        uint32_t count = 0;
+        for (uint32_t face = 0; face < numFaces; ++face) {
+            if (FaceHasCasters(face)) ++count;
+        }
+        return count;
+    }
+
+    uint32_t PointShadowFaceMask::NumCasters() const {
+        uint32_t count = 0;
+        for (uint32_t face = 0; face < numFaces; ++face) {
+            count += casterCounts[face];
+        }
+        return count;
+    }
+
+    void PointShadowFaceCulling::ComputeFaceViews(const glm::vec3& lightPosition, glm::mat4 views[6]) {
+        //                    pos            pos + dir                                       up
+        views[0] = glm::lookAt(lightPosition, lightPosition + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+        views[1] = glm::lookAt(lightPosition, lightPosition + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+        views[2] = glm::lookAt(lightPosition, lightPosition + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f));
+        views[3] = glm::lookAt(lightPosition, lightPosition + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f));
+        views[4] = glm::lookAt(lightPosition, lightPosition + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+        views[5] = glm::lookAt(lightPosition, lightPosition + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+    }
+
+    void PointShadowFaceCulling::ComputeFrustumPlanes(const glm::mat4& viewProj, glm::vec4 planes[6]) {
+        const glm::mat4 vpt = glm::transpose(viewProj);
+        planes[0] = vpt[3] + vpt[0];
+        planes[1] = vpt[3] - vpt[0];
+        planes[2] = vpt[3] + vpt[1];
+        planes[3] = vpt[3] - vpt[1];
+        planes[4] = vpt[3] + vpt[2];
+        planes[5] = vpt[3] - vpt[2];
+    }
+
+    // Matches isAabbVisible from aabb.glsl - the box is culled if all 8 corners are behind any one plane
+    static bool IsBoxInFrustum(const glm::vec3& vmin, const glm::vec3& vmax, const glm::vec4 planes[6]) {
+        for (int i = 0; i < 6; ++i) {
+            const glm::vec4& g = planes[i];
+            // Only the corner furthest along the plane normal needs to be checked
+            const glm::vec3 positive(g.x >= 0.0f ? vmax.x : vmin.x,
+                                     g.y >= 0.0f ? vmax.y : vmin.y,
+                                     g.z >= 0.0f ? vmax.z : vmin.z);
+            if (glm::dot(g, glm::vec4(positive, 1.0f)) < 0.0f) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static float DistanceSquaredToBox(const glm::vec3& point, const glm::vec3& vmin, const glm::vec3& vmax) {
+        const glm::vec3 d = glm::max(vmin - point, glm::max(glm::vec3(0.0f), point - vmax));
+        return glm::dot(d, d);
+    }
+
+    void PointShadowFaceCulling::AccumulateCasters(
+        const glm::vec3& lightPosition,
+        const float lightRadius,
+        const glm::mat4 * viewProj,
+        const std::vector<GpuAABB>& worldAabbs,
+        PointShadowFaceMask& mask) {
+
+        glm::vec4 planes[PointShadowFaceMask::numFaces][6];
+        for (uint32_t face = 0; face < PointShadowFaceMask::numFaces; ++face) {
+            ComputeFrustumPlanes(viewProj[face], planes[face]);
+        }
+
+        const float radiusSquared = lightRadius * lightRadius;
+        for (const GpuAABB& aabb : worldAabbs) {
+            const glm::vec3 vmin = glm::vec3(aabb.vmin.ToVec4());
+            const glm::vec3 vmax = glm::vec3(aabb.vmax.ToVec4());
+
+            if (DistanceSquaredToBox(lightPosition, vmin, vmax) > radiusSquared) continue;
+
+            for (uint32_t face = 0; face < PointShadowFaceMask::numFaces; ++face) {
+                if (IsBoxInFrustum(vmin, vmax, planes[face])) {
+                    mask.mask |= 1u << face;
+                    ++mask.casterCounts[face];
+                }
+            }
+        }
+    }
+
+    GpuAABB PointShadowFaceCulling::TransformAabb(const GpuAABB& aabb, const glm::mat4& transform) {
+        const glm::vec3 vmin = glm::vec3(aabb.vmin.ToVec4());
+        const glm::vec3 vmax = glm::vec3(aabb.vmax.ToVec4());
+
+        glm::vec3 resultMin(std::numeric_limits<float>::max());
+        glm::vec3 resultMax(std::numeric_limits<float>::lowest());
+        for (int corner = 0; corner < 8; ++corner) {
+            const glm::vec4 local((corner & 1) ? vmax.x : vmin.x,
+                                  (corner & 2) ? vmax.y : vmin.y,
+                                  (corner & 4) ? vmax.z : vmin.z,
+                                  1.0f);
+            const glm::vec3 world = glm::vec3(transform * local);
+            resultMin = glm::min(resultMin, world);
+            resultMax = glm::max(resultMax, world);
+        }
+
+        GpuAABB result;
+        result.vmin = glm::vec4(resultMin, 1.0f);
+        result.vmax = glm::vec4(resultMax, 1.0f);
+        return result;
+    }
+}
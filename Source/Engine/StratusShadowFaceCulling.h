@@ -0,0 +1,60 @@
+#pragma once
+
+#include "StratusGpuCommon.h"
+#include "glm/glm.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace stratus {
+    // Per cube face caster information for a single point light shadow update
+    struct PointShadowFaceMask {
+        static constexpr uint32_t numFaces = 6;
+
+        // Bit i is set if face i has at least one caster
+        uint32_t mask = 0;
+        uint32_t casterCounts[numFaces] = { 0, 0, 0, 0, 0, 0 };
+
+        bool FaceHasCasters(const size_t face) const { return (mask >> face) & 1; }
+        // True if the light does not see any geometry
+        bool Empty() const { return mask == 0; }
+        uint32_t NumFacesWithCasters() const;
+        uint32_t NumCasters() const;
+    };
+
+    // Running totals, reset once per frame by the renderer
+    struct PointShadowCullingStats {
+        // Cube faces whose geometry passes were skipped because they had no casters
+        uint64_t facesSkipped = 0;
+        // Cube faces which were rendered
+        uint64_t facesRendered = 0;
+        // Lights whose whole shadow update was skipped because no face had casters
+        uint64_t lightsSkipped = 0;
+    };
+
+    // CPU pre-pass for point light shadows. Tests world space caster bounds against the six
+    // light face frusta (the same test viscull_point_lights.cs performs per draw call) so that the
+    // renderer knows up front which faces are empty.
+    class PointShadowFaceCulling {
+    public:
+        // View matrices for the 6 cube faces of a light at lightPosition, ordered +X, -X, +Y, -Y, +Z, -Z
+        static void ComputeFaceViews(const glm::vec3& lightPosition, glm::mat4 views[6]);
+
+        // Extracts world space frustum planes the same way viscull_point_lights.cs does
+        static void ComputeFrustumPlanes(const glm::mat4& viewProj, glm::vec4 planes[6]);
+
+        // Adds the casters in worldAabbs to the mask. Boxes outside of the light's radius are rejected
+        // before any plane tests.
+        //
+        // viewProj must point to 6 face matrices ordered +X, -X, +Y, -Y, +Z, -Z
+        static void AccumulateCasters(
+            const glm::vec3& lightPosition,
+            const float lightRadius,
+            const glm::mat4 * viewProj,
+            const std::vector<GpuAABB>& worldAabbs,
+            PointShadowFaceMask& mask
+        );
+
+        // Transforms a local space box by the given model matrix and returns its world space bounds
+        static GpuAABB TransformAabb(const GpuAABB& aabb, const glm::mat4& transform);
+    };
+}
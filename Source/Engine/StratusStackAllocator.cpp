@@ -0,0 +1,218 @@
+#include "StratusStackAllocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace stratus {
+	static usize AlignUp(const usize bytes) {
+		return (bytes + FrameArena::Alignment - 1) & ~(FrameArena::Alignment - 1);
+	}
+
+	static std::atomic<u64> nextFrameArenaId(1);
+
+	StackAllocator::StackAllocator(const std::shared_ptr<FrameArenaLink_>& link)
+		: arena_(link->arena), link_(link) {}
+
+	StackAllocator::~StackAllocator() {
+		if (link_ != nullptr) {
+			// The memory belongs to the arena
+			std::unique_lock<std::mutex> ul(link_->mutex);
+			auto& subArenas = link_->subArenas;
+			subArenas.erase(std::remove(subArenas.begin(), subArenas.end(), this), subArenas.end());
+			return;
+		}
+
+		for (uint8_t * block : chained_) std::free((void *)block);
+		std::free((void *)start_);
+	}
+
+	void * StackAllocator::AllocateSlow_(const size_t bytes) {
+		if (arena_ != nullptr) {
+			arena_->Refill_(*this, bytes);
+		}
+		else if (growable_) {
+			// Keep the full block around until Deallocate since its memory is still in use
+			const size_t capacity = size_t(end_ - start_);
+			const size_t blockBytes = std::max(bytes, std::max<size_t>(capacity * 2, 1024));
+			uint8_t * block = (uint8_t *)std::malloc(blockBytes);
+			if (block == nullptr) throw std::bad_alloc();
+			chained_.push_back(start_);
+			chainedBytes_ += capacity;
+			start_ = block;
+			end_ = block + blockBytes;
+			current_ = block;
+		}
+		else {
+			throw std::bad_alloc();
+		}
+
+		uint8_t * memory = current_;
+		current_ = current_ + bytes;
+		return reinterpret_cast<void *>(memory);
+	}
+
+	void StackAllocator::Deallocate() {
+		if (link_ != nullptr) {
+			// Whatever is left of the chunk is given up - the arena gets it all back at the end of the frame
+			start_ = end_ = current_ = nullptr;
+			return;
+		}
+
+		// Swap the chain for one block which fits everything
+		if (chained_.size() > 0) {
+			const size_t capacity = Capacity();
+			for (uint8_t * block : chained_) std::free((void *)block);
+			chained_.clear();
+			chainedBytes_ = 0;
+			std::free((void *)start_);
+			start_ = (uint8_t *)std::malloc(capacity);
+			end_ = start_ + capacity;
+		}
+		current_ = start_;
+	}
+
+	FrameArena::FrameArena(const usize initialBytes, const usize chunkBytes)
+		: id_(nextFrameArenaId.fetch_add(1)),
+		  chunkBytes_(AlignUp(std::max<usize>(chunkBytes, Alignment))),
+		  link_(std::make_shared<FrameArenaLink_>()),
+		  minCapacity_(initialBytes) {
+		link_->arena = this;
+		Resize_(initialBytes);
+	}
+
+	FrameArena::~FrameArena() {
+		{
+			// Sub-arenas still held by threads become empty and can't allocate
+			std::unique_lock<std::mutex> ul(link_->mutex);
+			for (StackAllocator * subArena : link_->subArenas) {
+				subArena->arena_ = nullptr;
+				subArena->start_ = subArena->end_ = subArena->current_ = nullptr;
+			}
+			link_->subArenas.clear();
+			link_->arena = nullptr;
+		}
+
+		for (uint8_t * block : overflow_) std::free((void *)block);
+		std::free((void *)block_);
+	}
+
+	UnsafePtr<StackAllocator> FrameArena::ThreadAllocator() {
+		struct Entry {
+			u64 arena;
+			std::shared_ptr<FrameArenaLink_> link;
+			UnsafePtr<StackAllocator> allocator;
+		};
+		thread_local std::vector<Entry> entries;
+
+		for (const Entry& entry : entries) {
+			if (entry.arena == id_) return entry.allocator;
+		}
+
+		// Drop sub-arenas of arenas which no longer exist
+		entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& entry) {
+			std::unique_lock<std::mutex> ul(entry.link->mutex);
+			return entry.link->arena == nullptr;
+		}), entries.end());
+
+		UnsafePtr<StackAllocator> allocator = MakeUnsafe<StackAllocator>(link_);
+		{
+			std::unique_lock<std::mutex> ul(link_->mutex);
+			link_->subArenas.push_back(allocator.Get());
+		}
+		entries.push_back(Entry{ id_, link_, allocator });
+		return allocator;
+	}
+
+	void * FrameArena::Allocate(const usize bytes) {
+		const usize aligned = AlignUp(bytes);
+		const usize offset = offset_.fetch_add(aligned, std::memory_order_relaxed);
+		if (offset + aligned <= capacity_) return block_ + offset;
+		return AllocateOverflow_(aligned);
+	}
+
+	void FrameArena::Refill_(StackAllocator& subArena, const usize bytes) {
+		// Big requests get exactly what they need rather than wasting most of a chunk
+		const usize chunk = std::max(chunkBytes_, AlignUp(bytes));
+		// Sub-arenas start every frame empty so this is the first time it allocated this frame
+		if (subArena.start_ == nullptr) activeSubArenas_.fetch_add(1, std::memory_order_relaxed);
+		uint8_t * memory = (uint8_t *)Allocate(chunk);
+		subArena.start_ = memory;
+		subArena.current_ = memory;
+		subArena.end_ = memory + chunk;
+	}
+
+	uint8_t * FrameArena::AllocateOverflow_(const usize bytes) {
+		std::unique_lock<std::mutex> ul(overflowMutex_);
+		if (overflow_.empty() || overflowOffset_ + bytes > overflowCapacity_) {
+			// Each block is at least a quarter of the frame block so a badly undersized arena only
+			// chains on a handful of them
+			const usize blockBytes = std::max(bytes, std::max(capacity_ / 4, chunkBytes_ * 16));
+			uint8_t * block = (uint8_t *)std::malloc(blockBytes);
+			if (block == nullptr) throw std::bad_alloc();
+			overflow_.push_back(block);
+			overflowOffset_ = 0;
+			overflowCapacity_ = blockBytes;
+			overflowBytes_ += blockBytes;
+		}
+
+		uint8_t * memory = overflow_.back() + overflowOffset_;
+		overflowOffset_ += bytes;
+		return memory;
+	}
+
+	FrameArenaStats FrameArena::EndFrame() {
+		FrameArenaStats stats;
+		stats.frame = ++frames_;
+		stats.capacity = capacity_;
+		stats.bytesUsed = offset_.load(std::memory_order_relaxed);
+		stats.overflowBytes = overflowBytes_;
+		stats.overflowBlocks = overflow_.size();
+		stats.activeSubArenas = activeSubArenas_.exchange(0, std::memory_order_relaxed);
+
+		{
+			std::unique_lock<std::mutex> ul(link_->mutex);
+			for (StackAllocator * subArena : link_->subArenas) {
+				subArena->start_ = subArena->end_ = subArena->current_ = nullptr;
+			}
+		}
+
+		for (uint8_t * block : overflow_) std::free((void *)block);
+		overflow_.clear();
+		overflowOffset_ = 0;
+		overflowCapacity_ = 0;
+		overflowBytes_ = 0;
+
+		recentUsage_[(frames_ - 1) % HighWaterFrames] = stats.bytesUsed;
+		stats.highWaterMark = *std::max_element(recentUsage_, recentUsage_ + HighWaterFrames);
+
+		if (autoSize_) {
+			const usize target = std::max(AlignUp(usize(f64(stats.highWaterMark) * headroom_)), minCapacity_);
+			const bool overflowed = stats.bytesUsed > capacity_;
+			const bool oversized = frames_ >= HighWaterFrames && target < capacity_ / 2;
+			if (overflowed || oversized) Resize_(target);
+		}
+		if (capacity_ < minCapacity_) Resize_(minCapacity_);
+
+		offset_.store(0, std::memory_order_relaxed);
+		stats.nextCapacity = capacity_;
+		lastStats_ = stats;
+		return stats;
+	}
+
+	void FrameArena::SetAutoSize(const bool enabled, const f64 headroom) {
+		autoSize_ = enabled;
+		headroom_ = std::max(headroom, 1.0);
+	}
+
+	void FrameArena::SetMinCapacity(const usize bytes) {
+		minCapacity_ = bytes;
+	}
+
+	void FrameArena::Resize_(const usize bytes) {
+		// Nothing in the old block is alive so there is nothing to copy
+		std::free((void *)block_);
+		capacity_ = AlignUp(bytes);
+		block_ = (uint8_t *)std::malloc(std::max<usize>(capacity_, 1));
+		if (block_ == nullptr) throw std::bad_alloc();
+	}
+}
@@ -3,7 +3,12 @@
 #include <memory>
 #include <typeinfo>
 #include <exception>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <vector>
 #include "StratusPointer.h"
+#include "StratusTypes.h"
 
 // A stack allocator is meant to provide O(1) allocation by only ever moving
 // down the stack. This is best used for short duration allocations such as a
@@ -11,41 +16,53 @@
 // at the end.
 
 namespace stratus {
+	class FrameArena;
+	struct StackAllocator;
+
+	// Shared between a FrameArena and its sub-arenas so that a sub-arena held by a thread_local
+	// can tell whether the arena is still around when the thread exits
+	struct FrameArenaLink_ {
+		std::mutex mutex;
+		// Set to null when the arena is destroyed
+		FrameArena * arena = nullptr;
+		std::vector<StackAllocator *> subArenas;
+	};
+
 	struct StackAllocator {
-		StackAllocator(const size_t maxBytes) {
+		// A growable allocator chains on another block when it runs out instead of throwing
+		// std::bad_alloc. Deallocate replaces the blocks with one big enough for all of them.
+		StackAllocator(const size_t maxBytes, const bool growable = false)
+			: growable_(growable) {
 			start_ = (uint8_t *)std::malloc(maxBytes);
 			end_ = start_ + maxBytes;
 			current_ = start_;
 		}
 
-		~StackAllocator() {
-			if (start_ != nullptr) {
-				std::free((void *)start_);
-				start_ = nullptr;
-				end_ = nullptr;
-				current_ = nullptr;
-			}
-		}
+		// Sub-arena of a FrameArena - use FrameArena::ThreadAllocator instead of calling this
+		explicit StackAllocator(const std::shared_ptr<FrameArenaLink_>& link);
+
+		~StackAllocator();
+
+		StackAllocator(const StackAllocator&) = delete;
+		StackAllocator& operator=(const StackAllocator&) = delete;
 
 		// Allocates a block of memory
 		void * Allocate(const size_t bytes) {
-			uint8_t * memory = current_;
-			current_ = current_ + bytes;
-			if (current_ > end_) {
-				throw std::bad_alloc();
+			if (bytes > size_t(end_ - current_)) {
+				return AllocateSlow_(bytes);
 			}
 
+			uint8_t * memory = current_;
+			current_ = current_ + bytes;
 			return reinterpret_cast<void *>(memory);
 		}
 
 		// Deallocates ALL memory
-		void Deallocate() {
-			current_ = start_;
-		}
+		void Deallocate();
 
 		// Capacity in bytes
 		size_t Capacity() const noexcept {
-			return end_ - start_;
+			return size_t(end_ - start_) + chainedBytes_;
 		}
 
 		// Remaining bytes
@@ -54,17 +71,127 @@ namespace stratus {
 			return end_ - current_;
 		}
 
+		// True if running out of memory gets more instead of throwing
+		bool CanGrow() const noexcept {
+			return growable_ || link_ != nullptr;
+		}
+
+	private:
+		void * AllocateSlow_(const size_t bytes);
+
 	private:
+		friend class FrameArena;
+
 		uint8_t * start_ = nullptr;
 		uint8_t * end_ = nullptr;
 		uint8_t * current_ = nullptr;
+		bool growable_ = false;
+		// Blocks which filled up and were replaced by a bigger one (growable only)
+		std::vector<uint8_t *> chained_;
+		size_t chainedBytes_ = 0;
+		// Set for sub-arenas
+		FrameArena * arena_ = nullptr;
+		std::shared_ptr<FrameArenaLink_> link_;
 	};
 
+	// Whatever default constructed StackBasedPoolAllocators allocate goes here. Nothing resets
+	// it so it chains on more memory rather than throwing once the first 1 KB is used up.
 	inline static UnsafePtr<StackAllocator> GetDefaultStackAllocator_() {
-		thread_local static UnsafePtr<StackAllocator> allocator = MakeUnsafe<StackAllocator>(1024);
+		thread_local static UnsafePtr<StackAllocator> allocator = MakeUnsafe<StackAllocator>(1024, true);
 		return allocator;
 	}
 
+	struct FrameArenaStats {
+		// Number of frames ended so far, including this one
+		u64 frame = 0;
+		// Size of the shared frame block during the frame
+		usize capacity = 0;
+		// Bytes handed out, including those which had to come from overflow blocks
+		usize bytesUsed = 0;
+		// Bytes in blocks chained on after the frame block ran out
+		usize overflowBytes = 0;
+		usize overflowBlocks = 0;
+		// Sub-arenas which took memory this frame (about the number of threads which allocated)
+		usize activeSubArenas = 0;
+		// Largest bytesUsed over the last FrameArena::HighWaterFrames frames
+		usize highWaterMark = 0;
+		// Size of the frame block for the next frame
+		usize nextCapacity = 0;
+	};
+
+	// Scratch memory which lives for one frame. Each thread allocates through its own sub-arena
+	// (ThreadAllocator) which carves chunks out of a shared frame block with an atomic add, so
+	// threads never contend unless the block runs out. Past that chunks come from overflow blocks
+	// chained on under a lock.
+	//
+	// EndFrame frees everything at once. When auto sizing the frame block is then resized so the
+	// high water mark of recent frames fits without overflowing.
+	class FrameArena {
+	public:
+		static constexpr usize DefaultChunkBytes = 64 * 1024;
+		static constexpr usize HighWaterFrames = 120;
+		// Every allocation from the frame block is aligned to this
+		static constexpr usize Alignment = alignof(std::max_align_t);
+
+		FrameArena(const usize initialBytes, const usize chunkBytes = DefaultChunkBytes);
+		~FrameArena();
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		// The calling thread's sub-arena. Only use it (and copies of it) from this thread.
+		// Memory it hands out is valid until the next EndFrame.
+		UnsafePtr<StackAllocator> ThreadAllocator();
+		// Can be called from any thread
+		void * Allocate(const usize bytes);
+
+		// Frees everything allocated this frame - nothing can be allocating while this runs
+		FrameArenaStats EndFrame();
+
+		// Auto sizing grows the frame block as soon as a frame overflows it and shrinks it
+		// once a full window of frames fits in half of it. headroom is the multiple of the high
+		// water mark to size for.
+		void SetAutoSize(const bool enabled, const f64 headroom = 1.25);
+		// The frame block never shrinks below this. Takes effect at the next EndFrame.
+		void SetMinCapacity(const usize bytes);
+		usize MinCapacity() const { return minCapacity_; }
+
+		usize Capacity() const { return capacity_; }
+		// Stats returned by the last EndFrame
+		FrameArenaStats LastFrameStats() const { return lastStats_; }
+
+	private:
+		friend struct StackAllocator;
+
+		// Refills a sub-arena which could not fit the allocation
+		void Refill_(StackAllocator& subArena, const usize bytes);
+		uint8_t * AllocateOverflow_(const usize bytes);
+		void Resize_(const usize bytes);
+
+	private:
+		// Unique across all arenas so thread_local lookups can't be fooled by address reuse
+		u64 id_;
+		usize chunkBytes_;
+		uint8_t * block_ = nullptr;
+		usize capacity_ = 0;
+		std::atomic<usize> offset_{0};
+		std::shared_ptr<FrameArenaLink_> link_;
+		std::atomic<usize> activeSubArenas_{0};
+
+		std::mutex overflowMutex_;
+		std::vector<uint8_t *> overflow_;
+		usize overflowOffset_ = 0;
+		usize overflowCapacity_ = 0;
+		usize overflowBytes_ = 0;
+
+		bool autoSize_ = true;
+		f64 headroom_ = 1.25;
+		usize minCapacity_ = 0;
+		usize recentUsage_[HighWaterFrames] = {};
+		u64 frames_ = 0;
+		FrameArenaStats lastStats_;
+	};
+
 	// This is designed to work with C++ standard library containers so
 	// it follows Allocator requirements
 	//
@@ -128,6 +255,7 @@ namespace stratus {
 		}
 
 		size_type max_size() const noexcept {
+			if (allocator_->CanGrow()) return std::numeric_limits<size_type>::max() / sizeof(value_type);
 			return Remaining();
 		}
 
@@ -153,4 +281,4 @@ namespace stratus {
 	private:
 		UnsafePtr<StackAllocator> allocator_;
 	};
-}
\ No newline at end of file
+}
@@ -6,6 +6,11 @@ namespace stratus {
     TaskSystem::TaskSystem() {}
             
     bool TaskSystem::Initialize() {
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        tasksScheduledMetric_ = metrics.RegisterCounter("TaskSystem.tasksScheduled");
+        queueDepthMetric_ = metrics.RegisterGauge("TaskSystem.queueDepth", "Tasks scheduled which have not finished");
+        threadsMetric_ = metrics.RegisterGauge("TaskSystem.threads");
+
         taskThreads_.clear();
         // Important that this is > 1
         unsigned int concurrency = 2;
@@ -14,7 +19,8 @@ namespace stratus {
         }
 
         for (unsigned int i = 0; i < concurrency; ++i) {
-            Thread * ptr = new Thread("TaskThread#" + std::to_string(i + 1), true);
+            // Tasks start as soon as they are scheduled rather than waiting for the next Update
+            Thread * ptr = new Thread("TaskThread#" + std::to_string(i + 1), true, ThreadDispatchMode::IMMEDIATE);
             threadsWorking_.push_back(std::unique_ptr<std::atomic<size_t>>(new std::atomic<size_t>(0)));
             threadToIndexMap_.insert(std::make_pair(ptr->Id(), threadsWorking_.size() - 1));
             taskThreads_.push_back(ThreadPtr(std::move(ptr)));
@@ -28,28 +34,64 @@ namespace stratus {
     }
 
     SystemStatus TaskSystem::Update(const double) {
-        for (ThreadPtr& thread : taskThreads_) {
-            if (thread->Idle()) {
-                thread->Dispatch();
-            }
+        // Task threads pick up work as soon as it is queued and task groups complete on their own
+        size_t queueDepth = 0;
+        for (const auto& working : threadsWorking_) {
+            queueDepth += working->load(std::memory_order_relaxed);
         }
 
-        auto ul = std::unique_lock<std::mutex>(m_);
-        if (waiting_.size() == 0) return SystemStatus::SYSTEM_CONTINUE;
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        metrics.SetGauge(queueDepthMetric_, f64(queueDepth));
+        metrics.SetGauge(threadsMetric_, f64(taskThreads_.size()));
 
-        std::vector<TaskWait_ *> waiting;
-        for (TaskWait_* wait : waiting_) {
-            if (wait->CheckForCompletion()) {
-                delete wait;
-            }
-            else {
-                waiting.push_back(wait);
+        return SystemStatus::SYSTEM_CONTINUE;
+    }
+
+    // Shared between the caller of ParallelFor and its helper tasks. Helpers which only start
+    // after the caller has returned find no items left and exit.
+    struct ParallelForState_ {
+        std::function<void (size_t)> process;
+        size_t count;
+        std::atomic<size_t> next{ 0 };
+        size_t finished = 0;
+        std::mutex m;
+        std::condition_variable cv;
+
+        void RunItems() {
+            size_t completed = 0;
+            for (size_t index = next.fetch_add(1); index < count; index = next.fetch_add(1)) {
+                process(index);
+                ++completed;
             }
+
+            if (completed == 0) return;
+            auto ul = std::unique_lock<std::mutex>(m);
+            finished += completed;
+            if (finished == count) cv.notify_all();
         }
+    };
 
-        waiting_ = std::move(waiting);
-        
-        return SystemStatus::SYSTEM_CONTINUE;
+    void TaskSystem::ParallelFor(const size_t count, const std::function<void (size_t)>& process) {
+        if (count == 0) return;
+        if (count == 1 || taskThreads_.size() == 0) {
+            for (size_t i = 0; i < count; ++i) process(i);
+            return;
+        }
+
+        auto state = std::make_shared<ParallelForState_>();
+        state->process = process;
+        state->count = count;
+
+        // The current thread counts as one of the workers
+        const size_t numHelpers = std::min(count - 1, taskThreads_.size());
+        for (size_t i = 0; i < numHelpers; ++i) {
+            ScheduleVoidTask_([state]() { state->RunItems(); });
+        }
+
+        state->RunItems();
+
+        auto ul = std::unique_lock<std::mutex>(state->m);
+        state->cv.wait(ul, [&state]() { return state->finished == state->count; });
     }
 
     void TaskSystem::Shutdown() {
@@ -75,10 +117,6 @@ namespace stratus {
             }
 
             if (!allIdle) {
-                for (auto& thread : taskThreads_) {
-                    thread->Dispatch();
-                }
-
                 std::this_thread::sleep_for(std::chrono::milliseconds(1));
             }
         }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "StratusSystemModule.h"
+#include "StratusMetrics.h"
 #include "StratusThread.h"
 #include "StratusAsync.h"
 
@@ -9,39 +10,43 @@
 #include <cmath>
 #include <unordered_map>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 
 namespace stratus { 
-    // Allows groups of async processes to be waited on in an async manner
-    struct TaskWait_ {
-        virtual ~TaskWait_() = default;
-        virtual bool CheckForCompletion() const = 0;
-    };
-
+    // Allows groups of async processes to be waited on in an async manner. Each task in the group counts
+    // down when it finishes and the last one queues the callback on the thread which started the wait, so
+    // nothing has to poll for completion.
     template<typename E>
-    struct TaskWaitImpl_ : public TaskWait_ {
-        TaskWaitImpl_(const std::function<void(const std::vector<Async<E>>&)>& callback, const std::vector<Async<E>>& group)
-            : callback(callback), group(group) {
+    struct TaskWait_ : public std::enable_shared_from_this<TaskWait_<E>> {
+        TaskWait_(const std::function<void(const std::vector<Async<E>>&)>& callback, const std::vector<Async<E>>& group)
+            : callback(callback), group(group), remaining(group.size() + 1) {
             thread = &Thread::Current();
         }
 
-        virtual bool CheckForCompletion() const override {
-            for (const auto& as : group) {
-                if (!as.Completed()) {
-                    return false;
-                }
+        void Start() {
+            auto self = this->shared_from_this();
+            for (auto& as : group) {
+                as.AddCompletionListener([self]() { self->TaskFinished(); });
             }
+            // Balances the extra count from the constructor so an empty or already finished group still fires
+            TaskFinished();
+        }
+
+        void TaskFinished() {
+            if (remaining.fetch_sub(1) != 1) return;
 
             std::function<void(const std::vector<Async<E>>&)> c = callback;
             std::vector<Async<E>> g = group;
             thread->Queue([c, g]() {
                 c(g);
             });
-            return true;
         }
 
         Thread* thread;
         std::function<void(const std::vector<Async<E>>&)> callback;
         std::vector<Async<E>> group;
+        std::atomic<size_t> remaining;
     };
 
     // Enables easy access to asynchronous processing by providing its own Task
@@ -64,6 +69,7 @@ namespace stratus {
         Async<E> CreateAsyncTask_(const T& process, const size_t index) {
             // Increment the working #
             threadsWorking_[index]->fetch_add(1);
+            MetricsRegistry::Instance().Increment(tasksScheduledMetric_);
 
             const auto processWithHook = [this, index, process]() {
                 auto result = process();
@@ -79,6 +85,7 @@ namespace stratus {
         Async<void> CreateAsyncVoidTask_(const std::function<void (void)>& process, const size_t index) {
             // Increment the working #
             threadsWorking_[index]->fetch_add(1);
+            MetricsRegistry::Instance().Increment(tasksScheduledMetric_);
 
             const auto processWithHook = [this, index, process]() {
                 process();
@@ -146,12 +153,17 @@ namespace stratus {
             return ScheduleVoidTask_(process);
         }
 
+        // callback runs on the calling thread once every task in the group has finished
         template<typename E>
         void AddTaskGroupCallback(const std::function<void (const std::vector<Async<E>>&)>& callback, const std::vector<Async<E>>& group) {
-            auto ul = std::unique_lock<std::mutex>(m_);
-            waiting_.push_back(new TaskWaitImpl_<E>(callback, group));
+            std::make_shared<TaskWait_<E>>(callback, group)->Start();
         }
 
+        // Runs process(i) for every i in [0, count) spread across the task threads. The calling thread
+        // takes items as well and this only returns once all of them have finished, so it is safe to
+        // call from inside of another task.
+        void ParallelFor(const size_t count, const std::function<void (size_t)>& process);
+
         size_t Size() const {
             return taskThreads_.size();
         }
@@ -163,10 +175,9 @@ namespace stratus {
         std::unordered_map<ThreadHandle, size_t> threadToIndexMap_;
         // Measures # of work items per thread
         std::vector<std::unique_ptr<std::atomic<size_t>>> threadsWorking_;
-        
-        // This changes with every call to wait on task group
-        //std::vector<std::pair<Thread *, std::vector<
-        std::vector<TaskWait_ *> waiting_;
         size_t nextTaskThread_;
+        MetricId tasksScheduledMetric_;
+        MetricId queueDepthMetric_;
+        MetricId threadsMetric_;
     };
 }
\ No newline at end of file
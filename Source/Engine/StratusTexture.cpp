@@ -7,6 +7,14 @@
 #include "StratusApplicationThread.h"
 #include "StratusGraphicsDriver.h"
 
+// S3TC is an extension rather than core so the enums may be missing from the GL headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+
 namespace stratus {
     static const void* CastTexDataToPtr(const TextureArrayData& data, const size_t offset) {
         if (!data.size()) return nullptr;
@@ -65,6 +73,15 @@ namespace stratus {
         default: throw std::exception();
         }
 
+        switch (config.compression) {
+        case TextureCompression::NONE: break;
+        case TextureCompression::BC1: result += "BC1, "; break;
+        case TextureCompression::BC4: result += "BC4, "; break;
+        case TextureCompression::BC5: result += "BC5, "; break;
+        case TextureCompression::BC7: result += "BC7, "; break;
+        default: throw std::exception();
+        }
+
         result = result + std::to_string(config.width) + ", " +
             std::to_string(config.height) + ", " +
             std::to_string(config.depth) + ", " +
@@ -98,11 +115,13 @@ namespace stratus {
                 if (config.type == TextureType::TEXTURE_2D || config.type == TextureType::TEXTURE_RECTANGLE) {
                     glTextureStorage2D(
                         texture_,
-                        1,
-                        _convertInternalFormatPrecise(config.format, config.storage, config.dataType),
+                        std::max<u32>(1, config.virtualMipLevels),
+                        InternalFormat_(config),
                         config.width,
                         config.height
                     );
+                    glTextureParameteri(texture_, GL_TEXTURE_MAX_LEVEL, GLint(std::max<u32>(1, config.virtualMipLevels)) - 1);
+                    glTextureParameterf(texture_, GL_TEXTURE_MAX_ANISOTROPY, GraphicsDriver::GetConfig().maxAnisotropy);
                 }
                 else if (config.type == TextureType::TEXTURE_2D_ARRAY) {
                     glTextureStorage3D(
@@ -118,7 +137,14 @@ namespace stratus {
                     throw std::runtime_error("Unsupported virtual (sparse) texture type");
                 }
             }
+            else if (config.type == TextureType::TEXTURE_2D && data.size() > 0 && data[0].mips.size() > 0) {
+                InitFromMipChain_(config, data[0].mips);
+            }
             else {
+                if (config.compression != TextureCompression::NONE) {
+                    throw std::runtime_error("Compressed textures must be 2D and include their mip chain");
+                }
+
                 bind(0);
                 // Use tightly packed data
                 // See https://stackoverflow.com/questions/19023397/use-glteximage2d-draw-6363-image
@@ -203,8 +229,9 @@ namespace stratus {
                 unbind(0);
             }
 
-            // Mipmaps aren't generated for rectangle textures
-            if (config.generateMipMaps && config.type != TextureType::TEXTURE_RECTANGLE) glGenerateTextureMipmap(texture_);
+            // Mipmaps aren't generated for rectangle textures or when the full chain was provided
+            const bool mipsProvided = data.size() > 0 && data[0].mips.size() > 0;
+            if (config.generateMipMaps && !mipsProvided && config.type != TextureType::TEXTURE_RECTANGLE) glGenerateTextureMipmap(texture_);
 
             STRATUS_LOG << ConvertTextureConfigToString(config) << std::endl;
         }
@@ -225,6 +252,24 @@ namespace stratus {
         TextureImpl& operator=(const TextureImpl&) = delete;
         TextureImpl& operator=(TextureImpl&&) = delete;
 
+        static GLenum InternalFormat_(const TextureConfig& config) {
+            return config.compression != TextureCompression::NONE ?
+                _convertCompressedInternalFormat(config.compression, config.format) :
+                _convertInternalFormatPrecise(config.format, config.storage, config.dataType);
+        }
+
+        // Allocates immutable storage for every level and uploads them all at once
+        void InitFromMipChain_(const TextureConfig& config, const std::vector<TextureMipData>& mips) {
+            glTextureStorage2D(texture_, GLsizei(mips.size()), InternalFormat_(config), config.width, config.height);
+
+            for (usize level = 0; level < mips.size(); ++level) {
+                UploadMip(u32(level), mips[level]);
+            }
+
+            glTextureParameteri(texture_, GL_TEXTURE_MAX_LEVEL, GLint(mips.size()) - 1);
+            glTextureParameterf(texture_, GL_TEXTURE_MAX_ANISOTROPY, GraphicsDriver::GetConfig().maxAnisotropy);
+        }
+
         void setCoordinateWrapping(TextureCoordinateWrapping wrap) {
             if (config_.type == TextureType::TEXTURE_RECTANGLE && (wrap != TextureCoordinateWrapping::CLAMP_TO_BORDER && wrap != TextureCoordinateWrapping::CLAMP_TO_EDGE)) {
                 STRATUS_ERROR << "Texture_Rectangle ONLY supports clamp to edge and clamp to border" << std::endl;
@@ -331,6 +376,35 @@ namespace stratus {
             );
         }
 
+        void CopyLayerFrom(const TextureImpl& src, const i32 mipLevel, const i32 srcLayer, const i32 dstLayer) const {
+            // For cube maps layers are interpreted as layer-faces, meaning divisible by 6
+            const i32 multiplier = type() == TextureType::TEXTURE_CUBE_MAP_ARRAY ? 6 : 1;
+            glCopyImageSubData(
+                src.texture_,
+                _convertTexture(src.type()),
+                mipLevel,
+                0, 0, srcLayer * multiplier,
+                texture_,
+                _convertTexture(type()),
+                mipLevel,
+                0, 0, dstLayer * multiplier,
+                width(),
+                height(),
+                multiplier
+            );
+        }
+
+        void ReadPixels(const i32 mipLevel, const usize sizeBytes, void * out) const {
+            glGetTextureImage(
+                texture_,
+                mipLevel,
+                _convertFormat(config_.format, config_.dataType),
+                _convertType(config_.dataType, config_.storage),
+                GLsizei(sizeBytes),
+                out
+            );
+        }
+
         TextureType type() const { return config_.type; }
         TextureComponentFormat format() const { return config_.format; }
         TextureHandle handle() const { return handle_; }
@@ -360,6 +434,50 @@ namespace stratus {
         u32 depth() const { return config_.depth; }
         void* Underlying() const { return (void*)&texture_; }
 
+        void UploadMip(u32 mipLevel, const TextureMipData& mip) const {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            if (config_.compression != TextureCompression::NONE) {
+                glCompressedTextureSubImage2D(
+                    texture_, GLint(mipLevel), 0, 0, mip.width, mip.height,
+                    InternalFormat_(config_), GLsizei(mip.sizeBytes), mip.data
+                );
+            }
+            else {
+                glTextureSubImage2D(
+                    texture_, GLint(mipLevel), 0, 0, mip.width, mip.height,
+                    _convertFormat(config_.format, config_.dataType),
+                    _convertType(config_.dataType, config_.storage),
+                    mip.data
+                );
+            }
+        }
+
+        void CommitOrUncommitVirtualMip(u32 mipLevel, bool commit) const {
+            // A region covering the whole level is always valid even if it is not a multiple of the page size
+            glTexturePageCommitmentEXT(
+                texture_,
+                GLint(mipLevel),
+                0,
+                0,
+                0,
+                std::max<u32>(1, config_.width >> mipLevel),
+                std::max<u32>(1, config_.height >> mipLevel),
+                1,
+                commit ? GL_TRUE : GL_FALSE
+            );
+        }
+
+        void GetVirtualPageInfo(u32& pageSizeX, u32& pageSizeY, u32& numSparseLevels) const {
+            GLint x = DEFAULT_VIRTUAL_PAGE_SIZE_XYZ, y = DEFAULT_VIRTUAL_PAGE_SIZE_XYZ, levels = 0;
+            // Index 0 is the page size the texture was created with
+            glGetInternalformativ(_convertTexture(config_.type), InternalFormat_(config_), GL_VIRTUAL_PAGE_SIZE_X_ARB, 1, &x);
+            glGetInternalformativ(_convertTexture(config_.type), InternalFormat_(config_), GL_VIRTUAL_PAGE_SIZE_Y_ARB, 1, &y);
+            glGetTextureParameteriv(texture_, GL_NUM_SPARSE_LEVELS_ARB, &levels);
+            pageSizeX = u32(x);
+            pageSizeY = u32(y);
+            numSparseLevels = u32(levels);
+        }
+
         void CommitOrUncommitVirtualPage(u32 xoffset, u32 yoffset, u32 zoffset, u32 numPagesX, u32 numPagesY, bool commit) const {
             glTexturePageCommitmentEXT(
                 texture_,
@@ -593,6 +711,17 @@ namespace stratus {
             throw std::runtime_error("Unknown error occurred");
         }
 
+        static GLenum _convertCompressedInternalFormat(TextureCompression compression, TextureComponentFormat format) {
+            const bool srgb = format == TextureComponentFormat::SRGB || format == TextureComponentFormat::SRGB_ALPHA;
+            switch (compression) {
+            case TextureCompression::BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            case TextureCompression::BC4: return GL_COMPRESSED_RED_RGTC1;
+            case TextureCompression::BC5: return GL_COMPRESSED_RG_RGTC2;
+            case TextureCompression::BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+            default: throw std::runtime_error("Unknown texture compression format");
+            }
+        }
+
         static GLint _convertInternalFormatPrecise(TextureComponentFormat format, TextureComponentSize size, TextureComponentType type) {
             // If the bits are default we just mirror the format for the internal format option
             if (format == TextureComponentFormat::DEPTH_STENCIL ||
@@ -857,6 +986,17 @@ namespace stratus {
         impl_->ClearLayerRegion(mipLevel, layer, xoffset, yoffset, width, height, clearValue);
     }
 
+    void Texture::CopyLayerFrom(const Texture& src, const i32 mipLevel, const i32 srcLayer, const i32 dstLayer) const {
+        EnsureValid_();
+        src.EnsureValid_();
+        impl_->CopyLayerFrom(*src.impl_, mipLevel, srcLayer, dstLayer);
+    }
+
+    void Texture::ReadPixels(const i32 mipLevel, const usize sizeBytes, void * out) const {
+        EnsureValid_();
+        impl_->ReadPixels(mipLevel, sizeBytes, out);
+    }
+
     const void* Texture::Underlying() const { EnsureValid_(); return impl_->Underlying(); }
 
     u32 Texture::VirtualPageSizeXY() {
@@ -868,6 +1008,21 @@ namespace stratus {
         impl_->CommitOrUncommitVirtualPage(xoffset, yoffset, zoffset, numPagesX, numPagesY, commit);
     }
 
+    void Texture::CommitOrUncommitVirtualMip(u32 mipLevel, bool commit) const {
+        EnsureValid_();
+        impl_->CommitOrUncommitVirtualMip(mipLevel, commit);
+    }
+
+    void Texture::GetVirtualPageInfo(u32& pageSizeX, u32& pageSizeY, u32& numSparseLevels) const {
+        EnsureValid_();
+        impl_->GetVirtualPageInfo(pageSizeX, pageSizeY, numSparseLevels);
+    }
+
+    void Texture::UploadMip(u32 mipLevel, const TextureMipData& mip) const {
+        EnsureValid_();
+        impl_->UploadMip(mipLevel, mip);
+    }
+
     size_t Texture::HashCode() const {
         return std::hash<void*>{}((void*)impl_.get());
     }
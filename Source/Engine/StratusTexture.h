@@ -42,6 +42,20 @@ namespace stratus {
         BITS_11_11_10 // Only valid for float: R11G11B10_F
     };
 
+    // Block compressed storage formats. The number of channels comes from the block format
+    // while TextureConfig::format still selects between linear and sRGB.
+    enum class TextureCompression : i32 {
+        NONE,
+        // RGB, 4 bits per pixel
+        BC1,
+        // Single channel, 4 bits per pixel
+        BC4,
+        // Two channels, 8 bits per pixel
+        BC5,
+        // RGBA, 8 bits per pixel
+        BC7
+    };
+
     enum class TextureComponentType : i32 {
         // NORM types should only be used with BITS_DEFAULT or BITS_8
         INT_NORM,
@@ -111,6 +125,10 @@ namespace stratus {
         u32 depth;
         bool generateMipMaps;
         bool virtualTexture = false;
+        // Levels of storage allocated for virtual textures (none are committed up front)
+        u32 virtualMipLevels = 1;
+        // Only supported for TEXTURE_2D and requires TextureData::mips
+        TextureCompression compression = TextureCompression::NONE;
     };
 
     struct TextureAccess {
@@ -119,9 +137,22 @@ namespace stratus {
         TextureComponentType dataType;
     };
 
+    // One level of a precomputed mip chain
+    struct TextureMipData {
+        const void* data = nullptr;
+        u32 width = 0;
+        u32 height = 0;
+        // Only required for compressed textures
+        usize sizeBytes = 0;
+    };
+
     struct TextureData {
         const void* data;
+        // Optional full mip chain starting at level 0 (TEXTURE_2D only). When present it is used instead
+        // of data and mipmaps are not generated on the GPU.
+        std::vector<TextureMipData> mips;
         TextureData(const void* data = nullptr) : data(data) {}
+        TextureData(const std::vector<TextureMipData>& mips) : data(mips.size() > 0 ? mips[0].data : nullptr), mips(mips) {}
     };
 
     typedef std::vector<TextureData> TextureArrayData;
@@ -167,6 +198,12 @@ namespace stratus {
 
         static u32 VirtualPageSizeXY();
         void CommitOrUncommitVirtualPage(u32 xoffset, u32 yoffset, u32 zoffset, u32 numPagesX, u32 numPagesY, bool commit) const;
+        // Commits or uncommits an entire mip level of a virtual texture
+        void CommitOrUncommitVirtualMip(u32 mipLevel, bool commit) const;
+        // Page size for this texture's format and the number of levels which are not part of the mip tail
+        void GetVirtualPageInfo(u32& pageSizeX, u32& pageSizeY, u32& numSparseLevels) const;
+        // Replaces the contents of one level of a 2D texture. For compressed textures sizeBytes is required.
+        void UploadMip(u32 mipLevel, const TextureMipData& mip) const;
 
         void BindAsImageTexture(u32 unit, i32 mipLevel, bool layered, int32_t layer, ImageTextureAccessMode access) const;
         void BindAsImageTexture(u32 unit, i32 mipLevel, bool layered, int32_t layer, ImageTextureAccessMode access, const TextureAccess& config) const;
@@ -184,6 +221,12 @@ namespace stratus {
             const i32 width,
             const i32 height,
             const void* clearValue) const;
+        // Copies one layer of src into one layer of this texture. Both textures must have the same
+        // dimensions and format.
+        void CopyLayerFrom(const Texture& src, const i32 mipLevel, const i32 srcLayer, const i32 dstLayer) const;
+        // Reads every layer of a mip level in the texture's own format and type. With a buffer bound as the
+        // PIXEL_PACK_BUFFER out is an offset into it and the call does not wait for the GPU.
+        void ReadPixels(const i32 mipLevel, const usize sizeBytes, void * out) const;
 
         // Gets a pointer to the underlying data (implementation-dependent)
         const void* Underlying() const;
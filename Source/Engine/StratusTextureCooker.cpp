@@ -0,0 +1,724 @@
+#include "StratusTextureCooker.h"
+#include "StratusMipGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <functional>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STRATUS_TEXTURE_COOKER_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace stratus {
+    static constexpr u32 cookedMagic = 0x43585453; // "STXC"
+
+    // BC7 4-bit index interpolation weights
+    static constexpr i32 bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    usize CookedTexture::SizeBytes() const {
+        usize bytes = 0;
+        for (const auto& mip : mips) bytes += mip.data.size();
+        return bytes;
+    }
+
+    TextureComponentFormat CookedTexture::Format() const {
+        switch (compression) {
+        case TextureCompression::BC1: return srgb ? TextureComponentFormat::SRGB : TextureComponentFormat::RGB;
+        case TextureCompression::BC4: return TextureComponentFormat::RED;
+        case TextureCompression::BC5: return TextureComponentFormat::RG;
+        default: return srgb ? TextureComponentFormat::SRGB_ALPHA : TextureComponentFormat::RGBA;
+        }
+    }
+
+    std::vector<TextureMipData> CookedTexture::MipData() const {
+        std::vector<TextureMipData> result(mips.size());
+        for (usize i = 0; i < mips.size(); ++i) {
+            result[i].data = (const void *)mips[i].data.data();
+            result[i].width = mips[i].width;
+            result[i].height = mips[i].height;
+            result[i].sizeBytes = mips[i].data.size();
+        }
+        return result;
+    }
+
+    // Writes values into a 128-bit block starting from the least significant bit
+    struct BlockBitWriter_ {
+        u8 * out;
+        u32 bit = 0;
+
+        void Write(u32 value, const u32 numBits) {
+            for (u32 i = 0; i < numBits; ++i, ++bit) {
+                if ((value >> i) & 1) out[bit >> 3] |= u8(1 << (bit & 7));
+            }
+        }
+    };
+
+    struct BlockBitReader_ {
+        const u8 * in;
+        u32 bit = 0;
+
+        u32 Read(const u32 numBits) {
+            u32 value = 0;
+            for (u32 i = 0; i < numBits; ++i, ++bit) {
+                value |= u32((in[bit >> 3] >> (bit & 7)) & 1) << i;
+            }
+            return value;
+        }
+    };
+
+    // Finds the line through the block's colors using a few rounds of power iteration and returns the
+    // extents of the block along it. Only the first numChannels components are considered.
+    static void ComputeEndpoints(const u8 * rgba, const u32 numChannels, float e0[4], float e1[4]) {
+        float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (u32 p = 0; p < 16; ++p) {
+            for (u32 c = 0; c < numChannels; ++c) mean[c] += float(rgba[p * 4 + c]);
+        }
+        for (u32 c = 0; c < numChannels; ++c) mean[c] /= 16.0f;
+
+        float cov[4][4] = {};
+        for (u32 p = 0; p < 16; ++p) {
+            float d[4];
+            for (u32 c = 0; c < numChannels; ++c) d[c] = float(rgba[p * 4 + c]) - mean[c];
+            for (u32 i = 0; i < numChannels; ++i) {
+                for (u32 j = 0; j < numChannels; ++j) cov[i][j] += d[i] * d[j];
+            }
+        }
+
+        // Start from the covariance column with the largest variance since a fixed start vector
+        // can be orthogonal to the principal axis
+        u32 largest = 0;
+        for (u32 c = 1; c < numChannels; ++c) {
+            if (cov[c][c] > cov[largest][largest]) largest = c;
+        }
+        float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        axis[largest] = 1.0f;
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (u32 i = 0; i < numChannels; ++i) {
+                for (u32 j = 0; j < numChannels; ++j) next[i] += cov[i][j] * axis[j];
+            }
+            float length = 0.0f;
+            for (u32 c = 0; c < numChannels; ++c) length += next[c] * next[c];
+            // Flat block - any axis works
+            if (length < 1e-8f) break;
+            length = std::sqrt(length);
+            for (u32 c = 0; c < numChannels; ++c) axis[c] = next[c] / length;
+        }
+
+        float tmin = std::numeric_limits<float>::max();
+        float tmax = std::numeric_limits<float>::lowest();
+        for (u32 p = 0; p < 16; ++p) {
+            float t = 0.0f;
+            for (u32 c = 0; c < numChannels; ++c) t += (float(rgba[p * 4 + c]) - mean[c]) * axis[c];
+            tmin = std::min(tmin, t);
+            tmax = std::max(tmax, t);
+        }
+
+        for (u32 c = 0; c < 4; ++c) {
+            if (c < numChannels) {
+                e0[c] = std::clamp(mean[c] + axis[c] * tmax, 0.0f, 255.0f);
+                e1[c] = std::clamp(mean[c] + axis[c] * tmin, 0.0f, 255.0f);
+            }
+            else {
+                e0[c] = e1[c] = 255.0f;
+            }
+        }
+    }
+
+    // For each of the 16 pixels finds the closest palette entry (squared distance over the first
+    // numChannels components). numPalette must be 4, 8 or 16.
+    static void SelectIndices(const u8 * rgba, const u8 palette[16][4], const u32 numPalette, const u32 numChannels, u8 indices[16]) {
+#if defined(STRATUS_TEXTURE_COOKER_SSE)
+        // Channel planar palette with unused channels zeroed so they never contribute
+        alignas(16) i16 planar[4][16] = {};
+        for (u32 i = 0; i < numPalette; ++i) {
+            for (u32 c = 0; c < numChannels; ++c) planar[c][i] = i16(palette[i][c]);
+        }
+
+        for (u32 p = 0; p < 16; ++p) {
+            alignas(16) i32 distances[16];
+            for (u32 i = 0; i < numPalette; i += 8) {
+                __m128i diff[4];
+                for (u32 c = 0; c < 4; ++c) {
+                    const i16 value = c < numChannels ? i16(rgba[p * 4 + c]) : i16(0);
+                    diff[c] = _mm_sub_epi16(_mm_load_si128((const __m128i *)&planar[c][i]), _mm_set1_epi16(value));
+                }
+                // Interleave so madd squares and sums channel pairs in 32 bits without overflowing
+                const __m128i rgLo = _mm_unpacklo_epi16(diff[0], diff[1]);
+                const __m128i rgHi = _mm_unpackhi_epi16(diff[0], diff[1]);
+                const __m128i baLo = _mm_unpacklo_epi16(diff[2], diff[3]);
+                const __m128i baHi = _mm_unpackhi_epi16(diff[2], diff[3]);
+                const __m128i lo = _mm_add_epi32(_mm_madd_epi16(rgLo, rgLo), _mm_madd_epi16(baLo, baLo));
+                const __m128i hi = _mm_add_epi32(_mm_madd_epi16(rgHi, rgHi), _mm_madd_epi16(baHi, baHi));
+                _mm_store_si128((__m128i *)&distances[i], lo);
+                _mm_store_si128((__m128i *)&distances[i + 4], hi);
+            }
+
+            u32 bestIndex = 0;
+            for (u32 i = 1; i < numPalette; ++i) {
+                if (distances[i] < distances[bestIndex]) bestIndex = i;
+            }
+            indices[p] = u8(bestIndex);
+        }
+#else
+        for (u32 p = 0; p < 16; ++p) {
+            i32 bestDistance = std::numeric_limits<i32>::max();
+            u32 bestIndex = 0;
+            for (u32 i = 0; i < numPalette; ++i) {
+                i32 distance = 0;
+                for (u32 c = 0; c < numChannels; ++c) {
+                    const i32 d = i32(rgba[p * 4 + c]) - i32(palette[i][c]);
+                    distance += d * d;
+                }
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    bestIndex = i;
+                }
+            }
+            indices[p] = u8(bestIndex);
+        }
+#endif
+    }
+
+    static u16 To565(const float rgb[4]) {
+        const u32 r = u32(std::lround(rgb[0] * 31.0f / 255.0f));
+        const u32 g = u32(std::lround(rgb[1] * 63.0f / 255.0f));
+        const u32 b = u32(std::lround(rgb[2] * 31.0f / 255.0f));
+        return u16((r << 11) | (g << 5) | b);
+    }
+
+    static void From565(const u16 color, u8 out[4]) {
+        const u32 r = (color >> 11) & 31;
+        const u32 g = (color >> 5) & 63;
+        const u32 b = color & 31;
+        out[0] = u8((r << 3) | (r >> 2));
+        out[1] = u8((g << 2) | (g >> 4));
+        out[2] = u8((b << 3) | (b >> 2));
+        out[3] = 255;
+    }
+
+    static void BC1Palette(const u16 c0, const u16 c1, u8 palette[16][4]) {
+        From565(c0, palette[0]);
+        From565(c1, palette[1]);
+        for (u32 c = 0; c < 3; ++c) {
+            if (c0 > c1) {
+                palette[2][c] = u8((2 * u32(palette[0][c]) + u32(palette[1][c])) / 3);
+                palette[3][c] = u8((u32(palette[0][c]) + 2 * u32(palette[1][c])) / 3);
+            }
+            else {
+                palette[2][c] = u8((u32(palette[0][c]) + u32(palette[1][c])) / 2);
+                palette[3][c] = 0;
+            }
+        }
+        palette[2][3] = palette[3][3] = 255;
+    }
+
+    static void BC4Palette(const u8 r0, const u8 r1, u8 palette[8]) {
+        palette[0] = r0;
+        palette[1] = r1;
+        if (r0 > r1) {
+            for (u32 i = 2; i < 8; ++i) palette[i] = u8(((8 - i) * u32(r0) + (i - 1) * u32(r1)) / 7);
+        }
+        else {
+            for (u32 i = 2; i < 6; ++i) palette[i] = u8(((6 - i) * u32(r0) + (i - 1) * u32(r1)) / 5);
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    TextureCompression TextureCooker::SelectCompression(const TextureUsage usage, const u32 numChannels) {
+        switch (usage) {
+        case TextureUsage::NORMAL_MAP:
+            return numChannels >= 2 ? TextureCompression::BC5 : TextureCompression::BC4;
+        case TextureUsage::ROUGHNESS:
+        case TextureUsage::METALLIC:
+            return TextureCompression::BC4;
+        case TextureUsage::ALBEDO:
+        case TextureUsage::METALLIC_ROUGHNESS:
+            return TextureCompression::BC7;
+        default:
+            if (numChannels == 1) return TextureCompression::BC4;
+            if (numChannels == 3) return TextureCompression::BC1;
+            return TextureCompression::BC7;
+        }
+    }
+
+    usize TextureCooker::BlockBytes(const TextureCompression compression) {
+        switch (compression) {
+        case TextureCompression::BC1:
+        case TextureCompression::BC4:
+            return 8;
+        case TextureCompression::BC5:
+        case TextureCompression::BC7:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    usize TextureCooker::CompressedSize(const TextureCompression compression, const u32 width, const u32 height) {
+        const usize blocksX = std::max<usize>(1, (usize(width) + 3) / 4);
+        const usize blocksY = std::max<usize>(1, (usize(height) + 3) / 4);
+        return blocksX * blocksY * BlockBytes(compression);
+    }
+
+    void TextureCooker::EncodeBC1(const u8 * rgba, u8 * out) {
+        float e0[4], e1[4];
+        ComputeEndpoints(rgba, 3, e0, e1);
+
+        u16 c0 = To565(e0);
+        u16 c1 = To565(e1);
+        // c0 > c1 selects the 4 color mode
+        if (c0 < c1) std::swap(c0, c1);
+
+        u8 indices[16] = {};
+        if (c0 != c1) {
+            u8 palette[16][4];
+            BC1Palette(c0, c1, palette);
+            SelectIndices(rgba, palette, 4, 3, indices);
+        }
+
+        std::memset(out, 0, 8);
+        out[0] = u8(c0 & 0xFF);
+        out[1] = u8(c0 >> 8);
+        out[2] = u8(c1 & 0xFF);
+        out[3] = u8(c1 >> 8);
+        for (u32 p = 0; p < 16; ++p) {
+            out[4 + p / 4] |= u8(indices[p] << ((p % 4) * 2));
+        }
+    }
+
+    void TextureCooker::EncodeBC4(const u8 * rgba, const u32 channel, u8 * out) {
+        u8 r0 = 0, r1 = 255;
+        for (u32 p = 0; p < 16; ++p) {
+            r0 = std::max(r0, rgba[p * 4 + channel]);
+            r1 = std::min(r1, rgba[p * 4 + channel]);
+        }
+
+        std::memset(out, 0, 8);
+        out[0] = r0;
+        out[1] = r1;
+        if (r0 == r1) return;
+
+        u8 palette[8];
+        BC4Palette(r0, r1, palette);
+
+        u64 bits = 0;
+        for (u32 p = 0; p < 16; ++p) {
+            const i32 value = rgba[p * 4 + channel];
+            u32 bestIndex = 0;
+            i32 bestDistance = std::numeric_limits<i32>::max();
+            for (u32 i = 0; i < 8; ++i) {
+                const i32 distance = std::abs(value - i32(palette[i]));
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    bestIndex = i;
+                }
+            }
+            bits |= u64(bestIndex) << (p * 3);
+        }
+
+        for (u32 i = 0; i < 6; ++i) out[2 + i] = u8((bits >> (i * 8)) & 0xFF);
+    }
+
+    void TextureCooker::EncodeBC5(const u8 * rgba, u8 * out) {
+        EncodeBC4(rgba, 0, out);
+        EncodeBC4(rgba, 1, out + 8);
+    }
+
+    void TextureCooker::EncodeBC7(const u8 * rgba, u8 * out) {
+        float e[2][4];
+        ComputeEndpoints(rgba, 4, e[0], e[1]);
+
+        // Endpoints are 7 bits per channel plus a p-bit shared by all channels of the endpoint
+        u8 quantized[2][4];
+        u32 pbits[2];
+        for (u32 endpoint = 0; endpoint < 2; ++endpoint) {
+            float bestError = std::numeric_limits<float>::max();
+            for (u32 p = 0; p < 2; ++p) {
+                float error = 0.0f;
+                u8 candidate[4];
+                for (u32 c = 0; c < 4; ++c) {
+                    const i32 c7 = std::clamp(i32(std::lround((e[endpoint][c] - float(p)) / 2.0f)), 0, 127);
+                    candidate[c] = u8((c7 << 1) | i32(p));
+                    const float d = float(candidate[c]) - e[endpoint][c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    pbits[endpoint] = p;
+                    std::memcpy(quantized[endpoint], candidate, 4);
+                }
+            }
+        }
+
+        u8 palette[16][4];
+        for (u32 i = 0; i < 16; ++i) {
+            for (u32 c = 0; c < 4; ++c) {
+                palette[i][c] = u8(((64 - bc7Weights4[i]) * i32(quantized[0][c]) + bc7Weights4[i] * i32(quantized[1][c]) + 32) >> 6);
+            }
+        }
+
+        u8 indices[16];
+        SelectIndices(rgba, palette, 16, 4, indices);
+
+        // The most significant bit of the first index is implied to be 0
+        if (indices[0] & 8) {
+            std::swap(quantized[0], quantized[1]);
+            std::swap(pbits[0], pbits[1]);
+            for (u32 p = 0; p < 16; ++p) indices[p] = u8(15 - indices[p]);
+        }
+
+        std::memset(out, 0, 16);
+        BlockBitWriter_ writer{ out };
+        writer.Write(1 << 6, 7);
+        for (u32 c = 0; c < 4; ++c) {
+            writer.Write(quantized[0][c] >> 1, 7);
+            writer.Write(quantized[1][c] >> 1, 7);
+        }
+        writer.Write(pbits[0], 1);
+        writer.Write(pbits[1], 1);
+        writer.Write(indices[0], 3);
+        for (u32 p = 1; p < 16; ++p) writer.Write(indices[p], 4);
+    }
+
+    void TextureCooker::DecodeBC1(const u8 * in, u8 * rgba) {
+        const u16 c0 = u16(in[0] | (in[1] << 8));
+        const u16 c1 = u16(in[2] | (in[3] << 8));
+        u8 palette[16][4];
+        BC1Palette(c0, c1, palette);
+        for (u32 p = 0; p < 16; ++p) {
+            const u32 index = (in[4 + p / 4] >> ((p % 4) * 2)) & 3;
+            std::memcpy(rgba + p * 4, palette[index], 4);
+        }
+    }
+
+    void TextureCooker::DecodeBC4(const u8 * in, const u32 channel, u8 * rgba) {
+        u8 palette[8];
+        BC4Palette(in[0], in[1], palette);
+        u64 bits = 0;
+        for (u32 i = 0; i < 6; ++i) bits |= u64(in[2 + i]) << (i * 8);
+        for (u32 p = 0; p < 16; ++p) {
+            rgba[p * 4 + channel] = palette[(bits >> (p * 3)) & 7];
+        }
+    }
+
+    void TextureCooker::DecodeBC5(const u8 * in, u8 * rgba) {
+        DecodeBC4(in, 0, rgba);
+        DecodeBC4(in + 8, 1, rgba);
+    }
+
+    void TextureCooker::DecodeBC7(const u8 * in, u8 * rgba) {
+        BlockBitReader_ reader{ in };
+        u32 mode = 0;
+        while (mode < 8 && reader.Read(1) == 0) ++mode;
+        if (mode != 6) {
+            // Unsupported mode - output magenta so it stands out
+            for (u32 p = 0; p < 16; ++p) {
+                rgba[p * 4 + 0] = 255;
+                rgba[p * 4 + 1] = 0;
+                rgba[p * 4 + 2] = 255;
+                rgba[p * 4 + 3] = 255;
+            }
+            return;
+        }
+
+        u32 endpoints[2][4];
+        for (u32 c = 0; c < 4; ++c) {
+            endpoints[0][c] = reader.Read(7) << 1;
+            endpoints[1][c] = reader.Read(7) << 1;
+        }
+        const u32 p0 = reader.Read(1);
+        const u32 p1 = reader.Read(1);
+        for (u32 c = 0; c < 4; ++c) {
+            endpoints[0][c] |= p0;
+            endpoints[1][c] |= p1;
+        }
+
+        for (u32 p = 0; p < 16; ++p) {
+            const u32 index = reader.Read(p == 0 ? 3 : 4);
+            for (u32 c = 0; c < 4; ++c) {
+                rgba[p * 4 + c] = u8(((64 - bc7Weights4[index]) * i32(endpoints[0][c]) + bc7Weights4[index] * i32(endpoints[1][c]) + 32) >> 6);
+            }
+        }
+    }
+
+    // Expands 1-4 channel pixels into RGBA8
+    static std::vector<u8> ExpandToRgba(const u8 * pixels, const u32 width, const u32 height, const u32 numChannels) {
+        const usize numPixels = usize(width) * usize(height);
+        std::vector<u8> rgba(numPixels * 4);
+        for (usize i = 0; i < numPixels; ++i) {
+            const u8 * src = pixels + i * numChannels;
+            u8 * dst = rgba.data() + i * 4;
+            switch (numChannels) {
+            case 1: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = 255; break;
+            case 2: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = src[1]; break;
+            case 3: dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255; break;
+            default: std::memcpy(dst, src, 4); break;
+            }
+        }
+        return rgba;
+    }
+
+    // Rows of blocks compressed by a single work item
+    static constexpr u32 blockRowsPerTile = 8;
+
+    // Compresses block rows [firstBlockRow, lastBlockRow) of an RGBA8 level into mip, which must already be sized
+    static void CompressBlockRows(const MipLevel& rgba, const TextureCompression compression, const u32 firstBlockRow, const u32 lastBlockRow, CookedMip& mip) {
+        const u32 width = rgba.width;
+        const u32 height = rgba.height;
+        const u32 blocksX = std::max<u32>(1, (width + 3) / 4);
+        const usize blockBytes = TextureCooker::BlockBytes(compression);
+
+        u8 block[64];
+        for (u32 by = firstBlockRow; by < lastBlockRow; ++by) {
+            for (u32 bx = 0; bx < blocksX; ++bx) {
+                // Blocks hanging off the edge repeat the last row/column
+                for (u32 j = 0; j < 4; ++j) {
+                    const u32 y = std::min(by * 4 + j, height - 1);
+                    for (u32 i = 0; i < 4; ++i) {
+                        const u32 x = std::min(bx * 4 + i, width - 1);
+                        std::memcpy(block + (j * 4 + i) * 4, rgba.data.data() + (usize(y) * width + x) * 4, 4);
+                    }
+                }
+
+                u8 * out = mip.data.data() + (usize(by) * blocksX + bx) * blockBytes;
+                switch (compression) {
+                case TextureCompression::BC1: TextureCooker::EncodeBC1(block, out); break;
+                case TextureCompression::BC4: TextureCooker::EncodeBC4(block, 0, out); break;
+                case TextureCompression::BC5: TextureCooker::EncodeBC5(block, out); break;
+                default: TextureCooker::EncodeBC7(block, out); break;
+                }
+            }
+        }
+    }
+
+    CookedTexturePtr TextureCooker::Cook(
+        const u8 * pixels,
+        const u32 width,
+        const u32 height,
+        const u32 numChannels,
+        const TextureUsage usage,
+        const bool srgb,
+        const u64 key,
+        const float alphaCoverageThreshold) {
+
+        if (pixels == nullptr || width == 0 || height == 0 || numChannels < 1 || numChannels > 4) return nullptr;
+
+        auto cooked = std::make_shared<CookedTexture>();
+        cooked->compression = SelectCompression(usage, numChannels);
+        // Only the color formats have sRGB variants
+        cooked->srgb = srgb && (cooked->compression == TextureCompression::BC1 || cooked->compression == TextureCompression::BC7);
+        cooked->width = width;
+        cooked->height = height;
+        cooked->key = key;
+
+        MipGenerationOptions options;
+        options.srgb = srgb;
+        options.normalMap = usage == TextureUsage::NORMAL_MAP;
+        options.alphaCoverageThreshold = alphaCoverageThreshold;
+        const std::vector<u8> rgba = ExpandToRgba(pixels, width, height, numChannels);
+        const std::vector<MipLevel> levels = MipGenerator::Generate(rgba.data(), width, height, 4, options);
+
+        // Every level is known up front so blocks from all of them can be compressed at once
+        std::vector<std::pair<u32, u32>> tiles;
+        cooked->mips.resize(levels.size());
+        for (u32 level = 0; level < levels.size(); ++level) {
+            CookedMip& mip = cooked->mips[level];
+            mip.width = levels[level].width;
+            mip.height = levels[level].height;
+            mip.data.resize(CompressedSize(cooked->compression, mip.width, mip.height));
+
+            const u32 blocksY = std::max<u32>(1, (mip.height + 3) / 4);
+            for (u32 row = 0; row < blocksY; row += blockRowsPerTile) {
+                tiles.push_back(std::make_pair(level, row));
+            }
+        }
+
+        MipGenerator::ForEach(tiles.size(), [&](const usize index) {
+            const u32 level = tiles[index].first;
+            const u32 firstBlockRow = tiles[index].second;
+            const u32 blocksY = std::max<u32>(1, (levels[level].height + 3) / 4);
+            CompressBlockRows(levels[level], cooked->compression, firstBlockRow, std::min(blocksY, firstBlockRow + blockRowsPerTile), cooked->mips[level]);
+        });
+
+        return cooked;
+    }
+
+    u64 TextureCooker::HashBytes(const void * data, const usize sizeBytes, const u64 seed) {
+        const u8 * bytes = (const u8 *)data;
+        u64 hash = seed;
+        for (usize i = 0; i < sizeBytes; ++i) {
+            hash ^= u64(bytes[i]);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    u64 TextureCooker::ComputeKey(const u64 sourceHash, const TextureUsage usage, const bool srgb, const float alphaCoverageThreshold) {
+        u32 threshold;
+        std::memcpy(&threshold, &alphaCoverageThreshold, sizeof(threshold));
+        const u32 params[4] = { u32(usage), u32(srgb), threshold, version };
+        return HashBytes(params, sizeof(params), sourceHash);
+    }
+
+    template<typename T>
+    static void WriteValue(std::vector<u8>& out, const T& value) {
+        const usize offset = out.size();
+        out.resize(offset + sizeof(T));
+        std::memcpy(out.data() + offset, &value, sizeof(T));
+    }
+
+    template<typename T>
+    static bool ReadValue(const u8 * data, const usize sizeBytes, usize& offset, T& value) {
+        if (offset + sizeof(T) > sizeBytes) return false;
+        std::memcpy(&value, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    void TextureCooker::Serialize(const CookedTexture& cooked, std::vector<u8>& out) {
+        out.clear();
+        out.reserve(64 + cooked.SizeBytes());
+        WriteValue(out, cookedMagic);
+        WriteValue(out, version);
+        WriteValue(out, cooked.key);
+        WriteValue(out, u32(cooked.compression));
+        WriteValue(out, u32(cooked.srgb));
+        WriteValue(out, cooked.width);
+        WriteValue(out, cooked.height);
+        WriteValue(out, u32(cooked.mips.size()));
+        for (const auto& mip : cooked.mips) {
+            WriteValue(out, mip.width);
+            WriteValue(out, mip.height);
+            WriteValue(out, u64(mip.data.size()));
+            out.insert(out.end(), mip.data.begin(), mip.data.end());
+        }
+    }
+
+    CookedTexturePtr TextureCooker::Deserialize(const u8 * data, const usize sizeBytes) {
+        usize offset = 0;
+        u32 magic, fileVersion, compression, srgb, numMips;
+        auto cooked = std::make_shared<CookedTexture>();
+
+        if (!ReadValue(data, sizeBytes, offset, magic) || magic != cookedMagic) return nullptr;
+        if (!ReadValue(data, sizeBytes, offset, fileVersion) || fileVersion != version) return nullptr;
+        if (!ReadValue(data, sizeBytes, offset, cooked->key)) return nullptr;
+        if (!ReadValue(data, sizeBytes, offset, compression)) return nullptr;
+        if (!ReadValue(data, sizeBytes, offset, srgb)) return nullptr;
+        if (!ReadValue(data, sizeBytes, offset, cooked->width)) return nullptr;
+        if (!ReadValue(data, sizeBytes, offset, cooked->height)) return nullptr;
+        if (!ReadValue(data, sizeBytes, offset, numMips)) return nullptr;
+
+        if (compression < u32(TextureCompression::BC1) || compression > u32(TextureCompression::BC7)) return nullptr;
+        // A full chain for a 2^32 texture is at most 33 levels
+        if (numMips == 0 || numMips > 33) return nullptr;
+
+        cooked->compression = TextureCompression(compression);
+        cooked->srgb = srgb != 0;
+        cooked->mips.resize(numMips);
+        for (auto& mip : cooked->mips) {
+            u64 mipBytes;
+            if (!ReadValue(data, sizeBytes, offset, mip.width)) return nullptr;
+            if (!ReadValue(data, sizeBytes, offset, mip.height)) return nullptr;
+            if (!ReadValue(data, sizeBytes, offset, mipBytes)) return nullptr;
+            if (mipBytes != CompressedSize(cooked->compression, mip.width, mip.height)) return nullptr;
+            if (offset + mipBytes > sizeBytes) return nullptr;
+            mip.data.assign(data + offset, data + offset + mipBytes);
+            offset += usize(mipBytes);
+        }
+
+        return cooked;
+    }
+
+    TextureCookCache::TextureCookCache(const std::string& directory)
+        : directory_(directory) {}
+
+    std::string TextureCookCache::PathFor(const u64 key) const {
+        std::stringstream path;
+        path << directory_ << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".stxc";
+        return path.str();
+    }
+
+    CookedTexturePtr TextureCookCache::Load(const u64 key) const {
+        std::ifstream file(PathFor(key), std::ios::in | std::ios::binary);
+        if (!file.is_open()) return nullptr;
+
+        std::vector<u8> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        auto cooked = TextureCooker::Deserialize(bytes.data(), bytes.size());
+        // Guard against hash collisions in the file name
+        if (cooked == nullptr || cooked->key != key) return nullptr;
+        return cooked;
+    }
+
+    template<typename T>
+    static bool ReadValue(std::ifstream& file, T& value) {
+        file.read((char *)&value, sizeof(T));
+        return file.good();
+    }
+
+    bool TextureCookCache::LoadMip(const u64 key, const u32 mip, CookedMip& out) const {
+        std::ifstream file(PathFor(key), std::ios::in | std::ios::binary);
+        if (!file.is_open()) return false;
+
+        // Same layout as TextureCooker::Serialize
+        u32 magic, fileVersion, compression, srgb, width, height, numMips;
+        u64 fileKey;
+        if (!ReadValue(file, magic) || magic != cookedMagic) return false;
+        if (!ReadValue(file, fileVersion) || fileVersion != TextureCooker::version) return false;
+        if (!ReadValue(file, fileKey) || fileKey != key) return false;
+        if (!ReadValue(file, compression) || !ReadValue(file, srgb)) return false;
+        if (!ReadValue(file, width) || !ReadValue(file, height)) return false;
+        if (!ReadValue(file, numMips) || mip >= numMips) return false;
+
+        // Skip over the finer levels without reading them
+        for (u32 level = 0; level <= mip; ++level) {
+            u64 size;
+            if (!ReadValue(file, out.width) || !ReadValue(file, out.height) || !ReadValue(file, size)) return false;
+            if (level < mip) {
+                file.seekg(std::streamoff(size), std::ios::cur);
+                continue;
+            }
+
+            out.data.resize(usize(size));
+            file.read((char *)out.data.data(), std::streamsize(size));
+            return file.good() || (file.eof() && usize(file.gcount()) == usize(size));
+        }
+
+        return false;
+    }
+
+    bool TextureCookCache::Store(const CookedTexture& cooked) const {
+        std::error_code error;
+        std::filesystem::create_directories(directory_, error);
+        if (error) return false;
+
+        std::vector<u8> bytes;
+        TextureCooker::Serialize(cooked, bytes);
+
+        // Write to a temporary file first so that concurrent loaders never see a partial file
+        const std::string path = PathFor(cooked.key);
+        const std::string tmp = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) return false;
+            file.write((const char *)bytes.data(), std::streamsize(bytes.size()));
+            if (!file.good()) return false;
+        }
+
+        std::filesystem::rename(tmp, path, error);
+        if (error) {
+            std::filesystem::remove(tmp, error);
+            return false;
+        }
+
+        return true;
+    }
+}
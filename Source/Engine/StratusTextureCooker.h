@@ -0,0 +1,117 @@
+#pragma once
+
+#include "StratusTexture.h"
+#include "StratusTypes.h"
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace stratus {
+    // What a texture is used for - this decides which block format it is cooked to
+    enum class TextureUsage : i32 {
+        GENERIC,
+        ALBEDO,
+        NORMAL_MAP,
+        ROUGHNESS,
+        METALLIC,
+        // glTF style packed map (roughness in G, metallic in B)
+        METALLIC_ROUGHNESS,
+        EMISSIVE
+    };
+
+    struct CookedMip {
+        u32 width = 0;
+        u32 height = 0;
+        std::vector<u8> data;
+    };
+
+    // Block compressed texture with its full mip chain
+    struct CookedTexture {
+        TextureCompression compression = TextureCompression::NONE;
+        bool srgb = false;
+        u32 width = 0;
+        u32 height = 0;
+        // Key the texture was cooked under (see TextureCooker::ComputeKey)
+        u64 key = 0;
+        std::vector<CookedMip> mips;
+
+        usize SizeBytes() const;
+        // Format to pair with compression inside of a TextureConfig
+        TextureComponentFormat Format() const;
+        // Views into mips which stay valid as long as this object is alive
+        std::vector<TextureMipData> MipData() const;
+    };
+
+    typedef std::shared_ptr<CookedTexture> CookedTexturePtr;
+
+    // Converts decoded 8-bit images into BC1/BC4/BC5/BC7 along with a precomputed mip chain.
+    // Everything here is CPU only so it can run on worker threads or offline.
+    class TextureCooker {
+    public:
+        // Bumped whenever the encoder output changes so old cache entries are ignored
+        static constexpr u32 version = 2;
+
+        static TextureCompression SelectCompression(const TextureUsage usage, const u32 numChannels);
+
+        // pixels are tightly packed with numChannels (1-4) bytes per pixel. Mips are built with
+        // MipGenerator, which also receives alphaCoverageThreshold (0 disables coverage preservation).
+        static CookedTexturePtr Cook(
+            const u8 * pixels,
+            const u32 width,
+            const u32 height,
+            const u32 numChannels,
+            const TextureUsage usage,
+            const bool srgb,
+            const u64 key,
+            const float alphaCoverageThreshold = 0.0f
+        );
+
+        // Block sizes in bytes
+        static usize BlockBytes(const TextureCompression);
+        static usize CompressedSize(const TextureCompression, const u32 width, const u32 height);
+
+        // Encoders take a 4x4 block of RGBA8 pixels (64 bytes, row major)
+        static void EncodeBC1(const u8 * rgba, u8 * out);
+        // channel selects which of the RGBA components to encode
+        static void EncodeBC4(const u8 * rgba, const u32 channel, u8 * out);
+        // Encodes R and G
+        static void EncodeBC5(const u8 * rgba, u8 * out);
+        // Always emits mode 6 (single subset, RGBA endpoints, 4 bit indices)
+        static void EncodeBC7(const u8 * rgba, u8 * out);
+
+        // Decoders write a 4x4 block of RGBA8 pixels. DecodeBC7 only understands mode 6.
+        static void DecodeBC1(const u8 * in, u8 * rgba);
+        static void DecodeBC4(const u8 * in, const u32 channel, u8 * rgba);
+        static void DecodeBC5(const u8 * in, u8 * rgba);
+        static void DecodeBC7(const u8 * in, u8 * rgba);
+
+        // 64-bit FNV-1a
+        static u64 HashBytes(const void * data, const usize sizeBytes, const u64 seed = 14695981039346656037ULL);
+        // Combines the source content hash with everything that affects the cooked output
+        static u64 ComputeKey(const u64 sourceHash, const TextureUsage usage, const bool srgb, const float alphaCoverageThreshold = 0.0f);
+
+        static void Serialize(const CookedTexture&, std::vector<u8>& out);
+        // Returns nullptr if the data is not a valid cooked texture for this version
+        static CookedTexturePtr Deserialize(const u8 * data, const usize sizeBytes);
+    };
+
+    // On-disk cache of cooked textures keyed by TextureCooker::ComputeKey
+    class TextureCookCache {
+    public:
+        TextureCookCache(const std::string& directory);
+
+        const std::string& Directory() const { return directory_; }
+        std::string PathFor(const u64 key) const;
+
+        // Returns nullptr on a miss
+        CookedTexturePtr Load(const u64 key) const;
+        // Reads a single level without loading the rest of the file. Used for streaming.
+        bool LoadMip(const u64 key, const u32 mip, CookedMip& out) const;
+        bool Store(const CookedTexture&) const;
+
+    private:
+        std::string directory_;
+    };
+
+    typedef std::shared_ptr<TextureCookCache> TextureCookCachePtr;
+}
@@ -0,0 +1,64 @@
+#include "StratusTextureDedup.h"
+
+namespace stratus {
+    u64 TextureDedupTable::HashSources(const std::vector<std::vector<char>>& sources) {
+        u64 hash = TextureCooker::HashBytes(nullptr, 0);
+        for (const std::vector<char>& source : sources) {
+            hash = TextureCooker::HashBytes(source.data(), source.size(), hash);
+        }
+        return hash;
+    }
+
+    u64 TextureDedupTable::ContentKey(const u64 sourceHash, const TextureContentSettings& settings) {
+        const i32 params[] = { i32(settings.type), i32(settings.wrap), i32(settings.min), i32(settings.mag) };
+        return TextureCooker::HashBytes(params, sizeof(params),
+            TextureCooker::ComputeKey(sourceHash, settings.usage, settings.srgb, settings.alphaCoverageThreshold));
+    }
+
+    TextureHandle TextureDedupTable::Claim(const u64 contentKey, const TextureHandle handle, const usize sourceBytes) {
+        auto it = owners_.find(contentKey);
+        if (it == owners_.end()) {
+            owners_.insert(std::make_pair(contentKey, handle));
+            ++stats_.uniqueTextures;
+            return handle;
+        }
+
+        // Claiming twice with the same handle is not a duplicate
+        if (it->second == handle) return handle;
+
+        aliases_.insert(std::make_pair(handle, it->second));
+        ++stats_.duplicateTextures;
+        stats_.sourceBytesSaved += sourceBytes;
+        return it->second;
+    }
+
+    TextureHandle TextureDedupTable::Resolve(const TextureHandle handle) const {
+        auto it = aliases_.find(handle);
+        return it == aliases_.end() ? handle : it->second;
+    }
+
+    bool TextureDedupTable::IsAlias(const TextureHandle handle) const {
+        return aliases_.find(handle) != aliases_.end();
+    }
+
+    void TextureDedupTable::SetDecodedBytes(const TextureHandle owner, const usize bytes) {
+        decodedBytes_[owner] = bytes;
+    }
+
+    TextureDedupStats TextureDedupTable::Stats() const {
+        TextureDedupStats stats = stats_;
+        stats.decodedBytesSaved = 0;
+        for (const auto& alias : aliases_) {
+            auto it = decodedBytes_.find(alias.second);
+            if (it != decodedBytes_.end()) stats.decodedBytesSaved += it->second;
+        }
+        return stats;
+    }
+
+    void TextureDedupTable::Clear() {
+        owners_.clear();
+        aliases_.clear();
+        decodedBytes_.clear();
+        stats_ = TextureDedupStats();
+    }
+}
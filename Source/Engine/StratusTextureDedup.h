@@ -0,0 +1,65 @@
+#pragma once
+
+#include "StratusHandle.h"
+#include "StratusTexture.h"
+#include "StratusTextureCooker.h"
+#include "StratusTypes.h"
+#include <unordered_map>
+#include <vector>
+
+namespace stratus {
+    struct TextureDedupStats {
+        u32 uniqueTextures = 0;
+        // Textures whose content matched one that was already loaded
+        u32 duplicateTextures = 0;
+        // Compressed source bytes that did not need to be decoded
+        usize sourceBytesSaved = 0;
+        // Decoded bytes (CPU and GPU) that did not need to be created. Only counts duplicates
+        // of textures which have finished loading.
+        usize decodedBytesSaved = 0;
+    };
+
+    // Everything besides the source bytes which changes what a loaded texture looks like
+    struct TextureContentSettings {
+        TextureUsage usage = TextureUsage::GENERIC;
+        bool srgb = false;
+        float alphaCoverageThreshold = 0.0f;
+        TextureType type = TextureType::TEXTURE_2D;
+        TextureCoordinateWrapping wrap = TextureCoordinateWrapping::REPEAT;
+        TextureMinificationFilter min = TextureMinificationFilter::LINEAR_MIPMAP_LINEAR;
+        TextureMagnificationFilter mag = TextureMagnificationFilter::LINEAR;
+    };
+
+    // Maps texture content to the first handle which loaded it. Identical bytes loaded with the same
+    // settings produce the same texture, so later handles with that content become aliases of the
+    // first instead of decoding and uploading it again. Paths play no part - the same image under two
+    // names is one texture.
+    //
+    // Not thread safe - the resource manager only touches it under its lock.
+    class TextureDedupTable {
+    public:
+        // Hash of the source bytes in order (one entry per cube face or array layer)
+        static u64 HashSources(const std::vector<std::vector<char>>& sources);
+        static u64 ContentKey(const u64 sourceHash, const TextureContentSettings&);
+
+        // Returns the handle which owns the content. This is handle itself the first time the content is seen.
+        TextureHandle Claim(const u64 contentKey, const TextureHandle handle, const usize sourceBytes);
+        // Returns the owner for aliases and handle itself otherwise. Owners are never aliases.
+        TextureHandle Resolve(const TextureHandle handle) const;
+        bool IsAlias(const TextureHandle handle) const;
+        // Duplicate handle -> handle which owns the content
+        const std::unordered_map<TextureHandle, TextureHandle>& Aliases() const { return aliases_; }
+
+        // Called once a unique texture has been decoded so the stats know what each alias saved
+        void SetDecodedBytes(const TextureHandle owner, const usize bytes);
+        TextureDedupStats Stats() const;
+
+        void Clear();
+
+    private:
+        std::unordered_map<u64, TextureHandle> owners_;
+        std::unordered_map<TextureHandle, TextureHandle> aliases_;
+        std::unordered_map<TextureHandle, usize> decodedBytes_;
+        TextureDedupStats stats_;
+    };
+}
@@ -0,0 +1,136 @@
+#include "StratusTextureLoadQueue.h"
+#include <algorithm>
+
+namespace stratus {
+    TextureLoadQueue::TextureLoadQueue(const usize budgetBytes)
+        : budget_(budgetBytes) {
+        stats_.budgetBytes = budgetBytes;
+    }
+
+    void TextureLoadQueue::SetBudget(const usize budgetBytes) {
+        budget_ = budgetBytes;
+        stats_.budgetBytes = budgetBytes;
+    }
+
+    void TextureLoadQueue::Push(const TextureHandle handle, const usize estimatedSourceBytes) {
+        if (Contains(handle)) return;
+
+        Entry_ entry;
+        entry.sourceBytes = estimatedSourceBytes;
+        entry.order = nextOrder_++;
+        entries_.insert(std::make_pair(handle, entry));
+        ++stats_.stageCounts[usize(TextureLoadStage::QUEUED)];
+    }
+
+    void TextureLoadQueue::Prioritize(const TextureHandle handle, const bool visible, const float priority) {
+        auto it = entries_.find(handle);
+        if (it == entries_.end()) return;
+        it->second.visible = visible;
+        it->second.priority = priority;
+    }
+
+    std::vector<TextureHandle> TextureLoadQueue::SortedInStage_(const TextureLoadStage stage) const {
+        std::vector<std::pair<TextureHandle, const Entry_ *>> candidates;
+        for (const auto& entry : entries_) {
+            if (entry.second.stage == stage) candidates.push_back(std::make_pair(entry.first, &entry.second));
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+            if (a.second->visible != b.second->visible) return a.second->visible;
+            if (a.second->priority != b.second->priority) return a.second->priority > b.second->priority;
+            return a.second->order < b.second->order;
+        });
+
+        std::vector<TextureHandle> result(candidates.size());
+        for (usize i = 0; i < candidates.size(); ++i) result[i] = candidates[i].first;
+        return result;
+    }
+
+    void TextureLoadQueue::Move_(Entry_& entry, const TextureLoadStage stage, const usize bytesHeld) {
+        --stats_.stageCounts[usize(entry.stage)];
+        ++stats_.stageCounts[usize(stage)];
+
+        const bool wasReading = entry.stage == TextureLoadStage::READING || entry.stage == TextureLoadStage::READ;
+        const bool isReading = stage == TextureLoadStage::READING || stage == TextureLoadStage::READ;
+        if (wasReading) readBytes_ -= entry.bytesHeld;
+        if (isReading) readBytes_ += bytesHeld;
+
+        stats_.bytesInFlight = stats_.bytesInFlight - entry.bytesHeld + bytesHeld;
+        stats_.peakBytesInFlight = std::max(stats_.peakBytesInFlight, stats_.bytesInFlight);
+        entry.stage = stage;
+        entry.bytesHeld = bytesHeld;
+    }
+
+    bool TextureLoadQueue::AnyInStagesFrom_(const TextureLoadStage first) const {
+        for (i32 stage = i32(first); stage < i32(TextureLoadStage::NUM_STAGES); ++stage) {
+            if (stats_.stageCounts[stage] > 0) return true;
+        }
+        return false;
+    }
+
+    std::vector<TextureHandle> TextureLoadQueue::AdmitReads() {
+        std::vector<TextureHandle> admitted;
+        const usize readBudget = budget_ / 4;
+        for (const TextureHandle handle : SortedInStage_(TextureLoadStage::QUEUED)) {
+            Entry_& entry = entries_.find(handle)->second;
+            const bool fits = readBytes_ + entry.sourceBytes <= readBudget &&
+                stats_.bytesInFlight + entry.sourceBytes <= budget_;
+            // Strict priority order - nothing behind a texture that does not fit gets to skip ahead
+            if (!fits && AnyInStagesFrom_(TextureLoadStage::READING)) break;
+
+            Move_(entry, TextureLoadStage::READING, entry.sourceBytes);
+            admitted.push_back(handle);
+        }
+        return admitted;
+    }
+
+    void TextureLoadQueue::FinishRead(const TextureHandle handle, const usize sourceBytes, const usize decodedBytes) {
+        auto it = entries_.find(handle);
+        if (it == entries_.end() || it->second.stage != TextureLoadStage::READING) return;
+
+        it->second.sourceBytes = sourceBytes;
+        it->second.decodedBytes = decodedBytes;
+        Move_(it->second, TextureLoadStage::READ, sourceBytes);
+    }
+
+    std::vector<TextureHandle> TextureLoadQueue::AdmitDecodes() {
+        std::vector<TextureHandle> admitted;
+        for (const TextureHandle handle : SortedInStage_(TextureLoadStage::READ)) {
+            Entry_& entry = entries_.find(handle)->second;
+            const usize bytes = entry.sourceBytes + entry.decodedBytes;
+            // Only textures past this stage are guaranteed to give memory back, so if there are none
+            // this one has to go ahead regardless
+            const bool fits = stats_.bytesInFlight - entry.bytesHeld + bytes <= budget_;
+            if (!fits && AnyInStagesFrom_(TextureLoadStage::DECODING)) break;
+
+            Move_(entry, TextureLoadStage::DECODING, bytes);
+            admitted.push_back(handle);
+        }
+        return admitted;
+    }
+
+    void TextureLoadQueue::SetStage(const TextureHandle handle, const TextureLoadStage stage, const usize bytesHeld) {
+        auto it = entries_.find(handle);
+        if (it == entries_.end() || stage == TextureLoadStage::NUM_STAGES) return;
+        Move_(it->second, stage, bytesHeld);
+    }
+
+    void TextureLoadQueue::Finish(const TextureHandle handle) {
+        auto it = entries_.find(handle);
+        if (it == entries_.end()) return;
+
+        Move_(it->second, it->second.stage, 0);
+        --stats_.stageCounts[usize(it->second.stage)];
+        ++stats_.completed;
+        entries_.erase(it);
+    }
+
+    bool TextureLoadQueue::Contains(const TextureHandle handle) const {
+        return entries_.find(handle) != entries_.end();
+    }
+
+    TextureLoadStage TextureLoadQueue::Stage(const TextureHandle handle) const {
+        auto it = entries_.find(handle);
+        return it == entries_.end() ? TextureLoadStage::NUM_STAGES : it->second.stage;
+    }
+}
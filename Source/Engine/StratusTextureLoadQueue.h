@@ -0,0 +1,93 @@
+#pragma once
+
+#include "StratusHandle.h"
+#include "StratusTexture.h"
+#include "StratusTypes.h"
+#include <unordered_map>
+#include <vector>
+
+namespace stratus {
+    // Textures move through these in order. Any stage can end early on failure.
+    enum class TextureLoadStage : i32 {
+        // Waiting for budget to read the source
+        QUEUED,
+        READING,
+        // Source is in memory, waiting for budget to decode
+        READ,
+        DECODING,
+        GENERATING_MIPS,
+        // Decoded and waiting on the application thread
+        UPLOADING,
+        NUM_STAGES
+    };
+
+    struct TextureLoadStats {
+        usize budgetBytes = 0;
+        // Memory held by textures between being admitted and finishing their upload
+        usize bytesInFlight = 0;
+        usize peakBytesInFlight = 0;
+        // Queue depth of each stage, indexed by TextureLoadStage
+        u32 stageCounts[usize(TextureLoadStage::NUM_STAGES)] = {};
+        u32 completed = 0;
+    };
+
+    // CPU side scheduling for texture loads. Keeps the memory held by loads in progress under a byte budget
+    // and decides which textures move to the next stage, highest priority first. It does no work itself -
+    // the caller runs the stages and reports back.
+    //
+    // A texture reserves its source size when it starts reading and its decoded size when it starts decoding.
+    // Reads are limited to a quarter of the budget so there is always room left to decode. If nothing ahead
+    // of a texture is holding memory it is admitted even if it is over budget so that oversized textures
+    // still load.
+    class TextureLoadQueue {
+    public:
+        TextureLoadQueue(const usize budgetBytes);
+
+        void SetBudget(const usize budgetBytes);
+        usize Budget() const { return budget_; }
+
+        void Push(const TextureHandle, const usize estimatedSourceBytes);
+        // Visible textures go before hidden ones, then larger priority goes first. Ties go in the order
+        // they were pushed. Only matters for textures which have not started decoding.
+        void Prioritize(const TextureHandle, const bool visible, const float priority);
+
+        // QUEUED -> READING for as many textures as fit
+        std::vector<TextureHandle> AdmitReads();
+        // READING -> READ. decodedBytes is the estimated peak memory while decoding.
+        void FinishRead(const TextureHandle, const usize sourceBytes, const usize decodedBytes);
+        // READ -> DECODING for as many textures as fit
+        std::vector<TextureHandle> AdmitDecodes();
+        // Moves a texture to a later stage and updates how much memory it is holding
+        void SetStage(const TextureHandle, const TextureLoadStage, const usize bytesHeld);
+        // Releases everything held by the texture. Valid from any stage.
+        void Finish(const TextureHandle);
+
+        bool Contains(const TextureHandle) const;
+        TextureLoadStage Stage(const TextureHandle) const;
+        usize Size() const { return entries_.size(); }
+        const TextureLoadStats& Stats() const { return stats_; }
+
+    private:
+        struct Entry_ {
+            TextureLoadStage stage = TextureLoadStage::QUEUED;
+            usize sourceBytes = 0;
+            usize decodedBytes = 0;
+            usize bytesHeld = 0;
+            bool visible = false;
+            float priority = 0.0f;
+            u64 order = 0;
+        };
+
+        std::vector<TextureHandle> SortedInStage_(const TextureLoadStage) const;
+        void Move_(Entry_&, const TextureLoadStage, const usize bytesHeld);
+        bool AnyInStagesFrom_(const TextureLoadStage) const;
+
+    private:
+        std::unordered_map<TextureHandle, Entry_> entries_;
+        usize budget_;
+        // Source bytes held by READING and READ
+        usize readBytes_ = 0;
+        u64 nextOrder_ = 0;
+        TextureLoadStats stats_;
+    };
+}
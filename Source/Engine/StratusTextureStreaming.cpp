@@ -0,0 +1,227 @@
+#include "StratusTextureStreaming.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace stratus {
+    u32 TexturePageLayout::FirstTailMip() const {
+        if (numSparseLevels > 0) return std::min(numSparseLevels, numMips);
+
+        u32 mip = 0;
+        while (mip < numMips && MipWidth(mip) >= pageWidth && MipHeight(mip) >= pageHeight) ++mip;
+        return mip;
+    }
+
+    usize TexturePageLayout::PagesInMip(const u32 mip) const {
+        const usize pagesX = (usize(MipWidth(mip)) + pageWidth - 1) / pageWidth;
+        const usize pagesY = (usize(MipHeight(mip)) + pageHeight - 1) / pageHeight;
+        return pagesX * pagesY;
+    }
+
+    usize TexturePageLayout::TailBytes() const {
+        // Tail levels are packed together by the driver so estimate from their combined area
+        usize texels = 0;
+        for (u32 mip = FirstTailMip(); mip < numMips; ++mip) {
+            texels += usize(MipWidth(mip)) * usize(MipHeight(mip));
+        }
+        const usize pageTexels = usize(pageWidth) * usize(pageHeight);
+        return std::max<usize>(1, (texels + pageTexels - 1) / pageTexels) * pageBytes;
+    }
+
+    usize TexturePageLayout::BytesFrom(const u32 finestMip) const {
+        usize bytes = TailBytes();
+        for (u32 mip = finestMip; mip < FirstTailMip(); ++mip) {
+            bytes += PagesInMip(mip) * pageBytes;
+        }
+        return bytes;
+    }
+
+    TextureStreamer::TextureStreamer(const usize budgetBytes, const u32 maxCommitsPerUpdate)
+        : budget_(budgetBytes), maxCommitsPerUpdate_(std::max<u32>(1, maxCommitsPerUpdate)) {
+        stats_.budgetBytes = budgetBytes;
+    }
+
+    void TextureStreamer::SetBudget(const usize budgetBytes) {
+        budget_ = budgetBytes;
+        stats_.budgetBytes = budgetBytes;
+    }
+
+    void TextureStreamer::Register(const TextureHandle handle, const TexturePageLayout& layout) {
+        if (IsRegistered(handle)) return;
+
+        Entry_ entry;
+        entry.layout = layout;
+        entry.layout.numMips = std::max<u32>(1, layout.numMips);
+        entry.residentMip = entry.layout.FirstTailMip();
+        entry.requestedMip = entry.residentMip;
+        entry.targetMip = entry.residentMip;
+        entry.lastRequestUpdate = updateCount_;
+
+        // The tail is required so it is accounted for even if it pushes us over budget
+        residentBytes_ += entry.layout.TailBytes();
+        entries_.insert(std::make_pair(handle, entry));
+
+        stats_.numTextures = u32(entries_.size());
+        stats_.residentBytes = residentBytes_;
+    }
+
+    void TextureStreamer::Unregister(const TextureHandle handle) {
+        auto it = entries_.find(handle);
+        if (it == entries_.end()) return;
+
+        residentBytes_ -= it->second.layout.BytesFrom(it->second.residentMip);
+        entries_.erase(it);
+
+        stats_.numTextures = u32(entries_.size());
+        stats_.residentBytes = residentBytes_;
+    }
+
+    bool TextureStreamer::IsRegistered(const TextureHandle handle) const {
+        return entries_.find(handle) != entries_.end();
+    }
+
+    void TextureStreamer::RequestMip(const TextureHandle handle, const u32 mip) {
+        auto it = entries_.find(handle);
+        if (it == entries_.end()) return;
+
+        Entry_& entry = it->second;
+        entry.requestedMip = entry.requested ? std::min(entry.requestedMip, mip) : mip;
+        entry.requested = true;
+    }
+
+    void TextureStreamer::RequestScreenSize(const TextureHandle handle, const float screenPixels) {
+        auto it = entries_.find(handle);
+        if (it == entries_.end()) return;
+
+        const TexturePageLayout& layout = it->second.layout;
+        RequestMip(handle, RequiredMip(layout.width, layout.height, layout.numMips, screenPixels));
+    }
+
+    u32 TextureStreamer::ResidentMip(const TextureHandle handle) const {
+        auto it = entries_.find(handle);
+        return it == entries_.end() ? 0 : it->second.residentMip;
+    }
+
+    bool TextureStreamer::EvictOne_(const TextureHandle exclude, std::vector<TextureStreamingAction>& actions) {
+        Entry_ * victim = nullptr;
+        TextureHandle victimHandle;
+        for (auto& entry : entries_) {
+            Entry_& e = entry.second;
+            // Only levels finer than what is currently needed can go
+            if (entry.first == exclude || e.residentMip >= e.targetMip) continue;
+
+            const bool better = victim == nullptr ||
+                e.lastRequestUpdate < victim->lastRequestUpdate ||
+                (e.lastRequestUpdate == victim->lastRequestUpdate && e.residentMip < victim->residentMip) ||
+                (e.lastRequestUpdate == victim->lastRequestUpdate && e.residentMip == victim->residentMip && entry.first < victimHandle);
+            if (better) {
+                victim = &e;
+                victimHandle = entry.first;
+            }
+        }
+
+        if (victim == nullptr) return false;
+
+        const u32 mip = victim->residentMip;
+        residentBytes_ -= victim->layout.PagesInMip(mip) * victim->layout.pageBytes;
+        ++victim->residentMip;
+        actions.push_back(TextureStreamingAction{ victimHandle, mip, false });
+        ++stats_.uncommits;
+        return true;
+    }
+
+    std::vector<TextureStreamingAction> TextureStreamer::Update() {
+        ++updateCount_;
+        stats_.commits = 0;
+        stats_.uncommits = 0;
+        stats_.deferred = 0;
+        stats_.requestedBytes = 0;
+
+        struct Candidate {
+            TextureHandle handle;
+            u32 mip;
+            // How many levels the texture is away from its target
+            u32 distance;
+        };
+
+        // Coarser levels first, then textures furthest from their target
+        const auto lowerPriority = [](const Candidate& a, const Candidate& b) {
+            if (a.mip != b.mip) return a.mip < b.mip;
+            if (a.distance != b.distance) return a.distance < b.distance;
+            return a.handle > b.handle;
+        };
+        std::priority_queue<Candidate, std::vector<Candidate>, decltype(lowerPriority)> candidates(lowerPriority);
+
+        for (auto& entry : entries_) {
+            Entry_& e = entry.second;
+            const u32 tail = e.layout.FirstTailMip();
+            e.targetMip = e.requested ? std::min(e.requestedMip, tail) : tail;
+            if (e.requested) e.lastRequestUpdate = updateCount_;
+            e.requested = false;
+
+            stats_.requestedBytes += e.layout.BytesFrom(e.targetMip);
+            if (e.residentMip > e.targetMip) {
+                candidates.push(Candidate{ entry.first, e.residentMip - 1, e.residentMip - e.targetMip });
+            }
+        }
+
+        std::vector<TextureStreamingAction> actions;
+
+        // The budget may have been lowered since the last update
+        while (residentBytes_ > budget_ && EvictOne_(TextureHandle::Null(), actions))
+            ;
+
+        while (candidates.size() > 0) {
+            const Candidate next = candidates.top();
+            candidates.pop();
+
+            if (stats_.commits >= maxCommitsPerUpdate_) {
+                ++stats_.deferred;
+                continue;
+            }
+
+            Entry_& e = entries_.find(next.handle)->second;
+            const usize bytes = e.layout.PagesInMip(next.mip) * e.layout.pageBytes;
+            while (residentBytes_ + bytes > budget_ && EvictOne_(next.handle, actions))
+                ;
+
+            // Finer levels of this texture are dropped as well since they depend on this one
+            if (residentBytes_ + bytes > budget_) {
+                ++stats_.deferred;
+                continue;
+            }
+
+            residentBytes_ += bytes;
+            e.residentMip = next.mip;
+            actions.push_back(TextureStreamingAction{ next.handle, next.mip, true });
+            ++stats_.commits;
+
+            if (e.residentMip > e.targetMip) {
+                candidates.push(Candidate{ next.handle, e.residentMip - 1, e.residentMip - e.targetMip });
+            }
+        }
+
+        stats_.residentBytes = residentBytes_;
+        return actions;
+    }
+
+    u32 TextureStreamer::RequiredMip(const u32 width, const u32 height, const u32 numMips, const float screenPixels) {
+        const u32 coarsest = numMips > 0 ? numMips - 1 : 0;
+        if (screenPixels <= 0.0f) return coarsest;
+
+        const float texelsPerPixel = float(std::max(width, height)) / screenPixels;
+        if (texelsPerPixel <= 1.0f) return 0;
+        return std::min(coarsest, u32(std::floor(std::log2(texelsPerPixel))));
+    }
+
+    float TextureStreamer::EstimateScreenSize(const glm::vec3& vmin, const glm::vec3& vmax, const glm::vec3& cameraPosition, const float projectionScale) {
+        // Uses the bounding sphere's nearest point to the camera. Assumes the texture maps once across
+        // the bounds - there is no per mesh UV density information.
+        const glm::vec3 center = (vmin + vmax) * 0.5f;
+        const float radius = glm::length(vmax - vmin) * 0.5f;
+        const float distance = glm::length(center - cameraPosition) - radius;
+        if (distance <= 0.0f) return std::numeric_limits<float>::max();
+        return 2.0f * radius * projectionScale / distance;
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "StratusHandle.h"
+#include "StratusTexture.h"
+#include "StratusTypes.h"
+#include "glm/glm.hpp"
+#include <unordered_map>
+#include <algorithm>
+#include <vector>
+
+namespace stratus {
+    // Describes how the mip chain of a sparse texture maps onto virtual memory pages
+    struct TexturePageLayout {
+        u32 width = 0;
+        u32 height = 0;
+        u32 numMips = 1;
+        // Page size in texels for the texture's format
+        u32 pageWidth = DEFAULT_VIRTUAL_PAGE_SIZE_XYZ;
+        u32 pageHeight = DEFAULT_VIRTUAL_PAGE_SIZE_XYZ;
+        // Physical size of a page (64 KB for every format under ARB_sparse_texture)
+        usize pageBytes = 65536;
+        // First level of the mip tail (reported by the driver as GL_NUM_SPARSE_LEVELS_ARB). The tail is
+        // committed as a single unit and stays resident for as long as the texture is registered.
+        // 0 means it is derived from the page size.
+        u32 numSparseLevels = 0;
+
+        u32 MipWidth(const u32 mip) const { return std::max<u32>(1, width >> mip); }
+        u32 MipHeight(const u32 mip) const { return std::max<u32>(1, height >> mip); }
+        u32 FirstTailMip() const;
+        usize PagesInMip(const u32 mip) const;
+        usize TailBytes() const;
+        // Bytes needed when every level from finestMip down to and including the tail is committed
+        usize BytesFrom(const u32 finestMip) const;
+    };
+
+    struct TextureStreamingAction {
+        TextureHandle handle;
+        u32 mip;
+        // false means uncommit
+        bool commit;
+    };
+
+    struct TextureStreamingStats {
+        usize budgetBytes = 0;
+        usize residentBytes = 0;
+        // Bytes that would be resident if every request was satisfied
+        usize requestedBytes = 0;
+        u32 numTextures = 0;
+        // Counts for the most recent update
+        u32 commits = 0;
+        u32 uncommits = 0;
+        // Textures that wanted finer levels but hit the budget or the per update commit limit
+        u32 deferred = 0;
+    };
+
+    // CPU side residency bookkeeping and budget policy for streamed textures. Tracks which mip levels
+    // of each sparse texture are committed and decides what to commit/uncommit each update. It never
+    // touches the GPU itself - the caller carries out the returned actions.
+    //
+    // Policy:
+    //      1) Levels stream in coarsest first, both within a texture and across all textures.
+    //      2) Levels that are no longer requested stay resident until their memory is needed
+    //         (least recently requested textures are evicted first, finest level first).
+    //      3) The mip tail of every registered texture is always resident.
+    class TextureStreamer {
+    public:
+        TextureStreamer(const usize budgetBytes, const u32 maxCommitsPerUpdate = 16);
+
+        void SetBudget(const usize budgetBytes);
+        usize Budget() const { return budget_; }
+        void SetMaxCommitsPerUpdate(const u32 maxCommits) { maxCommitsPerUpdate_ = std::max<u32>(1, maxCommits); }
+
+        // Texture starts out with only its mip tail resident
+        void Register(const TextureHandle, const TexturePageLayout&);
+        void Unregister(const TextureHandle);
+        bool IsRegistered(const TextureHandle) const;
+
+        // Can be called any number of times between updates - the finest request wins
+        void RequestMip(const TextureHandle, const u32 mip);
+        // Requests the mip where one texel roughly maps to one pixel when the texture spans screenPixels
+        void RequestScreenSize(const TextureHandle, const float screenPixels);
+
+        // Consumes all requests made since the last update
+        std::vector<TextureStreamingAction> Update();
+
+        // Finest level currently committed (equal to FirstTailMip when only the tail is resident).
+        // Returns 0 for unknown textures.
+        u32 ResidentMip(const TextureHandle) const;
+        const TextureStreamingStats& Stats() const { return stats_; }
+
+        static u32 RequiredMip(const u32 width, const u32 height, const u32 numMips, const float screenPixels);
+        // Approximate size in pixels of the bounds' largest axis on screen. projectionScale is
+        // viewportHeight / (2 * tan(fovy / 2)).
+        static float EstimateScreenSize(const glm::vec3& vmin, const glm::vec3& vmax, const glm::vec3& cameraPosition, const float projectionScale);
+
+    private:
+        struct Entry_ {
+            TexturePageLayout layout;
+            u32 residentMip;
+            // Finest mip requested since the last update
+            u32 requestedMip;
+            bool requested = false;
+            // Finest mip this texture should be at (tail if unrequested)
+            u32 targetMip;
+            u64 lastRequestUpdate = 0;
+        };
+
+        bool EvictOne_(const TextureHandle exclude, std::vector<TextureStreamingAction>& actions);
+
+    private:
+        std::unordered_map<TextureHandle, Entry_> entries_;
+        usize budget_;
+        u32 maxCommitsPerUpdate_;
+        usize residentBytes_ = 0;
+        u64 updateCount_ = 0;
+        TextureStreamingStats stats_;
+    };
+}
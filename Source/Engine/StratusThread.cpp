@@ -1,4 +1,5 @@
 #include "StratusThread.h"
+#include "StratusProfiler.h"
 #include <chrono>
 #include <string>
 
@@ -33,19 +34,30 @@ namespace stratus {
         return **current;
     }
 
+    Thread * Thread::TryCurrent() {
+        return *GetCurrentThreadPtr();
+    }
+
     Thread::Thread(bool ownsExecutionContext) : Thread(NextThreadName(), ownsExecutionContext) {}
 
     Thread::Thread(const std::string& name, bool ownsExecutionContext)
+        : Thread(name, ownsExecutionContext, ThreadDispatchMode::MANUAL) {}
+
+    Thread::Thread(const std::string& name, bool ownsExecutionContext, ThreadDispatchMode mode)
         : name_(name),
           ownsExecutionContext_(ownsExecutionContext),
-          id_(ThreadHandle::NextHandle()) {
+          id_(ThreadHandle::NextHandle()),
+          mode_(mode) {
+
+        if (mode == ThreadDispatchMode::IMMEDIATE && !ownsExecutionContext) {
+            throw std::runtime_error("Immediate dispatch requires a thread which owns its execution context");
+        }
 
         if (ownsExecutionContext) {
             context_ = std::thread([this]() {
                 SetCurrentThread(this);
-                while (this->running_.load()) {
-                    this->ProcessNext_();
-                }
+                STRATUS_PROFILE_THREAD_NAME(name_);
+                this->Run_();
             });
         }
     }
@@ -54,7 +66,37 @@ namespace stratus {
         Dispose();
     }
 
+    void Thread::Run_() {
+        if (mode_ == ThreadDispatchMode::MANUAL) {
+            while (running_.load()) {
+                ProcessNext_();
+            }
+            return;
+        }
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> ul(mutex_);
+                wake_.wait(ul, [this]() { return frontQueue_.size() > 0 || !running_.load(); });
+                if (!running_.load()) return;
+
+                backQueue_.swap(frontQueue_);
+                processing_.store(true);
+            }
+
+            for (const ThreadFunction & func : backQueue_) {
+                STRATUS_PROFILE_SCOPE("Thread::Function");
+                func();
+            }
+            backQueue_.clear();
+            processing_.store(false);
+        }
+    }
+
     void Thread::Dispatch() {
+        // Work was already picked up when it was queued
+        if (mode_ == ThreadDispatchMode::IMMEDIATE) return;
+
         {
             std::unique_lock<std::mutex> ul(mutex_);
 
@@ -86,22 +128,34 @@ namespace stratus {
     }
 
     bool Thread::Idle() const {
+        if (mode_ == ThreadDispatchMode::IMMEDIATE) {
+            std::unique_lock<std::mutex> ul(mutex_);
+            return !processing_.load() && frontQueue_.size() == 0;
+        }
         return !processing_.load();
     }
 
     void Thread::Dispose() {
-        running_.store(false);
-        if (ownsExecutionContext_) context_.join();
+        {
+            // Taking the lock makes sure the private thread is either waiting or will see the change
+            std::unique_lock<std::mutex> ul(mutex_);
+            running_.store(false);
+        }
+        wake_.notify_all();
+        if (ownsExecutionContext_ && context_.joinable()) context_.join();
     }
 
     void Thread::Synchronize() const {
         // Wait until processing is complete
-        while (processing_.load()) std::this_thread::sleep_for(std::chrono::nanoseconds(1));
+        while (!Idle()) std::this_thread::sleep_for(std::chrono::nanoseconds(1));
     }
 
     void Thread::ProcessNext_() {
         if (processing_.load()) {
-            for (const ThreadFunction & func : backQueue_) func();
+            for (const ThreadFunction & func : backQueue_) {
+                STRATUS_PROFILE_SCOPE("Thread::Function");
+                func();
+            }
             backQueue_.clear();
             processing_.store(false); // Signal completion
         }
@@ -8,6 +8,7 @@
 #include <functional>
 #include <vector>
 #include <unordered_map>
+#include <condition_variable>
 #include "StratusHandle.h"
 #include "StratusCommon.h"
 
@@ -17,6 +18,14 @@ namespace stratus {
     typedef std::unique_ptr<Thread> ThreadPtr;
     typedef std::shared_ptr<Thread> ThreadSharedPtr;
 
+    enum class ThreadDispatchMode {
+        // Queued functions wait for the next call to Dispatch
+        MANUAL,
+        // Queued functions are picked up by the private thread as soon as they are queued and
+        // Dispatch does nothing. Requires ownsExecutionContext.
+        IMMEDIATE
+    };
+
     // A stratus thread represents a reusable thread of execution. To use it, small
     // functions should be queued for execution on it, and these functions should have
     // a finite execution time rather than being infinite.
@@ -24,6 +33,8 @@ namespace stratus {
     // To use it, functions are pushed onto the queue using Queue. These are stored
     // until the next call to Dispatch, which happens from outside the thread. This is useful
     // in the sense that the main game loop can keep all thread in-sync to some extent.
+    // Threads created with ThreadDispatchMode::IMMEDIATE skip this and start on queued
+    // functions right away.
     class Thread {
     public:
         typedef std::function<void(void)> ThreadFunction;
@@ -33,6 +44,7 @@ namespace stratus {
         // perform each function.
         Thread(bool ownsExecutionContext);
         Thread(const std::string & name, bool ownsExecutionContext);
+        Thread(const std::string & name, bool ownsExecutionContext, ThreadDispatchMode mode);
         ~Thread();
 
         Thread(const Thread&) = delete;
@@ -42,8 +54,11 @@ namespace stratus {
 
         template<typename E>
         void QueueMany(const E& functions) {
-            std::unique_lock<std::mutex> ul(mutex_);
-            for (auto & func : functions) frontQueue_.push_back(func);
+            {
+                std::unique_lock<std::mutex> ul(mutex_);
+                for (auto & func : functions) frontQueue_.push_back(func);
+            }
+            if (mode_ == ThreadDispatchMode::IMMEDIATE) wake_.notify_one();
         }
 
         void Queue(const ThreadFunction& function) {
@@ -58,7 +73,8 @@ namespace stratus {
         // Blocks the calling function until all functions from the previous call to Dispatch are complete
         void Synchronize() const;
         // Checks if the thread is ready for the next call to Dispatch meaning it is sitting idle (note that
-        // this is more of a hint since another thread could immediately call Dispatch())
+        // this is more of a hint since another thread could immediately call Dispatch()). In IMMEDIATE
+        // mode it also means nothing is queued.
         bool Idle() const;
         // Tells the thread to quit after it finishes executing the last call to Dispatch
         void Dispose();
@@ -66,15 +82,21 @@ namespace stratus {
         const std::string& Name() const;
         // Returns the unique id for this thread
         const ThreadHandle& Id() const;
+        ThreadDispatchMode DispatchMode() const { return mode_; }
 
         // Gets a reference to the underlying Thread object for the current active context it is called from
         static Thread& Current();
+        // Same as Current but returns nullptr instead of throwing when called from a thread which was not
+        // created through (or is not currently dispatching for) a stratus::Thread
+        static Thread * TryCurrent();
 
         bool operator==(const Thread & other) const { return this->id_ == other.id_; }
         bool operator!=(const Thread & other) const { return !((*this) == other); }
 
     private:
         void ProcessNext_();
+        // Loop for the private thread, returns on Dispose
+        void Run_();
 
     private:
         // May be empty if ownsExecutionContext is false
@@ -94,5 +116,8 @@ namespace stratus {
         mutable std::mutex mutex_;
         // When true it signals to the dispatch thread that it should begin its next batch of work
         std::atomic<bool> processing_{false};
+        const ThreadDispatchMode mode_;
+        // Wakes the private thread when there is work (or it is being disposed)
+        std::condition_variable wake_;
     };
 }
\ No newline at end of file
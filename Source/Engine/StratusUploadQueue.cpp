@@ -0,0 +1,196 @@
+#include "StratusUploadQueue.h"
+#include "StratusProfiler.h"
+#include <algorithm>
+#include <chrono>
+
+namespace stratus {
+    static usize AlignStaging(const usize sizeBytes) {
+        const usize alignment = UploadQueue::STAGING_ALIGNMENT;
+        return ((sizeBytes + alignment - 1) / alignment) * alignment;
+    }
+
+    UploadQueue::UploadQueue(const UploadTargetPtr& target, const usize bytesPerFrame, const f64 msPerFrame, const Clock& clock)
+        : target_(target), clock_(clock), bytesPerFrame_(bytesPerFrame), msPerFrame_(msPerFrame) {
+        stats_.stagingBytes = target_->SizeBytes();
+    }
+
+    void UploadQueue::SetBudget(const usize bytesPerFrame, const f64 msPerFrame) {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        bytesPerFrame_ = bytesPerFrame;
+        msPerFrame_ = msPerFrame;
+    }
+
+    usize UploadQueue::BytesPerFrame() const {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        return bytesPerFrame_;
+    }
+
+    f64 UploadQueue::MsPerFrame() const {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        return msPerFrame_;
+    }
+
+    bool UploadQueue::Allocate_(const usize sizeBytes, usize& offset, u64& allocation) {
+        const usize capacity = target_->SizeBytes();
+        const usize size = AlignStaging(sizeBytes);
+        if (size == 0 || size > capacity) return false;
+
+        if (allocations_.size() == 0) {
+            offset = 0;
+        }
+        else {
+            const Allocation_& front = allocations_.front();
+            const Allocation_& back = allocations_.back();
+            const usize head = back.offset + back.sizeBytes;
+            // Newest allocation is after the oldest, so there is space at the end and at the start
+            if (back.offset >= front.offset) {
+                if (head + size <= capacity) offset = head;
+                else if (size <= front.offset) offset = 0;
+                else return false;
+            }
+            // Already wrapped around, only the gap up to the oldest allocation is free
+            else {
+                if (head + size <= front.offset) offset = head;
+                else return false;
+            }
+        }
+
+        Allocation_ entry;
+        entry.offset = offset;
+        entry.sizeBytes = size;
+        allocations_.push_back(entry);
+        allocation = firstAllocation_ + allocations_.size() - 1;
+
+        stats_.stagingBytesInUse += size;
+        stats_.peakStagingBytesInUse = std::max(stats_.peakStagingBytesInUse, stats_.stagingBytesInUse);
+        return true;
+    }
+
+    void UploadQueue::Retire_(const u64 completedFrame) {
+        // In allocation order so the ring only ever frees from its tail
+        while (allocations_.size() > 0) {
+            const Allocation_& front = allocations_.front();
+            if (front.frame == 0 || front.frame > completedFrame) break;
+            stats_.stagingBytesInUse -= front.sizeBytes;
+            allocations_.pop_front();
+            ++firstAllocation_;
+        }
+    }
+
+    bool UploadQueue::Stage(const usize sizeBytes, const UploadWriteFunction& write, const UploadCopyFunction& copy) {
+        usize offset = 0;
+        u64 allocation = 0;
+        {
+            auto ul = std::unique_lock<std::mutex>(m_);
+            if (!Allocate_(sizeBytes, offset, allocation)) {
+                ul.unlock();
+                Queue(sizeBytes, copy);
+                return false;
+            }
+        }
+
+        // Other threads can allocate and write while this one copies
+        write(target_->MappedMemory() + offset);
+
+        Pending_ pending;
+        pending.source.staged = true;
+        pending.source.offset = offset;
+        pending.source.sizeBytes = sizeBytes;
+        pending.copy = copy;
+        pending.allocation = allocation;
+
+        auto ul = std::unique_lock<std::mutex>(m_);
+        pending_.push_back(std::move(pending));
+        ++stats_.pendingCopies;
+        stats_.pendingBytes += sizeBytes;
+        return true;
+    }
+
+    void UploadQueue::Queue(const usize sizeBytes, const UploadCopyFunction& copy) {
+        Pending_ pending;
+        pending.source.sizeBytes = sizeBytes;
+        pending.copy = copy;
+
+        auto ul = std::unique_lock<std::mutex>(m_);
+        pending_.push_back(std::move(pending));
+        ++stats_.pendingCopies;
+        stats_.pendingBytes += sizeBytes;
+    }
+
+    void UploadQueue::Issue_(const bool ignoreBudget) {
+        const f64 start = clock_();
+        u32 copies = 0;
+        usize bytes = 0;
+
+        {
+            auto ul = std::unique_lock<std::mutex>(m_);
+            Retire_(target_->CompletedFrame());
+        }
+
+        while (true) {
+            Pending_ next;
+            {
+                auto ul = std::unique_lock<std::mutex>(m_);
+                if (pending_.size() == 0) break;
+
+                const usize size = pending_.front().source.sizeBytes;
+                const bool overBudget = bytes + size > bytesPerFrame_ || clock_() - start >= msPerFrame_;
+                if (!ignoreBudget && copies > 0 && overBudget) break;
+
+                next = std::move(pending_.front());
+                pending_.pop_front();
+                --stats_.pendingCopies;
+                stats_.pendingBytes -= size;
+            }
+
+            // Copies may take other locks (resource manager) so the queue's lock is not held
+            next.copy(next.source);
+            ++copies;
+            bytes += next.source.sizeBytes;
+
+            auto ul = std::unique_lock<std::mutex>(m_);
+            if (next.source.staged) {
+                allocations_[usize(next.allocation - firstAllocation_)].frame = frame_;
+                ++stats_.stagedCopies;
+                stats_.stagedBytes += next.source.sizeBytes;
+            }
+            else {
+                ++stats_.unstagedCopies;
+                stats_.unstagedBytes += next.source.sizeBytes;
+            }
+        }
+
+        auto ul = std::unique_lock<std::mutex>(m_);
+        if (copies > 0) {
+            target_->InsertFence(frame_);
+            ++frame_;
+        }
+        stats_.copiesLastFrame = copies;
+        stats_.bytesLastFrame = bytes;
+        STRATUS_PROFILE_COUNTER("UploadQueueBytes", bytes);
+        stats_.msLastFrame = clock_() - start;
+    }
+
+    void UploadQueue::ProcessFrame() {
+        Issue_(false);
+    }
+
+    void UploadQueue::Flush() {
+        Issue_(true);
+    }
+
+    bool UploadQueue::Empty() const {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        return pending_.size() == 0;
+    }
+
+    UploadQueueStats UploadQueue::Stats() const {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        return stats_;
+    }
+
+    f64 UploadQueue::SteadyClock() {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration<f64, std::milli>(now).count();
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "StratusTypes.h"
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace stratus {
+    // Where a copy reads its data from once it reaches the application thread
+    struct UploadSource {
+        // False when the data did not go through staging memory and has to be copied from where it already is
+        bool staged = false;
+        // Byte offset into the staging memory
+        usize offset = 0;
+        usize sizeBytes = 0;
+    };
+
+    // Fills staging memory. Runs on whichever thread stages the upload.
+    typedef std::function<void (u8 *)> UploadWriteFunction;
+    // Issues the GPU copy commands. Always runs on the application thread.
+    typedef std::function<void (const UploadSource&)> UploadCopyFunction;
+
+    // GPU side of the upload queue - a persistently mapped staging buffer plus fences for the renderer,
+    // a plain block of memory in tests. Only ever called on the application thread except for
+    // MappedMemory/SizeBytes which must be safe to call from anywhere.
+    class UploadTarget {
+    public:
+        virtual ~UploadTarget() = default;
+
+        // CPU writable view of the staging memory. Stays valid for the lifetime of the target.
+        virtual u8 * MappedMemory() = 0;
+        virtual usize SizeBytes() const = 0;
+        // Marks the end of the copies issued for a frame
+        virtual void InsertFence(const u64 frame) = 0;
+        // Newest frame whose copies have finished reading from staging memory
+        virtual u64 CompletedFrame() = 0;
+    };
+
+    typedef std::shared_ptr<UploadTarget> UploadTargetPtr;
+
+    struct UploadQueueStats {
+        usize stagingBytes = 0;
+        // Staging memory written or waiting on the GPU
+        usize stagingBytesInUse = 0;
+        usize peakStagingBytesInUse = 0;
+        // Copies waiting for the application thread
+        u32 pendingCopies = 0;
+        usize pendingBytes = 0;
+        // Most recent ProcessFrame
+        u32 copiesLastFrame = 0;
+        usize bytesLastFrame = 0;
+        f64 msLastFrame = 0.0;
+        // Totals
+        u64 stagedCopies = 0;
+        usize stagedBytes = 0;
+        // Copies that did not fit in staging memory (or never needed it) and went from system memory
+        u64 unstagedCopies = 0;
+        usize unstagedBytes = 0;
+    };
+
+    // Moves CPU data to the GPU without stalling the application thread. Worker threads copy into a ring of
+    // staging memory and queue the GPU copy, then once per frame the application thread issues queued copies
+    // until the frame's byte or time budget is spent. Staging memory is recycled once the fence for the frame
+    // that consumed it has passed.
+    //
+    // If the ring is full the upload is queued unstaged instead of waiting, so callers have to keep their data
+    // alive until the copy runs either way.
+    class UploadQueue {
+    public:
+        // Milliseconds from some fixed point
+        typedef std::function<f64 ()> Clock;
+
+        UploadQueue(const UploadTargetPtr& target, const usize bytesPerFrame, const f64 msPerFrame, const Clock& clock = SteadyClock);
+
+        // The first copy each frame is always issued so larger uploads still make progress
+        void SetBudget(const usize bytesPerFrame, const f64 msPerFrame);
+        usize BytesPerFrame() const;
+        f64 MsPerFrame() const;
+
+        // Thread safe. Reserves sizeBytes of staging memory, fills it with write on the calling thread and
+        // queues copy. Returns false if there was no room, in which case write is skipped and copy gets an
+        // unstaged source.
+        bool Stage(const usize sizeBytes, const UploadWriteFunction& write, const UploadCopyFunction& copy);
+        // Thread safe. Queues a copy which reads straight from system memory but still counts against the budget.
+        void Queue(const usize sizeBytes, const UploadCopyFunction& copy);
+
+        // Application thread only. Issues copies in the order they were queued.
+        void ProcessFrame();
+        // Application thread only. Issues everything that is queued regardless of budget.
+        void Flush();
+
+        bool Empty() const;
+        UploadQueueStats Stats() const;
+
+        static f64 SteadyClock();
+
+        // Staging offsets are aligned to this for each allocation
+        static constexpr usize STAGING_ALIGNMENT = 16;
+
+    private:
+        struct Allocation_ {
+            usize offset;
+            usize sizeBytes;
+            // Frame the copy was issued in, 0 while it is still being written or waiting
+            u64 frame = 0;
+        };
+
+        struct Pending_ {
+            UploadSource source;
+            UploadCopyFunction copy;
+            // Only set when staged
+            u64 allocation = 0;
+        };
+
+        bool Allocate_(const usize sizeBytes, usize& offset, u64& allocation);
+        void Retire_(const u64 completedFrame);
+        void Issue_(const bool ignoreBudget);
+
+    private:
+        mutable std::mutex m_;
+        UploadTargetPtr target_;
+        Clock clock_;
+        usize bytesPerFrame_;
+        f64 msPerFrame_;
+        // Live allocations in the order they were made. allocations_[0] has id firstAllocation_.
+        std::deque<Allocation_> allocations_;
+        u64 firstAllocation_ = 1;
+        std::deque<Pending_> pending_;
+        u64 frame_ = 1;
+        UploadQueueStats stats_;
+    };
+
+    typedef std::shared_ptr<UploadQueue> UploadQueuePtr;
+}
@@ -0,0 +1,438 @@
+#include "StratusVplCulling.h"
+#include "StratusTaskSystem.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STRATUS_VPL_CULLING_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace stratus {
+    // Lights handed to each ParallelFor item by ComputeVisibleLights
+    static constexpr size_t VisibilityBatchSize = 256;
+
+    static float Saturate(const float value) {
+        return std::min(std::max(value, 0.0f), 1.0f);
+    }
+
+    static void ForEach(const size_t count, const std::function<void (size_t)>& process) {
+        TaskSystem * tasks = INSTANCE(TaskSystem);
+        if (tasks == nullptr || tasks->Size() == 0) {
+            for (size_t i = 0; i < count; ++i) process(i);
+            return;
+        }
+        tasks->ParallelFor(count, process);
+    }
+
+    // Structure of arrays copy of the visible lights so that stage 2 can test 4 lights at a time
+    struct VisibleLightsSoA_ {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> radius;
+        std::vector<int> index;
+        size_t size = 0;
+
+        VisibleLightsSoA_(const std::vector<GpuVplData>& lights, const std::vector<int>& visibleIndices) {
+            size = visibleIndices.size();
+            // Pad out to a multiple of 4 so the SIMD loop never reads past the end
+            const size_t padded = (size + 3) & ~size_t(3);
+            x.resize(padded, 0.0f);
+            y.resize(padded, 0.0f);
+            z.resize(padded, 0.0f);
+            radius.resize(padded, 1.0f);
+            index.resize(padded, -1);
+
+            for (size_t i = 0; i < size; ++i) {
+                const int lightIndex = visibleIndices[i];
+                const GpuVplData& light = lights[lightIndex];
+                x[i] = light.position.v[0];
+                y[i] = light.position.v[1];
+                z[i] = light.position.v[2];
+                radius[i] = light.radius;
+                index[i] = lightIndex;
+            }
+        }
+    };
+
+    // Matches the insertion + SHUFFLE_DOWN logic in vpl_tiled_deferred_culling_stage2.cs
+    struct TileNearestLights_ {
+        int numVisible = 0;
+        int indices[MAX_VPLS_PER_TILE];
+        float distances[MAX_VPLS_PER_TILE];
+
+        TileNearestLights_() {
+            for (int i = 0; i < MAX_VPLS_PER_TILE; ++i) {
+                indices[i] = i;
+                distances[i] = std::numeric_limits<float>::max();
+            }
+        }
+
+        void Insert(const int lightIndex, const float ratio) {
+            for (int i = 0; i < MAX_VPLS_PER_TILE; ++i) {
+                if (ratio < distances[i]) {
+                    if (distances[i] != std::numeric_limits<float>::max()) {
+                        for (int k = MAX_VPLS_PER_TILE - 2; k >= i; --k) {
+                            indices[k + 1] = indices[k];
+                            distances[k + 1] = distances[k];
+                        }
+                    }
+                    indices[i] = lightIndex;
+                    distances[i] = ratio;
+
+                    if (numVisible < MAX_VPLS_PER_TILE) {
+                        ++numVisible;
+                    }
+                    break;
+                }
+            }
+        }
+    };
+
+    static glm::vec3 WorldPositionFromDepth(const glm::vec2& uv, const float depth, const glm::mat4& invProjectionView) {
+        const float z = depth * 2.0f - 1.0f;
+        const glm::vec4 ndc = glm::vec4(uv * 2.0f - 1.0f, z, 1.0f);
+        const glm::vec4 worldPosition = invProjectionView * ndc;
+        return glm::vec3(worldPosition) / worldPosition.w;
+    }
+
+    bool VplCascadeDepthSnapshot::Valid() const {
+        const size_t texels = size_t(resolution) * size_t(resolution);
+        return resolution > 0 && projectionViews.size() >= 4 && cascadePlanes.size() >= 3 &&
+            depth.size() >= texels * projectionViews.size();
+    }
+
+    // texture() on a sampler2DArrayShadow with LEQUAL compare, linear filtering and clamp to edge: the
+    // 2x2 comparison results around the coordinate weighted bilinearly
+    static float SampleShadowTexture(const VplCascadeDepthSnapshot& snapshot, const size_t cascade, const glm::vec2& coords, const float depth) {
+        const int resolution = int(snapshot.resolution);
+        const float * texels = snapshot.depth.data() + cascade * size_t(resolution) * size_t(resolution);
+
+        const float u = coords.x * float(resolution) - 0.5f;
+        const float v = coords.y * float(resolution) - 0.5f;
+        const float floorU = std::floor(u);
+        const float floorV = std::floor(v);
+        const float alpha = u - floorU;
+        const float beta = v - floorV;
+
+        const auto compare = [texels, resolution, depth](const int x, const int y) {
+            const int sampleX = std::min(std::max(x, 0), resolution - 1);
+            const int sampleY = std::min(std::max(y, 0), resolution - 1);
+            return depth <= texels[sampleX + sampleY * resolution] ? 1.0f : 0.0f;
+        };
+
+        const int x0 = int(floorU);
+        const int y0 = int(floorV);
+        return (1.0f - alpha) * (1.0f - beta) * compare(x0, y0) +
+               alpha * (1.0f - beta) * compare(x0 + 1, y0) +
+               (1.0f - alpha) * beta * compare(x0, y0 + 1) +
+               alpha * beta * compare(x0 + 1, y0 + 1);
+    }
+
+    bool CpuVplCulling::IsLit(const VplCascadeDepthSnapshot& snapshot, const glm::vec3& position) {
+        const glm::vec4 p = glm::vec4(position, 1.0f);
+        const glm::vec3 cascadeBlends(
+            glm::dot(snapshot.cascadePlanes[0], p),
+            glm::dot(snapshot.cascadePlanes[1], p),
+            glm::dot(snapshot.cascadePlanes[2], p));
+
+        // Normal offset with the light direction as the normal
+        const glm::vec3& normal = snapshot.lightDirection;
+        const glm::vec4 offset = glm::vec4(position + normal * (1.0f - Saturate(glm::dot(normal, normal))) * 1.0f, 1.0f);
+
+        const bool beyondCascade2 = cascadeBlends.y >= 0.0f;
+        const bool beyondCascade3 = cascadeBlends.z >= 0.0f;
+        const size_t index1 = beyondCascade2 ? 2 : 0;
+        const size_t index2 = beyondCascade3 ? 3 : 1;
+
+        const auto cascadeCoords = [&snapshot, &offset](const size_t cascade) {
+            const glm::vec4 coords = snapshot.projectionViews[cascade] * offset;
+            return glm::vec3(coords) / coords.w * 0.5f + glm::vec3(0.5f);
+        };
+
+        const glm::vec3 coords1 = cascadeCoords(index1);
+        const glm::vec3 coords2 = cascadeCoords(index2);
+        // Clamped for the final cascade to prevent darkening beyond its bounds
+        const float depth2 = beyondCascade3 ? Saturate(coords2.z) : coords2.z;
+
+        const float weight = beyondCascade2
+            ? Saturate(cascadeBlends.y) - Saturate(cascadeBlends.z)
+            : 1.0f - Saturate(cascadeBlends.x);
+
+        const float texelSize = 1.0f / float(snapshot.resolution);
+        float light1 = 0.0f;
+        float light2 = 0.0f;
+        float samples = 0.0f;
+        for (float y = -1.0f; y <= 1.0f; y += 1.0f) {
+            for (float x = -1.0f; x <= 1.0f; x += 1.0f) {
+                const glm::vec2 sampleOffset = glm::vec2(x, y) * texelSize;
+                light1 += SampleShadowTexture(snapshot, index1, glm::vec2(coords1) + sampleOffset, coords1.z);
+                light2 += SampleShadowTexture(snapshot, index2, glm::vec2(coords2) + sampleOffset, depth2);
+                ++samples;
+            }
+        }
+
+        // shadowFactor = 1.0 - mix(light2, light1, weight) * (1.0 / samples), lit when below 1
+        const float shadowFactor = 1.0f - (light2 * (1.0f - weight) + light1 * weight) * (1.0f / samples);
+        return shadowFactor < 1.0f;
+    }
+
+    float CpuVplCulling::DiffuseAttenuation(const float distance, const float radius) {
+        const float ratio = std::min(distance / radius, 1.0f);
+        const float minDistance = (10.0f + (1.0f - 10.0f) * std::exp(-3.0f * ratio)) * radius;
+        return 1.0f / (minDistance + distance * distance);
+    }
+
+    float CpuVplCulling::Importance(const GpuVplData& light, const glm::vec3& viewer) {
+        const float distance = glm::length(glm::vec3(light.position.ToVec4()) - viewer);
+        return light.intensity * DiffuseAttenuation(distance, light.radius);
+    }
+
+    // Importance for lights [first, last), 4 at a time where possible. Performs the same operations in
+    // the same order as Importance so that both give identical results.
+    static void ComputeImportance(
+        const std::vector<GpuVplData>& lights,
+        const glm::vec3& viewer,
+        const size_t first,
+        const size_t last,
+        float * out) {
+
+        size_t i = first;
+
+#ifdef STRATUS_VPL_CULLING_SSE
+        const __m128 vx = _mm_set1_ps(viewer.x);
+        const __m128 vy = _mm_set1_ps(viewer.y);
+        const __m128 vz = _mm_set1_ps(viewer.z);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 ten = _mm_set1_ps(10.0f);
+        const __m128 minusNine = _mm_set1_ps(1.0f - 10.0f);
+        alignas(16) float ratios[4];
+        alignas(16) float falloff[4];
+
+        for (; i + 4 <= last; i += 4) {
+            const GpuVplData& l0 = lights[i];
+            const GpuVplData& l1 = lights[i + 1];
+            const GpuVplData& l2 = lights[i + 2];
+            const GpuVplData& l3 = lights[i + 3];
+
+            const __m128 dx = _mm_sub_ps(_mm_setr_ps(l0.position.v[0], l1.position.v[0], l2.position.v[0], l3.position.v[0]), vx);
+            const __m128 dy = _mm_sub_ps(_mm_setr_ps(l0.position.v[1], l1.position.v[1], l2.position.v[1], l3.position.v[1]), vy);
+            const __m128 dz = _mm_sub_ps(_mm_setr_ps(l0.position.v[2], l1.position.v[2], l2.position.v[2], l3.position.v[2]), vz);
+            const __m128 radius = _mm_setr_ps(l0.radius, l1.radius, l2.radius, l3.radius);
+            const __m128 intensity = _mm_setr_ps(l0.intensity, l1.intensity, l2.intensity, l3.intensity);
+
+            const __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+            _mm_store_ps(ratios, _mm_min_ps(_mm_div_ps(distance, radius), one));
+            // No SSE2 exp so this part is done per lane
+            for (int lane = 0; lane < 4; ++lane) {
+                falloff[lane] = std::exp(-3.0f * ratios[lane]);
+            }
+
+            const __m128 minDistance = _mm_mul_ps(_mm_add_ps(ten, _mm_mul_ps(minusNine, _mm_load_ps(falloff))), radius);
+            const __m128 attenuation = _mm_div_ps(one, _mm_add_ps(minDistance, _mm_mul_ps(distance, distance)));
+            _mm_storeu_ps(out + (i - first), _mm_mul_ps(intensity, attenuation));
+        }
+#endif
+
+        for (; i < last; ++i) {
+            out[i - first] = CpuVplCulling::Importance(lights[i], viewer);
+        }
+    }
+
+    void CpuVplCulling::ComputeVisibleLights(
+        const std::vector<GpuVplData>& lights,
+        const glm::vec3& viewer,
+        const VplSunVisibilityFunction& isLit,
+        const size_t maxVisible,
+        std::vector<int>& visibleIndices) {
+
+        // Every light is independent so the shadow tests and importance are split into batches across
+        // the task threads. Only the compaction below is serial.
+        std::vector<uint8_t> lit(lights.size(), 0);
+        std::vector<float> importance(lights.size(), 0.0f);
+        const size_t numBatches = (lights.size() + VisibilityBatchSize - 1) / VisibilityBatchSize;
+        ForEach(numBatches, [&](const size_t batch) {
+            const size_t first = batch * VisibilityBatchSize;
+            const size_t last = std::min(first + VisibilityBatchSize, lights.size());
+            for (size_t i = first; i < last; ++i) {
+                lit[i] = isLit(glm::vec3(lights[i].position.ToVec4())) ? 1 : 0;
+            }
+            ComputeImportance(lights, viewer, first, last, importance.data() + first);
+        });
+
+        visibleIndices.clear();
+        for (size_t i = 0; i < lights.size(); ++i) {
+            if (lit[i]) visibleIndices.push_back(int(i));
+        }
+
+        if (visibleIndices.size() <= maxVisible) return;
+
+        // Ties go to the lower index so the result doesn't depend on the partition order
+        std::nth_element(visibleIndices.begin(), visibleIndices.begin() + maxVisible, visibleIndices.end(),
+            [&importance](const int a, const int b) {
+                return importance[a] > importance[b] || (importance[a] == importance[b] && a < b);
+            });
+        visibleIndices.resize(maxVisible);
+        std::sort(visibleIndices.begin(), visibleIndices.end());
+    }
+
+    void CpuVplCulling::ComputeTileStage1(
+        const CpuVplTileCullingInputs& inputs,
+        const size_t firstRow,
+        const size_t lastRow,
+        std::vector<GpuVplStage1PerTileOutputs>& out) {
+
+        const size_t numTilesX = NumTilesX(inputs);
+        const size_t numTilesY = NumTilesY(inputs);
+        const size_t pixelsPerTile = size_t(inputs.tileXDivisor) * size_t(inputs.tileYDivisor);
+        if (pixelsPerTile == 0) return;
+
+        // The compute shader derives its texture coordinates from the dispatch size rather than the real
+        // viewport size, so the same is done here
+        const glm::vec2 dispatchSize = glm::vec2(float(numTilesX * inputs.tileXDivisor), float(numTilesY * inputs.tileYDivisor));
+        const float invPixelsPerTile = 1.0f / float(pixelsPerTile);
+
+        for (size_t tileY = firstRow; tileY < std::min(lastRow, numTilesY); ++tileY) {
+            for (size_t tileX = 0; tileX < numTilesX; ++tileX) {
+                glm::vec3 averagePosition = glm::vec3(0.0f);
+                glm::vec3 averageNormal = glm::vec3(0.0f);
+
+                for (uint32_t localY = 0; localY < inputs.tileYDivisor; ++localY) {
+                    for (uint32_t localX = 0; localX < inputs.tileXDivisor; ++localX) {
+                        const size_t pixelX = tileX * inputs.tileXDivisor + localX;
+                        const size_t pixelY = tileY * inputs.tileYDivisor + localY;
+                        const glm::vec2 texCoords = (glm::vec2(float(pixelX), float(pixelY)) + glm::vec2(0.5f)) / dispatchSize;
+
+                        // Nearest texel lookup into the full resolution buffers
+                        const size_t sampleX = std::min<size_t>(size_t(texCoords.x * float(inputs.viewportWidth)), inputs.viewportWidth - 1);
+                        const size_t sampleY = std::min<size_t>(size_t(texCoords.y * float(inputs.viewportHeight)), inputs.viewportHeight - 1);
+                        const size_t sample = sampleX + sampleY * inputs.viewportWidth;
+
+                        averagePosition += WorldPositionFromDepth(texCoords, inputs.depth[sample], inputs.invProjectionView);
+                        averageNormal += glm::normalize(inputs.normals[sample] * 2.0f - glm::vec3(1.0f));
+                    }
+                }
+
+                averagePosition *= invPixelsPerTile;
+                averageNormal = glm::normalize(averageNormal * invPixelsPerTile);
+
+                GpuVplStage1PerTileOutputs& tile = out[tileX + tileY * numTilesX];
+                tile.averageLocalPosition = GpuVec(glm::vec4(averagePosition, 1.0f));
+                tile.averageLocalNormal = GpuVec(glm::vec4(averageNormal, 1.0f));
+            }
+        }
+    }
+
+    static void SelectTileLights(
+        const VisibleLightsSoA_& soa,
+        const std::vector<GpuVplStage1PerTileOutputs>& stage1,
+        const size_t firstTile,
+        const size_t lastTile,
+        std::vector<GpuVplStage2PerTileOutputs>& out) {
+
+        for (size_t tileIndex = firstTile; tileIndex < std::min(lastTile, stage1.size()); ++tileIndex) {
+            const GpuVplStage1PerTileOutputs& tile = stage1[tileIndex];
+            const float fragX = tile.averageLocalPosition.v[0];
+            const float fragY = tile.averageLocalPosition.v[1];
+            const float fragZ = tile.averageLocalPosition.v[2];
+            const float normalX = tile.averageLocalNormal.v[0];
+            const float normalY = tile.averageLocalNormal.v[1];
+            const float normalZ = tile.averageLocalNormal.v[2];
+
+            TileNearestLights_ nearest;
+            size_t i = 0;
+
+#ifdef STRATUS_VPL_CULLING_SSE
+            const __m128 fx = _mm_set1_ps(fragX);
+            const __m128 fy = _mm_set1_ps(fragY);
+            const __m128 fz = _mm_set1_ps(fragZ);
+            const __m128 nx = _mm_set1_ps(normalX);
+            const __m128 ny = _mm_set1_ps(normalY);
+            const __m128 nz = _mm_set1_ps(normalZ);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            alignas(16) float ratios[4];
+
+            for (; i + 4 <= soa.size; i += 4) {
+                const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&soa.x[i]), fx);
+                const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&soa.y[i]), fy);
+                const __m128 dz = _mm_sub_ps(_mm_loadu_ps(&soa.z[i]), fz);
+
+                // Side of plane check: dot(normal, light - frag) >= 0
+                const __m128 side = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, dx), _mm_mul_ps(ny, dy)), _mm_mul_ps(nz, dz));
+                const __m128 distSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                const __m128 ratio = _mm_div_ps(_mm_sqrt_ps(distSquared), _mm_loadu_ps(&soa.radius[i]));
+                const __m128 accepted = _mm_and_ps(_mm_cmpge_ps(side, zero), _mm_cmple_ps(ratio, one));
+
+                const int mask = _mm_movemask_ps(accepted);
+                if (mask == 0) continue;
+
+                _mm_store_ps(ratios, ratio);
+                // Lanes must be inserted in order so that ties resolve the same way as the shader
+                for (int lane = 0; lane < 4; ++lane) {
+                    if (mask & (1 << lane)) {
+                        nearest.Insert(soa.index[i + lane], ratios[lane]);
+                    }
+                }
+            }
+#endif
+
+            // Scalar path for the remainder (or everything if SIMD is unavailable)
+            for (; i < soa.size; ++i) {
+                const float dx = soa.x[i] - fragX;
+                const float dy = soa.y[i] - fragY;
+                const float dz = soa.z[i] - fragZ;
+                const float side = normalX * dx + normalY * dy + normalZ * dz;
+                if (side < 0.0f) continue;
+
+                const float ratio = std::sqrt(dx * dx + dy * dy + dz * dz) / soa.radius[i];
+                if (ratio > 1.0f) continue;
+
+                nearest.Insert(soa.index[i], ratio);
+            }
+
+            GpuVplStage2PerTileOutputs& result = out[tileIndex];
+            result.numVisible = nearest.numVisible;
+            for (int k = 0; k < nearest.numVisible; ++k) {
+                result.indices[k] = nearest.indices[k];
+            }
+        }
+    }
+
+    void CpuVplCulling::ComputeTileStage2(
+        const std::vector<GpuVplData>& lights,
+        const std::vector<int>& visibleIndices,
+        const std::vector<GpuVplStage1PerTileOutputs>& stage1,
+        const size_t firstTile,
+        const size_t lastTile,
+        std::vector<GpuVplStage2PerTileOutputs>& out) {
+
+        const VisibleLightsSoA_ soa(lights, visibleIndices);
+        SelectTileLights(soa, stage1, firstTile, lastTile, out);
+    }
+
+    void CpuVplCulling::PerformCulling(
+        const std::vector<GpuVplData>& lights,
+        const glm::vec3& viewer,
+        const VplSunVisibilityFunction& isLit,
+        const CpuVplTileCullingInputs& inputs,
+        CpuVplCullingResults& results) {
+
+        const size_t numTilesX = NumTilesX(inputs);
+        const size_t numTilesY = NumTilesY(inputs);
+
+        ComputeVisibleLights(lights, viewer, isLit, MAX_TOTAL_VPLS_PER_FRAME, results.visibleIndices);
+
+        results.stage1.resize(numTilesX * numTilesY);
+        results.stage2.resize(numTilesX * numTilesY);
+
+        // Each row writes to a disjoint range of tiles so no synchronization is needed
+        const VisibleLightsSoA_ soa(lights, results.visibleIndices);
+        ForEach(numTilesY, [&](const size_t row) {
+            ComputeTileStage1(inputs, row, row + 1, results.stage1);
+            SelectTileLights(soa, results.stage1, row * numTilesX, (row + 1) * numTilesX, results.stage2);
+        });
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "StratusGpuCommon.h"
+#include "glm/glm.hpp"
+#include <vector>
+#include <functional>
+
+namespace stratus {
+    // Returns true if the given world space position receives light from the infinite light
+    typedef std::function<bool (const glm::vec3&)> VplSunVisibilityFunction;
+
+    // CPU copy of the cascaded shadow map, resolution x resolution texels per cascade. The matrices
+    // are the ones the depth was rendered with. With a full resolution copy IsLit gives the same answer
+    // as viscull_vpls.cs; the renderer's copy is downsampled and a frame or two old.
+    struct VplCascadeDepthSnapshot {
+        uint32_t resolution = 0;
+        // RendererCascadeData::projectionViewSample, one per cascade
+        std::vector<glm::mat4> projectionViews;
+        // RendererCascadeData::cascadePlane of cascades 1 and up (the shader's cascadePlanes)
+        std::vector<glm::vec4> cascadePlanes;
+        // The shader's infiniteLightDirection which viscull_vpls.cs also passes as the normal
+        glm::vec3 lightDirection = glm::vec3(0.0f);
+        // Depth on the range [0, 1], one resolution * resolution block per cascade
+        std::vector<float> depth;
+
+        bool Valid() const;
+    };
+
+    // Inputs for the per-tile culling stages. These mirror the data the compute shaders read
+    // from the GBuffer so that the CPU path can be used as a test oracle for them.
+    struct CpuVplTileCullingInputs {
+        // Viewport size in pixels
+        uint32_t viewportWidth = 0;
+        uint32_t viewportHeight = 0;
+        // Tile size in pixels (matches local_size_x/y of vpl_tiled_deferred_culling_stage1.cs)
+        uint32_t tileXDivisor = 5;
+        uint32_t tileYDivisor = 5;
+        glm::mat4 invProjectionView = glm::mat4(1.0f);
+        // Non-linear depth values on the range [0, 1], size = viewportWidth * viewportHeight
+        std::vector<float> depth;
+        // Normals encoded on the range [0, 1] as stored in the GBuffer, size = viewportWidth * viewportHeight
+        std::vector<glm::vec3> normals;
+    };
+
+    // Results of a full CPU culling run
+    struct CpuVplCullingResults {
+        std::vector<int> visibleIndices;
+        std::vector<GpuVplStage1PerTileOutputs> stage1;
+        std::vector<GpuVplStage2PerTileOutputs> stage2;
+    };
+
+    // CPU implementation of viscull_vpls.cs and vpl_tiled_deferred_culling_stage1/2.cs. Chooses which
+    // VPLs are lit by the infinite light and, when there are too many, which of them are kept. The tile
+    // outputs match GpuVplStage1PerTileOutputs and GpuVplStage2PerTileOutputs.
+    //
+    // All functions are thread safe as long as the inputs are not modified while they run. Work is
+    // split across TaskSystem::ParallelFor when a task system exists, otherwise it runs inline.
+    class CpuVplCulling {
+        CpuVplCulling() = delete;
+
+    public:
+        // Matches calculateInfiniteShadowValue as viscull_vpls.cs calls it (no depth bias): 3x3 LEQUAL
+        // comparisons with linear filtering and clamp to edge in each of the two blended cascades. Needs
+        // 4 cascades. The result is only as exact as the snapshot - see RendererSettings::cpuVplCullingEnabled.
+        static bool IsLit(const VplCascadeDepthSnapshot&, const glm::vec3& position);
+
+        // vplDiffuseAttenuation in pbr.glsl - how the GI pass scales a light's color with distance
+        static float DiffuseAttenuation(const float distance, const float radius);
+
+        // How much a light is expected to contribute to the frame - its intensity with the GI pass's
+        // falloff evaluated at the viewer
+        static float Importance(const GpuVplData& light, const glm::vec3& viewer);
+
+        // Writes the index of each light for which isLit returns true. When more than maxVisible are
+        // lit only the maxVisible most important are kept. Indices are sorted so that callers which
+        // sorted lights by distance still see the closest first. isLit may be called from several
+        // threads at once.
+        static void ComputeVisibleLights(
+            const std::vector<GpuVplData>& lights,
+            const glm::vec3& viewer,
+            const VplSunVisibilityFunction& isLit,
+            const size_t maxVisible,
+            std::vector<int>& visibleIndices
+        );
+
+        static size_t NumTilesX(const CpuVplTileCullingInputs& inputs) {
+            return inputs.tileXDivisor == 0 ? 0 : inputs.viewportWidth / inputs.tileXDivisor;
+        }
+
+        static size_t NumTilesY(const CpuVplTileCullingInputs& inputs) {
+            return inputs.tileYDivisor == 0 ? 0 : inputs.viewportHeight / inputs.tileYDivisor;
+        }
+
+        // Computes the average world position + normal for tile rows [firstRow, lastRow). The
+        // output vector must already be sized to NumTilesX * NumTilesY.
+        static void ComputeTileStage1(
+            const CpuVplTileCullingInputs& inputs,
+            const size_t firstRow,
+            const size_t lastRow,
+            std::vector<GpuVplStage1PerTileOutputs>& out
+        );
+
+        // Selects the MAX_VPLS_PER_TILE closest lights (by distance / radius) for tiles [firstTile, lastTile).
+        // The output vector must already be sized to match stage1.
+        static void ComputeTileStage2(
+            const std::vector<GpuVplData>& lights,
+            const std::vector<int>& visibleIndices,
+            const std::vector<GpuVplStage1PerTileOutputs>& stage1,
+            const size_t firstTile,
+            const size_t lastTile,
+            std::vector<GpuVplStage2PerTileOutputs>& out
+        );
+
+        // Runs visibility followed by both tile stages. Each tile only depends on itself so the tile
+        // rows are split across the task threads.
+        static void PerformCulling(
+            const std::vector<GpuVplData>& lights,
+            const glm::vec3& viewer,
+            const VplSunVisibilityFunction& isLit,
+            const CpuVplTileCullingInputs& inputs,
+            CpuVplCullingResults& results
+        );
+    };
+}
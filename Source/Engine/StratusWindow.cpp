@@ -26,7 +26,12 @@ namespace stratus {
         return mouse_;
     }
 
-    bool InputManager::Initialize() { return true; }
+    bool InputManager::Initialize() {
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        eventsMetric_ = metrics.RegisterCounter("InputManager.events", "Input events handed to the input handlers");
+        handlersMetric_ = metrics.RegisterGauge("InputManager.handlers");
+        return true;
+    }
 
     SystemStatus InputManager::Update(const double deltaSeconds) {
         // Commit input handler changes
@@ -40,6 +45,10 @@ namespace stratus {
             ptr->HandleInput(mouse_, inputEvents_, deltaSeconds);
         }
 
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        metrics.Increment(eventsMetric_, i64(inputEvents_.size()));
+        metrics.SetGauge(handlersMetric_, f64(inputHandlers_.size()));
+
         return SystemStatus::SYSTEM_CONTINUE;
     }
 
@@ -66,6 +75,11 @@ namespace stratus {
         // graphics backend to some extent
         CHECK_IS_APPLICATION_THREAD();
 
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        widthMetric_ = metrics.RegisterGauge("Window.width");
+        heightMetric_ = metrics.RegisterGauge("Window.height");
+        resizesMetric_ = metrics.RegisterCounter("Window.resizes");
+
         STRATUS_LOG << "Initializing SDL video" << std::endl;
         if (SDL_Init(SDL_INIT_VIDEO) != 0) {
             STRATUS_ERROR << "Unable to initialize sdl2" << std::endl;
@@ -102,6 +116,11 @@ namespace stratus {
         prevWidth_ = width_;
         prevHeight_ = height_;
 
+        MetricsRegistry& metrics = MetricsRegistry::Instance();
+        metrics.SetGauge(widthMetric_, f64(width_));
+        metrics.SetGauge(heightMetric_, f64(height_));
+        if (resized_) metrics.Increment(resizesMetric_);
+
         // Collect window input events
         std::vector<SDL_Event> inputEvents;
         SDL_Event e;
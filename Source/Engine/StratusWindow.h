@@ -1,6 +1,7 @@
 #pragma once
 
 #include "StratusSystemModule.h"
+#include "StratusMetrics.h"
 #include <unordered_map>
 #include <unordered_set>
 #include <shared_mutex>
@@ -48,6 +49,8 @@ namespace stratus {
         std::unordered_set<InputHandlerPtr> inputHandlers_;
         std::unordered_set<InputHandlerPtr> inputHandlersToAdd_;
         std::unordered_set<InputHandlerPtr> inputHandlersToRemove_;
+        MetricId eventsMetric_;
+        MetricId handlersMetric_;
     };
 
     SYSTEM_MODULE_CLASS(Window)
@@ -78,5 +81,8 @@ namespace stratus {
         uint32_t prevWidth_ = 0;
         uint32_t prevHeight_ = 0;
         bool resized_ = false;
+        MetricId widthMetric_;
+        MetricId heightMetric_;
+        MetricId resizesMetric_;
     };
 }
\ No newline at end of file
@@ -20,6 +20,14 @@ STRATUS_GLSL_VERSION
 // It's possible to have metallic + roughness combined into a single map
 #define GPU_METALLIC_ROUGHNESS_MAPPED (BITMASK_POW2(7))
 
+// Matches the definitions in StratusGpuCommon.h. Each map gets 4 bits of Material::residentMips.
+#define GPU_DIFFUSE_MIP_SLOT            (0)
+#define GPU_EMISSIVE_MIP_SLOT           (1)
+#define GPU_NORMAL_MIP_SLOT             (2)
+#define GPU_ROUGHNESS_MIP_SLOT          (3)
+#define GPU_METALLIC_MIP_SLOT           (4)
+#define GPU_METALLIC_ROUGHNESS_MIP_SLOT (5)
+
 #define FLOAT2_TO_VEC2(f2) vec2(f2[0], f2[1])
 #define FLOAT3_TO_VEC3(f3) vec3(f3[0], f3[1], f3[2])
 #define FLOAT3_TO_VEC4(f3) vec4(FLOAT3_TO_VEC3(f3), 1.0)
@@ -49,7 +57,8 @@ struct Material {
     // First two values = metallic, roughness
     float metallicRoughness[2];
     uint flags;
-    uint placeholder1_;
+    // Finest resident mip of each streamed map (see GPU_*_MIP_SLOT)
+    uint residentMips;
 };
 
 struct DrawElementsIndirectCommand {
@@ -108,6 +117,14 @@ float clampMediumPrecision(float value) {
     return clamp(value, 0.0, HALF_FLOAT_MAX);
 }
 
+// Streamed textures may only have their coarser levels committed. Bindless handles freeze the sampler
+// state so the LOD clamp has to happen here instead of through GL_TEXTURE_MIN_LOD.
+vec4 sampleMaterialTexture(in sampler2D tex, in vec2 texCoords, in uint residentMips, in uint slot) {
+    float minLod = float((residentMips >> (slot * 4)) & 0xF);
+    if (minLod == 0.0) return texture(tex, texCoords);
+    return textureLod(tex, texCoords, max(textureQueryLod(tex, texCoords).x, minLod));
+}
+
 vec2 computeTexelSize(sampler2D tex, int miplevel) {
     // This will give us the size of a single texel in (x, y) directions
     // (miplevel is telling it to give us the size at mipmap *miplevel*, where 0 would mean full size image)
@@ -26,7 +26,7 @@ void main() {
     Material material = materials[materialIndices[fsDrawID]];
     vec4 diffuse = FLOAT4_TO_VEC4(material.diffuseColor);
     if (bitwiseAndBool(material.flags, GPU_DIFFUSE_MAPPED)) {
-        diffuse = texture(material.diffuseMap, fsTexCoords);
+        diffuse = sampleMaterialTexture(material.diffuseMap, fsTexCoords, material.residentMips, GPU_DIFFUSE_MIP_SLOT);
     }
 
     runAlphaTest(diffuse.a);
@@ -0,0 +1,59 @@
+STRATUS_GLSL_VERSION
+
+#include "common.glsl"
+
+// Needs to match IRRADIANCE_PROBE_SH_COEFFICIENTS in StratusIrradianceProbes.h
+#define IRRADIANCE_PROBE_SH_COEFFICIENTS 9
+
+// Needs to match up with definition in StratusGpuCommon (rgb + padding per coefficient)
+struct IrradianceProbe {
+    vec4 coefficients[IRRADIANCE_PROBE_SH_COEFFICIENTS];
+};
+
+layout (std430, binding = 5) readonly buffer irradianceProbeBlock {
+    IrradianceProbe irradianceProbes[];
+};
+
+uniform bool staticProbesEnabled = false;
+uniform vec3 probeGridOrigin;
+uniform float probeGridSpacing;
+uniform ivec3 probeGridDimensions;
+
+int irradianceProbeIndex(ivec3 probe) {
+    return probe.x + probeGridDimensions.x * (probe.y + probeGridDimensions.y * probe.z);
+}
+
+// Mirrors IrradianceProbeGrid::SampleIrradiance - trilinear blend of the 8 surrounding probes
+// followed by evaluating the cosine convolved L2 SH in the direction of the normal
+vec3 sampleIrradianceProbes(vec3 position, vec3 normal) {
+    vec3 maxCoords = vec3(probeGridDimensions - ivec3(1));
+    vec3 gridCoords = clamp((position - probeGridOrigin) / probeGridSpacing, vec3(0.0), maxCoords);
+    ivec3 base = min(ivec3(floor(gridCoords)), max(probeGridDimensions - ivec3(2), ivec3(0)));
+    vec3 alpha = clamp(gridCoords - vec3(base), vec3(0.0), vec3(1.0));
+
+    vec3 sh[IRRADIANCE_PROBE_SH_COEFFICIENTS];
+    for (int i = 0; i < IRRADIANCE_PROBE_SH_COEFFICIENTS; ++i) {
+        sh[i] = vec3(0.0);
+    }
+
+    for (int corner = 0; corner < 8; ++corner) {
+        ivec3 offset = ivec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+        ivec3 probe = min(base + offset, probeGridDimensions - ivec3(1));
+        vec3 weights = mix(vec3(1.0) - alpha, alpha, vec3(offset));
+        float weight = weights.x * weights.y * weights.z;
+
+        int index = irradianceProbeIndex(probe);
+        for (int i = 0; i < IRRADIANCE_PROBE_SH_COEFFICIENTS; ++i) {
+            sh[i] += weight * irradianceProbes[index].coefficients[i].rgb;
+        }
+    }
+
+    vec3 n = normal;
+    vec3 result = PI * 0.282095 * sh[0];
+    result += (2.0 * PI / 3.0) * 0.488603 * (sh[1] * n.y + sh[2] * n.z + sh[3] * n.x);
+    result += (PI / 4.0) * (1.092548 * (sh[4] * n.x * n.y + sh[5] * n.y * n.z + sh[7] * n.x * n.z) +
+                            0.315392 * sh[6] * (3.0 * n.z * n.z - 1.0) +
+                            0.546274 * sh[8] * (n.x * n.x - n.y * n.y));
+
+    return max(result, vec3(0.0));
+}
@@ -78,11 +78,14 @@ vec4 calculateStructureOutput(float z) {
 // }
 
 vec3 calculateNormal(in Material material, in vec2 texCoords) {
-    vec3 normal = texture(material.normalMap, texCoords).rgb;
+    // Only x and y are read since cooked normal maps are two channel (BC5)
+    vec2 xy = sampleMaterialTexture(material.normalMap, texCoords, material.residentMips, GPU_NORMAL_MIP_SLOT).rg;
     // Normals generally have values from [-1, 1], but inside
     // an OpenGL texture they are transformed to [0, 1]. To convert
     // them back, we multiply by 2 and subtract 1.
-    normal = normalize(normal * 2.0 - vec3(1.0)); // [0, 1] -> [-1, 1]
+    xy = xy * 2.0 - vec2(1.0); // [0, 1] -> [-1, 1]
+    // Tangent space normals always point away from the surface so z can be rebuilt from x and y
+    vec3 normal = normalize(vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0))));
     // fsTbnMatrix goes from tangent space (defined by coordinate system of normal map)
     // to object space, and then model no translate moves to world space without translating
     normal = normalize(fsTbnMatrix * normal);
@@ -102,24 +105,24 @@ void main() {
     //vec2 texCoords = bitwiseAndBool(flags, GPU_DEPTH_MAPPED) ? calculateDepthCoords(material, fsTexCoords, viewDir) : fsTexCoords;
     vec2 texCoords = fsTexCoords;
 
-    vec4 baseColor = bool(fsDiffuseMapped) ? texture(material.diffuseMap, texCoords) : FLOAT4_TO_VEC4(material.diffuseColor);
+    vec4 baseColor = bool(fsDiffuseMapped) ? sampleMaterialTexture(material.diffuseMap, texCoords, material.residentMips, GPU_DIFFUSE_MIP_SLOT) : FLOAT4_TO_VEC4(material.diffuseColor);
     runAlphaTest(baseColor.a);
 
     vec3 normal = bool(fsNormalMapped) ? calculateNormal(material, texCoords) : (fsNormal + 1.0) * 0.5; // [-1, 1] -> [0, 1]
 
-    float roughness = bool(fsRoughnessMapped) ? texture(material.roughnessMap, texCoords).r : material.metallicRoughness[1];
-    float metallic = bool(fsMetallicMapped) ? texture(material.metallicMap, texCoords).r : material.metallicRoughness[0];
+    float roughness = bool(fsRoughnessMapped) ? sampleMaterialTexture(material.roughnessMap, texCoords, material.residentMips, GPU_ROUGHNESS_MIP_SLOT).r : material.metallicRoughness[1];
+    float metallic = bool(fsMetallicMapped) ? sampleMaterialTexture(material.metallicMap, texCoords, material.residentMips, GPU_METALLIC_MIP_SLOT).r : material.metallicRoughness[0];
     //float roughness = material.metallicRoughness[1];
     //float metallic = material.metallicRoughness[0];
     // float roughness = material.metallicRoughness[1];
     // float metallic = material.metallicRoughness[0];
     // See https://github.com/KhronosGroup/glTF-Sample-Viewer/blob/main/source/Renderer/shaders/material_info.glsl
     // See https://stackoverflow.com/questions/61140427/opengl-glsl-extract-metalroughness-map-to-metal-map-and-roughness-map
-    vec2 metallicRoughness = bool(fsMetallicRoughnessMapped) ? texture(material.metallicRoughnessMap, texCoords).bg : vec2(metallic, roughness);
+    vec2 metallicRoughness = bool(fsMetallicRoughnessMapped) ? sampleMaterialTexture(material.metallicRoughnessMap, texCoords, material.residentMips, GPU_METALLIC_ROUGHNESS_MIP_SLOT).bg : vec2(metallic, roughness);
     metallic = metallicRoughness.x;
     roughness = metallicRoughness.y;
 
-    vec3 emissive = bool(fsEmissiveMapped) ? emissiveTextureMultiplier * texture(material.emissiveMap, texCoords).rgb : FLOAT3_TO_VEC3(material.emissiveColor);
+    vec3 emissive = bool(fsEmissiveMapped) ? emissiveTextureMultiplier * sampleMaterialTexture(material.emissiveMap, texCoords, material.residentMips, GPU_EMISSIVE_MIP_SLOT).rgb : FLOAT3_TO_VEC3(material.emissiveColor);
 
     // Coordinate space is set to world
     //gPosition = fsPosition;
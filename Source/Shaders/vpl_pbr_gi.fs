@@ -5,6 +5,7 @@ STRATUS_GLSL_VERSION
 #include "pbr.glsl"
 #include "pbr2.glsl"
 #include "vpl_common.glsl"
+#include "irradiance_probes.glsl"
 
 // Input from vertex shader
 in vec2 fsTexCoords;
@@ -142,6 +143,11 @@ void performLightingCalculations(vec3 screenColor, vec2 pixelCoords, vec2 texCoo
     samplesMax = max(1, int(samplesMax * distRatioToCamera));
     int sampleCount = samplesMax;//max(1, int(samplesMax * 0.5));
 
+    // With baked probes there may be no live VPLs at all
+    if (numVisible[0] <= 0) {
+        sampleCount = 0;
+    }
+
     int maxRandomIndex = numVisible[0] - 1; //min(numVisible[0] - 1, int((numVisible[0] - 1) * (1.0 / 3.0)));
     //maxRandomIndex = int(maxRandomIndex * mix(1.0, 0.5, distRatioToCamera));
     
@@ -201,6 +207,12 @@ void performLightingCalculations(vec3 screenColor, vec2 pixelCoords, vec2 texCoo
 
     validSamples = max(validSamples, 1.0);
 
+    if (staticProbesEnabled) {
+        // Reservoir color is normalized by validSamples later on so scale up to compensate
+        vec3 irradiance = sampleIrradianceProbes(fragPos, normal);
+        vplColor += validSamples * ambientOcclusion * baseColor * irradiance / PI;
+    }
+
     color = baseColor + PREVENT_DIV_BY_ZERO;//baseColor;
     reservoir = vec4(boundHDR(vplColor), validSamples);
     //reservoir = vec4(max(boundHDR(vplColor), screenColor), validSamples);
@@ -0,0 +1,106 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+#include "StratusBenchmark.h"
+
+TEST_CASE( "Stratus Benchmark Stats Test", "[stratus_benchmark_stats_test]" ) {
+    std::cout << "Beginning stratus::BenchmarkStats test" << std::endl;
+
+    REQUIRE(stratus::BenchmarkStats::Percentile({}, 50.0) == 0.0);
+    REQUIRE(stratus::BenchmarkStats::Percentile({ 7.0 }, 99.0) == 7.0);
+
+    // 1..100 in reverse order - nearest rank picks exact samples
+    std::vector<double> samples;
+    for (int i = 100; i > 0; --i) samples.push_back(double(i));
+    REQUIRE(stratus::BenchmarkStats::Percentile(samples, 0.0) == 1.0);
+    REQUIRE(stratus::BenchmarkStats::Percentile(samples, 50.0) == 50.0);
+    REQUIRE(stratus::BenchmarkStats::Percentile(samples, 95.0) == 95.0);
+    REQUIRE(stratus::BenchmarkStats::Percentile(samples, 99.5) == 100.0);
+    REQUIRE(stratus::BenchmarkStats::Percentile(samples, 100.0) == 100.0);
+
+    stratus::BenchmarkStats stats;
+    for (const double sample : samples) stats.Add("Frame", sample);
+    stats.Add("Culling", 2.0);
+    stats.Add("Culling", 4.0);
+
+    REQUIRE(stats.Sections() == std::vector<std::string>{ "Frame", "Culling" });
+
+    const stratus::BenchmarkSummary frame = stats.Summarize("Frame");
+    REQUIRE(frame.count == 100);
+    REQUIRE(frame.min == 1.0);
+    REQUIRE(frame.max == 100.0);
+    REQUIRE(std::fabs(frame.mean - 50.5) < 1e-4);
+    REQUIRE(frame.p50 == 50.0);
+    REQUIRE(frame.p95 == 95.0);
+    REQUIRE(frame.p99 == 99.0);
+
+    REQUIRE(std::fabs(stats.Summarize("Culling").mean - 3.0) < 1e-4);
+    REQUIRE(stats.Summarize("Missing").count == 0);
+
+    std::stringstream out;
+    stats.WriteJson(out, { { "scene", "sponza \"test\"" }, { "frames", "100" } });
+    const std::string json = out.str();
+    REQUIRE(json.find("\"scene\": \"sponza \\\"test\\\"\"") != std::string::npos);
+    REQUIRE(json.find("\"frames\": \"100\"") != std::string::npos);
+    REQUIRE(json.find("\"Frame\": {\"count\": 100, \"mean\": 50.5000") != std::string::npos);
+    REQUIRE(json.find("\"p99\": 99.0000") != std::string::npos);
+    REQUIRE(json.find("\"Culling\": {\"count\": 2") != std::string::npos);
+    // Sections keep the order they were added in
+    REQUIRE(json.find("\"Frame\"") < json.find("\"Culling\""));
+}
+
+TEST_CASE( "Stratus Camera Path Test", "[stratus_camera_path_test]" ) {
+    std::cout << "Beginning stratus::CameraPath test" << std::endl;
+
+    stratus::CameraPath path;
+    REQUIRE(path.Empty());
+    REQUIRE(path.Duration() == 0.0);
+
+    path.AddKeyframe(stratus::CameraKeyframe{ 1.0, glm::vec3(0.0f), 0.0f, 0.0f });
+    path.AddKeyframe(stratus::CameraKeyframe{ 3.0, glm::vec3(10.0f, 20.0f, -30.0f), 10.0f, 90.0f });
+    REQUIRE_THROWS(path.AddKeyframe(stratus::CameraKeyframe{ 2.0, glm::vec3(0.0f), 0.0f, 0.0f }));
+    REQUIRE(path.Duration() == 2.0);
+
+    // Interpolates between keyframes and clamps outside of them
+    stratus::CameraKeyframe k = path.Sample(2.0);
+    REQUIRE(std::fabs(k.position.x - 5.0f) < 1e-4);
+    REQUIRE(std::fabs(k.position.y - 10.0f) < 1e-4);
+    REQUIRE(std::fabs(k.position.z + 15.0f) < 1e-4);
+    REQUIRE(std::fabs(k.pitch - 5.0f) < 1e-4);
+    REQUIRE(std::fabs(k.yaw - 45.0f) < 1e-4);
+    REQUIRE(path.Sample(0.0).position == glm::vec3(0.0f));
+    REQUIRE(path.Sample(10.0).yaw == 90.0f);
+
+    // Save/Load round trip
+    const std::string file = "stratus_camera_path_test.path";
+    REQUIRE(path.Save(file));
+    stratus::CameraPath loaded;
+    REQUIRE(stratus::CameraPath::Load(file, loaded));
+    REQUIRE(loaded.Keyframes().size() == 2);
+    for (size_t i = 0; i < 2; ++i) {
+        REQUIRE(loaded.Keyframes()[i].seconds == path.Keyframes()[i].seconds);
+        REQUIRE(loaded.Keyframes()[i].position == path.Keyframes()[i].position);
+        REQUIRE(loaded.Keyframes()[i].pitch == path.Keyframes()[i].pitch);
+        REQUIRE(loaded.Keyframes()[i].yaw == path.Keyframes()[i].yaw);
+    }
+    std::remove(file.c_str());
+    REQUIRE_FALSE(stratus::CameraPath::Load(file, loaded));
+
+    // Orbit starts and ends at the same place and always looks at the center. With pitch 0
+    // the camera's forward vector is (sin(yaw), 0, -cos(yaw)).
+    const glm::vec3 center(10.0f, 5.0f, -20.0f);
+    stratus::CameraPath orbit = stratus::CameraPath::Orbit(center, 50.0f, 0.0f, 8.0, 16);
+    REQUIRE(orbit.Keyframes().size() == 17);
+    REQUIRE(std::fabs(orbit.Duration() - 8.0) < 1e-4);
+    REQUIRE(glm::distance(orbit.Sample(0.0).position, orbit.Sample(8.0).position) < 1e-3f);
+    for (const stratus::CameraKeyframe& key : orbit.Keyframes()) {
+        REQUIRE(std::fabs(glm::distance(key.position, center) - 50.0f) < 1e-4);
+        const float yaw = key.yaw * 3.14159265f / 180.0f;
+        const glm::vec3 forward(std::sin(yaw), 0.0f, -std::cos(yaw));
+        REQUIRE(std::fabs(glm::dot(forward, glm::normalize(center - key.position)) - 1.0f) < 1e-4f);
+    }
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <cmath>
+
+#include "StratusCascadeCache.h"
+
+TEST_CASE( "Stratus Cascade Cache Test", "[stratus_cascade_cache_test]" ) {
+    std::cout << "Beginning stratus::CascadeCache test" << std::endl;
+
+    const glm::vec3 lightDir(0.0f, -1.0f, 0.0f);
+    const uint32_t resolution = 1024;
+    const float diameter = 100.0f;
+    const glm::vec3 minVec(-40.0f, -40.0f, -200.0f);
+    const glm::vec3 maxVec(40.0f, 40.0f, -100.0f);
+
+    // Without padding the bounds match the regular texel-snapped cascade
+    const stratus::CascadeBounds tight = stratus::CascadeCache::ComputeBounds(minVec, maxVec, diameter, resolution, 0.0f);
+    REQUIRE(tight.dimension == diameter);
+    REQUIRE(tight.depth == 100.0f);
+    REQUIRE(tight.position.z == minVec.z);
+    const float T = diameter / float(resolution);
+    REQUIRE(std::fabs(std::fmod(tight.position.x, T)) < 1e-4f);
+    REQUIRE(stratus::CascadeCache::Covers(tight, minVec, maxVec));
+
+    stratus::CascadeCache cache(4);
+    cache.SetCoverageMargin(0.1f);
+
+    // Disabled - everything renders every frame
+    cache.BeginFrame(lightDir, resolution, false);
+    for (size_t i = 0; i < 4; ++i) {
+        const auto update = cache.UpdateCascade(i, minVec, maxVec, diameter);
+        REQUIRE(update.renderStatic);
+        REQUIRE(update.renderDynamic);
+        REQUIRE(update.bounds.dimension == diameter);
+    }
+
+    // First enabled frame renders static casters for every cascade
+    cache.BeginFrame(lightDir, resolution, true);
+    stratus::CascadeBounds cached[4];
+    for (size_t i = 0; i < 4; ++i) {
+        const auto update = cache.UpdateCascade(i, minVec, maxVec, diameter);
+        REQUIRE(update.renderStatic);
+        REQUIRE(update.renderDynamic);
+        REQUIRE(update.bounds.dimension > diameter);
+        cached[i] = update.bounds;
+    }
+
+    // Small camera movement keeps the cached projection, near cascades refresh every frame
+    // and far cascades alternate
+    const glm::vec3 offset(2.0f, -1.0f, 0.5f);
+    for (int frame = 0; frame < 4; ++frame) {
+        cache.BeginFrame(lightDir, resolution, true);
+        int farUpdates = 0;
+        for (size_t i = 0; i < 4; ++i) {
+            const auto update = cache.UpdateCascade(i, minVec + offset, maxVec + offset, diameter);
+            REQUIRE_FALSE(update.renderStatic);
+            REQUIRE(update.bounds.position == cached[i].position);
+            if (i < 2) REQUIRE(update.renderDynamic);
+            else if (update.renderDynamic) ++farUpdates;
+        }
+        REQUIRE(farUpdates == 1);
+    }
+
+    const auto& stats = cache.GetStats();
+    REQUIRE(stats.size() == 4);
+    REQUIRE(stats[0].staticUpdates == 2);
+    REQUIRE(stats[0].dynamicUpdates == 6);
+    REQUIRE(stats[0].skippedUpdates == 0);
+    REQUIRE(stats[2].dynamicUpdates + stats[3].dynamicUpdates == 8);
+    REQUIRE(stats[2].skippedUpdates + stats[3].skippedUpdates == 4);
+    REQUIRE(stats[2].lastStaticUpdateFrame == 2);
+
+    // Static geometry change re-renders without moving the projection
+    cache.MarkStaticDirty();
+    cache.BeginFrame(lightDir, resolution, true);
+    for (size_t i = 0; i < 4; ++i) {
+        const auto update = cache.UpdateCascade(i, minVec, maxVec, diameter);
+        REQUIRE(update.renderStatic);
+        REQUIRE(update.renderDynamic);
+        REQUIRE(update.bounds.position == cached[i].position);
+    }
+
+    // Leaving the padded region moves the cascade
+    const glm::vec3 bigOffset(30.0f, 0.0f, 0.0f);
+    cache.BeginFrame(lightDir, resolution, true);
+    const auto moved = cache.UpdateCascade(0, minVec + bigOffset, maxVec + bigOffset, diameter);
+    REQUIRE(moved.renderStatic);
+    REQUIRE(moved.bounds.position != cached[0].position);
+    REQUIRE(stratus::CascadeCache::Covers(moved.bounds, minVec + bigOffset, maxVec + bigOffset));
+
+    // Rotating the light invalidates everything
+    cache.BeginFrame(glm::normalize(glm::vec3(0.1f, -1.0f, 0.0f)), resolution, true);
+    REQUIRE(cache.UpdateCascade(3, minVec, maxVec, diameter).renderStatic);
+}
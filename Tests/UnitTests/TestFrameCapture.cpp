@@ -0,0 +1,239 @@
+#include <catch2/catch_all.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "StratusFrameCapture.h"
+
+static stratus::CapturedFrame MakeFrame(const stratus::u64 index) {
+    stratus::CapturedFrame frame;
+    frame.frame = index;
+    frame.deltaSeconds = 1.0 / 60.0;
+    frame.viewportWidth = 1600;
+    frame.viewportHeight = 900;
+    frame.hasCamera = index > 0;
+    frame.cameraPosition = glm::vec3(float(index), 2.0f, -3.5f);
+    frame.cameraPitch = 10.0f;
+    frame.cameraYaw = float(index) * 0.5f;
+    frame.fovy = 75.0f;
+    frame.znear = 0.25f;
+    frame.zfar = 1000.0f;
+    frame.clearColor = glm::vec4(0.1f, 0.2f, 0.3f, 1.0f);
+    return frame;
+}
+
+TEST_CASE( "Stratus Frame Capture Test", "[stratus_frame_capture_test]" ) {
+    std::cout << "Beginning stratus::FrameCapture test" << std::endl;
+
+    const std::string filename = "stratus_frame_capture_test.bin";
+
+    std::vector<stratus::CapturedFrame> frames;
+    for (stratus::u64 i = 0; i < 4; ++i) frames.push_back(MakeFrame(i));
+
+    stratus::CapturedLight light;
+    light.id = 1;
+    light.position = glm::vec3(1.0f, 2.0f, 3.0f);
+    light.color = glm::vec3(1.0f, 0.5f, 0.25f);
+    light.intensity = 800.0f;
+    light.staticLight = true;
+    frames[0].lights.push_back(light);
+
+    stratus::CapturedEntity entity;
+    entity.id = 300;
+    entity.transform = glm::mat4(2.0f);
+    entity.transform[3] = glm::vec4(5.0f, 6.0f, 7.0f, 1.0f);
+    entity.meshes.resize(3);
+    entity.meshes[1].boundsMin = glm::vec3(-1.0f, 0.0f, -2.0f);
+    entity.meshes[1].boundsMax = glm::vec3(1.0f, 4.0f, 2.0f);
+    entity.meshes[1].material = "../Resources/Sponza.glb#7";
+    entity.model = "../Resources/Sponza.glb";
+    entity.modelOptimizeGraph = true;
+    entity.modelCullMode = 1;
+    entity.modelNode = 200;
+    entity.lightInteracting = true;
+    frames[0].entities.push_back(entity);
+
+    // Settings change part way through and then stay the same
+    frames[2].settings.fxaaEnabled = false;
+    frames[2].settings.perFrameMaxScratchMemoryBytes = 1 << 20;
+    frames[2].settings.fogColor = glm::vec3(0.25f);
+    frames[3].settings = frames[2].settings;
+
+    stratus::CapturedLight moved = light;
+    moved.change = stratus::CaptureChange::CHANGED;
+    moved.position = glm::vec3(4.0f);
+    frames[2].lights.push_back(moved);
+    stratus::CapturedEntity transform;
+    transform.id = 300;
+    transform.change = stratus::CaptureChange::MOVED;
+    transform.transform = glm::mat4(3.0f);
+    frames[2].entities.push_back(transform);
+
+    stratus::CapturedLight cleared;
+    cleared.change = stratus::CaptureChange::CLEARED;
+    frames[3].lights.push_back(cleared);
+    stratus::CapturedEntity removed;
+    removed.id = 300;
+    removed.change = stratus::CaptureChange::REMOVED;
+    frames[3].entities.push_back(removed);
+
+    stratus::u64 bytes = 0;
+    {
+        stratus::FrameCaptureWriter writer(filename);
+        for (const auto& frame : frames) writer.Write(frame);
+        REQUIRE(writer.FramesWritten() == frames.size());
+        bytes = writer.BytesWritten();
+    }
+
+    // Settings are only written for the first frame and when they change, the last frame gets
+    // them from the one before
+    {
+        stratus::FrameCaptureReader reader(filename);
+        stratus::CapturedFrame read;
+        for (const auto& expected : frames) {
+            REQUIRE(reader.Next(read));
+            REQUIRE(read.frame == expected.frame);
+            REQUIRE(read.deltaSeconds == expected.deltaSeconds);
+            REQUIRE(read.viewportWidth == 1600);
+            REQUIRE(read.viewportHeight == 900);
+            REQUIRE(read.hasCamera == expected.hasCamera);
+            if (expected.hasCamera) {
+                REQUIRE(read.cameraPosition == expected.cameraPosition);
+                REQUIRE(read.cameraYaw == expected.cameraYaw);
+            }
+            REQUIRE(read.znear == expected.znear);
+            REQUIRE(read.clearColor == expected.clearColor);
+            REQUIRE(read.settings == expected.settings);
+            REQUIRE(read.lights.size() == expected.lights.size());
+            REQUIRE(read.entities.size() == expected.entities.size());
+        }
+        REQUIRE_FALSE(reader.Next(read));
+        REQUIRE(reader.FramesRead() == frames.size());
+    }
+
+    // Spot check the changes
+    {
+        stratus::FrameCaptureReader reader(filename);
+        stratus::CapturedFrame read;
+        REQUIRE(reader.Next(read));
+        REQUIRE(read.lights[0].change == stratus::CaptureChange::ADDED);
+        REQUIRE(read.lights[0].color == light.color);
+        REQUIRE(read.lights[0].intensity == 800.0f);
+        REQUIRE(read.lights[0].staticLight);
+        REQUIRE_FALSE(read.lights[0].virtualLight);
+        REQUIRE(read.entities[0].id == 300);
+        REQUIRE(read.entities[0].transform == entity.transform);
+        REQUIRE(read.entities[0].meshes.size() == 3);
+        REQUIRE(read.entities[0].meshes[0].material.empty());
+        REQUIRE(read.entities[0].meshes[1].boundsMin == entity.meshes[1].boundsMin);
+        REQUIRE(read.entities[0].meshes[1].boundsMax == entity.meshes[1].boundsMax);
+        REQUIRE(read.entities[0].meshes[1].material == entity.meshes[1].material);
+        REQUIRE(read.entities[0].model == entity.model);
+        REQUIRE(read.entities[0].modelOptimizeGraph);
+        REQUIRE(read.entities[0].modelCullMode == 1);
+        REQUIRE(read.entities[0].modelNode == 200);
+        REQUIRE(read.entities[0].lightInteracting);
+
+        REQUIRE(reader.Next(read));
+        REQUIRE(reader.Next(read));
+        REQUIRE(read.settings.fogColor == glm::vec3(0.25f));
+        REQUIRE_FALSE(read.settings.fxaaEnabled);
+        REQUIRE(read.lights[0].position == glm::vec3(4.0f));
+        REQUIRE(read.entities[0].change == stratus::CaptureChange::MOVED);
+        REQUIRE(read.entities[0].transform == glm::mat4(3.0f));
+
+        REQUIRE(reader.Next(read));
+        REQUIRE(read.lights[0].change == stratus::CaptureChange::CLEARED);
+        REQUIRE(read.entities[0].change == stratus::CaptureChange::REMOVED);
+    }
+
+    // A file cut off part way through a frame is an error rather than a short replay
+    {
+        std::ifstream in(filename, std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        REQUIRE(contents.size() == bytes);
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), std::streamsize(contents.size() - 5));
+    }
+    {
+        stratus::FrameCaptureReader reader(filename);
+        stratus::CapturedFrame read;
+        for (int i = 0; i < 3; ++i) REQUIRE(reader.Next(read));
+        REQUIRE_THROWS(reader.Next(read));
+    }
+
+    // A light count far larger than the file fails cleanly instead of allocating it
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        // Magic, version, frame, delta seconds, viewport, flags, fovy/znear/zfar and clear color
+        out << "SFCP";
+        out.put(char(stratus::FrameCaptureWriter::Version));
+        out.put(1);
+        for (int i = 0; i < 8; ++i) out.put(0);
+        out.put(1);
+        out.put(1);
+        out.put(0);
+        for (int i = 0; i < 7 * 4; ++i) out.put(0);
+        // 2^40 lights
+        for (int i = 0; i < 5; ++i) out.put(char(0x80));
+        out.put(0x20);
+    }
+    {
+        stratus::FrameCaptureReader reader(filename);
+        stratus::CapturedFrame read;
+        REQUIRE_THROWS_AS(reader.Next(read), std::runtime_error);
+    }
+
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out << "not a capture";
+    }
+    REQUIRE_THROWS(stratus::FrameCaptureReader(filename));
+    std::remove(filename.c_str());
+
+    REQUIRE_THROWS(stratus::FrameCaptureReader("/this/path/does/not/exist/capture.bin"));
+    REQUIRE_THROWS(stratus::FrameCaptureWriter("/this/path/does/not/exist/capture.bin"));
+
+    // Ids stay the same until forgotten and the recorder diffs light state
+    stratus::FrameCapture& capture = stratus::FrameCapture::Instance();
+    REQUIRE_FALSE(capture.IsCapturing());
+    capture.Start(filename);
+    REQUIRE(capture.IsCapturing());
+    const stratus::u64 session = capture.Session();
+    int objects[2];
+    const stratus::u64 first = capture.IdFor(&objects[0]);
+    REQUIRE(capture.IdFor(&objects[0]) == first);
+    REQUIRE(capture.IdFor(&objects[1]) != first);
+
+    stratus::CapturedLight state = light;
+    state.id = first;
+    REQUIRE(capture.LightChanged(state));
+    REQUIRE_FALSE(capture.LightChanged(state));
+    state.intensity = 10.0f;
+    REQUIRE(capture.LightChanged(state));
+    capture.Forget(&objects[0]);
+    REQUIRE(capture.IdFor(&objects[0]) != first);
+
+    capture.Write(MakeFrame(1));
+    capture.Write(MakeFrame(2));
+    REQUIRE(capture.FramesCaptured() == 2);
+    capture.Stop();
+    REQUIRE_FALSE(capture.IsCapturing());
+
+    stratus::FrameCaptureReader reader(filename);
+    stratus::CapturedFrame read;
+    int readFrames = 0;
+    while (reader.Next(read)) ++readFrames;
+    REQUIRE(readFrames == 2);
+    std::remove(filename.c_str());
+
+    // Every restart is a new session
+    REQUIRE_THROWS(capture.Start("/this/path/does/not/exist/capture.bin"));
+    REQUIRE_FALSE(capture.IsCapturing());
+    capture.Start(filename);
+    REQUIRE(capture.Session() != session);
+    capture.Stop();
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,137 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <cmath>
+#include <vector>
+
+#include "StratusFramePacer.h"
+
+// Time only moves when the pacer sleeps or spins, or when the test advances it to stand in for
+// a frame's work
+struct MockFramePacerClock : public stratus::FramePacerClock {
+    double now = 100.0;
+    double sleepOvershoot = 0.0002;
+    double spinStep = 0.000005;
+    size_t sleeps = 0;
+    size_t spins = 0;
+
+    double Now() override { return now; }
+    void Sleep(const double seconds) override { now += seconds + sleepOvershoot; ++sleeps; }
+    void Spin() override { now += spinStep; ++spins; }
+};
+
+static MockFramePacerClock * CreateMockPacer(std::unique_ptr<stratus::FramePacer>& pacer, const double target) {
+    MockFramePacerClock * clock = new MockFramePacerClock();
+    pacer = std::make_unique<stratus::FramePacer>(target, std::unique_ptr<stratus::FramePacerClock>(clock));
+    return clock;
+}
+
+TEST_CASE( "Stratus Frame Pacer Test", "[stratus_frame_pacer_test]" ) {
+    std::cout << "Beginning stratus::FramePacer test" << std::endl;
+
+    const double target = 1.0 / 60.0;
+    const double work = 0.005;
+
+    // Every frame starts on the 60 hz grid, mostly asleep
+    std::unique_ptr<stratus::FramePacer> pacer;
+    MockFramePacerClock * clock = CreateMockPacer(pacer, target);
+    const double first = pacer->WaitForNextFrame();
+    for (int i = 1; i <= 100; ++i) {
+        clock->now += work;
+        const double start = pacer->WaitForNextFrame();
+        REQUIRE(start >= first + i * target);
+        REQUIRE(start - (first + i * target) < 0.00002);
+    }
+
+    const stratus::FramePacerStats& stats = pacer->Stats();
+    REQUIRE(stats.frames == 100);
+    REQUIRE(std::fabs(stats.meanFrameMs - target * 1000.0) < 0.01);
+    REQUIRE(stats.frameTimeStdDevMs < 0.01);
+    REQUIRE(stats.missedFrames == 0);
+    REQUIRE(std::fabs(stats.lastWorkMs - 5.0) < 1e-6);
+    REQUIRE(std::fabs(stats.lastWaitMs - (target - work) * 1000.0) < 0.02);
+    // Once it knows how much sleeps overshoot by it only spins for about a sleep step
+    REQUIRE(stats.lastSleepMs > 9.0);
+    REQUIRE(stats.lastSpinMs < 1.3);
+    REQUIRE(clock->sleeps > 0);
+
+    // A slightly late frame doesn't push later frames off the grid
+    double slotStart = pacer->WaitForNextFrame();
+    clock->now += 0.020;
+    const double late = pacer->WaitForNextFrame();
+    REQUIRE(std::fabs(late - (slotStart + 0.020)) < 1e-9);
+    clock->now += work;
+    REQUIRE(pacer->WaitForNextFrame() - (slotStart + 2.0 * target) < 0.00002);
+
+    // A frame which runs more than a whole frame over resets the schedule instead of catching up
+    slotStart = pacer->WaitForNextFrame();
+    clock->now += 0.040;
+    const double reset = pacer->WaitForNextFrame();
+    REQUIRE(pacer->Stats().missedFrames == 1);
+    REQUIRE(std::fabs(reset - (slotStart + 0.040)) < 1e-9);
+    clock->now += work;
+    REQUIRE(pacer->WaitForNextFrame() - (reset + target) < 0.00002);
+
+    // No target means no waiting
+    std::unique_ptr<stratus::FramePacer> unlimited;
+    MockFramePacerClock * unlimitedClock = CreateMockPacer(unlimited, 0.0);
+    unlimited->WaitForNextFrame();
+    for (int i = 0; i < 100; ++i) {
+        // Alternate 10 and 20 ms frames
+        unlimitedClock->now += (i % 2 == 0) ? 0.010 : 0.020;
+        unlimited->WaitForNextFrame();
+    }
+    REQUIRE(unlimitedClock->sleeps == 0);
+    REQUIRE(unlimitedClock->spins == 0);
+    REQUIRE(unlimited->Stats().lastWaitMs == 0.0);
+    REQUIRE(std::fabs(unlimited->Stats().meanFrameMs - 15.0) < 1e-6);
+    REQUIRE(std::fabs(unlimited->Stats().minFrameMs - 10.0) < 1e-6);
+    REQUIRE(std::fabs(unlimited->Stats().maxFrameMs - 20.0) < 1e-6);
+    // Sample variance of +/- 5 ms around the mean
+    REQUIRE(std::fabs(unlimited->Stats().frameTimeVarianceMs2 - 2500.0 / 99.0) < 1e-6);
+    REQUIRE(std::fabs(unlimited->Stats().frameTimeStdDevMs - std::sqrt(2500.0 / 99.0)) < 1e-6);
+
+    unlimited->ResetStats();
+    REQUIRE(unlimited->Stats().frames == 0);
+    REQUIRE(unlimited->Stats().meanFrameMs == 0.0);
+}
+
+TEST_CASE( "Stratus Adaptive Frame Pacer Test", "[stratus_adaptive_frame_pacer_test]" ) {
+    std::cout << "Beginning stratus::FramePacer adaptive test" << std::endl;
+
+    const double target = 1.0 / 60.0;
+    const double work = 0.004;
+
+    std::unique_ptr<stratus::FramePacer> pacer;
+    MockFramePacerClock * clock = CreateMockPacer(pacer, target);
+    pacer->SetAdaptive(true);
+    REQUIRE(pacer->IsAdaptive());
+
+    const double first = pacer->WaitForNextFrame();
+    std::vector<double> starts;
+    for (int i = 0; i < 100; ++i) {
+        clock->now += work;
+        starts.push_back(pacer->WaitForNextFrame());
+    }
+
+    // Steady work means no margin so the prediction converges on the real cost
+    REQUIRE(std::fabs(pacer->Stats().predictedWorkMs - work * 1000.0) < 1e-6);
+
+    for (size_t i = 50; i < starts.size(); ++i) {
+        // Frame i occupies slot i + 1 and starts as late as it can while still finishing in it
+        const double slotEnd = first + double(i + 2) * target;
+        REQUIRE(starts[i] >= first + double(i + 1) * target);
+        REQUIRE(starts[i] + work <= slotEnd + 0.00002);
+        REQUIRE(slotEnd - (starts[i] + work) < 0.00002);
+    }
+
+    // Still paced at the target rate
+    REQUIRE(std::fabs(pacer->Stats().lastFrameMs - target * 1000.0) < 0.02);
+
+    // Noisy work leaves a margin so frames start earlier than the mean alone would suggest
+    for (int i = 0; i < 100; ++i) {
+        clock->now += (i % 2 == 0) ? 0.002 : 0.006;
+        pacer->WaitForNextFrame();
+    }
+    REQUIRE(pacer->Stats().predictedWorkMs > 4.0 + 1.0);
+    REQUIRE(pacer->Stats().predictedWorkMs < target * 1000.0);
+}
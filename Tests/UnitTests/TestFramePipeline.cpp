@@ -0,0 +1,125 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "StratusFramePipeline.h"
+
+// Simulation writes state, extract copies it into a snapshot and render reads the snapshot -
+// the same split the engine uses between entities, RendererFrontend and RendererBackend
+struct PipelineTestWorld {
+    std::atomic<bool> extracting{false};
+    std::atomic<bool> simulating{false};
+    std::atomic<bool> rendering{false};
+    std::atomic<bool> overlapError{false};
+    int state = 0;
+    int snapshot = 0;
+    std::vector<int> rendered;
+};
+
+static void RunPipelineTestFrames(stratus::FramePipeline& pipeline, PipelineTestWorld& world, const int frames,
+                                  const std::chrono::microseconds simulateTime, const std::chrono::microseconds renderTime) {
+    for (int i = 0; i < frames; ++i) {
+        const stratus::SystemStatus status = pipeline.RunFrame(
+            [&world]() {
+                world.extracting.store(true);
+                if (world.simulating.load() || world.rendering.load()) world.overlapError.store(true);
+                world.snapshot = world.state;
+                world.extracting.store(false);
+            },
+            [&world, &pipeline, simulateTime]() {
+                world.simulating.store(true);
+                if (world.extracting.load() || pipeline.IsPipelined() != pipeline.IsSimulationThread()) world.overlapError.store(true);
+                // Sleeps stand in for work so the numbers hold up on machines with few cores
+                std::this_thread::sleep_for(simulateTime);
+                ++world.state;
+                world.simulating.store(false);
+                return stratus::SystemStatus::SYSTEM_CONTINUE;
+            },
+            [&world, renderTime]() {
+                world.rendering.store(true);
+                if (world.extracting.load()) world.overlapError.store(true);
+                std::this_thread::sleep_for(renderTime);
+                world.rendered.push_back(world.snapshot);
+                world.rendering.store(false);
+            }
+        );
+        REQUIRE(status == stratus::SystemStatus::SYSTEM_CONTINUE);
+    }
+}
+
+TEST_CASE( "Stratus Frame Pipeline Test", "[stratus_frame_pipeline_test]" ) {
+    std::cout << "Beginning stratus::FramePipeline test" << std::endl;
+
+    constexpr int frames = 10;
+    const auto step = std::chrono::microseconds(100);
+
+    // Serial renders what was simulated this frame
+    stratus::FramePipeline serial(false);
+    REQUIRE_FALSE(serial.IsPipelined());
+    REQUIRE_FALSE(serial.IsSimulationThread());
+    PipelineTestWorld serialWorld;
+    RunPipelineTestFrames(serial, serialWorld, frames, step, step);
+    REQUIRE_FALSE(serialWorld.overlapError.load());
+    for (int i = 0; i < frames; ++i) REQUIRE(serialWorld.rendered[i] == i + 1);
+    REQUIRE(serial.Stats().frames == frames);
+    REQUIRE(serial.Stats().waitMs == 0.0);
+
+    // Pipelined renders the previous frame's simulation while the next one runs
+    stratus::FramePipeline pipelined(true);
+    REQUIRE(pipelined.IsPipelined());
+    REQUIRE_FALSE(pipelined.IsSimulationThread());
+    PipelineTestWorld pipelinedWorld;
+    RunPipelineTestFrames(pipelined, pipelinedWorld, frames, step, step);
+    REQUIRE_FALSE(pipelinedWorld.overlapError.load());
+    for (int i = 0; i < frames; ++i) REQUIRE(pipelinedWorld.rendered[i] == i);
+    REQUIRE(pipelinedWorld.state == frames);
+
+    // Status from the simulation makes it back out
+    const stratus::SystemStatus status = pipelined.RunFrame(
+        []() {},
+        []() { return stratus::SystemStatus::SYSTEM_SHUTDOWN; },
+        []() {}
+    );
+    REQUIRE(status == stratus::SystemStatus::SYSTEM_SHUTDOWN);
+}
+
+TEST_CASE( "Stratus Frame Pipeline Throughput Test", "[stratus_frame_pipeline_throughput_test]" ) {
+    std::cout << "Beginning stratus::FramePipeline throughput test" << std::endl;
+
+    constexpr int frames = 60;
+    struct Workload {
+        const char * name;
+        std::chrono::microseconds simulate;
+        std::chrono::microseconds render;
+    };
+    const Workload workloads[] = {
+        { "Balanced (4ms sim, 4ms render)", std::chrono::microseconds(4000), std::chrono::microseconds(4000) },
+        { "Render bound (2ms sim, 6ms render)", std::chrono::microseconds(2000), std::chrono::microseconds(6000) },
+        { "Simulation bound (6ms sim, 2ms render)", std::chrono::microseconds(6000), std::chrono::microseconds(2000) }
+    };
+
+    for (const Workload& workload : workloads) {
+        double msPerFrame[2];
+        for (int mode = 0; mode < 2; ++mode) {
+            stratus::FramePipeline pipeline(mode == 1);
+            PipelineTestWorld world;
+            const auto start = std::chrono::steady_clock::now();
+            RunPipelineTestFrames(pipeline, world, frames, workload.simulate, workload.render);
+            const auto end = std::chrono::steady_clock::now();
+            msPerFrame[mode] = std::chrono::duration<double, std::milli>(end - start).count() / double(frames);
+        }
+
+        std::cout << workload.name << ": serial " << msPerFrame[0] << " ms/frame, pipelined " << msPerFrame[1]
+                  << " ms/frame (" << (msPerFrame[0] / msPerFrame[1]) << "x)" << std::endl;
+
+        // Serial pays for both steps, pipelined for roughly the longer of the two
+        const double serialExpected = double((workload.simulate + workload.render).count()) / 1000.0;
+        const double pipelinedExpected = double(std::max(workload.simulate, workload.render).count()) / 1000.0;
+        REQUIRE(msPerFrame[0] >= serialExpected);
+        REQUIRE(msPerFrame[1] < serialExpected);
+        REQUIRE(msPerFrame[1] >= pipelinedExpected);
+    }
+}
@@ -0,0 +1,117 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "StratusIrradianceProbes.h"
+#include "StratusLight.h"
+
+static stratus::GpuAABB MakeBox(const glm::vec3& vmin, const glm::vec3& vmax) {
+    stratus::GpuAABB aabb;
+    aabb.vmin = glm::vec4(vmin, 1.0f);
+    aabb.vmax = glm::vec4(vmax, 1.0f);
+    return aabb;
+}
+
+TEST_CASE( "Stratus Irradiance Probes Test", "[stratus_irradiance_probes_test]" ) {
+    std::cout << "Beginning stratus::IrradianceProbeBaker test" << std::endl;
+
+    auto grid = stratus::IrradianceProbeBaker::CreateGrid(glm::vec3(-10.0f), glm::vec3(10.0f), 5.0f);
+    REQUIRE(grid->dimensions == glm::ivec3(5));
+    REQUIRE(grid->NumProbes() == 125);
+    REQUIRE(grid->IsValid());
+    REQUIRE(grid->ProbePosition(4, 4, 4) == glm::vec3(10.0f));
+
+    // Nothing has been baked so all irradiance should be 0
+    REQUIRE(grid->SampleIrradiance(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)) == glm::vec3(0.0f));
+
+    std::vector<stratus::IrradianceProbeLight> lights(1);
+    lights[0].position = glm::vec3(0.0f, 8.0f, 0.0f);
+    lights[0].color = glm::vec3(100.0f, 50.0f, 25.0f);
+    lights[0].radius = 30.0f;
+
+    // Without a task system the bake runs inline
+    auto job = stratus::IrradianceProbeBaker::ScheduleBake(lights, nullptr, grid);
+    REQUIRE(job.Completed());
+    REQUIRE(job.Result() == grid);
+
+    const glm::vec3 up = grid->SampleIrradiance(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::vec3 down = grid->SampleIrradiance(glm::vec3(0.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+    // Surfaces facing the light receive far more than those facing away
+    REQUIRE(up.r > 0.0f);
+    REQUIRE(up.r > 10.0f * down.r);
+    // Color ratios are preserved
+    REQUIRE(std::fabs(up.g / up.r - 0.5f) < 1e-3f);
+
+    // Further away means less light
+    const glm::vec3 far = grid->SampleIrradiance(glm::vec3(0.0f, -10.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    REQUIRE(far.r < up.r);
+
+    // Fully occluded bake receives nothing
+    auto occluded = stratus::IrradianceProbeBaker::CreateGrid(glm::vec3(-10.0f), glm::vec3(10.0f), 5.0f);
+    stratus::IrradianceProbeBaker::BakeProbes(lights, [](const glm::vec3&, const glm::vec3&) { return false; }, 0, occluded->NumProbes(), *occluded);
+    REQUIRE(occluded->SampleIrradiance(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)) == glm::vec3(0.0f));
+
+    // A wall between the light and the lower half of the grid
+    const auto visible = stratus::IrradianceProbeBaker::CreateOccluderVisibility({
+        MakeBox(glm::vec3(-20.0f, 2.0f, -20.0f), glm::vec3(20.0f, 3.0f, 20.0f))
+    });
+    REQUIRE_FALSE(visible(glm::vec3(0.0f), lights[0].position));
+    REQUIRE(visible(glm::vec3(0.0f, 5.0f, 0.0f), lights[0].position));
+    // Boxes containing either end are ignored
+    REQUIRE(visible(glm::vec3(0.0f, 2.5f, 0.0f), lights[0].position));
+
+    // The hierarchy over many boxes should agree with testing each box on its own
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coord(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> size(0.5f, 10.0f);
+    std::vector<stratus::GpuAABB> boxes;
+    std::vector<stratus::IrradianceProbeVisibilityFunction> single;
+    for (int i = 0; i < 200; ++i) {
+        const glm::vec3 vmin(coord(rng), coord(rng), coord(rng));
+        boxes.push_back(MakeBox(vmin, vmin + glm::vec3(size(rng), size(rng), size(rng))));
+        single.push_back(stratus::IrradianceProbeBaker::CreateOccluderVisibility({ boxes.back() }));
+    }
+    const auto all = stratus::IrradianceProbeBaker::CreateOccluderVisibility(boxes);
+    for (int i = 0; i < 500; ++i) {
+        const glm::vec3 from(coord(rng), coord(rng), coord(rng));
+        const glm::vec3 to(coord(rng), coord(rng), coord(rng));
+        bool expected = true;
+        for (const auto& box : single) expected = expected && box(from, to);
+        REQUIRE(all(from, to) == expected);
+    }
+
+    auto walled = stratus::IrradianceProbeBaker::CreateGrid(glm::vec3(-10.0f), glm::vec3(10.0f), 5.0f);
+    stratus::IrradianceProbeBaker::BakeProbes(lights, visible, 0, walled->NumProbes(), *walled);
+    REQUIRE(walled->SampleIrradiance(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)) == glm::vec3(0.0f));
+    REQUIRE(walled->SampleIrradiance(glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)).r > 0.0f);
+
+    // Only VPLs marked as baked are collected, and only once the GI pass has computed their color
+    stratus::LightRegistry registry;
+    auto baked = std::make_shared<stratus::VirtualPointLight>();
+    baked->SetBaked(true);
+    auto live = std::make_shared<stratus::VirtualPointLight>();
+    registry.Add(baked);
+    registry.Add(live);
+    REQUIRE((registry.Flags()[0] & stratus::LIGHT_FLAG_BAKED) != 0);
+    REQUIRE((registry.Flags()[1] & stratus::LIGHT_FLAG_BAKED) == 0);
+    REQUIRE(stratus::IrradianceProbeBaker::CollectBakedLights(registry).empty());
+
+    // Save + load should round trip exactly
+    const std::string file = stratus::IrradianceProbeGrid::ProbeFileForScene("stratus_irradiance_probes_test.scene");
+    REQUIRE(file == "stratus_irradiance_probes_test.scene.probes");
+    REQUIRE(grid->SaveToFile(file));
+
+    stratus::IrradianceProbeGrid loaded;
+    REQUIRE(loaded.LoadFromFile(file));
+    REQUIRE(loaded.IsValid());
+    REQUIRE(loaded.origin == grid->origin);
+    REQUIRE(loaded.spacing == grid->spacing);
+    REQUIRE(loaded.dimensions == grid->dimensions);
+    REQUIRE(loaded.coefficients == grid->coefficients);
+    std::remove(file.c_str());
+
+    REQUIRE_FALSE(loaded.LoadFromFile("stratus_irradiance_probes_missing.probes"));
+}
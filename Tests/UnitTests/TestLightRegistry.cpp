@@ -0,0 +1,156 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <vector>
+
+#include "StratusLightRegistry.h"
+#include "StratusLight.h"
+
+// SetPosition and SetIntensity go through the engine's frame counter so change the light directly instead
+struct TestPointLight : public stratus::PointLight {
+    TestPointLight(const bool staticLight) : stratus::PointLight(staticLight) {}
+
+    void Move(const glm::vec3& position) {
+        position_ = position;
+    }
+
+    void ChangeIntensity(const float intensity) {
+        intensity_ = intensity;
+        color_ = baseColor_ * intensity;
+    }
+};
+
+TEST_CASE( "Stratus Light Registry Test", "[stratus_light_registry_test]" ) {
+    std::cout << "Beginning stratus::LightRegistry test" << std::endl;
+
+    stratus::LightRegistry registry;
+    std::vector<std::shared_ptr<TestPointLight>> lights;
+    std::vector<stratus::LightHandle> handles;
+    for (int i = 0; i < 100; ++i) {
+        auto light = std::make_shared<TestPointLight>(i % 2 == 0);
+        light->Move(glm::vec3(float(i)));
+        lights.push_back(light);
+        handles.push_back(registry.Add(light));
+    }
+
+    REQUIRE(registry.Size() == 100);
+    // Adding twice returns the same handle
+    REQUIRE(registry.Add(lights[5]) == handles[5]);
+    REQUIRE(registry.Size() == 100);
+
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(registry.Find(lights[i]) == handles[i]);
+        REQUIRE(registry.Get(handles[i]) == lights[i]);
+        const size_t dense = registry.DenseIndex(handles[i]);
+        REQUIRE(registry.Positions()[dense] == glm::vec3(float(i)));
+        REQUIRE(bool(registry.Flags()[dense] & stratus::LIGHT_FLAG_STATIC) == (i % 2 == 0));
+        REQUIRE(registry.HandleAt(dense) == handles[i]);
+    }
+
+    // Removing keeps the arrays dense and makes the handle stale
+    REQUIRE(registry.Remove(handles[10]));
+    REQUIRE_FALSE(registry.Remove(handles[10]));
+    REQUIRE(registry.Size() == 99);
+    REQUIRE_FALSE(registry.IsValid(handles[10]));
+    REQUIRE(registry.Get(handles[10]) == nullptr);
+    REQUIRE_FALSE(registry.Contains(lights[10]));
+    for (int i = 0; i < 100; ++i) {
+        if (i == 10) continue;
+        REQUIRE(registry.Get(handles[i]) == lights[i]);
+        REQUIRE(registry.Positions()[registry.DenseIndex(handles[i])] == glm::vec3(float(i)));
+    }
+
+    // Slot is reused with a new generation
+    auto replacement = std::make_shared<TestPointLight>(false);
+    const stratus::LightHandle replacementHandle = registry.Add(replacement);
+    REQUIRE(replacementHandle.index == handles[10].index);
+    REQUIRE(replacementHandle != handles[10]);
+    REQUIRE(registry.Get(handles[10]) == nullptr);
+    REQUIRE(registry.Get(replacementHandle) == replacement);
+
+    // Change tracking
+    registry.SyncFromLights();
+    size_t numMoved = 0;
+    registry.ForEachMoved([&numMoved](const size_t) { ++numMoved; });
+    REQUIRE(numMoved == 0);
+
+    lights[3]->Move(glm::vec3(-1.0f));
+    lights[70]->SetColor(glm::vec3(0.5f));
+    lights[71]->SetCastsShadows(false);
+    REQUIRE(registry.SyncFromLights() == 3);
+
+    std::vector<size_t> moved;
+    registry.ForEachMoved([&moved](const size_t index) { moved.push_back(index); });
+    REQUIRE(moved.size() == 1);
+    REQUIRE(moved[0] == registry.DenseIndex(handles[3]));
+    REQUIRE(registry.Positions()[moved[0]] == glm::vec3(-1.0f));
+    REQUIRE(registry.Changed(registry.DenseIndex(handles[70])));
+    REQUIRE_FALSE(registry.Moved(registry.DenseIndex(handles[70])));
+    REQUIRE_FALSE(registry.Flags()[registry.DenseIndex(handles[71])] & stratus::LIGHT_FLAG_CASTS_SHADOWS);
+
+    // The dense arrays keep last sync's values until the next sync
+    lights[72]->ChangeIntensity(50.0f);
+    REQUIRE(registry.Intensities()[registry.DenseIndex(handles[72])] != 50.0f);
+    REQUIRE(registry.SyncFromLights() == 1);
+    REQUIRE(registry.Intensities()[registry.DenseIndex(handles[72])] == 50.0f);
+    REQUIRE(registry.Colors()[registry.DenseIndex(handles[72])] == lights[72]->GetColor());
+
+    registry.Clear();
+    REQUIRE(registry.Size() == 0);
+    REQUIRE(registry.Get(handles[0]) == nullptr);
+    REQUIRE(registry.Get(replacementHandle) == nullptr);
+}
+
+TEST_CASE( "Stratus Light Update Queue Test", "[stratus_light_update_queue_test]" ) {
+    std::cout << "Beginning stratus::LightUpdateQueue test" << std::endl;
+
+    stratus::LightUpdateQueue queue;
+    auto handle = [](uint32_t index, uint32_t generation = 1) {
+        return stratus::LightHandle{ index, generation };
+    };
+
+    queue.PushBack(handle(0));
+    queue.PushBack(handle(1));
+    queue.PushBack(handle(2));
+    // Already queued - keeps its place
+    queue.PushBack(handle(0));
+    REQUIRE(queue.Size() == 3);
+
+    // Front moves an existing entry
+    queue.PushFront(handle(2));
+    REQUIRE(queue.Size() == 3);
+    REQUIRE(queue.PopFront() == handle(2));
+    REQUIRE(queue.PopFront() == handle(0));
+
+    queue.PushBack(handle(3));
+    queue.Erase(handle(1));
+    REQUIRE_FALSE(queue.Contains(handle(1)));
+    REQUIRE(queue.Size() == 1);
+    REQUIRE(queue.PopFront() == handle(3));
+    REQUIRE(queue.Size() == 0);
+    REQUIRE_FALSE(queue.PopFront());
+
+    // A newer generation in the same slot replaces the stale entry
+    queue.PushBack(handle(4, 1));
+    queue.PushBack(handle(4, 2));
+    REQUIRE(queue.Size() == 1);
+    REQUIRE_FALSE(queue.Contains(handle(4, 1)));
+    REQUIRE(queue.PopFront() == handle(4, 2));
+
+    // Lots of churn should not break ordering
+    for (uint32_t round = 0; round < 1000; ++round) {
+        queue.PushBack(handle(round % 7));
+        queue.PushFront(handle((round + 3) % 7));
+        if (round % 5 == 0) queue.Erase(handle(round % 7));
+    }
+    size_t popped = 0;
+    while (queue.Size() > 0) {
+        REQUIRE(queue.PopFront());
+        ++popped;
+    }
+    REQUIRE(popped <= 7);
+
+    queue.PushBack(handle(0));
+    queue.Clear();
+    REQUIRE(queue.Size() == 0);
+    REQUIRE_FALSE(queue.PopFront());
+}
@@ -0,0 +1,229 @@
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StratusLog.h"
+
+struct CaptureLogSink : public stratus::LogSink {
+    virtual ~CaptureLogSink() = default;
+
+    void Write(const stratus::LogLevel level, const std::string& line) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        lines.push_back(line);
+        levels.push_back(level);
+    }
+
+    void Flush() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++flushes;
+    }
+
+    std::vector<std::string> Lines() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lines;
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> lines;
+    std::vector<stratus::LogLevel> levels;
+    size_t flushes = 0;
+};
+
+// Counts lines and checks that each thread's messages arrive in order. Messages look like "<thread> <index>".
+struct OrderCheckingLogSink : public stratus::LogSink {
+    OrderCheckingLogSink(const size_t threads) : next(threads, 0) {}
+    virtual ~OrderCheckingLogSink() = default;
+
+    void Write(const stratus::LogLevel, const std::string& line) override {
+        ++count;
+        const size_t start = line.find("-> ");
+        if (start == std::string::npos) {
+            ordered = false;
+            return;
+        }
+        const size_t thread = std::stoul(line.substr(start + 3));
+        const size_t index = std::stoul(line.substr(line.find(' ', start + 3) + 1));
+        if (thread >= next.size() || next[thread] != index) ordered = false;
+        else ++next[thread];
+    }
+
+    void Flush() override {}
+
+    size_t count = 0;
+    bool ordered = true;
+    std::vector<size_t> next;
+};
+
+// Puts the log back the way it was when the test finishes
+struct LogStateGuard {
+    LogStateGuard()
+        : sinks(stratus::Log::GetSinks()), level(stratus::Log::GetLevel()),
+          format(stratus::Log::GetFormat()), async(stratus::Log::IsAsync()) {}
+
+    ~LogStateGuard() {
+        stratus::Log::Flush();
+        stratus::Log::SetAsync(async);
+        stratus::Log::SetSinks(sinks);
+        stratus::Log::SetLevel(level);
+        stratus::Log::SetFormat(format);
+        stratus::Log::SetRateLimit(20, 1.0);
+    }
+
+    std::vector<std::shared_ptr<stratus::LogSink>> sinks;
+    stratus::LogLevel level;
+    stratus::LogFormat format;
+    bool async;
+};
+
+static bool Contains(const std::string& line, const std::string& text) {
+    return line.find(text) != std::string::npos;
+}
+
+static int CountEvaluations(int& evaluations) {
+    return ++evaluations;
+}
+
+TEST_CASE( "Stratus Log Test", "[stratus_log_test]" ) {
+    std::cout << "Beginning stratus::Log test" << std::endl;
+
+    LogStateGuard guard;
+    auto sink = std::make_shared<CaptureLogSink>();
+    stratus::Log::SetSinks({ sink });
+    stratus::Log::SetAsync(false);
+    stratus::Log::SetFormat(stratus::LogFormat::TEXT);
+    stratus::Log::SetRateLimit(0, 1.0);
+    stratus::Log::SetLevel(stratus::LogLevel::LOG_INFO);
+
+    STRATUS_LOG << "Hello " << 42 << std::endl;
+    STRATUS_WARN << "Careful" << std::endl;
+    STRATUS_ERROR << "Broken" << std::endl;
+    auto lines = sink->Lines();
+    REQUIRE(lines.size() == 3);
+    // Threads the engine doesn't know about get a generated name
+    REQUIRE(Contains(lines[0], "[Info] Thread::(Unnamed#"));
+    REQUIRE(Contains(lines[0], "-> Hello 42\n"));
+    REQUIRE(Contains(lines[1], "[Warn]"));
+    REQUIRE(Contains(lines[2], "[Error]"));
+    REQUIRE(sink->levels[2] == stratus::LogLevel::LOG_ERROR);
+    REQUIRE(sink->flushes >= 3);
+
+    // Without std::endl the message ends when the next one starts
+    STRATUS_LOG << "First";
+    STRATUS_LOG << "Second" << std::endl;
+    lines = sink->Lines();
+    REQUIRE(lines.size() == 5);
+    REQUIRE(Contains(lines[3], "-> First\n"));
+    REQUIRE(Contains(lines[4], "-> Second\n"));
+
+    // Formatting doesn't leak into the next message
+    STRATUS_LOG << std::boolalpha << std::fixed << std::setprecision(2) << true << " " << 1.0 << std::endl;
+    STRATUS_LOG << true << " " << 1.5 << std::endl;
+    lines = sink->Lines();
+    REQUIRE(Contains(lines[5], "-> true 1.00\n"));
+    REQUIRE(Contains(lines[6], "-> 1 1.5\n"));
+
+    // Filtered messages never evaluate their arguments
+    int evaluations = 0;
+    stratus::Log::SetLevel(stratus::LogLevel::LOG_WARN);
+    REQUIRE_FALSE(stratus::Log::IsEnabled(stratus::LogLevel::LOG_INFO));
+    STRATUS_LOG << CountEvaluations(evaluations) << std::endl;
+    STRATUS_WARN << CountEvaluations(evaluations) << std::endl;
+    stratus::Log::SetLevel(stratus::LogLevel::LOG_NONE);
+    STRATUS_ERROR << CountEvaluations(evaluations) << std::endl;
+    REQUIRE(evaluations == 1);
+    REQUIRE(sink->Lines().size() == 8);
+    stratus::Log::SetLevel(stratus::LogLevel::LOG_INFO);
+
+    // Safe as the body of an unbraced if/else
+    if (evaluations == 0) STRATUS_LOG << "Not logged" << std::endl;
+    else STRATUS_LOG << "Logged" << std::endl;
+    REQUIRE(Contains(sink->Lines().back(), "-> Logged\n"));
+
+    stratus::Log::SetFormat(stratus::LogFormat::JSON_LINES);
+    STRATUS_WARN << "Quote \" slash \\ tab \t done" << std::endl;
+    const std::string json = sink->Lines().back();
+    REQUIRE(json.front() == '{');
+    REQUIRE(Contains(json, "\"level\":\"warn\""));
+    REQUIRE(Contains(json, "\"thread\":\"Unnamed#"));
+    REQUIRE(Contains(json, "\"message\":\"Quote \\\" slash \\\\ tab \\t done\"}\n"));
+    stratus::Log::SetFormat(stratus::LogFormat::TEXT);
+
+    // Messages past the limit are dropped and summarized once the window ends
+    stratus::Log::ResetStats();
+    stratus::Log::SetRateLimit(3, 0.05);
+    const size_t before = sink->Lines().size();
+    for (int i = 0; i < 10; ++i) {
+        STRATUS_LOG << "Spam" << std::endl;
+    }
+    REQUIRE(sink->Lines().size() == before + 3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    stratus::Log::Flush();
+    lines = sink->Lines();
+    REQUIRE(lines.size() == before + 4);
+    REQUIRE(Contains(lines.back(), "-> Spam (repeated 7 more times)\n"));
+
+    const stratus::LogStats stats = stratus::Log::Stats();
+    REQUIRE(stats.messages == 10);
+    REQUIRE(stats.suppressed == 7);
+    REQUIRE(stats.written == 4);
+
+    // Background writer
+    stratus::Log::SetRateLimit(0, 1.0);
+    stratus::Log::SetAsync(true);
+    REQUIRE(stratus::Log::IsAsync());
+    STRATUS_LOG << "Async" << std::endl;
+    stratus::Log::Flush();
+    REQUIRE(Contains(sink->Lines().back(), "-> Async\n"));
+    stratus::Log::SetAsync(false);
+
+    REQUIRE_THROWS(stratus::FileLogSink("/this/path/does/not/exist/log.txt"));
+}
+
+TEST_CASE( "Stratus Log Throughput Test", "[stratus_log_throughput_test]" ) {
+    std::cout << "Beginning stratus::Log throughput test" << std::endl;
+
+    constexpr size_t numThreads = 16;
+    constexpr size_t messagesPerThread = 1000000 / numThreads;
+
+    LogStateGuard guard;
+    stratus::Log::SetRateLimit(0, 1.0);
+    stratus::Log::SetFormat(stratus::LogFormat::TEXT);
+    stratus::Log::SetLevel(stratus::LogLevel::LOG_INFO);
+
+    for (const bool async : { false, true }) {
+        auto sink = std::make_shared<OrderCheckingLogSink>(numThreads);
+        stratus::Log::SetSinks({ sink });
+        stratus::Log::SetAsync(async);
+        stratus::Log::ResetStats();
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < numThreads; ++t) {
+            threads.emplace_back([t]() {
+                for (size_t i = 0; i < messagesPerThread; ++i) {
+                    STRATUS_LOG << t << " " << i << std::endl;
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        // Time until the producers are done - what the engine's threads would see
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stratus::Log::Flush();
+
+        const stratus::LogStats stats = stratus::Log::Stats();
+        std::cout << (async ? "Async" : "Sync") << " logging: " << size_t(double(numThreads * messagesPerThread) / seconds)
+                  << " messages/sec across " << numThreads << " threads (" << stats.queueFullWaits << " full queue waits)" << std::endl;
+
+        REQUIRE(sink->count == numThreads * messagesPerThread);
+        REQUIRE(sink->ordered);
+        REQUIRE(stats.messages == numThreads * messagesPerThread);
+        REQUIRE(stats.written == numThreads * messagesPerThread);
+    }
+
+    stratus::Log::SetAsync(false);
+}
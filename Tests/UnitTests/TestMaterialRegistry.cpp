@@ -0,0 +1,173 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "StratusMaterialRegistry.h"
+
+// Registry only stores and hands back the pointer
+static stratus::Material * FakeMaterial(const size_t i) {
+    static char storage[64];
+    return reinterpret_cast<stratus::Material *>(&storage[i]);
+}
+
+TEST_CASE( "Stratus Material Registry Test", "[stratus_material_registry_test]" ) {
+    std::cout << "Beginning stratus::MaterialRegistry test" << std::endl;
+
+    stratus::MaterialRegistry registry;
+    auto a = registry.Register(FakeMaterial(0));
+    auto b = registry.Register(FakeMaterial(1));
+    auto c = registry.Register(FakeMaterial(2));
+    REQUIRE(a.index == 0);
+    REQUIRE(c.index == 2);
+    REQUIRE(registry.Size() == 3);
+    REQUIRE(registry.Capacity() == 3);
+
+    stratus::Material * found = nullptr;
+    REQUIRE(registry.With(b, [&found](stratus::Material * m) { found = m; }));
+    REQUIRE(found == FakeMaterial(1));
+
+    registry.MarkChanged(c);
+    registry.MarkChanged(a);
+    registry.MarkChanged(a);
+    REQUIRE(registry.TakeChanged() == std::vector<uint32_t>{ 0, 2 });
+    REQUIRE(registry.TakeChanged().size() == 0);
+
+    // Stale once removed, the slot is reused with a new generation
+    registry.MarkChanged(b);
+    registry.Unregister(b);
+    REQUIRE_FALSE(registry.IsValid(b));
+    REQUIRE_FALSE(registry.With(b, [](stratus::Material *) {}));
+    REQUIRE(registry.TakeChanged().size() == 0);
+
+    auto d = registry.Register(FakeMaterial(3));
+    REQUIRE(d.index == b.index);
+    REQUIRE(d != b);
+    REQUIRE(registry.IsValid(d));
+    REQUIRE(registry.Capacity() == 3);
+    registry.MarkChanged(b);
+    REQUIRE(registry.TakeChanged().size() == 0);
+    REQUIRE_FALSE(bool(stratus::MaterialHandle::Null()));
+}
+
+TEST_CASE( "Stratus Material Change Tracker Test", "[stratus_material_change_tracker_test]" ) {
+    std::cout << "Beginning stratus::MaterialChangeTracker test" << std::endl;
+
+    using stratus::TextureHandle;
+    const TextureHandle t0 = TextureHandle::NextHandle();
+    const TextureHandle t1 = TextureHandle::NextHandle();
+    const TextureHandle t2 = TextureHandle::NextHandle();
+
+    stratus::MaterialChangeTracker tracker;
+    tracker.Track(3, { t0, t1 });
+    tracker.Track(70, { t1, TextureHandle::Null(), t1 });
+    tracker.Track(5, {});
+    REQUIRE(tracker.NumTracked() == 3);
+    REQUIRE(tracker.NumDirty() == 3);
+    REQUIRE(tracker.TakeDirty() == std::vector<uint32_t>{ 3, 5, 70 });
+    REQUIRE(tracker.NumDirty() == 0);
+
+    // Only materials using a changed texture become dirty
+    tracker.TexturesChanged({ t0 });
+    REQUIRE(tracker.TakeDirty() == std::vector<uint32_t>{ 3 });
+    tracker.TexturesChanged({ t1, t2 });
+    REQUIRE(tracker.TakeDirty() == std::vector<uint32_t>{ 3, 70 });
+
+    // Retracking replaces what the material depends on
+    tracker.Track(3, { t2 });
+    tracker.TakeDirty();
+    tracker.TexturesChanged({ t0, t1 });
+    REQUIRE(tracker.TakeDirty() == std::vector<uint32_t>{ 70 });
+    REQUIRE(tracker.Textures(3)[0] == t2);
+
+    // Untracked materials are never reported
+    tracker.MarkDirty(70);
+    tracker.Untrack(70);
+    REQUIRE(tracker.NumDirty() == 0);
+    tracker.TexturesChanged({ t1 });
+    tracker.MarkDirty(1000);
+    REQUIRE(tracker.TakeDirty().size() == 0);
+    REQUIRE(tracker.NumTracked() == 2);
+    REQUIRE(tracker.Textures(70)[0] == TextureHandle::Null());
+}
+
+// Scene with every texture streaming in, a handful finishing each frame. Compares the materials re-copied per
+// frame against re-checking every material which is still waiting on a texture.
+TEST_CASE( "Stratus Material Change Tracker Streaming Test", "[stratus_material_change_tracker_streaming_test]" ) {
+    std::cout << "Beginning stratus::MaterialChangeTracker streaming test" << std::endl;
+
+    using stratus::TextureHandle;
+    constexpr size_t numMaterials = 20000;
+    constexpr size_t numTextures = 8000;
+    constexpr size_t texturesPerFrame = 50;
+
+    std::mt19937 rng(1234);
+    std::vector<TextureHandle> textures(numTextures);
+    for (auto& texture : textures) texture = TextureHandle::NextHandle();
+
+    std::vector<stratus::MaterialChangeTracker::TextureList> materials(numMaterials);
+    for (auto& list : materials) {
+        // Not every slot has a map
+        for (size_t slot = 0; slot < list.size(); ++slot) {
+            if (rng() % 3 != 0) list[slot] = textures[rng() % numTextures];
+        }
+    }
+
+    std::vector<size_t> order(numTextures);
+    for (size_t i = 0; i < numTextures; ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+
+    stratus::MaterialChangeTracker tracker;
+    for (uint32_t i = 0; i < numMaterials; ++i) tracker.Track(i, materials[i]);
+    tracker.TakeDirty();
+
+    std::unordered_set<TextureHandle> loaded;
+    size_t processed = 0;
+    size_t polled = 0;
+    size_t frames = 0;
+    double elapsedMs = 0.0;
+
+    for (size_t next = 0; next < numTextures; next += texturesPerFrame) {
+        std::unordered_set<TextureHandle> changed;
+        for (size_t i = next; i < std::min(numTextures, next + texturesPerFrame); ++i) {
+            changed.insert(textures[order[i]]);
+            loaded.insert(textures[order[i]]);
+        }
+
+        auto start = std::chrono::system_clock::now();
+        tracker.TexturesChanged(changed);
+        const auto dirty = tracker.TakeDirty();
+        auto end = std::chrono::system_clock::now();
+        elapsedMs += double(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()) / 1000.0;
+
+        // Every dirty material uses a texture that changed
+        for (const uint32_t index : dirty) {
+            bool usesChanged = false;
+            for (const auto texture : materials[index]) usesChanged = usesChanged || changed.find(texture) != changed.end();
+            REQUIRE(usesChanged);
+        }
+        processed += dirty.size();
+
+        // Polling re-copies everything which was still waiting at the start of the frame
+        for (const auto& list : materials) {
+            for (const auto texture : list) {
+                if (texture != TextureHandle::Null() && (loaded.find(texture) == loaded.end() || changed.find(texture) != changed.end())) {
+                    ++polled;
+                    break;
+                }
+            }
+        }
+        ++frames;
+    }
+
+    std::cout << "Frames: " << frames << std::endl;
+    std::cout << "Materials processed per frame: " << (double(processed) / frames)
+              << " (polling: " << (double(polled) / frames) << ")" << std::endl;
+    std::cout << "Elapsed MS: " << elapsedMs << std::endl;
+
+    REQUIRE(processed < polled);
+    REQUIRE(tracker.NumDirty() == 0);
+}
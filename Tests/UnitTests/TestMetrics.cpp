@@ -0,0 +1,140 @@
+#include <catch2/catch_all.hpp>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StratusMetrics.h"
+
+TEST_CASE( "Stratus Metrics Test", "[stratus_metrics_test]" ) {
+    std::cout << "Beginning stratus::MetricsRegistry test" << std::endl;
+
+    stratus::MetricsRegistry& metrics = stratus::MetricsRegistry::Instance();
+
+    const auto counter = metrics.RegisterCounter("Test.counter", "Incremented by every thread");
+    const auto gauge = metrics.RegisterGauge("Test.gauge");
+    const auto histogram = metrics.RegisterHistogram("Test.histogram", { 1.0, 2.0, 4.0, 8.0 });
+
+    // Same name gives the same id, a different type is an error
+    REQUIRE(metrics.RegisterCounter("Test.counter") == counter);
+    REQUIRE_THROWS(metrics.RegisterGauge("Test.counter"));
+    REQUIRE_THROWS(metrics.RegisterHistogram("Test.unsorted", { 2.0, 1.0 }));
+    REQUIRE_THROWS(metrics.RegisterHistogram("Test.empty", {}));
+    // Using an id as the wrong type
+    REQUIRE_THROWS(metrics.Increment(gauge));
+    REQUIRE_THROWS(metrics.Record(counter, 1.0));
+
+    constexpr int numThreads = 8;
+    constexpr int perThread = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < perThread; ++i) {
+                metrics.Increment(counter);
+                // 0.5, 1.5, 2.5, ... 9.5 spread evenly
+                metrics.Record(histogram, 0.5 + double(i % 10));
+                metrics.AddGauge(gauge, 1.0);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    stratus::MetricsSnapshot snapshot = metrics.Snapshot();
+    REQUIRE(snapshot.Find("Test.missing") == nullptr);
+    const stratus::MetricSnapshot * c = snapshot.Find("Test.counter");
+    REQUIRE(c != nullptr);
+    REQUIRE(c->type == stratus::MetricType::COUNTER);
+    REQUIRE(c->description == "Incremented by every thread");
+    REQUIRE(c->count == numThreads * perThread);
+    REQUIRE(snapshot.Find("Test.gauge")->value == double(numThreads * perThread));
+
+    const stratus::HistogramSnapshot& h = snapshot.Find("Test.histogram")->histogram;
+    REQUIRE(h.count == numThreads * perThread);
+    REQUIRE(h.counts == std::vector<stratus::u64>{ 8000, 8000, 16000, 32000, 16000 });
+    REQUIRE(h.min == 0.5);
+    REQUIRE(h.max == 9.5);
+    REQUIRE(std::fabs(h.Mean() - 5.0) < 1e-9);
+    REQUIRE(std::fabs(h.Percentile(0.5) - 5.0) < 0.5);
+    REQUIRE(h.Percentile(0.0) >= h.min);
+    REQUIRE(h.Percentile(1.0) == 9.5);
+
+    // Shards of threads which have exited are reused
+    const stratus::usize shards = metrics.NumShards();
+    for (int t = 0; t < 4; ++t) {
+        std::thread([&]() { metrics.Increment(counter); }).join();
+    }
+    REQUIRE(metrics.NumShards() <= shards + 1);
+    REQUIRE(metrics.Snapshot().Find("Test.counter")->count == numThreads * perThread + 4);
+
+    metrics.SetGauge(gauge, 2.5);
+    std::ostringstream json;
+    metrics.Snapshot().WriteJson(json);
+    const std::string line = json.str();
+    REQUIRE(line.find("\"Test.counter\":{\"type\":\"counter\",\"value\":80004}") != std::string::npos);
+    REQUIRE(line.find("\"Test.gauge\":{\"type\":\"gauge\",\"value\":2.5}") != std::string::npos);
+    REQUIRE(line.find("\"counts\":[8000,8000,16000,32000,16000]") != std::string::npos);
+    REQUIRE(line.find('\n') == std::string::npos);
+
+    REQUIRE(metrics.ExponentialBounds(1.0, 2.0, 4) == std::vector<double>{ 1.0, 2.0, 4.0, 8.0 });
+
+    // Periodic dump plus a final snapshot on destruction
+    const std::string filename = "stratus_metrics_test.jsonl";
+    {
+        stratus::MetricsFileWriter writer(filename, 0.01);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        REQUIRE(writer.SnapshotsWritten() >= 1);
+    }
+    std::ifstream file(filename);
+    std::string fileLine;
+    int lines = 0;
+    while (std::getline(file, fileLine)) {
+        REQUIRE(fileLine.rfind("{\"ts\":", 0) == 0);
+        REQUIRE(fileLine.find("\"Test.counter\"") != std::string::npos);
+        ++lines;
+    }
+    file.close();
+    std::remove(filename.c_str());
+    REQUIRE(lines >= 2);
+
+    REQUIRE_THROWS(stratus::MetricsFileWriter("/this/path/does/not/exist/metrics.jsonl", 1.0));
+}
+
+TEST_CASE( "Stratus Metrics Contention Test", "[stratus_metrics_contention_test]" ) {
+    std::cout << "Beginning stratus::MetricsRegistry contention test" << std::endl;
+
+    constexpr int numThreads = 16;
+    constexpr int perThread = 1000000;
+
+    stratus::MetricsRegistry& metrics = stratus::MetricsRegistry::Instance();
+    const auto counter = metrics.RegisterCounter("Test.contention");
+
+    // Compared against every thread hammering one shared atomic
+    std::atomic<stratus::i64> shared(0);
+    const auto run = [](const std::function<void (void)>& increment) {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < numThreads; ++t) {
+            threads.emplace_back([&increment]() {
+                for (int i = 0; i < perThread; ++i) increment();
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / double(numThreads * perThread);
+    };
+
+    const double shardedNs = run([&]() { metrics.Increment(counter); });
+    const double sharedNs = run([&]() { shared.fetch_add(1, std::memory_order_relaxed); });
+
+    std::cout << "Counter increment across " << numThreads << " threads: " << shardedNs << " ns sharded, "
+              << sharedNs << " ns with one shared atomic" << std::endl;
+
+    REQUIRE(metrics.Snapshot().Find("Test.contention")->count == stratus::i64(numThreads) * perThread);
+    REQUIRE(shared.load() == stratus::i64(numThreads) * perThread);
+}
@@ -0,0 +1,100 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include "StratusMipGenerator.h"
+
+TEST_CASE( "Stratus Mip Generator Test", "[stratus_mip_generator_test]" ) {
+    std::cout << "Beginning stratus::MipGenerator test" << std::endl;
+
+    REQUIRE(stratus::MipGenerator::NumLevels(1, 1) == 1);
+    REQUIRE(stratus::MipGenerator::NumLevels(256, 256) == 9);
+    REQUIRE(stratus::MipGenerator::NumLevels(37, 10) == 6);
+
+    // Black/white checkerboard averages to 50% linear intensity, which is ~188 in sRGB rather than 128
+    const uint32_t size = 64;
+    std::vector<uint8_t> checker(size * size * 3);
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            const uint8_t value = ((x + y) & 1) ? 255 : 0;
+            for (uint32_t c = 0; c < 3; ++c) checker[(y * size + x) * 3 + c] = value;
+        }
+    }
+
+    stratus::MipGenerationOptions srgb;
+    srgb.srgb = true;
+    auto levels = stratus::MipGenerator::Generate(checker.data(), size, size, 3, srgb);
+    REQUIRE(levels.size() == 7);
+    REQUIRE(levels[0].data == checker);
+    REQUIRE(levels.back().width == 1);
+    REQUIRE(levels.back().data.size() == 3);
+    for (size_t level = 1; level < levels.size(); ++level) {
+        REQUIRE(std::abs(int(levels[level].data[0]) - 188) <= 1);
+    }
+
+    auto linearLevels = stratus::MipGenerator::Generate(checker.data(), size, size, 3, stratus::MipGenerationOptions());
+    REQUIRE(std::abs(int(linearLevels[1].data[0]) - 128) <= 1);
+
+    // Normals tilted in opposite directions average to a short vector which must be renormalized
+    std::vector<uint8_t> normals(size * size * 3);
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            const float nx = (x & 1) ? 0.6f : -0.6f;
+            uint8_t * texel = normals.data() + (y * size + x) * 3;
+            texel[0] = uint8_t((nx * 0.5f + 0.5f) * 255.0f + 0.5f);
+            texel[1] = 128;
+            texel[2] = uint8_t((0.8f * 0.5f + 0.5f) * 255.0f + 0.5f);
+        }
+    }
+
+    stratus::MipGenerationOptions normalMap;
+    normalMap.normalMap = true;
+    auto normalLevels = stratus::MipGenerator::Generate(normals.data(), size, size, 3, normalMap);
+    for (size_t level = 1; level < normalLevels.size(); ++level) {
+        const uint8_t * texel = normalLevels[level].data.data();
+        const float x = texel[0] / 255.0f * 2.0f - 1.0f;
+        const float y = texel[1] / 255.0f * 2.0f - 1.0f;
+        const float z = texel[2] / 255.0f * 2.0f - 1.0f;
+        REQUIRE(std::abs(std::sqrt(x * x + y * y + z * z) - 1.0f) < 0.02f);
+        REQUIRE(texel[2] >= 254);
+    }
+
+    // Sparse foliage-like alpha: 1 of every 4 texels is opaque. A plain box filter drops every texel
+    // to 25% alpha which would fail a 0.5 alpha test entirely.
+    std::vector<uint8_t> foliage(size * size * 4, 255);
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            foliage[(y * size + x) * 4 + 3] = ((x & 1) == 0 && (y & 1) == 0) ? 255 : 0;
+        }
+    }
+
+    const float threshold = 0.5f;
+    const float coverage = stratus::MipGenerator::AlphaCoverage({ size, size, foliage }, 4, threshold);
+    REQUIRE(std::abs(coverage - 0.25f) < 1e-6f);
+
+    auto plain = stratus::MipGenerator::Generate(foliage.data(), size, size, 4, stratus::MipGenerationOptions());
+    REQUIRE(stratus::MipGenerator::AlphaCoverage(plain[1], 4, threshold) == 0.0f);
+
+    // Smoothly varying alpha keeps partial coverage reachable at every level. Filtering pulls
+    // values toward the mean which shrinks coverage at a high threshold unless it is corrected.
+    const float highThreshold = 0.7f;
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            foliage[(y * size + x) * 4 + 3] = uint8_t(127.5f + 127.5f * std::sin(x * 0.4f) * std::sin(y * 0.3f));
+        }
+    }
+
+    stratus::MipGenerationOptions preserve;
+    preserve.alphaCoverageThreshold = highThreshold;
+    const float variedCoverage = stratus::MipGenerator::AlphaCoverage({ size, size, foliage }, 4, highThreshold);
+    auto filtered = stratus::MipGenerator::Generate(foliage.data(), size, size, 4, stratus::MipGenerationOptions());
+    auto preserved = stratus::MipGenerator::Generate(foliage.data(), size, size, 4, preserve);
+    // Only check levels big enough (8x8 and up) for coverage to be finely representable
+    for (size_t level = 1; level <= 3; ++level) {
+        const float plainError = std::abs(stratus::MipGenerator::AlphaCoverage(filtered[level], 4, highThreshold) - variedCoverage);
+        const float preservedError = std::abs(stratus::MipGenerator::AlphaCoverage(preserved[level], 4, highThreshold) - variedCoverage);
+        REQUIRE(preservedError < 0.05f);
+        REQUIRE(preservedError <= plainError);
+    }
+}
@@ -0,0 +1,144 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "StratusProfiler.h"
+
+TEST_CASE( "Stratus Profile Event Ring Test", "[stratus_profile_event_ring_test]" ) {
+    std::cout << "Beginning stratus::ProfileEventRing test" << std::endl;
+
+    stratus::ProfileEventRing ring(6);
+    REQUIRE(ring.Capacity() == 8);
+
+    std::vector<stratus::ProfileEvent> out;
+    // Go around the ring a few times
+    for (int64_t round = 0; round < 3; ++round) {
+        for (int64_t i = 0; i < 8; ++i) {
+            REQUIRE(ring.Push(stratus::ProfileEvent{ "event", round * 8 + i, round * 8 + i + 1, 0 }));
+        }
+        // Full
+        REQUIRE_FALSE(ring.Push(stratus::ProfileEvent{ "dropped", 0, 0, 0 }));
+
+        out.clear();
+        REQUIRE(ring.PopAll(out) == 8);
+        for (int64_t i = 0; i < 8; ++i) REQUIRE(out[i].startNs == round * 8 + i);
+        REQUIRE(ring.PopAll(out) == 0);
+    }
+
+    // One thread writing while another drains never loses or reorders anything
+    constexpr int64_t numEvents = 200000;
+    stratus::ProfileEventRing shared(1024);
+    std::thread producer([&shared]() {
+        for (int64_t i = 0; i < numEvents; ++i) {
+            while (!shared.Push(stratus::ProfileEvent{ "event", i, i, 0 })) std::this_thread::yield();
+        }
+    });
+
+    std::vector<stratus::ProfileEvent> received;
+    while (int64_t(received.size()) < numEvents) shared.PopAll(received);
+    producer.join();
+
+    for (int64_t i = 0; i < numEvents; ++i) REQUIRE(received[i].startNs == i);
+}
+
+TEST_CASE( "Stratus Profiler Test", "[stratus_profiler_test]" ) {
+    std::cout << "Beginning stratus::Profiler test" << std::endl;
+
+    stratus::Profiler& profiler = stratus::Profiler::Instance();
+    const stratus::u32 draws = profiler.RegisterCounter("Draws");
+    REQUIRE(profiler.RegisterCounter("Draws") == draws);
+
+    // Nothing is recorded while not capturing
+    {
+        stratus::ProfileScope scope("Ignored");
+    }
+    profiler.StartCapture();
+    REQUIRE(profiler.Stats().capturing);
+    REQUIRE(profiler.Stats().events == 0);
+
+    profiler.BeginFrame();
+    {
+        stratus::ProfileScope outer("Outer");
+        {
+            stratus::ProfileScope inner("Inner");
+            profiler.AddCounter(draws, 10);
+        }
+        profiler.AddCounter(draws, 5);
+    }
+
+    // Each thread gets its own track
+    constexpr size_t numThreads = 4;
+    constexpr size_t scopesPerThread = 1000;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.push_back(std::thread([t, &profiler]() {
+            profiler.SetThreadName("Worker \"" + std::to_string(t) + "\"");
+            for (size_t i = 0; i < scopesPerThread; ++i) {
+                stratus::ProfileScope scope("Work");
+            }
+        }));
+    }
+    for (auto& thread : threads) thread.join();
+
+    // GPU timings arrive separately with their own timestamps
+    const int64_t now = stratus::Profiler::NowNs();
+    profiler.RecordGpuEvent(stratus::ProfileEvent{ "Bloom", now, now + 1000, 0 });
+
+    profiler.BeginFrame();
+    REQUIRE(profiler.LastFrameCounter(draws) == 15);
+    REQUIRE(profiler.Stats().events == 2 + numThreads * scopesPerThread + 1);
+    REQUIRE(profiler.Stats().frames == 2);
+    REQUIRE(profiler.Stats().dropped == 0);
+
+    profiler.StopCapture();
+    REQUIRE_FALSE(profiler.Stats().capturing);
+    {
+        stratus::ProfileScope scope("Ignored");
+    }
+    profiler.BeginFrame();
+    REQUIRE(profiler.Stats().events == 2 + numThreads * scopesPerThread + 1);
+
+    std::stringstream trace;
+    profiler.WriteTrace(trace);
+    const std::string json = trace.str();
+    REQUIRE(json.find("\"traceEvents\"") != std::string::npos);
+    REQUIRE(json.find("{\"name\":\"Outer\",\"cat\":\"cpu\",\"ph\":\"X\"") != std::string::npos);
+    REQUIRE(json.find("\"name\":\"Inner\"") != std::string::npos);
+    REQUIRE(json.find("\"depth\":1") != std::string::npos);
+    REQUIRE(json.find("{\"name\":\"Bloom\",\"cat\":\"gpu\",\"ph\":\"X\"") != std::string::npos);
+    REQUIRE(json.find("{\"name\":\"Draws\",\"ph\":\"C\"") != std::string::npos);
+    REQUIRE(json.find("\"args\":{\"value\":15}") != std::string::npos);
+    REQUIRE(json.find("\"args\":{\"name\":\"Worker \\\"0\\\"\"}") != std::string::npos);
+    REQUIRE(json.find("Ignored") == std::string::npos);
+}
+
+TEST_CASE( "Stratus Profiler Overhead Test", "[stratus_profiler_overhead_test]" ) {
+    std::cout << "Beginning stratus::Profiler overhead test" << std::endl;
+
+    stratus::Profiler& profiler = stratus::Profiler::Instance();
+    constexpr size_t numScopes = 1000000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < numScopes; ++i) {
+        stratus::ProfileScope scope("Idle");
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "Not capturing ns/scope: " << double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / double(numScopes) << std::endl;
+
+    profiler.StartCapture();
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < numScopes; ++i) {
+        stratus::ProfileScope scope("Busy");
+        // Drain like the engine does once a frame so the ring never fills up
+        if (i % 10000 == 0) profiler.BeginFrame();
+    }
+    end = std::chrono::steady_clock::now();
+    profiler.StopCapture();
+    std::cout << "Capturing ns/scope: " << double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / double(numScopes) << std::endl;
+
+    REQUIRE(profiler.Stats().dropped == 0);
+    REQUIRE(profiler.Stats().events == numScopes);
+}
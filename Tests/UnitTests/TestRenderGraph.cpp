@@ -0,0 +1,197 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "StratusRenderGraph.h"
+
+static stratus::TextureConfig RenderGraphTestConfig(const uint32_t width, const uint32_t height) {
+    return stratus::TextureConfig{ stratus::TextureType::TEXTURE_2D, stratus::TextureComponentFormat::RGBA,
+        stratus::TextureComponentSize::BITS_16, stratus::TextureComponentType::FLOAT, width, height, 0, false };
+}
+
+static double ToMegabytes(const size_t bytes) {
+    return double(bytes) / (1024.0 * 1024.0);
+}
+
+TEST_CASE( "Stratus Render Graph Test", "[stratus_render_graph_test]" ) {
+    std::cout << "Beginning stratus::RenderGraph test" << std::endl;
+
+    const stratus::TextureConfig config = RenderGraphTestConfig(64, 64);
+    REQUIRE(stratus::RenderGraph::TextureBytes(config) == 64 * 64 * 8);
+    REQUIRE(stratus::RenderGraph::TextureBytes(RenderGraphTestConfig(1920, 1080)) == 1920 * 1080 * 8);
+
+    std::vector<std::string> executed;
+    const auto record = [&executed](const std::string& name) {
+        return [&executed, name]() { executed.push_back(name); };
+    };
+
+    // A -> B -> C -> D -> screen, with an unused branch off of A
+    stratus::RenderGraph graph;
+    const auto screen = graph.ImportTexture("Screen", config);
+    std::vector<stratus::RenderGraphTextureId> chain;
+    for (int i = 0; i < 4; ++i) {
+        chain.push_back(graph.CreateTexture("Chain" + std::to_string(i), config));
+    }
+    const auto unused = graph.CreateTexture("Unused", config);
+    const auto smaller = graph.CreateTexture("Smaller", RenderGraphTestConfig(32, 32));
+
+    const auto a = graph.AddPass("A", record("A"));
+    graph.Write(a, chain[0], stratus::RenderGraphAccess::IMAGE_STORE);
+    const auto branch = graph.AddPass("Branch", record("Branch"));
+    graph.Read(branch, chain[0]);
+    graph.Write(branch, unused);
+    const auto b = graph.AddPass("B", record("B"));
+    graph.Read(b, chain[0]);
+    graph.Write(b, chain[1]);
+    const auto c = graph.AddPass("C", record("C"));
+    graph.Read(c, chain[1], stratus::RenderGraphAccess::IMAGE_LOAD);
+    graph.Read(c, chain[0], stratus::RenderGraphAccess::IMAGE_LOAD);
+    graph.Write(c, chain[2]);
+    graph.Write(c, smaller);
+    const auto d = graph.AddPass("D", record("D"));
+    graph.Read(d, chain[2]);
+    graph.Read(d, chain[0]);
+    graph.Write(d, chain[3]);
+    const auto present = graph.AddPass("Present", record("Present"));
+    graph.Read(present, chain[3]);
+    graph.Write(present, screen);
+    // Nothing reads what it writes but it still has to run
+    const auto readback = graph.AddPass("Readback", record("Readback"));
+    graph.Read(readback, smaller, stratus::RenderGraphAccess::COPY_SOURCE);
+    graph.SetSideEffect(readback);
+
+    REQUIRE_FALSE(graph.IsCompiled());
+    REQUIRE_THROWS(graph.IsPassCulled(a));
+    graph.Compile();
+    REQUIRE(graph.IsCompiled());
+
+    REQUIRE(graph.IsPassCulled(branch));
+    for (const auto pass : { a, b, c, d, present, readback }) REQUIRE_FALSE(graph.IsPassCulled(pass));
+
+    // Sampling and then image loading what A stored need different barriers. Once both have been
+    // issued later reads need nothing.
+    REQUIRE(graph.GetPassBarriers(a) == 0);
+    REQUIRE(graph.GetPassBarriers(b) == stratus::RENDER_GRAPH_BARRIER_TEXTURE_FETCH);
+    REQUIRE(graph.GetPassBarriers(c) == stratus::RENDER_GRAPH_BARRIER_SHADER_IMAGE_ACCESS);
+    REQUIRE(graph.GetPassBarriers(d) == 0);
+    REQUIRE(graph.GetPassBarriers(present) == 0);
+
+    // Chain1 is dead once C finishes so Chain3 can take its place. Chain0 and Chain2 overlap with
+    // everything and Smaller doesn't match anything.
+    REQUIRE(graph.GetPhysicalTexture(screen) == stratus::RENDER_GRAPH_INVALID_ID);
+    REQUIRE(graph.GetPhysicalTexture(unused) == stratus::RENDER_GRAPH_INVALID_ID);
+    REQUIRE(graph.GetPhysicalTexture(chain[3]) == graph.GetPhysicalTexture(chain[1]));
+    REQUIRE(graph.GetPhysicalTexture(chain[0]) != graph.GetPhysicalTexture(chain[1]));
+    REQUIRE(graph.GetPhysicalTexture(chain[2]) != graph.GetPhysicalTexture(chain[1]));
+    REQUIRE(graph.GetPhysicalTextures().size() == 4);
+
+    const stratus::RenderGraphStats& stats = graph.Stats();
+    REQUIRE(stats.passes == 7);
+    REQUIRE(stats.culledPasses == 1);
+    REQUIRE(stats.transientTextures == 6);
+    REQUIRE(stats.culledTextures == 1);
+    REQUIRE(stats.physicalTextures == 4);
+    REQUIRE(stats.declaredBytes == 5 * 64 * 64 * 8 + 32 * 32 * 8);
+    REQUIRE(stats.usedBytes == 4 * 64 * 64 * 8 + 32 * 32 * 8);
+    REQUIRE(stats.allocatedBytes == 3 * 64 * 64 * 8 + 32 * 32 * 8);
+    REQUIRE(stats.SavedBytes() == 2 * 64 * 64 * 8);
+
+    std::vector<stratus::Bitfield> barriers;
+    graph.Execute([&barriers](const stratus::Bitfield bits) { barriers.push_back(bits); });
+    REQUIRE(executed == std::vector<std::string>{ "A", "B", "C", "D", "Present", "Readback" });
+    REQUIRE(barriers == std::vector<stratus::Bitfield>{ stratus::RENDER_GRAPH_BARRIER_TEXTURE_FETCH, stratus::RENDER_GRAPH_BARRIER_SHADER_IMAGE_ACCESS });
+
+    // Changing the graph means compiling it again
+    graph.AddPass("Late");
+    REQUIRE_FALSE(graph.IsCompiled());
+
+    // Reading something before it has been written is an error
+    stratus::RenderGraph invalid;
+    const auto texture = invalid.CreateTexture("Texture", config);
+    const auto reader = invalid.AddPass("Reader");
+    invalid.Read(reader, texture);
+    const auto writer = invalid.AddPass("Writer");
+    invalid.Write(writer, texture);
+    REQUIRE_THROWS(invalid.Compile());
+    REQUIRE_THROWS(invalid.Read(reader, 100));
+}
+
+TEST_CASE( "Stratus Post Fx Render Graph Test", "[stratus_post_fx_render_graph_test]" ) {
+    std::cout << "Beginning stratus::RenderGraph post fx test" << std::endl;
+
+    struct Resolution {
+        const char * name;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    struct Effects {
+        const char * name;
+        bool taa, bloom, atmospheric, fxaa;
+    };
+
+    const Resolution resolutions[] = { { "1080p", 1920, 1080 }, { "4K", 3840, 2160 } };
+    const Effects effects[] = {
+        { "all effects", true, true, true, true },
+        { "no bloom or fxaa", true, false, true, false },
+        { "tonemap only", false, false, false, false }
+    };
+
+    for (const Resolution& resolution : resolutions) {
+        for (const Effects& effect : effects) {
+            stratus::PostFxRenderGraphParams params;
+            params.viewportWidth = resolution.width;
+            params.viewportHeight = resolution.height;
+            params.taaEnabled = effect.taa;
+            params.bloomEnabled = effect.bloom;
+            params.atmosphericEnabled = effect.atmospheric;
+            params.fxaaEnabled = effect.fxaa;
+
+            stratus::RenderGraph graph;
+            const stratus::PostFxRenderGraph fx = stratus::BuildPostFxRenderGraph(graph, params);
+            graph.Compile();
+            const stratus::RenderGraphStats& stats = graph.Stats();
+
+            std::cout << resolution.name << " (" << effect.name << "): " << ToMegabytes(stats.declaredBytes) << " MB declared, "
+                      << ToMegabytes(stats.usedBytes) << " MB after culling, " << ToMegabytes(stats.allocatedBytes)
+                      << " MB after aliasing, " << ToMegabytes(stats.SavedBytes()) << " MB saved ("
+                      << stats.culledPasses << "/" << stats.passes << " passes culled, " << stats.physicalTextures
+                      << " textures for " << (stats.transientTextures - stats.culledTextures) << ")" << std::endl;
+
+            // 1920x1080 gives 7 bloom levels, 3840x2160 gives 8
+            const size_t levels = resolution.width == 1920 ? 7 : 8;
+            REQUIRE(fx.bloomDownsample.size() == levels);
+            REQUIRE(fx.bloomBlur.size() == 2 * levels);
+            REQUIRE(fx.bloomUpsample.size() == levels);
+            REQUIRE(graph.GetTextureConfig(fx.bloomUpsample.back().output).width == resolution.width);
+
+            REQUIRE(graph.IsPassCulled(fx.taa.pass) == !effect.taa);
+            REQUIRE(graph.IsPassCulled(fx.bloomDownsample[0].pass) == !effect.bloom);
+            REQUIRE(graph.IsPassCulled(fx.bloomUpsample.back().pass) == !effect.bloom);
+            REQUIRE(graph.IsPassCulled(fx.atmospheric.pass) == !effect.atmospheric);
+            REQUIRE(graph.IsPassCulled(fx.fxaaSmoothing.pass) == !effect.fxaa);
+            REQUIRE_FALSE(graph.IsPassCulled(fx.tonemap.pass));
+            REQUIRE_FALSE(graph.IsPassCulled(fx.present.pass));
+            // Everything renders through frame buffers so no barriers are needed
+            for (stratus::RenderGraphPassId pass = 0; pass < graph.NumPasses(); ++pass) {
+                if (!graph.IsPassCulled(pass)) REQUIRE(graph.GetPassBarriers(pass) == 0);
+            }
+
+            REQUIRE(stats.allocatedBytes <= stats.usedBytes);
+            REQUIRE(stats.usedBytes <= stats.declaredBytes);
+            if (effect.fxaa) {
+                // The second FXAA pass can write over the tonemapped image once the first has read it
+                REQUIRE(graph.GetPhysicalTexture(fx.fxaaSmoothing.output) == graph.GetPhysicalTexture(fx.tonemap.output));
+                REQUIRE(stats.allocatedBytes < stats.usedBytes);
+            }
+            if (effect.bloom && effect.taa && effect.atmospheric) {
+                // TAA's output is last read by the final bloom upsample
+                REQUIRE(graph.GetPhysicalTexture(fx.atmospheric.output) == graph.GetPhysicalTexture(fx.taa.output));
+            }
+            if (!effect.bloom) {
+                REQUIRE(graph.GetPhysicalTexture(fx.bloomDownsample[0].output) == stratus::RENDER_GRAPH_INVALID_ID);
+            }
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+
+#include "StratusShaderCache.h"
+
+TEST_CASE( "Stratus Shader Program Cache Test", "[stratus_shader_program_cache_test]" ) {
+    std::cout << "Beginning stratus::ShaderProgramCache test" << std::endl;
+
+    using stratus::ShaderProgramCache;
+
+    const std::vector<stratus::ShaderStageSource> stages = {
+        { 1, "#version 460 core\nvoid main() {}\n" },
+        { 2, "#version 460 core\nout vec4 color;\nvoid main() { color = vec4(1.0); }\n" }
+    };
+    const std::vector<std::pair<std::string, std::string>> defines = { { "SELECT_LOD", "1" } };
+    const std::string driver = "Test Renderer|4.6.0 Test 1.0";
+
+    // Anything that changes the program changes the key
+    const uint64_t key = ShaderProgramCache::ComputeKey(stages, defines, driver);
+    REQUIRE(key == ShaderProgramCache::ComputeKey(stages, defines, driver));
+
+    auto edited = stages;
+    edited[1].source += "\n";
+    REQUIRE(key != ShaderProgramCache::ComputeKey(edited, defines, driver));
+
+    auto retyped = stages;
+    retyped[0].type = 3;
+    REQUIRE(key != ShaderProgramCache::ComputeKey(retyped, defines, driver));
+
+    REQUIRE(key != ShaderProgramCache::ComputeKey(stages, {}, driver));
+    REQUIRE(key != ShaderProgramCache::ComputeKey(stages, { { "SELECT_LOD", "0" } }, driver));
+    REQUIRE(key != ShaderProgramCache::ComputeKey(stages, { { "SELECT_LO", "D1" } }, driver));
+    REQUIRE(key != ShaderProgramCache::ComputeKey(stages, defines, "Test Renderer|4.6.0 Test 1.1"));
+
+    const auto directory = std::filesystem::temp_directory_path() / "stratus_shader_cache_test";
+    std::filesystem::remove_all(directory);
+    ShaderProgramCache cache(directory.string());
+
+    stratus::ShaderProgramBinary binary;
+    REQUIRE_FALSE(cache.Load(key, binary));
+
+    binary.key = key;
+    binary.format = 0x8E21;
+    for (int i = 0; i < 1000; ++i) binary.data.push_back(uint8_t(i * 7));
+    REQUIRE(cache.Store(binary));
+
+    stratus::ShaderProgramBinary loaded;
+    REQUIRE(cache.Load(key, loaded));
+    REQUIRE(loaded.key == key);
+    REQUIRE(loaded.format == binary.format);
+    REQUIRE(loaded.data == binary.data);
+    REQUIRE_FALSE(cache.Load(key + 1, loaded));
+
+    // Truncated files are treated as misses and removed
+    std::filesystem::resize_file(cache.PathFor(key), std::filesystem::file_size(cache.PathFor(key)) - 1);
+    REQUIRE_FALSE(cache.Load(key, loaded));
+    REQUIRE_FALSE(std::filesystem::exists(cache.PathFor(key)));
+
+    // As are files whose size field is far larger than the file, without trying to allocate it
+    REQUIRE(cache.Store(binary));
+    {
+        std::fstream file(cache.PathFor(key), std::ios::in | std::ios::out | std::ios::binary);
+        const uint64_t size = uint64_t(1) << 62;
+        // magic, version, key, format come before the size
+        file.seekp(std::streamoff(sizeof(uint32_t) * 2 + sizeof(uint64_t) + sizeof(uint32_t)));
+        file.write((const char *)&size, sizeof(size));
+    }
+    REQUIRE_FALSE(cache.Load(key, loaded));
+    REQUIRE_FALSE(std::filesystem::exists(cache.PathFor(key)));
+
+    // So are files written under a different key
+    REQUIRE(cache.Store(binary));
+    std::filesystem::copy_file(cache.PathFor(key), cache.PathFor(key + 1));
+    REQUIRE_FALSE(cache.Load(key + 1, loaded));
+
+    // Entries the driver refuses are removed
+    cache.Reject(key);
+    REQUIRE_FALSE(std::filesystem::exists(cache.PathFor(key)));
+    REQUIRE_FALSE(cache.Load(key, loaded));
+
+    const auto stats = cache.Stats();
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.misses == 6);
+    REQUIRE(stats.rejected == 3);
+    REQUIRE(stats.stores == 3);
+
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "StratusShaderPermutation.h"
+
+TEST_CASE( "Stratus Shader Feature Set Test", "[stratus_shader_feature_set_test]" ) {
+    std::cout << "Beginning stratus::ShaderFeatureSet test" << std::endl;
+
+    using stratus::ShaderFeatureSet;
+    typedef std::vector<std::pair<std::string, std::string>> Defines;
+
+    // Same layout as the renderer's csm depth shader
+    const ShaderFeatureSet features({ { "DEPTH_LAYER", 6 }, { "RUN_CSM_ALPHA_TEST" } });
+    REQUIRE(features.Size() == 2);
+    REQUIRE(features.NumVariants() == 12);
+
+    // Key 0 is every feature at its first value
+    REQUIRE(features.Defines(0) == Defines{ { "DEPTH_LAYER", "0" } });
+
+    const stratus::ShaderVariantKey key = features.Set(features.Set(0, 0, 5), 1, 1);
+    REQUIRE(features.Get(key, 0) == 5);
+    REQUIRE(features.Get(key, 1) == 1);
+    REQUIRE(features.IsValid(key));
+    REQUIRE(features.Defines(key) == Defines{ { "DEPTH_LAYER", "5" }, { "RUN_CSM_ALPHA_TEST", "1" } });
+
+    // Setting a feature leaves the others alone
+    const stratus::ShaderVariantKey changed = features.Set(key, 0, 2);
+    REQUIRE(features.Get(changed, 0) == 2);
+    REQUIRE(features.Get(changed, 1) == 1);
+    REQUIRE(features.Set(changed, 1, 0) != changed);
+
+    // Every combination gets its own key
+    std::unordered_set<stratus::ShaderVariantKey> keys;
+    for (uint32_t layer = 0; layer < 6; ++layer) {
+        for (uint32_t alphaTest = 0; alphaTest < 2; ++alphaTest) {
+            keys.insert(features.Set(features.Set(0, 0, layer), 1, alphaTest));
+        }
+    }
+    REQUIRE(keys.size() == features.NumVariants());
+    for (const auto k : keys) REQUIRE(features.IsValid(k));
+
+    // DEPTH_LAYER takes 3 bits so 6 and 7 are not variants, nor is anything past the last feature
+    REQUIRE_FALSE(features.IsValid(6));
+    REQUIRE_FALSE(features.IsValid(uint64_t(1) << 4));
+    REQUIRE_THROWS_AS(features.Set(0, 0, 6), std::runtime_error);
+    REQUIRE_THROWS_AS(features.Set(0, 2, 0), std::runtime_error);
+
+    REQUIRE_THROWS_AS(ShaderFeatureSet({ { "ONE_VALUE", 1 } }), std::runtime_error);
+    std::vector<stratus::ShaderFeature> tooMany(65, stratus::ShaderFeature{ "BIT" });
+    REQUIRE_THROWS_AS(ShaderFeatureSet(tooMany), std::runtime_error);
+
+    // No features means a single variant
+    const ShaderFeatureSet none;
+    REQUIRE(none.NumVariants() == 1);
+    REQUIRE(none.IsValid(0));
+    REQUIRE_FALSE(none.IsValid(1));
+    REQUIRE(none.Defines(0).size() == 0);
+}
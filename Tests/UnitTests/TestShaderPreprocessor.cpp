@@ -0,0 +1,175 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "StratusShaderPreprocessor.h"
+
+// Shader files held in memory, Set stands in for saving a file
+class MockShaderSourceFiles : public stratus::ShaderSourceFiles {
+public:
+    void Set(const std::string& file, const std::string& source) {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        files_[file] = source;
+        modified_[file] = ++clock_;
+    }
+
+    bool Read(const std::string& file, std::string& out) override {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        ++reads;
+        auto it = files_.find(file);
+        if (it == files_.end()) return false;
+        out = it->second;
+        return true;
+    }
+
+    int64_t LastModified(const std::string& file) override {
+        auto ul = std::unique_lock<std::mutex>(m_);
+        auto it = modified_.find(file);
+        return it == modified_.end() ? 0 : it->second;
+    }
+
+    size_t reads = 0;
+
+private:
+    std::mutex m_;
+    std::unordered_map<std::string, std::string> files_;
+    std::unordered_map<std::string, int64_t> modified_;
+    int64_t clock_ = 0;
+};
+
+static std::vector<std::string> FileNames(const stratus::PreprocessedShader& shader) {
+    std::vector<std::string> result;
+    for (const auto& file : shader.files) result.push_back(file.first);
+    return result;
+}
+
+TEST_CASE( "Stratus Shader Preprocessor Test", "[stratus_shader_preprocessor_test]" ) {
+    std::cout << "Beginning stratus::ShaderPreprocessor test" << std::endl;
+
+    auto files = std::make_shared<MockShaderSourceFiles>();
+    files->Set("common.glsl", "STRATUS_GLSL_VERSION\nfloat common;\n");
+    files->Set("math.glsl", "STRATUS_GLSL_VERSION\n#include \"common.glsl\"\nfloat math;\n");
+    files->Set("a.fs", "STRATUS_GLSL_VERSION\n#include \"math.glsl\"\n  #include \"common.glsl\"\n#include \"a.fs\"\nvoid main() {}\n");
+    files->Set("b.fs", "STRATUS_GLSL_VERSION\n#include \"common.glsl\"\nvoid main() {}");
+
+    stratus::ShaderPreprocessor preprocessor(files);
+    stratus::PreprocessedShader a;
+    std::string error;
+    REQUIRE(preprocessor.Preprocess("a.fs", "#version 460 core", { { "A", "1" }, { "B", "2" } }, a, error));
+
+    // Every file is expanded once, the version is kept only at the top followed by the defines
+    REQUIRE(a.source ==
+        "#version 460 core\n\n#define A 1\n#define B 2\n\n"
+        "\n"
+        "\n"
+        "float common;\n\n"
+        "float math;\n\n"
+        "  \n"
+        "\n"
+        "void main() {}\n");
+    REQUIRE(FileNames(a) == std::vector<std::string>{ "a.fs", "math.glsl", "common.glsl" });
+
+    // Parsed files are shared between shaders
+    stratus::PreprocessedShader b;
+    REQUIRE(preprocessor.Preprocess("b.fs", "#version 460 core", {}, b, error));
+    REQUIRE(b.source == "#version 460 core\n\n\n\nfloat common;\n\nvoid main() {}");
+    REQUIRE(preprocessor.Stats().fileReads == 4);
+    REQUIRE(preprocessor.Stats().cacheHits == 1);
+    REQUIRE(files->reads == 4);
+
+    // Nothing changed yet
+    REQUIRE(preprocessor.PollChanges().size() == 0);
+    REQUIRE_FALSE(preprocessor.IsStale(a.files));
+    REQUIRE_FALSE(preprocessor.IsStale(b.files));
+    REQUIRE(preprocessor.Dependents({ "common.glsl" }) == std::unordered_set<std::string>{ "common.glsl", "math.glsl", "a.fs", "b.fs" });
+
+    // Editing an include only affects the shaders which use it
+    files->Set("math.glsl", "STRATUS_GLSL_VERSION\n#include \"common.glsl\"\nfloat math2;\n");
+    REQUIRE(preprocessor.PollChanges() == std::vector<std::string>{ "math.glsl" });
+    REQUIRE(preprocessor.Version("math.glsl") == 2);
+    REQUIRE(preprocessor.IsStale(a.files));
+    REQUIRE_FALSE(preprocessor.IsStale(b.files));
+    REQUIRE(preprocessor.Dependents({ "math.glsl" }) == std::unordered_set<std::string>{ "math.glsl", "a.fs" });
+
+    REQUIRE(preprocessor.Preprocess("a.fs", "#version 460 core", {}, a, error));
+    REQUIRE(a.source.find("float math2;") != std::string::npos);
+    REQUIRE_FALSE(preprocessor.IsStale(a.files));
+    // Only the edited file was read again
+    REQUIRE(files->reads == 5);
+
+    // Missing includes are errors and are still reported so they can be picked up once they exist
+    files->Set("c.fs", "STRATUS_GLSL_VERSION\n#include \"missing.glsl\"\n");
+    stratus::PreprocessedShader c;
+    REQUIRE_FALSE(preprocessor.Preprocess("c.fs", "#version 460 core", {}, c, error));
+    REQUIRE(error.find("missing.glsl") != std::string::npos);
+    REQUIRE(FileNames(c) == std::vector<std::string>{ "c.fs", "missing.glsl" });
+
+    files->Set("missing.glsl", "float found;\n");
+    REQUIRE(preprocessor.PollChanges() == std::vector<std::string>{ "missing.glsl" });
+    REQUIRE(preprocessor.IsStale(c.files));
+    REQUIRE(preprocessor.Preprocess("c.fs", "#version 460 core", {}, c, error));
+    REQUIRE(c.source.find("float found;") != std::string::npos);
+}
+
+// Lots of shaders pulling in the same include tree, similar to the renderer's shader directory
+TEST_CASE( "Stratus Shader Preprocessor Reload Test", "[stratus_shader_preprocessor_reload_test]" ) {
+    std::cout << "Beginning stratus::ShaderPreprocessor reload test" << std::endl;
+
+    constexpr size_t numIncludes = 40;
+    constexpr size_t numShaders = 200;
+
+    auto files = std::make_shared<MockShaderSourceFiles>();
+    for (size_t i = 0; i < numIncludes; ++i) {
+        std::string source = "STRATUS_GLSL_VERSION\n";
+        // Each include pulls in the two before it
+        if (i > 0) source += "#include \"include" + std::to_string(i - 1) + ".glsl\"\n";
+        if (i > 1) source += "#include \"include" + std::to_string(i - 2) + ".glsl\"\n";
+        source += std::string(2000, ' ') + "\nfloat value" + std::to_string(i) + ";\n";
+        files->Set("include" + std::to_string(i) + ".glsl", source);
+    }
+    for (size_t i = 0; i < numShaders; ++i) {
+        // Half of the shaders only use the bottom of the tree
+        const size_t include = i % 2 == 0 ? numIncludes - 1 : 4;
+        files->Set("shader" + std::to_string(i) + ".cs",
+            "STRATUS_GLSL_VERSION\n#include \"include" + std::to_string(include) + ".glsl\"\nvoid main() {}\n");
+    }
+
+    stratus::ShaderPreprocessor preprocessor(files);
+    std::vector<stratus::PreprocessedShader> shaders(numShaders);
+    std::string error;
+
+    auto start = std::chrono::system_clock::now();
+    for (size_t i = 0; i < numShaders; ++i) {
+        REQUIRE(preprocessor.Preprocess("shader" + std::to_string(i) + ".cs", "#version 460 core", {}, shaders[i], error));
+    }
+    auto end = std::chrono::system_clock::now();
+    std::cout << "Initial preprocess Elapsed MS: " << double(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()) / 1000.0 << std::endl;
+
+    // Every file was read exactly once
+    REQUIRE(files->reads == numIncludes + numShaders);
+    REQUIRE(shaders[0].files.size() == numIncludes + 1);
+    REQUIRE(shaders[1].files.size() == 6);
+
+    // Editing a file near the top of the tree only touches the shaders which can reach it
+    files->Set("include10.glsl", "STRATUS_GLSL_VERSION\nfloat edited;\n");
+    start = std::chrono::system_clock::now();
+    REQUIRE(preprocessor.PollChanges() == std::vector<std::string>{ "include10.glsl" });
+    size_t reloaded = 0;
+    for (size_t i = 0; i < numShaders; ++i) {
+        if (!preprocessor.IsStale(shaders[i].files)) continue;
+        REQUIRE(preprocessor.Preprocess("shader" + std::to_string(i) + ".cs", "#version 460 core", {}, shaders[i], error));
+        ++reloaded;
+    }
+    end = std::chrono::system_clock::now();
+    std::cout << "Reloaded " << reloaded << " of " << numShaders << " shaders" << std::endl;
+    std::cout << "Reload Elapsed MS: " << double(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()) / 1000.0 << std::endl;
+
+    REQUIRE(reloaded == numShaders / 2);
+    REQUIRE(files->reads == numIncludes + numShaders + 1);
+    REQUIRE(shaders[0].source.find("float edited;") != std::string::npos);
+    REQUIRE(shaders[1].source.find("float edited;") == std::string::npos);
+}
@@ -0,0 +1,79 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <vector>
+
+#include "StratusShadowFaceCulling.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+static std::vector<glm::mat4> FaceViewProjections(const glm::vec3& position, const float farPlane) {
+    const glm::mat4 projection = glm::perspective<float>(glm::radians(90.0f), 1.0f, 0.1f, farPlane);
+    glm::mat4 views[stratus::PointShadowFaceMask::numFaces];
+    stratus::PointShadowFaceCulling::ComputeFaceViews(position, views);
+    std::vector<glm::mat4> viewProj;
+    for (const glm::mat4& view : views) viewProj.push_back(projection * view);
+    return viewProj;
+}
+
+static stratus::GpuAABB Box(const glm::vec3& center, const float halfSize) {
+    stratus::GpuAABB aabb;
+    aabb.vmin = glm::vec4(center - glm::vec3(halfSize), 1.0f);
+    aabb.vmax = glm::vec4(center + glm::vec3(halfSize), 1.0f);
+    return aabb;
+}
+
+TEST_CASE( "Stratus Point Shadow Face Culling Test", "[stratus_point_shadow_face_culling_test]" ) {
+    std::cout << "Beginning stratus::PointShadowFaceCulling test" << std::endl;
+
+    const glm::vec3 position(10.0f, 5.0f, -3.0f);
+    const float radius = 50.0f;
+    const auto viewProj = FaceViewProjections(position, radius);
+
+    // No casters at all
+    stratus::PointShadowFaceMask empty;
+    stratus::PointShadowFaceCulling::AccumulateCasters(position, radius, viewProj.data(), {}, empty);
+    REQUIRE(empty.Empty());
+    REQUIRE(empty.NumCasters() == 0);
+
+    // One small box along each axis only lands in that axis' face
+    const glm::vec3 directions[6] = {
+        glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0),
+        glm::vec3(0, 1, 0), glm::vec3(0, -1, 0),
+        glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+    };
+    for (size_t face = 0; face < 6; ++face) {
+        stratus::PointShadowFaceMask mask;
+        stratus::PointShadowFaceCulling::AccumulateCasters(
+            position, radius, viewProj.data(), { Box(position + directions[face] * 20.0f, 1.0f) }, mask);
+        REQUIRE(mask.mask == (1u << face));
+        REQUIRE(mask.casterCounts[face] == 1);
+        REQUIRE(mask.NumFacesWithCasters() == 1);
+    }
+
+    // Boxes beyond the light's radius are rejected
+    stratus::PointShadowFaceMask far;
+    stratus::PointShadowFaceCulling::AccumulateCasters(
+        position, radius, viewProj.data(), { Box(position + glm::vec3(100.0f, 0.0f, 0.0f), 1.0f) }, far);
+    REQUIRE(far.Empty());
+
+    // A floor under the light is only seen by the -Y face plus the 4 side faces
+    stratus::GpuAABB floor;
+    floor.vmin = glm::vec4(position.x - 40.0f, position.y - 2.0f, position.z - 40.0f, 1.0f);
+    floor.vmax = glm::vec4(position.x + 40.0f, position.y - 1.0f, position.z + 40.0f, 1.0f);
+    stratus::PointShadowFaceMask floorMask;
+    stratus::PointShadowFaceCulling::AccumulateCasters(position, radius, viewProj.data(), { floor }, floorMask);
+    REQUIRE_FALSE(floorMask.FaceHasCasters(2));
+    REQUIRE(floorMask.FaceHasCasters(3));
+    REQUIRE(floorMask.NumFacesWithCasters() == 5);
+
+    // A box surrounding the light touches every face
+    stratus::PointShadowFaceMask all;
+    stratus::PointShadowFaceCulling::AccumulateCasters(position, radius, viewProj.data(), { Box(position, 5.0f), Box(position, 2.0f) }, all);
+    REQUIRE(all.mask == 0x3F);
+    REQUIRE(all.NumCasters() == 12);
+
+    // Local space bounds are transformed into world space
+    const glm::mat4 transform = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, 0.0f, 0.0f)), glm::vec3(2.0f));
+    const stratus::GpuAABB world = stratus::PointShadowFaceCulling::TransformAabb(Box(glm::vec3(0.0f), 1.0f), transform);
+    REQUIRE(world.vmin.ToVec4() == glm::vec4(1.0f, -2.0f, -2.0f, 1.0f));
+    REQUIRE(world.vmax.ToVec4() == glm::vec4(5.0f, 2.0f, 2.0f, 1.0f));
+}
@@ -4,6 +4,8 @@
 #include <chrono>
 #include <vector>
 #include <unordered_map>
+#include <thread>
+#include <algorithm>
 
 #include "StratusStackAllocator.h"
 
@@ -101,4 +103,116 @@ TEST_CASE( "Stratus Stack Allocators Test", "[stratus_stack_allocators_test]" )
 
 		std::cout << allocator->Remaining() << std::endl;
 	}
-}
\ No newline at end of file
+}
+TEST_CASE( "Stratus Frame Arena Test", "[stratus_frame_arena_test]" ) {
+	std::cout << "Beginning stratus::FrameArena tests" << std::endl;
+
+	// A growable allocator chains on more memory instead of throwing
+	{
+		auto allocator = stratus::MakeUnsafe<stratus::StackAllocator>(64, true);
+		REQUIRE(allocator->CanGrow());
+		for (int i = 0; i < 100; ++i) {
+			int * value = (int *)allocator->Allocate(sizeof(int));
+			*value = i;
+		}
+		REQUIRE(allocator->Capacity() >= 100 * sizeof(int));
+
+		// Everything ends up in one block once it is reset
+		const size_t capacity = allocator->Capacity();
+		allocator->Deallocate();
+		REQUIRE(allocator->Capacity() == capacity);
+		REQUIRE(allocator->Remaining() == capacity);
+	}
+
+	static constexpr size_t numThreads = 4;
+	static constexpr size_t allocationsPerThread = 4096;
+	static constexpr size_t bytesPerAllocation = 48;
+	static constexpr size_t chunkBytes = 4096;
+
+	stratus::FrameArena arena(64 * 1024, chunkBytes);
+	REQUIRE(arena.Capacity() == 64 * 1024);
+
+	// Each thread writes its own id into everything it allocated so overlapping memory shows up
+	// as a mismatch
+	auto allocate = [&arena](const uint8_t id, std::vector<uint8_t *>& out) {
+		auto allocator = arena.ThreadAllocator();
+		for (size_t i = 0; i < allocationsPerThread; ++i) {
+			uint8_t * memory = (uint8_t *)allocator->Allocate(bytesPerAllocation);
+			std::fill(memory, memory + bytesPerAllocation, id);
+			out.push_back(memory);
+		}
+	};
+
+	auto runFrame = [&]() {
+		std::vector<std::vector<uint8_t *>> allocations(numThreads);
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < numThreads; ++i) {
+			threads.push_back(std::thread(allocate, uint8_t(i + 1), std::ref(allocations[i])));
+		}
+		for (auto& thread : threads) thread.join();
+
+		bool overlapped = false;
+		for (size_t i = 0; i < numThreads; ++i) {
+			for (const uint8_t * memory : allocations[i]) {
+				for (size_t b = 0; b < bytesPerAllocation; ++b) {
+					overlapped = overlapped || memory[b] != uint8_t(i + 1);
+				}
+			}
+		}
+		REQUIRE_FALSE(overlapped);
+		return arena.EndFrame();
+	};
+
+	REQUIRE(arena.ThreadAllocator() == arena.ThreadAllocator());
+
+	// The frame needs far more than 64 kb so most of it comes from overflow blocks, after which
+	// the arena grows to fit
+	const size_t demand = numThreads * allocationsPerThread * bytesPerAllocation;
+	stratus::FrameArenaStats stats = runFrame();
+	REQUIRE(stats.frame == 1);
+	REQUIRE(stats.capacity == 64 * 1024);
+	REQUIRE(stats.bytesUsed >= demand);
+	REQUIRE(stats.overflowBlocks > 0);
+	REQUIRE(stats.overflowBytes > 0);
+	REQUIRE(stats.activeSubArenas == numThreads);
+	REQUIRE(stats.highWaterMark == stats.bytesUsed);
+	REQUIRE(stats.nextCapacity >= stats.bytesUsed);
+	REQUIRE(arena.Capacity() == stats.nextCapacity);
+
+	stats = runFrame();
+	REQUIRE(stats.frame == 2);
+	REQUIRE(stats.overflowBlocks == 0);
+	REQUIRE(stats.overflowBytes == 0);
+	REQUIRE(arena.LastFrameStats().bytesUsed == stats.bytesUsed);
+
+	// Frames which use almost nothing shrink it back down once the high water mark is out of
+	// the window, but never below the minimum
+	arena.SetMinCapacity(32 * 1024);
+	for (size_t i = 0; i < stratus::FrameArena::HighWaterFrames; ++i) {
+		arena.Allocate(16);
+		stats = arena.EndFrame();
+	}
+	REQUIRE(stats.highWaterMark == 16);
+	REQUIRE(arena.Capacity() == 32 * 1024);
+
+	arena.SetMinCapacity(128 * 1024);
+	arena.EndFrame();
+	REQUIRE(arena.Capacity() == 128 * 1024);
+
+	// Without auto sizing overflow is handled but the block stays the same size
+	arena.SetAutoSize(false);
+	std::vector<uint8_t *> allocations;
+	allocate(1, allocations);
+	allocate(2, allocations);
+	stats = arena.EndFrame();
+	REQUIRE(stats.overflowBlocks > 0);
+	REQUIRE(arena.Capacity() == 128 * 1024);
+
+	// Sub-arenas outliving their arena can't allocate
+	auto orphan = stratus::MakeUnsafe<stratus::FrameArena>(1024);
+	auto allocator = orphan->ThreadAllocator();
+	allocator->Allocate(16);
+	orphan.Reset();
+	REQUIRE(allocator->Remaining() == 0);
+	REQUIRE_THROWS_AS(allocator->Allocate(16), std::bad_alloc);
+}
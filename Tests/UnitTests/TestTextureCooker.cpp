@@ -0,0 +1,141 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <filesystem>
+
+#include "StratusTextureCooker.h"
+
+static double MaxBlockError(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, const uint32_t numChannels) {
+    double maxError = 0.0;
+    for (size_t p = 0; p < 16; ++p) {
+        for (uint32_t c = 0; c < numChannels; ++c) {
+            maxError = std::max(maxError, std::fabs(double(a[p * 4 + c]) - double(b[p * 4 + c])));
+        }
+    }
+    return maxError;
+}
+
+static std::vector<uint8_t> GradientBlock() {
+    std::vector<uint8_t> block(64);
+    for (uint32_t p = 0; p < 16; ++p) {
+        block[p * 4 + 0] = uint8_t(16 * p);
+        block[p * 4 + 1] = uint8_t(255 - 12 * p);
+        block[p * 4 + 2] = uint8_t(64 + 4 * p);
+        block[p * 4 + 3] = uint8_t(255 - 8 * p);
+    }
+    return block;
+}
+
+TEST_CASE( "Stratus Texture Cooker Block Test", "[stratus_texture_cooker_block_test]" ) {
+    std::cout << "Beginning stratus::TextureCooker block test" << std::endl;
+
+    const auto block = GradientBlock();
+    std::vector<uint8_t> decoded(64, 0);
+    uint8_t encoded[16];
+
+    // Gradients lie on a line so the error is bounded by half the palette spacing
+    // (240 / 3 / 2 for BC1's 4 colors, 240 / 7 / 2 for BC4's 8 values)
+    stratus::TextureCooker::EncodeBC1(block.data(), encoded);
+    stratus::TextureCooker::DecodeBC1(encoded, decoded.data());
+    REQUIRE(MaxBlockError(block, decoded, 3) <= 44.0);
+
+    stratus::TextureCooker::EncodeBC4(block.data(), 0, encoded);
+    stratus::TextureCooker::DecodeBC4(encoded, 0, decoded.data());
+    REQUIRE(MaxBlockError(block, decoded, 1) <= 20.0);
+
+    stratus::TextureCooker::EncodeBC5(block.data(), encoded);
+    stratus::TextureCooker::DecodeBC5(encoded, decoded.data());
+    REQUIRE(MaxBlockError(block, decoded, 2) <= 20.0);
+
+    stratus::TextureCooker::EncodeBC7(block.data(), encoded);
+    REQUIRE((encoded[0] & 0x7F) == 0x40); // mode 6
+    stratus::TextureCooker::DecodeBC7(encoded, decoded.data());
+    REQUIRE(MaxBlockError(block, decoded, 4) <= 10.0);
+
+    // Solid colors are exact for BC4/BC5 and nearly exact for BC7
+    std::vector<uint8_t> solid(64);
+    for (uint32_t p = 0; p < 16; ++p) {
+        solid[p * 4 + 0] = 200;
+        solid[p * 4 + 1] = 17;
+        solid[p * 4 + 2] = 99;
+        solid[p * 4 + 3] = 255;
+    }
+    stratus::TextureCooker::EncodeBC5(solid.data(), encoded);
+    stratus::TextureCooker::DecodeBC5(encoded, decoded.data());
+    REQUIRE(MaxBlockError(solid, decoded, 2) == 0.0);
+    stratus::TextureCooker::EncodeBC7(solid.data(), encoded);
+    stratus::TextureCooker::DecodeBC7(encoded, decoded.data());
+    REQUIRE(MaxBlockError(solid, decoded, 4) <= 1.0);
+}
+
+TEST_CASE( "Stratus Texture Cooker Cook Test", "[stratus_texture_cooker_cook_test]" ) {
+    std::cout << "Beginning stratus::TextureCooker cook test" << std::endl;
+
+    using stratus::TextureCompression;
+    using stratus::TextureUsage;
+    REQUIRE(stratus::TextureCooker::SelectCompression(TextureUsage::ALBEDO, 3) == TextureCompression::BC7);
+    REQUIRE(stratus::TextureCooker::SelectCompression(TextureUsage::NORMAL_MAP, 3) == TextureCompression::BC5);
+    REQUIRE(stratus::TextureCooker::SelectCompression(TextureUsage::ROUGHNESS, 3) == TextureCompression::BC4);
+    REQUIRE(stratus::TextureCooker::SelectCompression(TextureUsage::METALLIC, 1) == TextureCompression::BC4);
+    REQUIRE(stratus::TextureCooker::SelectCompression(TextureUsage::GENERIC, 3) == TextureCompression::BC1);
+
+    // Non power of two with partial edge blocks
+    const uint32_t width = 37, height = 10, channels = 3;
+    std::vector<uint8_t> pixels(width * height * channels);
+    for (size_t i = 0; i < pixels.size(); ++i) pixels[i] = uint8_t((i * 7) & 0xFF);
+
+    const uint64_t hash = stratus::TextureCooker::HashBytes(pixels.data(), pixels.size());
+    REQUIRE(hash != stratus::TextureCooker::HashBytes(pixels.data(), pixels.size() - 1));
+    const uint64_t key = stratus::TextureCooker::ComputeKey(hash, TextureUsage::ALBEDO, true);
+    REQUIRE(key != stratus::TextureCooker::ComputeKey(hash, TextureUsage::ALBEDO, false));
+    REQUIRE(key != stratus::TextureCooker::ComputeKey(hash, TextureUsage::NORMAL_MAP, true));
+
+    auto cooked = stratus::TextureCooker::Cook(pixels.data(), width, height, channels, TextureUsage::ALBEDO, true, key);
+    REQUIRE(cooked != nullptr);
+    REQUIRE(cooked->compression == TextureCompression::BC7);
+    REQUIRE(cooked->Format() == stratus::TextureComponentFormat::SRGB_ALPHA);
+    // 37x10 -> 18x5 -> 9x2 -> 4x1 -> 2x1 -> 1x1
+    REQUIRE(cooked->mips.size() == 6);
+    REQUIRE(cooked->mips[0].data.size() == 10 * 3 * 16);
+    REQUIRE(cooked->mips.back().width == 1);
+    REQUIRE(cooked->mips.back().height == 1);
+    REQUIRE(cooked->mips.back().data.size() == 16);
+
+    // sRGB does not apply to the two channel formats
+    auto normals = stratus::TextureCooker::Cook(pixels.data(), width, height, channels, TextureUsage::NORMAL_MAP, true, key);
+    REQUIRE(normals->compression == TextureCompression::BC5);
+    REQUIRE_FALSE(normals->srgb);
+    REQUIRE(normals->Format() == stratus::TextureComponentFormat::RG);
+
+    // Round trip through the serialized form and the on-disk cache
+    std::vector<uint8_t> bytes;
+    stratus::TextureCooker::Serialize(*cooked, bytes);
+    auto loaded = stratus::TextureCooker::Deserialize(bytes.data(), bytes.size());
+    REQUIRE(loaded != nullptr);
+    REQUIRE(loaded->key == key);
+    REQUIRE(loaded->mips.size() == cooked->mips.size());
+    REQUIRE(loaded->mips[2].data == cooked->mips[2].data);
+    REQUIRE(stratus::TextureCooker::Deserialize(bytes.data(), bytes.size() - 1) == nullptr);
+
+    const auto directory = std::filesystem::temp_directory_path() / "stratus_texture_cooker_test";
+    std::filesystem::remove_all(directory);
+    stratus::TextureCookCache cache(directory.string());
+    REQUIRE(cache.Load(key) == nullptr);
+    REQUIRE(cache.Store(*cooked));
+    auto cached = cache.Load(key);
+    REQUIRE(cached != nullptr);
+    REQUIRE(cached->SizeBytes() == cooked->SizeBytes());
+    REQUIRE(cached->mips[0].data == cooked->mips[0].data);
+
+    // Single levels can be read on their own for streaming
+    stratus::CookedMip mip;
+    REQUIRE(cache.LoadMip(key, 3, mip));
+    REQUIRE(mip.width == cooked->mips[3].width);
+    REQUIRE(mip.data == cooked->mips[3].data);
+    REQUIRE(cache.LoadMip(key, 0, mip));
+    REQUIRE(mip.data == cooked->mips[0].data);
+    REQUIRE_FALSE(cache.LoadMip(key, uint32_t(cooked->mips.size()), mip));
+    REQUIRE_FALSE(cache.LoadMip(key + 1, 0, mip));
+    std::filesystem::remove_all(directory);
+}
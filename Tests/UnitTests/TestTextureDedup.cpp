@@ -0,0 +1,120 @@
+#include <catch2/catch_all.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "StratusTextureDedup.h"
+#include "StratusFilesystem.h"
+
+static void WriteFile(const std::string& filename, const std::vector<char>& bytes) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), std::streamsize(bytes.size()));
+}
+
+// Reads the files the same way the resource manager does and claims them in order
+static std::vector<stratus::TextureHandle> Load(
+    stratus::TextureDedupTable& table,
+    const std::vector<std::string>& files,
+    const stratus::TextureContentSettings& settings = stratus::TextureContentSettings()) {
+
+    std::vector<stratus::TextureHandle> owners;
+    for (const std::string& file : files) {
+        const std::vector<std::vector<char>> sources{ stratus::Filesystem::ReadBinary(file) };
+        REQUIRE(sources[0].size() > 0);
+        const stratus::u64 key = stratus::TextureDedupTable::ContentKey(stratus::TextureDedupTable::HashSources(sources), settings);
+        owners.push_back(table.Claim(key, stratus::TextureHandle::NextHandle(), sources[0].size()));
+    }
+    return owners;
+}
+
+TEST_CASE( "Stratus Texture Dedup Test", "[stratus_texture_dedup_test]" ) {
+    std::cout << "Beginning stratus::TextureDedupTable test" << std::endl;
+
+    std::vector<char> payload(4096);
+    for (size_t i = 0; i < payload.size(); ++i) payload[i] = char(i * 31 + 7);
+    std::vector<char> different = payload;
+    different[2048] ^= 1;
+
+    const std::string first = "stratus_texture_dedup_a.png";
+    const std::string second = "stratus_texture_dedup_b.png";
+    const std::string third = "stratus_texture_dedup_c.png";
+    WriteFile(first, payload);
+    WriteFile(second, payload);
+    WriteFile(third, different);
+
+    // The same bytes under two paths resolve to one handle
+    {
+        stratus::TextureDedupTable table;
+        stratus::TextureHandle a = stratus::TextureHandle::NextHandle();
+        stratus::TextureHandle b = stratus::TextureHandle::NextHandle();
+        const auto key = [](const std::string& file) {
+            return stratus::TextureDedupTable::ContentKey(
+                stratus::TextureDedupTable::HashSources({ stratus::Filesystem::ReadBinary(file) }),
+                stratus::TextureContentSettings());
+        };
+
+        REQUIRE(table.Claim(key(first), a, payload.size()) == a);
+        REQUIRE(table.Claim(key(second), b, payload.size()) == a);
+        REQUIRE(table.Resolve(a) == a);
+        REQUIRE(table.Resolve(b) == a);
+        REQUIRE_FALSE(table.IsAlias(a));
+        REQUIRE(table.IsAlias(b));
+        REQUIRE(table.Aliases().size() == 1);
+
+        // Claiming again with the owner is not a duplicate
+        REQUIRE(table.Claim(key(first), a, payload.size()) == a);
+
+        stratus::TextureDedupStats stats = table.Stats();
+        REQUIRE(stats.uniqueTextures == 1);
+        REQUIRE(stats.duplicateTextures == 1);
+        REQUIRE(stats.sourceBytesSaved == payload.size());
+        // Nothing decoded yet
+        REQUIRE(stats.decodedBytesSaved == 0);
+
+        table.SetDecodedBytes(a, 1024 * 1024);
+        REQUIRE(table.Stats().decodedBytesSaved == 1024 * 1024);
+
+        table.Clear();
+        REQUIRE(table.Resolve(b) == b);
+        REQUIRE(table.Stats().uniqueTextures == 0);
+    }
+
+    // Different payloads stay distinct
+    {
+        stratus::TextureDedupTable table;
+        const auto owners = Load(table, { first, third });
+        REQUIRE(owners[0] != owners[1]);
+        REQUIRE(table.Aliases().size() == 0);
+        REQUIRE(table.Stats().uniqueTextures == 2);
+        REQUIRE(table.Stats().duplicateTextures == 0);
+    }
+
+    // So do identical payloads loaded with different settings
+    {
+        stratus::TextureDedupTable table;
+        stratus::TextureContentSettings srgb;
+        srgb.srgb = true;
+        stratus::TextureContentSettings clamped;
+        clamped.wrap = stratus::TextureCoordinateWrapping::CLAMP_TO_EDGE;
+
+        const auto linear = Load(table, { first });
+        REQUIRE(Load(table, { second }, srgb)[0] != linear[0]);
+        REQUIRE(Load(table, { second }, clamped)[0] != linear[0]);
+        REQUIRE(Load(table, { second })[0] == linear[0]);
+        REQUIRE(table.Stats().uniqueTextures == 3);
+        REQUIRE(table.Stats().duplicateTextures == 1);
+    }
+
+    // Cube maps hash their faces in order
+    {
+        const std::vector<std::vector<char>> faces{ payload, different };
+        const std::vector<std::vector<char>> swapped{ different, payload };
+        REQUIRE(stratus::TextureDedupTable::HashSources(faces) != stratus::TextureDedupTable::HashSources(swapped));
+    }
+
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+    std::remove(third.c_str());
+}
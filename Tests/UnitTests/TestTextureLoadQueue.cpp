@@ -0,0 +1,111 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <vector>
+
+#include "StratusTextureLoadQueue.h"
+
+static constexpr size_t MB = 1024 * 1024;
+
+static uint32_t Count(const stratus::TextureLoadQueue& queue, const stratus::TextureLoadStage stage) {
+    return queue.Stats().stageCounts[size_t(stage)];
+}
+
+TEST_CASE( "Stratus Texture Load Queue Test", "[stratus_texture_load_queue_test]" ) {
+    std::cout << "Beginning stratus::TextureLoadQueue test" << std::endl;
+
+    using stratus::TextureLoadStage;
+
+    stratus::TextureLoadQueue queue(64 * MB);
+    std::vector<stratus::TextureHandle> handles;
+    for (int i = 0; i < 8; ++i) {
+        handles.push_back(stratus::TextureHandle::NextHandle());
+        queue.Push(handles.back(), 4 * MB);
+    }
+    REQUIRE(queue.Size() == 8);
+    REQUIRE(Count(queue, TextureLoadStage::QUEUED) == 8);
+
+    // Visible goes first, then priority, then push order
+    queue.Prioritize(handles[5], false, 100.0f);
+    queue.Prioritize(handles[6], true, 1.0f);
+    queue.Prioritize(handles[7], true, 50.0f);
+
+    // Reads get a quarter of the budget (16 MB = 4 textures)
+    auto reads = queue.AdmitReads();
+    REQUIRE(reads.size() == 4);
+    REQUIRE(reads[0] == handles[7]);
+    REQUIRE(reads[1] == handles[6]);
+    REQUIRE(reads[2] == handles[5]);
+    REQUIRE(reads[3] == handles[0]);
+    REQUIRE(queue.Stats().bytesInFlight == 16 * MB);
+    REQUIRE(Count(queue, TextureLoadStage::READING) == 4);
+    REQUIRE(queue.AdmitReads().size() == 0);
+
+    // Each decode needs 20 MB on top of the source
+    for (auto handle : reads) queue.FinishRead(handle, 4 * MB, 20 * MB);
+    REQUIRE(Count(queue, TextureLoadStage::READ) == 4);
+
+    // 16 MB of sources + 2 decodes = 56 MB, a third would be 76 MB
+    auto decodes = queue.AdmitDecodes();
+    REQUIRE(decodes.size() == 2);
+    REQUIRE(decodes[0] == handles[7]);
+    REQUIRE(decodes[1] == handles[6]);
+    REQUIRE(queue.Stats().bytesInFlight == 56 * MB);
+    REQUIRE(queue.Stage(handles[7]) == TextureLoadStage::DECODING);
+
+    // Source is freed once decoded, what is left is the upload data
+    queue.SetStage(handles[7], TextureLoadStage::GENERATING_MIPS, 24 * MB);
+    queue.SetStage(handles[7], TextureLoadStage::UPLOADING, 16 * MB);
+    REQUIRE(queue.Stats().bytesInFlight == 48 * MB);
+    REQUIRE(queue.AdmitDecodes().size() == 0);
+
+    queue.Finish(handles[7]);
+    REQUIRE_FALSE(queue.Contains(handles[7]));
+    REQUIRE(queue.Stats().completed == 1);
+    REQUIRE(queue.Stats().bytesInFlight == 32 * MB);
+    REQUIRE(queue.AdmitDecodes().size() == 1);
+
+    // Never goes over budget while more than one texture is in flight
+    REQUIRE(queue.Stats().peakBytesInFlight <= queue.Budget());
+
+    // Everything drains
+    for (auto handle : handles) queue.Finish(handle);
+    REQUIRE(queue.Size() == 0);
+    REQUIRE(queue.Stats().bytesInFlight == 0);
+    for (int stage = 0; stage < int(TextureLoadStage::NUM_STAGES); ++stage) {
+        REQUIRE(queue.Stats().stageCounts[stage] == 0);
+    }
+}
+
+TEST_CASE( "Stratus Texture Load Queue Oversized Test", "[stratus_texture_load_queue_oversized_test]" ) {
+    std::cout << "Beginning stratus::TextureLoadQueue oversized test" << std::endl;
+
+    using stratus::TextureLoadStage;
+
+    stratus::TextureLoadQueue queue(8 * MB);
+    auto large = stratus::TextureHandle::NextHandle();
+    auto small = stratus::TextureHandle::NextHandle();
+    queue.Push(large, 16 * MB);
+    queue.Push(small, 1 * MB);
+
+    // Larger than the budget but nothing else is in flight so it goes anyway. The smaller one
+    // behind it does not get to skip ahead.
+    auto reads = queue.AdmitReads();
+    REQUIRE(reads.size() == 1);
+    REQUIRE(reads[0] == large);
+
+    queue.FinishRead(large, 16 * MB, 64 * MB);
+    REQUIRE(queue.AdmitReads().size() == 0);
+    auto decodes = queue.AdmitDecodes();
+    REQUIRE(decodes.size() == 1);
+    REQUIRE(queue.Stats().bytesInFlight == 80 * MB);
+
+    queue.Finish(large);
+    REQUIRE(queue.AdmitReads().size() == 1);
+    REQUIRE(queue.Stage(small) == TextureLoadStage::READING);
+
+    // Failures can finish from any stage
+    queue.Finish(small);
+    REQUIRE(queue.Size() == 0);
+    REQUIRE(queue.Stats().completed == 2);
+    REQUIRE(queue.Stats().peakBytesInFlight == 80 * MB);
+}
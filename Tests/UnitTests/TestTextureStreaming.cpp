@@ -0,0 +1,135 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <vector>
+
+#include "StratusTextureStreaming.h"
+
+static stratus::TexturePageLayout Layout(const uint32_t size) {
+    stratus::TexturePageLayout layout;
+    layout.width = size;
+    layout.height = size;
+    layout.numMips = 1;
+    for (uint32_t s = size; s > 1; s /= 2) ++layout.numMips;
+    layout.pageWidth = 128;
+    layout.pageHeight = 128;
+    layout.pageBytes = 65536;
+    return layout;
+}
+
+static bool IsCommit(const stratus::TextureStreamingAction& action, const stratus::TextureHandle handle, const uint32_t mip) {
+    return action.handle == handle && action.mip == mip && action.commit;
+}
+
+TEST_CASE( "Stratus Texture Page Layout Test", "[stratus_texture_page_layout_test]" ) {
+    std::cout << "Beginning stratus::TexturePageLayout test" << std::endl;
+
+    // 1024 -> 512 -> 256 -> 128 are sparse, 64 and below are the tail
+    const auto layout = Layout(1024);
+    REQUIRE(layout.numMips == 11);
+    REQUIRE(layout.FirstTailMip() == 4);
+    REQUIRE(layout.PagesInMip(0) == 64);
+    REQUIRE(layout.PagesInMip(3) == 1);
+    REQUIRE(layout.TailBytes() == 65536);
+    REQUIRE(layout.BytesFrom(layout.FirstTailMip()) == layout.TailBytes());
+    REQUIRE(layout.BytesFrom(2) == (4 + 1 + 1) * 65536);
+
+    // The driver reported sparse level count takes priority
+    auto driver = layout;
+    driver.numSparseLevels = 2;
+    REQUIRE(driver.FirstTailMip() == 2);
+
+    // Required mip and screen size estimates
+    REQUIRE(stratus::TextureStreamer::RequiredMip(1024, 1024, 11, 2048.0f) == 0);
+    REQUIRE(stratus::TextureStreamer::RequiredMip(1024, 1024, 11, 256.0f) == 2);
+    REQUIRE(stratus::TextureStreamer::RequiredMip(1024, 1024, 11, 0.5f) == 10);
+    REQUIRE(stratus::TextureStreamer::RequiredMip(1024, 1024, 11, 0.0f) == 10);
+
+    const float projectionScale = 1080.0f / 2.0f;
+    const float near = stratus::TextureStreamer::EstimateScreenSize(glm::vec3(-1.0f), glm::vec3(1.0f), glm::vec3(0.0f, 0.0f, 10.0f), projectionScale);
+    const float far = stratus::TextureStreamer::EstimateScreenSize(glm::vec3(-1.0f), glm::vec3(1.0f), glm::vec3(0.0f, 0.0f, 100.0f), projectionScale);
+    REQUIRE(near > far);
+    REQUIRE(far > 0.0f);
+    // Camera inside the bounds needs full resolution
+    const float inside = stratus::TextureStreamer::EstimateScreenSize(glm::vec3(-1.0f), glm::vec3(1.0f), glm::vec3(0.0f), projectionScale);
+    REQUIRE(stratus::TextureStreamer::RequiredMip(1024, 1024, 11, inside) == 0);
+}
+
+TEST_CASE( "Stratus Texture Streamer Test", "[stratus_texture_streamer_test]" ) {
+    std::cout << "Beginning stratus::TextureStreamer test" << std::endl;
+
+    const auto layout = Layout(1024);
+    const size_t pageBytes = layout.pageBytes;
+
+    stratus::TextureStreamer streamer(1024 * pageBytes, 16);
+    const auto a = stratus::TextureHandle::NextHandle();
+    const auto b = stratus::TextureHandle::NextHandle();
+    streamer.Register(a, layout);
+    streamer.Register(b, layout);
+    REQUIRE(streamer.ResidentMip(a) == 4);
+    REQUIRE(streamer.Stats().residentBytes == 2 * pageBytes);
+
+    // Nothing requested means nothing to do
+    REQUIRE(streamer.Update().size() == 0);
+
+    // Coarsest first across both textures
+    streamer.RequestMip(a, 0);
+    streamer.RequestMip(b, 5);
+    streamer.RequestMip(b, 2);
+    auto actions = streamer.Update();
+    REQUIRE(actions.size() == 6);
+    REQUIRE(IsCommit(actions[0], a, 3));
+    REQUIRE(IsCommit(actions[1], b, 3));
+    REQUIRE(IsCommit(actions[2], a, 2));
+    REQUIRE(IsCommit(actions[3], b, 2));
+    REQUIRE(IsCommit(actions[4], a, 1));
+    REQUIRE(IsCommit(actions[5], a, 0));
+    REQUIRE(streamer.ResidentMip(a) == 0);
+    REQUIRE(streamer.ResidentMip(b) == 2);
+    REQUIRE(streamer.Stats().residentBytes == layout.BytesFrom(0) + layout.BytesFrom(2));
+
+    // Unrequested levels stay cached while there is room
+    REQUIRE(streamer.Update().size() == 0);
+    REQUIRE(streamer.ResidentMip(a) == 0);
+
+    // Per update commit limit
+    const auto c = stratus::TextureHandle::NextHandle();
+    streamer.Register(c, layout);
+    streamer.SetMaxCommitsPerUpdate(2);
+    streamer.RequestMip(c, 0);
+    actions = streamer.Update();
+    REQUIRE(actions.size() == 2);
+    REQUIRE(streamer.ResidentMip(c) == 2);
+    REQUIRE(streamer.Stats().deferred == 1);
+    streamer.SetMaxCommitsPerUpdate(16);
+
+    // Shrinking the budget evicts the least recently requested texture first, finest level first
+    streamer.SetBudget(layout.BytesFrom(0) + 3 * pageBytes);
+    streamer.RequestMip(c, 0);
+    actions = streamer.Update();
+    REQUIRE(actions.size() >= 2);
+    REQUIRE(actions[0].commit == false);
+    REQUIRE(actions[0].handle == a);
+    REQUIRE(actions[0].mip == 0);
+    REQUIRE(streamer.ResidentMip(c) == 0);
+    REQUIRE(streamer.Stats().residentBytes <= streamer.Budget());
+
+    // Requested levels are never evicted to make room for other requests
+    const auto d = stratus::TextureHandle::NextHandle();
+    streamer.Register(d, layout);
+    streamer.RequestMip(c, 0);
+    streamer.RequestMip(d, 0);
+    actions = streamer.Update();
+    for (const auto& action : actions) {
+        REQUIRE_FALSE((action.handle == c && !action.commit));
+    }
+    REQUIRE(streamer.ResidentMip(c) == 0);
+    REQUIRE(streamer.ResidentMip(d) > 0);
+    REQUIRE(streamer.Stats().deferred == 1);
+    REQUIRE(streamer.Stats().residentBytes <= streamer.Budget());
+
+    // Unregistering releases everything the texture held
+    const size_t before = streamer.Stats().residentBytes;
+    streamer.Unregister(c);
+    REQUIRE_FALSE(streamer.IsRegistered(c));
+    REQUIRE(streamer.Stats().residentBytes == before - layout.BytesFrom(0));
+}
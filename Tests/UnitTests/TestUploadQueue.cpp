@@ -0,0 +1,221 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "StratusUploadQueue.h"
+
+// Stands in for the persistently mapped buffer + fences
+class MockUploadTarget : public stratus::UploadTarget {
+public:
+    MockUploadTarget(const size_t sizeBytes) : memory(sizeBytes, 0) {}
+
+    uint8_t * MappedMemory() override { return memory.data(); }
+    size_t SizeBytes() const override { return memory.size(); }
+    void InsertFence(const uint64_t frame) override { fences.push_back(frame); }
+    uint64_t CompletedFrame() override {
+        if (completeImmediately && fences.size() > 0) return fences.back();
+        return completedFrame;
+    }
+
+    std::vector<uint8_t> memory;
+    std::vector<uint64_t> fences;
+    uint64_t completedFrame = 0;
+    bool completeImmediately = false;
+};
+
+static stratus::UploadWriteFunction Fill(const uint8_t value, const size_t sizeBytes) {
+    return [value, sizeBytes](uint8_t * memory) { std::memset(memory, value, sizeBytes); };
+}
+
+TEST_CASE( "Stratus Upload Queue Budget Test", "[stratus_upload_queue_budget_test]" ) {
+    std::cout << "Beginning stratus::UploadQueue budget test" << std::endl;
+
+    auto target = std::make_shared<MockUploadTarget>(4096);
+    double now = 0.0;
+    stratus::UploadQueue queue(target, 1000, 100.0, [&now]() { return now; });
+
+    // Copies see what the worker wrote at the offset they were given
+    std::vector<stratus::UploadSource> issued;
+    bool contentsMatch = true;
+    const auto copy = [&](const uint8_t value) {
+        return [&, value](const stratus::UploadSource& source) {
+            issued.push_back(source);
+            for (size_t i = 0; i < source.sizeBytes; ++i) {
+                if (target->memory[source.offset + i] != value) contentsMatch = false;
+            }
+        };
+    };
+
+    REQUIRE(queue.Stage(400, Fill(1, 400), copy(1)));
+    REQUIRE(queue.Stage(400, Fill(2, 400), copy(2)));
+    REQUIRE(queue.Stage(400, Fill(3, 400), copy(3)));
+    REQUIRE(queue.Stats().pendingCopies == 3);
+    REQUIRE(queue.Stats().pendingBytes == 1200);
+
+    // Byte budget allows two per frame
+    queue.ProcessFrame();
+    REQUIRE(issued.size() == 2);
+    REQUIRE(issued[0].staged);
+    REQUIRE(issued[0].offset == 0);
+    REQUIRE(issued[1].offset == 400);
+    REQUIRE(issued[0].offset % stratus::UploadQueue::STAGING_ALIGNMENT == 0);
+    REQUIRE(target->fences == std::vector<uint64_t>{ 1 });
+    REQUIRE(queue.Stats().copiesLastFrame == 2);
+    REQUIRE(queue.Stats().bytesLastFrame == 800);
+
+    queue.ProcessFrame();
+    REQUIRE(issued.size() == 3);
+    REQUIRE(target->fences == std::vector<uint64_t>{ 1, 2 });
+    REQUIRE(contentsMatch);
+    REQUIRE(queue.Empty());
+
+    // Nothing to issue means no fence
+    queue.ProcessFrame();
+    REQUIRE(target->fences.size() == 2);
+
+    // A single upload larger than the byte budget still goes through on its own
+    REQUIRE(queue.Stage(1500, Fill(4, 1500), copy(4)));
+    REQUIRE(queue.Stage(16, Fill(5, 16), copy(5)));
+    queue.ProcessFrame();
+    REQUIRE(issued.size() == 4);
+    REQUIRE(issued[3].sizeBytes == 1500);
+    queue.ProcessFrame();
+    REQUIRE(issued.size() == 5);
+
+    // Time budget - every copy takes 1 ms of a 2.5 ms budget
+    queue.SetBudget(1024 * 1024, 2.5);
+    const auto slowCopy = [&](const stratus::UploadSource& source) { issued.push_back(source); now += 1.0; };
+    for (int i = 0; i < 5; ++i) queue.Queue(64, slowCopy);
+    issued.clear();
+    queue.ProcessFrame();
+    REQUIRE(issued.size() == 3);
+    REQUIRE_FALSE(issued[0].staged);
+    REQUIRE(queue.Stats().msLastFrame == 3.0);
+    queue.Flush();
+    REQUIRE(issued.size() == 5);
+    REQUIRE(queue.Stats().unstagedCopies == 5);
+    REQUIRE(queue.Stats().stagedCopies == 5);
+    REQUIRE(contentsMatch);
+}
+
+TEST_CASE( "Stratus Upload Queue Staging Ring Test", "[stratus_upload_queue_staging_ring_test]" ) {
+    std::cout << "Beginning stratus::UploadQueue staging ring test" << std::endl;
+
+    auto target = std::make_shared<MockUploadTarget>(1024);
+    stratus::UploadQueue queue(target, 1024 * 1024, 100.0);
+
+    std::vector<stratus::UploadSource> issued;
+    const auto copy = [&issued](const stratus::UploadSource& source) { issued.push_back(source); };
+
+    REQUIRE(queue.Stage(512, Fill(1, 512), copy));
+    REQUIRE(queue.Stage(250, Fill(2, 250), copy));
+    REQUIRE(queue.Stats().stagingBytesInUse == 512 + 256);
+
+    // Does not fit, goes unstaged and skips the write
+    bool written = false;
+    REQUIRE_FALSE(queue.Stage(512, [&written](uint8_t *) { written = true; }, copy));
+    REQUIRE_FALSE(written);
+    // Never fits
+    REQUIRE_FALSE(queue.Stage(2048, Fill(3, 2048), copy));
+
+    queue.ProcessFrame();
+    REQUIRE(issued.size() == 4);
+    REQUIRE(issued[0].staged);
+    REQUIRE(issued[1].offset == 512);
+    REQUIRE_FALSE(issued[2].staged);
+    REQUIRE(issued[2].sizeBytes == 512);
+
+    // Memory stays in use until the GPU is done with the frame
+    queue.ProcessFrame();
+    REQUIRE(queue.Stats().stagingBytesInUse == 768);
+    REQUIRE_FALSE(queue.Stage(512, Fill(4, 512), copy));
+    queue.ProcessFrame();
+    REQUIRE(target->fences == std::vector<uint64_t>{ 1, 2 });
+
+    target->completedFrame = 1;
+    queue.ProcessFrame();
+    REQUIRE(queue.Stats().stagingBytesInUse == 0);
+    REQUIRE(queue.Stats().peakStagingBytesInUse == 768);
+
+    // Wrap around: A [0, 512) and B [512, 768) are issued in different frames, only A retires
+    issued.clear();
+    REQUIRE(queue.Stage(512, Fill(5, 512), copy));
+    queue.ProcessFrame();
+    REQUIRE(queue.Stage(256, Fill(6, 256), copy));
+    queue.ProcessFrame();
+    REQUIRE(issued[0].offset == 0);
+    REQUIRE(issued[1].offset == 512);
+    target->completedFrame = target->fences[target->fences.size() - 2];
+    queue.ProcessFrame();
+    REQUIRE(queue.Stats().stagingBytesInUse == 256);
+
+    // No room after B so this goes to the start, then the gap up to B is all that is left
+    REQUIRE(queue.Stage(384, Fill(7, 384), copy));
+    REQUIRE_FALSE(queue.Stage(256, Fill(8, 256), copy));
+    REQUIRE(queue.Stage(128, Fill(9, 128), copy));
+    queue.ProcessFrame();
+    REQUIRE(issued[2].offset == 0);
+    REQUIRE_FALSE(issued[3].staged);
+    REQUIRE(issued[4].offset == 384);
+    REQUIRE(std::all_of(target->memory.begin() + 384, target->memory.begin() + 512, [](uint8_t v) { return v == 9; }));
+    REQUIRE(std::all_of(target->memory.begin() + 512, target->memory.begin() + 768, [](uint8_t v) { return v == 6; }));
+}
+
+TEST_CASE( "Stratus Upload Queue Threaded Test", "[stratus_upload_queue_threaded_test]" ) {
+    std::cout << "Beginning stratus::UploadQueue threaded test" << std::endl;
+
+    auto target = std::make_shared<MockUploadTarget>(64 * 1024);
+    target->completeImmediately = true;
+    stratus::UploadQueue queue(target, 16 * 1024, 100.0);
+
+    constexpr int numThreads = 8;
+    constexpr int uploadsPerThread = 200;
+    std::atomic<int> copied(0);
+    std::atomic<int> mismatched(0);
+    std::atomic<int> done(0);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < numThreads; ++t) {
+        workers.push_back(std::thread([&, t]() {
+            for (int i = 0; i < uploadsPerThread; ++i) {
+                const uint8_t value = uint8_t(t * uploadsPerThread + i);
+                const size_t size = 64 + size_t((i * 97 + t * 31) % 2048);
+                auto data = std::make_shared<std::vector<uint8_t>>(size, value);
+                queue.Stage(size,
+                    [data](uint8_t * memory) { std::memcpy(memory, data->data(), data->size()); },
+                    [&, data, value](const stratus::UploadSource& source) {
+                        // Unstaged copies read from their own memory
+                        const uint8_t * memory = source.staged ? target->memory.data() + source.offset : data->data();
+                        for (size_t b = 0; b < source.sizeBytes; ++b) {
+                            if (memory[b] != value) {
+                                ++mismatched;
+                                break;
+                            }
+                        }
+                        ++copied;
+                    });
+            }
+            ++done;
+        }));
+    }
+
+    // Application thread
+    while (done.load() < numThreads || !queue.Empty()) {
+        queue.ProcessFrame();
+        REQUIRE(queue.Stats().bytesLastFrame <= 16 * 1024);
+    }
+
+    for (auto& worker : workers) worker.join();
+    queue.Flush();
+
+    REQUIRE(copied.load() == numThreads * uploadsPerThread);
+    REQUIRE(mismatched.load() == 0);
+    const auto stats = queue.Stats();
+    REQUIRE(stats.stagedCopies + stats.unstagedCopies == numThreads * uploadsPerThread);
+    REQUIRE(stats.stagedCopies > 0);
+    REQUIRE(stats.peakStagingBytesInUse <= 64 * 1024);
+}
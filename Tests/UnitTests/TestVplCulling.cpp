@@ -0,0 +1,355 @@
+#include <catch2/catch_all.hpp>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+#include "StratusVplCulling.h"
+
+// Four cascades with an identity projection so that world [-1, 1] maps straight onto the
+// texture. Cascade 0 has an occluder at depth 0.25 over the left half, the rest are clear.
+static stratus::VplCascadeDepthSnapshot CreateSnapshot(const glm::vec4& firstCascadePlane) {
+    stratus::VplCascadeDepthSnapshot snapshot;
+    snapshot.resolution = 16;
+    snapshot.projectionViews = std::vector<glm::mat4>(4, glm::mat4(1.0f));
+    snapshot.cascadePlanes = { firstCascadePlane, glm::vec4(0.0f, 0.0f, 0.0f, -1.0f), glm::vec4(0.0f, 0.0f, 0.0f, -1.0f) };
+
+    const size_t texels = size_t(snapshot.resolution) * size_t(snapshot.resolution);
+    snapshot.depth = std::vector<float>(texels * 4, 1.0f);
+    for (uint32_t y = 0; y < snapshot.resolution; ++y) {
+        for (uint32_t x = 0; x < snapshot.resolution / 2; ++x) {
+            snapshot.depth[x + y * snapshot.resolution] = 0.25f;
+        }
+    }
+    return snapshot;
+}
+
+// Line for line version of calculateInfiniteShadowValue in pbr.glsl as viscull_vpls.cs calls it, with
+// texture() on the sampler2DArrayShadow written out the way the GL spec defines it for LINEAR filtering,
+// CLAMP_TO_EDGE and LEQUAL compare on a floating point depth texture
+static float ReferenceShadowTexture(const stratus::VplCascadeDepthSnapshot& snapshot, const glm::vec4& p) {
+    const int size = int(snapshot.resolution);
+    const int layer = int(p.z);
+    const float u = p.x * float(size) - 0.5f;
+    const float v = p.y * float(size) - 0.5f;
+    const int i0 = int(std::floor(u));
+    const int j0 = int(std::floor(v));
+    const float alpha = u - std::floor(u);
+    const float beta = v - std::floor(v);
+
+    const auto tau = [&](int i, int j) {
+        i = std::clamp(i, 0, size - 1);
+        j = std::clamp(j, 0, size - 1);
+        const float texel = snapshot.depth[size_t(layer) * size * size + size_t(j) * size + size_t(i)];
+        return p.w <= texel ? 1.0f : 0.0f;
+    };
+
+    return (1.0f - alpha) * (1.0f - beta) * tau(i0, j0) + alpha * (1.0f - beta) * tau(i0 + 1, j0) +
+        (1.0f - alpha) * beta * tau(i0, j0 + 1) + alpha * beta * tau(i0 + 1, j0 + 1);
+}
+
+static float ReferenceInfiniteShadowValue(const stratus::VplCascadeDepthSnapshot& snapshot, const glm::vec3& lightPos) {
+    const auto saturate = [](const float x) { return std::clamp(x, 0.0f, 1.0f); };
+    const glm::vec4 fragPos = glm::vec4(lightPos, 1.0f);
+    const glm::vec3 cascadeBlends = glm::vec3(glm::dot(snapshot.cascadePlanes[0], fragPos),
+                                              glm::dot(snapshot.cascadePlanes[1], fragPos),
+                                              glm::dot(snapshot.cascadePlanes[2], fragPos));
+    const glm::vec3 normal = snapshot.lightDirection;
+    const float bias = 0.0f;
+
+    glm::vec4 position = fragPos;
+    position = glm::vec4(glm::vec3(position) + normal * (1.0f - saturate(glm::dot(normal, normal))) * 1.0f, position.w);
+
+    glm::vec4 p1, p2;
+    glm::vec3 cascadeCoords[4];
+    for (int i = 0; i < 4; ++i) {
+        const glm::vec4 coords = snapshot.projectionViews[i] * position;
+        cascadeCoords[i] = glm::vec3(coords) / coords.w;
+        cascadeCoords[i] = cascadeCoords[i] * 0.5f + glm::vec3(0.5f);
+    }
+
+    const bool beyondCascade2 = cascadeBlends.y >= 0.0f;
+    const bool beyondCascade3 = cascadeBlends.z >= 0.0f;
+    const int index1 = beyondCascade2 ? 2 : 0;
+    const int index2 = beyondCascade3 ? 3 : 1;
+    p1.z = float(index1);
+    p2.z = float(index2);
+
+    const glm::vec2 shadowCoord1 = glm::vec2(cascadeCoords[index1]);
+    const glm::vec2 shadowCoord2 = glm::vec2(cascadeCoords[index2]);
+    const float depth1 = cascadeCoords[index1].z;
+    float depth2 = cascadeCoords[index2].z;
+    depth2 = beyondCascade3 ? saturate(depth2) : depth2;
+
+    const float weight = beyondCascade2 ? saturate(cascadeBlends.y) - saturate(cascadeBlends.z) : 1.0f - saturate(cascadeBlends.x);
+    const glm::vec2 wh = glm::vec2(1.0f) / glm::vec2(float(snapshot.resolution));
+
+    float light1 = 0.0f;
+    float light2 = 0.0f;
+    float samples = 0.0f;
+    p1.x = shadowCoord1.x; p1.y = shadowCoord1.y;
+    p2.x = shadowCoord2.x; p2.y = shadowCoord2.y;
+    const float bound = 1.0f;
+    for (float y = -bound; y <= bound; y += 1.0f) {
+        for (float x = -bound; x <= bound; x += 1.0f) {
+            const glm::vec2 offset = glm::vec2(x, y) * wh;
+            light1 += ReferenceShadowTexture(snapshot, glm::vec4(p1.x + offset.x, p1.y + offset.y, p1.z, depth1 - bias));
+            light2 += ReferenceShadowTexture(snapshot, glm::vec4(p2.x + offset.x, p2.y + offset.y, p2.z, depth2 - bias));
+            ++samples;
+        }
+    }
+
+    // mix(light2, light1, weight)
+    return (light2 * (1.0f - weight) + light1 * weight) * (1.0f / samples);
+}
+
+TEST_CASE( "Stratus Cpu Vpl Culling Shadow Test", "[stratus_cpu_vpl_culling_test]" ) {
+    std::cout << "Beginning stratus::CpuVplCulling::IsLit test" << std::endl;
+
+    REQUIRE_FALSE(stratus::VplCascadeDepthSnapshot().Valid());
+
+    // Negative first plane means fully inside cascade 0
+    const auto snapshot = CreateSnapshot(glm::vec4(0.0f, 0.0f, 0.0f, -1.0f));
+    REQUIRE(snapshot.Valid());
+
+    // Behind the occluder
+    REQUIRE_FALSE(stratus::CpuVplCulling::IsLit(snapshot, glm::vec3(-0.5f, 0.0f, 0.0f)));
+    // Not covered by the occluder
+    REQUIRE(stratus::CpuVplCulling::IsLit(snapshot, glm::vec3(0.5f, 0.0f, 0.0f)));
+    // In front of the occluder
+    REQUIRE(stratus::CpuVplCulling::IsLit(snapshot, glm::vec3(-0.5f, 0.0f, -0.8f)));
+    // Close enough to the edge of the occluder that one of the 3x3 samples passes
+    REQUIRE(stratus::CpuVplCulling::IsLit(snapshot, glm::vec3(-0.05f, 0.0f, 0.0f)));
+
+    // Positive first plane means fully blended into cascade 1 which has no occluder
+    const auto blended = CreateSnapshot(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    REQUIRE(stratus::CpuVplCulling::IsLit(blended, glm::vec3(-0.5f, 0.0f, 0.0f)));
+}
+
+TEST_CASE( "Stratus Cpu Vpl Culling Shader Match Test", "[stratus_cpu_vpl_culling_test]" ) {
+    std::cout << "Beginning stratus::CpuVplCulling::IsLit shader match test" << std::endl;
+
+    std::mt19937 rng(4321);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // Full resolution cascades of increasing size looking down -Y, filled with random heights so that
+    // every test position lands near a mix of passing and failing texels
+    stratus::VplCascadeDepthSnapshot snapshot;
+    snapshot.resolution = 128;
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 50.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    for (int cascade = 0; cascade < 4; ++cascade) {
+        const float extent = 8.0f * float(1 << cascade);
+        snapshot.projectionViews.push_back(glm::ortho(-extent, extent, -extent, extent, 1.0f, 100.0f) * view);
+    }
+    // Blend regions are distance along +X: cascade 1 from 6 to 8, 2 from 14 to 16, 3 from 30 to 32
+    snapshot.cascadePlanes = {
+        glm::vec4(0.5f, 0.0f, 0.0f, -3.0f),
+        glm::vec4(0.5f, 0.0f, 0.0f, -7.0f),
+        glm::vec4(0.5f, 0.0f, 0.0f, -15.0f)
+    };
+    // Not quite unit length so that the normal offset is not zero
+    snapshot.lightDirection = glm::vec3(0.0f, -0.9f, 0.1f);
+    snapshot.depth.resize(size_t(snapshot.resolution) * snapshot.resolution * 4);
+    for (float& depth : snapshot.depth) {
+        depth = 0.49f + 0.02f * unit(rng);
+    }
+    REQUIRE(snapshot.Valid());
+
+    std::uniform_real_distribution<float> x(-2.0f, 40.0f);
+    std::uniform_real_distribution<float> yz(-7.0f, 7.0f);
+    std::uniform_real_distribution<float> height(-5.0f, 5.0f);
+
+    size_t lit = 0;
+    size_t blended = 0;
+    for (int i = 0; i < 20000; ++i) {
+        const glm::vec3 position(x(rng), height(rng), yz(rng));
+        const float shadowFactor = 1.0f - ReferenceInfiniteShadowValue(snapshot, position);
+        const bool expected = shadowFactor < 1.0f;
+        REQUIRE(stratus::CpuVplCulling::IsLit(snapshot, position) == expected);
+
+        if (expected) ++lit;
+        const float d = position.x * 0.5f;
+        if ((d > 3.0f && d < 4.0f) || (d > 7.0f && d < 8.0f) || (d > 15.0f && d < 16.0f)) ++blended;
+    }
+
+    // Make sure both outcomes and the blend regions were actually exercised
+    REQUIRE(lit > 1000);
+    REQUIRE(lit < 19000);
+    REQUIRE(blended > 1000);
+}
+
+TEST_CASE( "Stratus Cpu Vpl Culling Importance Test", "[stratus_cpu_vpl_culling_test]" ) {
+    std::cout << "Beginning stratus::CpuVplCulling::ComputeVisibleLights test" << std::endl;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> radius(1.0f, 25.0f);
+    std::uniform_real_distribution<float> intensity(1.0f, 100.0f);
+
+    std::vector<stratus::GpuVplData> lights(1003);
+    for (auto& light : lights) {
+        light.position = glm::vec4(position(rng), position(rng), position(rng), 1.0f);
+        light.radius = radius(rng);
+        light.intensity = intensity(rng);
+    }
+
+    // Only lights above the ground plane are considered lit
+    const auto isLit = [](const glm::vec3& p) { return p.y >= 0.0f; };
+    const glm::vec3 viewer(3.0f, 1.0f, -2.0f);
+
+    std::vector<int> visible;
+    stratus::CpuVplCulling::ComputeVisibleLights(lights, viewer, isLit, lights.size(), visible);
+    REQUIRE(visible.size() > 0);
+    REQUIRE(std::is_sorted(visible.begin(), visible.end()));
+    for (int index : visible) {
+        REQUIRE(lights[index].position.v[1] >= 0.0f);
+    }
+
+    // When capped only the most important lit lights are kept
+    std::vector<int> reference = visible;
+    std::stable_sort(reference.begin(), reference.end(), [&lights, &viewer](const int a, const int b) {
+        return stratus::CpuVplCulling::Importance(lights[a], viewer) > stratus::CpuVplCulling::Importance(lights[b], viewer);
+    });
+    reference.resize(10);
+    std::sort(reference.begin(), reference.end());
+
+    std::vector<int> capped;
+    stratus::CpuVplCulling::ComputeVisibleLights(lights, viewer, isLit, 10, capped);
+    REQUIRE(capped == reference);
+
+    // A bright light further away beats a dim one close by
+    std::vector<stratus::GpuVplData> pair(2);
+    pair[0].position = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+    pair[0].radius = 10.0f;
+    pair[0].intensity = 1.0f;
+    pair[1].position = glm::vec4(5.0f, 0.0f, 0.0f, 1.0f);
+    pair[1].radius = 10.0f;
+    pair[1].intensity = 100.0f;
+
+    stratus::CpuVplCulling::ComputeVisibleLights(pair, glm::vec3(0.0f), isLit, 1, capped);
+    REQUIRE(capped == std::vector<int>{ 1 });
+}
+
+// Straightforward version of the stage 2 selection: stable sort by distance / radius and keep the closest
+static std::vector<int> ReferenceTileLights(
+    const std::vector<stratus::GpuVplData>& lights,
+    const std::vector<int>& visible,
+    const stratus::GpuVplStage1PerTileOutputs& tile) {
+
+    const glm::vec3 fragPos = glm::vec3(tile.averageLocalPosition.ToVec4());
+    const glm::vec3 normal = glm::vec3(tile.averageLocalNormal.ToVec4());
+
+    std::vector<std::pair<float, int>> accepted;
+    for (int index : visible) {
+        const glm::vec3 lightMinusFrag = glm::vec3(lights[index].position.ToVec4()) - fragPos;
+        if (glm::dot(normal, lightMinusFrag) < 0.0f) continue;
+        const float ratio = glm::length(lightMinusFrag) / lights[index].radius;
+        if (ratio > 1.0f) continue;
+        accepted.push_back(std::make_pair(ratio, index));
+    }
+
+    std::stable_sort(accepted.begin(), accepted.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+
+    std::vector<int> result;
+    for (size_t i = 0; i < accepted.size() && i < MAX_VPLS_PER_TILE; ++i) {
+        result.push_back(accepted[i].second);
+    }
+    return result;
+}
+
+TEST_CASE( "Stratus Cpu Vpl Tile Stage2 Test", "[stratus_cpu_vpl_culling_test]" ) {
+    std::cout << "Beginning stratus::CpuVplCulling tile stage 2 test" << std::endl;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> radius(1.0f, 25.0f);
+
+    std::vector<stratus::GpuVplData> lights(1003);
+    for (auto& light : lights) {
+        light.position = glm::vec4(position(rng), position(rng), position(rng), 1.0f);
+        light.radius = radius(rng);
+        light.intensity = 1.0f;
+    }
+
+    const auto isLit = [](const glm::vec3& p) { return p.y >= 0.0f; };
+    std::vector<int> visible;
+    stratus::CpuVplCulling::ComputeVisibleLights(lights, glm::vec3(0.0f), isLit, lights.size(), visible);
+
+    // Stage 2 should match the reference selection for every tile
+    std::vector<stratus::GpuVplStage1PerTileOutputs> stage1(257);
+    for (auto& tile : stage1) {
+        tile.averageLocalPosition = glm::vec4(position(rng), position(rng), position(rng), 1.0f);
+        const glm::vec3 normal = glm::normalize(glm::vec3(position(rng), position(rng), position(rng)) + glm::vec3(0.001f));
+        tile.averageLocalNormal = glm::vec4(normal, 1.0f);
+    }
+
+    std::vector<stratus::GpuVplStage2PerTileOutputs> stage2(stage1.size());
+    stratus::CpuVplCulling::ComputeTileStage2(lights, visible, stage1, 0, stage1.size(), stage2);
+
+    size_t tilesWithLights = 0;
+    size_t fullTiles = 0;
+    for (size_t i = 0; i < stage1.size(); ++i) {
+        const std::vector<int> expected = ReferenceTileLights(lights, visible, stage1[i]);
+        REQUIRE(stage2[i].numVisible == int(expected.size()));
+        for (size_t k = 0; k < expected.size(); ++k) {
+            REQUIRE(stage2[i].indices[k] == expected[k]);
+        }
+        if (expected.size() > 0) ++tilesWithLights;
+        if (expected.size() == MAX_VPLS_PER_TILE) ++fullTiles;
+    }
+    REQUIRE(tilesWithLights > 0);
+    REQUIRE(fullTiles > 0);
+
+    // Splitting the tile range should produce identical results
+    std::vector<stratus::GpuVplStage2PerTileOutputs> split(stage1.size());
+    stratus::CpuVplCulling::ComputeTileStage2(lights, visible, stage1, 0, 100, split);
+    stratus::CpuVplCulling::ComputeTileStage2(lights, visible, stage1, 100, stage1.size(), split);
+    for (size_t i = 0; i < stage1.size(); ++i) {
+        REQUIRE(split[i].numVisible == stage2[i].numVisible);
+        for (int k = 0; k < split[i].numVisible; ++k) {
+            REQUIRE(split[i].indices[k] == stage2[i].indices[k]);
+        }
+    }
+}
+
+TEST_CASE( "Stratus Cpu Vpl Tile Stage1 Test", "[stratus_cpu_vpl_culling_test]" ) {
+    std::cout << "Beginning stratus::CpuVplCulling tile stage 1 test" << std::endl;
+
+    stratus::CpuVplTileCullingInputs inputs;
+    inputs.viewportWidth = 23;
+    inputs.viewportHeight = 12;
+    // Identity inverse projection view means world position == NDC
+    inputs.invProjectionView = glm::mat4(1.0f);
+    inputs.depth.resize(inputs.viewportWidth * inputs.viewportHeight, 0.5f);
+    // Encoded +Y normal
+    inputs.normals.resize(inputs.viewportWidth * inputs.viewportHeight, glm::vec3(0.5f, 1.0f, 0.5f));
+
+    REQUIRE(stratus::CpuVplCulling::NumTilesX(inputs) == 4);
+    REQUIRE(stratus::CpuVplCulling::NumTilesY(inputs) == 2);
+
+    std::vector<stratus::GpuVplData> lights(1);
+    lights[0].position = glm::vec4(0.0f, 0.5f, 0.0f, 1.0f);
+    lights[0].radius = 10.0f;
+
+    stratus::CpuVplCullingResults results;
+    stratus::CpuVplCulling::PerformCulling(lights, glm::vec3(0.0f), [](const glm::vec3&) { return true; }, inputs, results);
+
+    REQUIRE(results.visibleIndices == std::vector<int>{ 0 });
+    REQUIRE(results.stage1.size() == 8);
+    REQUIRE(results.stage2.size() == 8);
+    for (size_t i = 0; i < results.stage1.size(); ++i) {
+        const glm::vec4 normal = results.stage1[i].averageLocalNormal.ToVec4();
+        REQUIRE(std::fabs(normal.y - 1.0f) < 1e-5f);
+        // Depth 0.5 -> NDC z of 0
+        REQUIRE(std::fabs(results.stage1[i].averageLocalPosition.v[2]) < 1e-5f);
+        REQUIRE(results.stage2[i].numVisible == 1);
+        REQUIRE(results.stage2[i].indices[0] == 0);
+    }
+
+    // Tile (0, 0) covers the first 5x5 pixels of a 20x10 dispatch
+    const float expectedX = ((2.5f / 20.0f) * 2.0f) - 1.0f;
+    REQUIRE(std::fabs(results.stage1[0].averageLocalPosition.v[0] - expectedX) < 1e-5f);
+}
@@ -2,9 +2,12 @@
 #include <iostream>
 #include <memory>
 #include <vector>
+#include <algorithm>
+#include <chrono>
 
 #include "StratusThread.h"
 #include "StratusAsync.h"
+#include "StratusTaskSystem.h"
 
 struct S {};
 
@@ -153,4 +156,141 @@ TEST_CASE( "Stratus Async Test", "[stratus_async_test]" ) {
     REQUIRE(called.load() == true);
     REQUIRE(computeVoid.Completed() == true);
     REQUIRE(computeVoid.Failed() == false);
-}
\ No newline at end of file
+}
+TEST_CASE( "Stratus Immediate Thread Test", "[stratus_immediate_thread_test]" ) {
+    std::cout << "Beginning stratus::Thread immediate dispatch test" << std::endl;
+
+    REQUIRE_THROWS(stratus::Thread("NoContext", false, stratus::ThreadDispatchMode::IMMEDIATE));
+
+    stratus::Thread thread("Immediate", true, stratus::ThreadDispatchMode::IMMEDIATE);
+    REQUIRE(thread.DispatchMode() == stratus::ThreadDispatchMode::IMMEDIATE);
+    REQUIRE(thread.Idle() == true);
+
+    // Runs in order without anyone calling Dispatch
+    std::atomic<int> counter(0);
+    const int numFunctions = 100;
+    for (int i = 0; i < numFunctions; ++i) {
+        thread.Queue([i, &counter, &thread]() {
+            REQUIRE(stratus::Thread::Current() == thread);
+            REQUIRE(counter.fetch_add(1) == i);
+        });
+    }
+    thread.Synchronize();
+    REQUIRE(thread.Idle() == true);
+    REQUIRE(counter.load() == numFunctions);
+
+    // Work queued from inside of work also starts right away, so a chain of stages does not
+    // need one dispatch per stage
+    counter.store(0);
+    const int numStages = 50;
+    std::function<void ()> stage;
+    stage = [&stage, &counter, &thread]() {
+        if (counter.fetch_add(1) + 1 < numStages) thread.Queue(stage);
+    };
+    thread.Queue(stage);
+    thread.Synchronize();
+    REQUIRE(counter.load() == numStages);
+
+    // Async works the same way
+    stratus::Async<int> compute(thread, []() { return new int(10); });
+    thread.Synchronize();
+    REQUIRE(compute.CompleteAndValid());
+    REQUIRE(compute.Get() == 10);
+}
+
+TEST_CASE( "Stratus Task Group Wait Test", "[stratus_task_group_wait_test]" ) {
+    std::cout << "Beginning stratus::TaskWait_ test" << std::endl;
+
+    stratus::Thread worker("Worker", true, stratus::ThreadDispatchMode::IMMEDIATE);
+    // Stands in for the thread which waits on the group, only runs what it is given on Dispatch
+    stratus::Thread waiter("Waiter", false);
+
+    std::atomic<bool> release(false);
+    std::vector<stratus::Async<int>> group;
+    for (int i = 0; i < 10; ++i) {
+        group.push_back(stratus::Async<int>(worker, [i, &release]() {
+            while (!release.load()) std::this_thread::yield();
+            return new int(i);
+        }));
+    }
+
+    std::atomic<int> calls(0);
+    waiter.Queue([&group, &calls, &waiter]() {
+        std::make_shared<stratus::TaskWait_<int>>([&calls, &waiter](const std::vector<stratus::Async<int>>& finished) {
+            REQUIRE(stratus::Thread::Current() == waiter);
+            for (size_t i = 0; i < finished.size(); ++i) {
+                REQUIRE(finished[i].CompleteAndValid());
+                REQUIRE(finished[i].Get() == int(i));
+            }
+            calls.fetch_add(1);
+        }, group)->Start();
+
+        // Groups which are already done (or empty) are reported right away
+        std::make_shared<stratus::TaskWait_<int>>([&calls](const std::vector<stratus::Async<int>>&) {
+            calls.fetch_add(1);
+        }, std::vector<stratus::Async<int>>())->Start();
+    });
+    waiter.Dispatch();
+    waiter.Dispatch();
+    REQUIRE(calls.load() == 1);
+
+    // Nothing polls the group, the last task to finish queues the callback
+    release.store(true);
+    worker.Synchronize();
+    REQUIRE(calls.load() == 1);
+    waiter.Dispatch();
+    REQUIRE(calls.load() == 2);
+}
+
+// Time from queueing a function to it starting, once on a thread which picks work up right away and once on
+// a thread which is dispatched by a frame loop
+TEST_CASE( "Stratus Task Dispatch Latency Test", "[stratus_task_dispatch_latency_test]" ) {
+    std::cout << "Beginning stratus::Thread dispatch latency test" << std::endl;
+
+    typedef std::chrono::steady_clock Clock;
+    constexpr int numSamples = 200;
+    // Shorter than a real frame to keep the test quick
+    constexpr auto framePeriod = std::chrono::milliseconds(2);
+
+    const auto measure = [](stratus::Thread& thread, const std::function<void ()>& pump) {
+        std::vector<double> latencies;
+        for (int i = 0; i < numSamples; ++i) {
+            std::atomic<bool> started(false);
+            Clock::time_point start;
+            const Clock::time_point queued = Clock::now();
+            thread.Queue([&started, &start]() {
+                start = Clock::now();
+                started.store(true);
+            });
+            while (!started.load()) pump();
+            thread.Synchronize();
+            latencies.push_back(std::chrono::duration<double, std::micro>(start - queued).count());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        return latencies;
+    };
+
+    stratus::Thread immediate("Immediate", true, stratus::ThreadDispatchMode::IMMEDIATE);
+    const auto immediateLatencies = measure(immediate, []() { std::this_thread::yield(); });
+
+    stratus::Thread manual("Manual", true);
+    Clock::time_point nextFrame = Clock::now() + framePeriod;
+    const auto manualLatencies = measure(manual, [&manual, &nextFrame, framePeriod]() {
+        if (Clock::now() < nextFrame) {
+            std::this_thread::yield();
+            return;
+        }
+        manual.Dispatch();
+        nextFrame += framePeriod;
+    });
+
+    const auto report = [](const char * name, const std::vector<double>& latencies) {
+        std::cout << name << " schedule to start latency us: p50 " << latencies[latencies.size() / 2]
+                  << ", p99 " << latencies[latencies.size() * 99 / 100]
+                  << ", max " << latencies.back() << std::endl;
+    };
+    report("Immediate", immediateLatencies);
+    report("Per frame dispatch", manualLatencies);
+
+    REQUIRE(immediateLatencies[numSamples / 2] < manualLatencies[numSamples / 2]);
+}